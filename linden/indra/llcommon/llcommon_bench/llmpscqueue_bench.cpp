@@ -0,0 +1,325 @@
+/**
+ * @file llmpscqueue_bench.cpp
+ * @brief Measures texture fetch request table contention, one mutex against shards and an LLMPSCQueue.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#include "linden_common.h"
+
+#include "llmpscqueue.h"
+#include "llstl.h"
+#include "llthread.h"
+#include "lltimer.h"
+#include "lluuid.h"
+
+// Models the texture fetcher's request table as the main thread and the
+// fetch, cache and decode threads see it.  With one lock it is one mutex
+// around one map, and the main thread sets each priority under it, as
+// LLTextureFetch used to.  Sharded, the map is split by texture id and the
+// main thread collects a frame's priority changes and hands them to the
+// fetch thread as one batch through an LLMPSCQueue, as it does now.
+// Reports the main thread's milliseconds per frame for both while the
+// callback threads hit the same table, and exits with 1 if a priority
+// update went missing.
+//
+// usage: llmpscqueue_bench [-r requests] [-t callback_threads] [-f frames]
+
+namespace
+{
+	const S32 NUM_SHARDS = 16;
+
+	struct FetchRequest
+	{
+		LLMutex mWorkMutex;
+		F32 mPriority;
+		U32 mCallbacks;
+		FetchRequest() : mPriority(0.f), mCallbacks(0) {}
+	};
+
+	struct PriorityUpdate
+	{
+		LLUUID mID;
+		F32 mPriority;
+	};
+	typedef std::vector<PriorityUpdate> priority_update_list_t;
+
+	class FetchTable
+	{
+	public:
+		typedef std::map<LLUUID, FetchRequest*> map_t;
+
+		FetchTable(bool sharded) : mSharded(sharded) {}
+		~FetchTable()
+		{
+			for (S32 i = 0; i < NUM_SHARDS; ++i)
+			{
+				std::for_each(mShards[i].mMap.begin(), mShards[i].mMap.end(), DeletePairedPointer());
+			}
+		}
+
+		LLMutex& getMutex(const LLUUID& id) { return getShard(id).mMutex; }
+
+		// call getMutex(id).lock() first
+		FetchRequest* find(const LLUUID& id)
+		{
+			map_t& map = getShard(id).mMap;
+			map_t::iterator iter = map.find(id);
+			return iter != map.end() ? iter->second : NULL;
+		}
+
+		void createRequest(const LLUUID& id)
+		{
+			LLMutexLock lock(&getMutex(id));
+			getShard(id).mMap[id] = new FetchRequest;
+		}
+
+		void setPriority(const LLUUID& id, F32 priority)
+		{
+			LLMutexLock lock(&getMutex(id));
+			FetchRequest* request = find(id);
+			if (request)
+			{
+				request->mWorkMutex.lock();
+				request->mPriority = priority;
+				request->mWorkMutex.unlock();
+			}
+		}
+
+		// Main thread, like LLTextureFetch::updateRequestPriority()
+		void updatePriority(const LLUUID& id, F32 priority)
+		{
+			if (mSharded)
+			{
+				mPendingPriorities[id] = priority;
+			}
+			else
+			{
+				setPriority(id, priority);
+			}
+		}
+
+		// Main thread, like LLTextureFetch::flushPriorityUpdates()
+		void flushPriorityUpdates()
+		{
+			if (mPendingPriorities.empty())
+			{
+				return;
+			}
+			priority_update_list_t batch;
+			batch.reserve(mPendingPriorities.size());
+			for (std::map<LLUUID, F32>::iterator iter = mPendingPriorities.begin();
+				 iter != mPendingPriorities.end(); ++iter)
+			{
+				PriorityUpdate update;
+				update.mID = iter->first;
+				update.mPriority = iter->second;
+				batch.push_back(update);
+			}
+			mPendingPriorities.clear();
+			mPriorityUpdates.push(batch);
+		}
+
+		// Fetch thread, like LLTextureFetch::applyPriorityUpdates()
+		void applyPriorityUpdates()
+		{
+			std::vector<priority_update_list_t> batches;
+			mPriorityUpdates.popAll(batches);
+			for (std::vector<priority_update_list_t>::iterator batch = batches.begin(); batch != batches.end(); ++batch)
+			{
+				for (priority_update_list_t::iterator iter = batch->begin(); iter != batch->end(); ++iter)
+				{
+					setPriority(iter->mID, iter->mPriority);
+				}
+			}
+		}
+
+		// Any thread, like the cache, decode and HTTP responders
+		void callback(const LLUUID& id)
+		{
+			LLMutexLock lock(&getMutex(id));
+			FetchRequest* request = find(id);
+			if (request)
+			{
+				request->mWorkMutex.lock();
+				request->mCallbacks++;
+				request->mWorkMutex.unlock();
+			}
+		}
+
+	private:
+		struct Shard
+		{
+			LLMutex mMutex;
+			map_t mMap;
+		};
+		Shard& getShard(const LLUUID& id) { return mShards[mSharded ? (id.mData[0] & (NUM_SHARDS - 1)) : 0]; }
+
+		bool mSharded;
+		Shard mShards[NUM_SHARDS];
+		std::map<LLUUID, F32> mPendingPriorities;	// main thread only
+		LLMPSCQueue<priority_update_list_t> mPriorityUpdates;
+	};
+
+	class CallbackThread : public LLThread
+	{
+	public:
+		CallbackThread(FetchTable& table, const std::vector<LLUUID>& ids, S32 index, LLAtomicS32& stop)
+			: LLThread("Fetch callbacks"), mTable(table), mIDs(ids), mIndex(index), mStop(stop)
+		{
+		}
+
+		/*virtual*/ void run()
+		{
+			S32 count = (S32)mIDs.size();
+			S32 i = mIndex % count;
+			while (!mStop)
+			{
+				if (mIndex == 0)
+				{
+					mTable.applyPriorityUpdates();
+				}
+				for (S32 j = 0; j < 64; ++j)
+				{
+					i = (i + 7) % count;
+					mTable.callback(mIDs[i]);
+				}
+			}
+		}
+
+	private:
+		FetchTable& mTable;
+		const std::vector<LLUUID>& mIDs;
+		S32 mIndex;
+		LLAtomicS32& mStop;
+	};
+
+	void wait_for_threads(std::vector<LLThread*>& threads)
+	{
+		for (std::vector<LLThread*>::iterator iter = threads.begin(); iter != threads.end(); ++iter)
+		{
+			while (!(*iter)->isStopped())
+			{
+				ms_sleep(1);
+			}
+			delete *iter;
+		}
+		threads.clear();
+	}
+
+	// Returns the main thread's seconds per frame of updateImages()-style
+	// traffic while the callback threads hammer the same table, and the
+	// lowest priority left in the table.
+	F64 bench(bool sharded, const std::vector<LLUUID>& ids, S32 callback_threads, S32 frames,
+			  F32& last_priority)
+	{
+		FetchTable table(sharded);
+		for (U32 i = 0; i < ids.size(); ++i)
+		{
+			table.createRequest(ids[i]);
+		}
+
+		LLAtomicS32 stop(0);
+		std::vector<LLThread*> threads;
+		for (S32 i = 0; i < callback_threads; ++i)
+		{
+			threads.push_back(new CallbackThread(table, ids, i, stop));
+			threads.back()->start();
+		}
+
+		LLTimer timer;
+		for (S32 frame = 0; frame < frames; ++frame)
+		{
+			for (U32 i = 0; i < ids.size(); ++i)
+			{
+				// getRequestFinished() still looks the request up
+				{
+					LLMutexLock lock(&table.getMutex(ids[i]));
+					table.find(ids[i]);
+				}
+				table.updatePriority(ids[i], (F32)(frame + 1));
+			}
+			table.flushPriorityUpdates();
+		}
+		F64 elapsed = timer.getElapsedTimeF64();
+
+		stop = 1;
+		wait_for_threads(threads);
+		table.applyPriorityUpdates();
+
+		last_priority = (F32)frames;
+		for (U32 i = 0; i < ids.size(); ++i)
+		{
+			LLMutexLock lock(&table.getMutex(ids[i]));
+			last_priority = llmin(last_priority, table.find(ids[i])->mPriority);
+		}
+		return elapsed / frames;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	S32 requests = 4096;
+	S32 callback_threads = 3;
+	S32 frames = 30;
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		S32 value = llmax(1, atoi(argv[i + 1]));
+		if (!strcmp(argv[i], "-r"))
+		{
+			requests = value;
+		}
+		else if (!strcmp(argv[i], "-t"))
+		{
+			callback_threads = value;
+		}
+		else if (!strcmp(argv[i], "-f"))
+		{
+			frames = value;
+		}
+	}
+
+	std::vector<LLUUID> ids(requests);
+	for (S32 i = 0; i < requests; ++i)
+	{
+		ids[i].generate();
+	}
+
+	F32 locked_priority = 0.f;
+	F64 locked = bench(false, ids, callback_threads, frames, locked_priority);
+	F32 sharded_priority = 0.f;
+	F64 sharded = bench(true, ids, callback_threads, frames, sharded_priority);
+
+	bool applied = locked_priority == (F32)frames && sharded_priority == (F32)frames;
+	printf("%d requests, %d callback threads, %d frames: single mutex %.3f ms/frame, sharded %.3f ms/frame  %.2fx  %s\n",
+		   requests, callback_threads, frames, locked * 1000.0, sharded * 1000.0,
+		   locked / llmax(sharded, 1.0e-9),
+		   applied ? "all priorities applied" : "PRIORITY UPDATES LOST");
+	return applied ? 0 : 1;
+}
@@ -0,0 +1,319 @@
+/**
+ * @file llpriorityheap_bench.cpp
+ * @brief Measures the image priority list kept in a heap against a sorted set.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#include "linden_common.h"
+
+#include <map>
+#include <set>
+#if LL_WINDOWS
+#include <hash_map>
+#else
+#include <ext/hash_map>
+#endif
+
+#include "llmath.h"
+#include "llpriorityheap.h"
+#include "lltimer.h"
+#include "lluuid.h"
+
+// Models the viewer's texture list as seen by
+// updateImagesDecodePriorities() and updateImagesFetchTextures(), with
+// enough priority updates a frame to refresh every image once a second at
+// 60 fps.  The old list keeps the images in a set sorted by priority and
+// walks a map by UUID; the new one keeps them in an LLPriorityHeap and
+// walks its handles.  Reports milliseconds per frame of updates plus
+// taking the top images, and nanoseconds per lookup by UUID, for both.
+// Exits with 1 if a lookup fails or a list's top is out of order.
+//
+// usage: llpriorityheap_bench [-n images] [-f frames]
+
+namespace
+{
+	const S32 FRAMES_PER_SECOND = 60;
+	const S32 TOP_COUNT = 32;
+
+	// Repeatable, so that both lists see the same camera moves
+	U32 sRandomSeed = 1;
+	U32 next_random(U32 range)
+	{
+		sRandomSeed = sRandomSeed * 1664525 + 1013904223;
+		return (sRandomSeed >> 8) % range;
+	}
+
+	struct Image
+	{
+		LLUUID mID;
+		F32 mDecodePriority;
+		F32 mPixelArea;			// What the priority is worked out from
+		S32 mHandle;
+	};
+
+	struct CompareImages
+	{
+		bool operator()(const Image* lhs, const Image* rhs) const
+		{
+			if (lhs->mDecodePriority != rhs->mDecodePriority)
+			{
+				return lhs->mDecodePriority > rhs->mDecodePriority;
+			}
+			return lhs < rhs;
+		}
+	};
+
+	F32 calc_priority(const Image& image)
+	{
+		return image.mPixelArea > 0.f ? 100000.f + fsqrtf(image.mPixelArea) : -2.f;
+	}
+
+	// Moves the camera: about one image in eight changes what it needs.
+	void move_camera(std::vector<Image>& images, S32 frame)
+	{
+		for (S32 i = frame % 8; i < (S32)images.size(); i += 8)
+		{
+			images[i].mPixelArea = next_random(4) == 0 ? 0.f : (F32)next_random(512 * 512);
+		}
+	}
+
+	class SetList
+	{
+	public:
+		SetList(std::vector<Image>& images)
+		{
+			for (std::vector<Image>::iterator iter = images.begin(); iter != images.end(); ++iter)
+			{
+				mUUIDMap[iter->mID] = &*iter;
+				mImageList.insert(&*iter);
+			}
+		}
+
+		// update_count images a frame, carrying on from the last one
+		void update(S32 update_count, std::vector<Image*>& top)
+		{
+			std::map<LLUUID, Image*>::iterator iter = mUUIDMap.upper_bound(mLastUpdateUUID);
+			for (S32 i = 0; i < update_count; ++i)
+			{
+				if (iter == mUUIDMap.end())
+				{
+					iter = mUUIDMap.begin();
+				}
+				mLastUpdateUUID = iter->first;
+				Image* image = iter->second;
+				++iter;
+				mImageList.erase(image);
+				image->mDecodePriority = calc_priority(*image);
+				mImageList.insert(image);
+			}
+			top.clear();
+			std::set<Image*, CompareImages>::iterator top_iter = mImageList.begin();
+			for (S32 i = 0; i < TOP_COUNT && top_iter != mImageList.end(); ++i, ++top_iter)
+			{
+				top.push_back(*top_iter);
+			}
+		}
+
+		Image* find(const LLUUID& id)
+		{
+			std::map<LLUUID, Image*>::iterator iter = mUUIDMap.find(id);
+			return iter != mUUIDMap.end() ? iter->second : NULL;
+		}
+
+	private:
+		std::map<LLUUID, Image*> mUUIDMap;
+		LLUUID mLastUpdateUUID;
+		std::set<Image*, CompareImages> mImageList;
+	};
+
+	class HeapList
+	{
+	public:
+		HeapList(std::vector<Image>& images)
+			: mLastUpdateHandle(0)
+		{
+			for (std::vector<Image>::iterator iter = images.begin(); iter != images.end(); ++iter)
+			{
+				mUUIDMap[iter->mID] = &*iter;
+				iter->mHandle = mImageList.insert(&*iter, iter->mDecodePriority);
+			}
+		}
+
+		void update(S32 update_count, std::vector<Image*>& top)
+		{
+			const S32 handle_count = mImageList.getHandleCount();
+			mBatch.clear();
+			for (S32 i = 0; i < update_count; ++i)
+			{
+				mLastUpdateHandle = (mLastUpdateHandle + 1) % handle_count;
+				mBatch.push_back(mImageList.get(mLastUpdateHandle));
+			}
+			mPriorities.resize(update_count);
+			for (S32 i = 0; i < update_count; ++i)
+			{
+				mPriorities[i] = calc_priority(*mBatch[i]);
+			}
+			for (S32 i = 0; i < update_count; ++i)
+			{
+				mBatch[i]->mDecodePriority = mPriorities[i];
+				mImageList.setPriority(mBatch[i]->mHandle, mPriorities[i]);
+			}
+			top.clear();
+			mImageList.getTop(TOP_COUNT, top);
+		}
+
+		Image* find(const LLUUID& id)
+		{
+			uuid_map_t::iterator iter = mUUIDMap.find(id);
+			return iter != mUUIDMap.end() ? iter->second : NULL;
+		}
+
+	private:
+#if LL_WINDOWS
+		typedef stdext::hash_map<LLUUID, Image*, lluuid_hash> uuid_map_t;
+#else
+		typedef __gnu_cxx::hash_map<LLUUID, Image*, lluuid_hash> uuid_map_t;
+#endif
+		uuid_map_t mUUIDMap;
+		LLPriorityHeap<Image*> mImageList;
+		S32 mLastUpdateHandle;
+		std::vector<Image*> mBatch;
+		std::vector<F32> mPriorities;
+	};
+
+	void make_images(std::vector<Image>& images, S32 count)
+	{
+		images.resize(count);
+		for (S32 i = 0; i < count; ++i)
+		{
+			images[i].mID.generate();
+			images[i].mPixelArea = (F32)next_random(512 * 512);
+			images[i].mDecodePriority = calc_priority(images[i]);
+			images[i].mHandle = -1;
+		}
+	}
+
+	bool top_in_order(const std::vector<Image*>& top)
+	{
+		for (S32 i = 1; i < (S32)top.size(); ++i)
+		{
+			if (top[i - 1]->mDecodePriority < top[i]->mDecodePriority)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Returns the seconds per frame spent updating update_count priorities
+	// and taking the top ones, and the seconds for a lookup of each image.
+	// found is the number of images the lookups found.
+	template <class LIST>
+	F64 bench(std::vector<Image>& images, S32 update_count, S32 frames,
+			  F64& find_seconds, S32& found, std::vector<Image*>& top)
+	{
+		sRandomSeed = 1;
+		LIST list(images);
+		F64 elapsed = 0.0;
+		for (S32 frame = 0; frame < frames; ++frame)
+		{
+			move_camera(images, frame);
+			LLTimer timer;
+			list.update(update_count, top);
+			elapsed += timer.getElapsedTimeF64();
+		}
+
+		LLTimer timer;
+		found = 0;
+		for (S32 i = 0; i < (S32)images.size(); ++i)
+		{
+			found += list.find(images[i].mID) ? 1 : 0;
+		}
+		find_seconds = timer.getElapsedTimeF64() / images.size();
+		return elapsed / frames;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	S32 num_images = 50000;
+	S32 frames = 120;
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		S32 value = llmax(1, atoi(argv[i + 1]));
+		if (!strcmp(argv[i], "-n"))
+		{
+			num_images = value;
+		}
+		else if (!strcmp(argv[i], "-f"))
+		{
+			frames = value;
+		}
+	}
+	const S32 update_count = llmin(num_images / FRAMES_PER_SECOND + 1, num_images);
+
+	std::vector<Image> set_images;
+	make_images(set_images, num_images);
+	std::vector<Image> heap_images(set_images);
+
+	std::vector<Image*> set_top;
+	F64 set_find = 0.0;
+	S32 set_found = 0;
+	F64 set_frame = bench<SetList>(set_images, update_count, frames, set_find, set_found, set_top);
+
+	std::vector<Image*> heap_top;
+	F64 heap_find = 0.0;
+	S32 heap_found = 0;
+	F64 heap_frame = bench<HeapList>(heap_images, update_count, frames, heap_find, heap_found, heap_top);
+
+	// The two walk the images in different orders, so only check that
+	// each list's top is what is in it.
+	F32 highest = -2.f;
+	for (S32 i = 0; i < num_images; ++i)
+	{
+		highest = llmax(highest, heap_images[i].mDecodePriority);
+	}
+	bool ok = set_found == num_images && heap_found == num_images
+		&& (S32)heap_top.size() == llmin(TOP_COUNT, num_images)
+		&& heap_top[0]->mDecodePriority == highest
+		&& top_in_order(heap_top) && top_in_order(set_top);
+
+	// The old pass updated at most 32 images a frame, and fewer at high
+	// frame rates, so a full pass took this long.
+	const S32 old_update_count = llmin(1024 / FRAMES_PER_SECOND + 1, 32);
+	printf("%d images, %d priority updates a frame: set %.3f ms/frame, heap %.3f ms/frame  %.2fx\n",
+		   num_images, update_count, set_frame * 1000.0, heap_frame * 1000.0,
+		   set_frame / llmax(heap_frame, 1.0e-9));
+	printf("lookup: map %.1f ns, hash %.1f ns; every priority refreshed in %d s before, 1 s now  %s\n",
+		   set_find * 1000000000.0, heap_find * 1000000000.0,
+		   num_images / old_update_count / FRAMES_PER_SECOND,
+		   ok ? "lists consistent" : "LIST MISMATCH");
+	return ok ? 0 : 1;
+}
@@ -33,7 +33,12 @@
 
 #include "llfasttimer.h"
 
+#include <ostream>
+#include <vector>
+
+#include "llapr.h"
 #include "llprocessor.h"
+#include "llthread.h"
 
 
 #if LL_WINDOWS
@@ -51,19 +56,18 @@
 // statics
 
 
-LLFastTimer::EFastTimerType LLFastTimer::sCurType = LLFastTimer::FTM_OTHER;
-int LLFastTimer::sCurDepth = 0;
-U64 LLFastTimer::sStart[LLFastTimer::FTM_MAX_DEPTH];
-U64 LLFastTimer::sCounter[LLFastTimer::FTM_NUM_TYPES];
-U64 LLFastTimer::sCountHistory[LLFastTimer::FTM_HISTORY_NUM][LLFastTimer::FTM_NUM_TYPES];
-U64 LLFastTimer::sCountAverage[LLFastTimer::FTM_NUM_TYPES];
-U64 LLFastTimer::sCalls[LLFastTimer::FTM_NUM_TYPES];
-U64 LLFastTimer::sCallHistory[LLFastTimer::FTM_HISTORY_NUM][LLFastTimer::FTM_NUM_TYPES];
-U64 LLFastTimer::sCallAverage[LLFastTimer::FTM_NUM_TYPES];
+S32 LLFastTimer::sCurType = LLFastTimer::FTM_OTHER;
+U64 LLFastTimer::sCounter[LLFastTimer::FTM_MAX_TIMERS];
+U64 LLFastTimer::sCountHistory[LLFastTimer::FTM_HISTORY_NUM][LLFastTimer::FTM_MAX_TIMERS];
+U64 LLFastTimer::sCountAverage[LLFastTimer::FTM_MAX_TIMERS];
+U64 LLFastTimer::sCalls[LLFastTimer::FTM_MAX_TIMERS];
+U64 LLFastTimer::sCallHistory[LLFastTimer::FTM_HISTORY_NUM][LLFastTimer::FTM_MAX_TIMERS];
+U64 LLFastTimer::sCallAverage[LLFastTimer::FTM_MAX_TIMERS];
 S32 LLFastTimer::sCurFrameIndex = -1;
 S32 LLFastTimer::sLastFrameIndex = -1;
 int LLFastTimer::sPauseHistory = 0;
 int LLFastTimer::sResetHistory = 0;
+S32 LLFastTimer::sCapture = 0;
 
 F64 LLFastTimer::sCPUClockFrequency = 0.0;
 
@@ -73,6 +77,78 @@ U64 LLFastTimer::sClockResolution = 1e9; // Nanosecond resolution
 U64 LLFastTimer::sClockResolution = 1e6; // Microsecond resolution
 #endif
 
+// Events are written by the timer's own thread and read by
+// exportChromeTrace() on the main thread without a lock: the writer bumps
+// mWritten after each event, and the reader throws away whatever the writer
+// may have overwritten while it was copying.
+struct LLFastTimer::CaptureRing
+{
+	struct Event
+	{
+		U64 mBegin;
+		U64 mEnd;
+		S32 mType;
+	};
+	Event mEvents[FTM_CAPTURE_EVENTS];
+	volatile apr_uint32_t mWritten;
+};
+
+namespace
+{
+	volatile void* sThreadStates = NULL;	// LLFastTimer::ThreadState list head
+	volatile apr_uint32_t sNumThreadStates = 0;
+	LLFastTimer::ThreadState* sFrameState = NULL;	// the thread calling reset()
+
+	S32 sNumNamedTimers = 0;
+	std::vector<std::string>& timer_names()
+	{
+		static std::vector<std::string> names(LLFastTimer::FTM_MAX_TIMERS);
+		return names;
+	}
+
+	// Guards sNumNamedTimers and timer_names(): every LLQueuedThread
+	// registers a named timer, on whichever thread constructs it.  The
+	// first registration is a static or happens on the main thread, so the
+	// mutex itself is created before there is any contention.  It comes
+	// from the global root pool and is never freed, so it outlives any
+	// thread and any static NamedTimer.
+	LLMutex& named_timer_mutex()
+	{
+		static LLMutex* mutex = new LLMutex(AIAPRRootPool::get());
+		return *mutex;
+	}
+
+	// Start of each captured frame, by frame number modulo FTM_CAPTURE_FRAMES
+	U64 sFrameStart[LLFastTimer::FTM_CAPTURE_FRAMES];
+	S32 sCaptureFrame = 0;
+
+	std::string json_escape(const std::string& in)
+	{
+		std::string out;
+		for (std::string::const_iterator iter = in.begin(); iter != in.end(); ++iter)
+		{
+			if (*iter == '"' || *iter == '\\')
+			{
+				out += '\\';
+				out += *iter;
+			}
+			else if ((U8)*iter >= 0x20)
+			{
+				out += *iter;
+			}
+		}
+		return out;
+	}
+
+	struct TraceEvent
+	{
+		S32 mThread;
+		S32 mType;
+		U64 mBegin;
+		U64 mEnd;
+	};
+}
+
 //////////////////////////////////////////////////////////////////////////////
 
 //
@@ -155,10 +231,28 @@ U64 LLFastTimer::countsPerSecond()
 void LLFastTimer::reset()
 {
 	countsPerSecond(); // good place to calculate clock frequency
+
+	ThreadState& state = getThreadState();
+	if (sFrameState != &state)
+	{
+		// The totals and history only cover the thread calling reset()
+		if (sFrameState)
+		{
+			sFrameState->mCounter = NULL;
+			sFrameState->mCalls = NULL;
+		}
+		state.mCounter = sCounter;
+		state.mCalls = sCalls;
+		sFrameState = &state;
+		if (!state.mName[0])
+		{
+			setThreadName("Main");
+		}
+	}
 	
-	if (sCurDepth != 0)
+	if (state.mDepth != 0)
 	{
-		llerrs << "LLFastTimer::Reset() when sCurDepth != 0" << llendl;
+		llerrs << "LLFastTimer::Reset() when mDepth != 0" << llendl;
 	}
 	if (sPauseHistory)
 	{
@@ -172,7 +266,7 @@ void LLFastTimer::reset()
 	else if (sCurFrameIndex >= 0)
 	{
 		int hidx = sCurFrameIndex % FTM_HISTORY_NUM;
-		for (S32 i=0; i<FTM_NUM_TYPES; i++)
+		for (S32 i=0; i<FTM_MAX_TIMERS; i++)
 		{
 			sCountHistory[hidx][i] = sCounter[i];
 			sCountAverage[i] = (sCountAverage[i]*sCurFrameIndex + sCounter[i]) / (sCurFrameIndex+1);
@@ -183,7 +277,7 @@ void LLFastTimer::reset()
 	}
 	else
 	{
-		for (S32 i=0; i<FTM_NUM_TYPES; i++)
+		for (S32 i=0; i<FTM_MAX_TIMERS; i++)
 		{
 			sCountAverage[i] = 0;
 			sCallAverage[i] = 0;
@@ -192,12 +286,254 @@ void LLFastTimer::reset()
 	
 	sCurFrameIndex++;
 	
-	for (S32 i=0; i<FTM_NUM_TYPES; i++)
+	for (S32 i=0; i<FTM_MAX_TIMERS; i++)
 	{
 		sCounter[i] = 0;
 		sCalls[i] = 0;
 	}
-	sCurDepth = 0;
+	state.mDepth = 0;
+
+	sFrameStart[sCaptureFrame % FTM_CAPTURE_FRAMES] = get_cpu_clock_count();
+	sCaptureFrame++;
+}
+
+//static
+LLFastTimer::ThreadState& LLFastTimer::getThreadState()
+{
+#if LL_FAST_TIMER_TLS
+	if (!sThreadState)
+	{
+		sThreadState = LLThread::tldata().mFastTimerState;
+	}
+	return *sThreadState;
+#else
+	return *LLThread::tldata().mFastTimerState;
+#endif
+}
+
+//static
+LLFastTimer::ThreadState* LLFastTimer::createThreadState()
+{
+	// Take over the state of a thread that has exited, if any
+	for (ThreadState* state = (ThreadState*)sThreadStates; state; state = state->mNext)
+	{
+		if (apr_atomic_cas32(&state->mActive, 1, 0) == 0)
+		{
+			state->mDepth = 0;
+			state->mName[0] = 0;
+			if (state->mCapture)
+			{
+				apr_atomic_set32(&state->mCapture->mWritten, 0);
+			}
+			return state;
+		}
+	}
+
+	ThreadState* state = new ThreadState;
+	state->mDepth = 0;
+	state->mCounter = NULL;
+	state->mCalls = NULL;
+	state->mCapture = NULL;
+	state->mActive = 1;
+	state->mIndex = (S32)apr_atomic_inc32(&sNumThreadStates);
+	state->mName[0] = 0;
+	void* head;
+	do
+	{
+		head = (void*)sThreadStates;
+		state->mNext = (ThreadState*)head;
+	}
+	while (apr_atomic_casptr(&sThreadStates, state, head) != head);
+	return state;
+}
+
+//static
+void LLFastTimer::releaseThreadState(ThreadState* state)
+{
+	if (state)
+	{
+#if LL_FAST_TIMER_TLS
+		// called on the exiting thread
+		if (sThreadState == state)
+		{
+			sThreadState = NULL;
+		}
+#endif
+		apr_atomic_set32(&state->mActive, 0);
+	}
+}
+
+//static
+void LLFastTimer::setThreadName(const std::string& name)
+{
+	ThreadState& state = getThreadState();
+	strncpy(state.mName, name.c_str(), sizeof(state.mName) - 1);
+	state.mName[sizeof(state.mName) - 1] = 0;
+}
+
+LLFastTimer::NamedTimer::NamedTimer(const std::string& name)
+{
+	LLMutexLock lock(&named_timer_mutex());
+	std::vector<std::string>& names = timer_names();
+	for (S32 i = FTM_NUM_TYPES; i < FTM_NUM_TYPES + sNumNamedTimers; i++)
+	{
+		if (names[i] == name)
+		{
+			mID = i;
+			return;
+		}
+	}
+	if (sNumNamedTimers >= FTM_MAX_NAMED)
+	{
+		llwarns << "Too many named fast timers, counting " << name << " as FTM_OTHER" << llendl;
+		mID = FTM_OTHER;
+		return;
+	}
+	mID = FTM_NUM_TYPES + sNumNamedTimers++;
+	names[mID] = name;
+}
+
+//static
+void LLFastTimer::setTimerName(S32 type, const std::string& name)
+{
+	if (type >= 0 && type < FTM_NUM_TYPES)
+	{
+		LLMutexLock lock(&named_timer_mutex());
+		timer_names()[type] = name;
+	}
+}
+
+//static
+std::string LLFastTimer::getTimerName(S32 type)
+{
+	if (type < 0 || type >= FTM_MAX_TIMERS)
+	{
+		return std::string();
+	}
+	LLMutexLock lock(&named_timer_mutex());
+	const std::string& name = timer_names()[type];
+	return name.empty() ? llformat("Timer %d", type) : name;
+}
+
+//static
+void LLFastTimer::setCapture(bool capture)
+{
+	sCapture = capture ? 1 : 0;
+}
+
+//static
+void LLFastTimer::capture(ThreadState& state, S32 type, U64 begin, U64 end)
+{
+	CaptureRing* ring = state.mCapture;
+	if (!ring)
+	{
+		ring = new CaptureRing;
+		ring->mWritten = 0;
+		apr_atomic_xchgptr((volatile void**)&state.mCapture, ring);
+	}
+	CaptureRing::Event& event = ring->mEvents[ring->mWritten & (FTM_CAPTURE_EVENTS - 1)];
+	event.mBegin = begin;
+	event.mEnd = end;
+	event.mType = type;
+	apr_atomic_inc32(&ring->mWritten);
+}
+
+//static
+void LLFastTimer::exportChromeTrace(std::ostream& out, S32 num_frames)
+{
+	num_frames = llclamp(num_frames, 1, FTM_CAPTURE_FRAMES - 1);
+	S32 first_frame = llmax(sCaptureFrame - 1 - num_frames, 0);
+	U64 from = sCaptureFrame > num_frames ? sFrameStart[first_frame % FTM_CAPTURE_FRAMES] : 0;
+
+	std::vector<TraceEvent> events;
+	std::vector<std::pair<S32, std::string> > threads;
+	for (ThreadState* state = (ThreadState*)sThreadStates; state; state = state->mNext)
+	{
+		threads.push_back(std::make_pair(state->mIndex, std::string(state->mName)));
+		CaptureRing* ring = state->mCapture;
+		if (!ring)
+		{
+			continue;
+		}
+
+		U32 written = apr_atomic_read32(&ring->mWritten);
+		U32 count = llmin(written, (U32)FTM_CAPTURE_EVENTS);
+		size_t start = events.size();
+		for (U32 seq = written - count; seq != written; ++seq)
+		{
+			const CaptureRing::Event& event = ring->mEvents[seq & (FTM_CAPTURE_EVENTS - 1)];
+			TraceEvent trace_event;
+			trace_event.mThread = state->mIndex;
+			trace_event.mType = event.mType;
+			trace_event.mBegin = event.mBegin;
+			trace_event.mEnd = event.mEnd;
+			events.push_back(trace_event);
+		}
+
+		// Drop what the thread may have overwritten in the meantime
+		U32 now_written = apr_atomic_read32(&ring->mWritten);
+		if (now_written < written)
+		{
+			events.resize(start);
+			continue;
+		}
+		// the event being written now overwrites sequence now_written - FTM_CAPTURE_EVENTS
+		U32 oldest = written - count;
+		U32 valid_from = now_written >= (U32)FTM_CAPTURE_EVENTS ? now_written - FTM_CAPTURE_EVENTS + 1 : 0;
+		if (valid_from > oldest)
+		{
+			U32 stale = llmin(valid_from - oldest, count);
+			events.erase(events.begin() + start, events.begin() + start + stale);
+		}
+	}
+
+	U64 base = from;
+	if (!base)
+	{
+		base = (U64)-1;
+		for (std::vector<TraceEvent>::iterator iter = events.begin(); iter != events.end(); ++iter)
+		{
+			base = llmin(base, iter->mBegin);
+		}
+	}
+	const F64 usec_per_count = 1000000.0 / (F64)countsPerSecond();
+
+	out << "{\"traceEvents\":[";
+	bool first = true;
+	for (std::vector<std::pair<S32, std::string> >::iterator iter = threads.begin(); iter != threads.end(); ++iter)
+	{
+		std::string name = iter->second.empty() ? llformat("Thread %d", iter->first) : iter->second;
+		out << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+			<< iter->first << ",\"args\":{\"name\":\"" << json_escape(name) << "\"}}";
+		first = false;
+	}
+	if (sFrameState)
+	{
+		for (S32 frame = first_frame; frame < sCaptureFrame; frame++)
+		{
+			U64 frame_start = sFrameStart[frame % FTM_CAPTURE_FRAMES];
+			if (frame_start < base)
+			{
+				continue;
+			}
+			out << (first ? "" : ",") << "\n{\"name\":\"Frame\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":"
+				<< sFrameState->mIndex << ",\"ts\":" << llformat("%.3f", (F64)(frame_start - base) * usec_per_count) << "}";
+			first = false;
+		}
+	}
+	for (std::vector<TraceEvent>::iterator iter = events.begin(); iter != events.end(); ++iter)
+	{
+		if (iter->mBegin < from)
+		{
+			continue;
+		}
+		out << (first ? "" : ",") << "\n{\"name\":\"" << json_escape(getTimerName(iter->mType))
+			<< "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << iter->mThread
+			<< ",\"ts\":" << llformat("%.3f", (F64)(iter->mBegin - base) * usec_per_count)
+			<< ",\"dur\":" << llformat("%.3f", (F64)(iter->mEnd - iter->mBegin) * usec_per_count) << "}";
+		first = false;
+	}
+	out << "\n],\"displayTimeUnit\":\"ms\"}\n";
 }
 
 //////////////////////////////////////////////////////////////////////////////
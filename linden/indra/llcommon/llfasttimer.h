@@ -33,6 +33,9 @@
 #ifndef LL_LLFASTTIMER_H
 #define LL_LLFASTTIMER_H
 
+#include <iosfwd>
+#include <string>
+
 #define FAST_TIMER_ON 1
 
 LL_COMMON_API U64 get_cpu_clock_count();
@@ -90,6 +93,7 @@ public:
 		 FTM_RENDER_BUMP,
 		 FTM_RENDER_TREES,
 		 FTM_RENDER_CHARACTERS,
+		 FTM_AVATAR_SKINNING,
 		 FTM_RENDER_OCCLUSION,
 		 FTM_RENDER_ALPHA,
          FTM_RENDER_CLOUDS,
@@ -147,6 +151,7 @@ public:
 		FTM_OBJECTLIST_UPDATE,
 		FTM_AVATAR_UPDATE,
 		FTM_JOINT_UPDATE,
+		FTM_AVATAR_MORPHS,
 		FTM_ATTACHMENT_UPDATE,
 		FTM_LOD_UPDATE,
 		FTM_REGION_UPDATE,
@@ -193,25 +198,59 @@ public:
 	};
 	enum { FTM_HISTORY_NUM = 60 };
 	enum { FTM_MAX_DEPTH = 64 };
+	// Timers registered at run time get the ids after FTM_NUM_TYPES
+	enum { FTM_MAX_NAMED = 128 };
+	enum { FTM_MAX_TIMERS = FTM_NUM_TYPES + FTM_MAX_NAMED };
+	// Frames and events per thread kept for exportChromeTrace()
+	enum { FTM_CAPTURE_FRAMES = 64 };
+	enum { FTM_CAPTURE_EVENTS = 65536 }; // must be power of 2
+
+	// A timer registered by name rather than listed in EFastTimerType, so
+	// a library or worker thread can time itself without touching this
+	// header.  Timers with the same name share an id.  Construct these at
+	// static initialization time or on the main thread.
+	class LL_COMMON_API NamedTimer
+	{
+	public:
+		NamedTimer(const std::string& name);
+		S32 getID() const { return mID; }
+	private:
+		S32 mID;
+	};
+
+	struct CaptureRing;
+
+	// The timer stack of one thread.  Every thread has its own, so timers
+	// can be used on any thread; only the thread that calls reset() adds
+	// to sCounter and sCalls.
+	struct ThreadState
+	{
+		S32 mDepth;
+		U64 mStart[FTM_MAX_DEPTH];
+		U64* mCounter;			// NULL except on the frame thread
+		U64* mCalls;
+		CaptureRing* mCapture;	// allocated on the first captured timer
+		ThreadState* mNext;		// list of all thread states, never shrinks
+		volatile U32 mActive;	// 0 once the thread has exited
+		S32 mIndex;
+		char mName[64];
+	};
 	
 public:
-	static EFastTimerType sCurType;
+	static S32 sCurType;
 
 	LLFastTimer(EFastTimerType type)
 	{
 #if FAST_TIMER_ON
-		mType = type;
-		sCurType = type;
-		// These don't get counted, because they use CPU clockticks
-		//gTimerBins[gCurTimerBin]++;
-		//LLTimer::sNumTimerCalls++;
-
-		U64 cpu_clocks = get_cpu_clock_count();
-
-		sStart[sCurDepth] = cpu_clocks;
-		sCurDepth++;
+		start(type);
 #endif
-	};
+	}
+	LLFastTimer(const NamedTimer& timer)
+	{
+#if FAST_TIMER_ON
+		start(timer.getID());
+#endif
+	}
 	~LLFastTimer()
 	{
 #if FAST_TIMER_ON
@@ -223,37 +262,86 @@ public:
 		//LLTimer::sNumTimerCalls++;
 		end = get_cpu_clock_count();
 
-		sCurDepth--;
-		delta = end - sStart[sCurDepth];
-		sCounter[mType] += delta;
-		sCalls[mType]++;
+		ThreadState& state = *mState;
+		state.mDepth--;
+		delta = end - state.mStart[state.mDepth];
+		if (state.mCounter)
+		{
+			state.mCounter[mType] += delta;
+			state.mCalls[mType]++;
+		}
 		// Subtract delta from parents
-		for (i=0; i<sCurDepth; i++)
-			sStart[i] += delta;
+		for (i=0; i<state.mDepth; i++)
+			state.mStart[i] += delta;
+		if (sCapture)
+		{
+			capture(state, mType, mBegin, end);
+		}
 #endif
 	}
 
 	static void reset();
 	static U64 countsPerSecond();
 
+	// Thread states are created and released by AIThreadLocalData.
+	static ThreadState* createThreadState();
+	static void releaseThreadState(ThreadState* state);
+	// Name shown for the calling thread in exported traces
+	static void setThreadName(const std::string& name);
+
+	// Names the enum timers in exported traces; named timers already have one.
+	static void setTimerName(S32 type, const std::string& name);
+	static std::string getTimerName(S32 type);
+
+	// While capturing, every timer on every thread is recorded in a
+	// per-thread ring buffer.
+	static void setCapture(bool capture);
+	static bool getCapture() { return sCapture != 0; }
+	// Writes what was captured during the last num_frames frames and the
+	// one in progress as Chrome trace event JSON (chrome://tracing,
+	// Perfetto).  Call it from the thread that calls reset().
+	static void exportChromeTrace(std::ostream& out, S32 num_frames = FTM_CAPTURE_FRAMES - 1);
+
 public:
-	static int sCurDepth;
-	static U64 sStart[FTM_MAX_DEPTH];
-	static U64 sCounter[FTM_NUM_TYPES];
-	static U64 sCalls[FTM_NUM_TYPES];
-	static U64 sCountAverage[FTM_NUM_TYPES];
-	static U64 sCallAverage[FTM_NUM_TYPES];
-	static U64 sCountHistory[FTM_HISTORY_NUM][FTM_NUM_TYPES];
-	static U64 sCallHistory[FTM_HISTORY_NUM][FTM_NUM_TYPES];
+	static U64 sCounter[FTM_MAX_TIMERS];
+	static U64 sCalls[FTM_MAX_TIMERS];
+	static U64 sCountAverage[FTM_MAX_TIMERS];
+	static U64 sCallAverage[FTM_MAX_TIMERS];
+	static U64 sCountHistory[FTM_HISTORY_NUM][FTM_MAX_TIMERS];
+	static U64 sCallHistory[FTM_HISTORY_NUM][FTM_MAX_TIMERS];
 	static S32 sCurFrameIndex;
 	static S32 sLastFrameIndex;
 	static int sPauseHistory;
 	static int sResetHistory;
 	static F64 sCPUClockFrequency;
     static U64 sClockResolution;
+	static S32 sCapture;
 	
 private:
-	EFastTimerType mType;
+	void start(S32 type)
+	{
+		mState = &getThreadState();
+		mType = type;
+		if (mState->mCounter)
+		{
+			sCurType = type;
+		}
+
+		// These don't get counted, because they use CPU clockticks
+		//gTimerBins[gCurTimerBin]++;
+		//LLTimer::sNumTimerCalls++;
+
+		mBegin = get_cpu_clock_count();
+		mState->mStart[mState->mDepth] = mBegin;
+		mState->mDepth++;
+	}
+
+	static ThreadState& getThreadState();
+	static void capture(ThreadState& state, S32 type, U64 begin, U64 end);
+
+	ThreadState* mState;
+	S32 mType;
+	U64 mBegin;
 };
 
 
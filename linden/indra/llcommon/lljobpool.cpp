@@ -0,0 +1,172 @@
+/**
+ * @file lljobpool.cpp
+ * @brief Fork/join pool that runs the iterations of a job on worker threads.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#include "linden_common.h"
+
+#include "lljobpool.h"
+
+#include "lltimer.h"
+
+LLJobPool::LLJobPool(const std::string& name, S32 num_threads)
+	: mJob(NULL),
+	  mCount(0),
+	  mGeneration(0),
+	  mActive(0),
+	  mQuitting(false),
+	  mNext(0),
+	  mDone(0)
+{
+	for (S32 i = 0; i < num_threads; ++i)
+	{
+		mWorkers.push_back(new Worker(this, llformat("%s%d", name.c_str(), i)));
+		mWorkers.back()->start();
+	}
+}
+
+LLJobPool::~LLJobPool()
+{
+	mCondition.lock();
+	mQuitting = true;
+	mCondition.broadcast();
+	mCondition.unlock();
+
+	for (std::vector<Worker*>::iterator iter = mWorkers.begin(); iter != mWorkers.end(); ++iter)
+	{
+		Worker* worker = *iter;
+		S32 timeout = 100;
+		while (!worker->isStopped() && timeout-- > 0)
+		{
+			ms_sleep(10);
+			LLThread::yield();
+		}
+		if (worker->isStopped())
+		{
+			delete worker;
+		}
+		else
+		{
+			llwarns << "Job pool worker did not stop, leaking it" << llendl;
+		}
+	}
+}
+
+void LLJobPool::run(Job& job, S32 count)
+{
+	if (count <= 0)
+	{
+		return;
+	}
+	if (mWorkers.empty() || count == 1)
+	{
+		for (S32 i = 0; i < count; ++i)
+		{
+			job.run(i);
+		}
+		return;
+	}
+
+	mCondition.lock();
+	// A worker that woke too late for the last job may still be looking
+	// at it; let it leave before the job is replaced.
+	while (mActive > 0)
+	{
+		mCondition.unlock();
+		LLThread::yield();
+		mCondition.lock();
+	}
+	mJob = &job;
+	mCount = count;
+	mNext = 0;
+	mDone = 0;
+	mGeneration++;
+	mCondition.broadcast();
+	mCondition.unlock();
+
+	work();
+
+	mDoneCondition.lock();
+	while (mDone < count)
+	{
+		mDoneCondition.wait();
+	}
+	mDoneCondition.unlock();
+}
+
+void LLJobPool::work()
+{
+	S32 index;
+	while ((index = mNext++) < mCount)
+	{
+		mJob->run(index);
+		if (mDone++ + 1 == mCount)
+		{
+			mDoneCondition.lock();
+			mDoneCondition.signal();
+			mDoneCondition.unlock();
+		}
+	}
+}
+
+LLJobPool::Worker::Worker(LLJobPool* pool, const std::string& name)
+	: LLThread(name),
+	  mPool(pool)
+{
+}
+
+//virtual
+void LLJobPool::Worker::run()
+{
+	U32 generation = 0;
+	while (1)
+	{
+		mPool->mCondition.lock();
+		while (!mPool->mQuitting && mPool->mGeneration == generation)
+		{
+			mPool->mCondition.wait();
+		}
+		if (mPool->mQuitting)
+		{
+			mPool->mCondition.unlock();
+			break;
+		}
+		generation = mPool->mGeneration;
+		mPool->mActive++;
+		mPool->mCondition.unlock();
+
+		mPool->work();
+
+		mPool->mCondition.lock();
+		mPool->mActive--;
+		mPool->mCondition.unlock();
+	}
+}
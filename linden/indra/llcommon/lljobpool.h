@@ -0,0 +1,95 @@
+/**
+ * @file lljobpool.h
+ * @brief Fork/join pool that runs the iterations of a job on worker threads.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#ifndef LL_LLJOBPOOL_H
+#define LL_LLJOBPOOL_H
+
+#include <vector>
+
+#include "llapr.h"
+#include "llthread.h"
+
+// A fixed set of worker threads that, together with the calling thread,
+// run the iterations of a job.  run() only returns once every iteration
+// has finished, so a job and its data can live on the caller's stack.
+// Workers sleep between jobs.
+class LL_COMMON_API LLJobPool
+{
+public:
+	class Job
+	{
+	public:
+		virtual ~Job() {}
+		// Called once for each index, from any thread of the pool.
+		virtual void run(S32 index) = 0;
+	};
+
+	// num_threads workers are started; 0 runs every job on the caller.
+	LLJobPool(const std::string& name, S32 num_threads);
+	~LLJobPool();
+
+	S32 getNumThreads() const { return (S32)mWorkers.size(); }
+
+	// Calls job.run(i) for every i in [0, count) and waits for them all.
+	// Only one thread at a time may call run().
+	void run(Job& job, S32 count);
+
+private:
+	class Worker : public LLThread
+	{
+	public:
+		Worker(LLJobPool* pool, const std::string& name);
+	private:
+		/*virtual*/ void run(void);
+		LLJobPool* mPool;
+	};
+	friend class Worker;
+
+	void work();
+
+	// Guards everything below except the atomics; workers wait on it
+	// for a new generation, the caller waits on mDoneCondition.
+	LLCondition mCondition;
+	LLCondition mDoneCondition;
+	Job* mJob;
+	S32 mCount;
+	U32 mGeneration;
+	S32 mActive;			// Workers between picking up a generation and finishing it
+	bool mQuitting;
+	LLAtomicS32 mNext;		// Next index to hand out
+	LLAtomicS32 mDone;		// Indices finished
+
+	std::vector<Worker*> mWorkers;
+};
+
+#endif // LL_LLJOBPOOL_H
@@ -0,0 +1,122 @@
+/**
+ * @file llmpscqueue.h
+ * @brief Lock-free queue with many producer threads and one consumer.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLMPSCQUEUE_H
+#define LL_LLMPSCQUEUE_H
+
+#include <vector>
+
+#include "llapr.h"
+
+// Any thread may push(); only one thread at a time may popAll().  Producers
+// never take a lock: they push onto a singly linked stack with a
+// compare-and-swap, and the consumer takes the whole stack with one exchange
+// and reverses it, so items come out in the order they were pushed.  As the
+// consumer never pops single nodes, there is no ABA problem.
+template <class T>
+class LLMPSCQueue
+{
+public:
+	LLMPSCQueue() : mHead(NULL) {}
+	~LLMPSCQueue()
+	{
+		deleteNodes(takeAll());
+	}
+
+	void push(const T& value)
+	{
+		Node* node = new Node(value);
+		void* head;
+		do
+		{
+			head = (void*)mHead;
+			node->mNext = (Node*)head;
+		}
+		while (apr_atomic_casptr(&mHead, node, head) != head);
+	}
+
+	// Consumer: appends everything pushed so far to out, oldest first.
+	// Returns the number of items taken.
+	S32 popAll(std::vector<T>& out)
+	{
+		Node* node = takeAll();
+		Node* oldest = NULL;
+		while (node)
+		{
+			Node* next = node->mNext;
+			node->mNext = oldest;
+			oldest = node;
+			node = next;
+		}
+		S32 count = 0;
+		for (node = oldest; node; node = node->mNext, ++count)
+		{
+			out.push_back(node->mValue);
+		}
+		deleteNodes(oldest);
+		return count;
+	}
+
+	// Only a hint when other threads are pushing.
+	bool empty() const { return mHead == NULL; }
+
+private:
+	struct Node
+	{
+		Node(const T& value) : mValue(value), mNext(NULL) {}
+		T mValue;
+		Node* mNext;
+	};
+
+	Node* takeAll()
+	{
+		if (mHead == NULL)
+		{
+			return NULL;
+		}
+		return (Node*)apr_atomic_xchgptr(&mHead, NULL);
+	}
+
+	static void deleteNodes(Node* node)
+	{
+		while (node)
+		{
+			Node* next = node->mNext;
+			delete node;
+			node = next;
+		}
+	}
+
+	volatile void* mHead;
+};
+
+#endif // LL_LLMPSCQUEUE_H
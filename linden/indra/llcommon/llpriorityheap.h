@@ -0,0 +1,251 @@
+/**
+ * @file llpriorityheap.h
+ * @brief Max heap with handles for changing the priority of queued items.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#ifndef LL_LLPRIORITYHEAP_H
+#define LL_LLPRIORITYHEAP_H
+
+#include <algorithm>
+#include <vector>
+
+// Items ordered by an F32 priority, highest first, in a heap with four
+// children to a node.  insert() returns a handle that stays good until the
+// item is erased, so a priority change is one sift up or down rather than
+// an erase and an insert.  Handles are small integers below
+// getHandleCount() and are reused after an erase, so walking them is a
+// stable way to visit every item a few at a time.
+template <class T>
+class LLPriorityHeap
+{
+public:
+	typedef S32 handle_t;
+
+	LLPriorityHeap() {}
+
+	S32 size() const { return (S32)mHeap.size(); }
+	bool empty() const { return mHeap.empty(); }
+
+	handle_t insert(const T& item, F32 priority)
+	{
+		handle_t handle;
+		if (mFreeHandles.empty())
+		{
+			handle = (handle_t)mSlots.size();
+			mSlots.push_back(Slot());
+		}
+		else
+		{
+			handle = mFreeHandles.back();
+			mFreeHandles.pop_back();
+		}
+		mSlots[handle].mItem = item;
+		Node node;
+		node.mPriority = priority;
+		node.mHandle = handle;
+		mHeap.push_back(node);
+		siftUp((S32)mHeap.size() - 1);
+		return handle;
+	}
+
+	void erase(handle_t handle)
+	{
+		llassert(isValid(handle));
+		S32 pos = mSlots[handle].mPos;
+		mSlots[handle].mItem = T();
+		mSlots[handle].mPos = -1;
+		mFreeHandles.push_back(handle);
+
+		Node last = mHeap.back();
+		mHeap.pop_back();
+		if (pos < (S32)mHeap.size())
+		{
+			// Put the last node in the hole and move it to where it belongs
+			mHeap[pos] = last;
+			mSlots[last.mHandle].mPos = pos;
+			reposition(pos);
+		}
+	}
+
+	void setPriority(handle_t handle, F32 priority)
+	{
+		llassert(isValid(handle));
+		S32 pos = mSlots[handle].mPos;
+		mHeap[pos].mPriority = priority;
+		reposition(pos);
+	}
+
+	void clear()
+	{
+		mHeap.clear();
+		mSlots.clear();
+		mFreeHandles.clear();
+	}
+
+	bool isValid(handle_t handle) const
+	{
+		return handle >= 0 && handle < (handle_t)mSlots.size() && mSlots[handle].mPos >= 0;
+	}
+	S32 getHandleCount() const { return (S32)mSlots.size(); }
+	const T& get(handle_t handle) const { return mSlots[handle].mItem; }
+	F32 getPriority(handle_t handle) const { return mHeap[mSlots[handle].mPos].mPriority; }
+
+	// The items in no particular order, for index < size()
+	const T& getAt(S32 index) const { return mSlots[mHeap[index].mHandle].mItem; }
+
+	const T& top() const { return getAt(0); }
+	F32 topPriority() const { return mHeap[0].mPriority; }
+
+	// Appends the count highest priority items to out, highest first,
+	// without changing the heap.
+	void getTop(S32 count, std::vector<T>& out) const
+	{
+		count = llmin(count, size());
+		if (count <= 0)
+		{
+			return;
+		}
+		// The next best is always a child of one already taken, so
+		// only the children of those are candidates.
+		std::vector<Candidate> candidates;
+		candidates.reserve(count * (ARITY - 1) + 1);
+		candidates.push_back(Candidate(mHeap[0].mPriority, 0));
+		while (count-- > 0)
+		{
+			std::pop_heap(candidates.begin(), candidates.end());
+			S32 pos = candidates.back().mPos;
+			candidates.pop_back();
+			out.push_back(getAt(pos));
+			S32 end = llmin(pos * ARITY + ARITY + 1, size());
+			for (S32 child = pos * ARITY + 1; child < end; ++child)
+			{
+				candidates.push_back(Candidate(mHeap[child].mPriority, child));
+				std::push_heap(candidates.begin(), candidates.end());
+			}
+		}
+	}
+
+private:
+	enum { ARITY = 4 };
+
+	// Priorities are kept in the heap itself so that sifting does not
+	// touch the items.
+	struct Node
+	{
+		F32 mPriority;
+		handle_t mHandle;
+	};
+
+	struct Candidate
+	{
+		Candidate(F32 priority, S32 pos) : mPriority(priority), mPos(pos) {}
+		bool operator<(const Candidate& rhs) const { return mPriority < rhs.mPriority; }
+		F32 mPriority;
+		S32 mPos;
+	};
+
+	struct Slot
+	{
+		Slot() : mPos(-1) {}
+		T mItem;
+		S32 mPos;				// Index in mHeap, -1 when free
+	};
+
+	void place(S32 pos, const Node& node)
+	{
+		mHeap[pos] = node;
+		mSlots[node.mHandle].mPos = pos;
+	}
+
+	void reposition(S32 pos)
+	{
+		if (pos > 0 && mHeap[(pos - 1) / ARITY].mPriority < mHeap[pos].mPriority)
+		{
+			siftUp(pos);
+		}
+		else
+		{
+			siftDown(pos);
+		}
+	}
+
+	void siftUp(S32 pos)
+	{
+		Node node = mHeap[pos];
+		while (pos > 0)
+		{
+			S32 parent = (pos - 1) / ARITY;
+			if (!(mHeap[parent].mPriority < node.mPriority))
+			{
+				break;
+			}
+			place(pos, mHeap[parent]);
+			pos = parent;
+		}
+		place(pos, node);
+	}
+
+	void siftDown(S32 pos)
+	{
+		Node node = mHeap[pos];
+		const S32 count = (S32)mHeap.size();
+		while (true)
+		{
+			S32 first = pos * ARITY + 1;
+			if (first >= count)
+			{
+				break;
+			}
+			S32 best = first;
+			S32 end = llmin(first + ARITY, count);
+			for (S32 child = first + 1; child < end; ++child)
+			{
+				if (mHeap[best].mPriority < mHeap[child].mPriority)
+				{
+					best = child;
+				}
+			}
+			if (!(node.mPriority < mHeap[best].mPriority))
+			{
+				break;
+			}
+			place(pos, mHeap[best]);
+			pos = best;
+		}
+		place(pos, node);
+	}
+
+	std::vector<Node> mHeap;
+	std::vector<Slot> mSlots;
+	std::vector<handle_t> mFreeHandles;
+};
+
+#endif // LL_LLPRIORITYHEAP_H
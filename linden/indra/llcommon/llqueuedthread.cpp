@@ -41,7 +41,8 @@ LLQueuedThread::LLQueuedThread(const std::string& name, bool threaded) :
 	LLThread(name),
 	mThreaded(threaded),
 	mIdleThread(TRUE),
-	mNextHandle(0)
+	mNextHandle(0),
+	mRequestTimer(name)
 {
 	if (mThreaded)
 	{
@@ -430,7 +431,11 @@ S32 LLQueuedThread::processNextRequest()
 	if (req)
 	{
 		// process request
-		bool complete = req->processRequest();
+		bool complete;
+		{
+			LLFastTimer t(mRequestTimer);
+			complete = req->processRequest();
+		}
 
 		if (complete)
 		{
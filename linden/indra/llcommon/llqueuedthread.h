@@ -212,6 +212,8 @@ protected:
 	request_hash_t mRequestHash;
 
 	handle_t mNextHandle;
+
+	LLFastTimer::NamedTimer mRequestTimer; // times processRequest(), named after the thread
 };
 
 #endif // LL_LLQUEUEDTHREAD_H
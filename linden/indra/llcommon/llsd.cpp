@@ -33,6 +33,9 @@
 #include "linden_common.h"
 #include "llsd.h"
 
+#include <algorithm>
+#include <new>
+
 #include "llerror.h"
 #include "../llmath/llmath.h"
 #include "llformat.h"
@@ -49,6 +52,7 @@ namespace
 #endif
 {
 	class ImplMap;
+	class ImplCompactMap;
 	class ImplArray;
 }
 
@@ -78,8 +82,13 @@ protected:
 
 	virtual ~Impl();
 	
+	virtual void destroy()						{ delete this; }
+		///< called when the last reference goes away
+	
 	bool shared() const							{ return mUseCount > 1; }
 	
+	friend class ::LLSDBuilder;
+	
 public:
 	static void reset(Impl*& var, Impl* impl);
 		///< safely set var to refer to the new impl (possibly shared)
@@ -93,6 +102,12 @@ public:
 	virtual ImplArray& makeArray(Impl*& var);
 		///< sure var is a modifiable, non-shared map or array
 	
+	virtual LLSD& refMap(Impl*& var, const String& k);
+		///< a modifiable value in var, which is made into a map
+	
+	virtual LLSDArena* arena() const			{ return NULL; }
+		///< the LLSDBuilder arena holding this, if any
+	
 	virtual LLSD::Type type() const				{ return LLSD::TypeUndefined; }
 	
 	static  void assignUndefined(LLSD::Impl*& var);
@@ -140,6 +155,96 @@ public:
 	static U32 sOutstandingCount;
 };
 
+class LLSDArena
+	/**< Memory for the values an LLSDBuilder makes.  Each value in it and
+		 the builder hold a reference; the blocks are freed with the last.
+	*/
+{
+public:
+	LLSDArena();
+	
+	void* allocate(size_t size);
+	
+	void ref()									{ ++mUseCount; }
+	void unref()								{ if (--mUseCount == 0) delete this; }
+	
+private:
+	~LLSDArena();
+	
+	enum
+	{
+		FIRST_BLOCK_SIZE = 1024,
+		MAX_BLOCK_SIZE = 32768,
+		ALIGNMENT = 8
+	};
+	
+	union Block
+	{
+		Block* mNext;
+		F64 mAlign;		// keeps the data after it aligned
+	};
+	
+	char* newBlock(size_t size);
+	
+	U32 mUseCount;
+	Block* mBlocks;
+	char* mFree;
+	size_t mFreeSize;
+	size_t mNextBlockSize;
+};
+
+LLSDArena::LLSDArena()
+	: mUseCount(0),
+	  mBlocks(NULL),
+	  mFree(NULL),
+	  mFreeSize(0),
+	  mNextBlockSize(FIRST_BLOCK_SIZE)
+{
+}
+
+LLSDArena::~LLSDArena()
+{
+	while (mBlocks)
+	{
+		Block* next = mBlocks->mNext;
+		delete[] (char*)mBlocks;
+		mBlocks = next;
+	}
+}
+
+void* LLSDArena::allocate(size_t size)
+{
+	size = (size + ALIGNMENT - 1) & ~(size_t)(ALIGNMENT - 1);
+	if (size > mFreeSize)
+	{
+		if (size >= mNextBlockSize)
+		{
+			// Big arrays get a block of their own
+			return newBlock(size);
+		}
+		mFree = newBlock(mNextBlockSize);
+		mFreeSize = mNextBlockSize;
+		if (mNextBlockSize < MAX_BLOCK_SIZE)
+		{
+			mNextBlockSize *= 2;
+		}
+	}
+	void* result = mFree;
+	mFree += size;
+	mFreeSize -= size;
+	return result;
+}
+
+char* LLSDArena::newBlock(size_t size)
+{
+	char* data = new char[sizeof(Block) + size];
+	++LLSD::Impl::sAllocationCount;
+	Block* block = (Block*)data;
+	block->mNext = mBlocks;
+	mBlocks = block;
+	return data + sizeof(Block);
+}
+
 #ifdef NAME_UNNAMED_NAMESPACE
 namespace LLSDUnnamedNamespace 
 #else
@@ -176,6 +281,57 @@ namespace
 	};
 
 	
+	template<class IMPL>
+	class ArenaImpl : public IMPL
+		///< An IMPL placed in an LLSDArena by LLSDBuilder
+	{
+	public:
+		ArenaImpl(LLSDArena* arena) : mArena(arena) { init(); }
+		template<class A>
+		ArenaImpl(LLSDArena* arena, const A& a) : IMPL(a), mArena(arena) { init(); }
+		template<class A, class B>
+		ArenaImpl(LLSDArena* arena, const A& a, const B& b) : IMPL(a, b), mArena(arena) { init(); }
+		
+		virtual LLSDArena* arena() const { return mArena; }
+		
+	protected:
+		virtual void destroy()
+		{
+			LLSDArena* arena = mArena;
+			this->~ArenaImpl();
+			arena->unref();
+		}
+		
+	private:
+		void init()
+		{
+			mArena->ref();
+			// Only the arena's blocks count as allocations
+			--LLSD::Impl::sAllocationCount;
+		}
+		
+		LLSDArena* mArena;
+	};
+	
+	template<class IMPL>
+	LLSD::Impl* arena_new(LLSDArena& arena)
+	{
+		return new (arena.allocate(sizeof(ArenaImpl<IMPL>))) ArenaImpl<IMPL>(&arena);
+	}
+	
+	template<class IMPL, class A>
+	LLSD::Impl* arena_new(LLSDArena& arena, const A& a)
+	{
+		return new (arena.allocate(sizeof(ArenaImpl<IMPL>))) ArenaImpl<IMPL>(&arena, a);
+	}
+	
+	template<class IMPL, class A, class B>
+	LLSD::Impl* arena_new(LLSDArena& arena, const A& a, const B& b)
+	{
+		return new (arena.allocate(sizeof(ArenaImpl<IMPL>))) ArenaImpl<IMPL>(&arena, a, b);
+	}
+
+	
 	class ImplBoolean
 		: public ImplBase<LLSD::TypeBoolean, LLSD::Boolean>
 	{
@@ -235,6 +391,8 @@ namespace
 		{ return llformat("%lg", mValue); }
 
 
+	LLSD::Real string_to_real(const LLSD::String& value);
+	
 	class ImplString
 		: public ImplBase<LLSD::TypeString, LLSD::String, const LLSD::String&>
 	{
@@ -261,9 +419,14 @@ namespace
 	}
 	
 	LLSD::Real		ImplString::asReal() const
+	{
+		return string_to_real(mValue);
+	}
+	
+	LLSD::Real string_to_real(const LLSD::String& value)
 	{
 		F64 v = 0.0;
-		std::istringstream i_stream(mValue);
+		std::istringstream i_stream(value);
 		i_stream >> v;
 
 		// we would probably like to ignore all trailing whitespace as
@@ -277,6 +440,30 @@ namespace
 	}
 	
 
+	class ImplArenaString : public LLSD::Impl
+		///< A String with its characters in an LLSDArena.  Assigning to it
+		//   makes an ImplString.
+	{
+	private:
+		const char* mChars;
+		U32 mLength;
+		
+	public:
+		ImplArenaString(const char* chars, U32 length)
+			: mChars(chars), mLength(length) { }
+		
+		virtual LLSD::Type type() const { return LLSD::TypeString; }
+		
+		virtual LLSD::Boolean	asBoolean() const	{ return mLength != 0; }
+		virtual LLSD::Integer	asInteger() const	{ return (int)asReal(); }
+		virtual LLSD::Real		asReal() const		{ return string_to_real(asString()); }
+		virtual LLSD::String	asString() const	{ return LLSD::String(mChars, mLength); }
+		virtual LLSD::UUID		asUUID() const	{ return LLUUID(asString()); }
+		virtual LLSD::Date		asDate() const	{ return LLDate(asString()); }
+		virtual LLSD::URI		asURI() const	{ return LLURI(asString()); }
+	};
+	
+
 	class ImplUUID
 		: public ImplBase<LLSD::TypeUUID, LLSD::UUID, const LLSD::UUID&>
 	{
@@ -340,6 +527,8 @@ namespace
 	protected:
 		ImplMap(const DataMap& data) : mData(data) { }
 		
+		friend class ImplCompactMap;
+		
 	public:
 		ImplMap() { }
 		
@@ -425,6 +614,298 @@ namespace
 		return i->second;
 	}
 
+
+	class ImplCompactMap : public LLSD::Impl
+		///< A map built by LLSDBuilder.  The entries are in an LLSDArena and
+		//   are sorted by key, if they did not arrive that way, on the first
+		//   lookup.  Once a map_const_iterator has been handed out, the
+		//   iteration map holds the values instead, so that writes keep the
+		//   iterators valid.  Erasing a key makes an ImplMap.
+	{
+	public:
+		ImplCompactMap();
+		virtual ~ImplCompactMap();
+		
+		LLSD& add(LLSDArena& arena, const LLSD::String& k);
+		
+		virtual ImplMap& makeMap(LLSD::Impl*& var);
+		virtual LLSD& refMap(LLSD::Impl*& var, const LLSD::String& k);
+		
+		virtual LLSD::Type type() const { return LLSD::TypeMap; }
+		
+		virtual LLSD::Boolean asBoolean() const { return size() != 0; }
+		
+		using LLSD::Impl::get; // Unhiding get(LLSD::Integer)
+		using LLSD::Impl::ref; // Unhiding ref(LLSD::Integer)
+		
+		virtual bool has(const LLSD::String&) const;
+		virtual LLSD get(const LLSD::String&) const;
+		virtual const LLSD& ref(const LLSD::String&) const;
+		
+		virtual int size() const;
+		
+		virtual LLSD::map_const_iterator beginMap() const { return iterationMap().begin(); }
+		virtual LLSD::map_const_iterator endMap() const { return iterationMap().end(); }
+		
+	private:
+		typedef std::map<LLSD::String, LLSD>	DataMap;
+		
+		struct Entry
+		{
+			const char* mKey;
+			U32 mKeyLength;
+			U32 mOrder;		// of duplicate keys, the last one added wins
+			LLSD mValue;
+		};
+		
+		static int compare(const char* a, U32 a_length, const char* b, U32 b_length);
+		static bool lessEntry(const Entry& a, const Entry& b);
+		
+		void sort() const;
+		Entry* find(const LLSD::String& k) const;
+		void copyTo(DataMap& data) const;
+		const DataMap& iterationMap() const;
+		
+		Entry* mEntries;
+		mutable U32 mCount;
+		U32 mCapacity;
+		U32 mNextOrder;
+		mutable bool mSorted;
+		mutable DataMap* mIterationMap;
+			///< only made for map_const_iterators, and then replaces mEntries
+	};
+	
+	ImplCompactMap::ImplCompactMap()
+		: mEntries(NULL),
+		  mCount(0),
+		  mCapacity(0),
+		  mNextOrder(0),
+		  mSorted(true),
+		  mIterationMap(NULL)
+	{
+	}
+	
+	ImplCompactMap::~ImplCompactMap()
+	{
+		delete mIterationMap;
+		for (U32 i = 0; i < mCount; ++i)
+		{
+			mEntries[i].~Entry();
+		}
+	}
+	
+	LLSD& ImplCompactMap::add(LLSDArena& arena, const LLSD::String& k)
+	{
+		if (mIterationMap)
+		{
+			// the last one added wins, as in mEntries
+			LLSD& value = (*mIterationMap)[k];
+			value.clear();
+			return value;
+		}
+		
+		if (mCount == mCapacity)
+		{
+			// The old entries are left in the arena
+			U32 capacity = mCapacity ? mCapacity * 2 : 4;
+			Entry* entries = (Entry*)arena.allocate(capacity * sizeof(Entry));
+			for (U32 i = 0; i < mCount; ++i)
+			{
+				new (entries + i) Entry(mEntries[i]);
+				mEntries[i].~Entry();
+			}
+			mEntries = entries;
+			mCapacity = capacity;
+		}
+		
+		char* key = (char*)arena.allocate(k.size());
+		memcpy(key, k.data(), k.size());
+		
+		Entry* entry = new (mEntries + mCount) Entry;
+		entry->mKey = key;
+		entry->mKeyLength = (U32)k.size();
+		entry->mOrder = mNextOrder++;
+		if (mSorted && mCount > 0)
+		{
+			const Entry& last = mEntries[mCount - 1];
+			mSorted = compare(last.mKey, last.mKeyLength, key, entry->mKeyLength) < 0;
+		}
+		++mCount;
+		return entry->mValue;
+	}
+	
+	ImplMap& ImplCompactMap::makeMap(LLSD::Impl*& var)
+	{
+		ImplMap* i = new ImplMap;
+		copyTo(i->mData);
+		Impl::assign(var, i);
+		return *i;
+	}
+	
+	LLSD& ImplCompactMap::refMap(LLSD::Impl*& var, const LLSD::String& k)
+	{
+		if (!shared())
+		{
+			if (mIterationMap)
+			{
+				// std::map keeps the iterators handed out valid
+				return (*mIterationMap)[k];
+			}
+			// Changing a value in place leaves the keys sorted
+			Entry* entry = find(k);
+			if (entry)
+			{
+				return entry->mValue;
+			}
+		}
+		return makeMap(var).ref(k);
+	}
+	
+	bool ImplCompactMap::has(const LLSD::String& k) const
+	{
+		if (mIterationMap)
+		{
+			return mIterationMap->find(k) != mIterationMap->end();
+		}
+		return find(k) != NULL;
+	}
+	
+	LLSD ImplCompactMap::get(const LLSD::String& k) const
+	{
+		return ref(k);
+	}
+	
+	const LLSD& ImplCompactMap::ref(const LLSD::String& k) const
+	{
+		if (mIterationMap)
+		{
+			DataMap::const_iterator i = mIterationMap->find(k);
+			return i != mIterationMap->end() ? i->second : undef();
+		}
+		const Entry* entry = find(k);
+		return entry ? entry->mValue : undef();
+	}
+	
+	int ImplCompactMap::size() const
+	{
+		if (mIterationMap)
+		{
+			return (int)mIterationMap->size();
+		}
+		sort();
+		return mCount;
+	}
+	
+	// Orders keys the way std::string does
+	int ImplCompactMap::compare(const char* a, U32 a_length, const char* b, U32 b_length)
+	{
+		int result = memcmp(a, b, llmin(a_length, b_length));
+		if (result == 0)
+		{
+			result = (a_length < b_length) ? -1 : (a_length > b_length);
+		}
+		return result;
+	}
+	
+	bool ImplCompactMap::lessEntry(const Entry& a, const Entry& b)
+	{
+		int result = compare(a.mKey, a.mKeyLength, b.mKey, b.mKeyLength);
+		return result < 0  ||  (result == 0  &&  a.mOrder < b.mOrder);
+	}
+	
+	void ImplCompactMap::sort() const
+	{
+		if (mSorted)
+		{
+			return;
+		}
+		
+		std::sort(mEntries, mEntries + mCount, lessEntry);
+		U32 count = 0;
+		for (U32 i = 0; i < mCount; ++i)
+		{
+			if (i + 1 < mCount
+				&& compare(mEntries[i].mKey, mEntries[i].mKeyLength,
+						   mEntries[i + 1].mKey, mEntries[i + 1].mKeyLength) == 0)
+			{
+				// Replaced by a later one
+				continue;
+			}
+			if (count != i)
+			{
+				mEntries[count] = mEntries[i];
+			}
+			++count;
+		}
+		for (U32 i = count; i < mCount; ++i)
+		{
+			mEntries[i].~Entry();
+		}
+		mCount = count;
+		mSorted = true;
+	}
+	
+	ImplCompactMap::Entry* ImplCompactMap::find(const LLSD::String& k) const
+	{
+		sort();
+		U32 low = 0;
+		U32 high = mCount;
+		while (low < high)
+		{
+			U32 mid = (low + high) / 2;
+			const Entry& entry = mEntries[mid];
+			int result = compare(entry.mKey, entry.mKeyLength, k.data(), (U32)k.size());
+			if (result < 0)
+			{
+				low = mid + 1;
+			}
+			else if (result > 0)
+			{
+				high = mid;
+			}
+			else
+			{
+				return mEntries + mid;
+			}
+		}
+		return NULL;
+	}
+	
+	void ImplCompactMap::copyTo(DataMap& data) const
+	{
+		if (mIterationMap)
+		{
+			data.insert(mIterationMap->begin(), mIterationMap->end());
+			return;
+		}
+		sort();
+		for (U32 i = 0; i < mCount; ++i)
+		{
+			const Entry& entry = mEntries[i];
+			data.insert(data.end(),
+				DataMap::value_type(LLSD::String(entry.mKey, entry.mKeyLength), entry.mValue));
+		}
+	}
+	
+	const ImplCompactMap::DataMap& ImplCompactMap::iterationMap() const
+	{
+		if (!mIterationMap)
+		{
+			DataMap* data = new DataMap;
+			copyTo(*data);
+			mIterationMap = data;
+			// the values must not be shared with the entries, or writing
+			// through the map would copy them
+			for (U32 i = 0; i < mCount; ++i)
+			{
+				mEntries[i].~Entry();
+			}
+			mCount = 0;
+		}
+		return *mIterationMap;
+	}
+	
+
 	class ImplArray : public LLSD::Impl
 	{
 	private:
@@ -589,7 +1070,7 @@ void LLSD::Impl::reset(Impl*& var, Impl* impl)
 	if (impl) ++impl->mUseCount;
 	if (var  &&  --var->mUseCount == 0)
 	{
-		delete var;
+		var->destroy();
 	}
 	var = impl;
 }
@@ -613,6 +1094,11 @@ ImplMap& LLSD::Impl::makeMap(Impl*& var)
 	return *im;
 }
 
+LLSD& LLSD::Impl::refMap(Impl*& var, const String& k)
+{
+	return makeMap(var).ref(k);
+}
+
 ImplArray& LLSD::Impl::makeArray(Impl*& var)
 {
 	ImplArray* ia = new ImplArray;
@@ -774,7 +1260,7 @@ LLSD& LLSD::insert(const String& k, const LLSD& v)
 void LLSD::erase(const String& k)		{ makeMap(impl).erase(k); }
 
 LLSD&		LLSD::operator[](const String& k)
-										{ return makeMap(impl).ref(k); }
+										{ return safe(impl).refMap(impl, k); }
 const LLSD& LLSD::operator[](const String& k) const
 										{ return safe(impl).ref(k); }
 
@@ -807,6 +1293,83 @@ const LLSD& LLSD::operator[](Integer i) const
 U32 LLSD::allocationCount()				{ return Impl::sAllocationCount; }
 U32 LLSD::outstandingCount()			{ return Impl::sOutstandingCount; }
 
+
+LLSDBuilder::LLSDBuilder()
+	: mArena(NULL)
+{
+}
+
+LLSDBuilder::~LLSDBuilder()
+{
+	reset();
+}
+
+void LLSDBuilder::reset()
+{
+	if (mArena)
+	{
+		mArena->unref();
+		mArena = NULL;
+	}
+}
+
+LLSDArena& LLSDBuilder::getArena()
+{
+	if (!mArena)
+	{
+		mArena = new LLSDArena;
+		mArena->ref();
+	}
+	return *mArena;
+}
+
+void LLSDBuilder::assign(LLSD& value, LLSD::Boolean v)
+	{ LLSD::Impl::reset(value.impl, arena_new<ImplBoolean>(getArena(), v)); }
+void LLSDBuilder::assign(LLSD& value, LLSD::Integer v)
+	{ LLSD::Impl::reset(value.impl, arena_new<ImplInteger>(getArena(), v)); }
+void LLSDBuilder::assign(LLSD& value, LLSD::Real v)
+	{ LLSD::Impl::reset(value.impl, arena_new<ImplReal>(getArena(), v)); }
+void LLSDBuilder::assign(LLSD& value, const LLSD::UUID& v)
+	{ LLSD::Impl::reset(value.impl, arena_new<ImplUUID>(getArena(), v)); }
+void LLSDBuilder::assign(LLSD& value, const LLSD::Date& v)
+	{ LLSD::Impl::reset(value.impl, arena_new<ImplDate>(getArena(), v)); }
+void LLSDBuilder::assign(LLSD& value, const LLSD::URI& v)
+	{ LLSD::Impl::reset(value.impl, arena_new<ImplURI>(getArena(), v)); }
+void LLSDBuilder::assign(LLSD& value, const LLSD::Binary& v)
+	{ LLSD::Impl::reset(value.impl, arena_new<ImplBinary>(getArena(), v)); }
+
+void LLSDBuilder::assign(LLSD& value, const char* v, size_t length)
+{
+	LLSDArena& arena = getArena();
+	char* chars = (char*)arena.allocate(length);
+	memcpy(chars, v, length);
+	LLSD::Impl::reset(value.impl,
+		arena_new<ImplArenaString>(arena, (const char*)chars, (U32)length));
+}
+
+void LLSDBuilder::makeMap(LLSD& value)
+	{ LLSD::Impl::reset(value.impl, arena_new<ImplCompactMap>(getArena())); }
+void LLSDBuilder::makeArray(LLSD& value)
+	{ LLSD::Impl::reset(value.impl, arena_new<ImplArray>(getArena())); }
+
+LLSD& LLSDBuilder::add(LLSD& map, const LLSD::String& key)
+{
+	LLSD::Impl* impl = map.impl;
+	if (mArena  &&  impl  &&  impl->arena() == mArena
+		&&  impl->type() == LLSD::TypeMap  &&  !impl->shared())
+	{
+		// The only maps in an arena are ImplCompactMaps
+		return static_cast<ArenaImpl<ImplCompactMap>*>(impl)->add(*mArena, key);
+	}
+	return map[key];
+}
+
+LLSD& LLSDBuilder::append(LLSD& array)
+{
+	array.append(LLSD());
+	return array[array.size() - 1];
+}
+
 static const char *llsd_dump(const LLSD &llsd, bool useXMLFormat)
 {
 	// sStorage is used to hold the string representation of the llsd last
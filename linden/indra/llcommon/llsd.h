@@ -324,12 +324,14 @@ public:
 		class Impl;
 private:
 		Impl* impl;
+		friend class LLSDBuilder;
 	//@}
 	
 	/** @name Unit Testing Interface */
 	//@{
 public:
-		static U32 allocationCount();	///< how many Impls have been made
+		static U32 allocationCount();	///< how many Impls have been allocated
+										//   (an LLSDBuilder arena block counts as one)
 		static U32 outstandingCount();	///< how many Impls are still alive
 	//@}
 
@@ -389,6 +391,58 @@ struct llsd_select_string : public std::unary_function<LLSD, LLSD::String>
 
 LL_COMMON_API std::ostream& operator<<(std::ostream& s, const LLSD& llsd);
 
+class LLSDArena;
+
+/**
+	Builds the values of a parsed document in one arena.  Maps are kept as
+	flat vectors sorted by key and strings are stored in the arena, so a
+	document costs a few allocations rather than several for each value.
+	The arena is freed when the last value built in it goes away; keeping
+	one small value keeps the whole document's memory.
+
+	The values are ordinary LLSD to everyone else.  A map built here is
+	turned into a normal map when it is shared and changed, when a key is
+	added or erased, or when it is asked for a map_iterator.  Like LLSD
+	itself, values from one arena must stay on one thread.
+*/
+class LL_COMMON_API LLSDBuilder
+{
+public:
+	LLSDBuilder();
+	~LLSDBuilder();
+
+	/// Later values go in a new arena; ones already built keep theirs.
+	void reset();
+
+	void assign(LLSD& value, LLSD::Boolean v);
+	void assign(LLSD& value, LLSD::Integer v);
+	void assign(LLSD& value, LLSD::Real v);
+	void assign(LLSD& value, const LLSD::String& v)	{ assign(value, v.data(), v.size()); }
+	void assign(LLSD& value, const char* v, size_t length);
+	void assign(LLSD& value, const LLSD::UUID& v);
+	void assign(LLSD& value, const LLSD::Date& v);
+	void assign(LLSD& value, const LLSD::URI& v);
+	void assign(LLSD& value, const LLSD::Binary& v);
+
+	void makeMap(LLSD& value);
+	void makeArray(LLSD& value);
+
+	/// Adds an undefined value to map and returns it for filling in.  It
+	/// is good until the next add() to the same map, so a parser has to
+	/// finish each child before starting the next.  Maps not made by this
+	/// builder get map[key].
+	LLSD& add(LLSD& map, const LLSD::String& key);
+	LLSD& append(LLSD& array);
+
+private:
+	LLSDArena& getArena();
+
+	/// Not implemented on purpose; see LLSD's Automatic Cast Protection.
+	void assign(LLSD& value, const char* v);
+
+	LLSDArena* mArena;
+};
+
 /** QUESTIONS & TO DOS
 	- Would Binary be more convenient as usigned char* buffer semantics?
 	- Should Binary be convertable to/from String, and if so how?
@@ -308,6 +308,7 @@ private:
 
 	LLSD mResult;
 	S32 mParseCount;
+	LLSDBuilder mBuilder;			// Holds each document in one arena
 	
 	bool mInLLSDElement;			// true if we're on LLSD
 	bool mGracefullStop;			// true if we found the </llsd
@@ -539,6 +540,7 @@ S32 LLSDXMLParser::Impl::parseLines(std::istream& input, LLSD& data)
 void LLSDXMLParser::Impl::reset()
 {
 	mResult.clear();
+	mBuilder.reset();
 	mParseCount = 0;
 
 	mInLLSDElement = false;
@@ -682,7 +684,7 @@ void LLSDXMLParser::Impl::startElementHandler(const XML_Char* name, const XML_Ch
 		if (mCurrentKey.empty()) { return startSkipping(); }
 		
 		LLSD& map = *mStack.back();
-		LLSD& newElement = map[mCurrentKey];
+		LLSD& newElement = mBuilder.add(map, mCurrentKey);
 		mStack.push_back(&newElement);		
 
 #if( LL_WINDOWS || __GNUC__ > 2)
@@ -694,8 +696,7 @@ void LLSDXMLParser::Impl::startElementHandler(const XML_Char* name, const XML_Ch
 	else if (mStack.back()->isArray())
 	{
 		LLSD& array = *mStack.back();
-		array.append(LLSD());
-		LLSD& newElement = array[array.size()-1];
+		LLSD& newElement = mBuilder.append(array);
 		mStack.push_back(&newElement);
 	}
 	else {
@@ -707,11 +708,11 @@ void LLSDXMLParser::Impl::startElementHandler(const XML_Char* name, const XML_Ch
 	switch (element)
 	{
 		case ELEMENT_MAP:
-			*mStack.back() = LLSD::emptyMap();
+			mBuilder.makeMap(*mStack.back());
 			break;
 		
 		case ELEMENT_ARRAY:
-			*mStack.back() = LLSD::emptyArray();
+			mBuilder.makeArray(*mStack.back());
 			break;
 			
 		default:
@@ -770,7 +771,7 @@ void LLSDXMLParser::Impl::endElementHandler(const XML_Char* name)
 			break;
 		
 		case ELEMENT_BOOL:
-			value = (mCurrentContent == "true" || mCurrentContent == "1");
+			mBuilder.assign(value, (LLSD::Boolean)(mCurrentContent == "true" || mCurrentContent == "1"));
 			break;
 		
 		case ELEMENT_INTEGER:
@@ -778,11 +779,11 @@ void LLSDXMLParser::Impl::endElementHandler(const XML_Char* name)
 				S32 i;
 				if ( sscanf(mCurrentContent.c_str(), "%d", &i ) == 1 )
 				{	// See if sscanf works - it's faster
-					value = i;
+					mBuilder.assign(value, (LLSD::Integer)i);
 				}
 				else
 				{
-					value = LLSD(mCurrentContent).asInteger();
+					mBuilder.assign(value, LLSD(mCurrentContent).asInteger());
 				}
 			}
 			break;
@@ -792,29 +793,29 @@ void LLSDXMLParser::Impl::endElementHandler(const XML_Char* name)
 				F64 r;
 				if ( sscanf(mCurrentContent.c_str(), "%lf", &r ) == 1 )
 				{	// See if sscanf works - it's faster
-					value = r;
+					mBuilder.assign(value, (LLSD::Real)r);
 				}
 				else
 				{
-					value = LLSD(mCurrentContent).asReal();
+					mBuilder.assign(value, LLSD(mCurrentContent).asReal());
 				}
 			}
 			break;
 		
 		case ELEMENT_STRING:
-			value = mCurrentContent;
+			mBuilder.assign(value, mCurrentContent);
 			break;
 		
 		case ELEMENT_UUID:
-			value = LLSD(mCurrentContent).asUUID();
+			mBuilder.assign(value, LLUUID(mCurrentContent));
 			break;
 		
 		case ELEMENT_DATE:
-			value = LLSD(mCurrentContent).asDate();
+			mBuilder.assign(value, LLDate(mCurrentContent));
 			break;
 		
 		case ELEMENT_URI:
-			value = LLSD(mCurrentContent).asURI();
+			mBuilder.assign(value, LLURI(mCurrentContent));
 			break;
 		
 		case ELEMENT_BINARY:
@@ -824,7 +825,7 @@ void LLSDXMLParser::Impl::endElementHandler(const XML_Char* name)
 			data.resize(len);
 			len = apr_base64_decode_binary(&data[0], mCurrentContent.c_str());
 			data.resize(len);
-			value = data;
+			mBuilder.assign(value, data);
 			break;
 		}
 		
@@ -304,3 +304,46 @@ BOOL compare_llsd_with_template(
 
 	return TRUE;
 }
+
+LLSD llsd_clone(const LLSD& sd)
+{
+	switch (sd.type())
+	{
+	case LLSD::TypeMap:
+	{
+		LLSD clone = LLSD::emptyMap();
+		for (LLSD::map_const_iterator iter = sd.beginMap(); iter != sd.endMap(); ++iter)
+		{
+			clone[iter->first] = llsd_clone(iter->second);
+		}
+		return clone;
+	}
+	case LLSD::TypeArray:
+	{
+		LLSD clone = LLSD::emptyArray();
+		for (LLSD::array_const_iterator iter = sd.beginArray(); iter != sd.endArray(); ++iter)
+		{
+			clone.append(llsd_clone(*iter));
+		}
+		return clone;
+	}
+	case LLSD::TypeBoolean:
+		return LLSD(sd.asBoolean());
+	case LLSD::TypeInteger:
+		return LLSD(sd.asInteger());
+	case LLSD::TypeReal:
+		return LLSD(sd.asReal());
+	case LLSD::TypeString:
+		return LLSD(sd.asString());
+	case LLSD::TypeUUID:
+		return LLSD(sd.asUUID());
+	case LLSD::TypeDate:
+		return LLSD(sd.asDate());
+	case LLSD::TypeURI:
+		return LLSD(sd.asURI());
+	case LLSD::TypeBinary:
+		return LLSD(sd.asBinary());
+	default:
+		return LLSD();
+	}
+}
@@ -103,6 +103,10 @@ LL_COMMON_API BOOL compare_llsd_with_template(
 	const LLSD& template_llsd,
 	LLSD& resultant_llsd);
 
+// Returns a copy of sd that shares no data with it.  LLSD reference counts
+// are not atomic, so a value handed to another thread must be cloned.
+LL_COMMON_API LLSD llsd_clone(const LLSD& sd);
+
 // Simple function to copy data out of input & output iterators if
 // there is no need for casting.
 template<typename Input> LLSD llsd_copy_array(Input iter, Input end)
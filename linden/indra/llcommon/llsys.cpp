@@ -629,6 +629,27 @@ std::string LLCPUInfo::getCPUString() const
 	return mCPUString;
 }
 
+//static
+U32 LLCPUInfo::getNumCores()
+{
+	S32 count = 1;
+#if LL_WINDOWS
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	count = (S32)info.dwNumberOfProcessors;
+#elif LL_DARWIN
+	int ncpu = 1;
+	size_t len = sizeof(ncpu);
+	if (sysctlbyname("hw.activecpu", &ncpu, &len, NULL, 0) == 0)
+	{
+		count = ncpu;
+	}
+#else
+	count = (S32)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+	return (U32)llmax(count, 1);
+}
+
 void LLCPUInfo::stream(std::ostream& s) const
 {
 #if LL_WINDOWS || LL_DARWIN || LL_SOLARIS
@@ -83,6 +83,9 @@ public:
 	bool hasSSE2() const;
 	F64 getMHz() const;
 
+	// Number of logical processors currently online (always >= 1).
+	static U32 getNumCores();
+
 	// Family is "AMD Duron" or "Intel Pentium Pro"
 	const std::string& getFamily() const { return mFamily; }
 
@@ -74,6 +74,7 @@ void *APR_THREAD_FUNC LLThread::staticRun(apr_thread_t *apr_threadp, void *datap
 
 	// Create a thread local data.
 	AIThreadLocalData::create(threadp);
+	LLFastTimer::setThreadName(threadp->mName);
 
 	// Run the user supplied function
 	threadp->run();
@@ -281,6 +282,15 @@ void AIThreadLocalData::init(void)
 #endif
 }
 
+AIThreadLocalData::AIThreadLocalData(void) : mFastTimerState(LLFastTimer::createThreadState())
+{
+}
+
+AIThreadLocalData::~AIThreadLocalData()
+{
+	LLFastTimer::releaseThreadState(mFastTimerState);
+}
+
 // This is called once for every thread when the thread is destructed.
 //static
 void AIThreadLocalData::destroy(void* thread_local_data)
@@ -309,6 +319,12 @@ AIThreadLocalData& AIThreadLocalData::tldata(void)
 	void* data;
 	apr_status_t status = apr_threadkey_private_get(&data, sThreadLocalDataKey);
 	llassert_always(status == APR_SUCCESS);
+	if (!data)
+	{
+		// A thread that was not started by LLThread.
+		AIThreadLocalData::create(NULL);
+		apr_threadkey_private_get(&data, sThreadLocalDataKey);
+	}
 	return *static_cast<AIThreadLocalData*>(data);
 }
 
@@ -39,6 +39,7 @@
 
 #include "apr_thread_cond.h"
 #include "aiaprpool.h"
+#include "llfasttimer.h"
 
 class LLThread;
 class LLMutex;
@@ -53,6 +54,11 @@ public:
 	// Thread-local memory pool.
 	AIAPRRootPool mRootPool;
 	AIVolatileAPRPool mVolatileAPRPool;
+	// This thread's LLFastTimer stack.
+	LLFastTimer::ThreadState* mFastTimerState;
+
+	AIThreadLocalData(void);
+	~AIThreadLocalData();
 
 	static void init(void);
 	static void destroy(void* thread_local_data);
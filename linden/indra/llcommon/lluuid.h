@@ -316,6 +316,23 @@ struct lluuid_less
 	}
 };
 
+// Hash function for hash maps keyed by LLUUID; it also has the ordering
+// and bucket constants MSVC's stdext::hash_map wants from its traits.
+// eg: __gnu_cxx::hash_map<LLUUID, LLWidget*, lluuid_hash> widget_map;
+struct lluuid_hash
+{
+	enum { bucket_size = 4, min_buckets = 8 };
+
+	size_t operator()(const LLUUID& id) const
+	{
+		return id.getCRC32();
+	}
+	bool operator()(const LLUUID& lhs, const LLUUID& rhs) const
+	{
+		return lhs < rhs;
+	}
+};
+
 typedef std::set<LLUUID, lluuid_less> uuid_list_t;
 
 /*
@@ -34,13 +34,79 @@
 
 #include "llimageworker.h"
 #include "llimagedxt.h"
+#include "lltimer.h"
+
+// Upper limit on the size of the decode pool
+static const U32 MAX_DECODE_WORKERS = 16;
 
 //----------------------------------------------------------------------------
 
 // MAIN THREAD
-LLImageDecodeThread::LLImageDecodeThread(bool threaded)
+LLImageDecodeThread::LLImageDecodeThread(bool threaded, U32 num_workers)
 	: LLQueuedThread("imagedecode", threaded)
 {
+	num_workers = threaded ? llclamp(num_workers, (U32)1, MAX_DECODE_WORKERS) : 1;
+	mThreadIDs.resize(num_workers, 0);
+	mWorkerStats.resize(num_workers);
+	for (U32 i = 1; i < num_workers; ++i)
+	{
+		DecodeWorker* worker = new DecodeWorker(this, i);
+		mWorkers.push_back(worker);
+		worker->start();
+	}
+	if (num_workers > 1)
+	{
+		llinfos << "Image decode pool started with " << num_workers << " workers" << llendl;
+	}
+}
+
+// MAIN THREAD
+LLImageDecodeThread::~LLImageDecodeThread()
+{
+	// ~LLQueuedThread() shuts down this thread and its queue
+	stopWorkers();
+}
+
+// MAIN THREAD
+//virtual
+void LLImageDecodeThread::shutdown()
+{
+	// Stop the extra workers first; they process requests owned by us.
+	stopWorkers();
+	LLQueuedThread::shutdown();
+}
+
+// MAIN THREAD
+void LLImageDecodeThread::stopWorkers()
+{
+	if (!mWorkers.empty())
+	{
+		setQuitting();
+		for (worker_list_t::iterator iter = mWorkers.begin(); iter != mWorkers.end(); ++iter)
+		{
+			(*iter)->wake();
+		}
+		for (worker_list_t::iterator iter = mWorkers.begin(); iter != mWorkers.end(); ++iter)
+		{
+			DecodeWorker* worker = *iter;
+			S32 timeout = 100;
+			while (!worker->isStopped() && timeout-- > 0)
+			{
+				ms_sleep(100);
+				LLThread::yield();
+			}
+			if (worker->isStopped())
+			{
+				delete worker;
+			}
+			else
+			{
+				// Leak it rather than destroy a running thread
+				llwarns << "Image decode worker " << worker->getIndex() << " timed out!" << llendl;
+			}
+		}
+		mWorkers.clear();
+	}
 }
 
 // MAIN THREAD
@@ -54,7 +120,7 @@ S32 LLImageDecodeThread::update(U32 max_time_ms)
 		creation_info& info = *iter;
 		ImageRequest* req = new ImageRequest(info.handle, info.image,
 						     info.priority, info.discard, info.needs_aux,
-						     info.responder);
+						     info.responder, this);
 
 		bool res = addRequest(req);
 		if (!res)
@@ -64,6 +130,11 @@ S32 LLImageDecodeThread::update(U32 max_time_ms)
 	}
 	mCreationList.clear();
 	S32 res = LLQueuedThread::update(max_time_ms);
+	// LLQueuedThread::update() only wakes this thread
+	for (worker_list_t::iterator iter = mWorkers.begin(); iter != mWorkers.end(); ++iter)
+	{
+		(*iter)->wake();
+	}
 	return res;
 }
 
@@ -85,6 +156,123 @@ S32 LLImageDecodeThread::tut_size()
 	return res;
 }
 
+// ANY THREAD
+S32 LLImageDecodeThread::getWorkerIndex()
+{
+	U32 id = LLThread::currentID();
+	LLMutexLock lock(&mStatsMutex);
+	for (U32 i = 1; i < mThreadIDs.size(); ++i)
+	{
+		if (mThreadIDs[i] == id)
+		{
+			return i;
+		}
+	}
+	// Either our own thread or, when not threaded, the main thread
+	return 0;
+}
+
+// ANY THREAD
+void LLImageDecodeThread::setWorkerBusy(S32 index, BOOL busy)
+{
+	LLMutexLock lock(&mStatsMutex);
+	mWorkerStats[index].mBusy = busy;
+}
+
+// ANY THREAD
+void LLImageDecodeThread::recordSlice(S32 index, F64 elapsed, bool done)
+{
+	LLMutexLock lock(&mStatsMutex);
+	WorkerStats& stats = mWorkerStats[index];
+	stats.mBusy = FALSE;
+	stats.mSlices++;
+	stats.mDecodeTime += elapsed;
+	stats.mMaxDecodeTime = llmax(stats.mMaxDecodeTime, elapsed);
+	if (done)
+	{
+		stats.mDecodes++;
+	}
+}
+
+void LLImageDecodeThread::getWorkerStats(worker_stats_list_t& stats)
+{
+	LLMutexLock lock(&mStatsMutex);
+	stats = mWorkerStats;
+}
+
+S32 LLImageDecodeThread::getNumBusyWorkers()
+{
+	LLMutexLock lock(&mStatsMutex);
+	S32 res = 0;
+	for (worker_stats_list_t::iterator iter = mWorkerStats.begin(); iter != mWorkerStats.end(); ++iter)
+	{
+		if (iter->mBusy)
+		{
+			++res;
+		}
+	}
+	return res;
+}
+
+// MAIN THREAD
+void LLImageDecodeThread::printWorkerStats()
+{
+	worker_stats_list_t stats;
+	getWorkerStats(stats);
+	llinfos << "Image decode pool: " << stats.size() << " workers, " << getPending() << " queued" << llendl;
+	for (U32 i = 0; i < stats.size(); ++i)
+	{
+		const WorkerStats& ws = stats[i];
+		F64 avg = ws.mDecodes ? ws.mDecodeTime / ws.mDecodes : 0.0;
+		llinfos << llformat("  worker %d: %s decodes: %d slices: %d time: %.3fs avg: %.1fms max slice: %.1fms",
+							i, ws.mBusy ? "busy" : "idle", ws.mDecodes, ws.mSlices,
+							ws.mDecodeTime, avg * 1000.0, ws.mMaxDecodeTime * 1000.0) << llendl;
+	}
+}
+
+//----------------------------------------------------------------------------
+
+LLImageDecodeThread::DecodeWorker::DecodeWorker(LLImageDecodeThread* pool, U32 index)
+	: LLThread(llformat("imagedecode%d", index)),
+	  mPool(pool),
+	  mIndex(index)
+{
+}
+
+//virtual
+bool LLImageDecodeThread::DecodeWorker::runCondition()
+{
+	// mRunCondition must be locked here
+	return mPool->isQuitting() || (!mPool->isPaused() && mPool->getPending() > 0);
+}
+
+//virtual
+void LLImageDecodeThread::DecodeWorker::run()
+{
+	{
+		LLMutexLock lock(&mPool->mStatsMutex);
+		mPool->mThreadIDs[mIndex] = LLThread::currentID();
+	}
+	while (1)
+	{
+		// Sleeps until the pool is unpaused and has queued requests
+		checkPause();
+
+		if (isQuitting() || mPool->isQuitting())
+		{
+			break;
+		}
+
+		if (mPool->processNextRequest() == 0)
+		{
+			ms_sleep(1);
+		}
+	}
+	llinfos << "LLImageDecodeThread::DecodeWorker " << mName << " EXITING." << llendl;
+}
+
+//----------------------------------------------------------------------------
+
 LLImageDecodeThread::Responder::~Responder()
 {
 }
@@ -93,8 +281,10 @@ LLImageDecodeThread::Responder::~Responder()
 
 LLImageDecodeThread::ImageRequest::ImageRequest(handle_t handle, LLImageFormatted* image, 
 												U32 priority, S32 discard, BOOL needs_aux,
-												LLImageDecodeThread::Responder* responder)
+												LLImageDecodeThread::Responder* responder,
+												LLImageDecodeThread* pool)
 	: LLQueuedThread::QueuedRequest(handle, priority, FLAG_AUTO_COMPLETE),
+	  mPool(pool),
 	  mFormattedImage(image),
 	  mDiscardLevel(discard),
 	  mNeedsAux(needs_aux),
@@ -116,6 +306,20 @@ LLImageDecodeThread::ImageRequest::~ImageRequest()
 
 // Returns true when done, whether or not decode was successful.
 bool LLImageDecodeThread::ImageRequest::processRequest()
+{
+	if (!mPool)
+	{
+		return decodeSlice();
+	}
+	S32 index = mPool->getWorkerIndex();
+	mPool->setWorkerBusy(index, TRUE);
+	LLTimer timer;
+	bool done = decodeSlice();
+	mPool->recordSlice(index, timer.getElapsedTimeF64(), done);
+	return done;
+}
+
+bool LLImageDecodeThread::ImageRequest::decodeSlice()
 {
 	const F32 decode_time_slice = .1f;
 	bool done = true;
@@ -36,6 +36,10 @@
 #include "llimage.h"
 #include "llworkerthread.h"
 
+// LLImageDecodeThread owns the (priority ordered) request queue.  When
+// created with more than one worker, additional DecodeWorker threads pull
+// requests from that same queue, so priorities are honored across the
+// whole pool and callers still see a single handle space.
 class LLImageDecodeThread : public LLQueuedThread
 {
 public:
@@ -55,15 +59,19 @@ public:
 	public:
 		ImageRequest(handle_t handle, LLImageFormatted* image,
 					 U32 priority, S32 discard, BOOL needs_aux,
-					 LLImageDecodeThread::Responder* responder);
+					 LLImageDecodeThread::Responder* responder,
+					 LLImageDecodeThread* pool = NULL);
 
 		/*virtual*/ bool processRequest();
 		/*virtual*/ void finishRequest(bool completed);
+		bool decodeSlice();
 
 		// Used by unit tests to check the consitency of the request instance
 		bool tut_isOK();
 		
 	private:
+		LLImageDecodeThread* mPool;
+
 		// input
 		LLPointer<LLImageFormatted> mFormattedImage;
 		S32 mDiscardLevel;
@@ -76,17 +84,74 @@ public:
 		LLPointer<LLImageDecodeThread::Responder> mResponder;
 	};
 	
+	// Per worker statistics, used to size the pool.
+	struct WorkerStats
+	{
+		U32 mDecodes;			// completed decodes
+		U32 mSlices;			// calls to processRequest()
+		F64 mDecodeTime;		// seconds spent decoding
+		F64 mMaxDecodeTime;		// longest single slice, in seconds
+		BOOL mBusy;				// currently processing a request
+		WorkerStats() : mDecodes(0), mSlices(0), mDecodeTime(0.0), mMaxDecodeTime(0.0), mBusy(FALSE) {}
+	};
+	typedef std::vector<WorkerStats> worker_stats_list_t;
+
 public:
-	LLImageDecodeThread(bool threaded = true);
+	// num_workers is the total number of decoding threads (including this one).
+	// It is ignored when threaded is false.
+	LLImageDecodeThread(bool threaded = true, U32 num_workers = 1);
+	virtual ~LLImageDecodeThread();
+	/*virtual*/ void shutdown();
+
 	handle_t decodeImage(LLImageFormatted* image,
 						 U32 priority, S32 discard, BOOL needs_aux,
 						 Responder* responder);
 	S32 update(U32 max_time_ms);
 
+	U32 getNumWorkers() const { return mWorkers.size() + 1; }
+	// Copies the current per worker statistics into stats; index 0 is this thread.
+	void getWorkerStats(worker_stats_list_t& stats);
+	// Number of workers that are currently decoding
+	S32 getNumBusyWorkers();
+	void printWorkerStats();
+
 	// Used by unit tests to check the consistency of the thread instance
 	S32 tut_size();
 	
 private:
+	// Additional worker that decodes from the queue owned by mPool
+	class DecodeWorker : public LLThread
+	{
+	public:
+		DecodeWorker(LLImageDecodeThread* pool, U32 index);
+		U32 getIndex() const { return mIndex; }
+
+	private:
+		/*virtual*/ bool runCondition(void);
+		/*virtual*/ void run(void);
+
+		LLImageDecodeThread* mPool;
+		U32 mIndex;
+	};
+	friend class DecodeWorker;
+
+	// Stops and deletes the extra workers; does nothing once they are gone.
+	void stopWorkers();
+
+	// Maps the calling thread to its slot in mWorkerStats.  This thread,
+	// or the main thread when not threaded, is slot 0.
+	S32 getWorkerIndex();
+	void recordSlice(S32 index, F64 elapsed, bool done);
+	void setWorkerBusy(S32 index, BOOL busy);
+
+	typedef std::vector<DecodeWorker*> worker_list_t;
+	worker_list_t mWorkers;
+
+	// mThreadIDs[i] is the id of the thread that owns mWorkerStats[i]
+	std::vector<U32> mThreadIDs;
+	worker_stats_list_t mWorkerStats;
+	LLMutex mStatsMutex;
+
 	struct creation_info
 	{
 		handle_t handle;
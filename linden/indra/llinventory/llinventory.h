@@ -117,6 +117,8 @@ public:
 	virtual void removeFromServer();
 	virtual void updateParentOnServer(BOOL) const;
 	virtual void updateServer(BOOL) const;
+	// sets names as stored, without rename()'s clean up
+	friend class LLInventoryCacheReader;
 };
 
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
@@ -290,6 +292,8 @@ public:
 private:
   void recalcNInventoryType();
 
+	friend class LLInventoryCacheReader;
+
 };
 
 BOOL item_dictionary_sort(LLInventoryItem* a,LLInventoryItem* b);
@@ -0,0 +1,219 @@
+/**
+ * @file llinventorycache_bench.cpp
+ * @brief Measures saving and loading an inventory through the gzipped text cache and the binary cache.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#include "linden_common.h"
+
+#include "llfile.h"
+#include "llinventorycache.h"
+#include "llsys.h"
+#include "lltimer.h"
+
+// Builds an inventory, saves and loads it through the gzipped text cache
+// the way LLInventoryModel::saveToFile()/loadFromFile() used to, then
+// through the binary cache, and reports the seconds each took.  Exits
+// with 1 if either load does not return every item.
+//
+// usage: llinventorycache_bench [-i items] [-c categories]
+
+namespace
+{
+	std::string temp_filename(const std::string& name)
+	{
+		LLUUID random;
+		random.generate();
+#if LL_WINDOWS
+		return "C:\\" + name + "-" + random.asString();
+#else
+		return "/tmp/" + name + "-" + random.asString();
+#endif
+	}
+
+	LLPointer<LLInventoryCategory> make_category(const LLUUID& parent, S32 index)
+	{
+		LLUUID id;
+		id.generate();
+		return new LLInventoryCategory(id, parent, LLAssetType::AT_NONE, llformat("Folder %d", index));
+	}
+
+	// Names repeat the way real inventories do; some are not ASCII.
+	LLPointer<LLInventoryItem> make_item(const LLUUID& parent, S32 index)
+	{
+		LLUUID id, asset_id, creator_id, owner_id, group_id;
+		id.generate();
+		asset_id.generate();
+		creator_id.generate();
+		owner_id.generate();
+		if (index % 7 == 0)
+		{
+			group_id.generate();
+		}
+
+		LLPermissions perm;
+		perm.init(creator_id, owner_id, creator_id, group_id);
+		perm.initMasks(PERM_ALL, PERM_ALL, index % 3 ? PERM_NONE : PERM_COPY,
+					   PERM_NONE, PERM_MOVE | PERM_TRANSFER | (index % 2 ? PERM_COPY : PERM_MODIFY));
+
+		static const LLAssetType::EType types[] = {
+			LLAssetType::AT_OBJECT, LLAssetType::AT_TEXTURE, LLAssetType::AT_NOTECARD,
+			LLAssetType::AT_LSL_TEXT, LLAssetType::AT_CLOTHING, LLAssetType::AT_LANDMARK };
+		LLAssetType::EType type = types[index % LL_ARRAY_SIZE(types)];
+
+		std::string name = index % 5 ? llformat("Object %d", index % 1000) : std::string("Caf\xc3\xa9 chair");
+		std::string desc = index % 4 ? std::string() : llformat("Description %d", index % 100);
+		LLSaleInfo sale(index % 11 ? LLSaleInfo::FS_NOT : LLSaleInfo::FS_COPY, index % 11 ? 0 : index % 500);
+
+		return new LLInventoryItem(id, parent, perm, asset_id, type,
+								   LLInventoryType::defaultForAssetType(type), name, desc,
+								   sale, index % 13 ? 0 : 0x100, 1200000000 + index);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	S32 num_items = 200000;
+	S32 num_categories = 2000;
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		S32 value = llmax(1, atoi(argv[i + 1]));
+		if (!strcmp(argv[i], "-i"))
+		{
+			num_items = value;
+		}
+		else if (!strcmp(argv[i], "-c"))
+		{
+			num_categories = value;
+		}
+	}
+
+	LLUUID owner;
+	owner.generate();
+	std::vector<LLPointer<LLInventoryCategory> > categories;
+	std::vector<LLPointer<LLInventoryItem> > items;
+	for (S32 i = 0; i < num_categories; ++i)
+	{
+		categories.push_back(make_category(i ? categories[0]->getUUID() : LLUUID::null, i));
+	}
+	for (S32 i = 0; i < num_items; ++i)
+	{
+		// spread items over the folders, out of order
+		items.push_back(make_item(categories[(i * 7) % num_categories]->getUUID(), i));
+	}
+
+	std::string text_filename = temp_filename("invcache-text");
+	std::string gz_filename = temp_filename("invcache-text-gz");
+	std::string binary_filename = temp_filename("invcache-binary");
+	bool ok = true;
+
+	LLTimer timer;
+	{
+		LLFILE* fp = LLFile::fopen(text_filename, "wb");
+		for (size_t i = 0; i < categories.size(); ++i)
+		{
+			categories[i]->exportFile(fp);
+		}
+		for (size_t i = 0; i < items.size(); ++i)
+		{
+			items[i]->exportFile(fp);
+		}
+		fclose(fp);
+		ok = gzip_file(text_filename, gz_filename) && ok;
+		LLFile::remove(text_filename);
+	}
+	F64 text_save = timer.getElapsedTimeAndResetF64();
+
+	S32 text_items = 0;
+	if (gunzip_file(gz_filename, text_filename))
+	{
+		LLFILE* fp = LLFile::fopen(text_filename, "rb");
+		char buffer[MAX_STRING];		/* Flawfinder: ignore */
+		char keyword[MAX_STRING];		/* Flawfinder: ignore */
+		while (!feof(fp) && fgets(buffer, MAX_STRING, fp))
+		{
+			sscanf(buffer, " %254s", keyword);	/* Flawfinder: ignore */
+			if (0 == strcmp("inv_category", keyword))
+			{
+				LLPointer<LLInventoryCategory> cat = new LLInventoryCategory;
+				cat->importFile(fp);
+			}
+			else if (0 == strcmp("inv_item", keyword))
+			{
+				LLPointer<LLInventoryItem> item = new LLInventoryItem;
+				if (item->importFile(fp))
+				{
+					text_items++;
+				}
+			}
+		}
+		fclose(fp);
+		LLFile::remove(text_filename);
+	}
+	F64 text_load = timer.getElapsedTimeAndResetF64();
+
+	{
+		LLInventoryCacheWriter writer;
+		for (size_t i = 0; i < categories.size(); ++i)
+		{
+			writer.addCategory(*categories[i], owner, (S32)i + 1);
+		}
+		for (size_t i = 0; i < items.size(); ++i)
+		{
+			writer.addItem(*items[i]);
+		}
+		ok = writer.save(binary_filename, false) && ok;
+	}
+	F64 binary_save = timer.getElapsedTimeAndResetF64();
+
+	S32 binary_items = 0;
+	{
+		LLInventoryCacheReader reader;
+		if (reader.open(binary_filename))
+		{
+			for (S32 i = 0; i < reader.getNumItems(); ++i)
+			{
+				LLPointer<LLInventoryItem> item = new LLInventoryItem;
+				reader.getItem(i, *item);
+				binary_items++;
+			}
+		}
+	}
+	F64 binary_load = timer.getElapsedTimeAndResetF64();
+
+	LLFile::remove(gz_filename);
+	LLFile::remove(binary_filename);
+
+	ok = ok && text_items == num_items && binary_items == num_items;
+	printf("%d items in %d folders: gzipped text save %.3f s, load %.3f s; binary save %.3f s, load %.3f s  %s\n",
+		   num_items, num_categories, text_save, text_load, binary_save, binary_load,
+		   ok ? "all items loaded" : "ITEMS MISSING");
+	return ok ? 0 : 1;
+}
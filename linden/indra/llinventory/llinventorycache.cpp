@@ -0,0 +1,506 @@
+/**
+ * @file llinventorycache.cpp
+ * @brief Binary inventory cache file.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#include "linden_common.h"
+
+#include "llinventorycache.h"
+
+#if !LL_WINDOWS
+#include <sys/mman.h>
+#endif
+#ifdef LL_STANDALONE
+# include <zlib.h>
+#else
+# include "zlib/zlib.h"
+#endif
+
+#include "llfile.h"
+
+static const char MAGIC[8] = { 'L', 'L', 'I', 'N', 'V', 'B', 'I', 'N' };
+static const U32 BYTE_ORDER_MARK = 0x01020304;
+static const S32 GZ_CHUNK_SIZE = 65536;
+
+static void set_id(U8* dest, const LLUUID& id)
+{
+	memcpy(dest, id.mData, UUID_BYTES);		/* Flawfinder: ignore */
+}
+
+static LLUUID get_id(const U8* src)
+{
+	LLUUID id;
+	memcpy(id.mData, src, UUID_BYTES);		/* Flawfinder: ignore */
+	return id;
+}
+
+///----------------------------------------------------------------------------
+/// Class LLInventoryCacheWriter
+///----------------------------------------------------------------------------
+
+LLInventoryCacheWriter::LLInventoryCacheWriter()
+{
+	mStrings.push_back('\0');
+}
+
+U32 LLInventoryCacheWriter::addString(const std::string& str)
+{
+	if (str.empty())
+	{
+		return 0;
+	}
+	std::map<std::string, U32>::iterator iter = mStringOffsets.find(str);
+	if (iter != mStringOffsets.end())
+	{
+		return iter->second;
+	}
+	U32 offset = (U32)mStrings.size();
+	mStrings.append(str.c_str());
+	mStrings.push_back('\0');
+	mStringOffsets[str] = offset;
+	return offset;
+}
+
+void LLInventoryCacheWriter::addCategory(const LLInventoryCategory& cat, const LLUUID& owner_id, S32 version)
+{
+	LLInventoryCache::CategoryRecord record;
+	memset(&record, 0, sizeof(record));
+	set_id(record.mID, cat.getUUID());
+	set_id(record.mParentID, cat.getParentUUID());
+	set_id(record.mOwnerID, owner_id);
+	record.mName = addString(cat.getName());
+	record.mVersion = version;
+	record.mType = (S8)cat.getType();
+	record.mPreferredType = (S8)cat.getPreferredType();
+	mCategories.push_back(record);
+}
+
+void LLInventoryCacheWriter::addItem(const LLInventoryItem& item)
+{
+	const LLPermissions& perm = item.getPermissions();
+	LLInventoryCache::ItemRecord record;
+	memset(&record, 0, sizeof(record));
+	set_id(record.mID, item.getUUID());
+	set_id(record.mParentID, item.getParentUUID());
+	set_id(record.mAssetID, item.getAssetUUID());
+	set_id(record.mCreatorID, perm.getCreator());
+	set_id(record.mOwnerID, perm.getOwner());
+	set_id(record.mLastOwnerID, perm.getLastOwner());
+	set_id(record.mGroupID, perm.getGroup());
+	record.mMaskBase = perm.getMaskBase();
+	record.mMaskOwner = perm.getMaskOwner();
+	record.mMaskGroup = perm.getMaskGroup();
+	record.mMaskEveryone = perm.getMaskEveryone();
+	record.mMaskNextOwner = perm.getMaskNextOwner();
+	record.mFlags = item.getFlags();
+	record.mCreationDate = (S32)item.getCreationDate();
+	record.mSalePrice = item.getSaleInfo().getSalePrice();
+	record.mName = addString(item.getName());
+	record.mDesc = addString(item.getDescription());
+	record.mType = (S8)item.getType();
+	record.mInventoryType = (S8)item.getInventoryType();
+	record.mSaleType = (U8)item.getSaleInfo().getSaleType();
+	mItems.push_back(record);
+}
+
+bool LLInventoryCacheWriter::save(const std::string& filename, bool compress)
+{
+	// Group the items by category, in category order, keeping the order
+	// they were added in within each category.  Items whose category was
+	// not added go last.
+	const S32 num_categories = (S32)mCategories.size();
+	std::map<LLUUID, S32> category_index;
+	for (S32 i = 0; i < num_categories; ++i)
+	{
+		category_index[get_id(mCategories[i].mID)] = i;
+	}
+	std::vector<S32> item_category(mItems.size());
+	std::vector<U32> next(num_categories + 1, 0);
+	for (size_t i = 0; i < mItems.size(); ++i)
+	{
+		std::map<LLUUID, S32>::iterator iter = category_index.find(get_id(mItems[i].mParentID));
+		item_category[i] = iter != category_index.end() ? iter->second : num_categories;
+		next[item_category[i]]++;
+	}
+	U32 first = 0;
+	for (S32 i = 0; i <= num_categories; ++i)
+	{
+		U32 count = next[i];
+		if (i < num_categories)
+		{
+			mCategories[i].mFirstItem = first;
+			mCategories[i].mNumItems = count;
+		}
+		next[i] = first;
+		first += count;
+	}
+	std::vector<LLInventoryCache::ItemRecord> items(mItems.size());
+	for (size_t i = 0; i < mItems.size(); ++i)
+	{
+		items[next[item_category[i]]++] = mItems[i];
+	}
+
+	LLInventoryCache::Header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.mMagic, MAGIC, sizeof(MAGIC));		/* Flawfinder: ignore */
+	header.mByteOrder = BYTE_ORDER_MARK;
+	header.mVersion = LLInventoryCache::VERSION;
+	header.mHeaderSize = sizeof(LLInventoryCache::Header);
+	header.mCategorySize = sizeof(LLInventoryCache::CategoryRecord);
+	header.mItemSize = sizeof(LLInventoryCache::ItemRecord);
+	header.mNumCategories = (U32)mCategories.size();
+	header.mNumItems = (U32)items.size();
+	header.mStringsSize = (U32)mStrings.size();
+
+	std::vector<std::pair<const void*, size_t> > blocks;
+	blocks.push_back(std::make_pair((const void*)&header, sizeof(header)));
+	if (!mCategories.empty())
+	{
+		blocks.push_back(std::make_pair((const void*)&mCategories[0], mCategories.size() * sizeof(LLInventoryCache::CategoryRecord)));
+	}
+	if (!items.empty())
+	{
+		blocks.push_back(std::make_pair((const void*)&items[0], items.size() * sizeof(LLInventoryCache::ItemRecord)));
+	}
+	blocks.push_back(std::make_pair((const void*)mStrings.data(), mStrings.size()));
+
+	std::string tmp_filename = filename + ".tmp";
+	bool success = true;
+	if (compress)
+	{
+		gzFile dst = gzopen(tmp_filename.c_str(), "wb");
+		if (!dst)
+		{
+			llwarns << "Unable to open " << tmp_filename << " for writing" << llendl;
+			return false;
+		}
+		for (size_t i = 0; i < blocks.size() && success; ++i)
+		{
+			success = gzwrite(dst, (voidpc)blocks[i].first, (unsigned)blocks[i].second) == (int)blocks[i].second;
+		}
+		success = (gzclose(dst) == Z_OK) && success;
+	}
+	else
+	{
+		LLFILE* dst = LLFile::fopen(tmp_filename, "wb");		/* Flawfinder: ignore */
+		if (!dst)
+		{
+			llwarns << "Unable to open " << tmp_filename << " for writing" << llendl;
+			return false;
+		}
+		for (size_t i = 0; i < blocks.size() && success; ++i)
+		{
+			success = fwrite(blocks[i].first, 1, blocks[i].second, dst) == blocks[i].second;
+		}
+		success = (fclose(dst) == 0) && success;
+	}
+
+	if (success)
+	{
+		LLFile::remove(filename);
+		success = LLFile::rename(tmp_filename, filename) == 0;
+	}
+	if (!success)
+	{
+		llwarns << "Unable to write inventory cache " << filename << llendl;
+		LLFile::remove(tmp_filename);
+	}
+	return success;
+}
+
+///----------------------------------------------------------------------------
+/// Class LLInventoryCacheReader
+///----------------------------------------------------------------------------
+
+LLInventoryCacheReader::LLInventoryCacheReader()
+	: mHeader(NULL),
+	  mCategories(NULL),
+	  mItems(NULL),
+	  mStrings(NULL),
+	  mMappedData(NULL),
+	  mMappedSize(0),
+	  mMappingHandle(NULL)
+{
+}
+
+LLInventoryCacheReader::~LLInventoryCacheReader()
+{
+	close();
+}
+
+bool LLInventoryCacheReader::open(const std::string& filename)
+{
+	close();
+
+	LLFILE* fp = LLFile::fopen(filename, "rb");		/* Flawfinder: ignore */
+	if (!fp)
+	{
+		return false;
+	}
+	U8 magic[2] = { 0, 0 };
+	bool gzipped = fread(magic, 1, 2, fp) == 2 && magic[0] == 0x1f && magic[1] == 0x8b;
+	fclose(fp);
+
+	const U8* data = NULL;
+	size_t size = 0;
+	if (gzipped)
+	{
+		// One pass straight into memory
+		gzFile src = gzopen(filename.c_str(), "rb");
+		if (!src)
+		{
+			return false;
+		}
+		S32 bytes = 0;
+		do
+		{
+			size = mBuffer.size();
+			mBuffer.resize(size + GZ_CHUNK_SIZE);
+			bytes = gzread(src, &mBuffer[size], GZ_CHUNK_SIZE);
+			mBuffer.resize(size + llmax(bytes, 0));
+		}
+		while (bytes == GZ_CHUNK_SIZE);
+		gzclose(src);
+		if (bytes < 0)
+		{
+			llwarns << "Unable to decompress " << filename << llendl;
+			close();
+			return false;
+		}
+		size = mBuffer.size();
+		data = size ? &mBuffer[0] : NULL;
+	}
+	else if (mapFile(filename))
+	{
+		data = mMappedData ? mMappedData : &mBuffer[0];
+		size = mMappedData ? mMappedSize : mBuffer.size();
+	}
+
+	if (!data || !validate(data, size))
+	{
+		llwarns << "Ignoring unreadable inventory cache " << filename << llendl;
+		close();
+		return false;
+	}
+	return true;
+}
+
+void LLInventoryCacheReader::close()
+{
+	unmapFile();
+	mBuffer.clear();
+	mHeader = NULL;
+	mCategories = NULL;
+	mItems = NULL;
+	mStrings = NULL;
+}
+
+bool LLInventoryCacheReader::validate(const U8* data, size_t size)
+{
+	if (size < sizeof(LLInventoryCache::Header))
+	{
+		return false;
+	}
+	const LLInventoryCache::Header* header = (const LLInventoryCache::Header*)data;
+	if (memcmp(header->mMagic, MAGIC, sizeof(MAGIC))
+		|| header->mByteOrder != BYTE_ORDER_MARK
+		|| header->mVersion != LLInventoryCache::VERSION
+		|| header->mHeaderSize != sizeof(LLInventoryCache::Header)
+		|| header->mCategorySize != sizeof(LLInventoryCache::CategoryRecord)
+		|| header->mItemSize != sizeof(LLInventoryCache::ItemRecord))
+	{
+		return false;
+	}
+
+	const U64 expected = (U64)sizeof(LLInventoryCache::Header)
+		+ (U64)header->mNumCategories * sizeof(LLInventoryCache::CategoryRecord)
+		+ (U64)header->mNumItems * sizeof(LLInventoryCache::ItemRecord)
+		+ (U64)header->mStringsSize;
+	if (expected != (U64)size || header->mStringsSize == 0)
+	{
+		return false;
+	}
+
+	const LLInventoryCache::CategoryRecord* categories =
+		(const LLInventoryCache::CategoryRecord*)(data + sizeof(LLInventoryCache::Header));
+	const LLInventoryCache::ItemRecord* items =
+		(const LLInventoryCache::ItemRecord*)(categories + header->mNumCategories);
+	const char* strings = (const char*)(items + header->mNumItems);
+
+	// Every string offset must land inside a table that ends with a
+	// terminator, and the category ranges must tile the items.
+	if (strings[header->mStringsSize - 1] != '\0')
+	{
+		return false;
+	}
+	U32 next_item = 0;
+	for (U32 i = 0; i < header->mNumCategories; ++i)
+	{
+		const LLInventoryCache::CategoryRecord& cat = categories[i];
+		if (cat.mName >= header->mStringsSize
+			|| cat.mFirstItem != next_item
+			|| cat.mNumItems > header->mNumItems - next_item)
+		{
+			return false;
+		}
+		next_item += cat.mNumItems;
+	}
+	for (U32 i = 0; i < header->mNumItems; ++i)
+	{
+		if (items[i].mName >= header->mStringsSize || items[i].mDesc >= header->mStringsSize)
+		{
+			return false;
+		}
+	}
+
+	mHeader = header;
+	mCategories = categories;
+	mItems = items;
+	mStrings = strings;
+	return true;
+}
+
+bool LLInventoryCacheReader::mapFile(const std::string& filename)
+{
+	LLFILE* fp = LLFile::fopen(filename, "rb");		/* Flawfinder: ignore */
+	if (!fp)
+	{
+		return false;
+	}
+	fseek(fp, 0, SEEK_END);
+	long size = ftell(fp);
+	if (size <= 0)
+	{
+		fclose(fp);
+		return false;
+	}
+#if LL_WINDOWS
+	HANDLE file = (HANDLE)_get_osfhandle(_fileno(fp));
+	HANDLE mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping)
+	{
+		void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, (SIZE_T)size);
+		if (view)
+		{
+			mMappingHandle = mapping;
+			mMappedData = (U8*)view;
+		}
+		else
+		{
+			CloseHandle(mapping);
+		}
+	}
+#else
+	void* view = mmap(NULL, (size_t)size, PROT_READ, MAP_SHARED, fileno(fp), 0);
+	if (view != MAP_FAILED)
+	{
+		mMappedData = (U8*)view;
+	}
+#endif
+	if (mMappedData)
+	{
+		mMappedSize = (size_t)size;
+	}
+	else
+	{
+		// Read it instead
+		mBuffer.resize((size_t)size);
+		fseek(fp, 0, SEEK_SET);
+		if (fread(&mBuffer[0], 1, (size_t)size, fp) != (size_t)size)
+		{
+			mBuffer.clear();
+		}
+	}
+	fclose(fp);
+	return mMappedData || !mBuffer.empty();
+}
+
+void LLInventoryCacheReader::unmapFile()
+{
+	if (!mMappedData)
+	{
+		return;
+	}
+#if LL_WINDOWS
+	UnmapViewOfFile(mMappedData);
+	CloseHandle((HANDLE)mMappingHandle);
+	mMappingHandle = NULL;
+#else
+	munmap(mMappedData, mMappedSize);
+#endif
+	mMappedData = NULL;
+	mMappedSize = 0;
+}
+
+LLUUID LLInventoryCacheReader::getCategoryID(S32 index) const
+{
+	return get_id(mCategories[index].mID);
+}
+
+void LLInventoryCacheReader::getCategory(S32 index, LLInventoryCategory& cat, LLUUID& owner_id) const
+{
+	const LLInventoryCache::CategoryRecord& record = mCategories[index];
+	cat.setUUID(get_id(record.mID));
+	cat.setParent(get_id(record.mParentID));
+	cat.setType((LLAssetType::EType)record.mType);
+	cat.setPreferredType((LLAssetType::EType)record.mPreferredType);
+	static_cast<LLInventoryObject&>(cat).mName = getString(record.mName);
+	owner_id = get_id(record.mOwnerID);
+}
+
+S32 LLInventoryCacheReader::getNumIndexedItems() const
+{
+	S32 count = getNumCategories();
+	return count ? getFirstItem(count - 1) + getCategoryItemCount(count - 1) : 0;
+}
+
+void LLInventoryCacheReader::getItem(S32 index, LLInventoryItem& item) const
+{
+	const LLInventoryCache::ItemRecord& record = mItems[index];
+	LLPermissions perm;
+	perm.init(get_id(record.mCreatorID), get_id(record.mOwnerID),
+			  get_id(record.mLastOwnerID), get_id(record.mGroupID));
+	perm.initMasks(record.mMaskBase, record.mMaskOwner, record.mMaskEveryone,
+				   record.mMaskGroup, record.mMaskNextOwner);
+
+	item.setUUID(get_id(record.mID));
+	item.setParent(get_id(record.mParentID));
+	item.setPermissions(perm);
+	item.setAssetUUID(get_id(record.mAssetID));
+	item.setType((LLAssetType::EType)record.mType);
+	item.setInventoryType((LLInventoryType::EType)record.mInventoryType);
+	item.setFlags(record.mFlags);
+	item.setSaleInfo(LLSaleInfo((LLSaleInfo::EForSale)record.mSaleType, record.mSalePrice));
+	// Stored as they were, like the text cache does
+	static_cast<LLInventoryObject&>(item).mName = getString(record.mName);
+	item.mDescription = getString(record.mDesc);
+	item.setCreationDate(record.mCreationDate);
+}
@@ -0,0 +1,182 @@
+/**
+ * @file llinventorycache.h
+ * @brief Binary inventory cache file.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#ifndef LL_LLINVENTORYCACHE_H
+#define LL_LLINVENTORYCACHE_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "llinventory.h"
+
+// The viewer's inventory cache, as a binary file: a header, fixed size
+// category and item records, and a table of the names and descriptions.
+// The items are stored grouped by category, and each category record
+// holds the range of its items, so a loader can skip whole categories
+// without looking at their items.
+//
+// The file is written in the host's byte order and is only meant to be
+// read back on the machine that wrote it; a file with another byte order,
+// version or record size is rejected, and the caller falls back to
+// fetching or to the text cache.
+class LLInventoryCache
+{
+public:
+	enum
+	{
+		VERSION = 1
+	};
+
+	struct Header
+	{
+		char mMagic[8];
+		U32 mByteOrder;
+		U32 mVersion;
+		U32 mHeaderSize;
+		U32 mCategorySize;
+		U32 mItemSize;
+		U32 mNumCategories;
+		U32 mNumItems;
+		U32 mStringsSize;
+	};
+
+	// Strings are offsets into the string table; offset 0 is "".
+	struct CategoryRecord
+	{
+		U8 mID[UUID_BYTES];
+		U8 mParentID[UUID_BYTES];
+		U8 mOwnerID[UUID_BYTES];
+		U32 mName;
+		S32 mVersion;
+		U32 mFirstItem;
+		U32 mNumItems;
+		S8 mType;
+		S8 mPreferredType;
+		U8 mPad[2];
+	};
+
+	struct ItemRecord
+	{
+		U8 mID[UUID_BYTES];
+		U8 mParentID[UUID_BYTES];
+		U8 mAssetID[UUID_BYTES];
+		U8 mCreatorID[UUID_BYTES];
+		U8 mOwnerID[UUID_BYTES];
+		U8 mLastOwnerID[UUID_BYTES];
+		U8 mGroupID[UUID_BYTES];
+		U32 mMaskBase;
+		U32 mMaskOwner;
+		U32 mMaskGroup;
+		U32 mMaskEveryone;
+		U32 mMaskNextOwner;
+		U32 mFlags;
+		S32 mCreationDate;
+		S32 mSalePrice;
+		U32 mName;
+		U32 mDesc;
+		S8 mType;
+		S8 mInventoryType;
+		U8 mSaleType;
+		U8 mPad;
+	};
+};
+
+class LLInventoryCacheWriter
+{
+public:
+	LLInventoryCacheWriter();
+
+	void addCategory(const LLInventoryCategory& cat, const LLUUID& owner_id, S32 version);
+	void addItem(const LLInventoryItem& item);
+
+	// Writes everything added so far, gzipped if compress is true.  The
+	// file is written under a temporary name and renamed into place.
+	bool save(const std::string& filename, bool compress);
+
+private:
+	U32 addString(const std::string& str);
+
+	std::vector<LLInventoryCache::CategoryRecord> mCategories;
+	std::vector<LLInventoryCache::ItemRecord> mItems;
+	std::string mStrings;
+	std::map<std::string, U32> mStringOffsets;
+};
+
+class LLInventoryCacheReader
+{
+public:
+	LLInventoryCacheReader();
+	~LLInventoryCacheReader();
+
+	// Maps the file, or reads it in one pass if it is gzipped.  Returns
+	// false if the file is missing or is not a cache this build can read.
+	bool open(const std::string& filename);
+	void close();
+	bool isOpen() const { return mHeader != NULL; }
+	bool isMapped() const { return mMappedData != NULL; }
+
+	S32 getNumCategories() const { return (S32)mHeader->mNumCategories; }
+	S32 getNumItems() const { return (S32)mHeader->mNumItems; }
+
+	LLUUID getCategoryID(S32 index) const;
+	S32 getCategoryVersion(S32 index) const { return mCategories[index].mVersion; }
+	void getCategory(S32 index, LLInventoryCategory& cat, LLUUID& owner_id) const;
+
+	// The items of category index are [getFirstItem(index),
+	// getFirstItem(index) + getCategoryItemCount(index)).  The items after
+	// the last category's are those whose parent was not written.
+	S32 getFirstItem(S32 index) const { return (S32)mCategories[index].mFirstItem; }
+	S32 getCategoryItemCount(S32 index) const { return (S32)mCategories[index].mNumItems; }
+	S32 getNumIndexedItems() const;
+
+	void getItem(S32 index, LLInventoryItem& item) const;
+
+private:
+	bool validate(const U8* data, size_t size);
+	bool mapFile(const std::string& filename);
+	void unmapFile();
+	const char* getString(U32 offset) const { return mStrings + offset; }
+
+	const LLInventoryCache::Header* mHeader;
+	const LLInventoryCache::CategoryRecord* mCategories;
+	const LLInventoryCache::ItemRecord* mItems;
+	const char* mStrings;
+
+	std::vector<U8> mBuffer;	// holds the file when it is not mapped
+	U8* mMappedData;
+	size_t mMappedSize;
+	void* mMappingHandle;
+};
+
+#endif // LL_LLINVENTORYCACHE_H
@@ -0,0 +1,214 @@
+/**
+ * @file llinventorysearchindex.cpp
+ * @brief Incrementally maintained substring index over inventory names.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#include "linden_common.h"
+
+#include "llinventorysearchindex.h"
+
+#include <algorithm>
+
+#include "llstring.h"
+
+LLInventorySearchIndex::LLInventorySearchIndex()
+	: mRevision(0)
+{
+}
+
+void LLInventorySearchIndex::update(const LLUUID& id, const std::string& text)
+{
+	std::string upper(text);
+	LLStringUtil::toUpper(upper);
+
+	U32 doc;
+	std::map<LLUUID, U32>::iterator iter = mDocIDs.find(id);
+	if (iter != mDocIDs.end())
+	{
+		doc = iter->second;
+		if (mDocs[doc].mText == upper)
+		{
+			return;
+		}
+		removePostings(doc);
+	}
+	else
+	{
+		if (mFreeDocs.empty())
+		{
+			doc = mDocs.size();
+			mDocs.push_back(Doc());
+		}
+		else
+		{
+			doc = mFreeDocs.back();
+			mFreeDocs.pop_back();
+		}
+		mDocs[doc].mID = id;
+		mDocIDs[id] = doc;
+	}
+	mDocs[doc].mText.swap(upper);
+	addPostings(doc);
+	mRevision++;
+}
+
+void LLInventorySearchIndex::remove(const LLUUID& id)
+{
+	std::map<LLUUID, U32>::iterator iter = mDocIDs.find(id);
+	if (iter == mDocIDs.end())
+	{
+		return;
+	}
+	U32 doc = iter->second;
+	removePostings(doc);
+	mDocs[doc].mID.setNull();
+	mDocs[doc].mText.clear();
+	mFreeDocs.push_back(doc);
+	mDocIDs.erase(iter);
+	mRevision++;
+}
+
+void LLInventorySearchIndex::clear()
+{
+	mDocs.clear();
+	mFreeDocs.clear();
+	mDocIDs.clear();
+	mPostings.clear();
+	mRevision++;
+}
+
+const std::string* LLInventorySearchIndex::getText(const LLUUID& id) const
+{
+	std::map<LLUUID, U32>::const_iterator iter = mDocIDs.find(id);
+	return iter != mDocIDs.end() ? &mDocs[iter->second].mText : NULL;
+}
+
+bool LLInventorySearchIndex::find(const std::string& substring, uuid_vec_t& matches) const
+{
+	matches.clear();
+	if (substring.size() < MIN_SUBSTRING_LENGTH)
+	{
+		return false;
+	}
+
+	std::vector<U32> trigrams;
+	getTrigrams(substring, trigrams);
+
+	// Start from the rarest trigram; a missing one means no matches.
+	std::vector<const posting_t*> postings;
+	for (std::vector<U32>::iterator iter = trigrams.begin(); iter != trigrams.end(); ++iter)
+	{
+		posting_map_t::const_iterator posting = mPostings.find(*iter);
+		if (posting == mPostings.end())
+		{
+			return true;
+		}
+		postings.push_back(&posting->second);
+	}
+	std::vector<const posting_t*>::iterator rarest = postings.begin();
+	for (std::vector<const posting_t*>::iterator iter = postings.begin(); iter != postings.end(); ++iter)
+	{
+		if ((*iter)->size() < (*rarest)->size())
+		{
+			rarest = iter;
+		}
+	}
+
+	const posting_t& candidates = **rarest;
+	for (posting_t::const_iterator doc = candidates.begin(); doc != candidates.end(); ++doc)
+	{
+		bool in_all = true;
+		for (std::vector<const posting_t*>::iterator iter = postings.begin(); in_all && iter != postings.end(); ++iter)
+		{
+			in_all = iter == rarest || std::binary_search((*iter)->begin(), (*iter)->end(), *doc);
+		}
+		// Having all the trigrams does not mean having them in order
+		if (in_all && mDocs[*doc].mText.find(substring) != std::string::npos)
+		{
+			matches.push_back(mDocs[*doc].mID);
+		}
+	}
+	std::sort(matches.begin(), matches.end());
+	return true;
+}
+
+// static
+void LLInventorySearchIndex::getTrigrams(const std::string& text, std::vector<U32>& trigrams)
+{
+	trigrams.clear();
+	for (size_t i = 0; i + 3 <= text.size(); ++i)
+	{
+		trigrams.push_back(((U8)text[i] << 16) | ((U8)text[i + 1] << 8) | (U8)text[i + 2]);
+	}
+	std::sort(trigrams.begin(), trigrams.end());
+	trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+}
+
+void LLInventorySearchIndex::addPostings(U32 doc)
+{
+	std::vector<U32> trigrams;
+	getTrigrams(mDocs[doc].mText, trigrams);
+	for (std::vector<U32>::iterator iter = trigrams.begin(); iter != trigrams.end(); ++iter)
+	{
+		posting_t& posting = mPostings[*iter];
+		if (posting.empty() || posting.back() < doc)
+		{
+			posting.push_back(doc);
+		}
+		else
+		{
+			posting.insert(std::lower_bound(posting.begin(), posting.end(), doc), doc);
+		}
+	}
+}
+
+void LLInventorySearchIndex::removePostings(U32 doc)
+{
+	std::vector<U32> trigrams;
+	getTrigrams(mDocs[doc].mText, trigrams);
+	for (std::vector<U32>::iterator iter = trigrams.begin(); iter != trigrams.end(); ++iter)
+	{
+		posting_map_t::iterator posting = mPostings.find(*iter);
+		if (posting == mPostings.end())
+		{
+			continue;
+		}
+		posting_t::iterator found = std::lower_bound(posting->second.begin(), posting->second.end(), doc);
+		if (found != posting->second.end() && *found == doc)
+		{
+			posting->second.erase(found);
+		}
+		if (posting->second.empty())
+		{
+			mPostings.erase(posting);
+		}
+	}
+}
@@ -0,0 +1,96 @@
+/**
+ * @file llinventorysearchindex.h
+ * @brief Incrementally maintained substring index over inventory names.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#ifndef LL_LLINVENTORYSEARCHINDEX_H
+#define LL_LLINVENTORYSEARCHINDEX_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "lluuid.h"
+
+// Trigram postings over the upper cased text of inventory objects, kept up
+// to date one object at a time as they are added, renamed and removed.
+// find() only looks at the objects listed under every trigram of the
+// substring, so its cost follows the number of likely matches rather than
+// the size of the inventory.
+class LLInventorySearchIndex
+{
+public:
+	typedef std::vector<LLUUID> uuid_vec_t;
+
+	enum { MIN_SUBSTRING_LENGTH = 3 };
+
+	LLInventorySearchIndex();
+
+	// Indexes text for id, replacing whatever was indexed for it before.
+	void update(const LLUUID& id, const std::string& text);
+	void remove(const LLUUID& id);
+	void clear();
+
+	S32 size() const { return (S32)mDocIDs.size(); }
+
+	// The upper cased text indexed for id, or NULL if id is not indexed.
+	const std::string* getText(const LLUUID& id) const;
+
+	// Changes with every update() or remove() that changed the index.
+	U32 getRevision() const { return mRevision; }
+
+	// Fills matches, sorted, with the ids whose text contains substring,
+	// which must already be upper cased.  Returns false and leaves
+	// matches empty when substring is too short for the index to help.
+	bool find(const std::string& substring, uuid_vec_t& matches) const;
+
+private:
+	typedef std::vector<U32> posting_t;
+	typedef std::map<U32, posting_t> posting_map_t;
+
+	struct Doc
+	{
+		LLUUID mID;
+		std::string mText;
+	};
+
+	static void getTrigrams(const std::string& text, std::vector<U32>& trigrams);
+	void addPostings(U32 doc);
+	void removePostings(U32 doc);
+
+	std::vector<Doc> mDocs;
+	std::vector<U32> mFreeDocs;
+	std::map<LLUUID, U32> mDocIDs;
+	posting_map_t mPostings;		// Trigram to sorted doc indices
+	U32 mRevision;
+};
+
+#endif // LL_LLINVENTORYSEARCHINDEX_H
@@ -0,0 +1,198 @@
+/**
+ * @file llskinjob_bench.cpp
+ * @brief Measures skinning a crowd of avatars serially and on a job pool.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#include "linden_common.h"
+
+#include "lljobpool.h"
+#include "llquaternion.h"
+#include "llrand.h"
+#include "llskinjob.h"
+#include "llsys.h"
+#include "lltimer.h"
+
+// Builds synthetic avatars with the mesh sizes and joint count of the
+// highest avatar LODs, then skins them every frame one mesh after
+// another, as renderSkinned() does, and all at once on an LLJobPool with
+// one worker per extra core.  Reports milliseconds per frame for both and
+// exits with 1 if the pooled results differ from the serial ones.
+//
+// usage: llskinjob_bench [-a avatars] [-f frames]
+
+namespace
+{
+	const S32 NUM_JOINTS = 15;		// LL_CHARACTER_MAX_JOINTS_PER_MESH
+
+	// Roughly the vertex counts of the highest avatar mesh LODs
+	const U32 MESH_VERTICES[] = { 1300, 1600, 1200, 300, 100, 900 };
+
+	// One synthetic mesh: a bind pose, weights in runs along the joint
+	// chain as a real mesh has them, and posed joints.
+	struct BenchMesh
+	{
+		std::vector<F32> mWeights;
+		std::vector<LLVector3> mCoords;
+		std::vector<LLVector3> mNormals;
+		std::vector<LLVector3> mOutVertices;
+		std::vector<LLVector3> mOutNormals;
+		LLMatrix4 mJointMat[LLSkinJob::MAX_JOINTS];
+		LLMatrix3 mJointRot[LLSkinJob::MAX_JOINTS];
+
+		BenchMesh(U32 num_vertices)
+			: mWeights(num_vertices), mCoords(num_vertices), mNormals(num_vertices),
+			  mOutVertices(num_vertices), mOutNormals(num_vertices)
+		{
+			F32 weight = 0.f;
+			for (U32 i = 0; i < num_vertices; ++i)
+			{
+				if (i % 8 == 0)
+				{
+					S32 joint = ll_rand(NUM_JOINTS - 1);
+					// some vertices sit on a single joint
+					weight = joint + (ll_rand(4) ? ll_frand(0.999f) : 1.f);
+				}
+				mWeights[i] = weight;
+				mCoords[i].setVec(ll_frand(1.f) - 0.5f, ll_frand(1.f) - 0.5f, ll_frand(2.f));
+				mNormals[i].setVec(ll_frand(1.f) - 0.5f, ll_frand(1.f) - 0.5f, ll_frand(1.f) - 0.5f);
+				mNormals[i].normVec();
+			}
+			for (S32 j = 0; j < NUM_JOINTS; ++j)
+			{
+				LLQuaternion rot(ll_frand(F_PI), LLVector3(ll_frand(1.f), ll_frand(1.f), 1.f));
+				LLVector3 pos(ll_frand(0.2f), ll_frand(0.2f), (F32)j * 0.1f);
+				mJointMat[j].initAll(LLVector3(1.f, 1.f, 1.f), rot, pos);
+				mJointRot[j] = mJointMat[j].getMat3();
+			}
+		}
+
+		void setupJob(LLSkinJob& job)
+		{
+			memcpy(job.mJointMat, mJointMat, sizeof(mJointMat));
+			memcpy(job.mJointRot, mJointRot, sizeof(mJointRot));
+			job.mWeights = &mWeights[0];
+			job.mCoords = &mCoords[0];
+			job.mNormals = &mNormals[0];
+			job.mNumVertices = mWeights.size();
+			job.mOutVertices = &mOutVertices[0];
+			job.mOutNormals = &mOutNormals[0];
+		}
+	};
+
+	class SkinJobList : public LLJobPool::Job
+	{
+	public:
+		SkinJobList(std::vector<LLSkinJob>& jobs) : mJobs(jobs) {}
+		/*virtual*/ void run(S32 index) { mJobs[index].run(); }
+	private:
+		std::vector<LLSkinJob>& mJobs;
+	};
+}
+
+int main(int argc, char** argv)
+{
+	S32 num_avatars = 40;
+	S32 frames = 20;
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		S32 value = llmax(1, atoi(argv[i + 1]));
+		if (!strcmp(argv[i], "-a"))
+		{
+			num_avatars = value;
+		}
+		else if (!strcmp(argv[i], "-f"))
+		{
+			frames = value;
+		}
+	}
+
+	std::vector<BenchMesh*> meshes;
+	U32 vertices = 0;
+	for (S32 i = 0; i < num_avatars; ++i)
+	{
+		for (size_t j = 0; j < LL_ARRAY_SIZE(MESH_VERTICES); ++j)
+		{
+			meshes.push_back(new BenchMesh(MESH_VERTICES[j]));
+			vertices += MESH_VERTICES[j];
+		}
+	}
+	std::vector<LLSkinJob> jobs(meshes.size());
+	for (size_t i = 0; i < meshes.size(); ++i)
+	{
+		meshes[i]->setupJob(jobs[i]);
+	}
+
+	LLTimer timer;
+	for (S32 frame = 0; frame < frames; ++frame)
+	{
+		for (size_t i = 0; i < jobs.size(); ++i)
+		{
+			jobs[i].run();
+		}
+	}
+	F64 serial = timer.getElapsedTimeF64() / frames;
+
+	std::vector<std::vector<LLVector3> > serial_out;
+	for (size_t i = 0; i < meshes.size(); ++i)
+	{
+		serial_out.push_back(meshes[i]->mOutVertices);
+		serial_out.push_back(meshes[i]->mOutNormals);
+		meshes[i]->mOutVertices.assign(meshes[i]->mOutVertices.size(), LLVector3::zero);
+		meshes[i]->mOutNormals.assign(meshes[i]->mOutNormals.size(), LLVector3::zero);
+	}
+
+	S32 threads = llmax((S32)LLCPUInfo::getNumCores() - 1, 1);
+	F64 pooled;
+	{
+		LLJobPool pool("skin", threads);
+		SkinJobList job_list(jobs);
+		timer.reset();
+		for (S32 frame = 0; frame < frames; ++frame)
+		{
+			pool.run(job_list, jobs.size());
+		}
+		pooled = timer.getElapsedTimeF64() / frames;
+	}
+
+	bool same = true;
+	for (size_t i = 0; i < meshes.size(); ++i)
+	{
+		same = same && serial_out[2 * i] == meshes[i]->mOutVertices
+					&& serial_out[2 * i + 1] == meshes[i]->mOutNormals;
+		delete meshes[i];
+	}
+
+	printf("%d avatars, %u vertices: serial %.3f ms/frame, %d workers and the caller %.3f ms/frame  %.2fx  %s\n",
+		   num_avatars, vertices, serial * 1000.0, threads, pooled * 1000.0,
+		   serial / llmax(pooled, 1.0e-9),
+		   same ? "same results" : "RESULT MISMATCH");
+	return same ? 0 : 1;
+}
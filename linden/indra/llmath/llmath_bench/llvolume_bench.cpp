@@ -0,0 +1,181 @@
+/**
+ * @file llvolume_bench.cpp
+ * @brief Measures volume picking with and without the per-face BVH.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#include "linden_common.h"
+
+#include "llmath.h"
+#include "llrand.h"
+#include "lltimer.h"
+#include "llvolume.h"
+#include "v2math.h"
+#include "v3math.h"
+
+// Builds a twisted torus, a tapered box and a high detail sculpty, then
+// times lineSegmentIntersect() over the same random segments with
+// LLVolumeFace::sUseBVH off (every triangle tested) and on.  Reports
+// microseconds per pick and exits with 1 if the two disagree on the
+// number of hits.
+//
+// usage: llvolume_bench [-n segments]
+
+namespace
+{
+	struct Segment
+	{
+		LLVector3 mStart;
+		LLVector3 mEnd;
+	};
+
+	// A lumpy sphere, like the sculpt maps people actually upload
+	void make_sculpt_map(std::vector<U8>& data, U16 width, U16 height)
+	{
+		data.resize(width * height * 3);
+		for (U16 y = 0; y < height; y++)
+		{
+			F32 v = F_PI * (F32)y / (F32)(height - 1);
+			for (U16 x = 0; x < width; x++)
+			{
+				F32 u = F_TWO_PI * (F32)x / (F32)width;
+				F32 r = 0.8f + 0.2f * sinf(5.f * u) * sinf(7.f * v);
+				LLVector3 pos(r * sinf(v) * cosf(u), r * sinf(v) * sinf(u), r * cosf(v));
+				U8* pixel = &data[(y * width + x) * 3];
+				for (U32 i = 0; i < 3; i++)
+				{
+					pixel[i] = (U8)llclamp(llround(127.5f + 127.5f * pos.mV[i]), 0, 255);
+				}
+			}
+		}
+	}
+
+	// Segments from outside the unit box through points inside it, the way
+	// hover picks cross a prim.
+	void make_segments(std::vector<Segment>& segments, S32 count)
+	{
+		segments.resize(count);
+		for (S32 i = 0; i < count; i++)
+		{
+			LLVector3 target(ll_frand() - 0.5f, ll_frand() - 0.5f, ll_frand() - 0.5f);
+			LLVector3 dir(ll_frand() - 0.5f, ll_frand() - 0.5f, ll_frand() - 0.5f);
+			dir.normVec();
+			segments[i].mStart = target - dir * 2.f;
+			segments[i].mEnd = target + dir * 2.f;
+		}
+	}
+
+	S32 count_triangles(LLVolume* volume)
+	{
+		S32 count = 0;
+		for (S32 i = 0; i < volume->getNumVolumeFaces(); i++)
+		{
+			count += volume->getVolumeFace(i).mIndices.size() / 3;
+		}
+		return count;
+	}
+
+	bool bench(LLVolume* volume, const std::string& name, const std::vector<Segment>& segments)
+	{
+		F64 seconds[2];
+		S32 hits[2];
+		for (S32 use_bvh = 0; use_bvh < 2; use_bvh++)
+		{
+			LLVolumeFace::sUseBVH = use_bvh;
+			// the first pick builds the hierarchy, keep that out of the timing
+			volume->lineSegmentIntersect(segments[0].mStart, segments[0].mEnd);
+			hits[use_bvh] = 0;
+			LLTimer timer;
+			for (U32 i = 0; i < segments.size(); i++)
+			{
+				LLVector3 point;
+				LLVector2 tc;
+				LLVector3 normal;
+				if (volume->lineSegmentIntersect(segments[i].mStart, segments[i].mEnd, -1, &point, &tc, &normal) >= 0)
+				{
+					hits[use_bvh]++;
+				}
+			}
+			seconds[use_bvh] = llmax(timer.getElapsedTimeF64(), 1.0e-9);
+		}
+
+		printf("%-8s %7d triangles  %6d hits  linear %8.2f us/pick  BVH %8.2f us/pick  %6.2fx  %s\n",
+			   name.c_str(), count_triangles(volume), hits[1],
+			   seconds[0] * 1000000.0 / segments.size(), seconds[1] * 1000000.0 / segments.size(),
+			   seconds[0] / seconds[1],
+			   hits[0] == hits[1] ? "same hits" : "HIT MISMATCH");
+		return hits[0] == hits[1];
+	}
+}
+
+int main(int argc, char** argv)
+{
+	S32 num_segments = 20000;
+	if (argc > 2 && !strcmp(argv[1], "-n"))
+	{
+		num_segments = llmax(1, atoi(argv[2]));
+	}
+
+	std::vector<Segment> segments;
+	make_segments(segments, num_segments);
+
+	// twisted, hollow torus
+	LLVolumeParams params;
+	params.setType(LL_PCODE_PROFILE_CIRCLE, LL_PCODE_PATH_CIRCLE);
+	params.setRatio(1.f, 0.25f);
+	params.setHollow(0.5f);
+	params.setTwistEnd(0.5f);
+	LLPointer<LLVolume> torus = new LLVolume(params, 4.f);
+
+	// tapered box with a cut
+	LLVolumeParams box_params;
+	box_params.setType(LL_PCODE_PROFILE_SQUARE, LL_PCODE_PATH_LINE);
+	box_params.setBeginAndEndS(0.125f, 0.875f);
+	box_params.setTaper(0.3f, -0.3f);
+	LLPointer<LLVolume> box = new LLVolume(box_params, 4.f);
+
+	// high detail sculpty
+	LLVolumeParams sculpt_params;
+	sculpt_params.setType(LL_PCODE_PROFILE_CIRCLE, LL_PCODE_PATH_CIRCLE);
+	LLUUID sculpt_id;
+	sculpt_id.generate();
+	sculpt_params.setSculptID(sculpt_id, LL_SCULPT_TYPE_SPHERE);
+	LLPointer<LLVolume> sculpt = new LLVolume(sculpt_params, 4.f);
+	std::vector<U8> map;
+	make_sculpt_map(map, 64, 64);
+	sculpt->sculpt(64, 64, 3, &map[0], 0);
+
+	printf("%d segments per volume\n", num_segments);
+	bool same = bench(torus, "torus", segments);
+	same = bench(box, "box", segments) && same;
+	same = bench(sculpt, "sculpt", segments) && same;
+	LLVolumeFace::sUseBVH = TRUE;
+	return same ? 0 : 1;
+}
@@ -0,0 +1,204 @@
+/**
+ * @file llmorphbatch.cpp
+ * @brief Batched application of morph target deltas to a mesh.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#include "linden_common.h"
+
+#include "llmorphbatch.h"
+
+void LLMorphDeltas::set(U32 count, const U32* indices,
+						const LLVector3* coords, const LLVector3* normals,
+						const LLVector3* binormals, const LLVector2* tex_coords)
+{
+	mIndices.assign(indices, indices + count);
+	for (S32 j = 0; j < 3; ++j)
+	{
+		mCoords[j].resize(count);
+		mNormals[j].resize(count);
+		mBinormals[j].resize(count);
+	}
+	mTexCoords[0].resize(count);
+	mTexCoords[1].resize(count);
+
+	for (U32 i = 0; i < count; ++i)
+	{
+		for (S32 j = 0; j < 3; ++j)
+		{
+			mCoords[j][i] = coords[i].mV[j];
+			mNormals[j][i] = normals[i].mV[j];
+			mBinormals[j][i] = binormals[i].mV[j];
+		}
+		mTexCoords[0][i] = tex_coords[i].mV[VX];
+		mTexCoords[1][i] = tex_coords[i].mV[VY];
+	}
+}
+
+void LLMorphBatch::add(const LLMorphDeltas* deltas, F32 delta_weight, const F32* mask_weights, bool clothing)
+{
+	for (std::vector<Entry>::iterator iter = mEntries.begin(); iter != mEntries.end(); ++iter)
+	{
+		if (iter->mDeltas == deltas && iter->mMaskWeights == mask_weights && iter->mClothing == clothing)
+		{
+			iter->mWeight += delta_weight;
+			return;
+		}
+	}
+
+	Entry entry;
+	entry.mDeltas = deltas;
+	entry.mWeight = delta_weight;
+	entry.mMaskWeights = mask_weights;
+	entry.mClothing = clothing;
+	mEntries.push_back(entry);
+}
+
+void LLMorphBatch::apply(const Mesh& mesh, F32 normal_factor)
+{
+	if (mTouched.size() < mesh.mNumVertices)
+	{
+		mTouched.resize(mesh.mNumVertices, 0);
+	}
+
+	for (std::vector<Entry>::iterator iter = mEntries.begin(); iter != mEntries.end(); ++iter)
+	{
+		if (iter->mWeight != 0.f)
+		{
+			applyEntry(*iter, mesh, normal_factor);
+		}
+	}
+	mEntries.clear();
+
+	// Same half angle normals and binormals as LLPolyMorphTarget::apply()
+	// computed after each morph
+	for (std::vector<U32>::iterator iter = mTouchedList.begin(); iter != mTouchedList.end(); ++iter)
+	{
+		U32 v = *iter;
+		mTouched[v] = 0;
+
+		LLVector3 normalized_normal = mesh.mScaledNormals[v];
+		normalized_normal.normVec();
+		mesh.mNormals[v] = normalized_normal;
+
+		LLVector3 tangent = mesh.mScaledBinormals[v] % normalized_normal;
+		LLVector3 normalized_binormal = normalized_normal % tangent;
+		normalized_binormal.normVec();
+		mesh.mBinormals[v] = normalized_binormal;
+	}
+	mTouchedList.clear();
+}
+
+// Scaling the deltas is done in flat loops over plain floats, which the
+// compiler turns into SIMD code; only the scatter into the mesh's
+// interleaved vectors goes vertex by vertex.  The products are formed in
+// the same order as LLPolyMorphTarget::apply() used to.
+void LLMorphBatch::applyEntry(const Entry& entry, const Mesh& mesh, F32 normal_factor)
+{
+	const LLMorphDeltas& deltas = *entry.mDeltas;
+	const U32 count = deltas.size();
+	if (count == 0)
+	{
+		return;
+	}
+
+	const F32 weight = entry.mWeight;
+	const F32* mask = entry.mMaskWeights;
+
+	F32* out[11];
+	const F32* in[11];
+	for (S32 j = 0; j < 11; ++j)
+	{
+		mScratch[j].resize(count);
+		out[j] = &mScratch[j][0];
+	}
+	for (S32 j = 0; j < 3; ++j)
+	{
+		in[j] = &deltas.mCoords[j][0];
+		in[3 + j] = &deltas.mNormals[j][0];
+		in[6 + j] = &deltas.mBinormals[j][0];
+	}
+	in[9] = &deltas.mTexCoords[0][0];
+	in[10] = &deltas.mTexCoords[1][0];
+
+	for (S32 j = 0; j < 11; ++j)
+	{
+		const F32* src = in[j];
+		F32* dst = out[j];
+		for (U32 i = 0; i < count; ++i)
+		{
+			dst[i] = src[i] * weight;
+		}
+		if (mask)
+		{
+			for (U32 i = 0; i < count; ++i)
+			{
+				dst[i] *= mask[i];
+			}
+		}
+		if (j >= 3 && j < 9)
+		{
+			for (U32 i = 0; i < count; ++i)
+			{
+				dst[i] *= normal_factor;
+			}
+		}
+	}
+
+	const U32* indices = &deltas.mIndices[0];
+	LLVector4* clothing_weights = entry.mClothing ? mesh.mClothingWeights : NULL;
+	for (U32 i = 0; i < count; ++i)
+	{
+		const U32 v = indices[i];
+		for (S32 j = 0; j < 3; ++j)
+		{
+			mesh.mCoords[v].mV[j] += out[j][i];
+			mesh.mScaledNormals[v].mV[j] += out[3 + j][i];
+			mesh.mScaledBinormals[v].mV[j] += out[6 + j][i];
+		}
+		mesh.mTexCoords[v].mV[VX] += out[9][i];
+		mesh.mTexCoords[v].mV[VY] += out[10][i];
+
+		if (clothing_weights)
+		{
+			LLVector4& clothing_weight = clothing_weights[v];
+			clothing_weight.mV[VX] += out[0][i];
+			clothing_weight.mV[VY] += out[1][i];
+			clothing_weight.mV[VZ] += out[2][i];
+			clothing_weight.mV[VW] = mask ? mask[i] : 1.f;
+		}
+
+		if (!mTouched[v])
+		{
+			mTouched[v] = 1;
+			mTouchedList.push_back(v);
+		}
+	}
+}
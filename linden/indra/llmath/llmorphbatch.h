@@ -0,0 +1,111 @@
+/**
+ * @file llmorphbatch.h
+ * @brief Batched application of morph target deltas to a mesh.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#ifndef LL_LLMORPHBATCH_H
+#define LL_LLMORPHBATCH_H
+
+#include <vector>
+
+#include "v2math.h"
+#include "v3math.h"
+#include "v4math.h"
+
+// One morph target's per-vertex deltas, one array per component, so
+// that scaling them by a weight is a flat loop over floats.
+class LLMorphDeltas
+{
+public:
+	void set(U32 count, const U32* indices,
+			 const LLVector3* coords, const LLVector3* normals,
+			 const LLVector3* binormals, const LLVector2* tex_coords);
+
+	U32 size() const { return (U32)mIndices.size(); }
+
+	std::vector<U32> mIndices;			// Mesh vertex of each delta
+	std::vector<F32> mCoords[3];
+	std::vector<F32> mNormals[3];
+	std::vector<F32> mBinormals[3];
+	std::vector<F32> mTexCoords[2];
+};
+
+// The morphs to apply to one mesh.  add() only records a morph and its
+// change in weight; apply() adds all of them in one pass and then
+// renormalizes each vertex they touched once, rather than once per morph.
+class LLMorphBatch
+{
+public:
+	// Where apply() writes, laid out as in LLPolyMesh
+	struct Mesh
+	{
+		U32 mNumVertices;
+		LLVector3* mCoords;
+		LLVector3* mScaledNormals;
+		LLVector3* mNormals;				// normalized mScaledNormals
+		LLVector3* mScaledBinormals;
+		LLVector3* mBinormals;				// mScaledBinormals made orthonormal to mNormals
+		LLVector2* mTexCoords;
+		LLVector4* mClothingWeights;		// may be NULL
+	};
+
+	bool empty() const { return mEntries.empty(); }
+	S32 getNumMorphs() const { return (S32)mEntries.size(); }
+
+	// mask_weights, when not NULL, scales each delta and must stay valid
+	// until apply().  Clothing morphs also move mClothingWeights.  Adding
+	// a morph that is already pending with the same mask just adds to its
+	// weight.
+	void add(const LLMorphDeltas* deltas, F32 delta_weight, const F32* mask_weights, bool clothing);
+
+	// Normal and binormal deltas are also scaled by normal_factor.
+	void apply(const Mesh& mesh, F32 normal_factor);
+
+	void clear() { mEntries.clear(); }
+
+private:
+	struct Entry
+	{
+		const LLMorphDeltas* mDeltas;
+		F32 mWeight;
+		const F32* mMaskWeights;
+		bool mClothing;
+	};
+
+	void applyEntry(const Entry& entry, const Mesh& mesh, F32 normal_factor);
+
+	std::vector<Entry> mEntries;
+	std::vector<F32> mScratch[11];			// Weighted deltas of one morph
+	std::vector<U8> mTouched;				// Per mesh vertex
+	std::vector<U32> mTouchedList;
+};
+
+#endif // LL_LLMORPHBATCH_H
@@ -0,0 +1,129 @@
+/**
+ * @file llskinjob.cpp
+ * @brief Software skinning of one mesh between pairs of joint matrices.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#include "linden_common.h"
+
+#include "llskinjob.h"
+
+#include "llmath.h"
+
+LLSkinJob::LLSkinJob()
+	: mWeights(NULL),
+	  mCoords(NULL),
+	  mNormals(NULL),
+	  mNumVertices(0)
+{
+}
+
+// static
+void LLSkinJob::skin(const LLMatrix4* joint_mat, const LLMatrix3* joint_rot,
+					 const F32* weights, const LLVector3* coords, const LLVector3* normals,
+					 U32 num_vertices,
+					 LLStrider<LLVector3> o_vertices, LLStrider<LLVector3> o_normals)
+{
+	F32 last_weight = F32_MAX;
+	LLMatrix4 blend_mat;
+	LLMatrix3 blend_rot_mat;
+
+	for (U32 index = 0; index < num_vertices; index++)
+	{
+		// blend by first matrix
+		F32 w = weights[index]; 
+		
+		// Maybe we don't have to change blend_mat.
+		// Profiles of a single-avatar scene on a Mac show this to be a very
+		// common case.  JC
+		if (w == last_weight)
+		{
+			o_vertices[index] = coords[index] * blend_mat;
+			o_normals[index] = normals[index] * blend_rot_mat;
+			continue;
+		}
+		
+		last_weight = w;
+
+		S32 joint = llfloor(w);
+		w -= joint;
+		
+		// No lerp required in this case.
+		if (w == 1.0f)
+		{
+			blend_mat = joint_mat[joint+1];
+			o_vertices[index] = coords[index] * blend_mat;
+			blend_rot_mat = joint_rot[joint+1];
+			o_normals[index] = normals[index] * blend_rot_mat;
+			continue;
+		}
+		
+		// Try to keep all the accesses to the matrix data as close
+		// together as possible.  This function is a hot spot on the
+		// Mac. JC
+		const LLMatrix4 &m0 = joint_mat[joint+1];
+		const LLMatrix4 &m1 = joint_mat[joint+0];
+		
+		blend_mat.mMatrix[VX][VX] = lerp(m1.mMatrix[VX][VX], m0.mMatrix[VX][VX], w);
+		blend_mat.mMatrix[VX][VY] = lerp(m1.mMatrix[VX][VY], m0.mMatrix[VX][VY], w);
+		blend_mat.mMatrix[VX][VZ] = lerp(m1.mMatrix[VX][VZ], m0.mMatrix[VX][VZ], w);
+
+		blend_mat.mMatrix[VY][VX] = lerp(m1.mMatrix[VY][VX], m0.mMatrix[VY][VX], w);
+		blend_mat.mMatrix[VY][VY] = lerp(m1.mMatrix[VY][VY], m0.mMatrix[VY][VY], w);
+		blend_mat.mMatrix[VY][VZ] = lerp(m1.mMatrix[VY][VZ], m0.mMatrix[VY][VZ], w);
+
+		blend_mat.mMatrix[VZ][VX] = lerp(m1.mMatrix[VZ][VX], m0.mMatrix[VZ][VX], w);
+		blend_mat.mMatrix[VZ][VY] = lerp(m1.mMatrix[VZ][VY], m0.mMatrix[VZ][VY], w);
+		blend_mat.mMatrix[VZ][VZ] = lerp(m1.mMatrix[VZ][VZ], m0.mMatrix[VZ][VZ], w);
+
+		blend_mat.mMatrix[VW][VX] = lerp(m1.mMatrix[VW][VX], m0.mMatrix[VW][VX], w);
+		blend_mat.mMatrix[VW][VY] = lerp(m1.mMatrix[VW][VY], m0.mMatrix[VW][VY], w);
+		blend_mat.mMatrix[VW][VZ] = lerp(m1.mMatrix[VW][VZ], m0.mMatrix[VW][VZ], w);
+
+		o_vertices[index] = coords[index] * blend_mat;
+		
+		const LLMatrix3 &n0 = joint_rot[joint+1];
+		const LLMatrix3 &n1 = joint_rot[joint+0];
+		
+		blend_rot_mat.mMatrix[VX][VX] = lerp(n1.mMatrix[VX][VX], n0.mMatrix[VX][VX], w);
+		blend_rot_mat.mMatrix[VX][VY] = lerp(n1.mMatrix[VX][VY], n0.mMatrix[VX][VY], w);
+		blend_rot_mat.mMatrix[VX][VZ] = lerp(n1.mMatrix[VX][VZ], n0.mMatrix[VX][VZ], w);
+
+		blend_rot_mat.mMatrix[VY][VX] = lerp(n1.mMatrix[VY][VX], n0.mMatrix[VY][VX], w);
+		blend_rot_mat.mMatrix[VY][VY] = lerp(n1.mMatrix[VY][VY], n0.mMatrix[VY][VY], w);
+		blend_rot_mat.mMatrix[VY][VZ] = lerp(n1.mMatrix[VY][VZ], n0.mMatrix[VY][VZ], w);
+
+		blend_rot_mat.mMatrix[VZ][VX] = lerp(n1.mMatrix[VZ][VX], n0.mMatrix[VZ][VX], w);
+		blend_rot_mat.mMatrix[VZ][VY] = lerp(n1.mMatrix[VZ][VY], n0.mMatrix[VZ][VY], w);
+		blend_rot_mat.mMatrix[VZ][VZ] = lerp(n1.mMatrix[VZ][VZ], n0.mMatrix[VZ][VZ], w);
+		
+		o_normals[index] = normals[index] * blend_rot_mat;
+	}
+}
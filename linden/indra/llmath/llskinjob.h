@@ -0,0 +1,72 @@
+/**
+ * @file llskinjob.h
+ * @brief Software skinning of one mesh between pairs of joint matrices.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#ifndef LL_LLSKINJOB_H
+#define LL_LLSKINJOB_H
+
+#include "llstrider.h"
+#include "m3math.h"
+#include "m4math.h"
+#include "v3math.h"
+
+// Everything needed to skin one mesh, so that many meshes can be skinned
+// at once on different threads: a copy of the joint matrices, the mesh's
+// bind pose and weights, and where the results go.  A weight's integer
+// part is the first of two joints and its fraction the blend towards the
+// second, as LLPolyMesh stores them.
+class LLSkinJob
+{
+public:
+	enum { MAX_JOINTS = 32 };
+
+	LLSkinJob();
+
+	void run() { skin(mJointMat, mJointRot, mWeights, mCoords, mNormals, mNumVertices, mOutVertices, mOutNormals); }
+
+	// The kernel, also used directly when skinning a single mesh.
+	static void skin(const LLMatrix4* joint_mat, const LLMatrix3* joint_rot,
+					 const F32* weights, const LLVector3* coords, const LLVector3* normals,
+					 U32 num_vertices,
+					 LLStrider<LLVector3> out_vertices, LLStrider<LLVector3> out_normals);
+
+	LLMatrix4 mJointMat[MAX_JOINTS];
+	LLMatrix3 mJointRot[MAX_JOINTS];
+	const F32* mWeights;
+	const LLVector3* mCoords;
+	const LLVector3* mNormals;
+	U32 mNumVertices;
+	LLStrider<LLVector3> mOutVertices;
+	LLStrider<LLVector3> mOutNormals;
+};
+
+#endif // LL_LLSKINJOB_H
@@ -0,0 +1,407 @@
+/**
+ * @file llskyeval.cpp
+ * @brief Batched evaluation of the WindLight sky color model.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#include "linden_common.h"
+
+#include "llskyeval.h"
+
+#include "llmath.h"
+#include "llv4math.h"
+
+// The integer conversions the exp and log below need are SSE2
+#if LL_VECTORIZE && (defined(__SSE2__) || _M_IX86_FP >= 2)
+#define LL_SKYEVAL_SSE2 1
+#include <emmintrin.h>
+#else
+#define LL_SKYEVAL_SSE2 0
+#endif
+
+static const LLColor3 DARK_BROWN(0.082f, 0.076f, 0.066f);
+static const LLColor3 BROWN(0.430f, 0.386f, 0.322f);
+static const F32 SATURATION = 0.3f;
+
+LLSkyEval::LLSkyEval()
+	: mParams()
+{
+	mParams.mLightNorm.set(0.f, 1.f, 0.f);
+	setParams(mParams);
+}
+
+void LLSkyEval::setParams(const Params& params)
+{
+	mParams = params;
+
+	const LLColor3 haze_density(params.mHazeDensity, params.mHazeDensity, params.mHazeDensity);
+	mLightAtten = (params.mBlueDensity + haze_density * 0.25f) * (params.mDensityMultiplier * params.mMaxY);
+	mExtinction = params.mBlueDensity + haze_density;
+	for (S32 c = 0; c < 3; ++c)
+	{
+		mBlueTerm.mV[c] = params.mBlueHorizon.mV[c] * (params.mBlueDensity.mV[c] / mExtinction.mV[c]);
+		mHazeTerm.mV[c] = params.mHazeHorizon * (params.mHazeDensity / mExtinction.mV[c]);
+	}
+	mCloudAmbient = params.mAmbient + (LLColor3::white - params.mAmbient) * params.mCloudShadow * 0.5f;
+
+	// Sunlight as it reaches the ground, for the sky below the horizon
+	const F32 inv_light_y = 1.f / llmax(0.f, params.mLightNorm.mV[VY] * 2.f);
+	for (S32 c = 0; c < 3; ++c)
+	{
+		mGroundLighting.mV[c] = params.mSunlightColor.mV[c] * expf((mLightAtten.mV[c] * -1.f) * inv_light_y)
+								+ params.mAmbient.mV[c];
+	}
+
+	const LLColor3& fog = params.mFogColor;
+	mFogSky.set(llmax(fog.mV[0], 0.2f), llmax(fog.mV[1], 0.2f), llmax(fog.mV[2], 0.22f));
+
+	LLColor3 desat_fog = fog;
+	F32 brightness = desat_fog.brightness();
+	// So that shiny somewhat shows up at night.
+	if (brightness < 0.15f)
+	{
+		brightness = 0.15f;
+		desat_fog.set(0.15f, 0.15f, 0.15f);
+	}
+	desat_fog = desat_fog * SATURATION + LLColor3(brightness, brightness, brightness) * (1.f - SATURATION);
+	mFogShiny = params.mWindLightShaders ? desat_fog * 0.5f : desat_fog;
+}
+
+void LLSkyEval::evaluate(const LLVector3* dirs, S32 count, LLColor4* sky, LLColor4* shiny) const
+{
+	S32 i = 0;
+#if LL_SKYEVAL_SSE2
+	for (; i + 4 <= count; i += 4)
+	{
+		evaluateFour(dirs + i, sky + i, shiny ? shiny + i : NULL);
+	}
+#endif
+	for (; i < count; ++i)
+	{
+		evaluateOne(dirs[i], sky + i, shiny ? shiny + i : NULL);
+	}
+}
+
+void LLSkyEval::evaluateOne(const LLVector3& dir, LLColor4* sky, LLColor4* shiny) const
+{
+	if (dir.mV[VZ] < -0.02f)
+	{
+		F32 x = 1.0f-fabsf(-0.1f-dir.mV[VZ]);
+		x *= x;
+		const LLColor3 fade(x*x, powf(x, 2.5f), x*x*x);
+		*sky = LLColor4(mFogSky * fade, 0.f);
+		if (shiny)
+		{
+			*shiny = LLColor4(mFogShiny * fade, 0.f);
+		}
+		return;
+	}
+
+	// undo OGL_TO_CFR_ROTATION and negate vertical direction.
+	LLVector3 Pn(-dir.mV[VY], -dir.mV[VZ], -dir.mV[VX]);
+
+	// Project the direction ray onto the sky dome.  This is the law of
+	// sines step of the sky shader with the trigonometry folded away:
+	// sin(PI + phi + asin(r sin(phi))) / sin(phi) = -(cos(asin(r sin(phi))) + r cos(phi))
+	const F32 ratio = mParams.mDomeOffsetRatio;
+	const F32 offset_sin = ratio * sqrtf(llmax(0.f, 1.f - Pn.mV[VY]*Pn.mV[VY]));
+	F32 Plen = -mParams.mDomeRadius * (sqrtf(llmax(0.f, 1.f - offset_sin*offset_sin)) + ratio * Pn.mV[VY]);
+	Pn *= Plen;
+
+	// Set altitude
+	if (Pn.mV[VY] > 0.f)
+	{
+		Pn *= (mParams.mMaxY / Pn.mV[VY]);
+	}
+	else
+	{
+		Pn *= (-32000.f / Pn.mV[VY]);
+	}
+	Plen = Pn.length();
+	Pn /= Plen;
+
+	const LLVector3& lightnorm = mParams.mLightNorm;
+	const F32 inv_y = 1.f / llmax(F_APPROXIMATELY_ZERO, llmax(0.f, Pn.mV[VY]) + lightnorm.mV[VY]);
+	const F32 distance = Plen * mParams.mDensityMultiplier;
+
+	// Haze glow, 0 at the sun and increasing away from it
+	F32 glow = llmax(1.f - Pn * lightnorm, .001f) * mParams.mGlow.mV[0];
+	glow = powf(glow, mParams.mGlow.mV[2]) + .25f;
+
+	LLColor3 haze;
+	for (S32 c = 0; c < 3; ++c)
+	{
+		F32 sunlight = mParams.mSunlightColor.mV[c] * expf((mLightAtten.mV[c] * -1.f) * inv_y);
+		const F32 transparency = expf((mExtinction.mV[c] * -1.f) * distance);
+		const F32 ambient = mParams.mAmbient.mV[c];
+		F32 above = mBlueTerm.mV[c] * (sunlight + ambient) + mHazeTerm.mV[c] * (sunlight * glow + ambient);
+		sunlight *= (1.f - mParams.mCloudShadow);
+		const F32 cloud_ambient = mCloudAmbient.mV[c];
+		const F32 below = mBlueTerm.mV[c] * (sunlight + cloud_ambient) + mHazeTerm.mV[c] * (sunlight * glow + cloud_ambient);
+
+		// At the horizon, blend towards the darker color below the clouds
+		above *= (1.f - transparency);
+		haze.mV[c] = above + (below - above) * (1.f - sqrtf(sqrtf(transparency)));
+	}
+
+	if (Pn.mV[VY] < 0.f)
+	{
+		const F32 haze_brightness = haze.brightness();
+		if (Pn.mV[VY] < -0.05f)
+		{
+			haze = (DARK_BROWN + (BROWN - DARK_BROWN) * (-Pn.mV[VY] * 0.9f)) * mGroundLighting * haze_brightness;
+		}
+		if (Pn.mV[VY] > -0.1f)
+		{
+			const LLColor3 grey(haze_brightness, haze_brightness, haze_brightness);
+			haze = grey + (haze - grey) * fabsf((Pn.mV[VY] + 0.05f) * -20.f);
+		}
+	}
+
+	if (!mParams.mWindLightShaders)
+	{
+		// LLVOSky dropped the gamma correction meant for this step,
+		// leaving the color doubled and clamped
+		for (S32 c = 0; c < 3; ++c)
+		{
+			haze.mV[c] = llclamp(haze.mV[c] * 2.f, 0.f, 1.f);
+		}
+	}
+
+	*sky = LLColor4(haze, 0.f);
+	if (shiny)
+	{
+		const F32 brightness = haze.brightness();
+		LLColor3 shiny_color = haze * SATURATION + LLColor3(brightness, brightness, brightness) * (1.f - SATURATION);
+		shiny_color *= (0.5f + 0.5f * brightness);
+		*shiny = LLColor4(shiny_color, 0.f);
+	}
+}
+
+#if LL_SKYEVAL_SSE2
+
+static inline __m128 select_ps(__m128 mask, __m128 a, __m128 b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+// expf() for four floats, after Cephes.  Results below 2^-126 come out 0.
+static inline __m128 exp_ps(__m128 x)
+{
+	const __m128 one = _mm_set1_ps(1.f);
+	x = _mm_min_ps(x, _mm_set1_ps(88.f));
+	x = _mm_max_ps(x, _mm_set1_ps(-88.3762626647949f));
+
+	// exp(x) = 2^n exp(g), |g| <= ln(2)/2
+	__m128 fx = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(1.44269504088896341f)), _mm_set1_ps(0.5f));
+	__m128 n = _mm_cvtepi32_ps(_mm_cvttps_epi32(fx));
+	n = _mm_sub_ps(n, _mm_and_ps(_mm_cmpgt_ps(n, fx), one));
+	x = _mm_sub_ps(x, _mm_mul_ps(n, _mm_set1_ps(0.693359375f)));
+	x = _mm_sub_ps(x, _mm_mul_ps(n, _mm_set1_ps(-2.12194440e-4f)));
+
+	__m128 y = _mm_set1_ps(1.9875691500e-4f);
+	y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.3981999507e-3f));
+	y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(8.3334519073e-3f));
+	y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(4.1665795894e-2f));
+	y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.6666665459e-1f));
+	y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(5.0000001201e-1f));
+	y = _mm_add_ps(_mm_mul_ps(y, _mm_mul_ps(x, x)), _mm_add_ps(x, one));
+
+	__m128i pow2n = _mm_slli_epi32(_mm_add_epi32(_mm_cvttps_epi32(n), _mm_set1_epi32(0x7f)), 23);
+	return _mm_mul_ps(y, _mm_castsi128_ps(pow2n));
+}
+
+// logf() for four positive floats, after Cephes.
+static inline __m128 log_ps(__m128 x)
+{
+	const __m128 one = _mm_set1_ps(1.f);
+	x = _mm_max_ps(x, _mm_castsi128_ps(_mm_set1_epi32(0x00800000)));	// smallest normal
+
+	// x = m 2^e, m in [0.5, 1)
+	__m128i exponent = _mm_srli_epi32(_mm_castps_si128(x), 23);
+	x = _mm_and_ps(x, _mm_castsi128_ps(_mm_set1_epi32(~0x7f800000)));
+	x = _mm_or_ps(x, _mm_set1_ps(0.5f));
+	__m128 e = _mm_cvtepi32_ps(_mm_sub_epi32(exponent, _mm_set1_epi32(0x7e)));
+
+	// keep m near 1: m < sqrt(1/2) becomes 2m, e - 1
+	__m128 small = _mm_cmplt_ps(x, _mm_set1_ps(0.707106781186547524f));
+	e = _mm_sub_ps(e, _mm_and_ps(one, small));
+	x = _mm_add_ps(_mm_sub_ps(x, one), _mm_and_ps(x, small));
+
+	__m128 z = _mm_mul_ps(x, x);
+	__m128 y = _mm_set1_ps(7.0376836292e-2f);
+	y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(-1.1514610310e-1f));
+	y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.1676998740e-1f));
+	y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(-1.2420140846e-1f));
+	y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.4249322787e-1f));
+	y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(-1.6668057665e-1f));
+	y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(2.0000714765e-1f));
+	y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(-2.4999993993e-1f));
+	y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(3.3333331174e-1f));
+	y = _mm_mul_ps(_mm_mul_ps(y, x), z);
+	y = _mm_add_ps(y, _mm_mul_ps(e, _mm_set1_ps(-2.12194440e-4f)));
+	y = _mm_sub_ps(y, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+	x = _mm_add_ps(x, y);
+	return _mm_add_ps(x, _mm_mul_ps(e, _mm_set1_ps(0.693359375f)));
+}
+
+// evaluateOne() on four directions, one per lane
+void LLSkyEval::evaluateFour(const LLVector3* dirs, LLColor4* sky, LLColor4* shiny) const
+{
+	LL_LLV4MATH_ALIGN_PREFIX F32 in[3][4] LL_LLV4MATH_ALIGN_POSTFIX;
+	for (S32 i = 0; i < 4; ++i)
+	{
+		in[0][i] = dirs[i].mV[VX];
+		in[1][i] = dirs[i].mV[VY];
+		in[2][i] = dirs[i].mV[VZ];
+	}
+	const __m128 dir_z = _mm_load_ps(in[2]);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.f);
+
+	// undo OGL_TO_CFR_ROTATION and negate vertical direction.
+	__m128 px = _mm_sub_ps(zero, _mm_load_ps(in[1]));
+	__m128 py = _mm_sub_ps(zero, dir_z);
+	__m128 pz = _mm_sub_ps(zero, _mm_load_ps(in[0]));
+
+	// Project onto the sky dome
+	const __m128 ratio = _mm_set1_ps(mParams.mDomeOffsetRatio);
+	__m128 offset_sin = _mm_mul_ps(ratio, _mm_sqrt_ps(_mm_max_ps(zero, _mm_sub_ps(one, _mm_mul_ps(py, py)))));
+	__m128 plen = _mm_sqrt_ps(_mm_max_ps(zero, _mm_sub_ps(one, _mm_mul_ps(offset_sin, offset_sin))));
+	plen = _mm_mul_ps(_mm_add_ps(plen, _mm_mul_ps(ratio, py)), _mm_set1_ps(-mParams.mDomeRadius));
+	px = _mm_mul_ps(px, plen);
+	py = _mm_mul_ps(py, plen);
+	pz = _mm_mul_ps(pz, plen);
+
+	// Set altitude
+	__m128 altitude = select_ps(_mm_cmpgt_ps(py, zero), _mm_set1_ps(mParams.mMaxY), _mm_set1_ps(-32000.f));
+	altitude = _mm_div_ps(altitude, py);
+	px = _mm_mul_ps(px, altitude);
+	py = _mm_mul_ps(py, altitude);
+	pz = _mm_mul_ps(pz, altitude);
+	plen = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(px, px), _mm_mul_ps(py, py)), _mm_mul_ps(pz, pz)));
+	px = _mm_div_ps(px, plen);
+	py = _mm_div_ps(py, plen);
+	pz = _mm_div_ps(pz, plen);
+
+	const LLVector3& lightnorm = mParams.mLightNorm;
+	__m128 inv_y = _mm_add_ps(_mm_max_ps(zero, py), _mm_set1_ps(lightnorm.mV[VY]));
+	inv_y = _mm_div_ps(one, _mm_max_ps(_mm_set1_ps(F_APPROXIMATELY_ZERO), inv_y));
+	const __m128 distance = _mm_mul_ps(plen, _mm_set1_ps(mParams.mDensityMultiplier));
+
+	__m128 glow = _mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(lightnorm.mV[VX])), _mm_mul_ps(py, _mm_set1_ps(lightnorm.mV[VY])));
+	glow = _mm_sub_ps(one, _mm_add_ps(glow, _mm_mul_ps(pz, _mm_set1_ps(lightnorm.mV[VZ]))));
+	glow = _mm_mul_ps(_mm_max_ps(glow, _mm_set1_ps(.001f)), _mm_set1_ps(mParams.mGlow.mV[0]));
+	glow = exp_ps(_mm_mul_ps(log_ps(glow), _mm_set1_ps(mParams.mGlow.mV[2])));
+	glow = _mm_add_ps(glow, _mm_set1_ps(.25f));
+
+	const __m128 cloud_light = _mm_set1_ps(1.f - mParams.mCloudShadow);
+	__m128 haze[3];
+	for (S32 c = 0; c < 3; ++c)
+	{
+		__m128 sunlight = exp_ps(_mm_mul_ps(_mm_set1_ps(mLightAtten.mV[c] * -1.f), inv_y));
+		sunlight = _mm_mul_ps(sunlight, _mm_set1_ps(mParams.mSunlightColor.mV[c]));
+		const __m128 transparency = exp_ps(_mm_mul_ps(_mm_set1_ps(mExtinction.mV[c] * -1.f), distance));
+		const __m128 blue = _mm_set1_ps(mBlueTerm.mV[c]);
+		const __m128 haze_term = _mm_set1_ps(mHazeTerm.mV[c]);
+
+		const __m128 ambient = _mm_set1_ps(mParams.mAmbient.mV[c]);
+		__m128 above = _mm_mul_ps(blue, _mm_add_ps(sunlight, ambient));
+		above = _mm_add_ps(above, _mm_mul_ps(haze_term, _mm_add_ps(_mm_mul_ps(sunlight, glow), ambient)));
+
+		sunlight = _mm_mul_ps(sunlight, cloud_light);
+		const __m128 cloud_ambient = _mm_set1_ps(mCloudAmbient.mV[c]);
+		__m128 below = _mm_mul_ps(blue, _mm_add_ps(sunlight, cloud_ambient));
+		below = _mm_add_ps(below, _mm_mul_ps(haze_term, _mm_add_ps(_mm_mul_ps(sunlight, glow), cloud_ambient)));
+
+		above = _mm_mul_ps(above, _mm_sub_ps(one, transparency));
+		const __m128 blend = _mm_sub_ps(one, _mm_sqrt_ps(_mm_sqrt_ps(transparency)));
+		haze[c] = _mm_add_ps(above, _mm_mul_ps(_mm_sub_ps(below, above), blend));
+	}
+
+	// Below the horizon the sky fades to the ground color
+	const __m128 down = _mm_cmplt_ps(py, zero);
+	const __m128 ground = _mm_and_ps(down, _mm_cmplt_ps(py, _mm_set1_ps(-0.05f)));
+	const __m128 horizon = _mm_and_ps(down, _mm_cmpgt_ps(py, _mm_set1_ps(-0.1f)));
+	const __m128 haze_brightness = _mm_div_ps(_mm_add_ps(_mm_add_ps(haze[0], haze[1]), haze[2]), _mm_set1_ps(3.f));
+	const __m128 ground_mix = _mm_mul_ps(_mm_sub_ps(zero, py), _mm_set1_ps(0.9f));
+	__m128 horizon_mix = _mm_mul_ps(_mm_add_ps(py, _mm_set1_ps(0.05f)), _mm_set1_ps(-20.f));
+	horizon_mix = _mm_andnot_ps(_mm_set1_ps(-0.f), horizon_mix);
+	for (S32 c = 0; c < 3; ++c)
+	{
+		__m128 ground_color = _mm_set1_ps(BROWN.mV[c] - DARK_BROWN.mV[c]);
+		ground_color = _mm_add_ps(_mm_set1_ps(DARK_BROWN.mV[c]), _mm_mul_ps(ground_color, ground_mix));
+		ground_color = _mm_mul_ps(_mm_mul_ps(ground_color, _mm_set1_ps(mGroundLighting.mV[c])), haze_brightness);
+		haze[c] = select_ps(ground, ground_color, haze[c]);
+
+		const __m128 faded = _mm_add_ps(haze_brightness, _mm_mul_ps(_mm_sub_ps(haze[c], haze_brightness), horizon_mix));
+		haze[c] = select_ps(horizon, faded, haze[c]);
+
+		if (!mParams.mWindLightShaders)
+		{
+			haze[c] = _mm_min_ps(_mm_max_ps(_mm_add_ps(haze[c], haze[c]), zero), one);
+		}
+	}
+
+	// Fog color for directions below the horizon
+	const __m128 fog = _mm_cmplt_ps(dir_z, _mm_set1_ps(-0.02f));
+	__m128 fade = _mm_sub_ps(_mm_set1_ps(-0.1f), dir_z);
+	fade = _mm_sub_ps(one, _mm_andnot_ps(_mm_set1_ps(-0.f), fade));
+	fade = _mm_mul_ps(fade, fade);
+	const __m128 fade_sq = _mm_mul_ps(fade, fade);
+	const __m128 fades[3] = { fade_sq, _mm_mul_ps(fade_sq, _mm_sqrt_ps(fade)), _mm_mul_ps(fade_sq, fade) };
+
+	LL_LLV4MATH_ALIGN_PREFIX F32 out[2][3][4] LL_LLV4MATH_ALIGN_POSTFIX;
+	const __m128 brightness = _mm_div_ps(_mm_add_ps(_mm_add_ps(haze[0], haze[1]), haze[2]), _mm_set1_ps(3.f));
+	const __m128 grey = _mm_mul_ps(brightness, _mm_set1_ps(1.f - SATURATION));
+	const __m128 shiny_scale = _mm_add_ps(_mm_set1_ps(0.5f), _mm_mul_ps(_mm_set1_ps(0.5f), brightness));
+	for (S32 c = 0; c < 3; ++c)
+	{
+		_mm_store_ps(out[0][c], select_ps(fog, _mm_mul_ps(_mm_set1_ps(mFogSky.mV[c]), fades[c]), haze[c]));
+
+		__m128 shiny_color = _mm_add_ps(_mm_mul_ps(haze[c], _mm_set1_ps(SATURATION)), grey);
+		shiny_color = _mm_mul_ps(shiny_color, shiny_scale);
+		_mm_store_ps(out[1][c], select_ps(fog, _mm_mul_ps(_mm_set1_ps(mFogShiny.mV[c]), fades[c]), shiny_color));
+	}
+
+	for (S32 i = 0; i < 4; ++i)
+	{
+		sky[i].set(out[0][0][i], out[0][1][i], out[0][2][i], 0.f);
+	}
+	if (shiny)
+	{
+		for (S32 i = 0; i < 4; ++i)
+		{
+			shiny[i].set(out[1][0][i], out[1][1][i], out[1][2][i], 0.f);
+		}
+	}
+}
+
+#endif // LL_SKYEVAL_SSE2
@@ -0,0 +1,96 @@
+/**
+ * @file llskyeval.h
+ * @brief Batched evaluation of the WindLight sky color model.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#ifndef LL_LLSKYEVAL_H
+#define LL_LLSKYEVAL_H
+
+#include "v3color.h"
+#include "v3math.h"
+#include "v4color.h"
+
+// The sky colors LLVOSky bakes into its sky and shiny cube maps, worked
+// out for many directions at a time.  This is the model of
+// LLVOSky::calcSkyColorInDir(): the WindLight sky vertex shader run on
+// the CPU.  Each direction is evaluated once for both textures, and
+// where LL_VECTORIZE four directions go through together.  evaluate()
+// only reads the parameters, so several threads can share one LLSkyEval.
+class LLSkyEval
+{
+public:
+	// The WindLight parameters LLVOSky::initAtmospherics() reads
+	struct Params
+	{
+		F32 mDomeRadius;
+		F32 mDomeOffsetRatio;
+		LLColor3 mSunlightColor;
+		LLColor3 mAmbient;
+		LLColor3 mBlueDensity;
+		LLColor3 mBlueHorizon;
+		F32 mHazeDensity;
+		F32 mHazeHorizon;
+		F32 mDensityMultiplier;
+		F32 mMaxY;
+		LLColor3 mGlow;
+		F32 mCloudShadow;
+		LLVector3 mLightNorm;		// GL axes, y clamped to -0.1 or above
+		LLColor3 mFogColor;			// below the horizon
+		bool mWindLightShaders;		// the sky is drawn by the WindLight shaders
+	};
+
+	LLSkyEval();
+
+	void setParams(const Params& params);
+	const Params& getParams() const { return mParams; }
+
+	// Sky and shiny colors for count directions, which must be
+	// normalized.  shiny may be NULL.
+	void evaluate(const LLVector3* dirs, S32 count, LLColor4* sky, LLColor4* shiny) const;
+
+private:
+	void evaluateOne(const LLVector3& dir, LLColor4* sky, LLColor4* shiny) const;
+	void evaluateFour(const LLVector3* dirs, LLColor4* sky, LLColor4* shiny) const;
+
+	Params mParams;
+
+	// Direction independent terms
+	LLColor3 mLightAtten;
+	LLColor3 mExtinction;		// blue density + haze density
+	LLColor3 mBlueTerm;			// blue horizon * blue weight
+	LLColor3 mHazeTerm;			// haze horizon * haze weight
+	LLColor3 mCloudAmbient;		// ambient raised by cloud shadow
+	LLColor3 mGroundLighting;	// sunlight through the atmosphere + ambient
+	LLColor3 mFogSky;
+	LLColor3 mFogShiny;
+};
+
+#endif // LL_LLSKYEVAL_H
@@ -0,0 +1,237 @@
+/**
+ * @file llterrainblend.cpp
+ * @brief Terrain surface texture compositing from the four detail textures.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#include "linden_common.h"
+
+#include "llterrainblend.h"
+
+#include "llmath.h"
+#include "llv4math.h"
+
+// Where LLViewerLayer::getValueScaled() samples for one coordinate
+static inline void comp_sample(F32 pos, F32 scale_inv, S32 width, S32& p1, S32& p2, F32& frac)
+{
+	frac = pos*scale_inv;
+	p1 = llfloor(frac);
+	p2 = p1 + 1;
+	frac -= p1;
+
+	p1 = llmin(width-1, p1);
+	p1 = llmax(0, p1);
+	p2 = llmin(width-1, p2);
+	p2 = llmax(0, p2);
+}
+
+// static
+void LLTerrainBlend::getCompositionBounds(const Params& params, S32 x_begin, S32 y_begin, S32 x_end, S32 y_end,
+										  S32& comp_x_begin, S32& comp_y_begin, S32& comp_x_end, S32& comp_y_end)
+{
+	// Samples only move forward with the texel, so the first and last say it all
+	S32 p1, p2;
+	F32 frac;
+	comp_sample(x_begin*params.mTexRatioX, params.mCompScaleInv, params.mCompWidth, p1, p2, frac);
+	comp_x_begin = p1;
+	comp_sample((x_end-1)*params.mTexRatioX, params.mCompScaleInv, params.mCompWidth, p1, p2, frac);
+	comp_x_end = p2 + 1;
+
+	comp_sample(y_begin*params.mTexRatioY, params.mCompScaleInv, params.mCompWidth, p1, p2, frac);
+	comp_y_begin = p1;
+	comp_sample((y_end-1)*params.mTexRatioY, params.mCompScaleInv, params.mCompWidth, p1, p2, frac);
+	comp_y_end = p2 + 1;
+}
+
+void LLTerrainBlend::setupColumns(const Params& params, S32 x_begin, S32 x_end)
+{
+	const S32 count = x_end - x_begin;
+	mCompX1.resize(count);
+	mCompX2.resize(count);
+	mCompXFrac.resize(count);
+	mDetailOffset.resize(count);
+
+	const S32 st_width = params.mDetailSize;
+	F32 sti = (x_begin * params.mDetailStrideX) - st_width*((U32)(x_begin * params.mDetailStrideX)/st_width);
+	for (S32 c = 0; c < count; c++)
+	{
+		S32 x1, x2;
+		comp_sample((x_begin + c)*params.mTexRatioX, params.mCompScaleInv, params.mCompWidth, x1, x2, mCompXFrac[c]);
+		mCompX1[c] = x1 - params.mCompX;
+		mCompX2[c] = x2 - params.mCompX;
+
+		mDetailOffset[c] = lltrunc(sti) * COMPONENTS;
+		sti += params.mDetailStrideX;
+		if (sti >= st_width)
+		{
+			sti -= st_width;
+		}
+	}
+}
+
+// One texel, exactly as the old per texel loop
+static inline void blend_texel(const LLTerrainBlend::Params& params, F32 composition, S32 st_offset, U8* out)
+{
+	S32 tex0 = llfloor(composition);
+	tex0 = llclamp(tex0, 0, 3);
+	composition -= tex0;
+	S32 tex1 = tex0 + 1;
+	tex1 = llclamp(tex1, 0, 3);
+
+	for (S32 k = 0; k < LLTerrainBlend::COMPONENTS; k++)
+	{
+		if (st_offset < params.mDetailDataSize[tex0] && st_offset < params.mDetailDataSize[tex1])
+		{
+			F32 a = params.mDetail[tex0][st_offset];
+			F32 b = params.mDetail[tex1][st_offset];
+			out[k] = (U8)lltrunc(a + composition * (b - a));
+		}
+		st_offset++;
+	}
+}
+
+void LLTerrainBlend::blend(const Params& params, S32 x_begin, S32 y_begin, S32 x_end, S32 y_end,
+						   U8* out, S32 out_stride)
+{
+	if (x_end <= x_begin || y_end <= y_begin)
+	{
+		return;
+	}
+	setupColumns(params, x_begin, x_end);
+
+	const S32 count = x_end - x_begin;
+	const S32* x1 = &mCompX1[0];
+	const S32* x2 = &mCompX2[0];
+	const F32* x_frac = &mCompXFrac[0];
+	const S32* detail_offset = &mDetailOffset[0];
+	const S32 min_data_size = llmin(llmin(params.mDetailDataSize[0], params.mDetailDataSize[1]),
+									llmin(params.mDetailDataSize[2], params.mDetailDataSize[3]));
+
+	const S32 st_width = params.mDetailSize;
+	const S32 st_height = params.mDetailSize;
+	F32 stj = (y_begin * params.mDetailStrideY) - st_height*(llfloor((y_begin * params.mDetailStrideY)/st_height));
+
+	for (S32 j = y_begin; j < y_end; j++)
+	{
+		S32 y1, y2;
+		F32 y_frac;
+		comp_sample(j*params.mTexRatioY, params.mCompScaleInv, params.mCompWidth, y1, y2, y_frac);
+		const F32* row1 = params.mComposition + (y1 - params.mCompY)*params.mCompRowLength;
+		const F32* row2 = params.mComposition + (y2 - params.mCompY)*params.mCompRowLength;
+		const S32 row_offset = lltrunc(stj)*st_width*COMPONENTS;
+		U8* out_row = out + (j - y_begin)*out_stride;
+
+		S32 c = 0;
+#if LL_VECTORIZE
+		LL_LLV4MATH_ALIGN_PREFIX F32 composition[4] LL_LLV4MATH_ALIGN_POSTFIX;
+		LL_LLV4MATH_ALIGN_PREFIX F32 a[12] LL_LLV4MATH_ALIGN_POSTFIX;
+		LL_LLV4MATH_ALIGN_PREFIX F32 b[12] LL_LLV4MATH_ALIGN_POSTFIX;
+		LL_LLV4MATH_ALIGN_PREFIX F32 frac[12] LL_LLV4MATH_ALIGN_POSTFIX;
+		LL_LLV4MATH_ALIGN_PREFIX F32 result[12] LL_LLV4MATH_ALIGN_POSTFIX;
+		const __m128 y_frac4 = _mm_set1_ps(y_frac);
+		for (; c + 4 <= count; c += 4)
+		{
+			// Bilinear composition of four columns
+			const __m128 xf = _mm_loadu_ps(x_frac + c);
+			const __m128 row1_left = _mm_set_ps(row1[x1[c+3]], row1[x1[c+2]], row1[x1[c+1]], row1[x1[c]]);
+			const __m128 row1_right = _mm_set_ps(row1[x2[c+3]], row1[x2[c+2]], row1[x2[c+1]], row1[x2[c]]);
+			const __m128 row2_left = _mm_set_ps(row2[x1[c+3]], row2[x1[c+2]], row2[x1[c+1]], row2[x1[c]]);
+			const __m128 row2_right = _mm_set_ps(row2[x2[c+3]], row2[x2[c+2]], row2[x2[c+1]], row2[x2[c]]);
+			const __m128 row1_interp = _mm_sub_ps(row1_left, _mm_mul_ps(xf, _mm_sub_ps(row1_left, row1_right)));
+			const __m128 row2_interp = _mm_sub_ps(row2_left, _mm_mul_ps(xf, _mm_sub_ps(row2_left, row2_right)));
+			_mm_store_ps(composition, _mm_sub_ps(row1_interp, _mm_mul_ps(y_frac4, _mm_sub_ps(row1_interp, row2_interp))));
+
+			bool in_range = true;
+			for (S32 t = 0; t < 4; t++)
+			{
+				in_range = in_range && (row_offset + detail_offset[c+t] + COMPONENTS <= min_data_size);
+			}
+			if (!in_range)
+			{
+				// Rounding error at the edge of a detail texture
+				for (S32 t = 0; t < 4; t++)
+				{
+					blend_texel(params, composition[t], row_offset + detail_offset[c+t], out_row + (c+t)*COMPONENTS);
+				}
+				continue;
+			}
+
+			// Gather the two detail texels of each column
+			for (S32 t = 0; t < 4; t++)
+			{
+				S32 tex0 = llfloor(composition[t]);
+				tex0 = llclamp(tex0, 0, 3);
+				S32 tex1 = tex0 + 1;
+				tex1 = llclamp(tex1, 0, 3);
+				const F32 weight = composition[t] - tex0;
+				const U8* texel0 = params.mDetail[tex0] + row_offset + detail_offset[c+t];
+				const U8* texel1 = params.mDetail[tex1] + row_offset + detail_offset[c+t];
+				for (S32 k = 0; k < COMPONENTS; k++)
+				{
+					a[t*COMPONENTS + k] = texel0[k];
+					b[t*COMPONENTS + k] = texel1[k];
+					frac[t*COMPONENTS + k] = weight;
+				}
+			}
+
+			// And blend the four texels' twelve components
+			for (S32 v = 0; v < 12; v += 4)
+			{
+				const __m128 a4 = _mm_load_ps(a + v);
+				const __m128 b4 = _mm_load_ps(b + v);
+				const __m128 frac4 = _mm_load_ps(frac + v);
+				_mm_store_ps(result + v, _mm_add_ps(a4, _mm_mul_ps(frac4, _mm_sub_ps(b4, a4))));
+			}
+			U8* texels = out_row + c*COMPONENTS;
+			for (S32 v = 0; v < 12; v++)
+			{
+				texels[v] = (U8)lltrunc(result[v]);
+			}
+		}
+#endif
+		for (; c < count; c++)
+		{
+			const F32 row1_left = row1[x1[c]];
+			const F32 row1_right = row1[x2[c]];
+			const F32 row2_left = row2[x1[c]];
+			const F32 row2_right = row2[x2[c]];
+			const F32 row1_interp = row1_left - x_frac[c] * (row1_left - row1_right);
+			const F32 row2_interp = row2_left - x_frac[c] * (row2_left - row2_right);
+			const F32 composition = row1_interp - y_frac * (row1_interp - row2_interp);
+			blend_texel(params, composition, row_offset + detail_offset[c], out_row + c*COMPONENTS);
+		}
+
+		stj += params.mDetailStrideY;
+		if (stj >= st_height)
+		{
+			stj -= st_height;
+		}
+	}
+}
@@ -0,0 +1,92 @@
+/**
+ * @file llterrainblend.h
+ * @brief Terrain surface texture compositing from the four detail textures.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#ifndef LL_LLTERRAINBLEND_H
+#define LL_LLTERRAINBLEND_H
+
+#include <vector>
+
+// Composites the terrain surface texture from the four detail textures,
+// as LLVLComposition::generateTexture() used to one texel at a time.
+// Which composition values and which detail texel a column reads is the
+// same on every row, so that is worked out once per call; where
+// LL_VECTORIZE the composition lookup and the blend are then done four
+// texels at a time.  The texels come out the same either way.
+class LLTerrainBlend
+{
+public:
+	enum
+	{
+		NUM_DETAILS = 4,
+		COMPONENTS = 3
+	};
+
+	struct Params
+	{
+		const U8* mDetail[NUM_DETAILS];		// mDetailSize square, COMPONENTS per texel
+		S32 mDetailDataSize[NUM_DETAILS];	// bytes; texels past the end are skipped
+		S32 mDetailSize;
+		F32 mDetailStrideX;					// detail texels per output texel
+		F32 mDetailStrideY;
+
+		const F32* mComposition;			// 0-3, the detail texture to use
+		S32 mCompX;							// grid point mComposition starts at
+		S32 mCompY;
+		S32 mCompRowLength;					// values per row of mComposition
+		S32 mCompWidth;						// width of the whole composition grid
+		F32 mCompScaleInv;					// grid points per meter
+		F32 mTexRatioX;						// meters per output texel
+		F32 mTexRatioY;
+	};
+
+	// The composition grid points blend() reads for the texels from
+	// x_begin, y_begin up to x_end, y_end, up to comp_x_end, comp_y_end.
+	static void getCompositionBounds(const Params& params, S32 x_begin, S32 y_begin, S32 x_end, S32 y_end,
+									 S32& comp_x_begin, S32& comp_y_begin, S32& comp_x_end, S32& comp_y_end);
+
+	// Writes the texels from x_begin, y_begin up to x_end, y_end.  out is
+	// texel x_begin, y_begin and its rows are out_stride bytes apart.
+	void blend(const Params& params, S32 x_begin, S32 y_begin, S32 x_end, S32 y_end,
+			   U8* out, S32 out_stride);
+
+private:
+	void setupColumns(const Params& params, S32 x_begin, S32 x_end);
+
+	// Per column
+	std::vector<S32> mCompX1;
+	std::vector<S32> mCompX2;
+	std::vector<F32> mCompXFrac;
+	std::vector<S32> mDetailOffset;
+};
+
+#endif // LL_LLTERRAINBLEND_H
@@ -32,6 +32,7 @@
 #include "linden_common.h"
 #include "llmath.h"
 
+#include <algorithm>
 #include <set>
 
 #include "llerror.h"
@@ -85,6 +86,10 @@ const F32 SKEW_MAX	=  0.95f;
 
 const F32 SCULPT_MIN_AREA = 0.002f;
 
+// Faces with no more triangles than this are tested triangle by triangle
+const U32 BVH_LEAF_SIZE = 4;
+const U32 BVH_MAX_DEPTH = 64;
+
 BOOL check_same_clock_dir( const LLVector3& pt1, const LLVector3& pt2, const LLVector3& pt3, const LLVector3& norm)
 {    
 	LLVector3 test = (pt2-pt1)%(pt3-pt2);
@@ -1661,7 +1666,7 @@ LLProfile::~LLProfile()
 }
 
 
-S32 LLVolume::sNumMeshPoints = 0;
+LLAtomicS32 LLVolume::sNumMeshPoints(0);
 
 LLVolume::LLVolume(const LLVolumeParams &params, const F32 detail, const BOOL generate_single_face, const BOOL is_unique)
 	: mParams(params)
@@ -1710,6 +1715,18 @@ void LLVolume::genBinormals(S32 face)
 	mVolumeFaces[face].createBinormals();
 }
 
+void LLVolume::swapGeometry(LLVolume& volume)
+{
+	llassert(mParams == volume.mParams && mDetail == volume.mDetail);
+	std::swap(mPathp, volume.mPathp);
+	std::swap(mProfilep, volume.mProfilep);
+	mMesh.swap(volume.mMesh);
+	mVolumeFaces.swap(volume.mVolumeFaces);
+	std::swap(mFaceMask, volume.mFaceMask);
+	std::swap(mLODScaleBias, volume.mLODScaleBias);
+	std::swap(mSculptLevel, volume.mSculptLevel);
+}
+
 LLVolume::~LLVolume()
 {
 	sNumMeshPoints -= mMesh.size();
@@ -3597,7 +3614,7 @@ S32 LLVolume::lineSegmentIntersect(const LLVector3& start, const LLVector3& end,
 	
 	for (S32 i = start_face; i <= end_face; i++)
 	{
-		const LLVolumeFace &face = getVolumeFace((U32)i);
+		LLVolumeFace &face = mVolumeFaces[i];
 
 		LLVector3 box_center = (face.mExtents[0] + face.mExtents[1]) / 2.f;
 		LLVector3 box_size   = face.mExtents[1] - face.mExtents[0];
@@ -3608,55 +3625,41 @@ S32 LLVolume::lineSegmentIntersect(const LLVector3& start, const LLVector3& end,
 			{
 				genBinormals(i);
 			}
-			
-			for (U32 tri = 0; tri < face.mIndices.size()/3; tri++) 
-			{
-				S32 index1 = face.mIndices[tri*3+0];
-				S32 index2 = face.mIndices[tri*3+1];
-				S32 index3 = face.mIndices[tri*3+2];
 
-				F32 a, b, t;
-			
-				if (LLTriangleRayIntersect(face.mVertices[index1].mPosition,
-										   face.mVertices[index2].mPosition,
-										   face.mVertices[index3].mPosition,
-										   start, dir, &a, &b, &t, FALSE))
-				{
-					if ((t >= 0.f) &&      // if hit is after start
-						(t <= 1.f) &&      // and before end
-						(t < closest_t))   // and this hit is closer
-		{
-						closest_t = t;
-						hit_face = i;
-
-						if (intersection != NULL)
-						{
-							*intersection = start + dir * closest_t;
-						}
-			
-						if (tex_coord != NULL)
+			S32 hit_index;
+			F32 a, b;
+			if (face.lineSegmentIntersect(start, dir, closest_t, hit_index, a, b))
 			{
-							*tex_coord = ((1.f - a - b)  * face.mVertices[index1].mTexCoord +
-										  a              * face.mVertices[index2].mTexCoord +
-										  b              * face.mVertices[index3].mTexCoord);
+				hit_face = i;
 
-						}
+				const LLVolumeFace::VertexData& v1 = face.mVertices[face.mIndices[hit_index+0]];
+				const LLVolumeFace::VertexData& v2 = face.mVertices[face.mIndices[hit_index+1]];
+				const LLVolumeFace::VertexData& v3 = face.mVertices[face.mIndices[hit_index+2]];
 
-						if (normal != NULL)
+				if (intersection != NULL)
 				{
-							*normal    = ((1.f - a - b)  * face.mVertices[index1].mNormal + 
-										  a              * face.mVertices[index2].mNormal +
-										  b              * face.mVertices[index3].mNormal);
-						}
+					*intersection = start + dir * closest_t;
+				}
 
-						if (bi_normal != NULL)
-					{
-							*bi_normal = ((1.f - a - b)  * face.mVertices[index1].mBinormal + 
-										  a              * face.mVertices[index2].mBinormal +
-										  b              * face.mVertices[index3].mBinormal);
-						}
+				if (tex_coord != NULL)
+				{
+					*tex_coord = ((1.f - a - b)  * v1.mTexCoord +
+								  a              * v2.mTexCoord +
+								  b              * v3.mTexCoord);
+				}
 
-					}
+				if (normal != NULL)
+				{
+					*normal    = ((1.f - a - b)  * v1.mNormal + 
+								  a              * v2.mNormal +
+								  b              * v3.mNormal);
+				}
+
+				if (bi_normal != NULL)
+				{
+					*bi_normal = ((1.f - a - b)  * v1.mBinormal + 
+								  a              * v2.mBinormal +
+								  b              * v3.mBinormal);
 				}
 			}
 		}		
@@ -4401,6 +4404,9 @@ std::ostream& operator<<(std::ostream &s, const LLVolume *volumep)
 
 BOOL LLVolumeFace::create(LLVolume* volume, BOOL partial_build)
 {
+	// Any change of the vertices invalidates the hierarchy
+	clearBVH();
+
 	if (mTypeMask & CAP_MASK)
 	{
 		return createCap(volume, partial_build);
@@ -4416,6 +4422,234 @@ BOOL LLVolumeFace::create(LLVolume* volume, BOOL partial_build)
 	}
 }
 
+//static
+BOOL LLVolumeFace::sUseBVH = TRUE;
+
+BOOL LLVolumeFace::intersectTriangle(U32 tri, const LLVector3& start, const LLVector3& dir,
+									 F32& closest_t, S32& hit_index, F32& hit_a, F32& hit_b) const
+{
+	S32 index = tri * 3;
+	F32 a, b, t;
+	if (LLTriangleRayIntersect(mVertices[mIndices[index+0]].mPosition,
+							   mVertices[mIndices[index+1]].mPosition,
+							   mVertices[mIndices[index+2]].mPosition,
+							   start, dir, &a, &b, &t, FALSE))
+	{
+		if ((t >= 0.f) &&      // if hit is after start
+			(t <= 1.f) &&      // and before end
+			(t < closest_t))   // and this hit is closer
+		{
+			closest_t = t;
+			hit_index = index;
+			hit_a = a;
+			hit_b = b;
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+// Slab test of the segment against a node's box, clipped to [0, max_t]
+static inline BOOL bvh_box_intersect(const LLVector3& min, const LLVector3& max,
+									 const LLVector3& start, const LLVector3& inv_dir,
+									 F32 max_t, F32& enter_t)
+{
+	F32 t0 = 0.f;
+	F32 t1 = max_t;
+	for (U32 i = 0; i < 3; i++)
+	{
+		if (inv_dir.mV[i] == 0.f)
+		{
+			// parallel to this slab
+			if (start.mV[i] < min.mV[i] || start.mV[i] > max.mV[i])
+			{
+				return FALSE;
+			}
+			continue;
+		}
+		F32 near_t = (min.mV[i] - start.mV[i]) * inv_dir.mV[i];
+		F32 far_t = (max.mV[i] - start.mV[i]) * inv_dir.mV[i];
+		if (near_t > far_t)
+		{
+			std::swap(near_t, far_t);
+		}
+		t0 = llmax(t0, near_t);
+		t1 = llmin(t1, far_t);
+		if (t0 > t1)
+		{
+			return FALSE;
+		}
+	}
+	enter_t = t0;
+	return TRUE;
+}
+
+BOOL LLVolumeFace::lineSegmentIntersect(const LLVector3& start, const LLVector3& dir,
+										F32& closest_t, S32& hit_index, F32& hit_a, F32& hit_b)
+{
+	U32 num_triangles = mIndices.size() / 3;
+	BOOL hit = FALSE;
+
+	if (!sUseBVH || num_triangles <= BVH_LEAF_SIZE)
+	{
+		for (U32 tri = 0; tri < num_triangles; tri++)
+		{
+			hit |= intersectTriangle(tri, start, dir, closest_t, hit_index, hit_a, hit_b);
+		}
+		return hit;
+	}
+
+	if (mBVHNodes.empty())
+	{
+		buildBVH();
+	}
+
+	LLVector3 inv_dir;
+	for (U32 i = 0; i < 3; i++)
+	{
+		inv_dir.mV[i] = (dir.mV[i] != 0.f) ? 1.f / dir.mV[i] : 0.f;
+	}
+
+	// Depth first, nearer child first, skipping boxes beyond the closest hit
+	U32 stack[BVH_MAX_DEPTH * 2];
+	U32 stack_size = 0;
+	stack[stack_size++] = 0;
+	while (stack_size)
+	{
+		U32 node_index = stack[--stack_size];
+		const BVHNode& node = mBVHNodes[node_index];
+		F32 enter_t;
+		if (!bvh_box_intersect(node.mMin, node.mMax, start, inv_dir, llmin(closest_t, 1.f), enter_t))
+		{
+			continue;
+		}
+
+		if (node.mCount)
+		{
+			for (U32 i = node.mFirst; i < node.mFirst + node.mCount; i++)
+			{
+				hit |= intersectTriangle(mBVHTriangles[i], start, dir, closest_t, hit_index, hit_a, hit_b);
+			}
+			continue;
+		}
+
+		U32 left = node_index + 1;
+		U32 right = node.mRight;
+		F32 left_t, right_t;
+		BOOL hit_left = bvh_box_intersect(mBVHNodes[left].mMin, mBVHNodes[left].mMax, start, inv_dir, llmin(closest_t, 1.f), left_t);
+		BOOL hit_right = bvh_box_intersect(mBVHNodes[right].mMin, mBVHNodes[right].mMax, start, inv_dir, llmin(closest_t, 1.f), right_t);
+		if (hit_left && hit_right)
+		{
+			if (left_t <= right_t)
+			{
+				stack[stack_size++] = right;
+				stack[stack_size++] = left;
+			}
+			else
+			{
+				stack[stack_size++] = left;
+				stack[stack_size++] = right;
+			}
+		}
+		else if (hit_left)
+		{
+			stack[stack_size++] = left;
+		}
+		else if (hit_right)
+		{
+			stack[stack_size++] = right;
+		}
+	}
+
+	return hit;
+}
+
+// Orders triangles by their center along one axis
+class LLBVHCenterLess
+{
+public:
+	LLBVHCenterLess(const std::vector<LLVector3>& centers, U32 axis)
+		: mCenters(centers), mAxis(axis) { }
+	bool operator()(U32 a, U32 b) const
+	{
+		return mCenters[a].mV[mAxis] < mCenters[b].mV[mAxis];
+	}
+private:
+	const std::vector<LLVector3>& mCenters;
+	U32 mAxis;
+};
+
+void LLVolumeFace::buildBVH()
+{
+	U32 num_triangles = mIndices.size() / 3;
+	std::vector<LLVector3> centers(num_triangles);
+	mBVHTriangles.resize(num_triangles);
+	for (U32 tri = 0; tri < num_triangles; tri++)
+	{
+		mBVHTriangles[tri] = tri;
+		centers[tri] = (mVertices[mIndices[tri*3+0]].mPosition +
+						mVertices[mIndices[tri*3+1]].mPosition +
+						mVertices[mIndices[tri*3+2]].mPosition) / 3.f;
+	}
+	mBVHNodes.clear();
+	mBVHNodes.reserve(2 * (num_triangles / BVH_LEAF_SIZE + 1));
+	buildBVHNode(0, num_triangles, centers);
+}
+
+// Median split along the longest axis of the triangle centers.  Halving
+// the triangle count bounds the depth well below BVH_MAX_DEPTH.
+U32 LLVolumeFace::buildBVHNode(U32 first, U32 count, const std::vector<LLVector3>& centers)
+{
+	U32 node_index = mBVHNodes.size();
+	mBVHNodes.push_back(BVHNode());
+
+	LLVector3 min = mVertices[mIndices[mBVHTriangles[first]*3]].mPosition;
+	LLVector3 max = min;
+	LLVector3 center_min = centers[mBVHTriangles[first]];
+	LLVector3 center_max = center_min;
+	for (U32 i = first; i < first + count; i++)
+	{
+		U32 tri = mBVHTriangles[i];
+		for (U32 j = 0; j < 3; j++)
+		{
+			update_min_max(min, max, mVertices[mIndices[tri*3+j]].mPosition);
+		}
+		update_min_max(center_min, center_max, centers[tri]);
+	}
+	// Pad the box so rounding in the slab test never loses a hit on its faces
+	LLVector3 pad = (max - min) * 0.0001f + LLVector3(0.00001f, 0.00001f, 0.00001f);
+	mBVHNodes[node_index].mMin = min - pad;
+	mBVHNodes[node_index].mMax = max + pad;
+	mBVHNodes[node_index].mFirst = first;
+	mBVHNodes[node_index].mCount = count;
+	mBVHNodes[node_index].mRight = 0;
+
+	LLVector3 size = center_max - center_min;
+	U32 axis = 0;
+	if (size.mV[1] > size.mV[axis])
+	{
+		axis = 1;
+	}
+	if (size.mV[2] > size.mV[axis])
+	{
+		axis = 2;
+	}
+	if (count <= BVH_LEAF_SIZE || size.mV[axis] <= 0.f)
+	{
+		return node_index;
+	}
+
+	U32 mid = first + count / 2;
+	std::nth_element(mBVHTriangles.begin() + first, mBVHTriangles.begin() + mid,
+					 mBVHTriangles.begin() + first + count, LLBVHCenterLess(centers, axis));
+
+	buildBVHNode(first, mid - first, centers);
+	U32 right = buildBVHNode(mid, first + count - mid, centers);
+	mBVHNodes[node_index].mCount = 0;
+	mBVHNodes[node_index].mRight = right;
+	return node_index;
+}
+
 void	LerpPlanarVertex(LLVolumeFace::VertexData& v0,
 				   LLVolumeFace::VertexData& v1,
 				   LLVolumeFace::VertexData& v2,
@@ -54,6 +54,7 @@ class LLVolume;
 #include "v4coloru.h"
 #include "llmemory.h"
 #include "llfile.h"
+#include "llapr.h"
 
 //============================================================================
 
@@ -802,6 +803,16 @@ public:
 	BOOL create(LLVolume* volume, BOOL partial_build = FALSE);
 	void createBinormals();
 
+	// Finds the closest front facing triangle hit by start + t * dir with
+	// t in [0, 1] and t < closest_t.  On a hit, returns TRUE with closest_t,
+	// the triangle's first index in mIndices and the barycentric coordinates
+	// of the hit.  Uses a bounding volume hierarchy built on first use.
+	BOOL lineSegmentIntersect(const LLVector3& start, const LLVector3& dir,
+							  F32& closest_t, S32& hit_index, F32& hit_a, F32& hit_b);
+	void clearBVH()							{ mBVHNodes.clear(); mBVHTriangles.clear(); }
+
+	static BOOL sUseBVH; // FALSE tests every triangle, for comparison
+
 	class VertexData
 	{
 	public:
@@ -848,6 +859,23 @@ private:
 	BOOL createUnCutCubeCap(LLVolume* volume, BOOL partial_build = FALSE);
 	BOOL createCap(LLVolume* volume, BOOL partial_build = FALSE);
 	BOOL createSide(LLVolume* volume, BOOL partial_build = FALSE);
+
+	struct BVHNode
+	{
+		LLVector3 mMin;
+		LLVector3 mMax;
+		U32 mFirst;		// into mBVHTriangles
+		U32 mCount;		// 0 for inner nodes, whose left child is the next node
+		U32 mRight;		// right child of inner nodes
+	};
+
+	void buildBVH();
+	U32 buildBVHNode(U32 first, U32 count, const std::vector<LLVector3>& centers);
+	BOOL intersectTriangle(U32 tri, const LLVector3& start, const LLVector3& dir,
+						   F32& closest_t, S32& hit_index, F32& hit_a, F32& hit_b) const;
+
+	std::vector<BVHNode> mBVHNodes;
+	std::vector<U32> mBVHTriangles;	// triangle numbers in leaf order
 };
 
 class LLVolume : public LLRefCount
@@ -893,6 +921,10 @@ public:
 	void regen();
 	void genBinormals(S32 face);
 
+	// Exchanges generated geometry with volume, which must have the same
+	// params and detail.  Used to swap in a volume built off the main thread.
+	void swapGeometry(LLVolume& volume);
+
 	BOOL isConvex() const;
 	BOOL isCap(S32 face);
 	BOOL isFlat(S32 face);
@@ -938,7 +970,8 @@ public:
 	LLFaceID generateFaceMask();
 
 	BOOL isFaceMaskValid(LLFaceID face_mask);
-	static S32 sNumMeshPoints;
+	// Updated from the volume build thread too
+	static LLAtomicS32 sNumMeshPoints;
 
 	friend std::ostream& operator<<(std::ostream &s, const LLVolume &volume);
 	friend std::ostream& operator<<(std::ostream &s, const LLVolume *volumep);		// HACK to bypass Windoze confusion over 
@@ -33,6 +33,7 @@
 
 #include "llvolumemgr.h"
 #include "llmemtype.h"
+#include "lltimer.h"
 #include "llvolume.h"
 
 
@@ -48,10 +49,127 @@ F32 LLVolumeLODGroup::mDetailThresholds[NUM_LODS] = {BASE_THRESHOLD,
 F32 LLVolumeLODGroup::mDetailScales[NUM_LODS] = {1.f, 1.5f, 2.5f, 4.f};
 
 
+//============================================================================
+
+// Builds volumes for LLVolumeMgr.  Every request builds its own LLVolume,
+// so the worker never touches a volume the main thread can see.
+class LLVolumeBuildQueue : public LLQueuedThread
+{
+public:
+	class BuildRequest : public LLQueuedThread::QueuedRequest
+	{
+	protected:
+		~BuildRequest() {} // use deleteRequest()
+
+	public:
+		BuildRequest(handle_t handle, const LLVolumeParams& volume_params, S32 detail,
+					 U16 sculpt_width, U16 sculpt_height, S8 sculpt_components,
+					 const U8* sculpt_data, S32 sculpt_level);
+
+		/*virtual*/ bool processRequest();
+
+		// Main thread, once the request is complete.  The volume must be
+		// taken before completeRequest() so that it is released here rather
+		// than on the worker.
+		LLPointer<LLVolume> takeVolume();
+		F32 getBuildTime() const { return mBuildTime; }
+		bool isSameSculpt(U16 sculpt_width, U16 sculpt_height, S8 sculpt_components, S32 sculpt_level) const
+		{
+			return mSculptWidth == sculpt_width && mSculptHeight == sculpt_height &&
+				mSculptComponents == sculpt_components && mSculptLevel == sculpt_level;
+		}
+
+	private:
+		LLVolumeParams mParams;
+		S32 mDetail;
+		U16 mSculptWidth;
+		U16 mSculptHeight;
+		S8 mSculptComponents;
+		std::vector<U8> mSculptData;
+		S32 mSculptLevel;
+		LLPointer<LLVolume> mVolume;
+		F32 mBuildTime;
+	};
+
+	LLVolumeBuildQueue(bool threaded)
+		: LLQueuedThread("Volume build", threaded)
+	{
+	}
+
+	handle_t build(const LLVolumeParams& volume_params, S32 detail,
+				   U16 sculpt_width, U16 sculpt_height, S8 sculpt_components,
+				   const U8* sculpt_data, S32 sculpt_level);
+
+	BuildRequest* getBuildRequest(handle_t handle)
+	{
+		return (BuildRequest*)getRequest(handle);
+	}
+};
+
+LLVolumeBuildQueue::BuildRequest::BuildRequest(handle_t handle, const LLVolumeParams& volume_params, S32 detail,
+											   U16 sculpt_width, U16 sculpt_height, S8 sculpt_components,
+											   const U8* sculpt_data, S32 sculpt_level)
+	: LLQueuedThread::QueuedRequest(handle, LLQueuedThread::PRIORITY_NORMAL),
+	  mParams(volume_params),
+	  mDetail(detail),
+	  mSculptWidth(sculpt_width),
+	  mSculptHeight(sculpt_height),
+	  mSculptComponents(sculpt_components),
+	  mSculptLevel(sculpt_level),
+	  mBuildTime(0.f)
+{
+	// the caller's image may change before the build runs
+	if (sculpt_data)
+	{
+		mSculptData.assign(sculpt_data, sculpt_data + sculpt_width * sculpt_height * sculpt_components);
+	}
+}
+
+// Runs on the worker
+bool LLVolumeBuildQueue::BuildRequest::processRequest()
+{
+	LLTimer timer;
+	LLPointer<LLVolume> volumep = new LLVolume(mParams, LLVolumeLODGroup::getVolumeScaleFromDetail(mDetail));
+	if (mParams.getSculptID().notNull())
+	{
+		volumep->sculpt(mSculptWidth, mSculptHeight, mSculptComponents,
+						mSculptData.empty() ? NULL : &mSculptData[0], mSculptLevel);
+	}
+	mVolume = volumep;
+	mBuildTime = timer.getElapsedTimeF32();
+	return true;
+}
+
+LLPointer<LLVolume> LLVolumeBuildQueue::BuildRequest::takeVolume()
+{
+	LLPointer<LLVolume> volumep = mVolume;
+	mVolume = NULL;
+	return volumep;
+}
+
+LLQueuedThread::handle_t LLVolumeBuildQueue::build(const LLVolumeParams& volume_params, S32 detail,
+												   U16 sculpt_width, U16 sculpt_height, S8 sculpt_components,
+												   const U8* sculpt_data, S32 sculpt_level)
+{
+	handle_t handle = generateHandle();
+	BuildRequest* req = new BuildRequest(handle, volume_params, detail,
+										 sculpt_width, sculpt_height, sculpt_components,
+										 sculpt_data, sculpt_level);
+	if (!addRequest(req))
+	{
+		llwarns << "Unable to queue volume build " << volume_params << llendl;
+		return nullHandle();
+	}
+	return handle;
+}
+
 //============================================================================
 
 LLVolumeMgr::LLVolumeMgr()
-:	mDataMutex(NULL)
+:	mDataMutex(NULL),
+	mBuildQueue(NULL),
+	mBuildTime(0.f),
+	mNumBuilds(0)
 {
 	// the LLMutex magic interferes with easy unit testing,
 	// so you now must manually call useMutex() to use it
@@ -68,6 +186,15 @@ LLVolumeMgr::~LLVolumeMgr()
 
 BOOL LLVolumeMgr::cleanup()
 {
+	if (mBuildQueue)
+	{
+		// stops the worker and frees the builds nobody collected
+		delete mBuildQueue;
+		mBuildQueue = NULL;
+		mPendingBuilds.clear();
+		mSupersededBuilds.clear();
+	}
+
 	BOOL no_refs = TRUE;
 	if (mDataMutex)
 	{
@@ -226,6 +353,126 @@ void LLVolumeMgr::useMutex()
 	}
 }
 
+void LLVolumeMgr::useBuildQueue(bool threaded)
+{
+	if (!mBuildQueue)
+	{
+		mBuildQueue = new LLVolumeBuildQueue(threaded);
+	}
+}
+
+bool LLVolumeMgr::isVolumeReady(const LLVolumeParams& volume_params, const S32 detail) const
+{
+	LLVolumeLODGroup* volgroupp = getGroup(volume_params);
+	return volgroupp && volgroupp->isLODReady(detail);
+}
+
+bool LLVolumeMgr::isBuildPending(const LLVolumeParams& volume_params, const S32 detail) const
+{
+	return mPendingBuilds.find(build_key_t(volume_params, detail)) != mPendingBuilds.end();
+}
+
+void LLVolumeMgr::requestBuild(const LLVolumeParams& volume_params, const S32 detail,
+							   U16 sculpt_width, U16 sculpt_height, S8 sculpt_components,
+							   const U8* sculpt_data, S32 sculpt_level)
+{
+	if (!mBuildQueue)
+	{
+		return;
+	}
+	build_key_t key(volume_params, detail);
+	pending_build_map_t::iterator iter = mPendingBuilds.find(key);
+	if (iter != mPendingBuilds.end())
+	{
+		LLVolumeBuildQueue::BuildRequest* req = mBuildQueue->getBuildRequest(iter->second);
+		if (volume_params.getSculptID().isNull() || !req ||
+			req->isSameSculpt(sculpt_width, sculpt_height, sculpt_components, sculpt_level))
+		{
+			return;
+		}
+		// The sculpt image changed discard level since the pending build was
+		// queued; the newest data wins.  The old request is collected in
+		// updateBuilds() so that its volume is released on this thread.
+		mBuildQueue->abortRequest(iter->second, false);
+		mSupersededBuilds.push_back(iter->second);
+		mPendingBuilds.erase(iter);
+	}
+	LLQueuedThread::handle_t handle = mBuildQueue->build(volume_params, detail,
+														 sculpt_width, sculpt_height, sculpt_components,
+														 sculpt_data, sculpt_level);
+	if (handle != LLQueuedThread::nullHandle())
+	{
+		mPendingBuilds[key] = handle;
+	}
+}
+
+S32 LLVolumeMgr::updateBuilds()
+{
+	if (!mBuildQueue)
+	{
+		return 0;
+	}
+	mBuildQueue->update(0); // unpauses the worker, or runs the builds when not threaded
+
+	for (std::vector<LLQueuedThread::handle_t>::iterator iter = mSupersededBuilds.begin();
+		 iter != mSupersededBuilds.end(); )
+	{
+		LLVolumeBuildQueue::BuildRequest* req = mBuildQueue->getBuildRequest(*iter);
+		if (req)
+		{
+			LLQueuedThread::status_t status = req->getStatus();
+			if (status == LLQueuedThread::STATUS_QUEUED || status == LLQueuedThread::STATUS_INPROGRESS)
+			{
+				++iter;
+				continue;
+			}
+			req->takeVolume();
+			mBuildQueue->completeRequest(*iter);
+		}
+		iter = mSupersededBuilds.erase(iter);
+	}
+
+	for (pending_build_map_t::iterator iter = mPendingBuilds.begin();
+		 iter != mPendingBuilds.end(); )
+	{
+		pending_build_map_t::iterator cur = iter++;
+		LLVolumeBuildQueue::BuildRequest* req = mBuildQueue->getBuildRequest(cur->second);
+		if (req)
+		{
+			LLQueuedThread::status_t status = req->getStatus();
+			if (status == LLQueuedThread::STATUS_QUEUED || status == LLQueuedThread::STATUS_INPROGRESS)
+			{
+				continue;
+			}
+			LLPointer<LLVolume> volumep = req->takeVolume();
+			if (volumep.notNull())
+			{
+				mBuildTime += req->getBuildTime();
+				mNumBuilds++;
+			}
+			mBuildQueue->completeRequest(cur->second);
+
+			// nothing to do if every object using these params went away
+			LLVolumeLODGroup* volgroupp = getGroup(cur->first.first);
+			if (volgroupp && volumep.notNull())
+			{
+				volgroupp->setBuiltLOD(cur->first.second, volumep);
+			}
+		}
+		mPendingBuilds.erase(cur);
+	}
+	return (S32)mPendingBuilds.size();
+}
+
+F32 LLVolumeMgr::getBuildTime(S32& num_builds)
+{
+	F32 build_time = mBuildTime;
+	num_builds = mNumBuilds;
+	mBuildTime = 0.f;
+	mNumBuilds = 0;
+	return build_time;
+}
+
 std::ostream& operator<<(std::ostream& s, const LLVolumeMgr& volume_mgr)
 {
 	s << "{ numLODgroups=" << volume_mgr.mVolumeLODGroups.size() << ", ";
@@ -310,6 +557,36 @@ LLVolume* LLVolumeLODGroup::refLOD(const S32 detail)
 	return mVolumeLODs[detail];
 }
 
+bool LLVolumeLODGroup::isLODReady(const S32 detail) const
+{
+	llassert(detail >=0 && detail < NUM_LODS);
+	if (mVolumeLODs[detail].isNull())
+	{
+		return false;
+	}
+	// sculpts have no faces until LLVolume::sculpt() runs
+	return mVolumeParams.getSculptID().isNull() || mVolumeLODs[detail]->getSculptLevel() != -2;
+}
+
+bool LLVolumeLODGroup::setBuiltLOD(const S32 detail, LLVolume* volumep)
+{
+	llassert(detail >=0 && detail < NUM_LODS);
+	LLVolume* currentp = mVolumeLODs[detail];
+	if (!currentp)
+	{
+		mVolumeLODs[detail] = volumep;
+		return true;
+	}
+	if (mVolumeParams.getSculptID().notNull() && currentp->getSculptLevel() != volumep->getSculptLevel())
+	{
+		// Objects already hold this volume, so replace its geometry in place,
+		// as LLVolume::sculpt() would.
+		currentp->swapGeometry(*volumep);
+		return true;
+	}
+	return false;
+}
+
 BOOL LLVolumeLODGroup::derefLOD(LLVolume *volumep)
 {
 	llassert_always(mRefs > 0);
@@ -375,6 +652,16 @@ F32 LLVolumeLODGroup::getVolumeScaleFromDetail(const S32 detail)
 	return mDetailScales[detail];
 }
 
+S32 LLVolumeLODGroup::getVolumeDetailFromScale(const F32 scale)
+{
+	S32 detail = 0;
+	while (detail < NUM_LODS - 1 && mDetailScales[detail + 1] <= scale)
+	{
+		detail++;
+	}
+	return detail;
+}
+
 F32 LLVolumeLODGroup::dump()
 {
 	F32 usage = 0.f;
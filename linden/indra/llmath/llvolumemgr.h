@@ -34,13 +34,16 @@
 #define LL_LLVOLUMEMGR_H
 
 #include <map>
+#include <vector>
 
 #include "llvolume.h"
 #include "llmemory.h"
+#include "llqueuedthread.h"
 #include "llthread.h"
 
 class LLVolumeParams;
 class LLVolumeLODGroup;
+class LLVolumeBuildQueue;
 
 class LLVolumeLODGroup
 {
@@ -59,9 +62,15 @@ public:
 	static S32 getDetailFromTan(const F32 tan_angle);
 	static void getDetailProximity(const F32 tan_angle, F32 &to_lower, F32& to_higher);
 	static F32 getVolumeScaleFromDetail(const S32 detail);
+	static S32 getVolumeDetailFromScale(const F32 scale);
 
 	LLVolume* refLOD(const S32 detail);
 	BOOL derefLOD(LLVolume *volumep);
+	// Main thread: true if the LOD exists and has been sculpted (for sculpts)
+	bool isLODReady(const S32 detail) const;
+	// Main thread: takes over a volume built in the background.  Returns
+	// false if the result was no longer needed.
+	bool setBuiltLOD(const S32 detail, LLVolume* volumep);
 	S32 getNumRefs() const { return mRefs; }
 	
 	const LLVolumeParams* getVolumeParams() const { return &mVolumeParams; };
@@ -100,6 +109,30 @@ public:
 	// manually call this for mutex magic
 	void useMutex();
 
+	// Background builds.  Call useBuildQueue() once to enable them; the
+	// main thread must then call updateBuilds() every frame.
+	void useBuildQueue(bool threaded = true);
+	bool hasBuildQueue() const { return mBuildQueue != NULL; }
+
+	// True if refVolume() would return a volume with faces without building it.
+	bool isVolumeReady(const LLVolumeParams& volume_params, const S32 detail) const;
+	bool isBuildPending(const LLVolumeParams& volume_params, const S32 detail) const;
+
+	// Queues a build of volume_params at detail.  For sculpts the sculpt data
+	// is copied and applied with LLVolume::sculpt().  Only one build per params
+	// and detail is pending at a time: identical requests are coalesced, and a
+	// sculpt request with new sculpt data replaces the pending one.
+	void requestBuild(const LLVolumeParams& volume_params, const S32 detail,
+					  U16 sculpt_width = 0, U16 sculpt_height = 0, S8 sculpt_components = 0,
+					  const U8* sculpt_data = NULL, S32 sculpt_level = -1);
+
+	// Hands finished builds to their LOD groups.  Returns the number still pending.
+	S32 updateBuilds();
+	S32 getNumPendingBuilds() const { return (S32)mPendingBuilds.size(); }
+
+	// Worker seconds spent on the builds finished since the last call.
+	F32 getBuildTime(S32& num_builds);
+
 	friend std::ostream& operator<<(std::ostream& s, const LLVolumeMgr& volume_mgr);
 
 protected:
@@ -112,6 +145,14 @@ protected:
 	volume_lod_group_map_t mVolumeLODGroups;
 
 	LLMutex* mDataMutex;
+
+	typedef std::pair<LLVolumeParams, S32> build_key_t;
+	typedef std::map<build_key_t, LLQueuedThread::handle_t> pending_build_map_t;
+	pending_build_map_t mPendingBuilds;	// build handles, main thread only
+	std::vector<LLQueuedThread::handle_t> mSupersededBuilds; // aborted, awaiting collection
+	LLVolumeBuildQueue* mBuildQueue;
+	F32 mBuildTime;
+	S32 mNumBuilds;
 };
 
 #endif // LL_LLVOLUMEMGR_H
@@ -193,7 +193,7 @@ LLCircuitData::~LLCircuitData()
 }
 
 
-void LLCircuitData::ackReliablePacket(TPACKETID packet_num)
+void LLCircuitData::ackReliablePacket(TPACKETID packet_num, deferred_ack_callback_list_t* deferred)
 {
 	reliable_iter iter;
 	LLReliablePacket *packetp;
@@ -212,13 +212,16 @@ void LLCircuitData::ackReliablePacket(TPACKETID packet_num)
 		}
 		if (packetp->mCallback)
 		{
-			if (packetp->mTimeout < 0.f)   // negative timeout will always return timeout even for successful ack, for debugging
+			// negative timeout will always return timeout even for successful ack, for debugging
+			S32 result = (packetp->mTimeout < 0.f) ? LL_ERR_TCP_TIMEOUT : LL_ERR_NOERR;
+			if (deferred)
 			{
-				packetp->mCallback(packetp->mCallbackData,LL_ERR_TCP_TIMEOUT);					
+				LLDeferredAckCallback callback = { packetp->mCallback, packetp->mCallbackData, result };
+				deferred->push_back(callback);
 			}
 			else
 			{
-				packetp->mCallback(packetp->mCallbackData,LL_ERR_NOERR);
+				packetp->mCallback(packetp->mCallbackData, result);
 			}
 		}
 
@@ -246,13 +249,16 @@ void LLCircuitData::ackReliablePacket(TPACKETID packet_num)
 		}
 		if (packetp->mCallback)
 		{
-			if (packetp->mTimeout < 0.f)   // negative timeout will always return timeout even for successful ack, for debugging
+			// negative timeout will always return timeout even for successful ack, for debugging
+			S32 result = (packetp->mTimeout < 0.f) ? LL_ERR_TCP_TIMEOUT : LL_ERR_NOERR;
+			if (deferred)
 			{
-				packetp->mCallback(packetp->mCallbackData,LL_ERR_TCP_TIMEOUT);					
+				LLDeferredAckCallback callback = { packetp->mCallback, packetp->mCallbackData, result };
+				deferred->push_back(callback);
 			}
 			else
 			{
-				packetp->mCallback(packetp->mCallbackData,LL_ERR_NOERR);
+				packetp->mCallback(packetp->mCallbackData, result);
 			}
 		}
 
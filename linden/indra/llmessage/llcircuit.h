@@ -74,6 +74,16 @@ class LLMessageSystem;
 class LLEncodedDatagramService;
 class LLSD;
 
+// A reliable packet callback whose ack arrived off the main thread. These are
+// collected by the receive thread and run later by LLMessageSystem.
+struct LLDeferredAckCallback
+{
+	void	(*mCallback)(void **, S32);
+	void	**mCallbackData;
+	S32		mResult;
+};
+typedef std::vector<LLDeferredAckCallback> deferred_ack_callback_list_t;
+
 //
 // Classes
 //
@@ -97,7 +107,9 @@ public:
 	// Public because stupid message system callbacks uses it.
 	void		pingTimerStart();
 	void		pingTimerStop(const U8 ping_id);
-	void			ackReliablePacket(TPACKETID packet_num);
+	// If deferred is non-NULL the packet's callback is appended to it
+	// instead of being called.
+	void			ackReliablePacket(TPACKETID packet_num, deferred_ack_callback_list_t* deferred = NULL);
 
 	// remote computer information
 	const LLUUID& getRemoteID() const { return mRemoteID; }
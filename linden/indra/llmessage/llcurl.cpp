@@ -70,8 +70,9 @@
 
 	Furthermore, it would behoove us to keep track of which
 	hosts an easy handle was used for and pick an easy handle
-	that matches the next request.  This code does not current
-	do this.
+	that matches the next request.  LLCurlRequest does this
+	when it is given a host limit, by keeping one multi handle
+	and easy handle pool per host.
  */
 
 //////////////////////////////////////////////////////////////////////////////
@@ -177,12 +178,13 @@ namespace boost
 {
 	void intrusive_ptr_add_ref(LLCurl::Responder* p)
 	{
-		++p->mReferenceCount;
+		p->mReferenceCount++;
 	}
 	
 	void intrusive_ptr_release(LLCurl::Responder* p)
 	{
-		if(p && 0 == --p->mReferenceCount)
+		// the atomic decrement returns zero once the count reaches zero
+		if(p && 0 == p->mReferenceCount--)
 		{
 			delete p;
 		}
@@ -368,7 +370,10 @@ U32 LLCurl::Easy::report(CURLcode code)
 	
 	if (code == CURLE_OK)
 	{
-		curl_easy_getinfo(mCurlEasyHandle, CURLINFO_RESPONSE_CODE, &responseCode);
+		// curl writes a long, which is wider than U32 on 64 bit Linux
+		long response_code = 0;
+		curl_easy_getinfo(mCurlEasyHandle, CURLINFO_RESPONSE_CODE, &response_code);
+		responseCode = (U32)response_code;
 		//*TODO: get reason from first line of mHeaderOutput
 	}
 	else
@@ -522,7 +527,7 @@ class LLCurl::Multi
 	LOG_CLASS(Multi);
 public:
 	
-	Multi();
+	Multi(S32 max_connections = 0);
 	~Multi();
 
 	Easy* allocEasy();
@@ -535,6 +540,8 @@ public:
 	
 	CURLMsg* info_read(S32* msgs_in_queue);
 
+	S32 getActiveCount() const { return (S32)mEasyActiveList.size(); }
+
 	S32 mQueued;
 	S32 mErrorCount;
 	
@@ -542,6 +549,7 @@ private:
 	void easyFree(Easy*);
 	
 	CURLM* mCurlMultiHandle;
+	U32 mEasyPoolSize;
 
 	typedef std::set<Easy*> easy_active_list_t;
 	easy_active_list_t mEasyActiveList;
@@ -551,9 +559,10 @@ private:
 	easy_free_list_t mEasyFreeList;
 };
 
-LLCurl::Multi::Multi()
+LLCurl::Multi::Multi(S32 max_connections)
 	: mQueued(0),
-	  mErrorCount(0)
+	  mErrorCount(0),
+	  mEasyPoolSize(EASY_HANDLE_POOL_SIZE)
 {
 	mCurlMultiHandle = curl_multi_init();
 	if (!mCurlMultiHandle)
@@ -563,6 +572,16 @@ LLCurl::Multi::Multi()
 	}
 	llassert_always(mCurlMultiHandle);
 	++gCurlMultiCount;
+
+	if (max_connections > 0)
+	{
+		// Keep an easy handle, and its connection, for each request that
+		// may be in flight at once.
+		mEasyPoolSize = llmax(mEasyPoolSize, (U32)max_connections);
+#if LIBCURL_VERSION_NUM >= 0x071003
+		curl_multi_setopt(mCurlMultiHandle, CURLMOPT_MAXCONNECTS, (long)max_connections);
+#endif
+	}
 }
 
 LLCurl::Multi::~Multi()
@@ -683,7 +702,7 @@ void LLCurl::Multi::easyFree(Easy* easy)
 {
 	mEasyActiveList.erase(easy);
 	mEasyActiveMap.erase(easy->getCurlHandle());
-	if (mEasyFreeList.size() < EASY_HANDLE_POOL_SIZE)
+	if (mEasyFreeList.size() < mEasyPoolSize)
 	{
 		easy->resetState();
 		mEasyFreeList.insert(easy);
@@ -720,7 +739,8 @@ std::string LLCurl::strerror(CURLcode errorcode)
 
 LLCurlRequest::LLCurlRequest() :
 	mActiveMulti(NULL),
-	mActiveRequestCount(0)
+	mActiveRequestCount(0),
+	mHostLimit(0)
 {
 	mThreadID = LLThread::currentID();
 }
@@ -740,8 +760,44 @@ void LLCurlRequest::addMulti()
 	mActiveRequestCount = 0;
 }
 
-LLCurl::Easy* LLCurlRequest::allocEasy()
+// "http://host:port/path" -> "host:port"
+static std::string get_url_host(const std::string& url)
 {
+	std::string::size_type start = url.find("://");
+	start = (start == std::string::npos) ? 0 : start + 3;
+	std::string::size_type end = url.find_first_of("/?#", start);
+	return url.substr(start, end == std::string::npos ? std::string::npos : end - start);
+}
+
+void LLCurlRequest::setHostLimit(S32 max_connections)
+{
+	llassert_always(mThreadID == LLThread::currentID());
+	llassert_always(mHostMultis.empty());
+	mHostLimit = max_connections;
+}
+
+S32 LLCurlRequest::getHostActive(const std::string& url)
+{
+	llassert_always(mThreadID == LLThread::currentID());
+	host_multi_map_t::iterator iter = mHostMultis.find(get_url_host(url));
+	return iter != mHostMultis.end() ? iter->second->getActiveCount() : 0;
+}
+
+LLCurl::Easy* LLCurlRequest::allocEasy(const std::string& url, LLCurl::Multi*& multi)
+{
+	if (mHostLimit > 0)
+	{
+		// Host multis are never replaced, since that would close their
+		// connections; they are only deleted with this object.
+		LLCurl::Multi*& host_multi = mHostMultis[get_url_host(url)];
+		if (!host_multi)
+		{
+			host_multi = new LLCurl::Multi(mHostLimit);
+			mMultiSet.insert(host_multi);
+		}
+		multi = host_multi;
+		return multi->allocEasy();
+	}
 	if (!mActiveMulti ||
 		mActiveRequestCount	>= MAX_ACTIVE_REQUEST_COUNT ||
 		mActiveMulti->mErrorCount > 0)
@@ -750,14 +806,15 @@ LLCurl::Easy* LLCurlRequest::allocEasy()
 	}
 	llassert_always(mActiveMulti);
 	++mActiveRequestCount;
+	multi = mActiveMulti;
 	LLCurl::Easy* easy = mActiveMulti->allocEasy();
 	return easy;
 }
 
-bool LLCurlRequest::addEasy(LLCurl::Easy* easy)
+bool LLCurlRequest::addEasy(LLCurl::Multi* multi, LLCurl::Easy* easy)
 {
-	llassert_always(mActiveMulti);
-	bool res = mActiveMulti->addEasy(easy);
+	llassert_always(multi);
+	bool res = multi->addEasy(easy);
 	return res;
 }
 
@@ -771,7 +828,8 @@ bool LLCurlRequest::getByteRange(const std::string& url,
 								 S32 offset, S32 length,
 								 LLCurl::ResponderPtr responder)
 {
-	LLCurl::Easy* easy = allocEasy();
+	LLCurl::Multi* multi = NULL;
+	LLCurl::Easy* easy = allocEasy(url, multi);
 	if (!easy)
 	{
 		return false;
@@ -785,7 +843,7 @@ bool LLCurlRequest::getByteRange(const std::string& url,
 		easy->slist_append(range.c_str());
 	}
 	easy->setHeaders();
-	bool res = addEasy(easy);
+	bool res = addEasy(multi, easy);
 	return res;
 }
 
@@ -794,7 +852,8 @@ bool LLCurlRequest::post(const std::string& url,
 						 const LLSD& data,
 						 LLCurl::ResponderPtr responder)
 {
-	LLCurl::Easy* easy = allocEasy();
+	LLCurl::Multi* multi = NULL;
+	LLCurl::Easy* easy = allocEasy(url, multi);
 	if (!easy)
 	{
 		return false;
@@ -812,7 +871,7 @@ bool LLCurlRequest::post(const std::string& url,
 	easy->setHeaders();
 
 	lldebugs << "POSTING: " << bytes << " bytes." << llendl;
-	bool res = addEasy(easy);
+	bool res = addEasy(multi, easy);
 	return res;
 }
 	
@@ -828,7 +887,7 @@ S32 LLCurlRequest::process()
 		LLCurl::Multi* multi = *curiter;
 		S32 tres = multi->process();
 		res += tres;
-		if (multi != mActiveMulti && tres == 0 && multi->mQueued == 0)
+		if (multi != mActiveMulti && tres == 0 && multi->mQueued == 0 && mHostLimit <= 0)
 		{
 			mMultiSet.erase(curiter);
 			delete multi;
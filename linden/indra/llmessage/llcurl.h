@@ -37,6 +37,7 @@
 
 #include "linden_common.h"
 
+#include <map>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -44,6 +45,7 @@
 #include <boost/intrusive_ptr.hpp>
 #include <curl/curl.h> // TODO: remove dependency
 
+#include "llapr.h"
 #include "llbuffer.h"
 #include "lliopipe.h"
 #include "llsd.h"
@@ -121,7 +123,7 @@ public:
 			virtual void completedHeader(U32 status, const std::string& reason, const LLSD& content);
 
 	public: /* but not really -- don't touch this */
-		U32 mReferenceCount;
+		LLAtomicU32 mReferenceCount;
 	};
 	typedef boost::intrusive_ptr<Responder>	ResponderPtr;
 
@@ -199,16 +201,27 @@ public:
 	S32  process();
 	S32  getQueued();
 
+	// Gives each host its own multi handle and pool of easy handles, kept
+	// until this request object is destroyed, so that up to max_connections
+	// connections to each host stay open between requests.  Call before the
+	// first request.
+	void setHostLimit(S32 max_connections);
+	// Requests in flight to the host of url, when host limits are set
+	S32  getHostActive(const std::string& url);
+
 private:
 	void addMulti();
-	LLCurl::Easy* allocEasy();
-	bool addEasy(LLCurl::Easy* easy);
+	LLCurl::Easy* allocEasy(const std::string& url, LLCurl::Multi*& multi);
+	bool addEasy(LLCurl::Multi* multi, LLCurl::Easy* easy);
 	
 private:
 	typedef std::set<LLCurl::Multi*> curlmulti_set_t;
 	curlmulti_set_t mMultiSet;
 	LLCurl::Multi* mActiveMulti;
 	S32 mActiveRequestCount;
+	typedef std::map<std::string, LLCurl::Multi*> host_multi_map_t;
+	host_multi_map_t mHostMultis;
+	S32 mHostLimit;
 	U32 mThreadID; // debug
 };
 
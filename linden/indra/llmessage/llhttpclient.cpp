@@ -81,6 +81,10 @@ namespace
 			{
 				mResponder->completedRaw(mStatus, mReason, channels, buffer);
 				mResponder->completedHeader(mStatus, mReason, mHeaderOutput);
+
+				// Let go of the responder here, on the thread which ran
+				// it, rather than wherever the chain drops this pipe.
+				mResponder = NULL;
 			}
 		}
 		virtual void header(const std::string& header, const std::string& value)
@@ -104,7 +108,14 @@ namespace
 	class LLSDInjector : public Injector
 	{
 	public:
-		LLSDInjector(const LLSD& sd) : mSD(sd) {}
+		// The body is serialized here so that a pump on another thread
+		// never shares the caller's LLSD.
+		LLSDInjector(const LLSD& sd)
+		{
+			std::ostringstream ostr;
+			LLSDSerialize::toXML(sd, ostr);
+			mBody = ostr.str();
+		}
 		virtual ~LLSDInjector() {}
 
 		const char* contentType() { return "application/llsd+xml"; }
@@ -113,12 +124,12 @@ namespace
 			buffer_ptr_t& buffer, bool& eos, LLSD& context, LLPumpIO* pump)
 		{
 			LLBufferStream ostream(channels, buffer.get());
-			LLSDSerialize::toXML(mSD, ostream);
+			ostream.write(mBody.data(), mBody.size());
 			eos = true;
 			return STATUS_DONE;
 		}
 
-		const LLSD mSD;
+		std::string mBody;
 	};
 
 	class RawInjector : public Injector
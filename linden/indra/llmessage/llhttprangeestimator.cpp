@@ -0,0 +1,202 @@
+/**
+ * @file llhttprangeestimator.cpp
+ * @brief Picks the size of the first range of a progressive HTTP fetch.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#include "linden_common.h"
+
+#include "llhttprangeestimator.h"
+
+#include <algorithm>
+
+// Only the most recent samples are kept, so the estimate follows changes
+// in the network and in what is being looked at.
+static const U32 MAX_TRANSFERS = 64;
+static const U32 MAX_NEEDS = 256;
+static const U32 MIN_TRANSFERS = 8;
+static const U32 MIN_NEEDS = 16;
+
+LLHTTPRangeEstimator::LLHTTPRangeEstimator(S32 min_range, S32 max_range)
+	: mMinRange(min_range),
+	  mMaxRange(llmax(min_range, max_range)),
+	  mNextTransfer(0),
+	  mNextNeed(0),
+	  mDirty(false),
+	  mFirstRange(min_range),
+	  mLatency(0.0),
+	  mBandwidth(0.0)
+{
+}
+
+void LLHTTPRangeEstimator::addTransfer(S32 bytes, F64 seconds)
+{
+	if (bytes <= 0 || seconds <= 0.0)
+	{
+		return;
+	}
+	Transfer transfer;
+	transfer.mBytes = bytes;
+	transfer.mSeconds = seconds;
+	if (mTransfers.size() < MAX_TRANSFERS)
+	{
+		mTransfers.push_back(transfer);
+	}
+	else
+	{
+		mTransfers[mNextTransfer] = transfer;
+		mNextTransfer = (mNextTransfer + 1) % MAX_TRANSFERS;
+	}
+	mDirty = true;
+}
+
+void LLHTTPRangeEstimator::addNeed(S32 bytes)
+{
+	if (bytes <= 0)
+	{
+		return;
+	}
+	if (mNeeds.size() < MAX_NEEDS)
+	{
+		mNeeds.push_back(bytes);
+	}
+	else
+	{
+		mNeeds[mNextNeed] = bytes;
+		mNextNeed = (mNextNeed + 1) % MAX_NEEDS;
+	}
+	mDirty = true;
+}
+
+S32 LLHTTPRangeEstimator::getFirstRange()
+{
+	update();
+	return mFirstRange;
+}
+
+F64 LLHTTPRangeEstimator::getLatency()
+{
+	update();
+	return mLatency;
+}
+
+F64 LLHTTPRangeEstimator::getBandwidth()
+{
+	update();
+	return mBandwidth;
+}
+
+void LLHTTPRangeEstimator::update()
+{
+	if (!mDirty)
+	{
+		return;
+	}
+	mDirty = false;
+	mFirstRange = mMinRange;
+
+	// Least squares fit of seconds = latency + bytes / bandwidth
+	mLatency = 0.0;
+	mBandwidth = 0.0;
+	const U32 num_transfers = mTransfers.size();
+	if (num_transfers < MIN_TRANSFERS)
+	{
+		return;
+	}
+	F64 mean_bytes = 0.0;
+	F64 mean_seconds = 0.0;
+	F64 min_seconds = mTransfers[0].mSeconds;
+	for (U32 i = 0; i < num_transfers; ++i)
+	{
+		mean_bytes += mTransfers[i].mBytes;
+		mean_seconds += mTransfers[i].mSeconds;
+		min_seconds = llmin(min_seconds, mTransfers[i].mSeconds);
+	}
+	mean_bytes /= num_transfers;
+	mean_seconds /= num_transfers;
+	F64 sxx = 0.0;
+	F64 sxy = 0.0;
+	for (U32 i = 0; i < num_transfers; ++i)
+	{
+		F64 dx = mTransfers[i].mBytes - mean_bytes;
+		sxx += dx * dx;
+		sxy += dx * (mTransfers[i].mSeconds - mean_seconds);
+	}
+	if (sxx <= 0.0 || sxy <= 0.0)
+	{
+		// All the same size, or bigger was not slower: nothing to go on
+		return;
+	}
+	F64 seconds_per_byte = sxy / sxx;
+	mBandwidth = 1.0 / seconds_per_byte;
+	mLatency = llclamp(mean_seconds - seconds_per_byte * mean_bytes, 0.0, min_seconds);
+
+	const U32 num_needs = mNeeds.size();
+	if (num_needs < MIN_NEEDS)
+	{
+		return;
+	}
+	mSortedNeeds.resize(num_needs);
+	for (U32 i = 0; i < num_needs; ++i)
+	{
+		mSortedNeeds[i] = llclamp(mNeeds[i], mMinRange, mMaxRange);
+	}
+	std::sort(mSortedNeeds.begin(), mSortedNeeds.end());
+
+	// For a first range of range bytes, the items which need no more pay
+	// for range bytes, and the others pay for what they need and one more
+	// request.  The best range is min_range or one of the needs.
+	F64 bytes_above = 0.0;
+	for (U32 i = 0; i < num_needs; ++i)
+	{
+		bytes_above += mSortedNeeds[i];
+	}
+	F64 best_cost = 0.0;
+	U32 i = 0;
+	for (S32 range = mMinRange; ; )
+	{
+		while (i < num_needs && mSortedNeeds[i] <= range)
+		{
+			bytes_above -= mSortedNeeds[i];
+			++i;
+		}
+		F64 cost = ((F64)i * range + bytes_above) * seconds_per_byte + (num_needs - i) * mLatency;
+		if (range == mMinRange || cost < best_cost)
+		{
+			best_cost = cost;
+			mFirstRange = range;
+		}
+		if (i == num_needs)
+		{
+			break;
+		}
+		range = mSortedNeeds[i];
+	}
+}
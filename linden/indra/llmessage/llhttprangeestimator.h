@@ -0,0 +1,86 @@
+/**
+ * @file llhttprangeestimator.h
+ * @brief Picks the size of the first range of a progressive HTTP fetch.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#ifndef LL_LLHTTPRANGEESTIMATOR_H
+#define LL_LLHTTPRANGEESTIMATOR_H
+
+#include <vector>
+
+// Picks how many bytes to ask for in the first request for an item that
+// is fetched with progressive range requests, such as a texture whose
+// size is not known yet.  It keeps the bytes recent items turned out to
+// need, and fits latency + bytes / bandwidth to recent requests.  Asking
+// for more than an item needs costs the time to send the extra bytes;
+// asking for less costs another request.  The first range is the one
+// with the lowest expected time over the recent items.
+class LLHTTPRangeEstimator
+{
+public:
+	LLHTTPRangeEstimator(S32 min_range, S32 max_range);
+
+	// A request which received bytes seconds after it was sent
+	void addTransfer(S32 bytes, F64 seconds);
+	// The bytes an item turned out to need, counted from its start
+	void addNeed(S32 bytes);
+
+	// Returns min_range until enough has been seen to do better.
+	S32 getFirstRange();
+
+	// 0 while unknown
+	F64 getLatency();
+	F64 getBandwidth(); // bytes per second
+
+private:
+	void update();
+
+	S32 mMinRange;
+	S32 mMaxRange;
+
+	struct Transfer
+	{
+		S32 mBytes;
+		F64 mSeconds;
+	};
+	std::vector<Transfer> mTransfers;
+	U32 mNextTransfer;
+	std::vector<S32> mNeeds;
+	U32 mNextNeed;
+
+	bool mDirty;
+	S32 mFirstRange;
+	F64 mLatency;
+	F64 mBandwidth;
+	std::vector<S32> mSortedNeeds;
+};
+
+#endif // LL_LLHTTPRANGEESTIMATOR_H
@@ -38,6 +38,7 @@
 #include <boost/intrusive_ptr.hpp>
 #include <boost/shared_ptr.hpp>
 #include "apr_poll.h"
+#include "llapr.h"
 
 #include "llsd.h"
 
@@ -256,18 +257,20 @@ protected:
 private:
 	friend void boost::intrusive_ptr_add_ref(LLIOPipe* p);
 	friend void boost::intrusive_ptr_release(LLIOPipe* p);
-	U32 mReferenceCount;
+	// Atomic, since chains on a threaded pump hand pipes between threads.
+	LLAtomicU32 mReferenceCount;
 };
 
 namespace boost
 {
 	inline void intrusive_ptr_add_ref(LLIOPipe* p)
 	{
-		++p->mReferenceCount;
+		p->mReferenceCount++;
 	}
 	inline void intrusive_ptr_release(LLIOPipe* p)
 	{
-		if(p && 0 == --p->mReferenceCount)
+		// the atomic decrement returns zero once the count reaches zero
+		if(p && 0 == p->mReferenceCount--)
 		{
 			delete p;
 		}
@@ -0,0 +1,260 @@
+/**
+ * @file llhttprangeestimator_bench.cpp
+ * @brief Measures texture fetches with and without adaptive first ranges.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#include "linden_common.h"
+
+#include "llbuffer.h"
+#include "llcurl.h"
+#include "llhttprangeestimator.h"
+#include "lltextureserver.h"
+#include "lltimer.h"
+
+// Serves made-up textures from an LLTextureServer on a local port with a
+// fixed round trip time, then fetches every one of them by range, a few
+// at a time, the way LLTextureFetch does: once starting each texture with
+// a fixed first range on whatever connections curl opens, and once with a
+// per-host connection limit and first ranges sized by an
+// LLHTTPRangeEstimator.  Reports textures per second, requests and
+// connections for both, and exits with 1 if either fetch comes back
+// incomplete or wrong.
+//
+// usage: llhttprangeestimator_bench [-n textures] [-l latency_ms] [-p port]
+
+namespace
+{
+	const S32 MIN_RANGE = 600;			// FIRST_PACKET_SIZE in llimage.h
+	const S32 MAX_RANGE = 128 * 1024;
+	const S32 HOST_CONNECTIONS = 8;
+
+	struct TextureFetch
+	{
+		enum EState { QUEUED, WAITING, ARRIVED, DONE };
+
+		EState mState;
+		S32 mNeed;				// Bytes the texture turns out to need
+		std::string mData;
+		S32 mRequested;
+		S32 mReceived;
+		U32 mStatus;
+		S32 mRequests;
+		LLTimer mTimer;
+
+		TextureFetch() : mState(QUEUED), mNeed(0), mRequested(0), mReceived(0), mStatus(0), mRequests(0) {}
+	};
+
+	class TextureResponder : public LLCurl::Responder
+	{
+	public:
+		TextureResponder(TextureFetch& fetch) : mFetch(fetch) {}
+
+		/*virtual*/ void completedRaw(U32 status, const std::string& reason,
+			const LLChannelDescriptors& channels, const LLIOPipe::buffer_ptr_t& buffer)
+		{
+			S32 size = buffer->countAfter(channels.in(), NULL);
+			if (size > 0)
+			{
+				std::vector<U8> data(size);
+				buffer->readAfter(channels.in(), NULL, &data[0], size);
+				mFetch.mData.append((const char*)&data[0], size);
+			}
+			mFetch.mStatus = status;
+			mFetch.mReceived = llmax(size, 0);
+			mFetch.mState = TextureFetch::ARRIVED;
+		}
+
+	private:
+		TextureFetch& mFetch;
+	};
+
+	struct FetchResults
+	{
+		F64 mSeconds;
+		S32 mRequests;
+		S32 mConnections;
+		S32 mFirstRange;
+		bool mComplete;
+	};
+
+	// Fetches every texture on the server up to its need.  pooled uses a
+	// host limit and sizes first ranges with an estimator; otherwise every
+	// texture starts with MIN_RANGE bytes on whatever connections curl has.
+	FetchResults fetch_textures(LLTextureServer& server, const std::vector<S32>& needs, bool pooled)
+	{
+		S32 start_connections = server.getConnections();
+		LLCurlRequest request;
+		if (pooled)
+		{
+			request.setHostLimit(HOST_CONNECTIONS);
+		}
+		LLHTTPRangeEstimator estimator(MIN_RANGE, MAX_RANGE);
+		std::vector<TextureFetch> fetches(server.getNumTextures());
+		for (S32 i = 0; i < (S32)fetches.size(); ++i)
+		{
+			fetches[i].mNeed = needs[i];
+		}
+
+		FetchResults results;
+		results.mComplete = true;
+		LLTimer timer;
+		S32 active = 0;
+		S32 done = 0;
+		while (done < (S32)fetches.size() && timer.getElapsedTimeF64() < 60.0)
+		{
+			for (S32 i = 0; i < (S32)fetches.size(); ++i)
+			{
+				TextureFetch& fetch = fetches[i];
+				if (fetch.mState == TextureFetch::ARRIVED)
+				{
+					active--;
+					S32 cur_size = (S32)fetch.mData.size();
+					bool good = fetch.mStatus >= 200 && fetch.mStatus < 300;
+					if (good && pooled)
+					{
+						estimator.addTransfer(fetch.mReceived, fetch.mTimer.getElapsedTimeF64());
+					}
+					if (!good || cur_size >= fetch.mNeed || fetch.mReceived < fetch.mRequested)
+					{
+						// done, or the server had nothing more
+						if (pooled)
+						{
+							estimator.addNeed(fetch.mNeed);
+						}
+						results.mComplete = results.mComplete && good;
+						fetch.mState = TextureFetch::DONE;
+						done++;
+					}
+					else
+					{
+						fetch.mState = TextureFetch::QUEUED;
+					}
+				}
+				if (fetch.mState == TextureFetch::QUEUED && active < HOST_CONNECTIONS)
+				{
+					S32 cur_size = (S32)fetch.mData.size();
+					S32 length = fetch.mNeed - cur_size;
+					if (cur_size == 0)
+					{
+						length = pooled ? estimator.getFirstRange() : MIN_RANGE;
+					}
+					fetch.mRequested = length;
+					fetch.mRequests++;
+					fetch.mTimer.reset();
+					fetch.mState = TextureFetch::WAITING;
+					request.getByteRange(server.getURL(i), LLCurlRequest::headers_t(), cur_size, length,
+										 new TextureResponder(fetch));
+					active++;
+				}
+			}
+			request.process();
+			ms_sleep(1);
+		}
+		results.mSeconds = timer.getElapsedTimeF64();
+		results.mFirstRange = estimator.getFirstRange();
+
+		results.mRequests = 0;
+		for (S32 i = 0; i < (S32)fetches.size(); ++i)
+		{
+			const TextureFetch& fetch = fetches[i];
+			results.mComplete = results.mComplete && fetch.mState == TextureFetch::DONE &&
+				(S32)fetch.mData.size() >= fetch.mNeed &&
+				fetch.mData == server.getTexture(i).substr(0, fetch.mData.size());
+			results.mRequests += fetch.mRequests;
+		}
+		results.mConnections = server.getConnections() - start_connections;
+		return results;
+	}
+
+	void print_results(const char* name, S32 num_textures, const FetchResults& results)
+	{
+		printf("%-6s %6d byte first range  %8.1f textures/s  %5d requests  %3d connections  %s\n",
+			   name, results.mFirstRange, num_textures / llmax(results.mSeconds, 1.0e-9),
+			   results.mRequests, results.mConnections,
+			   results.mComplete ? "complete" : "INCOMPLETE");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	S32 num_textures = 200;
+	S32 latency_ms = 20;
+	S32 port = 8891;
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		S32 value = llmax(1, atoi(argv[i + 1]));
+		if (!strcmp(argv[i], "-n"))
+		{
+			num_textures = value;
+		}
+		else if (!strcmp(argv[i], "-l"))
+		{
+			latency_ms = value;
+		}
+		else if (!strcmp(argv[i], "-p"))
+		{
+			port = value;
+		}
+	}
+
+	LLCurl::initClass();
+
+	bool complete = false;
+	{
+		LLTextureServer server((U16)port, latency_ms, 2 * HOST_CONNECTIONS);
+		std::vector<S32> needs;
+		U32 seed = 12345;
+		for (S32 i = 0; i < num_textures; ++i)
+		{
+			seed = seed * 1664525 + 1013904223;
+			S32 size = 4000 + (S32)((seed >> 8) % 60000);
+			server.addMadeUpTexture(512, 512, size);
+			// most textures are only needed to a middle discard level
+			needs.push_back((i % 4) ? size / 4 : size);
+		}
+		if (!server.start())
+		{
+			fprintf(stderr, "Unable to listen on port %d\n", port);
+			LLCurl::cleanupClass();
+			return 1;
+		}
+
+		printf("%d textures, %d ms server latency\n", num_textures, latency_ms);
+		FetchResults fixed = fetch_textures(server, needs, false);
+		print_results("fixed", num_textures, fixed);
+		FetchResults pooled = fetch_textures(server, needs, true);
+		print_results("pooled", num_textures, pooled);
+		complete = fixed.mComplete && pooled.mComplete;
+	}
+
+	LLCurl::cleanupClass();
+	return complete ? 0 : 1;
+}
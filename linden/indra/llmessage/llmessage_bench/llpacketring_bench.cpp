@@ -0,0 +1,210 @@
+/**
+ * @file llpacketring_bench.cpp
+ * @brief Measures checkMessages() packets per second, with and without batched I/O.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#include "linden_common.h"
+
+#include "llfile.h"
+#include "lltimer.h"
+#include "llversionserver.h"
+#include "message.h"
+#include "message_prehash.h"
+#include "net.h"
+
+// Sends a stream of TestMessage datagrams over loopback into a message
+// system a chunk at a time, drains each chunk through checkMessages(), and
+// reports packets per second with LLPacketRing batching off and, where the
+// platform has it, on.  Exits with 1 if any packet is lost.
+//
+// usage: llpacketring_bench [-n packets] [-c chunk]
+
+namespace
+{
+	// Only the message used by the stream, so the bench does not depend
+	// on the location of the full message_template.msg.
+	const char* BENCH_TEMPLATE =
+		"version 2.0\n"
+		"{\n"
+		"	TestMessage Low 1 NotTrusted Zerocoded\n"
+		"	{\n"
+		"		TestBlock1		Single\n"
+		"		{	Test1		U32	}\n"
+		"	}\n"
+		"	{\n"
+		"		NeighborBlock		Multiple		4\n"
+		"		{	Test0		U32	}\n"
+		"		{	Test1		U32	}\n"
+		"		{	Test2		U32	}\n"
+		"	}\n"
+		"}\n";
+
+	const S32 TEST_MESSAGE_NUMBER = 1;
+	const S32 TEST_MESSAGE_BODY_SIZE = 4 + 4 * 3 * 4;
+
+	S32 sReceivedCount = 0;
+
+	void process_test_message(LLMessageSystem* msg, void**)
+	{
+		++sReceivedCount;
+	}
+
+	U32 sPacketID = 1;
+
+	// Builds a TestMessage datagram the way the wire carries it.
+	std::string make_test_packet(U32 value)
+	{
+		std::string packet(LL_PACKET_ID_SIZE + 4 + TEST_MESSAGE_BODY_SIZE, '\0');
+		U8* buffer = (U8*)&packet[0];
+		U32 packet_id = htonl(sPacketID++);
+		memcpy(buffer + PHL_PACKET_ID, &packet_id, sizeof(packet_id));
+		U8* header = buffer + LL_PACKET_ID_SIZE;
+		header[0] = 255;
+		header[1] = 255;
+		U16 number = htons((U16)TEST_MESSAGE_NUMBER);
+		memcpy(header + 2, &number, sizeof(number));
+		htonmemcpy(header + 4, &value, MVT_U32, 4);
+		return packet;
+	}
+
+	// Replays count fresh packets into the listen socket, chunk at a time,
+	// and drains them through checkMessages().  Returns the elapsed seconds.
+	F64 replay(S32 send_socket, const LLHost& listen_host, S32 count, S32 chunk)
+	{
+		std::vector<std::string> packets;
+		for (S32 i = 0; i < count; ++i)
+		{
+			packets.push_back(make_test_packet(i));
+		}
+
+		LLTimer timer;
+		S32 expected = sReceivedCount;
+		for (S32 i = 0; i < count; i += chunk)
+		{
+			S32 end = llmin(i + chunk, count);
+			for (S32 j = i; j < end; ++j)
+			{
+				send_packet(send_socket, packets[j].data(), (int)packets[j].size(),
+							listen_host.getAddress(), listen_host.getPort());
+			}
+			expected += end - i;
+
+			// loopback delivery is immediate, but give a slow box a
+			// moment before declaring packets lost
+			LLTimer drain_timer;
+			while (sReceivedCount < expected && drain_timer.getElapsedTimeF32() < 2.f)
+			{
+				while (gMessageSystem->checkMessages())
+				{
+				}
+			}
+		}
+		return llmax(timer.getElapsedTimeF64(), 1.0e-6);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	S32 count = 20000;
+	S32 chunk = 64;
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		S32 value = llmax(1, atoi(argv[i + 1]));
+		if (!strcmp(argv[i], "-n"))
+		{
+			count = value;
+		}
+		else if (!strcmp(argv[i], "-c"))
+		{
+			chunk = value;
+		}
+	}
+
+	LLUUID random;
+	random.generate();
+#if LL_WINDOWS
+	std::string template_file = "C:\\packetring-bench-" + random.asString() + ".msg";
+#else
+	std::string template_file = "/tmp/packetring-bench-" + random.asString() + ".msg";
+#endif
+	llofstream file(template_file);
+	file << BENCH_TEMPLATE;
+	file.close();
+
+	bool started = start_messaging_system(template_file, NET_USE_OS_ASSIGNED_PORT,
+										  LL_VERSION_MAJOR,
+										  LL_VERSION_MINOR,
+										  LL_VERSION_PATCH,
+										  FALSE,
+										  "notasharedsecret",
+										  NULL,
+										  false,
+										  5.f,
+										  100.f);
+	LLFile::remove(template_file);
+	if (!started || !gMessageSystem->isOK())
+	{
+		printf("can't start the message system\n");
+		return 1;
+	}
+	gMessageSystem->setHandlerFuncFast(_PREHASH_TestMessage, process_test_message);
+	LLHost listen_host(ip_string_to_u32("127.0.0.1"), gMessageSystem->getListenPort());
+
+	S32 send_socket = 0;
+	S32 send_port = NET_USE_OS_ASSIGNED_PORT;
+	start_net(send_socket, send_port);
+	gMessageSystem->enableCircuit(LLHost(ip_string_to_u32("127.0.0.1"), send_port), TRUE);
+
+	bool lost = false;
+	gMessageSystem->mPacketRing.setUseBatchIO(FALSE);
+	F64 unbatched = replay(send_socket, listen_host, count, chunk);
+	lost = lost || sReceivedCount != count;
+	printf("%d packets in chunks of %d: unbatched %.0f packets/s", count, chunk, count / unbatched);
+
+	if (net_batch_supported())
+	{
+		gMessageSystem->mPacketRing.setUseBatchIO(TRUE);
+		F64 batched = replay(send_socket, listen_host, count, chunk);
+		gMessageSystem->mPacketRing.setUseBatchIO(FALSE);
+		lost = lost || sReceivedCount != count * 2;
+		printf(", batched %.0f packets/s  %.2fx", count / batched, unbatched / batched);
+	}
+	else
+	{
+		printf(", no batched I/O on this platform");
+	}
+	printf("  %s\n", lost ? "PACKETS LOST" : "all received");
+
+	end_net(send_socket);
+	delete gMessageSystem;
+	gMessageSystem = NULL;
+	return lost ? 1 : 0;
+}
@@ -0,0 +1,261 @@
+/**
+ * @file llpartstore_bench.cpp
+ * @brief Measures particle updates, one heap object per particle against LLPartStore.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#include "linden_common.h"
+
+#include "llpartstore.h"
+#include "llrand.h"
+#include "llstl.h"
+#include "lltimer.h"
+
+// Updates the same particles with mixed flags for a number of frames, once
+// as one heap object per particle, the way LLViewerPartGroup used to keep
+// them, and once in an LLPartStore, the way it does now.  Reports
+// milliseconds per frame for both and exits with 1 if the two end up with
+// different particles.
+//
+// usage: llpartstore_bench [-n particles] [-f frames]
+
+namespace
+{
+	// A particle the way LLViewerPartGroup used to keep them: one heap
+	// object each, updated one at a time.
+	struct BenchPart : public LLPartData
+	{
+		F32 mAge;
+		F32 mSkipOffset;
+		LLVector3 mPosAgent;
+		LLVector3 mVelocity;
+		LLVector3 mAccel;
+		LLColor4 mColor;
+		LLVector2 mScale;
+
+		BenchPart() : mAge(0.f), mSkipOffset(0.f) {}
+	};
+
+	const LLVector3 SOURCE_POS(128.f, 128.f, 20.f);
+
+	// The per-particle update from LLViewerPartGroup, less the parts that
+	// need a viewer (callbacks, wind, targets).
+	void update_part(BenchPart& part, F32 dt)
+	{
+		const F32 cur_time = part.mAge + dt;
+		const F32 frac = cur_time / part.mMaxAge;
+
+		if (part.mFlags & LLPartData::LL_PART_FOLLOW_SRC_MASK)
+		{
+			part.mPosAgent = SOURCE_POS;
+			part.mPosAgent += part.mPosOffset;
+		}
+
+		part.mPosAgent += dt*part.mVelocity;
+		part.mPosAgent += 0.5f*dt*dt*part.mAccel;
+		part.mVelocity += part.mAccel*dt;
+
+		if (part.mFlags & LLPartData::LL_PART_BOUNCE_MASK)
+		{
+			F32 dz = part.mPosAgent.mV[VZ] - SOURCE_POS.mV[VZ];
+			if (dz < 0)
+			{
+				part.mPosAgent.mV[VZ] += -2.f*dz;
+				part.mVelocity.mV[VZ] *= -0.75f;
+			}
+		}
+
+		if (part.mFlags & LLPartData::LL_PART_FOLLOW_SRC_MASK)
+		{
+			part.mPosOffset = part.mPosAgent;
+			part.mPosOffset -= SOURCE_POS;
+		}
+
+		if (part.mFlags & LLPartData::LL_PART_INTERP_COLOR_MASK)
+		{
+			part.mColor.setVec(part.mStartColor);
+			part.mColor *= 1.f - frac;
+			part.mColor %= 1.f - frac;
+			part.mColor += frac%(frac*part.mEndColor);
+		}
+
+		if (part.mFlags & LLPartData::LL_PART_INTERP_SCALE_MASK)
+		{
+			part.mScale.setVec(part.mStartScale);
+			part.mScale *= 1.f - frac;
+			part.mScale += frac*part.mEndScale;
+		}
+
+		part.mAge = cur_time;
+	}
+
+	// Mixed flags: most particles only interpolate, some bounce or follow
+	// their source.
+	BenchPart make_part(S32 i)
+	{
+		static const U32 FLAGS[] =
+		{
+			0,
+			LLPartData::LL_PART_INTERP_COLOR_MASK,
+			LLPartData::LL_PART_INTERP_SCALE_MASK,
+			LLPartData::LL_PART_INTERP_COLOR_MASK | LLPartData::LL_PART_INTERP_SCALE_MASK,
+			LLPartData::LL_PART_INTERP_COLOR_MASK | LLPartData::LL_PART_EMISSIVE_MASK,
+			LLPartData::LL_PART_INTERP_COLOR_MASK | LLPartData::LL_PART_FOLLOW_VELOCITY_MASK,
+			LLPartData::LL_PART_INTERP_COLOR_MASK | LLPartData::LL_PART_BOUNCE_MASK,
+			LLPartData::LL_PART_INTERP_SCALE_MASK | LLPartData::LL_PART_FOLLOW_SRC_MASK
+		};
+
+		BenchPart part;
+		part.mFlags = FLAGS[i % LL_ARRAY_SIZE(FLAGS)];
+		part.mMaxAge = 1000.f + ll_frand(10.f);
+		part.mStartColor.setVec(ll_frand(), ll_frand(), ll_frand(), 1.f);
+		part.mEndColor.setVec(ll_frand(), ll_frand(), ll_frand(), 0.f);
+		part.mStartScale.setVec(0.1f + ll_frand(), 0.1f + ll_frand());
+		part.mEndScale.setVec(0.1f + ll_frand(), 0.1f + ll_frand());
+		part.mPosAgent = SOURCE_POS + LLVector3(ll_frand(2.f) - 1.f, ll_frand(2.f) - 1.f, ll_frand(2.f));
+		part.mPosOffset = part.mPosAgent - SOURCE_POS;
+		part.mVelocity.setVec(ll_frand(2.f) - 1.f, ll_frand(2.f) - 1.f, ll_frand(4.f));
+		part.mAccel.setVec(0.f, 0.f, -0.5f - ll_frand());
+		part.mColor = part.mStartColor;
+		part.mScale = part.mStartScale;
+		part.mSkipOffset = ll_frand(0.05f);
+		return part;
+	}
+
+	void set_part(LLPartStore& store, S32 index, const BenchPart& part)
+	{
+		store.setPartData(index, part);
+		store.mAge[index] = part.mAge;
+		store.mSkipOffset[index] = part.mSkipOffset;
+		store.mPosAgent[index] = part.mPosAgent;
+		store.mVelocity[index] = part.mVelocity;
+		store.mAccel[index] = part.mAccel;
+		store.mColor[index] = part.mColor;
+		store.mScale[index] = part.mScale;
+	}
+
+	void get_part(const LLPartStore& store, S32 index, BenchPart& part)
+	{
+		store.getPartData(index, part);
+		part.mAge = store.mAge[index];
+		part.mSkipOffset = store.mSkipOffset[index];
+		part.mPosAgent = store.mPosAgent[index];
+		part.mVelocity = store.mVelocity[index];
+		part.mAccel = store.mAccel[index];
+		part.mColor = store.mColor[index];
+		part.mScale = store.mScale[index];
+	}
+
+	// One frame the way LLViewerPartGroup::updateParticles() does it
+	void update_store(LLPartStore& store, F32 dt)
+	{
+		store.updateSimple(dt, 0.f);
+		BenchPart part;
+		for (S32 i = store.getNumSimple(); i < store.size(); ++i)
+		{
+			get_part(store, i, part);
+			F32 part_dt = dt - part.mSkipOffset;
+			part.mSkipOffset = 0.f;
+			update_part(part, part_dt);
+			set_part(store, i, part);
+		}
+	}
+
+	void update_list(std::vector<BenchPart*>& parts, F32 dt)
+	{
+		for (std::vector<BenchPart*>::iterator iter = parts.begin(); iter != parts.end(); ++iter)
+		{
+			BenchPart* part = *iter;
+			F32 part_dt = dt - part->mSkipOffset;
+			part->mSkipOffset = 0.f;
+			update_part(*part, part_dt);
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	S32 num_parts = 8192;
+	S32 num_frames = 200;
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		S32 value = llmax(1, atoi(argv[i + 1]));
+		if (!strcmp(argv[i], "-n"))
+		{
+			num_parts = value;
+		}
+		else if (!strcmp(argv[i], "-f"))
+		{
+			num_frames = value;
+		}
+	}
+	const F32 DT = 1.f / 60.f;
+
+	std::vector<BenchPart*> list;
+	LLPartStore store;
+	for (S32 i = 0; i < num_parts; ++i)
+	{
+		BenchPart part = make_part(i);
+		list.push_back(new BenchPart(part));
+		S32 index = store.add(part, (part.mFlags & LLPartStore::COMPLEX_MASK) != 0);
+		set_part(store, index, part);
+		store.mSlot[index] = i;
+	}
+
+	LLTimer timer;
+	for (S32 frame = 0; frame < num_frames; ++frame)
+	{
+		update_list(list, DT);
+	}
+	F64 list_time = timer.getElapsedTimeF64();
+
+	timer.reset();
+	for (S32 frame = 0; frame < num_frames; ++frame)
+	{
+		update_store(store, DT);
+	}
+	F64 store_time = llmax(timer.getElapsedTimeF64(), 1.0e-9);
+
+	// same particles, same results
+	bool same = true;
+	for (S32 i = 0; i < store.size(); ++i)
+	{
+		const BenchPart* part = list[store.mSlot[i]];
+		same = same && store.mAge[i] == part->mAge && store.mPosAgent[i] == part->mPosAgent;
+	}
+	for_each(list.begin(), list.end(), DeletePointer());
+
+	printf("%d particles (%d simple), %d frames: per particle %.3f ms/frame, store %.3f ms/frame  %.2fx  %s\n",
+		   num_parts, store.getNumSimple(), num_frames,
+		   list_time * 1000.0 / num_frames, store_time * 1000.0 / num_frames,
+		   list_time / store_time,
+		   same ? "same particles" : "PARTICLE MISMATCH");
+	return same ? 0 : 1;
+}
@@ -0,0 +1,196 @@
+/**
+ * @file llmessagereceivethread.cpp
+ * @brief Thread that reads and decodes template messages for LLMessageSystem.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llmessagereceivethread.h"
+
+#include "llmessagetemplate.h"
+#include "net.h"
+
+//----------------------------------------------------------------------------
+
+LLReceivedMessage::LLReceivedMessage()
+	: mStatus(RM_DISCARD),
+	  mTrueSize(0),
+	  mReceiveSize(0),
+	  mCompressedSize(0),
+	  mPacketID(0),
+	  mReliable(FALSE),
+	  mResent(FALSE),
+	  mAcks(FALSE),
+	  mOnCircuit(FALSE),
+	  mTemplate(NULL),
+	  mData(NULL),
+	  mHeaderTemplate(NULL),
+	  mBuffer(NULL)
+{
+}
+
+LLReceivedMessage::~LLReceivedMessage()
+{
+	delete mData;
+	delete mBuffer;
+}
+
+void LLReceivedMessage::reset()
+{
+	// buffers are only allocated for the slots the queue actually uses
+	if (!mBuffer)
+	{
+		mBuffer = new Buffer;
+	}
+	mStatus = RM_DISCARD;
+	mSender.invalidate();
+	mReceivingIF.invalidate();
+	mTrueSize = 0;
+	mReceiveSize = 0;
+	mCompressedSize = 0;
+	mPacketID = 0;
+	mReliable = FALSE;
+	mResent = FALSE;
+	mAcks = FALSE;
+	mOnCircuit = FALSE;
+	mTemplate = NULL;
+	delete mData;
+	mData = NULL;
+	mHeaderTemplate = NULL;
+	mAckCallbacks.clear();
+	mExceptions.clear();
+}
+
+//----------------------------------------------------------------------------
+
+LLMessageReceiveThread::LLMessageReceiveThread(LLMessageSystem* msg)
+	: LLThread("Message receive"),
+	  mMessageSystem(msg),
+	  mReader(msg->mMessageNumbers),
+	  mCurrent(NULL),
+	  mThreadID(0),
+	  mHead(0),
+	  mTail(0)
+{
+	mReader.setCountReceives(false);
+}
+
+LLMessageReceiveThread::~LLMessageReceiveThread()
+{
+	// Stop here rather than in ~LLThread, since run() uses our members.
+	// The thread never waits longer than RECEIVE_WAIT_MSEC for the socket.
+	setQuitting();
+	S32 timeout = 100;
+	for ( ; timeout > 0 && !isStopped(); timeout--)
+	{
+		ms_sleep(10);
+	}
+	if (!isStopped())
+	{
+		llwarns << "~LLMessageReceiveThread timed out!" << llendl;
+	}
+}
+
+LLReceivedMessage* LLMessageReceiveThread::front()
+{
+	U32 tail = mTail;
+	if (tail == (U32)mHead)
+	{
+		return NULL;
+	}
+	return &mQueue[tail & (QUEUE_SIZE - 1)];
+}
+
+void LLMessageReceiveThread::pop()
+{
+	mTail++;
+}
+
+LLReceivedMessage* LLMessageReceiveThread::nextFreeSlot()
+{
+	U32 head = mHead;
+	if (head - (U32)mTail >= QUEUE_SIZE)
+	{
+		return NULL;
+	}
+	return &mQueue[head & (QUEUE_SIZE - 1)];
+}
+
+void LLMessageReceiveThread::push()
+{
+	mHead++;
+}
+
+void LLMessageReceiveThread::deferException(EMessageException exception)
+{
+	if (mCurrent)
+	{
+		mCurrent->mExceptions.push_back(exception);
+	}
+}
+
+//virtual
+void LLMessageReceiveThread::run()
+{
+	mThreadID = LLThread::currentID();
+
+	while (1)
+	{
+		checkPause();
+
+		if (isQuitting())
+		{
+			break;
+		}
+
+		LLReceivedMessage* msgp = nextFreeSlot();
+		if (!msgp)
+		{
+			// The main thread is behind; leave the rest in the socket buffer
+			ms_sleep(1);
+			continue;
+		}
+
+		msgp->reset();
+		mCurrent = msgp;
+		BOOL received = mMessageSystem->receiveMessageOnThread(*msgp, mReader, mExpandBuffer);
+		mCurrent = NULL;
+
+		if (received)
+		{
+			push();
+		}
+		else
+		{
+			wait_for_packet(mMessageSystem->mSocket, RECEIVE_WAIT_MSEC);
+		}
+	}
+	llinfos << "LLMessageReceiveThread " << mName << " EXITING." << llendl;
+}
@@ -0,0 +1,153 @@
+/**
+ * @file llmessagereceivethread.h
+ * @brief Thread that reads and decodes template messages for LLMessageSystem.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLMESSAGERECEIVETHREAD_H
+#define LL_LLMESSAGERECEIVETHREAD_H
+
+#include <vector>
+
+#include "llapr.h"
+#include "llcircuit.h"
+#include "llhost.h"
+#include "llsocks5.h"
+#include "llthread.h"
+#include "lltemplatemessagereader.h"
+#include "message.h"
+
+class LLMessageTemplate;
+class LLMsgData;
+
+// One datagram as read by the receive thread, with everything that must
+// still happen on the main thread.
+class LLReceivedMessage
+{
+public:
+	enum EStatus
+	{
+		RM_DISCARD,		// too short or malformed
+		RM_DUPLICATE,	// resend of a packet already seen
+		RM_INVALID,		// failed validation or decoding
+		RM_OFF_CIRCUIT,	// valid message from an unknown circuit
+		RM_UNTRUSTED,	// trusted message on an untrusted circuit
+		RM_ACKS,		// PacketAck, already applied to the circuit
+		RM_MESSAGE		// decoded, waiting for its handler
+	};
+
+	LLReceivedMessage();
+	~LLReceivedMessage();
+
+	void reset();
+	U8* getBuffer() { return mBuffer->data; }
+
+	EStatus mStatus;
+	LLHost mSender;
+	LLHost mReceivingIF;
+	S32 mTrueSize;			// bytes read from the socket
+	S32 mReceiveSize;		// message size after acks and zero coding are removed
+	S32 mCompressedSize;	// see LLMessageSystem::getReceiveCompressedSize()
+	TPACKETID mPacketID;
+	BOOL mReliable;
+	BOOL mResent;
+	BOOL mAcks;
+	BOOL mOnCircuit;
+	LLMessageTemplate* mTemplate;
+	LLMsgData* mData;
+
+	// Template named by the header, even if the message then failed
+	// validation; the main thread counts the receive against it.
+	LLMessageTemplate* mHeaderTemplate;
+
+	// Callbacks of reliable packets this datagram acked, and message
+	// exceptions raised while reading it.
+	deferred_ack_callback_list_t mAckCallbacks;
+	std::vector<EMessageException> mExceptions;
+
+private:
+// Same layout as LLMessageSystem's receive buffer: SOCKS may write its
+// header in front of the data.
+#pragma pack(push,1)
+	struct Buffer
+	{
+		proxywrap_t header;
+		U8 data[MAX_BUFFER_SIZE];
+	};
+#pragma pack(pop)
+
+	Buffer* mBuffer;
+};
+
+// Drains the message system's socket, validates and decodes each packet and
+// does the circuit's ack bookkeeping, then queues the result for
+// LLMessageSystem::checkMessages() to hand to the message handlers.
+class LLMessageReceiveThread : public LLThread
+{
+public:
+	LLMessageReceiveThread(LLMessageSystem* msg);
+	~LLMessageReceiveThread();
+
+	// Main thread: oldest decoded message, or NULL if there is none.  Call
+	// pop() once done with it.
+	LLReceivedMessage* front();
+	void pop();
+
+	bool isReceiveThread() const { return LLThread::currentID() == mThreadID; }
+
+	// Receive thread: records an exception for the packet being read.
+	void deferException(EMessageException exception);
+
+private:
+	/*virtual*/ void run(void);
+
+	enum
+	{
+		QUEUE_SIZE = 256,			// power of 2
+		RECEIVE_WAIT_MSEC = 10
+	};
+
+	// Receive thread side of the queue
+	LLReceivedMessage* nextFreeSlot();
+	void push();
+
+	LLMessageSystem* mMessageSystem;
+	LLTemplateMessageReader mReader;
+	U8 mExpandBuffer[MAX_BUFFER_SIZE];
+	LLReceivedMessage* mCurrent;
+	U32 mThreadID;
+
+	// Single producer, single consumer: only the receive thread advances
+	// mHead and only the main thread advances mTail.
+	LLReceivedMessage mQueue[QUEUE_SIZE];
+	LLAtomicU32 mHead;
+	LLAtomicU32 mTail;
+};
+
+#endif // LL_LLMESSAGERECEIVETHREAD_H
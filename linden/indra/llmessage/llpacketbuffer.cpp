@@ -62,6 +62,11 @@ LLPacketBuffer::LLPacketBuffer (S32 hSocket)
 	init(hSocket);
 }
 
+LLPacketBuffer::LLPacketBuffer ()
+	: mSize(0)
+{
+}
+
 ///////////////////////////////////////////////////////////
 
 LLPacketBuffer::~LLPacketBuffer ()
@@ -77,3 +82,13 @@ void LLPacketBuffer::init (S32 hSocket)
 	mReceivingIF = ::get_receiving_interface();
 }
 
+void LLPacketBuffer::init (const LLHost &host, const char *datap, const S32 size, const LLHost &receiving_if)
+{
+	mHost = host;
+	mReceivingIF = receiving_if;
+	mSize = llclamp(size, 0, NET_BUFFER_SIZE);
+	if (datap != NULL)
+	{
+		memcpy(mData, datap, mSize);	/*Flawfinder: ignore*/
+	}
+}
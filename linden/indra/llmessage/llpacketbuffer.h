@@ -42,6 +42,7 @@ class LLPacketBuffer
 public:
 	LLPacketBuffer(const LLHost &host, const char *datap, const S32 size);
 	LLPacketBuffer(S32 hSocket);           // receive a packet
+	LLPacketBuffer();
 	~LLPacketBuffer();
 
 	S32			getSize() const					{ return mSize; }
@@ -49,6 +50,7 @@ public:
 	LLHost		getHost() const					{ return mHost; }
 	LLHost		getReceivingInterface() const	{ return mReceivingIF; }
 	void init(S32 hSocket);
+	void init(const LLHost &host, const char *datap, const S32 size, const LLHost &receiving_if);
 
 protected:
 	char	mData[NET_BUFFER_SIZE];        // packet data		/* Flawfinder : ignore */
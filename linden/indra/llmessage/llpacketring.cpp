@@ -39,6 +39,7 @@
 #include "lltimer.h"
 #include "timing.h"
 #include "llrand.h"
+#include "llstl.h"
 #include "u64.h"
 #include "llmessagelog.h"
 #include "message.h"
@@ -64,7 +65,13 @@ LLPacketRing::LLPacketRing () :
 	mInBufferLength(0),
 	mOutBufferLength(0),
 	mDropPercentage(0.0f),
-	mPacketsToDrop(0x0)
+	mPacketsToDrop(0x0),
+	mUseBatchIO(FALSE),
+	mBatchData(NULL),
+	mReceiveBatchCount(0),
+	mReceiveBatchNext(0),
+	mSendBatchCount(0),
+	mSendBatchSocket(-1)
 {
 }
 
@@ -72,6 +79,8 @@ LLPacketRing::LLPacketRing () :
 LLPacketRing::~LLPacketRing ()
 {
 	cleanup();
+	delete[] mBatchData;
+	mBatchData = NULL;
 }
 	
 ///////////////////////////////////////////////////////////
@@ -92,6 +101,15 @@ void LLPacketRing::cleanup ()
 		delete packetp;
 		mSendQueue.pop();
 	}
+
+	for_each(mFreeReceiveBuffers.begin(), mFreeReceiveBuffers.end(), DeletePointer());
+	mFreeReceiveBuffers.clear();
+	for_each(mFreeSendBuffers.begin(), mFreeSendBuffers.end(), DeletePointer());
+	mFreeSendBuffers.clear();
+
+	mReceiveBatchCount = 0;
+	mReceiveBatchNext = 0;
+	mSendBatchCount = 0;
 }
 
 ///////////////////////////////////////////////////////////
@@ -125,6 +143,110 @@ void LLPacketRing::setOutBandwidth(const F32 bps)
 {
 	mOutThrottle.setRate(bps);
 }
+
+void LLPacketRing::setUseBatchIO(const BOOL use_batch)
+{
+	if (use_batch && !mBatchData)
+	{
+		mBatchData = new char[2 * NET_PACKET_BATCH_SIZE * NET_BUFFER_SIZE];
+		for (S32 i = 0; i < NET_PACKET_BATCH_SIZE; i++)
+		{
+			mReceiveBatch[i].mData = mBatchData + i * NET_BUFFER_SIZE;
+			mSendBatch[i].mData = mBatchData + (NET_PACKET_BATCH_SIZE + i) * NET_BUFFER_SIZE;
+		}
+	}
+	if (!use_batch)
+	{
+		// Packets already received are still handed out by receivePacket()
+		flushSends();
+	}
+	mUseBatchIO = use_batch;
+}
+
+void LLPacketRing::flushSends()
+{
+	if (mSendBatchCount > 0)
+	{
+		send_packets(mSendBatchSocket, mSendBatch, mSendBatchCount);
+		mSendBatchCount = 0;
+	}
+}
+
+///////////////////////////////////////////////////////////
+// Returns the next packet of the receive batch, reading a new batch when
+// the current one is used up. NULL if there is nothing to read.
+const LLNetPacket* LLPacketRing::nextReceivedPacket(S32 socket)
+{
+	if (mReceiveBatchNext >= mReceiveBatchCount)
+	{
+		mReceiveBatchNext = 0;
+		mReceiveBatchCount = 0;
+		if (mUseBatchIO)
+		{
+			mReceiveBatchCount = receive_packets(socket, mReceiveBatch, NET_PACKET_BATCH_SIZE);
+		}
+		if (!mReceiveBatchCount)
+		{
+			return NULL;
+		}
+	}
+	return &mReceiveBatch[mReceiveBatchNext++];
+}
+
+void LLPacketRing::receiveIntoBuffer(S32 socket, LLPacketBuffer* packetp)
+{
+	if (mUseBatchIO || mReceiveBatchNext < mReceiveBatchCount)
+	{
+		const LLNetPacket* net_packetp = nextReceivedPacket(socket);
+		if (net_packetp)
+		{
+			packetp->init(LLHost(net_packetp->mIP, net_packetp->mPort), net_packetp->mData, net_packetp->mSize,
+						  LLHost(net_packetp->mReceivingIP, INVALID_PORT));
+		}
+		else
+		{
+			packetp->init(LLHost(), NULL, 0, LLHost());
+		}
+	}
+	else
+	{
+		packetp->init(socket);
+	}
+}
+
+void LLPacketRing::queueSend(int h_socket, const char * send_buffer, S32 buf_size, const LLHost& host)
+{
+	if (mSendBatchCount > 0 && h_socket != mSendBatchSocket)
+	{
+		flushSends();
+	}
+	mSendBatchSocket = h_socket;
+	LLNetPacket& packet = mSendBatch[mSendBatchCount++];
+	packet.mSize = llmin(buf_size, NET_BUFFER_SIZE);
+	memcpy(packet.mData, send_buffer, packet.mSize);	/*Flawfinder: ignore*/
+	packet.mIP = host.getAddress();
+	packet.mPort = host.getPort();
+	if (mSendBatchCount == NET_PACKET_BATCH_SIZE)
+	{
+		flushSends();
+	}
+}
+
+LLPacketBuffer* LLPacketRing::allocPacketBuffer(packet_pool_t& pool)
+{
+	if (pool.empty())
+	{
+		return new LLPacketBuffer();
+	}
+	LLPacketBuffer* packetp = pool.back();
+	pool.pop_back();
+	return packetp;
+}
+
+void LLPacketRing::freePacketBuffer(packet_pool_t& pool, LLPacketBuffer* packetp)
+{
+	pool.push_back(packetp);
+}
 ///////////////////////////////////////////////////////////
 S32 LLPacketRing::receiveFromRing (S32 socket, char *datap)
 {
@@ -153,7 +275,7 @@ S32 LLPacketRing::receiveFromRing (S32 socket, char *datap)
 	// need to set sender IP/port!!
 	mLastSender = packetp->getHost();
 	mLastReceivingIF = packetp->getReceivingInterface();
-	delete packetp;
+	freePacketBuffer(mFreeReceiveBuffers, packetp);
 
 	this->mInBufferLength -= packet_size;
 
@@ -175,8 +297,8 @@ S32 LLPacketRing::receivePacket (S32 socket, char *datap)
 		// push any current net packet (if any) onto delay ring
 		while (!done)
 		{
-			LLPacketBuffer *packetp;
-			packetp = new LLPacketBuffer(socket);
+			LLPacketBuffer *packetp = allocPacketBuffer(mFreeReceiveBuffers);
+			receiveIntoBuffer(socket, packetp);
 
 			if (packetp->getSize())
 			{
@@ -190,7 +312,7 @@ S32 LLPacketRing::receivePacket (S32 socket, char *datap)
 
 				if (mPacketsToDrop)
 				{
-					delete packetp;
+					freePacketBuffer(mFreeReceiveBuffers, packetp);
 					packetp = NULL;
 					packet_size = 0;
 					mPacketsToDrop--;
@@ -205,7 +327,7 @@ S32 LLPacketRing::receivePacket (S32 socket, char *datap)
 				{
 					// Toss it.
 					llwarns << "Throwing away packet, overflowing buffer" << llendl;
-					delete packetp;
+					freePacketBuffer(mFreeReceiveBuffers, packetp);
 					packetp = NULL;
 				}
 				else if (packetp->getSize())
@@ -215,7 +337,7 @@ S32 LLPacketRing::receivePacket (S32 socket, char *datap)
 				}
 				else
 				{
-					delete packetp;
+					freePacketBuffer(mFreeReceiveBuffers, packetp);
 					packetp = NULL;
 					done = true;
 				}
@@ -233,7 +355,19 @@ S32 LLPacketRing::receivePacket (S32 socket, char *datap)
 	else
 	{
 		// no delay, pull straight from net
-		if (LLSocks::isEnabled())
+		// (SOCKS wrapped packets only take the unbatched path)
+		if ((mUseBatchIO && !LLSocks::isEnabled()) || mReceiveBatchNext < mReceiveBatchCount)
+		{
+			const LLNetPacket* net_packetp = nextReceivedPacket(socket);
+			if (net_packetp)
+			{
+				packet_size = net_packetp->mSize;
+				memcpy(datap, net_packetp->mData, packet_size);	/*Flawfinder: ignore*/
+				mLastSender = LLHost(net_packetp->mIP, net_packetp->mPort);
+				mLastReceivingIF = LLHost(net_packetp->mReceivingIP, INVALID_PORT);
+			}
+		}
+		else if (LLSocks::isEnabled())
 		{
 			proxywrap_t * header;
 			datap  = datap-10;
@@ -245,15 +379,15 @@ S32 LLPacketRing::receivePacket (S32 socket, char *datap)
 			{
 				packet_size -= 10;			
 			}
+			mLastReceivingIF = ::get_receiving_interface();
 		}
 		else
 		{
 			packet_size = receive_packet(socket, datap);		
 			mLastSender = ::get_sender();
+			mLastReceivingIF = ::get_receiving_interface();
 		}
 
-		mLastReceivingIF = ::get_receiving_interface();
-
 		if (packet_size)  // did we actually get a packet?
 		{
 			if (mDropPercentage && (ll_frand(100.f) < mDropPercentage))
@@ -303,7 +437,7 @@ BOOL LLPacketRing::sendPacket(int h_socket, char * send_buffer, S32 buf_size, LL
 
 				status = doSendPacket(h_socket, packetp->getData(), packet_size, packetp->getHost());
 				
-				delete packetp;
+				freePacketBuffer(mFreeSendBuffers, packetp);
 				// Update the throttle
 				mOutThrottle.throttleOverflow(packet_size * 8.f);
 			}
@@ -339,7 +473,8 @@ BOOL LLPacketRing::sendPacket(int h_socket, char * send_buffer, S32 buf_size, LL
 				llinfos << "Outbound packet queue " << mOutBufferLength << " bytes" << llendl;
 				queue_timer.reset();
 			}
-			packetp = new LLPacketBuffer(host, send_buffer, buf_size);
+			packetp = allocPacketBuffer(mFreeSendBuffers);
+			packetp->init(host, send_buffer, buf_size, LLHost());
 
 			mOutBufferLength += packetp->getSize();
 			mSendQueue.push(packetp);
@@ -354,6 +489,12 @@ BOOL LLPacketRing::doSendPacket(int h_socket, const char * send_buffer, S32 buf_
 	
 	if (!LLSocks::isEnabled())
 	{
+		if (mUseBatchIO)
+		{
+			// Errors are only logged once the batch goes out
+			queueSend(h_socket, send_buffer, buf_size, host);
+			return TRUE;
+		}
 		return send_packet(h_socket, send_buffer, buf_size, host.getAddress(), host.getPort());
 	}
 
@@ -35,6 +35,7 @@
 #define LL_LLPACKETRING_H
 
 #include <queue>
+#include <vector>
 
 #include "llpacketbuffer.h"
 #include "llhost.h"
@@ -61,6 +62,12 @@ public:
 
 	BOOL sendPacket(int h_socket, char * send_buffer, S32 buf_size, LLHost host);
 
+	// Batched socket I/O: packets are received NET_PACKET_BATCH_SIZE at a time,
+	// and sends are queued until flushSends() or until a batch is full.
+	void setUseBatchIO(const BOOL use_batch);
+	BOOL getUseBatchIO() const					{ return mUseBatchIO; }
+	void flushSends();
+
 	inline LLHost getLastSender();
 	inline LLHost getLastReceivingInterface();
 
@@ -91,6 +98,28 @@ protected:
 
 	BOOL doSendPacket(int h_socket, const char * send_buffer, S32 buf_size, LLHost host);
 	U8	 mProxyWrappedSendBuffer[NET_BUFFER_SIZE];
+
+	const LLNetPacket* nextReceivedPacket(S32 socket);
+	void receiveIntoBuffer(S32 socket, LLPacketBuffer* packetp);
+	void queueSend(int h_socket, const char * send_buffer, S32 buf_size, const LLHost& host);
+
+	// Throttle queue buffers are recycled instead of reallocated for every
+	// packet.  Receive and send keep separate pools so that the two sides
+	// can run on different threads.
+	typedef std::vector<LLPacketBuffer *> packet_pool_t;
+	LLPacketBuffer* allocPacketBuffer(packet_pool_t& pool);
+	void freePacketBuffer(packet_pool_t& pool, LLPacketBuffer* packetp);
+	packet_pool_t mFreeReceiveBuffers;
+	packet_pool_t mFreeSendBuffers;
+
+	BOOL mUseBatchIO;
+	char* mBatchData;				// packet data for both batches
+	LLNetPacket mReceiveBatch[NET_PACKET_BATCH_SIZE];
+	S32 mReceiveBatchCount;
+	S32 mReceiveBatchNext;			// next packet to hand out
+	LLNetPacket mSendBatch[NET_PACKET_BATCH_SIZE];
+	S32 mSendBatchCount;
+	int mSendBatchSocket;
 };
 
 
@@ -0,0 +1,273 @@
+/**
+ * @file llpartstore.cpp
+ * @brief Structure-of-arrays storage and update kernel for particles.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llpartstore.h"
+
+LLPartStore::LLPartStore()
+	: mNumSimple(0)
+{
+}
+
+S32 LLPartStore::add(const LLPartData& data, bool complex)
+{
+	push();
+	S32 index = size() - 1;
+	if (!complex)
+	{
+		if (index != mNumSimple)
+		{
+			// make room by moving the first complex particle to the end
+			move(mNumSimple, index);
+		}
+		index = mNumSimple++;
+	}
+
+	setPartData(index, data);
+	mAge[index] = 0.f;
+	mSkipOffset[index] = 0.f;
+	mPosAgent[index].clear();
+	mVelocity[index].clear();
+	mAccel[index].clear();
+	mColor[index] = LLColor4();
+	mScale[index].clear();
+	mSlot[index] = -1;
+	return index;
+}
+
+void LLPartStore::remove(S32 index)
+{
+	llassert(index >= 0 && index < size());
+	S32 last = size() - 1;
+	if (index < mNumSimple)
+	{
+		S32 last_simple = --mNumSimple;
+		if (index != last_simple)
+		{
+			move(last_simple, index);
+		}
+		if (last_simple != last)
+		{
+			move(last, last_simple);
+		}
+	}
+	else if (index != last)
+	{
+		move(last, index);
+	}
+	pop();
+}
+
+void LLPartStore::clear()
+{
+	mFlags.clear();
+	mMaxAge.clear();
+	mStartColor.clear();
+	mEndColor.clear();
+	mStartScale.clear();
+	mEndScale.clear();
+	mPosOffset.clear();
+	mParameter.clear();
+	mAge.clear();
+	mSkipOffset.clear();
+	mPosAgent.clear();
+	mVelocity.clear();
+	mAccel.clear();
+	mColor.clear();
+	mScale.clear();
+	mSlot.clear();
+	mNumSimple = 0;
+}
+
+void LLPartStore::getPartData(S32 index, LLPartData& data) const
+{
+	data.mFlags = mFlags[index];
+	data.mMaxAge = mMaxAge[index];
+	data.mStartColor = mStartColor[index];
+	data.mEndColor = mEndColor[index];
+	data.mStartScale = mStartScale[index];
+	data.mEndScale = mEndScale[index];
+	data.mPosOffset = mPosOffset[index];
+	data.mParameter = mParameter[index];
+}
+
+void LLPartStore::setPartData(S32 index, const LLPartData& data)
+{
+	mFlags[index] = data.mFlags;
+	mMaxAge[index] = data.mMaxAge;
+	mStartColor[index] = data.mStartColor;
+	mEndColor[index] = data.mEndColor;
+	mStartScale[index] = data.mStartScale;
+	mEndScale[index] = data.mEndScale;
+	mPosOffset[index] = data.mPosOffset;
+	mParameter[index] = data.mParameter;
+}
+
+// Each pass is a flat loop over plain floats with no calls and no
+// branches, which the compiler can turn into SIMD code.  The arithmetic
+// is done in the same order as LLViewerPartGroup's per-particle update,
+// so both give the same results.
+void LLPartStore::updateSimple(F32 dt, F32 skipped_time)
+{
+	const S32 count = mNumSimple;
+	if (count == 0)
+	{
+		return;
+	}
+
+	mStepTime.resize(count);
+	mStepFrac.resize(count);
+	F32* step_time = &mStepTime[0];
+	F32* step_frac = &mStepFrac[0];
+
+	// Ages
+	const F32 group_dt = dt + skipped_time;
+	F32* age = &mAge[0];
+	F32* skip_offset = &mSkipOffset[0];
+	const F32* max_age = &mMaxAge[0];
+	for (S32 i = 0; i < count; ++i)
+	{
+		const F32 part_dt = group_dt - skip_offset[i];
+		const F32 cur_time = age[i] + part_dt;
+		step_time[i] = part_dt;
+		step_frac[i] = cur_time / max_age[i];
+		age[i] = cur_time;
+		skip_offset[i] = 0.f;
+	}
+
+	// Velocity interpolation
+	F32* pos = mPosAgent[0].mV;
+	F32* vel = mVelocity[0].mV;
+	const F32* accel = mAccel[0].mV;
+	for (S32 i = 0; i < count; ++i)
+	{
+		const F32 part_dt = step_time[i];
+		const F32 half_dt_sq = 0.5f*part_dt*part_dt;
+		for (S32 j = 3*i; j < 3*i + 3; ++j)
+		{
+			pos[j] += part_dt*vel[j];
+			pos[j] += half_dt_sq*accel[j];
+			vel[j] += accel[j]*part_dt;
+		}
+	}
+
+	// Color and scale interpolation, selected rather than branched on
+	const U32* flags = &mFlags[0];
+	F32* color = mColor[0].mV;
+	const F32* start_color = mStartColor[0].mV;
+	const F32* end_color = mEndColor[0].mV;
+	for (S32 i = 0; i < count; ++i)
+	{
+		const F32 frac = step_frac[i];
+		const bool interp = (flags[i] & LLPartData::LL_PART_INTERP_COLOR_MASK) != 0;
+		for (S32 j = 4*i; j < 4*i + 4; ++j)
+		{
+			const F32 lerp = start_color[j]*(1.f - frac) + frac*end_color[j];
+			color[j] = interp ? lerp : color[j];
+		}
+	}
+
+	F32* scale = mScale[0].mV;
+	const F32* start_scale = mStartScale[0].mV;
+	const F32* end_scale = mEndScale[0].mV;
+	for (S32 i = 0; i < count; ++i)
+	{
+		const F32 frac = step_frac[i];
+		const bool interp = (flags[i] & LLPartData::LL_PART_INTERP_SCALE_MASK) != 0;
+		for (S32 j = 2*i; j < 2*i + 2; ++j)
+		{
+			const F32 lerp = start_scale[j]*(1.f - frac) + frac*end_scale[j];
+			scale[j] = interp ? lerp : scale[j];
+		}
+	}
+}
+
+void LLPartStore::push()
+{
+	mFlags.push_back(0);
+	mMaxAge.push_back(0.f);
+	mStartColor.push_back(LLColor4());
+	mEndColor.push_back(LLColor4());
+	mStartScale.push_back(LLVector2());
+	mEndScale.push_back(LLVector2());
+	mPosOffset.push_back(LLVector3());
+	mParameter.push_back(0.f);
+	mAge.push_back(0.f);
+	mSkipOffset.push_back(0.f);
+	mPosAgent.push_back(LLVector3());
+	mVelocity.push_back(LLVector3());
+	mAccel.push_back(LLVector3());
+	mColor.push_back(LLColor4());
+	mScale.push_back(LLVector2());
+	mSlot.push_back(-1);
+}
+
+void LLPartStore::pop()
+{
+	mFlags.pop_back();
+	mMaxAge.pop_back();
+	mStartColor.pop_back();
+	mEndColor.pop_back();
+	mStartScale.pop_back();
+	mEndScale.pop_back();
+	mPosOffset.pop_back();
+	mParameter.pop_back();
+	mAge.pop_back();
+	mSkipOffset.pop_back();
+	mPosAgent.pop_back();
+	mVelocity.pop_back();
+	mAccel.pop_back();
+	mColor.pop_back();
+	mScale.pop_back();
+	mSlot.pop_back();
+}
+
+void LLPartStore::move(S32 from, S32 to)
+{
+	mFlags[to] = mFlags[from];
+	mMaxAge[to] = mMaxAge[from];
+	mStartColor[to] = mStartColor[from];
+	mEndColor[to] = mEndColor[from];
+	mStartScale[to] = mStartScale[from];
+	mEndScale[to] = mEndScale[from];
+	mPosOffset[to] = mPosOffset[from];
+	mParameter[to] = mParameter[from];
+	mAge[to] = mAge[from];
+	mSkipOffset[to] = mSkipOffset[from];
+	mPosAgent[to] = mPosAgent[from];
+	mVelocity[to] = mVelocity[from];
+	mAccel[to] = mAccel[from];
+	mColor[to] = mColor[from];
+	mScale[to] = mScale[from];
+	mSlot[to] = mSlot[from];
+}
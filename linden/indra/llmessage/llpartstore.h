@@ -0,0 +1,109 @@
+/**
+ * @file llpartstore.h
+ * @brief Structure-of-arrays storage and update kernel for particles.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLPARTSTORE_H
+#define LL_LLPARTSTORE_H
+
+#include <vector>
+
+#include "llpartdata.h"
+
+// The particles of one particle group, one array per field.  Simple
+// particles, the ones updateSimple() can handle, are kept in front of the
+// ones that need a per-particle update (callbacks, following the source,
+// wind, targets, bouncing).  Removing a particle moves others into its
+// slot, so an index is only good until the next add() or remove().  The
+// arrays keep their capacity, so a busy group stops allocating.
+class LLPartStore
+{
+public:
+	enum
+	{
+		// Flags that keep a particle out of updateSimple()
+		COMPLEX_MASK = LLPartData::LL_PART_BOUNCE_MASK |
+					   LLPartData::LL_PART_WIND_MASK |
+					   LLPartData::LL_PART_FOLLOW_SRC_MASK |
+					   LLPartData::LL_PART_TARGET_POS_MASK |
+					   LLPartData::LL_PART_TARGET_LINEAR_MASK
+	};
+
+	LLPartStore();
+
+	S32 size() const { return (S32)mFlags.size(); }
+	bool empty() const { return mFlags.empty(); }
+	S32 getNumSimple() const { return mNumSimple; }
+
+	// Adds a particle with data's parameters and zeroed state and returns
+	// its index.  complex puts it with the particles updateSimple() skips.
+	S32 add(const LLPartData& data, bool complex);
+	void remove(S32 index);
+	void clear();
+
+	void getPartData(S32 index, LLPartData& data) const;
+	void setPartData(S32 index, const LLPartData& data);
+
+	// Ages the simple particles by dt + skipped_time - mSkipOffset and
+	// integrates their motion, color and scale.
+	void updateSimple(F32 dt, F32 skipped_time);
+
+	// LLPartData
+	std::vector<U32> mFlags;
+	std::vector<F32> mMaxAge;
+	std::vector<LLColor4> mStartColor;
+	std::vector<LLColor4> mEndColor;
+	std::vector<LLVector2> mStartScale;
+	std::vector<LLVector2> mEndScale;
+	std::vector<LLVector3> mPosOffset;
+	std::vector<F32> mParameter;
+
+	// Current state
+	std::vector<F32> mAge;				// Time since the particle was born
+	std::vector<F32> mSkipOffset;		// Group skipped time when the particle was added
+	std::vector<LLVector3> mPosAgent;
+	std::vector<LLVector3> mVelocity;
+	std::vector<LLVector3> mAccel;
+	std::vector<LLColor4> mColor;
+	std::vector<LLVector2> mScale;
+
+	std::vector<S32> mSlot;				// Owner's index for data kept elsewhere
+
+private:
+	void push();
+	void pop();
+	void move(S32 from, S32 to);
+
+	S32 mNumSimple;
+	std::vector<F32> mStepTime;
+	std::vector<F32> mStepFrac;
+};
+
+#endif // LL_LLPARTSTORE_H
@@ -0,0 +1,321 @@
+/**
+ * @file llpatchdecoder.cpp
+ * @brief Thread-safe terrain patch decoding with a vectorized inverse DCT.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#include "linden_common.h"
+
+#include "llpatchdecoder.h"
+
+#include "bitpack.h"
+#include "llmath.h"
+#include "llv4math.h"
+#include "patch_code.h"
+
+//----------------------------------------------------------------------------
+// LLPatchDecoder
+//----------------------------------------------------------------------------
+
+LLPatchDecoder::LLPatchDecoder()
+{
+	buildTables(NORMAL_PATCH_SIZE, mNormalTables);
+	buildTables(LARGE_PATCH_SIZE, mLargeTables);
+}
+
+// static
+void LLPatchDecoder::buildTables(S32 size, Tables& tables)
+{
+	build_patch_dequantize_table(size, tables.mDequantize);
+	setup_patch_icosines(size, tables.mICosines);
+	build_decopy_matrix(size, tables.mDeCopy);
+}
+
+BOOL LLPatchDecoder::decodeGroup(LLBitPack& bitpack, const LLGroupHeader& gopp, BOOL b_large_patch,
+								 S32 patches_per_edge, std::vector<LLDecodedPatch>& patches) const
+{
+	S32 size = gopp.patch_size;
+	if (size != NORMAL_PATCH_SIZE && size != LARGE_PATCH_SIZE)
+	{
+		llwarns << "Received invalid terrain packet - patch size " << size << llendl;
+		return FALSE;
+	}
+
+	LLPatchHeader ph;
+	S32 cpatch[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
+	while (1)
+	{
+		unpack_patch_header(bitpack, &ph, b_large_patch);
+		if (ph.quant_wbits == END_OF_PATCHES)
+		{
+			break;
+		}
+
+		S32 i, j;
+		if (b_large_patch)
+		{
+			i = ph.patchids >> 16; //x
+			j = ph.patchids & 0xFFFF; //y
+		}
+		else
+		{
+			i = ph.patchids >> 5; //x
+			j = ph.patchids & 0x1F; //y
+		}
+
+		if ((i >= patches_per_edge) || (j >= patches_per_edge))
+		{
+			llwarns << "Received invalid terrain packet - patch header patch ID incorrect!" 
+				<< " patches per edge " << patches_per_edge
+				<< " i " << i
+				<< " j " << j
+				<< " dc_offset " << ph.dc_offset
+				<< " range " << (S32)ph.range
+				<< " quant_wbits " << (S32)ph.quant_wbits
+				<< " patchids " << (S32)ph.patchids
+				<< llendl;
+			return FALSE;
+		}
+
+		unpack_patch(bitpack, cpatch, size, (ph.quant_wbits & 0xf) + 2);
+
+		patches.push_back(LLDecodedPatch());
+		LLDecodedPatch& patch = patches.back();
+		patch.mX = i;
+		patch.mY = j;
+		decompress(cpatch, ph, size, patch.mHeights, size);
+	}
+	return TRUE;
+}
+
+// The passes below do what decompress_patch() and the idct_ functions do,
+// with each sum taken in the same order, so the results are bit for bit
+// the same.  The column pass works on sixteen columns at once and the
+// line pass on sixteen outputs of a line at once.
+void LLPatchDecoder::decompress(const S32* cpatch, const LLPatchHeader& ph, S32 size, F32* heights, S32 stride) const
+{
+	const Tables& tables = (size == NORMAL_PATCH_SIZE) ? mNormalTables : mLargeTables;
+	const F32* icos = tables.mICosines;
+
+	LL_LLV4MATH_ALIGN_PREFIX F32 block[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE] LL_LLV4MATH_ALIGN_POSTFIX;
+	LL_LLV4MATH_ALIGN_PREFIX F32 temp[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE] LL_LLV4MATH_ALIGN_POSTFIX;
+
+	F32		range = ph.range;
+	S32		prequant = (ph.quant_wbits >> 4) + 2;
+	S32		quantize = 1<<prequant;
+	F32		hmin = ph.dc_offset;
+
+	F32		ooq = 1.f/(F32)quantize;
+	F32		mult = ooq*range;
+	F32		addval = mult*(F32)(1<<(prequant - 1))+hmin;
+
+	// Dequantize, undoing the zigzag order
+	const S32 count = size*size;
+	for (S32 i = 0; i < count; i++)
+	{
+		block[i] = (F32)cpatch[tables.mDeCopy[i]];
+	}
+	for (S32 i = 0; i < count; i++)
+	{
+		block[i] *= tables.mDequantize[i];
+	}
+
+	const F32 oosob = 2.f/size;
+#if LL_VECTORIZE
+	const __m128 oo_sqrt2 = _mm_set1_ps(OO_SQRT2);
+
+	// Columns: temp[n][c] = sum over u of block[u][c]*icos[u][n].  The
+	// four sums are kept apart so they don't wait on each other.
+	for (S32 n = 0; n < size; n++)
+	{
+		for (S32 c = 0; c < size; c += 16)
+		{
+			__m128 total0 = _mm_mul_ps(oo_sqrt2, _mm_load_ps(block + c));
+			__m128 total1 = _mm_mul_ps(oo_sqrt2, _mm_load_ps(block + c + 4));
+			__m128 total2 = _mm_mul_ps(oo_sqrt2, _mm_load_ps(block + c + 8));
+			__m128 total3 = _mm_mul_ps(oo_sqrt2, _mm_load_ps(block + c + 12));
+			for (S32 u = 1; u < size; u++)
+			{
+				const __m128 icos4 = _mm_set1_ps(icos[u*size + n]);
+				const F32* row = block + u*size + c;
+				total0 = _mm_add_ps(total0, _mm_mul_ps(_mm_load_ps(row), icos4));
+				total1 = _mm_add_ps(total1, _mm_mul_ps(_mm_load_ps(row + 4), icos4));
+				total2 = _mm_add_ps(total2, _mm_mul_ps(_mm_load_ps(row + 8), icos4));
+				total3 = _mm_add_ps(total3, _mm_mul_ps(_mm_load_ps(row + 12), icos4));
+			}
+			F32* out = temp + n*size + c;
+			_mm_store_ps(out, total0);
+			_mm_store_ps(out + 4, total1);
+			_mm_store_ps(out + 8, total2);
+			_mm_store_ps(out + 12, total3);
+		}
+	}
+
+	// Lines: block[l][n] = oosob * sum over u of temp[l][u]*icos[u][n]
+	const __m128 scale = _mm_set1_ps(oosob);
+	for (S32 l = 0; l < size; l++)
+	{
+		const F32* line = temp + l*size;
+		for (S32 n = 0; n < size; n += 16)
+		{
+			const __m128 first = _mm_mul_ps(oo_sqrt2, _mm_set1_ps(line[0]));
+			__m128 total0 = first;
+			__m128 total1 = first;
+			__m128 total2 = first;
+			__m128 total3 = first;
+			for (S32 u = 1; u < size; u++)
+			{
+				const __m128 line4 = _mm_set1_ps(line[u]);
+				const F32* cosines = icos + u*size + n;
+				total0 = _mm_add_ps(total0, _mm_mul_ps(line4, _mm_loadu_ps(cosines)));
+				total1 = _mm_add_ps(total1, _mm_mul_ps(line4, _mm_loadu_ps(cosines + 4)));
+				total2 = _mm_add_ps(total2, _mm_mul_ps(line4, _mm_loadu_ps(cosines + 8)));
+				total3 = _mm_add_ps(total3, _mm_mul_ps(line4, _mm_loadu_ps(cosines + 12)));
+			}
+			F32* out = block + l*size + n;
+			_mm_store_ps(out, _mm_mul_ps(total0, scale));
+			_mm_store_ps(out + 4, _mm_mul_ps(total1, scale));
+			_mm_store_ps(out + 8, _mm_mul_ps(total2, scale));
+			_mm_store_ps(out + 12, _mm_mul_ps(total3, scale));
+		}
+	}
+
+	const __m128 mult4 = _mm_set1_ps(mult);
+	const __m128 addval4 = _mm_set1_ps(addval);
+	for (S32 j = 0; j < size; j++)
+	{
+		F32* out = heights + j*stride;
+		const F32* in = block + j*size;
+		for (S32 i = 0; i < size; i += 4)
+		{
+			_mm_storeu_ps(out + i, _mm_add_ps(_mm_mul_ps(_mm_load_ps(in + i), mult4), addval4));
+		}
+	}
+#else
+	for (S32 n = 0; n < size; n++)
+	{
+		for (S32 c = 0; c < size; c++)
+		{
+			F32 total = OO_SQRT2*block[c];
+			for (S32 u = 1; u < size; u++)
+			{
+				total += block[u*size + c]*icos[u*size + n];
+			}
+			temp[n*size + c] = total;
+		}
+	}
+
+	for (S32 l = 0; l < size; l++)
+	{
+		const F32* line = temp + l*size;
+		for (S32 n = 0; n < size; n++)
+		{
+			F32 total = OO_SQRT2*line[0];
+			for (S32 u = 1; u < size; u++)
+			{
+				total += line[u]*icos[u*size + n];
+			}
+			block[l*size + n] = total*oosob;
+		}
+	}
+
+	for (S32 j = 0; j < size; j++)
+	{
+		F32* out = heights + j*stride;
+		const F32* in = block + j*size;
+		for (S32 i = 0; i < size; i++)
+		{
+			out[i] = in[i]*mult+addval;
+		}
+	}
+#endif
+}
+
+//----------------------------------------------------------------------------
+// LLPatchDecodeThread
+//----------------------------------------------------------------------------
+
+LLPatchDecodeThread::LLPatchDecodeThread(bool threaded)
+	: LLQueuedThread("Terrain decode", threaded)
+{
+}
+
+LLPatchDecodeThread::handle_t LLPatchDecodeThread::decode(U64 region_handle, U8* data, S32 size,
+														  BOOL b_large_patch, S32 patches_per_edge)
+{
+	handle_t handle = generateHandle();
+	DecodeRequest* req = new DecodeRequest(handle, mDecoder, region_handle,
+										   data, size, b_large_patch, patches_per_edge);
+	bool res = addRequest(req);
+	if (!res)
+	{
+		llerrs << "LLPatchDecodeThread::decode called after shutdown()" << llendl;
+	}
+	return handle;
+}
+
+LLPatchDecodeThread::DecodeRequest* LLPatchDecodeThread::getDecodeRequest(handle_t handle)
+{
+	return (DecodeRequest*)getRequest(handle);
+}
+
+LLPatchDecodeThread::DecodeRequest::DecodeRequest(handle_t handle, const LLPatchDecoder& decoder,
+												  U64 region_handle, U8* data, S32 size,
+												  BOOL b_large_patch, S32 patches_per_edge)
+	: LLQueuedThread::QueuedRequest(handle, LLQueuedThread::PRIORITY_NORMAL, 0),
+	  mDecoder(decoder),
+	  mRegionHandle(region_handle),
+	  mData(data),
+	  mSize(size),
+	  mLargePatch(b_large_patch),
+	  mPatchesPerEdge(patches_per_edge),
+	  mValid(FALSE),
+	  mPatchSize(0)
+{
+}
+
+LLPatchDecodeThread::DecodeRequest::~DecodeRequest()
+{
+	delete [] mData;
+}
+
+// virtual
+bool LLPatchDecodeThread::DecodeRequest::processRequest()
+{
+	LLBitPack bitpack(mData, mSize);
+	LLGroupHeader gopp;
+	unpack_patch_group_header(bitpack, &gopp);
+	mPatchSize = gopp.patch_size;
+	mValid = mDecoder.decodeGroup(bitpack, gopp, mLargePatch, mPatchesPerEdge, mPatches);
+
+	delete [] mData;
+	mData = NULL;
+	return true;
+}
@@ -0,0 +1,134 @@
+/**
+ * @file llpatchdecoder.h
+ * @brief Thread-safe terrain patch decoding with a vectorized inverse DCT.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#ifndef LL_LLPATCHDECODER_H
+#define LL_LLPATCHDECODER_H
+
+#include <vector>
+
+#include "llqueuedthread.h"
+#include "patch_dct.h"
+
+class LLBitPack;
+
+// One terrain patch of a LayerData group, decoded to heights
+struct LLDecodedPatch
+{
+	S32 mX;
+	S32 mY;
+	F32 mHeights[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];	// patch size rows of patch size heights
+};
+
+// Decodes the patches of a land layer without the global state that
+// patch_code.cpp and patch_idct.cpp keep, so any thread can use it.  The
+// dequantize, inverse DCT and output steps work on four heights at a time
+// where LL_VECTORIZE, and give exactly the heights decompress_patch() does.
+class LLPatchDecoder
+{
+public:
+	LLPatchDecoder();
+
+	// Decodes every patch after the group header up to END_OF_PATCHES.
+	// Returns FALSE, keeping the patches decoded until then, if the group
+	// has a patch size other than 16 or 32 or names a patch outside
+	// patches_per_edge.
+	BOOL decodeGroup(LLBitPack& bitpack, const LLGroupHeader& gopp, BOOL b_large_patch,
+					 S32 patches_per_edge, std::vector<LLDecodedPatch>& patches) const;
+
+	// Dequantizes and inverse transforms one patch's coefficients into
+	// size rows of heights, stride apart.  size is 16 or 32.
+	void decompress(const S32* cpatch, const LLPatchHeader& ph, S32 size, F32* heights, S32 stride) const;
+
+private:
+	struct Tables
+	{
+		F32 mDequantize[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
+		F32 mICosines[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
+		S32 mDeCopy[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
+	};
+
+	static void buildTables(S32 size, Tables& tables);
+
+	Tables mNormalTables;
+	Tables mLargeTables;
+};
+
+// Decodes land layers in the background.  The caller keeps the handles
+// decode() returns and, once getRequestStatus() says STATUS_COMPLETE,
+// takes the patches from getDecodeRequest() and calls completeRequest().
+// Requests finish in the order they were made.
+class LLPatchDecodeThread : public LLQueuedThread
+{
+public:
+	class DecodeRequest : public LLQueuedThread::QueuedRequest
+	{
+	protected:
+		virtual ~DecodeRequest(); // use deleteRequest()
+
+	public:
+		DecodeRequest(handle_t handle, const LLPatchDecoder& decoder, U64 region_handle,
+					  U8* data, S32 size, BOOL b_large_patch, S32 patches_per_edge);
+
+		/*virtual*/ bool processRequest();
+
+		U64 getRegionHandle() const { return mRegionHandle; }
+		// FALSE if the data was bad; getPatches() has what came before it
+		BOOL isValid() const { return mValid; }
+		S32 getPatchSize() const { return mPatchSize; }
+		const std::vector<LLDecodedPatch>& getPatches() const { return mPatches; }
+
+	private:
+		const LLPatchDecoder& mDecoder;
+		U64 mRegionHandle;
+		U8* mData;
+		S32 mSize;
+		BOOL mLargePatch;
+		S32 mPatchesPerEdge;
+
+		BOOL mValid;
+		S32 mPatchSize;
+		std::vector<LLDecodedPatch> mPatches;
+	};
+
+	LLPatchDecodeThread(bool threaded = true);
+
+	// Takes ownership of data, a land layer starting with its group header.
+	handle_t decode(U64 region_handle, U8* data, S32 size, BOOL b_large_patch, S32 patches_per_edge);
+
+	DecodeRequest* getDecodeRequest(handle_t handle);
+
+private:
+	LLPatchDecoder mDecoder;
+};
+
+#endif // LL_LLPATCHDECODER_H
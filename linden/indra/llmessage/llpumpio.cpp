@@ -42,6 +42,7 @@
 #include "llapr.h"
 #include "llmemtype.h"
 #include "llstl.h"
+#include "llsdutil.h"
 #include "llstat.h"
 #include "llthread.h"
 #include "llfasttimer.h"
@@ -179,6 +180,9 @@ LLPumpIO::LLPumpIO(void) :
 	mCurrentPoolReallocCount(0),
 	mChainsMutex(NULL),
 	mCallbackMutex(NULL),
+	mChainsCondition(NULL),
+	mWake(false),
+	mCurrentChainAddTime(0),
 	mCurrentChain(mRunningChains.end())
 {
 	mCurrentChain = mRunningChains.end();
@@ -190,10 +194,10 @@ LLPumpIO::LLPumpIO(void) :
 LLPumpIO::~LLPumpIO()
 {
 	LLMemType m1(LLMemType::MTYPE_IO_PUMP);
-#if LL_THREADS_APR
+	if (mChainsCondition) apr_thread_cond_destroy(mChainsCondition);
 	if (mChainsMutex) apr_thread_mutex_destroy(mChainsMutex);
 	if (mCallbackMutex) apr_thread_mutex_destroy(mCallbackMutex);
-#endif
+	mChainsCondition = NULL;
 	mChainsMutex = NULL;
 	mCallbackMutex = NULL;
 	if(mPollset)
@@ -209,10 +213,9 @@ bool LLPumpIO::addChain(const chain_t& chain, F32 timeout)
 	LLMemType m1(LLMemType::MTYPE_IO_PUMP);
 	if(chain.empty()) return false;
 
-#if LL_THREADS_APR
 	LLScopedLock lock(mChainsMutex);
-#endif
 	LLChainInfo info;
+	info.mAddTime = totalTime();
 	info.setTimeoutSeconds(timeout);
 	info.mData = LLIOPipe::buffer_ptr_t(new LLBufferArray);
 	LLLinkInfo link;
@@ -231,6 +234,7 @@ bool LLPumpIO::addChain(const chain_t& chain, F32 timeout)
 		info.mChainLinks.push_back(link);
 	}
 	mPendingChains.push_back(info);
+	if(mChainsCondition) apr_thread_cond_signal(mChainsCondition);
 	return true;
 }
 
@@ -248,9 +252,7 @@ bool LLPumpIO::addChain(
 	if(!data) return false;
 	if(links.empty()) return false;
 
-#if LL_THREADS_APR
 	LLScopedLock lock(mChainsMutex);
-#endif
 #if LL_DEBUG_PIPE_TYPE_IN_PUMP
 	lldebugs << "LLPumpIO::addChain() " << links[0].mPipe << " '"
 		<< typeid(*(links[0].mPipe)).name() << "'" << llendl;
@@ -258,11 +260,14 @@ bool LLPumpIO::addChain(
 	lldebugs << "LLPumpIO::addChain() " << links[0].mPipe << llendl;
 #endif
 	LLChainInfo info;
+	info.mAddTime = totalTime();
 	info.setTimeoutSeconds(timeout);
 	info.mChainLinks = links;
 	info.mData = data;
-	info.mContext = context;
+	// the chain may run on a pump thread
+	info.mContext = llsd_clone(context);
 	mPendingChains.push_back(info);
+	if(mChainsCondition) apr_thread_cond_signal(mChainsCondition);
 	return true;
 }
 
@@ -405,9 +410,7 @@ void LLPumpIO::clearLock(S32 key)
 	// therefore won't be treading into deleted memory. I think we can
 	// also clear the lock on the chain safely since the pump only
 	// reads that value.
-#if LL_THREADS_APR
 	LLScopedLock lock(mChainsMutex);
-#endif
 	mClearLocks.insert(key);
 }
 
@@ -461,9 +464,7 @@ void LLPumpIO::pump(const S32& poll_timeout)
 	PUMP_DEBUG;
 	if(true)
 	{
-#if LL_THREADS_APR
 		LLScopedLock lock(mChainsMutex);
-#endif
 		// bail if this pump is paused.
 		if(PAUSING == mState)
 		{
@@ -555,6 +556,7 @@ void LLPumpIO::pump(const S32& poll_timeout)
 	while( run_chain != mRunningChains.end() )
 	{
 		PUMP_DEBUG;
+		mCurrentChainAddTime = (*run_chain).mAddTime;
 		if((*run_chain).mInit
 		   && (*run_chain).mTimer.getStarted()
 		   && (*run_chain).mTimer.hasExpired())
@@ -723,9 +725,38 @@ void LLPumpIO::pump(const S32& poll_timeout)
 	PUMP_DEBUG;
 	// null out the chain
 	mCurrentChain = mRunningChains.end();
+	mCurrentChainAddTime = 0;
 	END_PUMP_DEBUG;
 }
 
+void LLPumpIO::waitForChains(S64 timeout_usecs)
+{
+	if(!mChainsCondition) return;
+	LLScopedLock lock(mChainsMutex);
+	if(!mWake && mPendingChains.empty())
+	{
+		if(mRunningChains.empty())
+		{
+			apr_thread_cond_wait(mChainsCondition, mChainsMutex);
+		}
+		else
+		{
+			apr_thread_cond_timedwait(
+				mChainsCondition,
+				mChainsMutex,
+				(apr_interval_time_t)timeout_usecs);
+		}
+	}
+	mWake = false;
+}
+
+void LLPumpIO::wake()
+{
+	LLScopedLock lock(mChainsMutex);
+	mWake = true;
+	if(mChainsCondition) apr_thread_cond_signal(mChainsCondition);
+}
+
 //bool LLPumpIO::respond(const chain_t& pipes)
 //{
 //#if LL_THREADS_APR
@@ -743,10 +774,10 @@ bool LLPumpIO::respond(LLIOPipe* pipe)
 	LLMemType m1(LLMemType::MTYPE_IO_PUMP);
 	if(NULL == pipe) return false;
 
-#if LL_THREADS_APR
 	LLScopedLock lock(mCallbackMutex);
-#endif
 	LLChainInfo info;
+	info.mAddTime = mCurrentChainAddTime;
+	info.mRespondTime = totalTime();
 	LLLinkInfo link;
 	link.mPipe = pipe;
 	info.mChainLinks.push_back(link);
@@ -757,7 +788,7 @@ bool LLPumpIO::respond(LLIOPipe* pipe)
 bool LLPumpIO::respond(
 	const links_t& links,
 	LLIOPipe::buffer_ptr_t data,
-	LLSD context)
+	const LLSD& context)
 {
 	LLMemType m1(LLMemType::MTYPE_IO_PUMP);
 	// if the caller is providing a full link description, we need to
@@ -765,15 +796,17 @@ bool LLPumpIO::respond(
 	if(!data) return false;
 	if(links.empty()) return false;
 
-#if LL_THREADS_APR
 	LLScopedLock lock(mCallbackMutex);
-#endif
 
 	// Add the callback response
 	LLChainInfo info;
+	info.mAddTime = mCurrentChainAddTime;
+	info.mRespondTime = totalTime();
 	info.mChainLinks = links;
 	info.mData = data;
-	info.mContext = context;
+	// callback() may run on another thread than the one responding, and
+	// the context must not share reference counts across threads
+	info.mContext = llsd_clone(context);
 	mPendingCallbacks.push_back(info);
 	return true;
 }
@@ -784,9 +817,7 @@ void LLPumpIO::callback()
 	//llinfos << "LLPumpIO::callback()" << llendl;
 	if(true)
 	{
-#if LL_THREADS_APR
 		LLScopedLock lock(mCallbackMutex);
-#endif
 		std::copy(
 			mPendingCallbacks.begin(),
 			mPendingCallbacks.end(),
@@ -797,8 +828,21 @@ void LLPumpIO::callback()
 	{
 		callbacks_t::iterator it = mCallbacks.begin();
 		callbacks_t::iterator end = mCallbacks.end();
+		U64 now = totalTime();
 		for(; it != end; ++it)
 		{
+			// Chains which responded from outside of pump() have no
+			// add time, so only the delay is known.
+			F32 delay_ms = (F32)((now - (*it).mRespondTime) / 1000.0);
+			mCallbackDelayStat.addValue(delay_ms);
+			if((*it).mAddTime)
+			{
+				F32 latency_ms = (F32)(((*it).mRespondTime - (*it).mAddTime) / 1000.0);
+				mChainLatencyStat.addValue(latency_ms);
+				lldebugs << "LLPumpIO::callback() chain latency " << latency_ms
+						 << " ms, callback delay " << delay_ms << " ms" << llendl;
+			}
+
 			// it's always the first and last time for respone chains
 			(*it).mHead = (*it).mChainLinks.begin();
 			(*it).mInit = true;
@@ -811,9 +855,7 @@ void LLPumpIO::callback()
 
 void LLPumpIO::control(LLPumpIO::EControl op)
 {
-#if LL_THREADS_APR
 	LLScopedLock lock(mChainsMutex);
-#endif
 	switch(op)
 	{
 	case PAUSE:
@@ -833,10 +875,18 @@ void LLPumpIO::initialize(void)
 	LLMemType m1(LLMemType::MTYPE_IO_PUMP);
 	mPool.create();
 #if LL_THREADS_APR
+	setThreaded();
+#endif
+}
+
+void LLPumpIO::setThreaded()
+{
+	LLMemType m1(LLMemType::MTYPE_IO_PUMP);
+	if(mChainsMutex) return;
 	// SJB: Windows defaults to NESTED and OSX defaults to UNNESTED, so use UNNESTED explicitly.
 	apr_thread_mutex_create(&mChainsMutex, APR_THREAD_MUTEX_UNNESTED, mPool());
 	apr_thread_mutex_create(&mCallbackMutex, APR_THREAD_MUTEX_UNNESTED, mPool());
-#endif
+	apr_thread_cond_create(&mChainsCondition, mPool());
 }
 
 void LLPumpIO::rebuildPollset()
@@ -1132,6 +1182,8 @@ bool LLPumpIO::handleChainError(
  */
 
 LLPumpIO::LLChainInfo::LLChainInfo() :
+	mAddTime(0),
+	mRespondTime(0),
 	mInit(false),
 	mLock(0),
 	mEOS(false),
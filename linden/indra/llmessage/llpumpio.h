@@ -41,11 +41,14 @@
 #include <sys/param.h>
 #endif
 
+#include "apr_thread_cond.h"
+#include "apr_thread_mutex.h"
 #include "aiaprpool.h"
 #include "llbuffer.h"
 #include "llframetimer.h"
 #include "lliopipe.h"
 #include "llrun.h"
+#include "llstat.h"
 
 // Define this to enable use with the APR thread library.
 //#define LL_THREADS_APR 1
@@ -92,6 +95,15 @@ public:
 	 */
 	~LLPumpIO();
 
+	/**
+	 * @brief Make this pump safe to share between two threads.
+	 *
+	 * Call this before handing the pump to another thread. One thread
+	 * calls <code>pump()</code> and <code>waitForChains()</code>, the
+	 * other adds chains and calls <code>callback()</code>.
+	 */
+	void setThreaded();
+
 	/**
 	 * @brief Typedef for having a chain of pipes.
 	 */
@@ -251,6 +263,22 @@ public:
 	void pump(const S32& poll_timeout);
 	void pump();
 
+	/** 
+	 * @brief Block the pumping thread until there is work to do.
+	 *
+	 * Returns at once if a chain is pending. Otherwise waits for
+	 * <code>addChain()</code> or <code>wake()</code>, or for at most
+	 * timeout_usecs while chains are running. Does nothing on a pump
+	 * which is not threaded.
+	 * @param timeout_usecs How long to wait while chains are running.
+	 */
+	void waitForChains(S64 timeout_usecs);
+
+	/** 
+	 * @brief Make the next or current <code>waitForChains()</code> return.
+	 */
+	void wake();
+
 	/** 
 	 * @brief Add a chain to a special queue which will be called
 	 * during the next call to <code>callback()</code> and then
@@ -291,7 +319,7 @@ public:
 	bool respond(
 		const links_t& links,
 		LLIOPipe::buffer_ptr_t data,
-		LLSD context);
+		const LLSD& context);
 
 	/** 
 	 * @brief Run through the callback queue and call <code>process()</code>.
@@ -318,6 +346,18 @@ public:
 	 */
 	void control(EControl op);
 
+	/** 
+	 * @brief Latency of the responses run by <code>callback()</code>.
+	 *
+	 * The chain latency is the milliseconds from adding a chain to a
+	 * pipe on it calling <code>respond()</code>. The callback delay is
+	 * the milliseconds from <code>respond()</code> to
+	 * <code>callback()</code> running the response. Only read these
+	 * from the thread which calls <code>callback()</code>.
+	 */
+	LLStat* getChainLatencyStat() { return &mChainLatencyStat; }
+	LLStat* getCallbackDelayStat() { return &mCallbackDelayStat; }
+
 protected:
 	/** 
 	 * @brief State of the pump
@@ -350,6 +390,9 @@ protected:
 		void adjustTimeoutSeconds(F32 delta);
 
 		// basic member data
+		U64 mAddTime;			// when the chain was added or, for a
+								// response, when its chain was added
+		U64 mRespondTime;		// when a response was queued
 		bool mInit;
 		S32 mLock;
 		LLFrameTimer mTimer;
@@ -387,13 +430,16 @@ protected:
 	AIAPRPool mCurrentPool;
 	S32 mCurrentPoolReallocCount;
 
-#if LL_THREADS_APR
+	// These are NULL unless the pump is threaded.
 	apr_thread_mutex_t* mChainsMutex;
 	apr_thread_mutex_t* mCallbackMutex;
-#else
-	int* mChainsMutex;
-	int* mCallbackMutex;
-#endif
+	apr_thread_cond_t* mChainsCondition;
+	bool mWake;
+
+	// Set while the pump is running a chain, for respond().
+	U64 mCurrentChainAddTime;
+	LLStat mChainLatencyStat;
+	LLStat mCallbackDelayStat;
 
 protected:
 	void initialize();
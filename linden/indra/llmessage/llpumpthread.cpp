@@ -0,0 +1,95 @@
+/**
+ * @file llpumpthread.cpp
+ * @brief Thread which runs an LLPumpIO.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#include "linden_common.h"
+
+#include "llpumpthread.h"
+
+#include "llpumpio.h"
+
+// How long to wait between pumps while chains are running.  Most chains
+// on a pump thread poll curl rather than a socket, so this bounds how
+// quickly their responses are noticed.
+static const S64 PUMP_THREAD_POLL_USECS = 1000;
+
+LLPumpThread::LLPumpThread(LLPumpIO* pump)
+	: LLThread("Pump"),
+	  mPump(pump)
+{
+	mPump->setThreaded();
+}
+
+LLPumpThread::~LLPumpThread()
+{
+	shutdown();
+	// ~LLThread() will be called here
+}
+
+void LLPumpThread::shutdown()
+{
+	// already shut down by the owner, or never started
+	if (!mAPRThreadp)
+	{
+		return;
+	}
+	setQuitting();
+	mPump->wake();
+
+	S32 timeout = 100;
+	for ( ; timeout > 0; timeout--)
+	{
+		if (isStopped())
+		{
+			break;
+		}
+		ms_sleep(100);
+		LLThread::yield();
+	}
+	if (timeout == 0)
+	{
+		llwarns << "~LLPumpThread (" << mName << ") timed out!" << llendl;
+		// Leak the thread and its run condition, as LLThread::shutdown()
+		// does, so ~LLThread() doesn't wait all over again.
+		mRunCondition = NULL;
+	}
+	mAPRThreadp = NULL;
+}
+
+void LLPumpThread::run()
+{
+	while (!isQuitting())
+	{
+		mPump->pump();
+		mPump->waitForChains(PUMP_THREAD_POLL_USECS);
+	}
+}
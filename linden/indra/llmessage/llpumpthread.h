@@ -0,0 +1,61 @@
+/**
+ * @file llpumpthread.h
+ * @brief Thread which runs an LLPumpIO.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#ifndef LL_LLPUMPTHREAD_H
+#define LL_LLPUMPTHREAD_H
+
+#include "llthread.h"
+
+class LLPumpIO;
+
+// Runs pump() on its own thread, so chains on the pump keep moving
+// however long the main thread's frames take.  The thread which added
+// the chains still calls callback(), so responses are handled there.
+// The pump is made threaded by the constructor and has to outlive the
+// thread.
+class LLPumpThread : public LLThread
+{
+public:
+	LLPumpThread(LLPumpIO* pump);
+	~LLPumpThread();
+
+	// Stops the thread, waking it if it is waiting for chains.
+	/*virtual*/ void shutdown();
+
+protected:
+	/*virtual*/ void run();
+
+	LLPumpIO* mPump;
+};
+
+#endif // LL_LLPUMPTHREAD_H
@@ -48,7 +48,8 @@ LLTemplateMessageReader::LLTemplateMessageReader(message_template_number_map_t&
 	mReceiveSize(0),
 	mCurrentRMessageTemplate(NULL),
 	mCurrentRMessageData(NULL),
-	mMessageNumbers(number_template_map)
+	mMessageNumbers(number_template_map),
+	mCountReceives(true)
 {
 }
 
@@ -547,6 +548,21 @@ void LLTemplateMessageReader::logRanOffEndOfPacket( const LLHost& host, const S3
 // decode a given message
 BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender, BOOL custom)
 // </edit>
+{
+	if (!buildMessageData(buffer, sender, custom))
+	{
+		return FALSE;
+	}
+	// <edit>
+	if(!custom)
+	// </edit>
+	{
+		dispatchMessage(sender);
+	}
+	return TRUE;
+}
+
+BOOL LLTemplateMessageReader::buildMessageData(const U8* buffer, const LLHost& sender, BOOL custom)
 {
 	llassert( mReceiveSize >= 0 );
 	llassert( mCurrentRMessageTemplate);
@@ -726,60 +742,74 @@ BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender,
 		lldebugs << "Empty message '" << mCurrentRMessageTemplate->mName << "' (no blocks)" << llendl;
 		return FALSE;
 	}
-	
-	// <edit>
-	if(!custom)
-	// </edit>
+	return TRUE;
+}
+
+void LLTemplateMessageReader::dispatchMessage(const LLHost& sender)
+{
+	static LLTimer decode_timer;
+
+	if(LLMessageReader::getTimeDecodes() || gMessageSystem->getTimingCallback())
 	{
-		static LLTimer decode_timer;
+		decode_timer.reset();
+	}
 
-		if(LLMessageReader::getTimeDecodes() || gMessageSystem->getTimingCallback())
+	{
+		LLFastTimer t(LLFastTimer::FTM_PROCESS_MESSAGES);
+		if( !mCurrentRMessageTemplate->callHandlerFunc(gMessageSystem) )
 		{
-			decode_timer.reset();
+			llwarns << "Message from " << sender << " with no handler function received: " << mCurrentRMessageTemplate->mName << llendl;
 		}
+	}
 
+	if(LLMessageReader::getTimeDecodes() || gMessageSystem->getTimingCallback())
+	{
+		F32 decode_time = decode_timer.getElapsedTimeF32();
+
+		if (gMessageSystem->getTimingCallback())
 		{
-			LLFastTimer t(LLFastTimer::FTM_PROCESS_MESSAGES);
-			if( !mCurrentRMessageTemplate->callHandlerFunc(gMessageSystem) )
-			{
-				llwarns << "Message from " << sender << " with no handler function received: " << mCurrentRMessageTemplate->mName << llendl;
-			}
+			(gMessageSystem->getTimingCallback())(mCurrentRMessageTemplate->mName,
+							decode_time,
+							gMessageSystem->getTimingCallbackData());
 		}
 
-		if(LLMessageReader::getTimeDecodes() || gMessageSystem->getTimingCallback())
+		if (LLMessageReader::getTimeDecodes())
 		{
-			F32 decode_time = decode_timer.getElapsedTimeF32();
+			mCurrentRMessageTemplate->mDecodeTimeThisFrame += decode_time;
 
-			if (gMessageSystem->getTimingCallback())
-			{
-				(gMessageSystem->getTimingCallback())(mCurrentRMessageTemplate->mName,
-								decode_time,
-								gMessageSystem->getTimingCallbackData());
-			}
+			mCurrentRMessageTemplate->mTotalDecoded++;
+			mCurrentRMessageTemplate->mTotalDecodeTime += decode_time;
 
-			if (LLMessageReader::getTimeDecodes())
+			if( mCurrentRMessageTemplate->mMaxDecodeTimePerMsg < decode_time )
 			{
-				mCurrentRMessageTemplate->mDecodeTimeThisFrame += decode_time;
-
-				mCurrentRMessageTemplate->mTotalDecoded++;
-				mCurrentRMessageTemplate->mTotalDecodeTime += decode_time;
-
-				if( mCurrentRMessageTemplate->mMaxDecodeTimePerMsg < decode_time )
-				{
-					mCurrentRMessageTemplate->mMaxDecodeTimePerMsg = decode_time;
-				}
+				mCurrentRMessageTemplate->mMaxDecodeTimePerMsg = decode_time;
+			}
 
 
-				if(decode_time > LLMessageReader::getTimeDecodesSpamThreshold())
-				{
-					lldebugs << "--------- Message " << mCurrentRMessageTemplate->mName << " decode took " << decode_time << " seconds. (" <<
-						mCurrentRMessageTemplate->mMaxDecodeTimePerMsg << " max, " <<
-						(mCurrentRMessageTemplate->mTotalDecodeTime / mCurrentRMessageTemplate->mTotalDecoded) << " avg)" << llendl;
-				}
+			if(decode_time > LLMessageReader::getTimeDecodesSpamThreshold())
+			{
+				lldebugs << "--------- Message " << mCurrentRMessageTemplate->mName << " decode took " << decode_time << " seconds. (" <<
+					mCurrentRMessageTemplate->mMaxDecodeTimePerMsg << " max, " <<
+					(mCurrentRMessageTemplate->mTotalDecodeTime / mCurrentRMessageTemplate->mTotalDecoded) << " avg)" << llendl;
 			}
 		}
 	}
-	return TRUE;
+}
+
+LLMsgData* LLTemplateMessageReader::detachMessageData()
+{
+	LLMsgData* data = mCurrentRMessageData;
+	mCurrentRMessageData = NULL;
+	return data;
+}
+
+void LLTemplateMessageReader::adoptMessageData(LLMessageTemplate* msg_template,
+											   LLMsgData* data, S32 receive_size)
+{
+	delete mCurrentRMessageData;
+	mCurrentRMessageTemplate = msg_template;
+	mCurrentRMessageData = data;
+	mReceiveSize = receive_size;
 }
 
 // <edit>
@@ -800,7 +830,7 @@ BOOL LLTemplateMessageReader::validateMessage(const U8* buffer,
 	//BOOL valid = decodeTemplate(buffer, buffer_size, &mCurrentRMessageTemplate );
 	BOOL valid = decodeTemplate(buffer, buffer_size, &mCurrentRMessageTemplate, custom );
 	//if(result)
-	if(valid && !custom)
+	if(valid && !custom && mCountReceives)
 	// </edit>
 	{
 		mCurrentRMessageTemplate->mReceiveCount++;
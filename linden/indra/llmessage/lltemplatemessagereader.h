@@ -118,8 +118,21 @@ public:
 
 	BOOL decodeData(const U8* buffer, const LLHost& sender, BOOL custom = FALSE);
 
+	// decodeData() split in two, so that a message can be decoded on the
+	// network receive thread and its handler called on the main thread.
+	BOOL buildMessageData(const U8* buffer, const LLHost& sender, BOOL custom = FALSE);
+	void dispatchMessage(const LLHost& sender);
+
+	// Hand a decoded message from one reader to another.
+	LLMsgData* detachMessageData();
+	void adoptMessageData(LLMessageTemplate* msg_template, LLMsgData* data, S32 receive_size);
+
 	BOOL decodeTemplate(const U8* buffer, S32 buffer_size,  // inputs
 						LLMessageTemplate** msg_template, BOOL custom = FALSE); // outputs
+
+	// A reader on the network receive thread leaves the templates' receive
+	// counts to the main thread.
+	void setCountReceives(bool count) { mCountReceives = count; }
 	
 private:
 
@@ -132,6 +145,7 @@ private:
 	LLMessageTemplate* mCurrentRMessageTemplate;
 	LLMsgData* mCurrentRMessageData;
 	message_template_number_map_t& mMessageNumbers;
+	bool mCountReceives;
 };
 
 #endif // LL_LLTEMPLATEMESSAGEREADER_H
@@ -751,6 +751,7 @@ void LLTransferSourceChannel::updateTransfers()
 	// If so, update priorities so we know who gets to send it.
 	// Send data from the sources, while updating until we've sent our throttle allocation.
 
+	LLMessageSystem::LLCircuitLock lock(gMessageSystem);
 	LLCircuitData *cdp = gMessageSystem->mCircuitInfo.findCircuit(getHost());
 	if (!cdp)
 	{
@@ -1005,7 +1005,7 @@ void LLXferManager::retransmitUnackedPackets ()
 		if (xferp->mStatus == e_LL_XFER_IN_PROGRESS)
 		{
 			// if the circuit dies, abort
-			if (! gMessageSystem->mCircuitInfo.isCircuitAlive( xferp->mRemoteHost ))
+			if (! gMessageSystem->checkCircuitAlive( xferp->mRemoteHost ))
 			{
 				llinfos << "Xfer found in progress on dead circuit, aborting" << llendl;
 				xferp->mCallbackResult = LL_ERR_CIRCUIT_GONE;
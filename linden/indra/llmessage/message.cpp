@@ -64,6 +64,7 @@
 #include "llmd5.h"
 #include "llmessagebuilder.h"
 #include "llmessageconfig.h"
+#include "llmessagereceivethread.h"
 #include "lltemplatemessagedispatcher.h"
 #include "llpumpio.h"
 #include "lltemplatemessagebuilder.h"
@@ -241,6 +242,11 @@ void LLMessageSystem::init()
 
 	mMessageBuilder = NULL;
 	mMessageReader = NULL;
+
+	mReceiveThread = NULL;
+	mCircuitMutex = NULL;
+	mCircuitLockDepth = 0;
+	mCircuitMutexHeld = false;
 }
 
 // Read file and build message templates
@@ -358,12 +364,19 @@ void LLMessageSystem::loadTemplateFile(const std::string& filename, bool failure
 
 LLMessageSystem::~LLMessageSystem()
 {
+	// stop reading before the templates and the socket go away
+	delete mReceiveThread;
+	mReceiveThread = NULL;
+	delete mCircuitMutex;
+	mCircuitMutex = NULL;
+
 	mMessageTemplates.clear(); // don't delete templates.
 	for_each(mMessageNumbers.begin(), mMessageNumbers.end(), DeletePairedPointer());
 	mMessageNumbers.clear();
 	
 	if (!mbError)
 	{
+		mPacketRing.flushSends();
 		end_net(mSocket);
 	}
 	mSocket = 0;
@@ -421,6 +434,7 @@ BOOL LLMessageSystem::poll(F32 seconds)
 
 bool LLMessageSystem::isTrustedSender(const LLHost& host) const
 {
+	LLCircuitLock lock(this);
 	LLCircuitData* cdp = mCircuitInfo.findCircuit(host);
 	if(NULL == cdp)
 	{
@@ -466,7 +480,8 @@ bool LLMessageSystem::isUntrustedMessage(const std::string& name) const
 }
 
 LLCircuitData* LLMessageSystem::findCircuit(const LLHost& host,
-											bool resetPacketId)
+											bool resetPacketId,
+											TPACKETID packet_id)
 {
 	LLCircuitData* cdp = mCircuitInfo.findCircuit(host);
 	if (!cdp)
@@ -481,13 +496,13 @@ LLCircuitData* LLMessageSystem::findCircuit(const LLHost& host,
 		else
 		{
 			// nope, open the new circuit
-			cdp = mCircuitInfo.addCircuitData(host, mCurrentRecvPacketID);
+			cdp = mCircuitInfo.addCircuitData(host, packet_id);
 
 			if(resetPacketId)
 			{
 				// I added this - I think it's correct - DJS
 				// reset packet in ID
-				cdp->setPacketInID(mCurrentRecvPacketID);
+				cdp->setPacketInID(packet_id);
 			}
 			// And claim the packet is on the circuit we just added.
 		}
@@ -511,7 +526,7 @@ LLCircuitData* LLMessageSystem::findCircuit(const LLHost& host,
 				if(resetPacketId)
 				{
 					// reset packet in ID
-					cdp->setPacketInID(mCurrentRecvPacketID);
+					cdp->setPacketInID(packet_id);
 				}
 			}
 		}
@@ -527,6 +542,9 @@ BOOL LLMessageSystem::checkMessages( S64 frame_count, bool faked_message, U8 fak
 	mMessageReader = mTemplateMessageReader;
 
 	LLTransferTargetVFile::updateQueue();
+
+	// Send anything the last message's handlers queued before reading more
+	mPacketRing.flushSends();
 	
 	if (!mNumMessageCounts)
 	{
@@ -536,6 +554,11 @@ BOOL LLMessageSystem::checkMessages( S64 frame_count, bool faked_message, U8 fak
 		mMessageCountTime = getMessageTimeSeconds();
 	}
 
+	if (mReceiveThread)
+	{
+		return checkReceivedMessages();
+	}
+
 	// loop until either no packets or a valid packet
 	// i.e., burn through packets from unregistered circuits
 	S32 receive_size = 0;
@@ -609,7 +632,7 @@ BOOL LLMessageSystem::checkMessages( S64 frame_count, bool faked_message, U8 fak
 			host = getSender();
 
 			const bool resetPacketId = true;
-			cdp = findCircuit(host, resetPacketId);
+			cdp = findCircuit(host, resetPacketId, mCurrentRecvPacketID);
 
 			// At this point, cdp is now a pointer to the circuit that
 			// this message came in on if it's valid, and NULL if the
@@ -782,6 +805,367 @@ BOOL LLMessageSystem::checkMessages( S64 frame_count, bool faked_message, U8 fak
 	return valid_packet;
 }
 
+void LLMessageSystem::startReceiveThread()
+{
+	if (mReceiveThread)
+	{
+		return;
+	}
+	llassert(mCircuitLockDepth == 0);
+	mCircuitMutex = new LLMutex;
+	mReceiveThread = new LLMessageReceiveThread(this);
+	mReceiveThread->start();
+}
+
+void LLMessageSystem::lockCircuits() const
+{
+	if (mCircuitLockDepth++ == 0 && mReceiveThread)
+	{
+		mCircuitMutex->lock();
+		mCircuitMutexHeld = true;
+	}
+}
+
+void LLMessageSystem::unlockCircuits() const
+{
+	if (--mCircuitLockDepth == 0 && mCircuitMutexHeld)
+	{
+		mCircuitMutexHeld = false;
+		mCircuitMutex->unlock();
+	}
+}
+
+// Main thread half of checkMessages() when the receive thread is running:
+// the packets are already read, validated and decoded, so what is left is
+// the message log, the statistics, the deferred callbacks and the handler.  Callbacks and
+// handlers run without the circuit lock so that one that blocks does not
+// stall the receive thread; they lock for themselves where they need to.
+BOOL LLMessageSystem::checkReceivedMessages()
+{
+	BOOL valid_packet = FALSE;
+	LLReceivedMessage* msgp;
+	while (!valid_packet && (msgp = mReceiveThread->front()) != NULL)
+	{
+		clearReceiveState();
+
+		for (deferred_ack_callback_list_t::iterator iter = msgp->mAckCallbacks.begin();
+			 iter != msgp->mAckCallbacks.end(); ++iter)
+		{
+			iter->mCallback(iter->mCallbackData, iter->mResult);
+		}
+		for (std::vector<EMessageException>::iterator iter = msgp->mExceptions.begin();
+			 iter != msgp->mExceptions.end(); ++iter)
+		{
+			callExceptionFunc(*iter);
+		}
+
+		mTrueReceiveSize = msgp->mTrueSize;
+		memcpy(mTrueReceiveBuffer.buffer, msgp->getBuffer(), mTrueReceiveSize);	/* Flawfinder: ignore */
+		mLastSender = msgp->mSender;
+		// <edit>
+		if (mTrueReceiveSize > (S32) LL_MINIMUM_VALID_PACKET_SIZE)
+		{
+			LLMessageLog::log(mLastSender, LLHost(16777343, mPort), mTrueReceiveBuffer.buffer, mTrueReceiveSize);
+		}
+		// </edit>
+		if (msgp->mHeaderTemplate)
+		{
+			// the receive thread leaves the template statistics to us
+			msgp->mHeaderTemplate->mReceiveCount++;
+		}
+		mLastReceivingIF = msgp->mReceivingIF;
+		mIncomingCompressedSize = msgp->mCompressedSize;
+		mCurrentRecvPacketID = msgp->mPacketID;
+		if (msgp->mReceiveSize > 0)
+		{
+			// zeroCodeExpand() leaves the byte counts to this thread
+			if (msgp->mCompressedSize)
+			{
+				mTotalBytesIn += msgp->mCompressedSize;
+				mCompressedPacketsIn++;
+				mCompressedBytesIn += msgp->mCompressedSize;
+				mUncompressedBytesIn += msgp->mReceiveSize;
+			}
+			else
+			{
+				mTotalBytesIn += msgp->mReceiveSize;
+			}
+		}
+		if (msgp->mTemplate)
+		{
+			mTemplateMessageReader->adoptMessageData(msgp->mTemplate, msgp->mData, msgp->mReceiveSize);
+			msgp->mData = NULL;
+		}
+
+		LLReceivedMessage::EStatus status = msgp->mStatus;
+		BOOL recv_reliable = msgp->mReliable;
+		BOOL recv_resent = msgp->mResent;
+		BOOL recv_acks = msgp->mAcks;
+		BOOL on_circuit = msgp->mOnCircuit;
+		LLHost host = msgp->mSender;
+		mReceiveThread->pop();
+
+		if (status == LLReceivedMessage::RM_DISCARD)
+		{
+			continue;
+		}
+		if (status == LLReceivedMessage::RM_DUPLICATE)
+		{
+			mPacketsIn++;
+			continue;
+		}
+
+		if (status == LLReceivedMessage::RM_MESSAGE || status == LLReceivedMessage::RM_ACKS)
+		{
+			// A handler may have closed the circuit since the packet was read
+			LLCircuitLock lock(this);
+			if (!mCircuitInfo.findCircuit(host)
+				&& mTemplateMessageReader->getMessageName() != _PREHASH_UseCircuitCode)
+			{
+				status = LLReceivedMessage::RM_OFF_CIRCUIT;
+				on_circuit = FALSE;
+			}
+		}
+
+		if (status == LLReceivedMessage::RM_OFF_CIRCUIT)
+		{
+			logMsgFromInvalidCircuit(host, recv_reliable);
+		}
+		else if (status == LLReceivedMessage::RM_UNTRUSTED)
+		{
+			logTrustedMsgFromUntrustedCircuit(host);
+			sendDenyTrustedCircuit(host);
+		}
+		else if (status != LLReceivedMessage::RM_INVALID)
+		{
+			// the receive thread already updated the circuit
+			logValidMsg(NULL, host, recv_reliable, recv_resent, recv_acks);
+			if (status == LLReceivedMessage::RM_MESSAGE)
+			{
+				mTemplateMessageReader->dispatchMessage(host);
+			}
+			valid_packet = TRUE;
+		}
+
+		if (valid_packet)
+		{
+			mPacketsIn++;
+			mBytesIn += mTrueReceiveSize;
+			if (on_circuit && recv_reliable)
+			{
+				mReliablePacketsIn++;
+			}
+		}
+		else
+		{
+			clearReceiveState();
+			if (mbProtected && !on_circuit)
+			{
+				LL_WARNS("Messaging") << "Invalid Packet from invalid circuit " << host << llendl;
+				mOffCircuitPackets++;
+			}
+			else
+			{
+				mInvalidOnCircuitPackets++;
+			}
+		}
+	}
+
+	F64 mt_sec = getMessageTimeSeconds();
+	// Check to see if we need to print debug info
+	if ((mt_sec - mCircuitPrintTime) > mCircuitPrintFreq)
+	{
+		LLCircuitLock lock(this);
+		dumpCircuitInfo();
+		mCircuitPrintTime = mt_sec;
+	}
+
+	if( !valid_packet )
+	{
+		clearReceiveState();
+	}
+
+	return valid_packet;
+}
+
+// Receive thread half: everything checkMessages() does up to calling the
+// handler, with the circuit work done under mCircuitMutex.
+BOOL LLMessageSystem::receiveMessageOnThread(LLReceivedMessage& msg,
+											 LLTemplateMessageReader& reader,
+											 U8* expand_buffer)
+{
+	U8* buffer = msg.getBuffer();
+	S32 receive_size = mPacketRing.receivePacket(mSocket, (char *)buffer);
+	if (receive_size <= 0)
+	{
+		return FALSE;
+	}
+
+	msg.mTrueSize = receive_size;
+	msg.mSender = mPacketRing.getLastSender();
+	msg.mReceivingIF = mPacketRing.getLastReceivingInterface();
+
+	if (receive_size < (S32) LL_MINIMUM_VALID_PACKET_SIZE)
+	{
+		LL_WARNS("Messaging") << "Invalid (too short) packet discarded " << receive_size << llendl;
+		callExceptionFunc(MX_PACKET_TOO_SHORT);
+		return TRUE;
+	}
+
+	S32 acks = 0;
+	S32 true_rcv_size = 0;
+
+	// note if packet acks are appended.
+	if(buffer[0] & LL_ACK_FLAG)
+	{
+		acks += buffer[--receive_size];
+		true_rcv_size = receive_size;
+		if(receive_size >= ((S32)(acks * sizeof(TPACKETID) + LL_MINIMUM_VALID_PACKET_SIZE)))
+		{
+			receive_size -= acks * sizeof(TPACKETID);
+		}
+		else
+		{
+			LL_WARNS("Messaging") << "Malformed packet received. Packet size "
+				<< receive_size << " with invalid no. of acks " << acks
+				<< llendl;
+			return TRUE;
+		}
+	}
+
+	msg.mCompressedSize = zeroCodeExpand(&buffer, &receive_size, expand_buffer);
+	msg.mReceiveSize = receive_size;
+	msg.mPacketID = ntohl(*((U32*)(&buffer[1])));
+	msg.mReliable = (buffer[0] & LL_RELIABLE_FLAG) ? TRUE : FALSE;
+	msg.mResent = (buffer[0] & LL_RESENT_FLAG) ? TRUE : FALSE;
+	msg.mAcks = acks > 0;
+	const LLHost& host = msg.mSender;
+
+	LLMutexLock lock(mCircuitMutex);
+
+	LLCircuitData* cdp = findCircuit(host, true, msg.mPacketID);
+	msg.mOnCircuit = cdp != NULL;
+
+	if(cdp && (acks > 0) && ((S32)(acks * sizeof(TPACKETID)) < (true_rcv_size)))
+	{
+		TPACKETID packet_id;
+		U32 mem_id=0;
+		for(S32 i = 0; i < acks; ++i)
+		{
+			true_rcv_size -= sizeof(TPACKETID);
+			memcpy(&mem_id, &buffer[true_rcv_size], /* Flawfinder: ignore*/
+			     sizeof(TPACKETID));
+			packet_id = ntohl(mem_id);
+			cdp->ackReliablePacket(packet_id, &msg.mAckCallbacks);
+		}
+		if (!cdp->getUnackedPacketCount())
+		{
+			// Remove this circuit from the list of circuits with unacked packets
+			mCircuitInfo.mUnackedCircuitMap.erase(cdp->mHost);
+		}
+	}
+
+	if (msg.mResent && cdp && cdp->isDuplicateResend(msg.mPacketID))
+	{
+		// We need to ACK here to suppress further resends of packets
+		// we've already seen.
+		if (msg.mReliable)
+		{
+			cdp->collectRAck(msg.mPacketID);
+		}
+		LL_DEBUGS("Messaging") << "Discarding duplicate resend from " << host << llendl;
+		if(mVerboseLog)
+		{
+			std::ostringstream str;
+			str << "MSG: <- " << host;
+			std::string tbuf;
+			tbuf = llformat( "\t%6d\t%6d\t%6d ", receive_size, (msg.mCompressedSize ? msg.mCompressedSize : receive_size), msg.mPacketID);
+			str << tbuf << "(unknown)"
+				<< (msg.mReliable ? " reliable" : "")
+				<< " resent "
+				<< ((acks > 0) ? "acks" : "")
+				<< " DISCARD DUPLICATE";
+			LL_INFOS("Messaging") << str.str() << llendl;
+		}
+		msg.mStatus = LLReceivedMessage::RM_DUPLICATE;
+		return TRUE;
+	}
+
+	bool trusted = cdp && cdp->getTrusted();
+	BOOL valid = reader.validateMessage(buffer, receive_size, host, trusted);
+	msg.mHeaderTemplate = reader.getTemplate();
+	if (!valid)
+	{
+		reader.clearMessage();
+		msg.mStatus = LLReceivedMessage::RM_INVALID;
+		return TRUE;
+	}
+	msg.mTemplate = reader.getTemplate();
+
+	// UseCircuitCode is allowed in even from an invalid circuit, so that
+	// we can toss circuits around.
+	if (!cdp && (reader.getMessageName() != _PREHASH_UseCircuitCode))
+	{
+		reader.clearMessage();
+		msg.mStatus = LLReceivedMessage::RM_OFF_CIRCUIT;
+		return TRUE;
+	}
+	if (cdp && !cdp->getTrusted() && reader.isTrusted())
+	{
+		reader.clearMessage();
+		msg.mStatus = LLReceivedMessage::RM_UNTRUSTED;
+		return TRUE;
+	}
+
+	if (cdp)
+	{
+		// update circuit packet ID tracking (missing/out of order packets)
+		cdp->checkPacketInID(msg.mPacketID, msg.mResent);
+		cdp->addBytesIn(msg.mTrueSize);
+	}
+
+	if (!reader.buildMessageData(buffer, host))
+	{
+		reader.clearMessage();
+		msg.mStatus = LLReceivedMessage::RM_INVALID;
+		return TRUE;
+	}
+
+	msg.mStatus = LLReceivedMessage::RM_MESSAGE;
+	if (msg.mTemplate->mName == _PREHASH_PacketAck)
+	{
+		// What process_packet_ack() does, without waiting for the main thread
+		if (cdp)
+		{
+			S32 ack_count = reader.getNumberOfBlocks(_PREHASH_Packets);
+			for (S32 i = 0; i < ack_count; i++)
+			{
+				TPACKETID packet_id;
+				reader.getU32(_PREHASH_Packets, _PREHASH_ID, packet_id, i);
+				cdp->ackReliablePacket(packet_id, &msg.mAckCallbacks);
+			}
+			if (!cdp->getUnackedPacketCount())
+			{
+				mCircuitInfo.mUnackedCircuitMap.erase(host);
+			}
+		}
+		msg.mStatus = LLReceivedMessage::RM_ACKS;
+	}
+	msg.mData = reader.detachMessageData();
+	reader.clearMessage();
+
+	// ACK here for valid packets that we've seen for the first time.
+	if (cdp && msg.mReliable)
+	{
+		// Add to the recently received list for duplicate suppression
+		cdp->mRecentlyReceivedReliablePackets[msg.mPacketID] = getMessageTimeUsecs();
+
+		// Put it onto the list of packets to be acked
+		cdp->collectRAck(msg.mPacketID);
+	}
+	return TRUE;
+}
+
 S32	LLMessageSystem::getReceiveBytes() const
 {
 	if (getReceiveCompressedSize())
@@ -797,6 +1181,7 @@ S32	LLMessageSystem::getReceiveBytes() const
 
 void LLMessageSystem::processAcks()
 {
+	LLCircuitLock lock(this);
 	F64 mt_sec = getMessageTimeSeconds();
 	{
 		gTransferManager.updateTransfers();
@@ -863,6 +1248,9 @@ void LLMessageSystem::processAcks()
 		mResendDumpTime = mt_sec;
 		mCircuitInfo.dumpResends();
 	}
+
+	// Once per frame: send this frame's acks, resends and queued messages
+	mPacketRing.flushSends();
 }
 
 void LLMessageSystem::copyMessageReceivedToSend()
@@ -1018,6 +1406,7 @@ S32 LLMessageSystem::sendReliable(const LLHost &host)
 
 S32 LLMessageSystem::sendSemiReliable(const LLHost &host, void (*callback)(void **,S32), void ** callback_data)
 {
+	LLCircuitLock lock(this);
 	F32 timeout;
 
 	LLCircuitData *cdp = mCircuitInfo.findCircuit(host);
@@ -1044,6 +1433,8 @@ S32 LLMessageSystem::sendReliable(	const LLHost &host,
 									void (*callback)(void **,S32), 
 									void ** callback_data)
 {
+	LLCircuitLock lock(this);
+
 	if (ping_based_timeout)
 	{
 	    LLCircuitData *cdp = mCircuitInfo.findCircuit(host);
@@ -1095,6 +1486,7 @@ S32 LLMessageSystem::forwardReliable(	const LLHost &host,
 
 S32 LLMessageSystem::flushSemiReliable(const LLHost &host, void (*callback)(void **,S32), void ** callback_data)
 {
+	LLCircuitLock lock(this);
 	F32 timeout; 
 
 	LLCircuitData *cdp = mCircuitInfo.findCircuit(host);
@@ -1164,6 +1556,8 @@ LLHTTPClient::ResponderPtr LLMessageSystem::createResponder(const std::string& n
 // so should should not use llinfos.
 S32 LLMessageSystem::sendMessage(const LLHost &host)
 {
+	LLCircuitLock lock(this);
+
 	if (! mMessageBuilder->isBuilt())
 	{
 		mSendSize = mMessageBuilder->buildMessage(
@@ -1560,12 +1954,14 @@ LLCircuit* LLMessageSystem::getCircuit()
 
 void LLMessageSystem::getCircuitInfo(LLSD& info) const
 {
+	LLCircuitLock lock(this);
 	mCircuitInfo.getInfo(info);
 }
 
 // returns whether the given host is on a trusted circuit
 BOOL    LLMessageSystem::getCircuitTrust(const LLHost &host)
 {
+	LLCircuitLock lock(this);
 	LLCircuitData *cdp = mCircuitInfo.findCircuit(host);
 	if (cdp)
 	{
@@ -1579,6 +1975,7 @@ BOOL    LLMessageSystem::getCircuitTrust(const LLHost &host)
 // FALSE if not).
 void LLMessageSystem::enableCircuit(const LLHost &host, BOOL trusted)
 {
+	LLCircuitLock lock(this);
 	LLCircuitData *cdp = mCircuitInfo.findCircuit(host);
 	if (!cdp)
 	{
@@ -1593,6 +1990,7 @@ void LLMessageSystem::enableCircuit(const LLHost &host, BOOL trusted)
 
 void LLMessageSystem::disableCircuit(const LLHost &host)
 {
+	LLCircuitLock lock(this);
 	LL_INFOS("Messaging") << "LLMessageSystem::disableCircuit for " << host << llendl;
 	U32 code = gMessageSystem->findCircuitCode( host );
 
@@ -1640,6 +2038,7 @@ void LLMessageSystem::disableCircuit(const LLHost &host)
 
 void LLMessageSystem::setCircuitAllowTimeout(const LLHost &host, BOOL allow)
 {
+	LLCircuitLock lock(this);
 	LLCircuitData *cdp = mCircuitInfo.findCircuit(host);
 	if (cdp)
 	{
@@ -1649,6 +2048,7 @@ void LLMessageSystem::setCircuitAllowTimeout(const LLHost &host, BOOL allow)
 
 void LLMessageSystem::setCircuitTimeoutCallback(const LLHost &host, void (*callback_func)(const LLHost & host, void *user_data), void *user_data)
 {
+	LLCircuitLock lock(this);
 	LLCircuitData *cdp = mCircuitInfo.findCircuit(host);
 	if (cdp)
 	{
@@ -1667,6 +2067,7 @@ BOOL LLMessageSystem::checkCircuitBlocked(const U32 circuit)
 		return TRUE;
 	}
 
+	LLCircuitLock lock(this);
 	LLCircuitData *cdp = mCircuitInfo.findCircuit(host);
 	if (cdp)
 	{
@@ -1689,6 +2090,7 @@ BOOL LLMessageSystem::checkCircuitAlive(const U32 circuit)
 		return FALSE;
 	}
 
+	LLCircuitLock lock(this);
 	LLCircuitData *cdp = mCircuitInfo.findCircuit(host);
 	if (cdp)
 	{
@@ -1703,6 +2105,7 @@ BOOL LLMessageSystem::checkCircuitAlive(const U32 circuit)
 
 BOOL LLMessageSystem::checkCircuitAlive(const LLHost &host)
 {
+	LLCircuitLock lock(this);
 	LLCircuitData *cdp = mCircuitInfo.findCircuit(host);
 	if (cdp)
 	{
@@ -1795,6 +2198,7 @@ LLMessageSystem	*gMessageSystem = NULL;
 // update appropriate ping info
 void	process_complete_ping_check(LLMessageSystem *msgsystem, void** /*user_data*/)
 {
+	LLMessageSystem::LLCircuitLock lock(msgsystem);
 	U8 ping_id;
 	msgsystem->getU8Fast(_PREHASH_PingID, _PREHASH_PingID, ping_id);
 
@@ -1810,6 +2214,7 @@ void	process_complete_ping_check(LLMessageSystem *msgsystem, void** /*user_data*
 
 void	process_start_ping_check(LLMessageSystem *msgsystem, void** /*user_data*/)
 {
+	LLMessageSystem::LLCircuitLock lock(msgsystem);
 	U8 ping_id;
 	msgsystem->getU8Fast(_PREHASH_PingID, _PREHASH_PingID, ping_id);
 
@@ -2003,37 +2408,41 @@ void LLMessageSystem::processUseCircuitCode(LLMessageSystem* msg,
 			}
 		}
 
-		// Since this comes from the viewer, it's untrusted, but it
-		// passed the circuit code and session id check, so we will go
-		// ahead and persist the ID associated.
-		LLCircuitData *cdp = msg->mCircuitInfo.findCircuit(msg->getSender());
-		BOOL had_circuit_already = cdp ? TRUE : FALSE;
-
-		msg->enableCircuit(msg->getSender(), FALSE);
-		cdp = msg->mCircuitInfo.findCircuit(msg->getSender());
-		if(cdp)
 		{
-			cdp->setRemoteID(id);
-			cdp->setRemoteSessionID(session_id);
-		}
+			LLCircuitLock lock(msg);
 
-		if (!had_circuit_already)
-		{
-			//
-			// HACK HACK HACK HACK HACK!
-			//
-			// This would NORMALLY happen inside logValidMsg, but at the point that this happens
-			// inside logValidMsg, there's no circuit for this message yet.  So the awful thing that
-			// we do here is do it inside this message handler immediately AFTER the message is
-			// handled.
-			//
-			// We COULD not do this, but then what happens is that some of the circuit bookkeeping
-			// gets broken, especially the packets in count.  That causes some later packets to flush
-			// the RecentlyReceivedReliable list, resulting in an error in which UseCircuitCode
-			// doesn't get properly duplicate suppressed.  Not a BIG deal, but it's somewhat confusing
-			// (and bad from a state point of view).  DJS 9/23/04
-			//
-			cdp->checkPacketInID(gMessageSystem->mCurrentRecvPacketID, FALSE ); // Since this is the first message on the circuit, by definition it's not resent.
+			// Since this comes from the viewer, it's untrusted, but it
+			// passed the circuit code and session id check, so we will go
+			// ahead and persist the ID associated.
+			LLCircuitData *cdp = msg->mCircuitInfo.findCircuit(msg->getSender());
+			BOOL had_circuit_already = cdp ? TRUE : FALSE;
+
+			msg->enableCircuit(msg->getSender(), FALSE);
+			cdp = msg->mCircuitInfo.findCircuit(msg->getSender());
+			if(cdp)
+			{
+				cdp->setRemoteID(id);
+				cdp->setRemoteSessionID(session_id);
+			}
+
+			if (!had_circuit_already)
+			{
+				//
+				// HACK HACK HACK HACK HACK!
+				//
+				// This would NORMALLY happen inside logValidMsg, but at the point that this happens
+				// inside logValidMsg, there's no circuit for this message yet.  So the awful thing that
+				// we do here is do it inside this message handler immediately AFTER the message is
+				// handled.
+				//
+				// We COULD not do this, but then what happens is that some of the circuit bookkeeping
+				// gets broken, especially the packets in count.  That causes some later packets to flush
+				// the RecentlyReceivedReliable list, resulting in an error in which UseCircuitCode
+				// doesn't get properly duplicate suppressed.  Not a BIG deal, but it's somewhat confusing
+				// (and bad from a state point of view).  DJS 9/23/04
+				//
+				cdp->checkPacketInID(gMessageSystem->mCurrentRecvPacketID, FALSE ); // Since this is the first message on the circuit, by definition it's not resent.
+			}
 		}
 
 		msg->mIPPortToCircuitCode[ip_port_in] = circuit_code_in;
@@ -2252,6 +2661,7 @@ S32 LLMessageSystem::sendError(
 
 void	process_packet_ack(LLMessageSystem *msgsystem, void** /*user_data*/)
 {
+	LLMessageSystem::LLCircuitLock lock(msgsystem);
 	TPACKETID packet_id;
 
 	LLHost host = msgsystem->getSender();
@@ -2299,6 +2709,7 @@ void process_log_messages(LLMessageSystem* msg, void**)
 // notify remote end that they are not trusted.
 void process_create_trusted_circuit(LLMessageSystem *msg, void **)
 {
+	LLMessageSystem::LLCircuitLock lock(msg);
 	// don't try to create trust on machines with no shared secret
 	std::string shared_secret = get_shared_secret();
 	if(shared_secret.empty()) return;
@@ -2375,6 +2786,7 @@ void process_create_trusted_circuit(LLMessageSystem *msg, void **)
 
 void process_deny_trusted_circuit(LLMessageSystem *msg, void **)
 {
+	LLMessageSystem::LLCircuitLock lock(msg);
 	// don't try to create trust on machines with no shared secret
 	std::string shared_secret = get_shared_secret();
 	if(shared_secret.empty()) return;
@@ -2879,6 +3291,12 @@ S32 LLMessageSystem::zeroCodeAdjustCurrentSendTotal()
 
 
 S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size)
+{
+	return zeroCodeExpand(data, data_size, mEncodedRecvBuffer);
+}
+
+// expand_buffer must hold MAX_BUFFER_SIZE bytes
+S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size, U8* expand_buffer)
 {
 	if ((*data_size ) < LL_MINIMUM_VALID_PACKET_SIZE)
 	{
@@ -2886,7 +3304,12 @@ S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size)
 			<< llendl;
 	}
 
-	mTotalBytesIn += *data_size;
+	// the receive thread leaves the statistics to checkReceivedMessages()
+	bool count_bytes = !(mReceiveThread && mReceiveThread->isReceiveThread());
+	if (count_bytes)
+	{
+		mTotalBytesIn += *data_size;
+	}
 
 	// if we're not zero-coded, simply return.
 	if (!(*data[0] & LL_ZERO_CODE_FLAG))
@@ -2895,15 +3318,18 @@ S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size)
 	}
 
 	S32 in_size = *data_size;
-	mCompressedPacketsIn++;
-	mCompressedBytesIn += *data_size;
+	if (count_bytes)
+	{
+		mCompressedPacketsIn++;
+		mCompressedBytesIn += *data_size;
+	}
 	
 	*data[0] &= (~LL_ZERO_CODE_FLAG);
 
 	S32 count = (*data_size);  
 	
 	U8 *inptr = (U8 *)*data;
-	U8 *outptr = (U8 *)mEncodedRecvBuffer;
+	U8 *outptr = (U8 *)expand_buffer;
 
 // skip the packet id field
 
@@ -2920,11 +3346,11 @@ S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size)
 
 	while (count--)
 	{
-		if (outptr > (&mEncodedRecvBuffer[MAX_BUFFER_SIZE-1]))
+		if (outptr > (&expand_buffer[MAX_BUFFER_SIZE-1]))
 		{
 			LL_WARNS("Messaging") << "attempt to write past reasonable encoded buffer size 1" << llendl;
 			callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
-			outptr = mEncodedRecvBuffer;					
+			outptr = expand_buffer;					
 			break;
 		}
 		if (!((*outptr++ = *inptr++)))
@@ -2932,11 +3358,11 @@ S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size)
 			while (((count--)) && (!(*inptr)))
 			{
 				*outptr++ = *inptr++;
-  				if (outptr > (&mEncodedRecvBuffer[MAX_BUFFER_SIZE-256]))
+  				if (outptr > (&expand_buffer[MAX_BUFFER_SIZE-256]))
   				{
   					LL_WARNS("Messaging") << "attempt to write past reasonable encoded buffer size 2" << llendl;
 					callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
-					outptr = mEncodedRecvBuffer;
+					outptr = expand_buffer;
 					count = -1;
 					break;
   				}
@@ -2951,11 +3377,11 @@ S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size)
 
 			else
 			{
-  				if (outptr > (&mEncodedRecvBuffer[MAX_BUFFER_SIZE-(*inptr)]))
+  				if (outptr > (&expand_buffer[MAX_BUFFER_SIZE-(*inptr)]))
 				{
   					LL_WARNS("Messaging") << "attempt to write past reasonable encoded buffer size 3" << llendl;
 					callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
-					outptr = mEncodedRecvBuffer;					
+					outptr = expand_buffer;					
 				}
 				memset(outptr,0,(*inptr) - 1);
 				outptr += ((*inptr) - 1);
@@ -2964,9 +3390,12 @@ S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size)
 		}		
 	}
 	
-	*data = mEncodedRecvBuffer;
-	*data_size = (S32)(outptr - mEncodedRecvBuffer);
-	mUncompressedBytesIn += *data_size;
+	*data = expand_buffer;
+	*data_size = (S32)(outptr - expand_buffer);
+	if (count_bytes)
+	{
+		mUncompressedBytesIn += *data_size;
+	}
 
 	return(in_size);
 }
@@ -3042,6 +3471,13 @@ void LLMessageSystem::setExceptionFunc(EMessageException e,
 
 BOOL LLMessageSystem::callExceptionFunc(EMessageException exception)
 {
+	if (mReceiveThread && mReceiveThread->isReceiveThread())
+	{
+		// callbacks belong to the main thread; run them with the message
+		mReceiveThread->deferException(exception);
+		return mExceptionCallbacks.find(exception) != mExceptionCallbacks.end();
+	}
+
 	callbacks_t::iterator it = mExceptionCallbacks.find(exception);
 	if(it != mExceptionCallbacks.end())
 	{
@@ -3077,6 +3513,7 @@ char* LLMessageSystem::getMessageName()
 
 const LLUUID& LLMessageSystem::getSenderID() const
 {
+	LLCircuitLock lock(this);
 	LLCircuitData *cdp = mCircuitInfo.findCircuit(mLastSender);
 	if (cdp)
 	{
@@ -3088,6 +3525,7 @@ const LLUUID& LLMessageSystem::getSenderID() const
 
 const LLUUID& LLMessageSystem::getSenderSessionID() const
 {
+	LLCircuitLock lock(this);
 	LLCircuitData *cdp = mCircuitInfo.findCircuit(mLastSender);
 	if (cdp)
 	{
@@ -3296,6 +3734,7 @@ void LLMessageSystem::sendDenyTrustedCircuit(const LLHost &host)
 
 void LLMessageSystem::reallySendDenyTrustedCircuit(const LLHost &host)
 {
+	LLCircuitLock lock(this);
 	LLCircuitData *cdp = mCircuitInfo.findCircuit(host);
 	if (!cdp)
 	{
@@ -3363,9 +3802,12 @@ void LLMessageSystem::establishBidirectionalTrust(const LLHost &host, S64 frame_
 	LLCircuitData* cdp = NULL;
 	while(!timeout.hasExpired())
 	{
-		cdp = mCircuitInfo.findCircuit(host);
-		if(!cdp) break; // no circuit anymore, no point continuing.
-		if(cdp->getTrusted()) break; // circuit is trusted.
+		{
+			LLCircuitLock lock(this);
+			cdp = mCircuitInfo.findCircuit(host);
+			if(!cdp) break; // no circuit anymore, no point continuing.
+			if(cdp->getTrusted()) break; // circuit is trusted.
+		}
 		checkMessages(frame_count);
 		processAcks();
 		ms_sleep(1);
@@ -192,6 +192,9 @@ class LLMsgBlkData;
 class LLMessageTemplate;
 
 class LLMessagePollInfo;
+class LLMessageReceiveThread;
+class LLReceivedMessage;
+class LLMutex;
 class LLMessageBuilder;
 class LLTemplateMessageBuilder;
 class LLSDMessageBuilder;
@@ -348,6 +351,26 @@ public:
 	BOOL	checkMessages( S64 frame_count = 0, bool faked_message = false, U8 fake_buffer[MAX_BUFFER_SIZE] = NULL, LLHost fake_host = LLHost(), S32 fake_size = 0 );
 	void	processAcks();
 
+	// Moves packet reads, validation, decoding and ack bookkeeping onto a
+	// separate thread.  Handlers still run from checkMessages() on the
+	// calling thread.  Call once, after the packet ring is configured.
+	void	startReceiveThread();
+	BOOL	hasReceiveThread() const { return mReceiveThread != NULL; }
+
+	// Circuit data is shared with the receive thread.  The main thread may
+	// nest these, since handlers send messages.
+	void	lockCircuits() const;
+	void	unlockCircuits() const;
+
+	class LLCircuitLock
+	{
+	public:
+		LLCircuitLock(const LLMessageSystem* msg) : mMessageSystem(msg) { mMessageSystem->lockCircuits(); }
+		~LLCircuitLock() { mMessageSystem->unlockCircuits(); }
+	private:
+		const LLMessageSystem* mMessageSystem;
+	};
+
 	BOOL	isMessageFast(const char *msg);
 	BOOL	isMessage(const char *msg)
 	{
@@ -840,7 +863,20 @@ private:
 
 
 	/** Find, create or revive circuit for host as needed */
-	LLCircuitData* findCircuit(const LLHost& host, bool resetPacketId);
+	LLCircuitData* findCircuit(const LLHost& host, bool resetPacketId, TPACKETID packet_id);
+
+	S32		zeroCodeExpand(U8** data, S32* data_size, U8* expand_buffer);
+
+	// checkMessages() when the receive thread is running
+	BOOL	checkReceivedMessages();
+	// Receive thread: reads and decodes one packet.  FALSE if none was waiting.
+	BOOL	receiveMessageOnThread(LLReceivedMessage& msg, LLTemplateMessageReader& reader, U8* expand_buffer);
+	friend class LLMessageReceiveThread;
+
+	LLMessageReceiveThread* mReceiveThread;
+	LLMutex* mCircuitMutex;
+	mutable S32 mCircuitLockDepth;		// main thread only
+	mutable bool mCircuitMutexHeld;
 };
 
 
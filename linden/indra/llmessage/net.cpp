@@ -43,6 +43,7 @@
 	#include <windows.h>
 #else
 	#include <sys/types.h>
+	#include <sys/select.h>
 	#include <sys/socket.h>
 	#include <netinet/in.h>
 	#include <arpa/inet.h>
@@ -58,6 +59,13 @@
 
 #include "llsocks5.h"
 
+#if LL_LINUX && defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 14))
+	// recvmmsg() is in glibc 2.12, sendmmsg() in 2.14
+	#define LL_NET_BATCH_IO 1
+#else
+	#define LL_NET_BATCH_IO 0
+#endif
+
 // Globals
 #if LL_WINDOWS
 
@@ -811,4 +819,162 @@ BOOL send_packet(int hSocket, const char * sendBuffer, int size, U32 recipient,
 
 #endif
 
+#if LL_NET_BATCH_IO
+
+BOOL net_batch_supported()
+{
+	return TRUE;
+}
+
+S32 receive_packets(int hSocket, LLNetPacket* packets, S32 count)
+{
+	struct mmsghdr msgs[NET_PACKET_BATCH_SIZE];
+	struct iovec iovs[NET_PACKET_BATCH_SIZE];
+	struct sockaddr_in addrs[NET_PACKET_BATCH_SIZE];
+	char cmsgs[NET_PACKET_BATCH_SIZE][CMSG_SPACE(sizeof(struct in_pktinfo))];
+
+	count = llmin(count, NET_PACKET_BATCH_SIZE);
+	memset(msgs, 0, sizeof(msgs[0]) * count);
+	for (S32 i = 0; i < count; i++)
+	{
+		iovs[i].iov_base = packets[i].mData;
+		iovs[i].iov_len = NET_BUFFER_SIZE;
+		msgs[i].msg_hdr.msg_name = &addrs[i];
+		msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+		msgs[i].msg_hdr.msg_iov = &iovs[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+		msgs[i].msg_hdr.msg_control = cmsgs[i];
+		msgs[i].msg_hdr.msg_controllen = sizeof(cmsgs[i]);
+	}
+
+	int received = recvmmsg(hSocket, msgs, count, MSG_DONTWAIT, NULL);
+	if (received <= 0)
+	{
+		return 0;
+	}
+
+	for (S32 i = 0; i < received; i++)
+	{
+		LLNetPacket& packet = packets[i];
+		packet.mSize = msgs[i].msg_len;
+		packet.mIP = addrs[i].sin_addr.s_addr;
+		packet.mPort = ntohs(addrs[i].sin_port);
+		packet.mReceivingIP = INVALID_HOST_IP_ADDRESS;
+		for (struct cmsghdr* cmsgptr = CMSG_FIRSTHDR(&msgs[i].msg_hdr); cmsgptr != NULL; cmsgptr = CMSG_NXTHDR(&msgs[i].msg_hdr, cmsgptr))
+		{
+			if (cmsgptr->cmsg_level == SOL_IP && cmsgptr->cmsg_type == IP_PKTINFO)
+			{
+				// see recvfrom_destip()
+				in_pktinfo* pktinfo = (in_pktinfo*)CMSG_DATA(cmsgptr);
+				packet.mReceivingIP = pktinfo->ipi_spec_dst.s_addr;
+			}
+		}
+	}
+	return received;
+}
+
+S32 send_packets(int hSocket, const LLNetPacket* packets, S32 count)
+{
+	struct mmsghdr msgs[NET_PACKET_BATCH_SIZE];
+	struct iovec iovs[NET_PACKET_BATCH_SIZE];
+	struct sockaddr_in addrs[NET_PACKET_BATCH_SIZE];
+
+	count = llmin(count, NET_PACKET_BATCH_SIZE);
+	memset(msgs, 0, sizeof(msgs[0]) * count);
+	memset(addrs, 0, sizeof(addrs[0]) * count);
+	for (S32 i = 0; i < count; i++)
+	{
+		iovs[i].iov_base = packets[i].mData;
+		iovs[i].iov_len = packets[i].mSize;
+		addrs[i].sin_family = AF_INET;
+		addrs[i].sin_addr.s_addr = packets[i].mIP;
+		addrs[i].sin_port = htons(packets[i].mPort);
+		msgs[i].msg_hdr.msg_name = &addrs[i];
+		msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+		msgs[i].msg_hdr.msg_iov = &iovs[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	// Same retry policy as send_packet(): up to 3 attempts per datagram
+	S32 sent = 0;
+	S32 failed = 0;
+	S32 send_attempts = 0;
+	while (sent + failed < count)
+	{
+		S32 first = sent + failed;
+		int ret = sendmmsg(hSocket, msgs + first, count - first, 0);
+		if (ret > 0)
+		{
+			sent += ret;
+			send_attempts = 0;
+			continue;
+		}
+		if ((errno == EAGAIN || errno == ECONNREFUSED) && ++send_attempts < 3)
+		{
+			continue;
+		}
+		// Give up on this one and go on with the rest of the batch
+		llinfos << "sendmmsg() failed: " << errno << ", " << strerror(errno) << " "
+				<< u32_to_ip_string(packets[first].mIP) << ":" << packets[first].mPort << llendl;
+		failed++;
+		send_attempts = 0;
+	}
+	return sent;
+}
+
+#else
+
+BOOL net_batch_supported()
+{
+	return FALSE;
+}
+
+S32 receive_packets(int hSocket, LLNetPacket* packets, S32 count)
+{
+	S32 received = 0;
+	while (received < count)
+	{
+		LLNetPacket& packet = packets[received];
+		packet.mSize = receive_packet(hSocket, packet.mData);
+		if (packet.mSize <= 0)
+		{
+			break;
+		}
+		packet.mIP = get_sender_ip();
+		packet.mPort = get_sender_port();
+		packet.mReceivingIP = get_receiving_interface_ip();
+		received++;
+	}
+	return received;
+}
+
+S32 send_packets(int hSocket, const LLNetPacket* packets, S32 count)
+{
+	S32 sent = 0;
+	for (S32 i = 0; i < count; i++)
+	{
+		if (send_packet(hSocket, packets[i].mData, packets[i].mSize, packets[i].mIP, packets[i].mPort))
+		{
+			sent++;
+		}
+	}
+	return sent;
+}
+
+#endif
+
+BOOL wait_for_packet(int hSocket, S32 timeout_msec)
+{
+	fd_set read_set;
+	FD_ZERO(&read_set);
+	FD_SET(hSocket, &read_set);
+
+	struct timeval timeout;
+	timeout.tv_sec = timeout_msec / 1000;
+	timeout.tv_usec = (timeout_msec % 1000) * 1000;
+
+	// first argument is ignored by winsock
+	return select(hSocket + 1, &read_set, NULL, NULL, &timeout) > 0;
+}
+
 //EOF
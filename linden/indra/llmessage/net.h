@@ -51,6 +51,26 @@ S32		receive_packet(int hSocket, char * receiveBuffer);
 
 BOOL	send_packet(int hSocket, const char *sendBuffer, int size, U32 recipient, int nPort);	// Returns TRUE on success.
 
+// Batched datagram I/O: one recvmmsg()/sendmmsg() call per batch on Linux,
+// a loop over receive_packet()/send_packet() elsewhere.
+const S32 NET_PACKET_BATCH_SIZE = 32;
+
+struct LLNetPacket
+{
+	char*	mData;			// NET_BUFFER_SIZE bytes
+	S32		mSize;
+	U32		mIP;			// sender when receiving, recipient when sending
+	U32		mPort;
+	U32		mReceivingIP;	// receiving interface, receive only
+};
+
+BOOL	net_batch_supported();	// TRUE if the batch calls are real syscalls
+S32		receive_packets(int hSocket, LLNetPacket* packets, S32 count);	// Returns the number of packets received, never blocks
+S32		send_packets(int hSocket, const LLNetPacket* packets, S32 count);	// Returns the number of packets sent
+
+// Blocks until hSocket is readable or timeout_msec passes. Returns TRUE if readable.
+BOOL	wait_for_packet(int hSocket, S32 timeout_msec);
+
 //void	get_sender(char * tmp);
 LLHost  get_sender();
 U32		get_sender_port();
@@ -211,6 +211,12 @@ void	init_patch_decoding(LLBitPack &bitpack)
 }
 
 void	decode_patch_group_header(LLBitPack &bitpack, LLGroupHeader *gopp)
+{
+	unpack_patch_group_header(bitpack, gopp);
+	gPatchSize = gopp->patch_size; 
+}
+
+void	unpack_patch_group_header(LLBitPack &bitpack, LLGroupHeader *gopp)
 {
 	U16 retvalu16;
 
@@ -231,11 +237,18 @@ void	decode_patch_group_header(LLBitPack &bitpack, LLGroupHeader *gopp)
 	retvalu8 = 0;
 	bitpack.bitUnpack(&retvalu8, 8);
 	gopp->layer_type = retvalu8;
-
-	gPatchSize = gopp->patch_size; 
 }
 
 void	decode_patch_header(LLBitPack &bitpack, LLPatchHeader *ph, BOOL b_large_patch)
+{
+	unpack_patch_header(bitpack, ph, b_large_patch);
+	if (END_OF_PATCHES != ph->quant_wbits)
+	{
+		gWordBits = (ph->quant_wbits & 0xf) + 2;
+	}
+}
+
+void	unpack_patch_header(LLBitPack &bitpack, LLPatchHeader *ph, BOOL b_large_patch)
 {
 	U8 retvalu8;
 
@@ -286,14 +299,17 @@ void	decode_patch_header(LLBitPack &bitpack, LLPatchHeader *ph, BOOL b_large_pat
 		bitpack.bitUnpack((U8 *)&retvalu32, 10);
 #endif
 	ph->patchids = retvalu32;
-
-	gWordBits = (ph->quant_wbits & 0xf) + 2;
 }
 
 void	decode_patch(LLBitPack &bitpack, S32 *patches)
+{
+	unpack_patch(bitpack, patches, gPatchSize, gWordBits);
+}
+
+void	unpack_patch(LLBitPack &bitpack, S32 *patches, S32 patch_size, S32 wbits)
 {
 #ifdef LL_BIG_ENDIAN
-	S32		i, j, patch_size = gPatchSize, wbits = gWordBits;
+	S32		i, j;
 	U8		tempu8;
 	U16		tempu16;
 	U32		tempu32;
@@ -366,7 +382,7 @@ void	decode_patch(LLBitPack &bitpack, S32 *patches)
 		}
 	}
 #else
-	S32		i, j, patch_size = gPatchSize, wbits = gWordBits;
+	S32		i, j;
 	U32		temp;
 	for (i = 0; i < patch_size*patch_size; i++)
 	{
@@ -49,4 +49,10 @@ void	decode_patch_group_header(LLBitPack &bitpack, LLGroupHeader *gopp);
 void	decode_patch_header(LLBitPack &bitpack, LLPatchHeader *ph, BOOL b_large_patch);
 void	decode_patch(LLBitPack &bitpack, S32 *patches);
 
+// As above, but without the patch size and word bits the decode_ functions
+// keep in globals, so that they can be used from any thread
+void	unpack_patch_group_header(LLBitPack &bitpack, LLGroupHeader *gopp);
+void	unpack_patch_header(LLBitPack &bitpack, LLPatchHeader *ph, BOOL b_large_patch);
+void	unpack_patch(LLBitPack &bitpack, S32 *patches, S32 patch_size, S32 word_bits);
+
 #endif
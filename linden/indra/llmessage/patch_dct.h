@@ -94,4 +94,10 @@ void init_patch_decompressor(S32 size);
 void decompress_patch(F32 *patch, S32 *cpatch, LLPatchHeader *ph);
 void decompress_patchv(LLVector3 *v, S32 *cpatch, LLPatchHeader *ph);
 
+// Fill caller owned size*size tables, as init_patch_decompressor() does
+// for the global ones
+void build_patch_dequantize_table(S32 size, F32 *table);
+void setup_patch_icosines(S32 size, F32 *icosines);
+void build_decopy_matrix(S32 size, S32 *decopy_matrix);
+
 #endif
@@ -45,14 +45,14 @@ void set_group_of_patch_header(LLGroupHeader *gopp)
 }
 
 F32 gPatchDequantizeTable[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
-void build_patch_dequantize_table(S32 size)
+void build_patch_dequantize_table(S32 size, F32 *table)
 {
 	S32 i, j;
 	for (j = 0; j < size; j++)
 	{
 		for (i = 0; i < size; i++)
 		{
-			gPatchDequantizeTable[j*size + i] = (1.f + 2.f*(i+j));
+			table[j*size + i] = (1.f + 2.f*(i+j));
 		}
 	}
 }
@@ -61,7 +61,7 @@ S32	gCurrentDeSize = 0;
 
 F32	gPatchICosines[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
 
-void setup_patch_icosines(S32 size)
+void setup_patch_icosines(S32 size, F32 *icosines)
 {
 	S32 n, u;
 	F32 oosob = F_PI*0.5f/size;
@@ -70,14 +70,14 @@ void setup_patch_icosines(S32 size)
 	{
 		for (n = 0; n < size; n++)
 		{
-			gPatchICosines[u*size+n] = cosf((2.f*n+1.f)*u*oosob);
+			icosines[u*size+n] = cosf((2.f*n+1.f)*u*oosob);
 		}
 	}
 }
 
 S32	gDeCopyMatrix[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
 
-void build_decopy_matrix(S32 size)
+void build_decopy_matrix(S32 size, S32 *decopy_matrix)
 {
 	S32 i, j, count;
 	BOOL	b_diag = FALSE;
@@ -90,7 +90,7 @@ void build_decopy_matrix(S32 size)
 	while (  (i < size)
 		   &&(j < size))
 	{
-		gDeCopyMatrix[j*size + i] = count;
+		decopy_matrix[j*size + i] = count;
 
 		count++;
 
@@ -146,9 +146,9 @@ void init_patch_decompressor(S32 size)
 	if (size != gCurrentDeSize)
 	{
 		gCurrentDeSize = size;
-		build_patch_dequantize_table(size);
-		setup_patch_icosines(size);
-		build_decopy_matrix(size);
+		build_patch_dequantize_table(size, gPatchDequantizeTable);
+		setup_patch_icosines(size, gPatchICosines);
+		build_decopy_matrix(size, gDeCopyMatrix);
 	}
 }
 
@@ -115,8 +115,11 @@ BOOL LLVFile::read(U8 *buffer, S32 bytes, BOOL async, F32 priority)
 	}
 	else
 	{
-		// We can't do a read while there are pending async writes on this file
-		mBytesRead = sVFSThread->readImmediate(mVFS, mFileID, mFileType, buffer, mPosition, bytes);
+		// Synchronous reads don't need the VFS thread; LLVFS::getData() only
+		// takes a shared lock and copies out of the mapped data file.  Queued
+		// writes hold VFSLOCK_APPEND until their data is stored, so the wait
+		// above keeps this read from returning stale data.
+		mBytesRead = mVFS->getData(mFileID, mFileType, buffer, mPosition, bytes);
 		mPosition += mBytesRead;
 		if (! mBytesRead)
 		{
@@ -44,6 +44,9 @@
 #else
 #include <sys/file.h>
 #endif
+#if !LL_WINDOWS
+#include <sys/mman.h>
+#endif
     
 #include "llvfs.h"
 #include "llstl.h"
@@ -55,6 +58,9 @@ const S32 BLOCK_LENGTH_INVALID = -1;	// mLength for invalid LLVFSFileBlocks
 
 LLVFS *gVFS = NULL;
 
+//static
+BOOL LLVFS::sUseMappedReads = TRUE;
+
 // internal class definitions
 class LLVFSBlock
 {
@@ -128,6 +134,7 @@ public:
 		mSize = 0;
 		mIndexLocation = -1;
 		mAccessTime = (U32)time(NULL);
+		mReadTime = 0;
 
 		for (S32 i = 0; i < (S32)VFSLOCK_COUNT; i++)
 		{
@@ -204,6 +211,19 @@ public:
 		swizzleCopy(&mSize, buffer, 4);
 	}
     
+	// Readers only hold the shared lock, so they stamp mReadTime instead of
+	// mAccessTime.  flushReadTime() folds it in under the exclusive lock,
+	// before the LRU or the index sees mAccessTime.
+	void touch() { mReadTime = (U32)time(NULL); }
+	void flushReadTime()
+	{
+		U32 read_time = mReadTime;
+		if (read_time > mAccessTime)
+		{
+			mAccessTime = read_time;
+		}
+	}
+
 	static BOOL insertLRU(LLVFSFileBlock* const& first,
 						  LLVFSFileBlock* const& second)
 	{
@@ -216,6 +236,7 @@ public:
 	S32  mSize;
 	S32  mIndexLocation; // location of index entry
 	U32  mAccessTime;
+	LLAtomicU32 mReadTime;
 	BOOL mLocks[VFSLOCK_COUNT]; // number of outstanding locks of each type
     
 	static const S32 SERIAL_SIZE;
@@ -237,7 +258,13 @@ const S32 LLVFSFileBlock::SERIAL_SIZE = 34;
 LLVFS::LLVFS(const std::string& index_filename, const std::string& data_filename, const BOOL read_only, const U32 presize, const BOOL remove_after_crash)
 :	mRemoveAfterCrash(remove_after_crash)
 {
-	mDataMutex = new LLMutex;
+	mDataLock = new AIRWLock;
+	mFileMutex = new LLMutex;
+	mMappedData = NULL;
+	mMappedSize = 0;
+#if LL_WINDOWS
+	mMappingHandle = NULL;
+#endif
 
 	S32 i;
 	for (i = 0; i < VFSLOCK_COUNT; i++)
@@ -584,6 +611,11 @@ LLVFS::LLVFS(const std::string& index_filename, const std::string& data_filename
 		}
 	}
 
+	if (sUseMappedReads)
+	{
+		mapDataFile(data_size);
+	}
+
 	// Success!
 	LL_INFOS("VFS") << "Using index file " << mIndexFilename << LL_ENDL;
 	LL_INFOS("VFS") << "Using data file " << mDataFilename << LL_ENDL;
@@ -593,7 +625,7 @@ LLVFS::LLVFS(const std::string& index_filename, const std::string& data_filename
     
 LLVFS::~LLVFS()
 {
-	if (mDataMutex->isLocked())
+	if (mFileMutex->isLocked())
 	{
 		LL_ERRS("VFS") << "LLVFS destroyed with mutex locked" << LL_ENDL;
 	}
@@ -612,6 +644,7 @@ LLVFS::~LLVFS()
 
 	for_each(mFreeBlocksByLocation.begin(), mFreeBlocksByLocation.end(), DeletePairedPointer());
     
+	unmapDataFile();
 	unlockAndClose(mDataFP);
 	mDataFP = NULL;
     
@@ -622,7 +655,102 @@ LLVFS::~LLVFS()
 		LLFile::remove(marker);
 	}
 
-	delete mDataMutex;
+	delete mFileMutex;
+	delete mDataLock;
+}
+
+void LLVFS::mapDataFile(U32 size)
+{
+	if (!mDataFP || !size)
+	{
+		return;
+	}
+	if (sizeof(void*) < 8 && size > 0x20000000)
+	{
+		// Don't eat half of a 32 bit address space; reads fall back to stdio.
+		LL_INFOS("VFS") << "Not mapping " << size << " byte VFS data file" << LL_ENDL;
+		return;
+	}
+
+	// Make sure the mapping sees everything written so far
+	fflush(mDataFP);
+#if LL_WINDOWS
+	HANDLE file = (HANDLE)_get_osfhandle(_fileno(mDataFP));
+	HANDLE mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping)
+	{
+		void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, size);
+		if (view)
+		{
+			mMappingHandle = mapping;
+			mMappedData = (U8*)view;
+		}
+		else
+		{
+			CloseHandle(mapping);
+		}
+	}
+#else
+	void* view = mmap(NULL, size, PROT_READ, MAP_SHARED, fileno(mDataFP), 0);
+	if (view != MAP_FAILED)
+	{
+		mMappedData = (U8*)view;
+	}
+#endif
+	if (mMappedData)
+	{
+		mMappedSize = size;
+		LL_INFOS("VFS") << "Mapped " << size << " bytes of " << mDataFilename << LL_ENDL;
+	}
+	else
+	{
+		LL_WARNS("VFS") << "Unable to map " << mDataFilename << ", using buffered reads" << LL_ENDL;
+	}
+}
+
+void LLVFS::unmapDataFile()
+{
+	if (!mMappedData)
+	{
+		return;
+	}
+#if LL_WINDOWS
+	UnmapViewOfFile(mMappedData);
+	CloseHandle((HANDLE)mMappingHandle);
+	mMappingHandle = NULL;
+#else
+	munmap(mMappedData, mMappedSize);
+#endif
+	mMappedData = NULL;
+	mMappedSize = 0;
+}
+
+// Caller must hold at least a shared lock on mDataLock
+S32 LLVFS::readDataFile(U32 location, U8* buffer, S32 length)
+{
+	if (mMappedData && location + (U32)length <= mMappedSize)
+	{
+		memcpy(buffer, mMappedData + location, length);		/* Flawfinder: ignore */
+		return length;
+	}
+
+	LLMutexLock lock(mFileMutex);
+	fseek(mDataFP, location, SEEK_SET);
+	return (S32)fread(buffer, 1, length, mDataFP);
+}
+
+// Caller must hold the exclusive lock on mDataLock
+S32 LLVFS::writeDataFile(U32 location, const U8* buffer, S32 length)
+{
+	LLMutexLock lock(mFileMutex);
+	fseek(mDataFP, location, SEEK_SET);
+	S32 write_len = (S32)fwrite(buffer, 1, length, mDataFP);
+	if (mMappedData)
+	{
+		// Readers of the mapping don't see stdio buffers
+		fflush(mDataFP);
+	}
+	return write_len;
 }
 
 void LLVFS::presizeDataFile(const U32 size)
@@ -661,19 +789,19 @@ BOOL LLVFS::getExists(const LLUUID &file_id, const LLAssetType::EType file_type)
 		llerrs << "Attempting to use invalid VFS!" << llendl;
 	}
 
-	lockData();
+	lockDataShared();
 	
 	LLVFSFileSpecifier spec(file_id, file_type);
 	fileblock_map::iterator it = mFileBlocks.find(spec);
 	if (it != mFileBlocks.end())
 	{
 		block = (*it).second;
-		block->mAccessTime = (U32)time(NULL);
+		block->touch();
 	}
 
 	BOOL res = (block && block->mLength > 0) ? TRUE : FALSE;
 	
-	unlockData();
+	unlockDataShared();
 	
 	return res;
 }
@@ -688,7 +816,7 @@ S32	 LLVFS::getSize(const LLUUID &file_id, const LLAssetType::EType file_type)
 
 	}
 
-	lockData();
+	lockDataShared();
 	
 	LLVFSFileSpecifier spec(file_id, file_type);
 	fileblock_map::iterator it = mFileBlocks.find(spec);
@@ -696,11 +824,11 @@ S32	 LLVFS::getSize(const LLUUID &file_id, const LLAssetType::EType file_type)
 	{
 		LLVFSFileBlock *block = (*it).second;
 
-		block->mAccessTime = (U32)time(NULL);
+		block->touch();
 		size = block->mSize;
 	}
 
-	unlockData();
+	unlockDataShared();
 	
 	return size;
 }
@@ -714,7 +842,7 @@ S32  LLVFS::getMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type
 		llerrs << "Attempting to use invalid VFS!" << llendl;
 	}
 
-	lockData();
+	lockDataShared();
 	
 	LLVFSFileSpecifier spec(file_id, file_type);
 	fileblock_map::iterator it = mFileBlocks.find(spec);
@@ -722,11 +850,11 @@ S32  LLVFS::getMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type
 	{
 		LLVFSFileBlock *block = (*it).second;
 
-		block->mAccessTime = (U32)time(NULL);
+		block->touch();
 		size = block->mLength;
 	}
 
-	unlockData();
+	unlockDataShared();
 
 	return size;
 }
@@ -864,11 +992,9 @@ BOOL LLVFS::setMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type
 					{
 						// move the file into the new block
 						U8 *buffer = new U8[block->mSize];
-						fseek(mDataFP, block->mLocation, SEEK_SET);
-						if (fread(buffer, block->mSize, 1, mDataFP) == 1)
+						if (readDataFile(block->mLocation, buffer, block->mSize) == block->mSize)
 						{
-							fseek(mDataFP, new_data_location, SEEK_SET);
-							if (fwrite(buffer, block->mSize, 1, mDataFP) != 1)
+							if (writeDataFile(new_data_location, buffer, block->mSize) != block->mSize)
 							{
 								llwarns << "Short write" << llendl;
 							}
@@ -1073,7 +1199,7 @@ S32 LLVFS::getData(const LLUUID &file_id, const LLAssetType::EType file_type, U8
 
 	BOOL do_read = FALSE;
 	
-    lockData();
+    lockDataShared();
 	
 	LLVFSFileSpecifier spec(file_id, file_type);
 	fileblock_map::iterator it = mFileBlocks.find(spec);
@@ -1081,7 +1207,7 @@ S32 LLVFS::getData(const LLUUID &file_id, const LLAssetType::EType file_type, U8
 	{
 		LLVFSFileBlock *block = (*it).second;
 
-		block->mAccessTime = (U32)time(NULL);
+		block->touch();
     
 		if (location > block->mSize)
 		{
@@ -1100,11 +1226,10 @@ S32 LLVFS::getData(const LLUUID &file_id, const LLAssetType::EType file_type, U8
 
 	if (do_read)
 	{
-		fseek(mDataFP, location, SEEK_SET);
-		bytesread = (S32)fread(buffer, 1, length, mDataFP);
+		bytesread = readDataFile(location, buffer, length);
 	}
 	
-	unlockData();
+	unlockDataShared();
 
 	return bytesread;
 }
@@ -1170,13 +1295,11 @@ S32 LLVFS::storeData(const LLUUID &file_id, const LLAssetType::EType file_type,
 			}
 			U32 file_location = location + block->mLocation;
 			
-			fseek(mDataFP, file_location, SEEK_SET);
-			S32 write_len = (S32)fwrite(buffer, 1, length, mDataFP);
+			S32 write_len = writeDataFile(file_location, buffer, length);
 			if (write_len != length)
 			{
 				llwarns << llformat("VFS Write Error: %d != %d",write_len,length) << llendl;
 			}
-			// fflush(mDataFP);
 			
 			if (location + length > block->mSize)
 			{
@@ -1247,7 +1370,7 @@ void LLVFS::decLock(const LLUUID &file_id, const LLAssetType::EType file_type, E
 
 BOOL LLVFS::isLocked(const LLUUID &file_id, const LLAssetType::EType file_type, EVFSLock lock)
 {
-	lockData();
+	lockDataShared();
 	
 	BOOL res = FALSE;
 	
@@ -1259,7 +1382,7 @@ BOOL LLVFS::isLocked(const LLUUID &file_id, const LLAssetType::EType file_type,
 		res = (block->mLocks[lock] > 0);
 	}
 
-	unlockData();
+	unlockDataShared();
 
 	return res;
 }
@@ -1506,6 +1629,7 @@ void LLVFS::sync(LLVFSFileBlock *block, BOOL remove)
 	}
 	else
 	{
+		block->flushReadTime();
 		block->serialize(buffer);
 	}
 
@@ -1562,6 +1686,7 @@ LLVFSBlock *LLVFS::findFreeBlock(S32 size, LLVFSFileBlock *immune)
 				for (fileblock_map::iterator it = mFileBlocks.begin(); it != mFileBlocks.end(); ++it)
 				{
 					LLVFSFileBlock *tmp = (*it).second;
+					tmp->flushReadTime();
 
 					if (tmp != immune &&
 						tmp->mLength > 0 &&
@@ -1647,16 +1772,16 @@ void LLVFS::pokeFiles()
 	
 	// only write data if we actually read 4 bytes
 	// otherwise we're writing garbage and screwing up the file
-	fseek(mDataFP, 0, SEEK_SET);
-	if (fread(&word, sizeof(word), 1, mDataFP) == 1)
+	lockData();
+	if (readDataFile(0, (U8*)&word, sizeof(word)) == sizeof(word))
 	{
-		fseek(mDataFP, 0, SEEK_SET);
-		if (fwrite(&word, sizeof(word), 1, mDataFP) != 1)
+		if (writeDataFile(0, (U8*)&word, sizeof(word)) != sizeof(word))
 		{
 			llwarns << "Could not write to data file" << llendl;
 		}
 		fflush(mDataFP);
 	}
+	unlockData();
 
 	fseek(mIndexFP, 0, SEEK_SET);
 	if (fread(&word, sizeof(word), 1, mIndexFP) == 1)
@@ -1694,8 +1819,8 @@ void LLVFS::dumpMap()
 // Very slow, do not call routinely. JC
 void LLVFS::audit()
 {
-	// Lock the mutex through this whole function.
-	LLMutexLock lock_data(mDataMutex);
+	// Lock the data through this whole function.
+	lockData();
 	
 	fflush(mIndexFP);
 
@@ -1748,6 +1873,7 @@ void LLVFS::audit()
 				// try to keep data from being lost
 				unlockAndClose(mIndexFP);
 				mIndexFP = NULL;
+				unmapDataFile();
 				unlockAndClose(mDataFP);
 				mDataFP = NULL;
 				llwarns << "VFS: Original block index " << block->mIndexLocation
@@ -1826,10 +1952,10 @@ void LLVFS::audit()
 		}
     
 		llinfos << "VFS: audit OK" << llendl;
-		// mutex released by LLMutexLock() destructor.
 	}
 
 	for_each(audit_blocks.begin(), audit_blocks.end(), DeletePointer());
+	unlockData();
 }
     
     
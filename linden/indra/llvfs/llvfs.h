@@ -85,7 +85,9 @@ public:
 	BOOL isValid() const			{ return (VFSVALID_OK == mValid); }
 	EVFSValid getValidState() const	{ return mValid; }
 
-	// ---------- The following fucntions lock/unlock mDataMutex ----------
+	// ---------- The following fucntions lock/unlock mDataLock ----------
+	// getExists(), getSize(), getMaxSize(), isLocked() and getData() only take
+	// a shared lock, so they run concurrently with each other.
 	BOOL getExists(const LLUUID &file_id, const LLAssetType::EType file_type);
 	S32	 getSize(const LLUUID &file_id, const LLAssetType::EType file_type);
 
@@ -106,6 +108,11 @@ public:
 	BOOL isLocked(const LLUUID &file_id, const LLAssetType::EType file_type, EVFSLock lock);
 	// ----------------------------------------------------------------
 
+	// Reads are served from a read-only mapping of the data file when possible.
+	// Only affects VFSs created after the call.
+	static void setUseMappedReads(BOOL enable) { sUseMappedReads = enable; }
+	BOOL isDataMapped() const { return mMappedData != NULL; }
+
 	// Used to trigger evil WinXP behavior of "preloading" entire file into memory.
 	void pokeFiles();
 
@@ -134,17 +141,40 @@ protected:
 
 	static LLFILE *openAndLock(const std::string& filename, const char* mode, BOOL read_lock);
 	static void unlockAndClose(FILE *fp);
+
+	// Map/unmap the first size bytes of mDataFP for reading
+	void mapDataFile(U32 size);
+	void unmapDataFile();
+
+	// Raw access to the data file.  Reads use the mapping when the range lies
+	// inside it, anything else goes through mDataFP under mFileMutex.
+	S32 readDataFile(U32 location, U8* buffer, S32 length);
+	S32 writeDataFile(U32 location, const U8* buffer, S32 length);
 	
 	// Can initiate LRU-based file removal to make space.
 	// The immune file block will not be removed.
 	LLVFSBlock *findFreeBlock(S32 size, LLVFSFileBlock *immune = NULL);
 
-	// lock/unlock data mutex (mDataMutex)
-	void lockData() { mDataMutex->lock(); }
-	void unlockData() { mDataMutex->unlock(); }	
+	// exclusive lock, needed to change the index, the free lists or the data file
+	void lockData() { mDataLock->wrlock(); }
+	void unlockData() { mDataLock->wrunlock(); }
+	// shared lock, for lookups and reads
+	void lockDataShared() { mDataLock->rdlock(); }
+	void unlockDataShared() { mDataLock->rdunlock(); }
 	
 protected:
-	LLMutex* mDataMutex;
+	AIRWLock* mDataLock;
+	// Serializes the stdio position/buffer of mDataFP between shared readers
+	LLMutex* mFileMutex;
+
+	// Read-only view of the data file, NULL if not mapped
+	U8* mMappedData;
+	U32 mMappedSize;
+#if LL_WINDOWS
+	void* mMappingHandle;
+#endif
+
+	static BOOL sUseMappedReads;
 	
 	typedef std::map<LLVFSFileSpecifier, LLVFSFileBlock*> fileblock_map;
 	fileblock_map mFileBlocks;
@@ -0,0 +1,188 @@
+/**
+ * @file llvfs_bench.cpp
+ * @brief Measures concurrent LLVFile read throughput, buffered and mapped.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#include "linden_common.h"
+
+#include "lldir.h"
+#include "llfile.h"
+#include "llthread.h"
+#include "lltimer.h"
+#include "llvfile.h"
+#include "llvfs.h"
+
+// Writes a set of files into a scratch VFS, then has several threads read
+// all of them through LLVFile a number of times, once with buffered reads
+// and once with the data file mapped.  Reports MB/s for both and exits
+// with 1 if any read came back wrong.
+//
+// usage: llvfs_bench [-t threads] [-f files] [-s file_size] [-p passes]
+
+namespace
+{
+	// Fills buffer with a pattern that depends on the file index
+	void fill_pattern(U8* buffer, S32 size, S32 index)
+	{
+		for (S32 i = 0; i < size; ++i)
+		{
+			buffer[i] = (U8)((i * 7 + index * 13) & 0xff);
+		}
+	}
+
+	// Reads every file through LLVFile, passes times
+	class VFSReader : public LLThread
+	{
+	public:
+		VFSReader(LLVFS* vfs, const std::vector<LLUUID>& ids, S32 file_size, S32 passes)
+			: LLThread("vfs reader"), mVFS(vfs), mIDs(ids), mFileSize(file_size), mPasses(passes),
+			  mErrors(0), mBytes(0)
+		{
+		}
+
+		/*virtual*/ void run()
+		{
+			std::vector<U8> expected(mFileSize);
+			std::vector<U8> buffer(mFileSize);
+			for (S32 pass = 0; pass < mPasses; ++pass)
+			{
+				for (S32 i = 0; i < (S32)mIDs.size(); ++i)
+				{
+					LLVFile file(mVFS, mIDs[i], LLAssetType::AT_NOTECARD, LLVFile::READ);
+					file.read(&buffer[0], mFileSize);	/* Flawfinder: ignore */
+					mBytes += file.getLastBytesRead();
+					fill_pattern(&expected[0], mFileSize, i);
+					if (file.getLastBytesRead() != mFileSize || buffer != expected)
+					{
+						++mErrors;
+					}
+				}
+			}
+		}
+
+		LLVFS* mVFS;
+		std::vector<LLUUID> mIDs;
+		S32 mFileSize;
+		S32 mPasses;
+		S32 mErrors;
+		S64 mBytes;
+	};
+
+	// Builds a VFS holding the files, reads it with threads readers and
+	// returns the throughput in MB/s.
+	F64 bench(BOOL mapped, const std::vector<LLUUID>& ids, S32 file_size, S32 threads, S32 passes,
+			  S32& errors)
+	{
+		std::string base = gDirUtilp->getTempFilename();
+		std::string index_file = base + ".index.db2";
+		std::string data_file = base + ".data.db2";
+
+		LLVFS::setUseMappedReads(mapped);
+		S32 vfs_size = llmax(16 * 1024 * 1024, 2 * file_size * (S32)ids.size());
+		LLVFS* vfs = new LLVFS(index_file, data_file, FALSE, vfs_size, FALSE);
+		std::vector<U8> buffer(file_size);
+		for (S32 i = 0; i < (S32)ids.size(); ++i)
+		{
+			fill_pattern(&buffer[0], file_size, i);
+			LLVFile::writeFile(&buffer[0], file_size, vfs, ids[i], LLAssetType::AT_NOTECARD);
+		}
+
+		std::vector<VFSReader*> readers;
+		LLTimer timer;
+		for (S32 i = 0; i < threads; ++i)
+		{
+			readers.push_back(new VFSReader(vfs, ids, file_size, passes));
+			readers.back()->start();
+		}
+		S64 bytes = 0;
+		errors = 0;
+		for (S32 i = 0; i < threads; ++i)
+		{
+			while (!readers[i]->isStopped())
+			{
+				ms_sleep(1);
+			}
+			bytes += readers[i]->mBytes;
+			errors += readers[i]->mErrors;
+			delete readers[i];
+		}
+		F64 elapsed = llmax(timer.getElapsedTimeF64(), 1.0e-6);
+
+		delete vfs;
+		LLFile::remove(index_file);
+		LLFile::remove(data_file);
+		return (F64)bytes / (1024.0 * 1024.0) / elapsed;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	S32 threads = 4;
+	S32 files = 64;
+	S32 file_size = 32 * 1024;
+	S32 passes = 20;
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		S32 value = llmax(1, atoi(argv[i + 1]));
+		if (!strcmp(argv[i], "-t"))
+		{
+			threads = value;
+		}
+		else if (!strcmp(argv[i], "-f"))
+		{
+			files = value;
+		}
+		else if (!strcmp(argv[i], "-s"))
+		{
+			file_size = value;
+		}
+		else if (!strcmp(argv[i], "-p"))
+		{
+			passes = value;
+		}
+	}
+
+	LLVFile::initClass();
+	std::vector<LLUUID> ids;
+	for (S32 i = 0; i < files; ++i)
+	{
+		ids.push_back(LLUUID::generateNewID());
+	}
+
+	S32 buffered_errors = 0;
+	S32 mapped_errors = 0;
+	F64 buffered_rate = bench(FALSE, ids, file_size, threads, passes, buffered_errors);
+	F64 mapped_rate = bench(TRUE, ids, file_size, threads, passes, mapped_errors);
+	printf("%d threads, %d files of %d bytes, %d passes: buffered %.1f MB/s, mapped %.1f MB/s  %s\n",
+		   threads, files, file_size, passes, buffered_rate, mapped_rate,
+		   buffered_errors || mapped_errors ? "READ ERRORS" : "all reads ok");
+	return buffered_errors || mapped_errors ? 1 : 0;
+}
@@ -107,7 +107,8 @@ LLControlVariable::LLControlVariable(const std::string& name, eControlType type,
 	  mComment(comment),
 	  mType(type),
 	  mPersist(persist),
-	  mHideFromSettingsEditor(hidefromsettingseditor)
+	  mHideFromSettingsEditor(hidefromsettingseditor),
+	  mLookupCount(0)
 {
 	if (mPersist && mComment.empty())
 	{
@@ -257,7 +258,12 @@ LLSD LLControlVariable::getSaveValue() const
 LLPointer<LLControlVariable> LLControlGroup::getControl(const std::string& name)
 {
 	ctrl_name_table_t::iterator iter = mNameTable.find(name);
-	return iter == mNameTable.end() ? LLPointer<LLControlVariable>() : iter->second;
+	if (iter == mNameTable.end())
+	{
+		return LLPointer<LLControlVariable>();
+	}
+	iter->second->mLookupCount++;
+	return iter->second;
 }
 
 
@@ -1177,6 +1183,34 @@ void LLControlGroup::applyToAll(ApplyFunctor* func)
 	}
 }
 
+static bool more_lookups(const std::pair<std::string, U32>& a, const std::pair<std::string, U32>& b)
+{
+	return a.second > b.second;
+}
+
+void LLControlGroup::getLookupCounts(lookup_count_list_t& counts, U32 max_count, bool reset)
+{
+	counts.clear();
+	for (ctrl_name_table_t::iterator iter = mNameTable.begin();
+		 iter != mNameTable.end(); ++iter)
+	{
+		LLControlVariable* control = iter->second;
+		U32 lookups = control->mLookupCount;
+		if (lookups > 0)
+		{
+			counts.push_back(std::make_pair(iter->first, lookups));
+		}
+		if (reset)
+		{
+			control->mLookupCount = 0;
+		}
+	}
+
+	U32 count = llmin(max_count, (U32)counts.size());
+	std::partial_sort(counts.begin(), counts.begin() + count, counts.end(), more_lookups);
+	counts.resize(count);
+}
+
 //============================================================================
 // First-use
 
@@ -1226,6 +1260,115 @@ void LLControlGroup::resetWarnings()
 	}
 }
 
+template <> eControlType get_control_type<U32>(const U32& in, LLSD& out) 
+{ 
+	out = (LLSD::Integer)in; 
+	return TYPE_U32; 
+}
+
+template <> eControlType get_control_type<S32>(const S32& in, LLSD& out) 
+{ 
+	out = in; 
+	return TYPE_S32; 
+}
+
+template <> eControlType get_control_type<F32>(const F32& in, LLSD& out) 
+{ 
+	out = in; 
+	return TYPE_F32; 
+}
+
+template <> eControlType get_control_type<bool> (const bool& in, LLSD& out) 
+{ 
+	out = in; 
+	return TYPE_BOOLEAN; 
+}
+/*
+// Yay BOOL, its really an S32.
+template <> eControlType get_control_type<BOOL> (const BOOL& in, LLSD& out) 
+{ 
+	out = in; 
+	return TYPE_BOOLEAN; 
+}
+*/
+template <> eControlType get_control_type<std::string>(const std::string& in, LLSD& out) 
+{ 
+	out = in; 
+	return TYPE_STRING; 
+}
+
+template <> eControlType get_control_type<LLVector3>(const LLVector3& in, LLSD& out) 
+{ 
+	out = in.getValue(); 
+	return TYPE_VEC3; 
+}
+
+template <> eControlType get_control_type<LLVector3d>(const LLVector3d& in, LLSD& out) 
+{ 
+	out = in.getValue(); 
+	return TYPE_VEC3D; 
+}
+
+template <> eControlType get_control_type<LLRect>(const LLRect& in, LLSD& out) 
+{ 
+	out = in.getValue(); 
+	return TYPE_RECT; 
+}
+
+template <> eControlType get_control_type<LLColor4>(const LLColor4& in, LLSD& out) 
+{ 
+	out = in.getValue(); 
+	return TYPE_COL4; 
+}
+
+template <> eControlType get_control_type<LLColor3>(const LLColor3& in, LLSD& out) 
+{ 
+	out = in.getValue(); 
+	return TYPE_COL3; 
+}
+
+template <> eControlType get_control_type<LLColor4U>(const LLColor4U& in, LLSD& out) 
+{ 
+	out = in.getValue();
+	return TYPE_COL4U; 
+}
+
+template <> eControlType get_control_type<LLSD>(const LLSD& in, LLSD& out) 
+{ 
+	out = in;
+	return TYPE_LLSD; 
+}
+
+template <> U32 convert_from_llsd<U32>(const LLSD& sd)
+{
+	return (U32)sd.asInteger();
+}
+
+template <> S32 convert_from_llsd<S32>(const LLSD& sd)
+{
+	return sd.asInteger();
+}
+
+template <> F32 convert_from_llsd<F32>(const LLSD& sd)
+{
+	return (F32)sd.asReal();
+}
+
+template <> bool convert_from_llsd<bool>(const LLSD& sd)
+{
+	return sd.asBoolean();
+}
+
+template <> std::string convert_from_llsd<std::string>(const LLSD& sd)
+{
+	return sd.asString();
+}
+
+template <> LLSD convert_from_llsd<LLSD>(const LLSD& sd)
+{
+	return sd;
+}
+
 template <>					void jc_rebind::rebind_callback<S32>(const LLSD &data, S32 *reciever){ *reciever = data.asInteger(); }
 template <>					void jc_rebind::rebind_callback<F32>(const LLSD &data, F32 *reciever){ *reciever = data.asReal(); }
 template <>					void jc_rebind::rebind_callback<U32>(const LLSD &data, U32 *reciever){ *reciever = data.asInteger(); }
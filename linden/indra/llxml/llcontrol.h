@@ -33,6 +33,7 @@
 #ifndef LL_LLCONTROL_H
 #define LL_LLCONTROL_H
 
+#include "llapr.h"
 #include "llevent.h"
 #include "llnametable.h"
 #include "llmap.h"
@@ -41,6 +42,7 @@
 
 #include "llcontrolgroupreader.h"
 
+#include <typeinfo>
 #include <vector>
 
 // *NOTE: boost::visit_each<> generates warning 4675 on .net 2003
@@ -98,6 +100,7 @@ private:
 	bool			mPersist;
 	bool			mHideFromSettingsEditor;
 	std::vector<LLSD> mValues;
+	LLAtomicU32		mLookupCount;	// Times LLControlGroup::getControl() found this; any thread
 	
 	signal_t mSignal;
 	
@@ -230,6 +233,10 @@ public:
  	U32	loadFromFile(const std::string& filename, bool default_values = false);
 	void	resetToDefaults();
 
+	// The most looked up controls since the last reset, busiest first.
+	// Each getX() by name is one lookup; an LLCachedControl is one in all.
+	typedef std::vector<std::pair<std::string, U32> > lookup_count_list_t;
+	void	getLookupCounts(lookup_count_list_t& counts, U32 max_count, bool reset);
 	
 	// Ignorable Warnings
 	
@@ -242,6 +249,133 @@ public:
 	void resetWarnings();
 };
 
+//! Helpers for LLCachedControl
+template <class T> 
+eControlType get_control_type(const T& in, LLSD& out)
+{
+	llerrs << "Unsupported control type: " << typeid(T).name() << "." << llendl;
+	return TYPE_COUNT;
+}
+
+template <class T>
+T convert_from_llsd(const LLSD& sd)
+{
+	return T(sd);
+}
+
+//! A typed copy of one control's value, kept current through the
+//! control's signal, so reading it is a plain load rather than a name
+//! lookup and an LLSD conversion.  Meant for settings read every frame:
+//!
+//!   static LLCachedControl<F32> sRenderGlowWidth(gSavedSettings, "RenderGlowWidth");
+//!   F32 delta = sRenderGlowWidth / glow_res;
+//!
+//! Without a default the control must already exist; with one, a missing
+//! control is declared, unsaved, with that value.
+template <class T>
+class LLCachedControl
+{
+public:
+	LLCachedControl(LLControlGroup& group, const std::string& name)
+		: mCachedValue()
+	{
+		mControl = group.getControl(name);
+		if (mControl.isNull())
+		{
+			llwarns << "Control " << name << " does not exist, caching a default value" << llendl;
+			return;
+		}
+		bind();
+	}
+
+	LLCachedControl(LLControlGroup& group,
+					const std::string& name, 
+					const T& default_value, 
+					const std::string& comment = "Declared In Code")
+		: mCachedValue(default_value)
+	{
+		mControl = group.getControl(name);
+		if (mControl.isNull())
+		{
+			LLSD init_value;
+			eControlType type = get_control_type<T>(default_value, init_value);
+			if (type < TYPE_COUNT)
+			{
+				group.declareControl(name, type, init_value, comment, FALSE);
+				mControl = group.getControl(name);
+			}
+			if (mControl.isNull())
+			{
+				llwarns << "Control " << name << " could not be created" << llendl;
+				return;
+			}
+		}
+		bind();
+	}
+
+	~LLCachedControl()
+	{
+		mConnection.disconnect();
+	}
+
+	LLCachedControl& operator =(const T& newvalue)
+	{
+		LLSD value;
+		if (mControl.notNull() && get_control_type<T>(newvalue, value) < TYPE_COUNT)
+		{
+			// handleValueChange() updates the cached value
+			mControl->set(value);
+		}
+		return *this;
+	}
+
+	operator const T&() const { return mCachedValue; }
+	const T& get() const { return mCachedValue; }
+
+private:
+	// A copy would leave the signal pointing at the original
+	LLCachedControl(const LLCachedControl&);
+	LLCachedControl& operator =(const LLCachedControl&);
+
+	void bind()
+	{
+		mCachedValue = convert_from_llsd<T>(mControl->getValue());
+		mConnection = mControl->getSignal()->connect(
+			boost::bind(&LLCachedControl<T>::handleValueChange, this, _1));
+	}
+
+	void handleValueChange(const LLSD& newvalue)
+	{
+		mCachedValue = convert_from_llsd<T>(newvalue);
+	}
+
+	T mCachedValue;
+	LLPointer<LLControlVariable> mControl;
+	boost::signals::connection mConnection;
+};
+
+template <> eControlType get_control_type<U32>(const U32& in, LLSD& out);
+template <> eControlType get_control_type<S32>(const S32& in, LLSD& out);
+template <> eControlType get_control_type<F32>(const F32& in, LLSD& out);
+template <> eControlType get_control_type<bool> (const bool& in, LLSD& out); 
+// Yay BOOL, its really an S32.
+//template <> eControlType get_control_type<BOOL> (const BOOL& in, LLSD& out) 
+template <> eControlType get_control_type<std::string>(const std::string& in, LLSD& out);
+template <> eControlType get_control_type<LLVector3>(const LLVector3& in, LLSD& out);
+template <> eControlType get_control_type<LLVector3d>(const LLVector3d& in, LLSD& out); 
+template <> eControlType get_control_type<LLRect>(const LLRect& in, LLSD& out);
+template <> eControlType get_control_type<LLColor4>(const LLColor4& in, LLSD& out);
+template <> eControlType get_control_type<LLColor3>(const LLColor3& in, LLSD& out);
+template <> eControlType get_control_type<LLColor4U>(const LLColor4U& in, LLSD& out); 
+template <> eControlType get_control_type<LLSD>(const LLSD& in, LLSD& out);
+
+template <> U32 convert_from_llsd<U32>(const LLSD& sd);
+template <> S32 convert_from_llsd<S32>(const LLSD& sd);
+template <> F32 convert_from_llsd<F32>(const LLSD& sd);
+template <> bool convert_from_llsd<bool>(const LLSD& sd);
+template <> std::string convert_from_llsd<std::string>(const LLSD& sd);
+template <> LLSD convert_from_llsd<LLSD>(const LLSD& sd);
+
 ///////////////////////
 namespace jc_you_suck
 {
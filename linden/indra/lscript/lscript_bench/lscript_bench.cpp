@@ -0,0 +1,210 @@
+/**
+ * @file lscript_bench.cpp
+ * @brief Measures LSL2 instructions per second, interpreted and predecoded.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#include "linden_common.h"
+
+#include "lltimer.h"
+#include "lluuid.h"
+#include "lscript_execute.h"
+#include "lscript_rt_interface.h"
+
+// Compiles each .lsl fixture with lscript_compile(), or loads a .lso file
+// as is, runs it from state_entry until it settles once interpreted and
+// once predecoded, and reports instructions per second for both.  Exits
+// with 1 if the two runs do not end in the same state.
+//
+// usage: lscript_bench [-r repeats] [file.lsl|file.lso ...]
+// With no files, runs the fixtures next to this source.
+
+#ifndef LSCRIPT_BENCH_FIXTURES
+#define LSCRIPT_BENCH_FIXTURES "fixtures"
+#endif
+
+namespace
+{
+	const char* DEFAULT_FIXTURES[] =
+	{
+		"integer_loop.lsl",
+		"float_math.lsl",
+		"function_calls.lsl",
+		"strings_lists.lsl",
+		"state_changes.lsl",
+		NULL
+	};
+
+	const F32 TIME_SLICE = 0.1f;
+
+	bool ends_with(const std::string& str, const std::string& suffix)
+	{
+		return str.size() >= suffix.size()
+			&& str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+	}
+
+	bool read_file(const std::string& filename, std::vector<U8>& data)
+	{
+		LLFILE* fp = LLFile::fopen(filename, "rb");
+		if (!fp)
+		{
+			return false;
+		}
+		fseek(fp, 0, SEEK_END);
+		long size = ftell(fp);
+		fseek(fp, 0, SEEK_SET);
+		data.resize(size > 0 ? size : 0);
+		bool ok = size > 0 && fread(&data[0], 1, size, fp) == (size_t)size;
+		fclose(fp);
+		return ok;
+	}
+
+	// Returns the bytecode for filename, compiling it first if it is LSL.
+	bool load_bytecode(const std::string& filename, std::vector<U8>& bytecode)
+	{
+		std::string lso_filename = filename;
+		if (ends_with(filename, ".lsl"))
+		{
+			std::string base = filename.substr(0, filename.size() - 4);
+			std::string::size_type slash = base.find_last_of("/\\");
+			if (slash != std::string::npos)
+			{
+				base = base.substr(slash + 1);
+			}
+			lso_filename = base + ".lso";
+			std::string err_filename = base + ".out";
+			if (!lscript_compile(filename.c_str(), lso_filename.c_str(), err_filename.c_str(),
+								 FALSE, "lscript_bench"))
+			{
+				printf("%s: failed to compile, see %s\n", filename.c_str(), err_filename.c_str());
+				return false;
+			}
+		}
+
+		if (!read_file(lso_filename, bytecode) || bytecode.size() > (size_t)TOP_OF_MEMORY)
+		{
+			printf("%s: can't read bytecode\n", lso_filename.c_str());
+			return false;
+		}
+		return true;
+	}
+
+	// Runs events until the script is idle or faulted.  Returns the time taken.
+	F64 run_script(LLScriptExecuteLSL2& script)
+	{
+		LLTimer timer;
+		LLTimer slice;
+		const char* error = NULL;
+		U32 events_processed = 0;
+		do
+		{
+			slice.reset();
+			script.runQuanta(FALSE, LLUUID::null, &error, TIME_SLICE, events_processed, slice);
+		}
+		while (!script.getFaults()
+			   && (!script.isFinished()
+				   || script.isStateChangePending()
+				   || (script.getCurrentEvents() & script.getEventHandlers())));
+		return timer.getElapsedTimeF64();
+	}
+
+	bool bench(const std::string& filename, S32 repeats)
+	{
+		std::vector<U8> bytecode;
+		if (!load_bytecode(filename, bytecode))
+		{
+			return false;
+		}
+
+		F64 interpreted_time = 0.0;
+		F64 predecoded_time = 0.0;
+		U32 instructions = 0;
+		bool same = true;
+		for (S32 i = 0; i < repeats; i++)
+		{
+			LLScriptExecuteLSL2 interpreted(&bytecode[0], (U32)bytecode.size());
+			interpreted_time += run_script(interpreted);
+
+			LLScriptExecuteLSL2 predecoded(&bytecode[0], (U32)bytecode.size());
+			predecoded.setPredecoded(true);
+			predecoded_time += run_script(predecoded);
+
+			instructions += interpreted.mInstructionCount;
+			same = same
+				&& interpreted.mInstructionCount == predecoded.mInstructionCount
+				&& !memcmp(interpreted.mBuffer, predecoded.mBuffer, TOP_OF_MEMORY);
+			if (interpreted.getFaults())
+			{
+				printf("%s: faulted with %s\n", filename.c_str(),
+					   LSCRIPTRunTimeFaultStrings[interpreted.getFaults()]);
+			}
+		}
+
+		F64 interpreted_rate = instructions / llmax(interpreted_time, 1.0e-9);
+		F64 predecoded_rate = instructions / llmax(predecoded_time, 1.0e-9);
+		printf("%-24s %10u instructions  interpreted %8.2f M/s  predecoded %8.2f M/s  %5.2fx  %s\n",
+			   filename.c_str(), instructions / repeats,
+			   interpreted_rate / 1.0e6, predecoded_rate / 1.0e6,
+			   predecoded_rate / interpreted_rate,
+			   same ? "same state" : "STATE MISMATCH");
+		return same;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	S32 repeats = 5;
+	std::vector<std::string> files;
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "-r") && i + 1 < argc)
+		{
+			repeats = llmax(1, atoi(argv[++i]));
+		}
+		else
+		{
+			files.push_back(argv[i]);
+		}
+	}
+	if (files.empty())
+	{
+		for (S32 i = 0; DEFAULT_FIXTURES[i]; i++)
+		{
+			files.push_back(std::string(LSCRIPT_BENCH_FIXTURES) + "/" + DEFAULT_FIXTURES[i]);
+		}
+	}
+
+	bool same = true;
+	for (std::vector<std::string>::iterator iter = files.begin(); iter != files.end(); ++iter)
+	{
+		same = bench(*iter, repeats) && same;
+	}
+	return same ? 0 : 1;
+}
@@ -472,6 +472,8 @@ private:
 	static	S32		sTimerCheckSkip;		// Number of times to skip the timer check for performance reasons
 };
 
+class LLScriptPredecoder;
+
 class LLScriptExecuteLSL2 : public LLScriptExecute
 {
 public:
@@ -536,6 +538,12 @@ public:
 
 	void init();
 
+	// Runs bytecode from a cache of decoded instructions, several per
+	// resumeEventHandler() call, instead of interpreting one at a time.
+	// The script ends up in the same state either way.
+	void setPredecoded(bool predecoded);
+	bool isPredecoded() const { return mPredecoder != NULL; }
+
 	BOOL (*mExecuteFuncs[0x100])(U8 *buffer, S32 &offset, BOOL b_print, const LLUUID &id);
 
 	U32						mInstructionCount;
@@ -549,6 +557,8 @@ private:
 	void		recordBoundaryError( const LLUUID &id );
 	void		setStateEventOpcoodeStartSafely( S32 state, LSCRIPTStateEventType event, const LLUUID &id );
 
+	LLScriptPredecoder*		mPredecoder;
+
 	// Called when the script is scheduled to be run from newsim/LLScriptData
 	virtual void startRunning();
 
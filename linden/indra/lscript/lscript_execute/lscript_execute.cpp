@@ -41,11 +41,16 @@
 #include "lscript_library.h"
 #include "lscript_heapruntime.h"
 #include "lscript_alloc.h"
+#include "lscript_predecode.h"
 
 // Static
 const	S32	DEFAULT_SCRIPT_TIMER_CHECK_SKIP = 4;
 S32		LLScriptExecute::sTimerCheckSkip = DEFAULT_SCRIPT_TIMER_CHECK_SKIP;
 
+// Instructions run per resumeEventHandler() call in predecoded mode.  The
+// time slice is only checked between calls, so keep this small.
+const	U32	PREDECODED_BATCH_SIZE = 64;
+
 void (*binary_operations[LST_EOF][LST_EOF])(U8 *buffer, LSCRIPTOpCodesEnum opcode);
 void (*unary_operations[LST_EOF])(U8 *buffer, LSCRIPTOpCodesEnum opcode);
 
@@ -114,6 +119,7 @@ LLScriptExecuteLSL2::~LLScriptExecuteLSL2()
 {
 	delete[] mBuffer;
 	delete[] mBytecode;
+	delete mPredecoder;
 }
 
 void LLScriptExecuteLSL2::init()
@@ -121,6 +127,7 @@ void LLScriptExecuteLSL2::init()
 	S32 i, j;
 
 	mInstructionCount = 0;
+	mPredecoder = NULL;
 
 	for (i = 0; i < 256; i++)
 	{
@@ -316,8 +323,31 @@ void LLScriptExecuteLSL2::setStateEventOpcoodeStartSafely( S32 state, LSCRIPTSta
 
 S32 lscript_push_variable(LLScriptLibData *data, U8 *buffer);
 
+void LLScriptExecuteLSL2::setPredecoded(bool predecoded)
+{
+	if (!predecoded)
+	{
+		delete mPredecoder;
+		mPredecoder = NULL;
+	}
+	else if (!mPredecoder)
+	{
+		mPredecoder = new LLScriptPredecoder(mExecuteFuncs);
+	}
+}
+
 void LLScriptExecuteLSL2::resumeEventHandler(BOOL b_print, const LLUUID &id, F32 time_slice)
 {
+	if (mPredecoder && !b_print)
+	{
+		U32 count = mPredecoder->run(mBuffer, id, PREDECODED_BATCH_SIZE);
+		if (count)
+		{
+			mInstructionCount += count;
+			return;
+		}
+	}
+
 	//	call opcode run function pointer with buffer and IP
 	mInstructionCount++;
 	S32 value = get_register(mBuffer, LREG_IP);
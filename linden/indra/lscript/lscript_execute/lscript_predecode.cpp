@@ -0,0 +1,627 @@
+/**
+ * @file lscript_predecode.cpp
+ * @brief Pre-decoded, direct-threaded execution of LSL2 bytecode
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#include "linden_common.h"
+
+#include "lscript_predecode.h"
+#include "lscript_execute.h"
+
+extern void (*binary_operations[LST_EOF][LST_EOF])(U8 *buffer, LSCRIPTOpCodesEnum opcode);
+extern void (*unary_operations[LST_EOF])(U8 *buffer, LSCRIPTOpCodesEnum opcode);
+
+const void* const* LLScriptPredecoder::sHandlers = NULL;
+
+namespace
+{
+	enum
+	{
+		KIND_BARRIER,				// ends the run, left to the interpreter
+		KIND_EXECUTE,				// calls the run_* function
+		KIND_NOOP,
+		KIND_POP,
+		KIND_POPARG,
+		KIND_PUSH,
+		KIND_PUSHG,
+		KIND_STORE,
+		KIND_STOREG,
+		KIND_LOADP,
+		KIND_LOADGP,
+		KIND_PUSHARGB,
+		KIND_PUSHARGI,				// also PUSHARGF, the bits are the same
+		KIND_PUSHE,
+		KIND_OPERATION,				// binary or unary operation picked at decode time
+		KIND_JUMP,
+		KIND_JUMPIF_INTEGER,
+		KIND_JUMPIF_FLOAT,
+		KIND_JUMPNIF_INTEGER,
+		KIND_JUMPNIF_FLOAT,
+		KIND_EOF
+	};
+
+	// LSCRIPTOpCodesEnum for each opcode byte
+	S32 sOpcodes[0x100];
+
+	U8 safe_op_index(U8 index)
+	{
+		return index >= LST_EOF ? (U8)LST_NULL : index;
+	}
+
+	inline bool is_faulted(const U8 *buffer)
+	{
+		S32 fault = get_register(buffer, LREG_FR);
+		return fault > LSRF_INVALID && fault < LSRF_EOF;
+	}
+
+	// Same arithmetic as add_register_fp(buffer, LREG_ESR, -0.1f), on the
+	// register's bits so the result is rounded the same way.
+	inline bool use_energy(S32 &esr)
+	{
+		F32 value = *(F32 *)&esr;
+		value += -0.1f;
+		esr = *(S32 *)&value;
+		return llfinite(value);
+	}
+}
+
+LLScriptPredecoder::LLScriptPredecoder(lscript_execute_func_t* execute_funcs)
+	: mExecuteFuncs(execute_funcs),
+	  mCodeStart(0),
+	  mCodeEnd(0)
+{
+	if (sOpcodes[LSCRIPTOpCodes[LOPC_POP]] != LOPC_POP)
+	{
+		for (S32 i = LOPC_NOOP; i < LOPC_EOF; i++)
+		{
+			sOpcodes[LSCRIPTOpCodes[i]] = i;
+		}
+	}
+}
+
+void LLScriptPredecoder::clear()
+{
+	mIndex.clear();
+	mInstructions.clear();
+	mCodeStart = 0;
+	mCodeEnd = 0;
+}
+
+U16 LLScriptPredecoder::decode(U8 *buffer, S32 ip)
+{
+	U8 opcode = buffer[ip];
+
+	Instruction insn;
+	insn.mKind = KIND_EXECUTE;
+	insn.mArg = 0;
+	insn.mNext = ip + 1;
+	insn.mExecute = mExecuteFuncs[opcode];
+	insn.mOperation = NULL;
+	insn.mOpcode = (LSCRIPTOpCodesEnum)sOpcodes[opcode];
+
+	// Only replace the run_* functions the handlers were written from.
+	lscript_execute_func_t expected = NULL;
+	S32 kind = KIND_EXECUTE;
+	S32 offset = ip + 1;
+	switch (insn.mOpcode)
+	{
+	case LOPC_NOOP:
+		expected = run_noop;
+		kind = KIND_NOOP;
+		break;
+	case LOPC_POP:
+		expected = run_pop;
+		kind = KIND_POP;
+		break;
+	case LOPC_PUSHE:
+		expected = run_pushe;
+		kind = KIND_PUSHE;
+		break;
+	case LOPC_POPARG:
+		expected = run_poparg;
+		kind = KIND_POPARG;
+		break;
+	case LOPC_PUSH:
+		expected = run_push;
+		kind = KIND_PUSH;
+		break;
+	case LOPC_PUSHG:
+		expected = run_pushg;
+		kind = KIND_PUSHG;
+		break;
+	case LOPC_STORE:
+		expected = run_store;
+		kind = KIND_STORE;
+		break;
+	case LOPC_STOREG:
+		expected = run_storeg;
+		kind = KIND_STOREG;
+		break;
+	case LOPC_LOADP:
+		expected = run_loadp;
+		kind = KIND_LOADP;
+		break;
+	case LOPC_LOADGP:
+		expected = run_loadgp;
+		kind = KIND_LOADGP;
+		break;
+	case LOPC_PUSHARGI:
+		expected = run_pushargi;
+		kind = KIND_PUSHARGI;
+		break;
+	case LOPC_PUSHARGF:
+		expected = run_pushargf;
+		kind = KIND_PUSHARGI;
+		break;
+	case LOPC_PUSHARGB:
+		expected = run_pushargb;
+		kind = KIND_PUSHARGB;
+		break;
+	case LOPC_JUMP:
+		expected = run_jump;
+		kind = KIND_JUMP;
+		break;
+	case LOPC_JUMPIF:
+		expected = run_jumpif;
+		kind = KIND_JUMPIF_INTEGER;
+		break;
+	case LOPC_JUMPNIF:
+		expected = run_jumpnif;
+		kind = KIND_JUMPNIF_INTEGER;
+		break;
+	case LOPC_ADD:
+		expected = run_add;
+		kind = KIND_OPERATION;
+		break;
+	case LOPC_SUB:
+		expected = run_sub;
+		kind = KIND_OPERATION;
+		break;
+	case LOPC_MUL:
+		expected = run_mul;
+		kind = KIND_OPERATION;
+		break;
+	case LOPC_DIV:
+		expected = run_div;
+		kind = KIND_OPERATION;
+		break;
+	case LOPC_MOD:
+		expected = run_mod;
+		kind = KIND_OPERATION;
+		break;
+	case LOPC_EQ:
+		expected = run_eq;
+		kind = KIND_OPERATION;
+		break;
+	case LOPC_NEQ:
+		expected = run_neq;
+		kind = KIND_OPERATION;
+		break;
+	case LOPC_LEQ:
+		expected = run_leq;
+		kind = KIND_OPERATION;
+		break;
+	case LOPC_GEQ:
+		expected = run_geq;
+		kind = KIND_OPERATION;
+		break;
+	case LOPC_LESS:
+		expected = run_less;
+		kind = KIND_OPERATION;
+		break;
+	case LOPC_GREATER:
+		expected = run_greater;
+		kind = KIND_OPERATION;
+		break;
+	case LOPC_BITAND:
+		expected = run_bitand;
+		kind = KIND_OPERATION;
+		break;
+	case LOPC_BITOR:
+		expected = run_bitor;
+		kind = KIND_OPERATION;
+		break;
+	case LOPC_BITXOR:
+		expected = run_bitxor;
+		kind = KIND_OPERATION;
+		break;
+	case LOPC_BOOLAND:
+		expected = run_booland;
+		kind = KIND_OPERATION;
+		break;
+	case LOPC_BOOLOR:
+		expected = run_boolor;
+		kind = KIND_OPERATION;
+		break;
+	case LOPC_SHL:
+		expected = run_shl;
+		kind = KIND_OPERATION;
+		break;
+	case LOPC_SHR:
+		expected = run_shr;
+		kind = KIND_OPERATION;
+		break;
+	case LOPC_NEG:
+		expected = run_neg;
+		kind = KIND_OPERATION;
+		break;
+	case LOPC_BITNOT:
+		expected = run_bitnot;
+		kind = KIND_OPERATION;
+		break;
+	case LOPC_BOOLNOT:
+		expected = run_boolnot;
+		kind = KIND_OPERATION;
+		break;
+	case LOPC_STATE:
+	case LOPC_CALLLIB:
+	case LOPC_CALLLIB_TWO_BYTE:
+	case LOPC_POPSLR:
+	case LOPC_PRINT:
+		// These change the state, sleep or energy registers the
+		// interpreter checks after every instruction.
+		kind = KIND_BARRIER;
+		expected = insn.mExecute;
+		break;
+	default:
+		break;
+	}
+
+	if (kind != KIND_EXECUTE && insn.mExecute == expected)
+	{
+		// Operands that run past the code are left to the run_*
+		// function, which raises the bounds fault.
+		switch (kind)
+		{
+		case KIND_POPARG:
+		case KIND_PUSH:
+		case KIND_PUSHG:
+		case KIND_STORE:
+		case KIND_STOREG:
+		case KIND_LOADP:
+		case KIND_LOADGP:
+		case KIND_PUSHARGI:
+		case KIND_JUMP:
+			if (offset + LSCRIPTDataSize[LST_INTEGER] <= mCodeEnd)
+			{
+				insn.mArg = bytestream2integer(buffer, offset);
+				insn.mKind = kind;
+				if (insn.mOpcode == LOPC_PUSHARGF && !llfinite(*(F32 *)&insn.mArg))
+				{
+					// run_pushargf() faults on these
+					insn.mKind = KIND_EXECUTE;
+				}
+			}
+			break;
+		case KIND_PUSHARGB:
+			if (offset + 1 <= mCodeEnd)
+			{
+				insn.mArg = bytestream2byte(buffer, offset);
+				insn.mKind = kind;
+			}
+			break;
+		case KIND_JUMPIF_INTEGER:
+		case KIND_JUMPNIF_INTEGER:
+			if (offset + 1 + LSCRIPTDataSize[LST_INTEGER] <= mCodeEnd)
+			{
+				U8 type = bytestream2byte(buffer, offset);
+				insn.mArg = bytestream2integer(buffer, offset);
+				if (type == LST_INTEGER)
+				{
+					insn.mKind = kind;
+				}
+				else if (type == LST_FLOATINGPOINT)
+				{
+					insn.mKind = kind + (KIND_JUMPIF_FLOAT - KIND_JUMPIF_INTEGER);
+				}
+			}
+			break;
+		case KIND_OPERATION:
+			switch (insn.mOpcode)
+			{
+			case LOPC_BITAND:
+			case LOPC_BITOR:
+			case LOPC_BITXOR:
+			case LOPC_BOOLAND:
+			case LOPC_BOOLOR:
+			case LOPC_SHL:
+			case LOPC_SHR:
+				insn.mOperation = binary_operations[LST_INTEGER][LST_INTEGER];
+				break;
+			case LOPC_BITNOT:
+			case LOPC_BOOLNOT:
+				insn.mOperation = unary_operations[LST_INTEGER];
+				break;
+			case LOPC_NEG:
+				if (offset + 1 <= mCodeEnd)
+				{
+					insn.mOperation = unary_operations[safe_op_index(bytestream2byte(buffer, offset))];
+				}
+				break;
+			default:
+				if (offset + 1 <= mCodeEnd)
+				{
+					U8 types = bytestream2byte(buffer, offset);
+					insn.mOperation = binary_operations[safe_op_index(types >> 4)][safe_op_index(types & 0xf)];
+				}
+				break;
+			}
+			if (insn.mOperation)
+			{
+				insn.mKind = kind;
+			}
+			break;
+		default:
+			insn.mKind = kind;
+			break;
+		}
+		insn.mNext = offset;
+	}
+
+	insn.mHandler = sHandlers ? sHandlers[insn.mKind] : NULL;
+	mInstructions.push_back(insn);
+	return (U16)(mInstructions.size() - 1);
+}
+
+#if LSCRIPT_DIRECT_THREADED
+#define LSCRIPT_HANDLER(kind)	handle_##kind:
+#define LSCRIPT_DISPATCH()		goto *insn->mHandler
+#else
+#define LSCRIPT_HANDLER(kind)	case KIND_##kind:
+#define LSCRIPT_DISPATCH()		goto dispatch
+#endif
+
+U32 LLScriptPredecoder::run(U8 *buffer, const LLUUID &id, U32 max_count)
+{
+#if LSCRIPT_DIRECT_THREADED
+	static const void* const handlers[KIND_EOF] =
+	{
+		&&handle_BARRIER,
+		&&handle_EXECUTE,
+		&&handle_NOOP,
+		&&handle_POP,
+		&&handle_POPARG,
+		&&handle_PUSH,
+		&&handle_PUSHG,
+		&&handle_STORE,
+		&&handle_STOREG,
+		&&handle_LOADP,
+		&&handle_LOADGP,
+		&&handle_PUSHARGB,
+		&&handle_PUSHARGI,
+		&&handle_PUSHE,
+		&&handle_OPERATION,
+		&&handle_JUMP,
+		&&handle_JUMPIF_INTEGER,
+		&&handle_JUMPIF_FLOAT,
+		&&handle_JUMPNIF_INTEGER,
+		&&handle_JUMPNIF_FLOAT
+	};
+	sHandlers = handlers;
+#endif
+
+	S32 gfr = get_register(buffer, LREG_GFR);
+	S32 hr = get_register(buffer, LREG_HR);
+	if (gfr != mCodeStart || hr != mCodeEnd)
+	{
+		clear();
+		if (gfr <= 0 || hr <= gfr || hr > TOP_OF_MEMORY)
+		{
+			return 0;
+		}
+		mCodeStart = gfr;
+		mCodeEnd = hr;
+		mIndex.resize(hr - gfr, 0);
+	}
+
+	S32 ip = get_register(buffer, LREG_IP);
+	if (ip < mCodeStart || ip >= mCodeEnd)
+	{
+		return 0;
+	}
+
+	S32 offset = gLSCRIPTRegisterAddresses[LREG_ESR];
+	S32 esr = bytestream2integer(buffer, offset);
+	if (!llfinite(*(F32 *)&esr))
+	{
+		// let add_register_fp() raise the fault
+		return 0;
+	}
+
+	const Instruction* insn = fetch(buffer, ip);
+	if (insn->mKind == KIND_BARRIER)
+	{
+		return 0;
+	}
+
+	U32 count = 0;
+	S32 next = ip;
+	bool energy_ok = true;
+	LSCRIPT_DISPATCH();
+
+#if !LSCRIPT_DIRECT_THREADED
+dispatch:
+	switch (insn->mKind)
+	{
+#endif
+	LSCRIPT_HANDLER(BARRIER)
+		// ip == next, nothing has run at ip yet
+		goto done;
+
+	LSCRIPT_HANDLER(EXECUTE)
+		next = ip;
+		insn->mExecute(buffer, next, FALSE, id);
+		goto step;
+
+	LSCRIPT_HANDLER(NOOP)
+		next = insn->mNext;
+		goto step;
+
+	LSCRIPT_HANDLER(POP)
+		next = insn->mNext;
+		lscript_poparg(buffer, LSCRIPTDataSize[LST_INTEGER]);
+		goto step;
+
+	LSCRIPT_HANDLER(POPARG)
+		next = insn->mNext;
+		lscript_poparg(buffer, insn->mArg);
+		goto step;
+
+	LSCRIPT_HANDLER(PUSH)
+		next = insn->mNext;
+		lscript_push(buffer, lscript_local_get(buffer, insn->mArg));
+		goto step;
+
+	LSCRIPT_HANDLER(PUSHG)
+		next = insn->mNext;
+		lscript_push(buffer, lscript_global_get(buffer, insn->mArg));
+		goto step;
+
+	LSCRIPT_HANDLER(STORE)
+		{
+			next = insn->mNext;
+			S32 sp = get_register(buffer, LREG_SP);
+			S32 value = bytestream2integer(buffer, sp);
+			lscript_local_store(buffer, insn->mArg, value);
+		}
+		goto step;
+
+	LSCRIPT_HANDLER(STOREG)
+		{
+			next = insn->mNext;
+			S32 sp = get_register(buffer, LREG_SP);
+			S32 value = bytestream2integer(buffer, sp);
+			lscript_global_store(buffer, insn->mArg, value);
+		}
+		goto step;
+
+	LSCRIPT_HANDLER(LOADP)
+		next = insn->mNext;
+		lscript_local_store(buffer, insn->mArg, lscript_pop_int(buffer));
+		goto step;
+
+	LSCRIPT_HANDLER(LOADGP)
+		next = insn->mNext;
+		lscript_global_store(buffer, insn->mArg, lscript_pop_int(buffer));
+		goto step;
+
+	LSCRIPT_HANDLER(PUSHARGB)
+		next = insn->mNext;
+		lscript_push(buffer, (U8)insn->mArg);
+		goto step;
+
+	LSCRIPT_HANDLER(PUSHARGI)
+		next = insn->mNext;
+		lscript_push(buffer, insn->mArg);
+		goto step;
+
+	LSCRIPT_HANDLER(PUSHE)
+		next = insn->mNext;
+		lscript_pusharge(buffer, LSCRIPTDataSize[LST_INTEGER]);
+		goto step;
+
+	LSCRIPT_HANDLER(OPERATION)
+		next = insn->mNext;
+		insn->mOperation(buffer, insn->mOpcode);
+		goto step;
+
+	LSCRIPT_HANDLER(JUMP)
+		next = insn->mNext + insn->mArg;
+		goto step;
+
+	LSCRIPT_HANDLER(JUMPIF_INTEGER)
+		next = insn->mNext;
+		if (lscript_pop_int(buffer))
+		{
+			next += insn->mArg;
+		}
+		goto step;
+
+	LSCRIPT_HANDLER(JUMPIF_FLOAT)
+		next = insn->mNext;
+		if (lscript_pop_float(buffer))
+		{
+			next += insn->mArg;
+		}
+		goto step;
+
+	LSCRIPT_HANDLER(JUMPNIF_INTEGER)
+		next = insn->mNext;
+		if (!lscript_pop_int(buffer))
+		{
+			next += insn->mArg;
+		}
+		goto step;
+
+	LSCRIPT_HANDLER(JUMPNIF_FLOAT)
+		next = insn->mNext;
+		if (!lscript_pop_float(buffer))
+		{
+			next += insn->mArg;
+		}
+		goto step;
+#if !LSCRIPT_DIRECT_THREADED
+	default:
+		goto done;
+	}
+#endif
+
+step:
+	// The interpreter sets IP, charges energy and checks for faults and
+	// yields after every instruction.  Only IP and ESR can have changed
+	// here, and they stay in locals until the run ends.
+	++count;
+	energy_ok = use_energy(esr);
+	if (count >= max_count
+		|| next < mCodeStart
+		|| next >= mCodeEnd
+		|| !energy_ok
+		|| is_faulted(buffer))
+	{
+		goto done;
+	}
+	ip = next;
+	insn = fetch(buffer, ip);
+	LSCRIPT_DISPATCH();
+
+done:
+	// The last instruction ran at ip.  A bad next IP leaves IP there.
+	set_register(buffer, LREG_IP, ip);
+	set_ip(buffer, next);
+	if (!energy_ok)
+	{
+		esr = 0;
+		set_fault(buffer, LSRF_MATH);
+	}
+	offset = gLSCRIPTRegisterAddresses[LREG_ESR];
+	integer2bytestream(buffer, offset, esr);
+	return count;
+}
@@ -0,0 +1,108 @@
+/**
+ * @file lscript_predecode.h
+ * @brief Pre-decoded, direct-threaded execution of LSL2 bytecode
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#ifndef LL_LSCRIPT_PREDECODE_H
+#define LL_LSCRIPT_PREDECODE_H
+
+#include <vector>
+
+#include "lscript_byteconvert.h"
+
+// GCC can jump straight to the handler stored with each decoded
+// instruction, other compilers dispatch through a switch.
+#if LL_GNUC
+#define LSCRIPT_DIRECT_THREADED 1
+#else
+#define LSCRIPT_DIRECT_THREADED 0
+#endif
+
+typedef BOOL (*lscript_execute_func_t)(U8 *buffer, S32 &offset, BOOL b_print, const LLUUID &id);
+
+// Runs LSL2 bytecode from a cache of decoded instructions.  Each
+// instruction is decoded the first time it runs: its operand is read and
+// bounds checked once and its handler is picked, so the interpreter's
+// opcode lookup, operand checks and per-instruction register traffic are
+// gone.  Common stack, arithmetic and jump instructions have their own
+// handlers; every other instruction calls the same run_* function as the
+// interpreter, so both leave identical state behind.
+class LLScriptPredecoder
+{
+public:
+	LLScriptPredecoder(lscript_execute_func_t* execute_funcs);
+
+	// Forgets all decoded instructions.
+	void clear();
+
+	// Runs instructions from IP until max_count have run, a fault is
+	// raised, IP leaves the code or the next instruction may end the time
+	// slice (STATE, CALLLIB, POPSLR, PRINT).  Updates IP and ESR exactly as
+	// running them one at a time would.  Returns the number run, 0 when the
+	// instruction at IP has to go through the interpreter.
+	U32 run(U8 *buffer, const LLUUID &id, U32 max_count);
+
+	S32 getDecodedCount() const { return (S32)mInstructions.size(); }
+
+private:
+	struct Instruction
+	{
+		const void* mHandler;		// label in run() when direct threaded
+		S32 mKind;
+		S32 mArg;					// decoded operand
+		S32 mNext;					// offset of the following instruction
+		lscript_execute_func_t mExecute;
+		void (*mOperation)(U8 *buffer, LSCRIPTOpCodesEnum opcode);
+		LSCRIPTOpCodesEnum mOpcode;
+	};
+
+	const Instruction* fetch(U8 *buffer, S32 ip)
+	{
+		U16& index = mIndex[ip - mCodeStart];
+		if (!index)
+		{
+			index = decode(buffer, ip) + 1;
+		}
+		return &mInstructions[index - 1];
+	}
+
+	U16 decode(U8 *buffer, S32 ip);
+
+	lscript_execute_func_t* mExecuteFuncs;
+	S32 mCodeStart;							// GFR the instructions were decoded from
+	S32 mCodeEnd;							// HR the instructions were decoded from
+	std::vector<U16> mIndex;				// per code byte, decoded instruction + 1
+	std::vector<Instruction> mInstructions;
+
+	static const void* const* sHandlers;
+};
+
+#endif // LL_LSCRIPT_PREDECODE_H
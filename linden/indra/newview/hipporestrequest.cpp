@@ -52,6 +52,9 @@ class HippoRestComplete : public LLURLRequestComplete
 		void complete(const LLChannelDescriptors &channels, const buffer_ptr_t &buffer)
 		{
 			mHandler->handle(mStatus, mReason, channels, buffer);
+			// done with the handler on the thread that ran it
+			delete mHandler;
+			mHandler = NULL;
 		}
 
 	private:
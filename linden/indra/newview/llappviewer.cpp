@@ -47,6 +47,7 @@
 #include "llviewerstats.h"
 #include "llmd5.h"
 #include "llpumpio.h"
+#include "llpumpthread.h"
 #include "llimpanel.h"
 #include "llmimetypes.h"
 #include "llstartup.h"
@@ -150,6 +151,7 @@
 #include "llframestats.h"
 #include "llagentpilot.h"
 #include "llsrv.h"
+#include "llvocache.h"
 #include "llvovolume.h"
 #include "llflexibleobject.h" 
 #include "llvosurfacepatch.h"
@@ -165,6 +167,7 @@
 #include "llgesturemgr.h"
 #include "llsky.h"
 #include "llvlmanager.h"
+#include "llvlcomposition.h"
 #include "llviewercamera.h"
 #include "lldrawpoolbump.h"
 #include "llvieweraudio.h"
@@ -252,6 +255,8 @@ LLSD gDebugInfo;
 U32	gFrameCount = 0;
 U32 gForegroundFrameCount = 0; // number of frames that app window was in foreground
 LLPumpIO* gServicePump = NULL;
+LLPumpIO* gHTTPPump = NULL;
+static LLPumpThread* sHTTPPumpThread = NULL;
 
 BOOL gPacificDaylightTime = FALSE;
 
@@ -917,7 +922,21 @@ bool LLAppViewer::mainLoop()
 
 	// Create IO Pump to use for HTTP Requests.
 	gServicePump = new LLPumpIO;
-	LLHTTPClient::setPump(*gServicePump);
+	if (gSavedSettings.getBOOL("HTTPPumpThread"))
+	{
+		// HTTP requests get a pump of their own which is pumped on a
+		// thread. Their responses are still run from the main loop by
+		// gHTTPPump->callback(). Voice and other socket chains stay on
+		// gServicePump since their pipes touch viewer state.
+		gHTTPPump = new LLPumpIO;
+		sHTTPPumpThread = new LLPumpThread(gHTTPPump);
+		sHTTPPumpThread->start();
+		LLHTTPClient::setPump(*gHTTPPump);
+	}
+	else
+	{
+		LLHTTPClient::setPump(*gServicePump);
+	}
 	LLCurl::setCAFile(gDirUtilp->getCAFile());
 	
 	// Note: this is where gLocalSpeakerMgr and gActiveSpeakerMgr used to be instantiated.
@@ -1004,6 +1023,10 @@ bool LLAppViewer::mainLoop()
 						// this pump is necessary to make the login screen show up
 						gServicePump->pump();
 						gServicePump->callback();
+						if (gHTTPPump)
+						{
+							gHTTPPump->callback();
+						}
 					}
 					
 					resumeMainloopTimeout();
@@ -1164,6 +1187,14 @@ bool LLAppViewer::mainLoop()
 		}
 	}
 	
+	if (sHTTPPumpThread)
+	{
+		sHTTPPumpThread->shutdown();
+		delete sHTTPPumpThread;
+		sHTTPPumpThread = NULL;
+	}
+	delete gHTTPPump;
+	gHTTPPump = NULL;
 	delete gServicePump;
 
 	destroyMainloopTimeout();
@@ -1483,7 +1514,10 @@ bool LLAppViewer::cleanup()
 	// shutdown all worker threads before deleting them in case of co-dependencies
 	sTextureCache->shutdown();
 	sTextureFetch->shutdown();
+	sImageDecodeThread->printWorkerStats();
 	sImageDecodeThread->shutdown();
+	gVLManager.shutdownThread();
+	LLVLComposition::cleanupClass();
 	delete sTextureCache;
     sTextureCache = NULL;
 	delete sTextureFetch;
@@ -1619,15 +1653,32 @@ bool LLAppViewer::initThreads()
 		LLWatchdog::getInstance()->init(watchdog_killer_callback);
 	}
 
-	LLVFSThread::initClass(enable_threads && false);
+	// LLVFS reads only take a shared lock, so asynchronous VFS requests can run threaded.
+	LLVFSThread::initClass(enable_threads && gSavedSettings.getBOOL("VFSThreaded"));
 	LLLFSThread::initClass(enable_threads && false);
 
 	// Image decoding
-	LLAppViewer::sImageDecodeThread = new LLImageDecodeThread(enable_threads && true);
+	U32 decode_threads = gSavedSettings.getU32("ImageDecodeThreads");
+	if (decode_threads == 0)
+	{
+		// Leave a core for the main thread
+		decode_threads = llmax(LLCPUInfo::getNumCores(), (U32)2) - 1;
+	}
+	LLAppViewer::sImageDecodeThread = new LLImageDecodeThread(enable_threads && true, decode_threads);
 	LLAppViewer::sTextureCache = new LLTextureCache(enable_threads && true);
 	LLAppViewer::sTextureFetch = new LLTextureFetch(LLAppViewer::getTextureCache(), sImageDecodeThread, enable_threads && true);
 	LLImage::initClass(gSavedSettings.getBOOL("UseKDUIfAvailable"));
 
+	// Terrain patch decoding
+	gVLManager.initThread(enable_threads && gSavedSettings.getBOOL("TerrainDecodeThreaded"));
+	LLVLComposition::initClass(enable_threads && gSavedSettings.getBOOL("TerrainCompositeThreaded"));
+
+	// Volume LOD and sculpt builds
+	if (gSavedSettings.getBOOL("VolumeBuildThreaded"))
+	{
+		LLPrimitive::getVolumeManager()->useBuildQueue(enable_threads);
+	}
+
 	// *FIX: no error handling here!
 	return true;
 }
@@ -3157,6 +3208,8 @@ bool LLAppViewer::initCache()
 	// Startup the VFS...
 	gSavedSettings.setU32("VFSSalt", new_salt);
 
+	LLVFS::setUseMappedReads(gSavedSettings.getBOOL("VFSMappedReads"));
+
 	// Don't remove VFS after viewer crashes.  If user has corrupt data, they can reinstall. JC
 	gVFS = new LLVFS(new_vfs_index_file, new_vfs_data_file, false, vfs_size_u32, false);
 	if( VFSVALID_BAD_CORRUPT == gVFS->getValidState() )
@@ -3201,6 +3254,7 @@ void LLAppViewer::purgeCache()
 		if (gSavedSettings.getBOOL("ClearObjectCache"))
 		{
 			removeCacheFiles("*.slc");
+			removeCacheFiles("objects_*.cache");
 			gSavedSettings.setBOOL("ClearObjectCache", FALSE);
 		}
 
@@ -3670,6 +3724,8 @@ void LLAppViewer::idle()
 		{
 			gObjectList.update(gAgent, *LLWorld::getInstance());
 		}
+
+		LLVOVolume::updateVolumeBuilds();
 	}
 	
 	//////////////////////////////////////
@@ -4263,6 +4319,8 @@ void LLAppViewer::disconnectViewer()
 	// This is where we used to call gObjectList.destroy() and then delete gWorldp.
 	// Now we just ask the LLWorld singleton to cleanly shut down.
 	LLWorld::getInstance()->destroyClass();
+	// After the regions have queued their objects
+	LLVOCache::cleanupClass();
 
 	// call all self-registered classes
 	LLDestroyClassList::instance().fireCallbacks();
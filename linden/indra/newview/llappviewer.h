@@ -286,6 +286,7 @@ extern U32 gFrameCount;
 extern U32 gForegroundFrameCount;
 
 extern LLPumpIO* gServicePump;
+extern LLPumpIO* gHTTPPump;		// NULL unless HTTP requests have their own thread
 
 // Is the Pacific time zone (aka server time zone)
 // currently in daylight savings time?
@@ -43,6 +43,8 @@
 #include "llfontgl.h"
 
 #include "llappviewer.h"
+#include "lldir.h"
+#include "llfile.h"
 #include "llviewerimagelist.h"
 #include "llui.h"
 #include "llviewercontrol.h"
@@ -99,6 +101,7 @@ static struct ft_display_info ft_display_table[] =
 	{ LLFastTimer::FTM_OBJECTLIST_UPDATE,	"  Object Update",	&LLColor4::purple1, 1 },
 	{ LLFastTimer::FTM_AVATAR_UPDATE,		"   Avatars",		&LLColor4::purple2, 0 },
 	{ LLFastTimer::FTM_JOINT_UPDATE,		"    Joints",		&LLColor4::purple3, 0 },
+	{ LLFastTimer::FTM_AVATAR_MORPHS,		"    Morphs",		&LLColor4::purple3, 0 },
 	{ LLFastTimer::FTM_ATTACHMENT_UPDATE,	"    Attachments",	&LLColor4::purple4, 0 },
 	{ LLFastTimer::FTM_UPDATE_ANIMATION,	"     Animation",	&LLColor4::purple5, 0 },
 	{ LLFastTimer::FTM_FLEXIBLE_UPDATE,		"   Flex Update",	&LLColor4::pink2, 0 },
@@ -171,6 +174,7 @@ static struct ft_display_info ft_display_table[] =
 	{ LLFastTimer::FTM_SHADOW_AVATAR,		"   Avatar",		&LLColor4::yellow1, 1 },
 	{ LLFastTimer::FTM_SHADOW_TREE,			"   Tree",			&LLColor4::yellow8, 1 },
 	{ LLFastTimer::FTM_RENDER_GEOMETRY,		"  Geometry",		&LLColor4::green2, 1 },
+	{ LLFastTimer::FTM_AVATAR_SKINNING,		"   Skinning",		&LLColor4::yellow1, 0 },
 	{ LLFastTimer::FTM_POOLS,				"   Pools",			&LLColor4::green3, 1 },
 	{ LLFastTimer::FTM_POOLRENDER,			"    RenderPool",	&LLColor4::green4, 1 },
 	{ LLFastTimer::FTM_RENDER_TERRAIN,		"     Terrain",		&LLColor4::green6, 0 },
@@ -252,6 +256,7 @@ LLFastTimerView::LLFastTimerView(const std::string& name, const LLRect& rect)
 			}
 			llassert(level < FTV_DISPLAY_NUM);
 			ft_display_table[i].desc = text;
+			LLFastTimer::setTimerName(ft_display_table[i].timer, text);
 			ft_display_table[i].level = level;
 			if (level > 0)
 			{
@@ -281,6 +286,11 @@ LLFastTimerView::~LLFastTimerView()
 
 BOOL LLFastTimerView::handleRightMouseDown(S32 x, S32 y, MASK mask)
 {
+	if (mask & MASK_CONTROL)
+	{
+		saveTrace();
+		return TRUE;
+	}
 	if (mBarRect.pointInRect(x, y))
 	{
 		S32 bar_idx = MAX_VISIBLE_HISTORY - ((y - mBarRect.mBottom) * (MAX_VISIBLE_HISTORY + 2) / mBarRect.getHeight());
@@ -291,6 +301,27 @@ BOOL LLFastTimerView::handleRightMouseDown(S32 x, S32 y, MASK mask)
 	return FALSE;
 }
 
+void LLFastTimerView::setVisible(BOOL visible)
+{
+	LLFloater::setVisible(visible);
+	// Record every thread's timers while the view is up
+	LLFastTimer::setCapture(visible);
+}
+
+void LLFastTimerView::saveTrace()
+{
+	std::string filename = gDirUtilp->getExpandedFilename(LL_PATH_LOGS, "fast_timers_trace.json");
+	llofstream out(filename);
+	if (!out.is_open())
+	{
+		llwarns << "Unable to open " << filename << " for writing" << llendl;
+		return;
+	}
+	LLFastTimer::exportChromeTrace(out);
+	out.close();
+	llinfos << "Saved fast timer trace to " << filename << llendl;
+}
+
 S32 LLFastTimerView::getLegendIndex(S32 y)
 {
 	S32 idx = (getRect().getHeight() - y) / ((S32) LLFontGL::getFontMonospace()->getLineHeight()+2) - 5;
@@ -508,7 +539,7 @@ void LLFastTimerView::draw()
 		LLFontGL::getFontMonospace()->renderUTF8(tdesc, 0, x, y, LLColor4::white, LLFontGL::LEFT, LLFontGL::TOP);
 		y -= (texth + 2);
 
-		LLFontGL::getFontMonospace()->renderUTF8(std::string("[Right-Click log selected] [ALT-Click toggle counts] [ALT-SHIFT-Click sub hidden]"),
+		LLFontGL::getFontMonospace()->renderUTF8(std::string("[Right-Click log selected] [CTRL-Right-Click save trace] [ALT-Click toggle counts] [ALT-SHIFT-Click sub hidden]"),
 										 0, x, y, LLColor4::white, LLFontGL::LEFT, LLFontGL::TOP);
 		y -= (texth + 2);
 	}
@@ -48,9 +48,12 @@ public:
 	virtual BOOL handleHover(S32 x, S32 y, MASK mask);
 	virtual BOOL handleScrollWheel(S32 x, S32 y, S32 clicks);
 	virtual void draw();
+	virtual void setVisible(BOOL visible);
 
 	S32 getLegendIndex(S32 y);
 	F64 getTime(LLFastTimer::EFastTimerType tidx);
+	// Writes the captured frames to the log directory as a Chrome trace
+	void saveTrace();
 	
 private:	
 	S32* mBarStart;
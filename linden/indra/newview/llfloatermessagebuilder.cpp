@@ -71,6 +71,7 @@ LLNetListItem* LLFloaterMessageBuilder::findNetListItem(LLUUID id)
 void LLFloaterMessageBuilder::refreshNetList()
 {
 	LLScrollListCtrl* scrollp = getChild<LLScrollListCtrl>("net_list");
+	LLMessageSystem::LLCircuitLock lock(gMessageSystem);
 	// Update circuit data of net list items
 	std::vector<LLCircuitData*> circuits = gMessageSystem->getCircuit()->getCircuitDataList();
 	std::vector<LLCircuitData*>::iterator circuits_end = circuits.end();
@@ -537,6 +537,7 @@ LLNetListItem* LLFloaterMessageLog::findNetListItem(LLUUID id)
 void LLFloaterMessageLog::refreshNetList()
 {
 	LLScrollListCtrl* scrollp = getChild<LLScrollListCtrl>("net_list");
+	LLMessageSystem::LLCircuitLock lock(gMessageSystem);
 	// Update circuit data of net list items
 	std::vector<LLCircuitData*> circuits = gMessageSystem->getCircuit()->getCircuitDataList();
 	std::vector<LLCircuitData*>::iterator circuits_end = circuits.end();
@@ -813,6 +814,7 @@ BOOL LLFloaterMessageLog::onClickCloseCircuit(void* user_data)
 bool LLFloaterMessageLog::onConfirmCloseCircuit(const LLSD& notification, const LLSD& response )
 {
 	S32 option = LLNotification::getSelectedOption(notification, response);
+	LLMessageSystem::LLCircuitLock lock(gMessageSystem);
 	LLCircuitData* cdp = gMessageSystem->mCircuitInfo.findCircuit(LLHost(notification["payload"]["circuittoclose"].asString()));
 	if(!cdp) return false;
 	LLViewerRegion* regionp = LLWorld::getInstance()->getRegion(cdp->getHost());
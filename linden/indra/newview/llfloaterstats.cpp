@@ -37,7 +37,10 @@
 #include "llfloaterstats.h"
 #include "llcontainerview.h"
 #include "llfloater.h"
+#include "llhttpclient.h"
+#include "llpumpio.h"
 #include "llstatview.h"
+#include "llsurface.h"
 #include "llscrollcontainer.h"
 #include "lluictrlfactory.h"
 #include "llviewercontrol.h"
@@ -140,6 +143,31 @@ void LLFloaterStats::buildStats()
 	stat_barp->mLabelSpacing = 500.f;
 	stat_barp->mPerSec = TRUE;
 
+	stat_barp = render_statviewp->addStat("Volume Builds", &(LLViewerStats::getInstance()->mVolumeBuildQueueStat), "DebugStatModeVolumeBuildQueue");
+	stat_barp->setUnitLabel(" queued");
+	stat_barp->mMinBar = 0.f;
+	stat_barp->mMaxBar = 200.f;
+	stat_barp->mTickSpacing = 50.f;
+	stat_barp->mLabelSpacing = 100.f;
+	stat_barp->mPerSec = FALSE;
+
+	stat_barp = render_statviewp->addStat("Volume Build Time", &(LLViewerStats::getInstance()->mVolumeBuildMsecStat), "DebugStatModeVolumeBuildTime");
+	stat_barp->setUnitLabel(" ms/fr");
+	stat_barp->mMinBar = 0.f;
+	stat_barp->mMaxBar = 100.f;
+	stat_barp->mTickSpacing = 25.f;
+	stat_barp->mLabelSpacing = 50.f;
+	stat_barp->mPrecision = 1;
+	stat_barp->mPerSec = FALSE;
+
+	stat_barp = render_statviewp->addStat("Terrain Texels", &(LLSurface::sTexelsUpdatedPerSecStat), "DebugStatModeTerrainTexels");
+	stat_barp->setUnitLabel(" K/sec");
+	stat_barp->mMinBar = 0.f;
+	stat_barp->mMaxBar = 100000.f;
+	stat_barp->mTickSpacing = 25000.f;
+	stat_barp->mLabelSpacing = 50000.f;
+	stat_barp->mPerSec = FALSE;
+
 
 	// Texture statistics
 	LLStatView *texture_statviewp = render_statviewp->addStatView("texture stat view", "Texture", "OpenDebugStatTexture", rect);
@@ -239,6 +267,29 @@ void LLFloaterStats::buildStats()
 	stat_barp->setUnitLabel(" ");
 	stat_barp->mPerSec = FALSE;
 
+	if (LLHTTPClient::hasPump())
+	{
+		LLPumpIO& http_pump = LLHTTPClient::getPump();
+
+		stat_barp = net_statviewp->addStat("HTTP Latency", http_pump.getChainLatencyStat(),
+										   "DebugStatModeHTTPLatency");
+		stat_barp->setUnitLabel(" msec");
+		stat_barp->mMinBar = 0.f;
+		stat_barp->mMaxBar = 2000.f;
+		stat_barp->mTickSpacing = 250.f;
+		stat_barp->mLabelSpacing = 500.f;
+		stat_barp->mPerSec = FALSE;
+
+		stat_barp = net_statviewp->addStat("HTTP Callback Delay", http_pump.getCallbackDelayStat(),
+										   "DebugStatModeHTTPCallbackDelay");
+		stat_barp->setUnitLabel(" msec");
+		stat_barp->mMinBar = 0.f;
+		stat_barp->mMaxBar = 200.f;
+		stat_barp->mTickSpacing = 25.f;
+		stat_barp->mLabelSpacing = 50.f;
+		stat_barp->mPerSec = FALSE;
+	}
+
 
 	// Simulator stats
 	LLStatView *sim_statviewp = new LLStatView("sim stat view", "Simulator", "OpenDebugStatSim", rect);
@@ -357,6 +357,11 @@ void LLFolderViewItem::refresh()
 		mSearchableLabelDesc.assign(searchable_label_desc);
 		mSearchableLabelAll.assign(searchable_label_all);
 
+		// not registered with the root until added to a folder
+		if (mParentFolder)
+		{
+			mRoot->updateLabelIndex(this);
+		}
 		dirtyFilter();
 		// some part of label has changed, so overall width has potentially changed
 		if (mParentFolder)
@@ -1322,6 +1327,14 @@ void LLFolderViewFolder::filter( LLInventoryFilter& filter)
 		gInventory.startBackgroundFetch(mListener->getUUID());
 	}
 
+	// none of our descendants contain the filter substring, so none
+	// of them can pass
+	if (!getRoot()->hasIndexedMatchesBelow(this))
+	{
+		setCompletedFilterGeneration(filter_generation, FALSE);
+		return;
+	}
+
 	// now query children
 	for (folders_t::iterator iter = mFolders.begin();
 		 iter != mFolders.end();)
@@ -2628,7 +2641,11 @@ LLFolderView::LLFolderView( const std::string& name, LLUIImagePtr root_folder_ic
 	mSelectCallback(NULL),
 	mSignalSelectCallback(0),
 	mMinWidth(0),
-	mDragAndDropThisFrame(FALSE)
+	mDragAndDropThisFrame(FALSE),
+	mLabelIndexBuilt(FALSE),
+	mFoldersWithMatchesValid(FALSE),
+	mFoldersWithMatchesGeneration(0),
+	mFoldersWithMatchesRevision(0)
 {
 	LLRect new_rect(rect.mLeft, rect.mBottom + getRect().getHeight(), rect.mLeft + getRect().getWidth(), rect.mBottom);
 	setRect( rect );
@@ -2706,6 +2723,8 @@ LLFolderView::~LLFolderView( void )
 	mFolders.clear();
 
 	mItemMap.clear();
+	mLabelIndex.clear();
+	mFoldersWithMatches.clear();
 }
 
 BOOL LLFolderView::canFocusChildren() const
@@ -2901,10 +2920,66 @@ void LLFolderView::filter( LLInventoryFilter& filter )
 	{
 		mFiltered = FALSE;
 		mMinWidth = 0;
+		updateFoldersWithMatches(filter);
 		LLFolderViewFolder::filter(filter);
 	}
 }
 
+void LLFolderView::updateFoldersWithMatches(LLInventoryFilter& filter)
+{
+	// only name searches look at the labels the index holds
+	std::string substring = filter.getFilterSubString();
+	if (filter.getSearchType() != 0 || substring.size() < LLInventorySearchIndex::MIN_SUBSTRING_LENGTH)
+	{
+		mFoldersWithMatchesValid = FALSE;
+		return;
+	}
+
+	if (!mLabelIndexBuilt)
+	{
+		for (std::map<LLUUID, LLFolderViewItem*>::iterator iter = mItemMap.begin();
+			 iter != mItemMap.end(); ++iter)
+		{
+			mLabelIndex.update(iter->first, iter->second->getSearchableNameLabel());
+		}
+		mLabelIndexBuilt = TRUE;
+	}
+
+	if (mFoldersWithMatchesValid
+		&& mFoldersWithMatchesGeneration == filter.getCurrentGeneration()
+		&& mFoldersWithMatchesRevision == mLabelIndex.getRevision())
+	{
+		return;
+	}
+
+	LLInventorySearchIndex::uuid_vec_t matches;
+	mLabelIndex.find(substring, matches);
+	mFoldersWithMatches.clear();
+	for (LLInventorySearchIndex::uuid_vec_t::iterator iter = matches.begin();
+		 iter != matches.end(); ++iter)
+	{
+		LLFolderViewItem* itemp = getItemByID(*iter);
+		if (!itemp)
+		{
+			continue;
+		}
+		// stop at the first folder already marked by an earlier match
+		for (LLFolderViewFolder* folderp = itemp->getParentFolder();
+			 folderp && mFoldersWithMatches.insert(folderp).second;
+			 folderp = folderp->getParentFolder())
+		{
+		}
+	}
+	mFoldersWithMatchesValid = TRUE;
+	mFoldersWithMatchesGeneration = filter.getCurrentGeneration();
+	mFoldersWithMatchesRevision = mLabelIndex.getRevision();
+}
+
+BOOL LLFolderView::hasIndexedMatchesBelow(LLFolderViewFolder* folder) const
+{
+	return !mFoldersWithMatchesValid || mFoldersWithMatches.find(folder) != mFoldersWithMatches.end();
+}
+
 void LLFolderView::reshape(S32 width, S32 height, BOOL called_from_parent)
 {
 	S32 min_width = 0;
@@ -4311,11 +4386,27 @@ void LLFolderView::setShowSingleSelection(BOOL show)
 void LLFolderView::addItemID(const LLUUID& id, LLFolderViewItem* itemp)
 {
 	mItemMap[id] = itemp;
+	if (mLabelIndexBuilt)
+	{
+		mLabelIndex.update(id, itemp->getSearchableNameLabel());
+	}
 }
 
 void LLFolderView::removeItemID(const LLUUID& id)
 {
 	mItemMap.erase(id);
+	if (mLabelIndexBuilt)
+	{
+		mLabelIndex.remove(id);
+	}
+}
+
+void LLFolderView::updateLabelIndex(LLFolderViewItem* itemp)
+{
+	if (mLabelIndexBuilt && itemp->getListener())
+	{
+		mLabelIndex.update(itemp->getListener()->getUUID(), itemp->getSearchableNameLabel());
+	}
 }
 
 LLFolderViewItem* LLFolderView::getItemByID(const LLUUID& id)
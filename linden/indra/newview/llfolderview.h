@@ -43,6 +43,7 @@
 
 #include <vector>
 #include <map>
+#include <set>
 #include <deque>
 
 #include "lluictrl.h"
@@ -54,6 +55,7 @@
 #include "lleditmenuhandler.h"
 #include "llviewerimage.h"
 #include "lldepthstack.h"
+#include "llinventorysearchindex.h"
 #include "lltooldraganddrop.h"
 
 class LLMenuGL;
@@ -483,6 +485,8 @@ public:
 	const std::string& getName( void ) const;
 
 	const std::string& getSearchableLabel() const;
+	// The label name searches look at, whatever the search type.
+	const std::string& getSearchableNameLabel() const { return mSearchableLabel; }
 
 	// This method returns the label displayed on the view. This
 	// method was primarily added to allow sorting on the folder
@@ -900,6 +904,12 @@ public:
 	void removeItemID(const LLUUID& id);
 	LLFolderViewItem* getItemByID(const LLUUID& id);
 
+	// Keeps the label index in step with an item's searchable label.
+	void updateLabelIndex(LLFolderViewItem* itemp);
+	// FALSE when the label index shows that nothing below folder
+	// contains the filter substring, so its contents need not be filtered.
+	BOOL hasIndexedMatchesBelow(LLFolderViewFolder* folder) const;
+
 	void	doIdle();						// Real idle routine
 	static void idle(void* user_data);		// static glue to doIdle()
 
@@ -921,6 +931,8 @@ protected:
 	void finishRenamingItem( void );
 	void closeRenamer( void );
 
+	void updateFoldersWithMatches(LLInventoryFilter& filter);
+
 protected:
 	LLHandle<LLView>					mPopupMenuHandle;
 	
@@ -962,6 +974,17 @@ protected:
 	std::map<LLUUID, LLFolderViewItem*> mItemMap;
 	BOOL							mDragAndDropThisFrame;
 
+	// Trigram index over the searchable name labels of mItemMap, built
+	// on the first name search and kept up to date from then on.
+	LLInventorySearchIndex			mLabelIndex;
+	BOOL							mLabelIndexBuilt;
+	// Folders with an indexed match somewhere below them, as of the
+	// filter generation and index revision they were found at.
+	std::set<LLFolderViewFolder*>	mFoldersWithMatches;
+	BOOL							mFoldersWithMatchesValid;
+	S32								mFoldersWithMatchesGeneration;
+	U32								mFoldersWithMatchesRevision;
+
 };
 
 bool sort_item_name(LLFolderViewItem* a, LLFolderViewItem* b);
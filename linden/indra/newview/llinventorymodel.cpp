@@ -37,6 +37,7 @@
 #include "llassetstorage.h"
 #include "llcrc.h"
 #include "lldir.h"
+#include "llinventorycache.h"
 #include "llsys.h"
 #include "llxfermanager.h"
 #include "message.h"
@@ -92,6 +93,7 @@ static std::deque<LLUUID> sFetchQueue;
 const F32 MAX_TIME_FOR_SINGLE_FETCH = 10.f;
 const S32 MAX_FETCH_RETRIES = 10;
 const char CACHE_FORMAT_STRING[] = "%s.inv"; 
+const char BINARY_CACHE_FORMAT_STRING[] = "%s.inv.bin";
 const char* NEW_CATEGORY_NAME = "New Folder";
 const char* NEW_CATEGORY_NAMES[LLAssetType::AT_COUNT] =
 {
@@ -1806,6 +1808,17 @@ void LLInventoryModel::cache(
 	agent_id.toString(agent_id_str);
 	std::string path(gDirUtilp->getExpandedFilename(LL_PATH_CACHE, agent_id_str));
 	inventory_filename = llformat(CACHE_FORMAT_STRING, path.c_str());
+	std::string binary_filename = llformat(BINARY_CACHE_FORMAT_STRING, path.c_str());
+	if (saveToBinaryFile(binary_filename, categories, items,
+						 gSavedSettings.getBOOL("InventoryCacheCompress")))
+	{
+		// The text cache is only read when there is no binary one, so
+		// don't leave a stale one around.
+		LLFile::remove(inventory_filename + ".gz");
+		return;
+	}
+	LLFile::remove(binary_filename);
+
 	saveToFile(inventory_filename, categories, items);
 	std::string gzip_filename(inventory_filename);
 	gzip_filename.append(".gz");
@@ -2152,41 +2165,62 @@ bool LLInventoryModel::loadSkeleton(const LLInventoryModel::options_t& options,
 
 		const S32 NO_VERSION = LLViewerInventoryCategory::VERSION_UNKNOWN;
 
-		std::string gzip_filename(inventory_filename);
-		gzip_filename.append(".gz");
-		LLFILE* fp = LLFile::fopen(gzip_filename, "rb");
-
+		// The skeleton categories that we have cached contents for
+		std::set<LLUUID> cached_ids;
+		bool cache_loaded = false;
 		bool remove_inventory_file = false;
 
-		// try to ungzip the inventory -- MC
-		if (fp)
+		LLInventoryCacheReader reader;
+		std::string binary_filename = llformat(BINARY_CACHE_FORMAT_STRING, path.c_str());
+		if (reader.open(binary_filename))
 		{
-			fclose(fp);
-			fp = NULL;
-			if (gunzip_file(gzip_filename, inventory_filename))
+			LL_DEBUGS("Inventory") << "Loading binary inventory cache " << binary_filename
+								   << (reader.isMapped() ? " (mapped)" : "") << LL_ENDL;
+			std::set<LLUUID> skeleton_ids;
+			for (cat_set_t::iterator it = temp_cats.begin(); it != temp_cats.end(); ++it)
 			{
-				// we only want to remove the inventory file if it was
-				// gzipped before we loaded, and we successfully
-				// gunziped it.
-				remove_inventory_file = true;
+				skeleton_ids.insert((*it)->getUUID());
 			}
-			else
+			S32 count = reader.getNumCategories();
+			for (S32 i = 0; i < count; ++i)
 			{
-				llinfos << "Unable to gunzip " << gzip_filename << llendl;
+				LLUUID cat_id = reader.getCategoryID(i);
+				if (skeleton_ids.find(cat_id) != skeleton_ids.end())
+				{
+					cached_ids.insert(cat_id);
+				}
 			}
+			cache_loaded = true;
 		}
-
-		// begin cache loading -- MC
-		if (loadFromFile(inventory_filename, categories, items))
+		else
 		{
-			// We were able to find a cache of files. So, use what we
-			// found to generate a set of categories we should add. We
-			// will go through each category loaded and if the version
-			// does not match, invalidate the version.
+			std::string gzip_filename(inventory_filename);
+			gzip_filename.append(".gz");
+			LLFILE* fp = LLFile::fopen(gzip_filename, "rb");
+
+			// try to ungzip the inventory -- MC
+			if (fp)
+			{
+				fclose(fp);
+				fp = NULL;
+				if (gunzip_file(gzip_filename, inventory_filename))
+				{
+					// we only want to remove the inventory file if it was
+					// gzipped before we loaded, and we successfully
+					// gunziped it.
+					remove_inventory_file = true;
+				}
+				else
+				{
+					llinfos << "Unable to gunzip " << gzip_filename << llendl;
+				}
+			}
+
+			// begin cache loading -- MC
+			cache_loaded = loadFromFile(inventory_filename, categories, items);
 			S32 count = categories.count();
 			cat_set_t::iterator not_cached = temp_cats.end();
-			std::set<LLUUID> cached_ids;
-			for (S32 i = 0; i < count; ++i)
+			for (S32 i = 0; cache_loaded && i < count; ++i)
 			{
 				LLViewerInventoryCategory* cat = categories[i];
 				cat_set_t::iterator cit = temp_cats.find(cat);
@@ -2226,6 +2260,12 @@ bool LLInventoryModel::loadSkeleton(const LLInventoryModel::options_t& options,
 					cached_ids.insert(tcat->getUUID());
 				}
 			}
+		}
+
+		if (cache_loaded)
+		{
+			// We were able to find a cache of files. So, use what we
+			// found to generate a set of categories we should add.
 
 			// go ahead and add the cats returned during the download
 			std::set<LLUUID>::iterator not_cached_id = cached_ids.end();
@@ -2244,21 +2284,49 @@ bool LLInventoryModel::loadSkeleton(const LLInventoryModel::options_t& options,
 				++child_counts[(*it)->getParentUUID()];
 			}
 
-			// Add all the items loaded which are parented to a
-			// category with a correctly cached parent
-			count = items.count();
-			for (int i = 0; i < count; ++i)
+			if (reader.isOpen())
 			{
-				cat_map_t::iterator cit = mCategoryMap.find(items[i]->getParentUUID());
-				
-				if (cit != mCategoryMap.end())
+				// Only build the items of categories with a correctly
+				// cached version.  The items after the indexed ones have
+				// no cached category, so they would be skipped anyway.
+				S32 count = reader.getNumCategories();
+				for (S32 i = 0; i < count; ++i)
 				{
-					LLViewerInventoryCategory* cat = cit->second;
-					if (cat->getVersion() != NO_VERSION)
+					cat_map_t::iterator cit = mCategoryMap.find(reader.getCategoryID(i));
+					if (cit == mCategoryMap.end() || cit->second->getVersion() == NO_VERSION)
 					{
-						addItem(items[i]);
+						continue;
+					}
+					S32 first = reader.getFirstItem(i);
+					S32 end = first + reader.getCategoryItemCount(i);
+					for (S32 j = first; j < end; ++j)
+					{
+						LLPointer<LLViewerInventoryItem> item = new LLViewerInventoryItem;
+						reader.getItem(j, *item);
+						addItem(item);
 						cached_item_count += 1;
-						++child_counts[cat->getUUID()];
+						++child_counts[cit->first];
+					}
+				}
+			}
+			else
+			{
+				// Add all the items loaded which are parented to a
+				// category with a correctly cached parent
+				S32 count = items.count();
+				for (int i = 0; i < count; ++i)
+				{
+					cat_map_t::iterator cit = mCategoryMap.find(items[i]->getParentUUID());
+					
+					if (cit != mCategoryMap.end())
+					{
+						LLViewerInventoryCategory* cat = cit->second;
+						if (cat->getVersion() != NO_VERSION)
+						{
+							addItem(items[i]);
+							cached_item_count += 1;
+							++child_counts[cat->getUUID()];
+						}
 					}
 				}
 			}
@@ -2873,6 +2941,31 @@ bool LLInventoryModel::saveToFile(const std::string& filename,
 	return true;
 }
 
+// static
+bool LLInventoryModel::saveToBinaryFile(const std::string& filename,
+										const cat_array_t& categories,
+										const item_array_t& items,
+										bool compress)
+{
+	llinfos << "LLInventoryModel::saveToBinaryFile(" << filename << ")" << llendl;
+	LLInventoryCacheWriter writer;
+	S32 count = categories.count();
+	for (S32 i = 0; i < count; ++i)
+	{
+		LLViewerInventoryCategory* cat = categories[i];
+		if (cat->getVersion() != LLViewerInventoryCategory::VERSION_UNKNOWN)
+		{
+			writer.addCategory(*cat, cat->getOwnerID(), cat->getVersion());
+		}
+	}
+	count = items.count();
+	for (S32 i = 0; i < count; ++i)
+	{
+		writer.addItem(*items[i]);
+	}
+	return writer.save(filename, compress);
+}
+
 // message handling functionality
 // static
 void LLInventoryModel::registerCallbacks(LLMessageSystem* msg)
@@ -409,6 +409,11 @@ protected:
 	static bool saveToFile(const std::string& filename,
 						   const cat_array_t& categories,
 						   const item_array_t& items); 
+	// binary cache, see LLInventoryCache; read in loadSkeleton().
+	static bool saveToBinaryFile(const std::string& filename,
+								 const cat_array_t& categories,
+								 const item_array_t& items,
+								 bool compress);
 
 	// message handling functionality
 	//static void processUseCachedInventory(LLMessageSystem* msg, void**);
@@ -55,6 +55,8 @@ extern LLControlGroup gSavedSettings;				// read only
 // Global table of loaded LLPolyMeshes
 //-----------------------------------------------------------------------------
 LLPolyMesh::LLPolyMeshSharedDataTable LLPolyMesh::sGlobalSharedMeshList;
+S32 LLPolyMesh::sMorphBatchDepth = 0;
+std::vector<LLPolyMesh*> LLPolyMesh::sMorphBatchMeshes;
 
 //-----------------------------------------------------------------------------
 // LLPolyMeshSharedData()
@@ -758,6 +760,11 @@ LLPolyMesh::~LLPolyMesh()
 #else
 	delete [] mVertexData;
 #endif
+
+	if (!mMorphBatch.empty())
+	{
+		vector_replace_with_last(sMorphBatchMeshes, this);
+	}
 }
 
 
@@ -812,6 +819,71 @@ void LLPolyMesh::freeAllMeshes()
 	sGlobalSharedMeshList.clear();
 }
 
+//-----------------------------------------------------------------------------
+// LLPolyMesh::beginMorphBatch()
+//-----------------------------------------------------------------------------
+void LLPolyMesh::beginMorphBatch()
+{
+	sMorphBatchDepth++;
+}
+
+//-----------------------------------------------------------------------------
+// LLPolyMesh::endMorphBatch()
+//-----------------------------------------------------------------------------
+void LLPolyMesh::endMorphBatch()
+{
+	llassert(sMorphBatchDepth > 0);
+	if (--sMorphBatchDepth > 0)
+	{
+		return;
+	}
+
+	LLFastTimer t(LLFastTimer::FTM_AVATAR_MORPHS);
+	for (std::vector<LLPolyMesh*>::iterator iter = sMorphBatchMeshes.begin(); iter != sMorphBatchMeshes.end(); ++iter)
+	{
+		(*iter)->applyMorphs();
+	}
+	sMorphBatchMeshes.clear();
+}
+
+//-----------------------------------------------------------------------------
+// LLPolyMesh::addMorph()
+//-----------------------------------------------------------------------------
+void LLPolyMesh::addMorph(const LLMorphDeltas* deltas, F32 delta_weight, const F32* mask_weights, BOOL clothing)
+{
+	if (sMorphBatchDepth > 0 && mMorphBatch.empty())
+	{
+		sMorphBatchMeshes.push_back(this);
+	}
+	mMorphBatch.add(deltas, delta_weight, mask_weights, clothing);
+	if (sMorphBatchDepth == 0)
+	{
+		applyMorphs();
+	}
+}
+
+//-----------------------------------------------------------------------------
+// LLPolyMesh::applyMorphs()
+//-----------------------------------------------------------------------------
+void LLPolyMesh::applyMorphs()
+{
+	if (mMorphBatch.empty())
+	{
+		return;
+	}
+
+	LLMorphBatch::Mesh mesh;
+	mesh.mNumVertices = getNumVertices();
+	mesh.mCoords = getWritableCoords();
+	mesh.mScaledNormals = getScaledNormals();
+	mesh.mNormals = getWritableNormals();
+	mesh.mScaledBinormals = getScaledBinormals();
+	mesh.mBinormals = getWritableBinormals();
+	mesh.mTexCoords = getWritableTexCoords();
+	mesh.mClothingWeights = getWritableClothingWeights();
+	mMorphBatch.apply(mesh, NORMAL_SOFTEN_FACTOR);
+}
+
 LLPolyMeshSharedData *LLPolyMesh::getSharedData() const
 {
 	return mSharedData;
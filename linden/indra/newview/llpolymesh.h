@@ -179,6 +179,16 @@ public:
 	// references to these objects.  Generally, upon exit of the application.
 	static void freeAllMeshes();
 
+	// Morphs added between beginMorphBatch() and the matching
+	// endMorphBatch() are collected per mesh and applied in one pass over
+	// each mesh when the outermost batch ends.  Outside a batch, addMorph()
+	// applies the morph at once.
+	static void beginMorphBatch();
+	static void endMorphBatch();
+	void addMorph(const LLMorphDeltas* deltas, F32 delta_weight, const F32* mask_weights, BOOL clothing);
+	// Applies this mesh's pending morphs now.
+	void applyMorphs();
+
 	//--------------------------------------------------------------------
 	// Transform Data Access
 	//--------------------------------------------------------------------
@@ -362,6 +372,10 @@ protected:
 	
 	LLPolyMesh				*mReferenceMesh;
 
+	LLMorphBatch			mMorphBatch;
+	static S32				sMorphBatchDepth;
+	static std::vector<LLPolyMesh*> sMorphBatchMeshes;
+
 	// global mesh list
 	typedef std::map<std::string, LLPolyMeshSharedData*> LLPolyMeshSharedDataTable; 
 	static LLPolyMeshSharedDataTable sGlobalSharedMeshList;
@@ -36,6 +36,7 @@
 #include <string>
 #include <vector>
 
+#include "llmorphbatch.h"
 #include "llviewervisualparam.h"
 
 class LLPolyMeshSharedData;
@@ -43,6 +44,9 @@ class LLVOAvatar;
 class LLVector2;
 class LLViewerJointCollisionVolume;
 
+// Scales morph normal and binormal deltas
+const F32 NORMAL_SOFTEN_FACTOR = 0.65f;
+
 //-----------------------------------------------------------------------------
 // LLPolyMorphData()
 //-----------------------------------------------------------------------------
@@ -66,6 +70,7 @@ public:
 	LLVector3*			mNormals;
 	LLVector3*			mBinormals;
 	LLVector2*			mTexCoords;
+	LLMorphDeltas		mDeltas;			// the deltas above, one array per component
 
 	F32					mTotalDistortion;	// vertex distortion summed over entire morph
 	F32					mMaxDistortion;		// maximum single vertex distortion in a given morph
@@ -171,6 +171,7 @@
 #include "llviewerthrottle.h"
 #include "llviewerwindow.h"
 #include "llvoavatar.h"
+#include "llvocache.h"
 #include "llvoclouds.h"
 #include "llweb.h"
 #include "llworld.h"
@@ -616,6 +617,12 @@ bool idle_startup()
 			F32 dropPercent = gSavedSettings.getF32("PacketDropPercentage");
 			msg->mPacketRing.setDropPercentage(dropPercent);
 
+			if (gSavedSettings.getBOOL("UDPBatchIO") && net_batch_supported())
+			{
+				LL_INFOS("AppInit") << "Using batched UDP I/O" << LL_ENDL;
+				msg->mPacketRing.setUseBatchIO(TRUE);
+			}
+
             F32 inBandwidth = gSavedSettings.getF32("InBandwidth"); 
             F32 outBandwidth = gSavedSettings.getF32("OutBandwidth"); 
 			if (inBandwidth != 0.f)
@@ -630,6 +637,13 @@ bool idle_startup()
 				msg->mPacketRing.setUseOutThrottle(TRUE);
 				msg->mPacketRing.setOutBandwidth(outBandwidth);
 			}
+
+			// after the packet ring settings, which the thread reads
+			if (gSavedSettings.getBOOL("UDPReceiveThread"))
+			{
+				LL_INFOS("AppInit") << "Starting network receive thread" << LL_ENDL;
+				msg->startReceiveThread();
+			}
 		}
 
 		LL_INFOS("AppInit") << "Message System Initialized." << LL_ENDL;
@@ -2006,6 +2020,11 @@ bool idle_startup()
 
 		gAgent.initOriginGlobal(from_region_handle(first_sim_handle));
 
+		// One object cache for all the regions of this grid
+		std::string object_cache = "objects_" + gHippoGridManager->getConnectedGrid()->getGridNick() + ".cache";
+		LLVOCache::initClass(gDirUtilp->getExpandedFilename(LL_PATH_CACHE, object_cache),
+							 gSavedSettings.getU32("ObjectCacheSize") * 1024 * 1024);
+
 		LLWorld::getInstance()->addRegion(first_sim_handle, first_sim, first_sim_size_x, first_sim_size_y);
 
 		LLViewerRegion *regionp = LLWorld::getInstance()->getRegionFromHandle(first_sim_handle);
@@ -41,6 +41,7 @@
 #include "patch_dct.h"
 #include "patch_code.h"
 #include "bitpack.h"
+#include "llpatchdecoder.h"
 #include "llviewerobjectlist.h"
 #include "llregionhandle.h"
 #include "llagent.h"
@@ -695,56 +696,34 @@ BOOL LLSurface::idleUpdate(F32 max_update_time)
 
 void LLSurface::decompressDCTPatch(LLBitPack &bitpack, LLGroupHeader *gopp, BOOL b_large_patch) 
 {
+	static LLPatchDecoder decoder;
 
-	LLPatchHeader  ph;
-	S32 j, i;
-	S32 patch[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
-	LLSurfacePatch *patchp;
-
-	init_patch_decompressor(gopp->patch_size);
-	gopp->stride = mGridsPerEdge;
-	set_group_of_patch_header(gopp);
-
-	while (1)
+	std::vector<LLDecodedPatch> patches;
+	BOOL valid = decoder.decodeGroup(bitpack, *gopp, b_large_patch, mPatchesPerEdge, patches);
+	applyDecodedPatches(patches, gopp->patch_size);
+	if (!valid)
 	{
-		decode_patch_header(bitpack, &ph, b_large_patch);
-		if (ph.quant_wbits == END_OF_PATCHES)
-		{
-			break;
-		}
+		LLAppViewer::instance()->badNetworkHandler();
+	}
+}
 
-		if (b_large_patch)
-		{
-			i = ph.patchids >> 16; //x
-			j = ph.patchids & 0xFFFF; //y
-		}
-		else
+void LLSurface::applyDecodedPatches(const std::vector<LLDecodedPatch> &patches, S32 patch_size)
+{
+	for (std::vector<LLDecodedPatch>::const_iterator iter = patches.begin(); iter != patches.end(); ++iter)
+	{
+		if ((iter->mX >= mPatchesPerEdge) || (iter->mY >= mPatchesPerEdge))
 		{
-			i = ph.patchids >> 5; //x
-			j = ph.patchids & 0x1F; //y
+			// decoded for a surface that has since been recreated
+			continue;
 		}
+		LLSurfacePatch *patchp = &mPatchList[iter->mY*mPatchesPerEdge + iter->mX];
 
-		if ((i >= mPatchesPerEdge) || (j >= mPatchesPerEdge))
+		F32 *data = patchp->getDataZ();
+		for (S32 j = 0; j < patch_size; j++)
 		{
-			llwarns << "Received invalid terrain packet - patch header patch ID incorrect!" 
-				<< " patches per edge " << mPatchesPerEdge
-				<< " i " << i
-				<< " j " << j
-				<< " dc_offset " << ph.dc_offset
-				<< " range " << (S32)ph.range
-				<< " quant_wbits " << (S32)ph.quant_wbits
-				<< " patchids " << (S32)ph.patchids
-				<< llendl;
-            LLAppViewer::instance()->badNetworkHandler();
-			return;
+			memcpy(data + j*mGridsPerEdge, iter->mHeights + j*patch_size, patch_size*sizeof(F32));
 		}
 
-		patchp = &mPatchList[j*mPatchesPerEdge + i];
-
-
-		decode_patch(bitpack, patch);
-		decompress_patch(patchp->getDataZ(), patch, &ph);
-
 		// Update edges for neighbors.  Need to guarantee that this gets done before we generate vertical stats.
 		patchp->updateNorthEdge();
 		patchp->updateEastEdge();
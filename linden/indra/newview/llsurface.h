@@ -69,6 +69,7 @@ class LLViewerRegion;
 class LLSurfacePatch;
 class LLBitPack;
 class LLGroupHeader;
+struct LLDecodedPatch;
 
 class LLSurface 
 {
@@ -94,6 +95,8 @@ public:
 	void rebuildWater(); //Destroys (if nesessary) and then rebuilds (if needed)
 
 	virtual void decompressDCTPatch(LLBitPack &bitpack, LLGroupHeader *gopp, BOOL b_large_patch);
+	// Copies patches decoded elsewhere into the surface
+	void applyDecodedPatches(const std::vector<LLDecodedPatch> &patches, S32 patch_size);
 	virtual void updatePatchVisibilities(LLAgent &agent);
 
 	inline F32 getZ(const U32 k) const				{ return mSurfaceZ[k]; }
@@ -55,6 +55,7 @@ extern LLPipeline gPipeline;
 LLSurfacePatch::LLSurfacePatch() :
 	mHasReceivedData(FALSE),
 	mSTexUpdate(FALSE),
+	mSTexPending(FALSE),
 	mDirty(FALSE),
 	mDirtyZStats(TRUE),
 	mHeightsGenerated(FALSE),
@@ -709,22 +710,28 @@ BOOL LLSurfacePatch::updateTexture()
 			
 			if (comp->generateComposition())
 			{
-				if (mVObjp)
+				if (!mSTexPending)
 				{
-					mVObjp->dirtyGeom();
+					if (mVObjp)
+					{
+						mVObjp->dirtyGeom();
+					}
+					updateCompositionStats();
 				}
-				updateCompositionStats();
 				F32 tex_patch_size = meters_per_grid*grids_per_patch_edge;
 				if (comp->generateTexture((F32)origin_region[VX], (F32)origin_region[VY],
 										  tex_patch_size, tex_patch_size))
 				{
 					mSTexUpdate = FALSE;
+					mSTexPending = FALSE;
 
 					// Also generate the water texture
 					mSurfacep->generateWaterTexture((F32)origin_region.mdV[VX], (F32)origin_region.mdV[VY],
 													tex_patch_size, tex_patch_size);
 					return TRUE;
 				}
+				// Still compositing in the background
+				mSTexPending = TRUE;
 			}
 		}
 		return FALSE;
@@ -739,6 +746,7 @@ BOOL LLSurfacePatch::updateTexture()
 void LLSurfacePatch::dirtyZ()
 {
 	mSTexUpdate = TRUE;
+	mSTexPending = FALSE;
 
 	// Invalidate all normals in this patch
 	U32 i;
@@ -146,6 +146,7 @@ public:
 public:
 	BOOL mHasReceivedData;	// has the patch EVER received height data?
 	BOOL mSTexUpdate;		// Does the surface texture need to be updated?
+	BOOL mSTexPending;		// Has the surface texture update been started?
 
 protected:
 	LLSurfacePatch *mNeighborPatches[8]; // Adjacent patches
@@ -0,0 +1,477 @@
+/** 
+ * @file lltexturebodystore.cpp
+ * @brief Single file storage for texture cache bodies.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ * 
+ * Copyright (c) 2009, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#include "llviewerprecompiledheaders.h"
+
+#include "lltexturebodystore.h"
+
+#if !LL_WINDOWS
+#include "apr_portable.h"
+#include <unistd.h>
+#endif
+
+LLTextureBodyStore::LLTextureBodyStore()
+	: mReadOnly(false),
+	  mLoaded(false),
+	  mEndBlock(0)
+{
+}
+
+LLTextureBodyStore::~LLTextureBodyStore()
+{
+	close();
+}
+
+LLTextureBodyStore::StoreLock::StoreLock(LLTextureBodyStore* store)
+	: mStore(store)
+{
+	for (S32 i = 0; i < SHARD_COUNT; i++)
+	{
+		mStore->mShards[i].mMutex.lock();
+	}
+	mStore->mFreeMutex.lock();
+}
+
+LLTextureBodyStore::StoreLock::~StoreLock()
+{
+	mStore->mFreeMutex.unlock();
+	for (S32 i = SHARD_COUNT - 1; i >= 0; i--)
+	{
+		mStore->mShards[i].mMutex.unlock();
+	}
+}
+
+bool LLTextureBodyStore::open(const std::string& filename, bool read_only)
+{
+	StoreLock lock(this);
+	if (mFile.getFileHandle())
+	{
+		mFile.close();
+	}
+	mReadOnly = read_only;
+	apr_int32_t flags = read_only ? APR_READ|APR_BINARY : APR_READ|APR_WRITE|APR_CREATE|APR_BINARY;
+	// The file stays open for the life of the cache and is used from the cache thread.
+	if (mFile.open(filename, flags, LLAPRFile::global) != APR_SUCCESS)
+	{
+		llwarns << "Unable to open texture body store " << filename << llendl;
+		return false;
+	}
+	// Nothing is known about the contents until the entries are scanned,
+	// so new bodies go past the end of the file.
+	apr_off_t end = 0;
+	apr_file_seek(mFile.getFileHandle(), APR_END, &end);
+	mEndBlock = blocksForSize((S32)llmin((S64)end, (S64)S32_MAX));
+	mLoaded = false;
+	return true;
+}
+
+void LLTextureBodyStore::close()
+{
+	StoreLock lock(this);
+	if (mFile.getFileHandle())
+	{
+		mFile.close();
+	}
+	for (S32 i = 0; i < SHARD_COUNT; i++)
+	{
+		mShards[i].mExtents.clear();
+	}
+	mFreeByBlock.clear();
+	mFreeByLength.clear();
+	mLoadingExtents.clear();
+	mLoadingUsed.clear();
+	mEndBlock = 0;
+	mLoaded = false;
+}
+
+void LLTextureBodyStore::clear()
+{
+	StoreLock lock(this);
+	for (S32 i = 0; i < SHARD_COUNT; i++)
+	{
+		mShards[i].mExtents.clear();
+	}
+	mFreeByBlock.clear();
+	mFreeByLength.clear();
+	mLoadingExtents.clear();
+	mLoadingUsed.clear();
+	mEndBlock = 0;
+	if (mFile.getFileHandle() && !mReadOnly)
+	{
+		apr_file_trunc(mFile.getFileHandle(), 0);
+	}
+	mLoaded = true;
+}
+
+//----------------------------------------------------------------------------
+
+void LLTextureBodyStore::beginLoading()
+{
+	LLMutexLock lock(&mFreeMutex);
+	mLoadingExtents.clear();
+	mLoadingUsed.clear();
+}
+
+bool LLTextureBodyStore::addExisting(const LLUUID& id, U32 block, S32 size)
+{
+	LLMutexLock lock(&mFreeMutex);
+	if (size <= 0 || mLoadingExtents.find(id) != mLoadingExtents.end())
+	{
+		return false;
+	}
+	U32 blocks = blocksForSize(size);
+	used_map_t::iterator next = mLoadingUsed.lower_bound(block);
+	if (next != mLoadingUsed.end() && next->first < block + blocks)
+	{
+		return false;
+	}
+	if (next != mLoadingUsed.begin())
+	{
+		used_map_t::iterator prev = next;
+		--prev;
+		if (prev->first + prev->second > block)
+		{
+			return false;
+		}
+	}
+	mLoadingUsed[block] = blocks;
+	mLoadingExtents[id] = Extent(block, blocks, size);
+	return true;
+}
+
+void LLTextureBodyStore::finishLoading()
+{
+	StoreLock lock(this);
+	for (S32 i = 0; i < SHARD_COUNT; i++)
+	{
+		mShards[i].mExtents.clear();
+	}
+	for (extent_map_t::iterator iter = mLoadingExtents.begin(); iter != mLoadingExtents.end(); ++iter)
+	{
+		getShard(iter->first).mExtents.insert(*iter);
+	}
+	mLoadingExtents.clear();
+	mFreeByBlock.clear();
+	mFreeByLength.clear();
+	U32 cur = 0;
+	for (used_map_t::iterator iter = mLoadingUsed.begin(); iter != mLoadingUsed.end(); ++iter)
+	{
+		if (iter->first > cur)
+		{
+			addFreeRange(cur, iter->first - cur);
+		}
+		cur = iter->first + iter->second;
+	}
+	mEndBlock = cur;
+	mLoadingUsed.clear();
+	mLoaded = true;
+}
+
+void LLTextureBodyStore::addKnown(const LLUUID& id, U32 block, S32 size)
+{
+	Shard& shard = getShard(id);
+	LLMutexLock lock(&shard.mMutex);
+	bool loaded;
+	{
+		LLMutexLock free_lock(&mFreeMutex);
+		loaded = mLoaded;
+	}
+	if (!loaded && size > 0 && shard.mExtents.find(id) == shard.mExtents.end())
+	{
+		shard.mExtents[id] = Extent(block, blocksForSize(size), size);
+	}
+}
+
+//----------------------------------------------------------------------------
+
+S32 LLTextureBodyStore::allocate(const LLUUID& id, S32 size)
+{
+	Shard& shard = getShard(id);
+	LLMutexLock lock(&shard.mMutex);
+	if (mReadOnly || !mFile.getFileHandle() || size <= 0)
+	{
+		return -1;
+	}
+	U32 blocks = blocksForSize(size);
+	extent_map_t::iterator iter = shard.mExtents.find(id);
+	if (iter != shard.mExtents.end())
+	{
+		Extent& extent = iter->second;
+		if (extent.mBlocks >= blocks)
+		{
+			extent.mSize = size;
+			return (S32)extent.mBlock;
+		}
+	}
+	LLMutexLock free_lock(&mFreeMutex);
+	if (iter != shard.mExtents.end())
+	{
+		// Bodies are always rewritten from the start, so there is nothing to copy
+		freeBlocks(iter->second.mBlock, iter->second.mBlocks);
+		shard.mExtents.erase(iter);
+	}
+	U32 block = allocateBlocks(blocks);
+	shard.mExtents[id] = Extent(block, blocks, size);
+	return (S32)block;
+}
+
+void LLTextureBodyStore::remove(const LLUUID& id)
+{
+	Shard& shard = getShard(id);
+	LLMutexLock lock(&shard.mMutex);
+	extent_map_t::iterator iter = shard.mExtents.find(id);
+	if (iter != shard.mExtents.end())
+	{
+		LLMutexLock free_lock(&mFreeMutex);
+		freeBlocks(iter->second.mBlock, iter->second.mBlocks);
+		shard.mExtents.erase(iter);
+	}
+}
+
+S32 LLTextureBodyStore::getSize(const LLUUID& id)
+{
+	Shard& shard = getShard(id);
+	LLMutexLock lock(&shard.mMutex);
+	extent_map_t::iterator iter = shard.mExtents.find(id);
+	return iter != shard.mExtents.end() ? iter->second.mSize : 0;
+}
+
+S32 LLTextureBodyStore::getStoredSize(const LLUUID& id)
+{
+	Shard& shard = getShard(id);
+	LLMutexLock lock(&shard.mMutex);
+	extent_map_t::iterator iter = shard.mExtents.find(id);
+	apr_file_t* file = mFile.getFileHandle();
+	if (iter == shard.mExtents.end() || !file)
+	{
+		return 0;
+	}
+	apr_finfo_t info;
+	if (apr_file_info_get(&info, APR_FINFO_SIZE, file) != APR_SUCCESS)
+	{
+		return 0;
+	}
+	S64 start = (S64)iter->second.mBlock * BLOCK_SIZE;
+	S64 stored = llclamp((S64)info.size - start, (S64)0, (S64)iter->second.mSize);
+	return (S32)stored;
+}
+
+// The shard mutex is held during I/O so that the extent can't be freed and
+// handed to another texture while it is being read or written.
+S32 LLTextureBodyStore::read(const LLUUID& id, U8* buffer, S32 offset, S32 size)
+{
+	Shard& shard = getShard(id);
+	LLMutexLock lock(&shard.mMutex);
+	extent_map_t::iterator iter = shard.mExtents.find(id);
+	if (iter == shard.mExtents.end() || offset < 0 || offset >= iter->second.mSize)
+	{
+		return 0;
+	}
+	size = llmin(size, iter->second.mSize - offset);
+	return readAt((S64)iter->second.mBlock * BLOCK_SIZE + offset, buffer, size);
+}
+
+S32 LLTextureBodyStore::write(const LLUUID& id, const U8* buffer, S32 size)
+{
+	Shard& shard = getShard(id);
+	LLMutexLock lock(&shard.mMutex);
+	extent_map_t::iterator iter = shard.mExtents.find(id);
+	if (mReadOnly || iter == shard.mExtents.end())
+	{
+		return 0;
+	}
+	size = llmin(size, (S32)(iter->second.mBlocks * BLOCK_SIZE));
+	return writeAt((S64)iter->second.mBlock * BLOCK_SIZE, buffer, size);
+}
+
+S64 LLTextureBodyStore::getFileSize()
+{
+	LLMutexLock lock(&mFreeMutex);
+	return (S64)mEndBlock * BLOCK_SIZE;
+}
+
+S64 LLTextureBodyStore::getFreeSize()
+{
+	LLMutexLock lock(&mFreeMutex);
+	S64 res = 0;
+	for (free_by_block_t::iterator iter = mFreeByBlock.begin(); iter != mFreeByBlock.end(); ++iter)
+	{
+		res += (S64)iter->second * BLOCK_SIZE;
+	}
+	return res;
+}
+
+//----------------------------------------------------------------------------
+// mFreeMutex must be locked for the following functions
+
+// Best fit from the free list, else grow the file
+U32 LLTextureBodyStore::allocateBlocks(U32 blocks)
+{
+	free_by_length_t::iterator iter = mFreeByLength.lower_bound(blocks);
+	if (iter != mFreeByLength.end())
+	{
+		U32 free_blocks = iter->first;
+		U32 block = iter->second;
+		eraseFreeRange(block, free_blocks);
+		if (free_blocks > blocks)
+		{
+			addFreeRange(block + blocks, free_blocks - blocks);
+		}
+		return block;
+	}
+	U32 block = mEndBlock;
+	mEndBlock += blocks;
+	return block;
+}
+
+// Returns a range to the free list, merging it with its neighbors
+void LLTextureBodyStore::freeBlocks(U32 block, U32 blocks)
+{
+	free_by_block_t::iterator next = mFreeByBlock.lower_bound(block);
+	if (next != mFreeByBlock.end() && next->first == block + blocks)
+	{
+		blocks += next->second;
+		eraseFreeRange(next->first, next->second);
+	}
+	next = mFreeByBlock.lower_bound(block);
+	if (next != mFreeByBlock.begin())
+	{
+		free_by_block_t::iterator prev = next;
+		--prev;
+		if (prev->first + prev->second == block)
+		{
+			U32 prev_block = prev->first;
+			blocks += prev->second;
+			eraseFreeRange(prev->first, prev->second);
+			block = prev_block;
+		}
+	}
+	if (block + blocks == mEndBlock)
+	{
+		// Free space at the end of the file is simply reused by the next append
+		mEndBlock = block;
+	}
+	else
+	{
+		addFreeRange(block, blocks);
+	}
+}
+
+void LLTextureBodyStore::addFreeRange(U32 block, U32 blocks)
+{
+	mFreeByBlock[block] = blocks;
+	mFreeByLength.insert(std::make_pair(blocks, block));
+}
+
+void LLTextureBodyStore::eraseFreeRange(U32 block, U32 blocks)
+{
+	mFreeByBlock.erase(block);
+	std::pair<free_by_length_t::iterator, free_by_length_t::iterator> range = mFreeByLength.equal_range(blocks);
+	for (free_by_length_t::iterator iter = range.first; iter != range.second; ++iter)
+	{
+		if (iter->second == block)
+		{
+			mFreeByLength.erase(iter);
+			break;
+		}
+	}
+}
+
+// The shard of the extent must be locked for readAt() and writeAt()
+S32 LLTextureBodyStore::readAt(S64 offset, U8* buffer, S32 size)
+{
+	apr_file_t* file = mFile.getFileHandle();
+	if (!file)
+	{
+		return 0;
+	}
+#if LL_WINDOWS
+	LLMutexLock lock(&mFileMutex);
+	apr_off_t pos = offset;
+	if (apr_file_seek(file, APR_SET, &pos) != APR_SUCCESS)
+	{
+		return 0;
+	}
+	apr_size_t bytes = size;
+	apr_file_read(file, buffer, &bytes);
+	return (S32)bytes;
+#else
+	apr_os_file_t fd;
+	apr_os_file_get(&fd, file);
+	S32 total = 0;
+	while (total < size)
+	{
+		ssize_t res = pread(fd, buffer + total, size - total, (off_t)(offset + total));
+		if (res <= 0)
+		{
+			break;
+		}
+		total += (S32)res;
+	}
+	return total;
+#endif
+}
+
+S32 LLTextureBodyStore::writeAt(S64 offset, const U8* buffer, S32 size)
+{
+	apr_file_t* file = mFile.getFileHandle();
+	if (!file)
+	{
+		return 0;
+	}
+#if LL_WINDOWS
+	LLMutexLock lock(&mFileMutex);
+	apr_off_t pos = offset;
+	if (apr_file_seek(file, APR_SET, &pos) != APR_SUCCESS)
+	{
+		return 0;
+	}
+	apr_size_t bytes = size;
+	apr_file_write(file, buffer, &bytes);
+	return (S32)bytes;
+#else
+	apr_os_file_t fd;
+	apr_os_file_get(&fd, file);
+	S32 total = 0;
+	while (total < size)
+	{
+		ssize_t res = pwrite(fd, buffer + total, size - total, (off_t)(offset + total));
+		if (res <= 0)
+		{
+			break;
+		}
+		total += (S32)res;
+	}
+	return total;
+#endif
+}
@@ -0,0 +1,162 @@
+/** 
+ * @file lltexturebodystore.h
+ * @brief Single file storage for texture cache bodies.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ * 
+ * Copyright (c) 2009, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLTEXTUREBODYSTORE_H
+#define LL_LLTEXTUREBODYSTORE_H
+
+#include "llapr.h"
+#include "llthread.h"
+#include "lluuid.h"
+
+// Keeps the body of every cached texture (everything after the first
+// TEXTURE_CACHE_ENTRY_SIZE bytes) in one file instead of one file per UUID.
+// Space is handed out in extents of whole blocks.  The store has no index
+// file of its own: LLTextureCache records the extent of each body in its
+// entries file and hands them all back with addExisting() when it scans
+// them.  Until the first scan the free space is unknown and the file only
+// grows; extents are learned one at a time with addKnown().
+//
+// All methods are thread safe.  The extents are split over SHARD_COUNT
+// shards by id, each with its own mutex that is held during the I/O on its
+// bodies, so reads and writes of different textures don't wait on each
+// other.  The free space has a separate mutex, taken after a shard mutex.
+class LLTextureBodyStore
+{
+public:
+	enum { BLOCK_SIZE = 4096 };
+	enum { SHARD_COUNT = 16 };	// power of 2
+
+	LLTextureBodyStore();
+	~LLTextureBodyStore();
+
+	bool open(const std::string& filename, bool read_only);
+	void close();
+	bool isOpen() { return mFile.getFileHandle() != NULL; }
+
+	// Forget all extents and truncate the file
+	void clear();
+
+	// Full scan: beginLoading(), addExisting() for every body, finishLoading().
+	// The previous extents stay in use until finishLoading().
+	void beginLoading();
+	// Returns false if the extent is not usable (overlaps another one).
+	bool addExisting(const LLUUID& id, U32 block, S32 size);
+	// Replaces the extents and turns the gaps into free space.
+	void finishLoading();
+	bool isLoaded() { return mLoaded; }
+	// Before the first scan: registers the extent of a body read from its entry
+	void addKnown(const LLUUID& id, U32 block, S32 size);
+
+	// Reserves room for size bytes of body, moving the body if it no longer fits.
+	// Returns the first block of the extent, or -1 on failure.
+	S32 allocate(const LLUUID& id, S32 size);
+	void remove(const LLUUID& id);
+	// Size of the body of id, 0 if there is none
+	S32 getSize(const LLUUID& id);
+	// Like getSize() but only counts bytes actually present in the file (validation)
+	S32 getStoredSize(const LLUUID& id);
+
+	S32 read(const LLUUID& id, U8* buffer, S32 offset, S32 size);
+	// Writes the body of id from its start; allocate() must have been called first.
+	S32 write(const LLUUID& id, const U8* buffer, S32 size);
+
+	// debug
+	S64 getFileSize();
+	S64 getFreeSize();
+
+private:
+	struct Extent
+	{
+		Extent() : mBlock(0), mBlocks(0), mSize(0) {}
+		Extent(U32 block, U32 blocks, S32 size) : mBlock(block), mBlocks(blocks), mSize(size) {}
+		U32 mBlock;		// first block
+		U32 mBlocks;	// allocated blocks
+		S32 mSize;		// bytes in use
+	};
+
+	typedef std::map<LLUUID, Extent> extent_map_t;
+	struct Shard
+	{
+		LLMutex mMutex;
+		extent_map_t mExtents;
+	};
+
+	static U32 blocksForSize(S32 size) { return (U32)((size + BLOCK_SIZE - 1) / BLOCK_SIZE); }
+	// Texture ids are random, any byte will do
+	Shard& getShard(const LLUUID& id) { return mShards[id.mData[0] & (SHARD_COUNT - 1)]; }
+	// Locks every shard, then the free space
+	class StoreLock
+	{
+	public:
+		StoreLock(LLTextureBodyStore* store);
+		~StoreLock();
+	private:
+		LLTextureBodyStore* mStore;
+	};
+	friend class StoreLock;
+
+	// mFreeMutex must be locked for these
+	U32 allocateBlocks(U32 blocks);
+	void freeBlocks(U32 block, U32 blocks);
+	void addFreeRange(U32 block, U32 blocks);
+	void eraseFreeRange(U32 block, U32 blocks);
+	// The shard of the extent must be locked for these
+	S32 readAt(S64 offset, U8* buffer, S32 size);
+	S32 writeAt(S64 offset, const U8* buffer, S32 size);
+
+private:
+	Shard mShards[SHARD_COUNT];
+	LLMutex mFreeMutex;
+#if LL_WINDOWS
+	// readAt() and writeAt() seek the shared file handle
+	LLMutex mFileMutex;
+#endif
+	LLAPRFile mFile;
+	bool mReadOnly;
+	bool mLoaded;
+
+	// extents collected by a scan, by id and by first block
+	extent_map_t mLoadingExtents;
+	typedef std::map<U32, U32> used_map_t;
+	used_map_t mLoadingUsed;
+
+	// free space, by first block and by length
+	typedef std::map<U32, U32> free_by_block_t;
+	free_by_block_t mFreeByBlock;
+	typedef std::multimap<U32, U32> free_by_length_t;
+	free_by_length_t mFreeByLength;
+
+	// first block past the last allocated extent
+	U32 mEndBlock;
+};
+
+#endif // LL_LLTEXTUREBODYSTORE_H
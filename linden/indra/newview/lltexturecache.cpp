@@ -450,11 +450,10 @@ bool LLTextureCacheRemoteWorker::doRead()
 		}
 	}
 
-	// Fourth state / stage : read the rest of the data from the UUID based cached file
+	// Fourth state / stage : read the rest of the data from the body store
 	if (!done && (mState == BODY))
 	{
-		std::string filename = mCache->getTextureFileName(mID);
-		S32 filesize = LLAPRFile::size(filename);
+		S32 filesize = mCache->getBodyStore().getSize(mID);
 
 		if (filesize && (filesize + TEXTURE_CACHE_ENTRY_SIZE) > mOffset)
 		{
@@ -494,9 +493,8 @@ bool LLTextureCacheRemoteWorker::doRead()
 			mReadData = data;
 
 			// Read the data at last
-			S32 bytes_read = LLAPRFile::readEx(filename, 
-											 mReadData + data_offset,
-											 file_offset, file_size);
+			S32 bytes_read = mCache->getBodyStore().read(mID, mReadData + data_offset,
+														 file_offset, file_size);
 			if (bytes_read != file_size)
 			{
 				llwarns << "LLTextureCacheWorker: "  << mID
@@ -512,7 +510,7 @@ bool LLTextureCacheRemoteWorker::doRead()
 		{
 			// No body, we're done.
 			mDataSize = llmax(TEXTURE_CACHE_ENTRY_SIZE - mOffset, 0);
-			lldebugs << "No body file for: " << filename << llendl;
+			lldebugs << "No body for: " << mID << llendl;
 		}	
 		// Nothing else to do at that point...
 		done = true;
@@ -624,19 +622,17 @@ bool LLTextureCacheRemoteWorker::doWrite()
 		}
 	}
 	
-	// Fourth stage / state : write the body file, i.e. the rest of the texture in a "UUID" file name
+	// Fourth stage / state : write the body, i.e. the rest of the texture, to the body store
 	if (!done && (mState == BODY))
 	{
 		llassert(mDataSize > TEXTURE_CACHE_ENTRY_SIZE);	// wouldn't make sense to be here otherwise...
 		S32 file_size = mDataSize - TEXTURE_CACHE_ENTRY_SIZE;
 		if ((file_size > 0) && mCache->updateTextureEntryList(mID, file_size))
 		{
-			// build the cache file name from the UUID
-			std::string filename = mCache->getTextureFileName(mID);			
-// 			llinfos << "Writing Body: " << filename << " Bytes: " << file_offset+file_size << llendl;
-			S32 bytes_written = LLAPRFile::writeEx(	filename, 
-													mWriteData + TEXTURE_CACHE_ENTRY_SIZE,
-													0, file_size);
+// 			llinfos << "Writing Body: " << mID << " Bytes: " << file_size << llendl;
+			S32 bytes_written = mCache->getBodyStore().write(mID, 
+															 mWriteData + TEXTURE_CACHE_ENTRY_SIZE,
+															 file_size);
 			if (bytes_written <= 0)
 			{
 				llwarns << "LLTextureCacheWorker: "  << mID
@@ -738,7 +734,7 @@ LLTextureCache::LLTextureCache(bool threaded)
 	: LLWorkerThread("TextureCache", threaded),
 	  mHeaderAPRFile(NULL),
 	  mReadOnly(FALSE),
-	  mTexturesSizeTotal(0),
+	  mCompactPending(FALSE),
 	  mDoPurge(FALSE)
 {
 }
@@ -801,31 +797,18 @@ std::string LLTextureCache::getLocalFileName(const LLUUID& id)
 	return filename;
 }
 
-std::string LLTextureCache::getTextureFileName(const LLUUID& id)
-{
-	std::string idstr = id.asString();
-	std::string delem = gDirUtilp->getDirDelimiter();
-	std::string filename = mTexturesDirName + delem + idstr[0] + delem + idstr + ".texture";
-	return filename;
-}
-
 bool LLTextureCache::updateTextureEntryList(const LLUUID& id, S32 bodysize)
 {
 	bool res = false;
 	bool purge = false;
 	{
 		mHeaderMutex.lock();
-		size_map_t::iterator iter1 = mTexturesSizeMap.find(id);
-		if (iter1 == mTexturesSizeMap.end() || iter1->second < bodysize)
+		S32 oldbodysize = 0;
+		mIndex.find(id, oldbodysize);
+		if (oldbodysize < bodysize)
 		{
 			llassert_always(bodysize > 0);
 
-			S32 oldbodysize = 0;
-			if (iter1 != mTexturesSizeMap.end())
-			{
-				oldbodysize = iter1->second;
-			}
-						
 			Entry entry;
 			S32 idx = openAndReadEntry(id, entry, false);
 			if (idx < 0)
@@ -837,16 +820,28 @@ bool LLTextureCache::updateTextureEntryList(const LLUUID& id, S32 bodysize)
 			}			
 			else if (oldbodysize != entry.mBodySize)
 			{
-				llwarns << "Entry mismatch in mTextureSizeMap / mHeaderIDMap"
+				llwarns << "Entry mismatch in texture cache index"
 					   << " idx=" << idx << " oldsize=" << oldbodysize << " entrysize=" << entry.mBodySize << llendl;
 			}
+			if (entry.mImageSize < bodysize)
+			{
+				// writeEntryAndClose() would refuse this entry, don't store a body for it
+				mHeaderMutex.unlock();
+				return false;
+			}
+			S32 block = mBodyStore.allocate(id, bodysize);
+			if (block < 0)
+			{
+				llwarns << "Failed to allocate body: " << id << " size: " << bodysize << llendl;
+				mHeaderMutex.unlock();
+				removeFromCache(id);
+				return false;
+			}
 			entry.mBodySize = bodysize;
-			writeEntryAndClose(idx, entry);
+			entry.mBodyBlock = (U32)block;
+			writeEntryAndClose(idx, entry); // updates the index
 			
-			mTexturesSizeTotal -= oldbodysize;
-			mTexturesSizeTotal += bodysize;
-			
-			if (mTexturesSizeTotal > sCacheMaxTexturesSize)
+			if (mIndex.getBodySizeTotal() > sCacheMaxTexturesSize)
 			{
 				purge = true;
 			}
@@ -865,12 +860,15 @@ bool LLTextureCache::updateTextureEntryList(const LLUUID& id, S32 bodysize)
 
 //static
 const S32 MAX_REASONABLE_FILE_SIZE = 512*1024*1024; // 512 MB
-F32 LLTextureCache::sHeaderCacheVersion = 1.3f;
+F32 LLTextureCache::sHeaderCacheVersion = 1.4f;
 U32 LLTextureCache::sCacheMaxEntries = MAX_REASONABLE_FILE_SIZE / TEXTURE_CACHE_ENTRY_SIZE;
 S64 LLTextureCache::sCacheMaxTexturesSize = 0; // no limit
 const char* entries_filename = "texture.entries";
 const char* cache_filename = "texture.cache";
 const char* textures_dirname = "textures";
+const char* bodies_filename = "texture.bodies";
+const char* index_filename = "texture.index";
+const char* journal_filename = "texture.journal";
 
 void LLTextureCache::setDirNames(ELLPath location)
 {
@@ -878,6 +876,10 @@ void LLTextureCache::setDirNames(ELLPath location)
 	mHeaderEntriesFileName = gDirUtilp->getExpandedFilename(location, entries_filename);
 	mHeaderDataFileName = gDirUtilp->getExpandedFilename(location, cache_filename);
 	mTexturesDirName = gDirUtilp->getExpandedFilename(location, textures_dirname);
+	mBodyStoreFileName = gDirUtilp->getExpandedFilename(location, bodies_filename);
+	mIndexFileName = gDirUtilp->getExpandedFilename(location, index_filename);
+	mJournalFileName = gDirUtilp->getExpandedFilename(location, journal_filename);
+	mIndex.setFileNames(mIndexFileName, mJournalFileName, mReadOnly);
 }
 
 void LLTextureCache::purgeCache(ELLPath location)
@@ -890,6 +892,11 @@ void LLTextureCache::purgeCache(ELLPath location)
 		llassert_always(mHeaderAPRFile == NULL);
 		LLAPRFile::remove(mHeaderEntriesFileName);
 		LLAPRFile::remove(mHeaderDataFileName);
+		mBodyStore.close();
+		LLAPRFile::remove(mBodyStoreFileName);
+		mIndex.close();
+		LLAPRFile::remove(mIndexFileName);
+		LLAPRFile::remove(mJournalFileName);
 	}
 	purgeAllTextures(true);
 }
@@ -914,22 +921,91 @@ S64 LLTextureCache::initCache(ELLPath location, S64 max_size, BOOL read_only)
 
 	setDirNames(location);
 	
+	if (!mBodyStore.open(mBodyStoreFileName, mReadOnly))
+	{
+		LL_WARNS("TextureCache") << "Texture bodies will not be cached" << LL_ENDL;
+	}
+
+	// Validate 1/256th of the files on startup.  The counter is a setting,
+	// so it is read and advanced here, on the main thread.
+	U32 validate_idx = gSavedSettings.getU32("CacheValidateCounter");
 	if (!mReadOnly)
 	{
-		LLFile::mkdir(mTexturesDirName);
-		const char* subdirs = "0123456789abcdef";
-		for (S32 i=0; i<16; i++)
-		{
-			std::string dirname = mTexturesDirName + gDirUtilp->getDirDelimiter() + subdirs[i];
-			LLFile::mkdir(dirname);
-		}
+		gSavedSettings.setU32("CacheValidateCounter", (validate_idx + 1) % 256);
+	}
+
+	if (openIndex())
+	{
+		// The index answers lookups right away, scan the entries
+		// (LRU, free body space, validation) in the background.
+		scheduleMaintenance(MAINTENANCE_SCAN, validate_idx);
+	}
+	else
+	{
+		readHeaderCache(); // also rebuilds the index
+		purgeTextures(true, validate_idx); // calc mTexturesSize and make some room in the texture cache if we need it
 	}
-	readHeaderCache();
-	purgeTextures(true); // calc mTexturesSize and make some room in the texture cache if we need it
 
 	return max_size; // unused cache space
 }
 
+bool LLTextureCache::openIndex()
+{
+	LLMutexLock lock(&mHeaderMutex);
+	readEntriesHeader();
+	if (mHeaderEntriesInfo.mVersion != sHeaderCacheVersion)
+	{
+		return false;
+	}
+	return mIndex.open();
+}
+
+//----------------------------------------------------------------------------
+
+LLTextureCache::MaintenanceRequest::MaintenanceRequest(LLTextureCache* cache, handle_t handle,
+													   e_maintenance type, U32 validate_idx)
+	: LLQueuedThread::QueuedRequest(handle, LLQueuedThread::PRIORITY_LOW, FLAG_AUTO_COMPLETE),
+	  mCache(cache),
+	  mType(type),
+	  mValidateIdx(validate_idx)
+{
+}
+
+// virtual (WORKER THREAD)
+bool LLTextureCache::MaintenanceRequest::processRequest()
+{
+	if (mType == MAINTENANCE_SCAN)
+	{
+		mCache->readHeaderCache();
+		mCache->purgeTextures(true, mValidateIdx);
+	}
+	else
+	{
+		LLMutexLock lock(&mCache->mHeaderMutex);
+		mCache->mIndex.compact();
+		mCache->mCompactPending = FALSE;
+	}
+	return true;
+}
+
+void LLTextureCache::scheduleMaintenance(e_maintenance type, U32 validate_idx)
+{
+	if (!addRequest(new MaintenanceRequest(this, generateHandle(), type, validate_idx)))
+	{
+		llwarns << "Unable to schedule texture cache maintenance" << llendl;
+	}
+}
+
+// mHeaderMutex must be locked
+void LLTextureCache::checkIndexCompaction()
+{
+	if (!mCompactPending && mIndex.needsCompaction())
+	{
+		mCompactPending = TRUE;
+		scheduleMaintenance(MAINTENANCE_COMPACT);
+	}
+}
+
 //----------------------------------------------------------------------------
 // mHeaderMutex must be locked for the following functions!
 
@@ -972,12 +1048,37 @@ static S32 mHeaderEntriesMaxWriteIdx = 0;
 
 S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create)
 {
-	S32 idx = -1;
-	
-	id_map_t::iterator iter1 = mHeaderIDMap.find(id);
-	if (iter1 != mHeaderIDMap.end())
+	S32 bodysize;
+	S32 idx = mIndex.find(id, bodysize);
+
+	if (idx >= 0)
 	{
-		idx = iter1->second;
+		// Read the entry
+		S32 bytes_read = 0;
+		if (idx < (S32)mHeaderEntriesInfo.mEntries)
+		{
+			S32 offset = sizeof(EntriesInfo) + idx * sizeof(Entry);
+			LLAPRFile* aprfile = openHeaderEntriesFile(true, offset);
+			bytes_read = aprfile->read((void*)&entry, (S32)sizeof(Entry));
+			closeHeaderEntriesFile();
+		}
+		if (bytes_read != sizeof(Entry) || entry.mID != id)
+		{
+			// The journal and the entries file can disagree after a crash
+			llwarns << "Texture cache index out of date for: " << id << " idx=" << idx << llendl;
+			mIndex.remove(id, false);
+			idx = -1;
+		}
+		else
+		{
+			// Remove this entry from the LRU if it exists
+			mLRU.erase(id);
+			llassert_always(entry.mImageSize == 0 || entry.mImageSize == -1 || entry.mImageSize > entry.mBodySize);
+			if (entry.mBodySize > 0 && !mBodyStore.isLoaded())
+			{
+				mBodyStore.addKnown(id, entry.mBodyBlock, entry.mBodySize);
+			}
+		}
 	}
 
 	if (idx < 0)
@@ -990,10 +1091,9 @@ S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create
 				idx = mHeaderEntriesInfo.mEntries++;
 
 			}
-			else if (!mFreeList.empty())
+			else if ((idx = mIndex.popFreeEntry()) >= 0)
 			{
-				idx = *(mFreeList.begin());
-				mFreeList.erase(mFreeList.begin());
+				// Reuse a deleted entry
 			}
 			else
 			{
@@ -1005,12 +1105,13 @@ S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create
 					// Erase entry from LRU regardless
 					mLRU.erase(curiter2);
 					// Look up entry and use it if it is valid
-					id_map_t::iterator iter3 = mHeaderIDMap.find(oldid);
-					if (iter3 != mHeaderIDMap.end() && iter3->second >= 0)
+					S32 oldbodysize;
+					S32 oldidx = mIndex.find(oldid, oldbodysize);
+					if (oldidx >= 0)
 					{
-						idx = iter3->second;
-						mHeaderIDMap.erase(oldid);
-						mTexturesSizeMap.erase(oldid);
+						idx = oldidx;
+						mIndex.remove(oldid, false);
+						mBodyStore.remove(oldid);
 						break;
 					}
 				}
@@ -1021,8 +1122,7 @@ S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create
 			if (idx >= 0)
 			{
 				// Set the header index
-				mHeaderIDMap[id] = idx;
-				llassert_always(mTexturesSizeMap.erase(id) == 0);
+				mIndex.set(id, idx, 0);
 				// Initialize the entry (will get written later)
 				entry.init(id, time(NULL));
 				// Update Header
@@ -1034,21 +1134,10 @@ S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create
 				llassert_always(bytes_written == sizeof(Entry));
 				mHeaderEntriesMaxWriteIdx = llmax(mHeaderEntriesMaxWriteIdx, idx);
 				closeHeaderEntriesFile();
+				checkIndexCompaction();
 			}
 		}
 	}
-	else
-	{
-		// Remove this entry from the LRU if it exists
-		mLRU.erase(id);
-		// Read the entry
-		S32 offset = sizeof(EntriesInfo) + idx * sizeof(Entry);
-		LLAPRFile* aprfile = openHeaderEntriesFile(true, offset);
-		S32 bytes_read = aprfile->read((void*)&entry, (S32)sizeof(Entry));
-		llassert_always(bytes_read == sizeof(Entry));
-		llassert_always(entry.mImageSize == 0 || entry.mImageSize == -1 || entry.mImageSize > entry.mBodySize);
-		closeHeaderEntriesFile();
-	}
 	return idx;
 }
 
@@ -1067,9 +1156,10 @@ void LLTextureCache::writeEntryAndClose(S32 idx, Entry& entry)
 			}
 
 			llassert_always(entry.mImageSize == 0 || entry.mImageSize == -1 || entry.mImageSize > entry.mBodySize);
-			if (entry.mBodySize > 0)
+			if (entry.mImageSize >= 0)
 			{
-				mTexturesSizeMap[entry.mID] = entry.mBodySize;
+				mIndex.set(entry.mID, idx, entry.mBodySize);
+				checkIndexCompaction();
 			}
 // 			llinfos << "Updating TE: " << idx << ": " << id << " Size: " << entry.mBodySize << " Time: " << entry.mTime << llendl;
 			S32 offset = sizeof(EntriesInfo) + idx * sizeof(Entry);
@@ -1086,10 +1176,14 @@ U32 LLTextureCache::openAndReadEntries(std::vector<Entry>& entries)
 {
 	U32 num_entries = mHeaderEntriesInfo.mEntries;
 
-	mHeaderIDMap.clear();
-	mTexturesSizeMap.clear();
-	mFreeList.clear();
-	mTexturesSizeTotal = 0;
+	// An open index only needs the entries that disagree with it, rebuilding
+	// it would rewrite the whole index on every scan.
+	bool rebuild = !mIndex.isOpen();
+	if (rebuild)
+	{
+		mIndex.beginRebuild();
+	}
+	mBodyStore.beginLoading();
 
 	LLAPRFile* aprfile = openHeaderEntriesFile(false, (S32)sizeof(EntriesInfo));
 	for (U32 idx=0; idx<num_entries; idx++)
@@ -1103,24 +1197,30 @@ U32 LLTextureCache::openAndReadEntries(std::vector<Entry>& entries)
 			purgeAllTextures(false);
 			return 0;
 		}
+		if (entry.mImageSize >= 0 && entry.mBodySize > 0 &&
+			!mBodyStore.addExisting(entry.mID, entry.mBodyBlock, entry.mBodySize))
+		{
+			llwarns << "Bad body extent: " << idx << ": " << entry.mID << llendl;
+			entry.mBodySize = 0;
+		}
 		entries.push_back(entry);
 // 		llinfos << "ENTRY: " << entry.mTime << " TEX: " << entry.mID << " IDX: " << idx << " Size: " << entry.mImageSize << llendl;
 		if (entry.mImageSize < 0)
 		{
-			mFreeList.insert(idx);
+			mIndex.addFreeEntry(idx);
 		}
 		else
 		{
-			mHeaderIDMap[entry.mID] = idx;
-			if (entry.mBodySize > 0)
-			{
-				mTexturesSizeMap[entry.mID] = entry.mBodySize;
-				mTexturesSizeTotal += entry.mBodySize;
-			}
+			mIndex.set(entry.mID, idx, entry.mBodySize);
 			llassert_always(entry.mImageSize == 0 || entry.mImageSize > entry.mBodySize);
 		}
 	}
 	closeHeaderEntriesFile();
+	mBodyStore.finishLoading();
+	if (rebuild)
+	{
+		mIndex.endRebuild();
+	}
 	return num_entries;
 }
 
@@ -1276,11 +1376,8 @@ void LLTextureCache::purgeAllTextures(bool purge_directories)
 			LLFile::rmdir(mTexturesDirName);
 		}
 	}
-	mHeaderIDMap.clear();
-	mTexturesSizeMap.clear();
-	mTexturesSizeTotal = 0;
-	mFreeList.clear();
-	mTexturesSizeTotal = 0;
+	mBodyStore.clear();
+	mIndex.clear();
 
 	// Info with 0 entries
 	mHeaderEntriesInfo.mVersion = sHeaderCacheVersion;
@@ -1288,7 +1385,8 @@ void LLTextureCache::purgeAllTextures(bool purge_directories)
 	writeEntriesHeader();
 }
 
-void LLTextureCache::purgeTextures(bool validate)
+// May run on the cache thread: must not touch gSavedSettings.
+void LLTextureCache::purgeTextures(bool validate, U32 validate_idx)
 {
 	if (mReadOnly)
 	{
@@ -1300,7 +1398,48 @@ void LLTextureCache::purgeTextures(bool validate)
 		// *FIX:Mani - watchdog off.
 		LLAppViewer::instance()->pauseMainloopTimeout();
 	}
-	
+
+	// Validate the entries whose first id byte is validate_idx.  The bodies
+	// are read without mHeaderMutex so lookups are not held up by the
+	// validation I/O; entries that changed meanwhile are left alone below.
+	std::map<LLUUID, S32> bad_bodies;
+	if (validate)
+	{
+		LL_DEBUGS("TextureCache") << "TEXTURE CACHE: Validating: " << validate_idx << LL_ENDL;
+
+		std::vector<std::pair<LLUUID, S32> > to_validate;
+		{
+			LLMutexLock lock(&mHeaderMutex);
+			std::vector<Entry> entries;
+			U32 num_entries = openAndReadEntries(entries);
+			for (U32 idx = 0; idx < num_entries; ++idx)
+			{
+				const Entry& entry = entries[idx];
+				S32 bodysize;
+				if (entry.mImageSize >= 0 && entry.mBodySize > 0 &&
+					entry.mID.mData[0] == validate_idx &&
+					mIndex.find(entry.mID, bodysize) == (S32)idx)
+				{
+					to_validate.push_back(std::make_pair(entry.mID, entry.mBodySize));
+				}
+			}
+		}
+		for (std::vector<std::pair<LLUUID, S32> >::iterator iter = to_validate.begin();
+			 iter != to_validate.end(); ++iter)
+		{
+			const LLUUID& id = iter->first;
+			LL_DEBUGS("TextureCache") << "Validating: " << id << "Size: " << iter->second << LL_ENDL;
+			// make sure the body is in the store and is the correct size
+			S32 bodysize = mBodyStore.getStoredSize(id);
+			if (bodysize != iter->second)
+			{
+				LL_WARNS("TextureCache") << "TEXTURE CACHE BODY HAS BAD SIZE: " << bodysize << " != " << iter->second
+						<< id << LL_ENDL;
+				bad_bodies[id] = iter->second;
+			}
+		}
+	}
+
 	LLMutexLock lock(&mHeaderMutex);
 
 	llinfos << "TEXTURE CACHE: Purging." << llendl;
@@ -1314,35 +1453,21 @@ void LLTextureCache::purgeTextures(bool validate)
 		return; // nothing to purge
 	}
 	
-	// Use mTexturesSizeMap to collect UUIDs of textures with bodies
+	// Collect the entries of textures with bodies
 	typedef std::set<std::pair<U32,S32> > time_idx_set_t;
 	std::set<std::pair<U32,S32> > time_idx_set;
-	for (size_map_t::iterator iter1 = mTexturesSizeMap.begin();
-		 iter1 != mTexturesSizeMap.end(); ++iter1)
+	for (S32 idx = 0; idx < (S32)num_entries; ++idx)
 	{
-		if (iter1->second > 0)
+		S32 bodysize;
+		if (entries[idx].mImageSize >= 0 && entries[idx].mBodySize > 0 &&
+			mIndex.find(entries[idx].mID, bodysize) == idx)
 		{
-			id_map_t::iterator iter2 = mHeaderIDMap.find(iter1->first);
-			if (iter2 != mHeaderIDMap.end())
-			{
-				S32 idx = iter2->second;
-				time_idx_set.insert(std::make_pair(entries[idx].mTime, idx));
-// 				llinfos << "TIME: " << entries[idx].mTime << " TEX: " << entries[idx].mID << " IDX: " << idx << " Size: " << entries[idx].mImageSize << llendl;
-			}
+			time_idx_set.insert(std::make_pair(entries[idx].mTime, idx));
+// 			llinfos << "TIME: " << entries[idx].mTime << " TEX: " << entries[idx].mID << " IDX: " << idx << " Size: " << entries[idx].mImageSize << llendl;
 		}
 	}
 	
-	// Validate 1/256th of the files on startup
-	U32 validate_idx = 0;
-	if (validate)
-	{
-		validate_idx = gSavedSettings.getU32("CacheValidateCounter");
-		U32 next_idx = (validate_idx + 1) % 256;
-		gSavedSettings.setU32("CacheValidateCounter", next_idx);
-		LL_DEBUGS("TextureCache") << "TEXTURE CACHE: Validating: " << validate_idx << LL_ENDL;
-	}
-
-	S64 cache_size = mTexturesSizeTotal;
+	S64 cache_size = mIndex.getBodySizeTotal();
 	S64 purged_cache_size = (sCacheMaxTexturesSize * (S64)((1.f-TEXTURE_CACHE_PURGE_AMOUNT)*100)) / 100;
 	S32 purge_count = 0;
 	for (time_idx_set_t::iterator iter = time_idx_set.begin();
@@ -1350,25 +1475,18 @@ void LLTextureCache::purgeTextures(bool validate)
 	{
 		S32 idx = iter->second;
 		bool purge_entry = false;
-		std::string filename = getTextureFileName(entries[idx].mID);
+		const LLUUID& id = entries[idx].mID;
 		if (cache_size >= purged_cache_size)
 		{
 			purge_entry = true;
 		}
 		else if (validate)
 		{
-			// make sure file exists and is the correct size
-			S32 uuididx = entries[idx].mID.mData[0];
-			if (uuididx == validate_idx)
+			// only if the body is still the one that failed validation
+			std::map<LLUUID, S32>::iterator bad_iter = bad_bodies.find(id);
+			if (bad_iter != bad_bodies.end() && bad_iter->second == entries[idx].mBodySize)
 			{
- 				LL_DEBUGS("TextureCache") << "Validating: " << filename << "Size: " << entries[idx].mBodySize << LL_ENDL;
-				S32 bodysize = LLAPRFile::size(filename);
-				if (bodysize != entries[idx].mBodySize)
-				{
-					LL_WARNS("TextureCache") << "TEXTURE CACHE BODY HAS BAD SIZE: " << bodysize << " != " << entries[idx].mBodySize
-							<< filename << LL_ENDL;
-					purge_entry = true;
-				}
+				purge_entry = true;
 			}
 		}
 		else
@@ -1379,20 +1497,11 @@ void LLTextureCache::purgeTextures(bool validate)
 		if (purge_entry)
 		{
 			purge_count++;
-	 		LL_DEBUGS("TextureCache") << "PURGING: " << filename << LL_ENDL;
-			if (entries[idx].mBodySize > 0)
-			{
-				LLAPRFile::remove(filename);
-			}
-			else if (LLAPRFile::isExist(filename))	// Sanity check. Shouldn't exist.
-			{
-				LL_WARNS("TextureCache") << "Entry has zero body size but existing " << filename << ". Deleting file too..." << LL_ENDL;
-				LLAPRFile::remove(filename);
-			}
+	 		LL_DEBUGS("TextureCache") << "PURGING: " << id << LL_ENDL;
+			mBodyStore.remove(id);
 			cache_size -= entries[idx].mBodySize;
-			mTexturesSizeTotal -= entries[idx].mBodySize;
 			entries[idx].mBodySize = 0;
-			mTexturesSizeMap.erase(entries[idx].mID);
+			mIndex.set(id, idx, 0);
 		}
 	}
 
@@ -1409,7 +1518,7 @@ void LLTextureCache::purgeTextures(bool validate)
 	LL_INFOS("TextureCache") << "TEXTURE CACHE:"
 			<< " PURGED: " << purge_count
 			<< " ENTRIES: " << num_entries
-			<< " CACHE SIZE: " << mTexturesSizeTotal / 1024*1024 << " MB"
+			<< " CACHE SIZE: " << mIndex.getBodySizeTotal() / 1024*1024 << " MB"
 			<< llendl;
 }
 
@@ -1622,9 +1731,8 @@ bool LLTextureCache::removeHeaderCacheEntry(const LLUUID& id)
 			entry.mImageSize = -1;
 			entry.mBodySize = 0;
 			writeEntryAndClose(idx, entry);
-			mFreeList.insert(idx);
-			mHeaderIDMap.erase(id);
-			mTexturesSizeMap.erase(id);
+			mIndex.remove(id, true);
+			checkIndexCompaction();
 			return true;
 		}
 	}
@@ -1637,7 +1745,7 @@ void LLTextureCache::removeFromCacheLocked(const LLUUID& id)
 	if (!mReadOnly)
 	{
 		removeHeaderCacheEntry(id);
-		LLAPRFile::remove(getTextureFileName(id));
+		mBodyStore.remove(id);
 	}
 }
 
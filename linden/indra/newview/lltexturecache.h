@@ -40,6 +40,9 @@
 
 #include "llworkerthread.h"
 
+#include "lltexturebodystore.h"
+#include "lltexturecacheindex.h"
+
 class LLTextureCacheWorker;
 
 class LLTextureCache : public LLWorkerThread
@@ -60,12 +63,13 @@ private:
 	{
 		Entry() {}
 		Entry(const LLUUID& id, S32 imagesize, S32 bodysize, U32 time) :
-			mID(id), mImageSize(imagesize), mBodySize(bodysize), mTime(time) {}
-		void init(const LLUUID& id, U32 time) { mID = id, mImageSize = 0; mBodySize = 0; mTime = time; }
+			mID(id), mImageSize(imagesize), mBodySize(bodysize), mTime(time), mBodyBlock(0) {}
+		void init(const LLUUID& id, U32 time) { mID = id, mImageSize = 0; mBodySize = 0; mTime = time; mBodyBlock = 0; }
 		LLUUID mID; // 16 bytes
 		S32 mImageSize; // total size of image if known
-		S32 mBodySize; // size of body file in body cache
+		S32 mBodySize; // size of body in body store
 		U32 mTime; // seconds since 1/1/1970
+		U32 mBodyBlock; // first block of body in body store
 	};
 
 	
@@ -127,7 +131,7 @@ public:
 	// debug
 	S32 getNumReads() { return mReaders.size(); }
 	S32 getNumWrites() { return mWriters.size(); }
-	S64 getUsage() { return mTexturesSizeTotal; }
+	S64 getUsage() { return mIndex.getBodySizeTotal(); }
 	S64 getMaxUsage() { return sCacheMaxTexturesSize; }
 	U32 getEntries() { return mHeaderEntriesInfo.mEntries; }
 	U32 getMaxEntries() { return sCacheMaxEntries; };
@@ -136,14 +140,36 @@ protected:
 	// Accessed by LLTextureCacheWorker
 	bool updateTextureEntryList(const LLUUID& id, S32 size);
 	std::string getLocalFileName(const LLUUID& id);
-	std::string getTextureFileName(const LLUUID& id);
+	LLTextureBodyStore& getBodyStore() { return mBodyStore; }
 	void addCompleted(Responder* responder, bool success);
 	
 private:
+	// Index upkeep, run on the cache thread
+	enum e_maintenance
+	{
+		MAINTENANCE_SCAN,		// full entries scan: LRU, body extents, validation and purge
+		MAINTENANCE_COMPACT		// fold the journal into the index
+	};
+	class MaintenanceRequest : public LLQueuedThread::QueuedRequest
+	{
+	public:
+		MaintenanceRequest(LLTextureCache* cache, handle_t handle, e_maintenance type, U32 validate_idx);
+		/*virtual*/ bool processRequest();
+	protected:
+		/*virtual*/ ~MaintenanceRequest() {}
+	private:
+		LLTextureCache* mCache;
+		e_maintenance mType;
+		U32 mValidateIdx;		// CacheValidateCounter, read on the main thread
+	};
+	void scheduleMaintenance(e_maintenance type, U32 validate_idx = 0);
+	void checkIndexCompaction();
+	bool openIndex();
+
 	void setDirNames(ELLPath location);
 	void readHeaderCache();
 	void purgeAllTextures(bool purge_directories);
-	void purgeTextures(bool validate);
+	void purgeTextures(bool validate, U32 validate_idx = 0);
 	LLAPRFile* openHeaderEntriesFile(bool readonly, S32 offset);
 	void closeHeaderEntriesFile();
 	void readEntriesHeader();
@@ -180,16 +206,17 @@ private:
 	std::string mHeaderEntriesFileName;
 	std::string mHeaderDataFileName;
 	EntriesInfo mHeaderEntriesInfo;
-	std::set<S32> mFreeList; // deleted entries
 	std::set<LLUUID> mLRU;
-	typedef std::map<LLUUID,S32> id_map_t;
-	id_map_t mHeaderIDMap;
+	// id -> entry, body sizes and free entries
+	LLTextureCacheIndex mIndex;
+	std::string mIndexFileName;
+	std::string mJournalFileName;
+	LLAtomic32<BOOL> mCompactPending;
 
 	// BODIES (TEXTURES minus headers)
-	std::string mTexturesDirName;
-	typedef std::map<LLUUID,S32> size_map_t;
-	size_map_t mTexturesSizeMap;
-	S64 mTexturesSizeTotal;
+	std::string mTexturesDirName; // legacy per-texture body files, purged
+	std::string mBodyStoreFileName;
+	LLTextureBodyStore mBodyStore;
 	LLAtomic32<BOOL> mDoPurge;
 
 	// Statics
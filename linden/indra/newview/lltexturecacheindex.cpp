@@ -0,0 +1,554 @@
+/** 
+ * @file lltexturecacheindex.cpp
+ * @brief Mapped texture cache index with an update journal.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ * 
+ * Copyright (c) 2009, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "lltexturecacheindex.h"
+
+#if LL_WINDOWS
+#include <io.h>
+#else
+#include <sys/mman.h>
+#endif
+
+#include "llfile.h"
+
+static const U32 INDEX_MAGIC = 0x58494354; // "TCIX"
+static const U32 INDEX_VERSION = 1;
+static const U32 MIN_INDEX_CAPACITY = 1024;
+// compact() once this many ids have changed since the index was written
+static const U32 MIN_COMPACT_RECORDS = 4096;
+
+LLTextureCacheIndex::LLTextureCacheIndex()
+	: mReadOnly(false),
+	  mRebuilding(false),
+	  mMappedData(NULL),
+	  mMappedSize(0),
+	  mMappingHandle(NULL),
+	  mHeader(NULL),
+	  mSlots(NULL),
+	  mSerial(0),
+	  mNumIDs(0),
+	  mBodySizeTotal(0),
+	  mJournalFP(NULL)
+{
+}
+
+LLTextureCacheIndex::~LLTextureCacheIndex()
+{
+	close();
+}
+
+void LLTextureCacheIndex::setFileNames(const std::string& index_filename, const std::string& journal_filename, bool read_only)
+{
+	mIndexFileName = index_filename;
+	mJournalFileName = journal_filename;
+	mReadOnly = read_only;
+}
+
+bool LLTextureCacheIndex::open()
+{
+	close();
+	mapIndex();
+	if (!mHeader)
+	{
+		return false;
+	}
+	mSerial = mHeader->mSerial;
+	mNumIDs = mHeader->mNumIDs;
+	mBodySizeTotal = mHeader->mBodySizeTotal;
+	const S32* free_list = (const S32*)(mSlots + mHeader->mCapacity);
+	for (U32 i = 0; i < mHeader->mNumFree; i++)
+	{
+		mFreeEntries.insert(free_list[i]);
+	}
+
+	// Replay the journal
+	LLFILE* fp = LLFile::fopen(mJournalFileName, "rb");
+	if (!fp)
+	{
+		llwarns << "Missing texture cache journal" << llendl;
+		close();
+		return false;
+	}
+	U32 serial = 0;
+	bool ok = fread(&serial, sizeof(serial), 1, fp) == 1 && serial == mSerial;
+	JournalRecord record;
+	U32 records = 0;
+	while (ok && fread(&record, sizeof(record), 1, fp) == 1)
+	{
+		// A partial record at the end is what's left of a crash, ignore it
+		apply(record);
+		records++;
+	}
+	fclose(fp);
+	if (!ok)
+	{
+		llwarns << "Texture cache journal does not match the index" << llendl;
+		close();
+		return false;
+	}
+
+	if (!mReadOnly && !openJournal(false))
+	{
+		close();
+		return false;
+	}
+	LL_INFOS("TextureCache") << "Texture cache index: " << mNumIDs << " textures, "
+							 << records << " journal records" << LL_ENDL;
+	return true;
+}
+
+void LLTextureCacheIndex::close()
+{
+	if (mJournalFP)
+	{
+		fclose(mJournalFP);
+		mJournalFP = NULL;
+	}
+	unmapIndex();
+	mOverlay.clear();
+	mFreeEntries.clear();
+	mNumIDs = 0;
+	mBodySizeTotal = 0;
+	mRebuilding = false;
+}
+
+void LLTextureCacheIndex::clear()
+{
+	close();
+	if (!mReadOnly && !mIndexFileName.empty())
+	{
+		compact();
+	}
+}
+
+//----------------------------------------------------------------------------
+
+void LLTextureCacheIndex::beginRebuild()
+{
+	if (mJournalFP)
+	{
+		fclose(mJournalFP);
+		mJournalFP = NULL;
+	}
+	unmapIndex();
+	mOverlay.clear();
+	mFreeEntries.clear();
+	mNumIDs = 0;
+	mBodySizeTotal = 0;
+	mRebuilding = true;
+}
+
+void LLTextureCacheIndex::endRebuild()
+{
+	mRebuilding = false;
+	if (!mReadOnly)
+	{
+		compact();
+	}
+}
+
+S32 LLTextureCacheIndex::find(const LLUUID& id, S32& bodysize) const
+{
+	bodysize = 0;
+	overlay_map_t::const_iterator iter = mOverlay.find(id);
+	if (iter != mOverlay.end())
+	{
+		if (iter->second.mIdx >= 0)
+		{
+			bodysize = iter->second.mBodySize;
+		}
+		return iter->second.mIdx;
+	}
+	const Slot* slot = findMapped(id);
+	if (slot)
+	{
+		bodysize = slot->mBodySize;
+		return slot->mIdx;
+	}
+	return -1;
+}
+
+void LLTextureCacheIndex::set(const LLUUID& id, S32 idx, S32 bodysize)
+{
+	S32 cur_bodysize;
+	if (find(id, cur_bodysize) == idx && cur_bodysize == bodysize)
+	{
+		return; // timestamp only update
+	}
+	JournalRecord record;
+	record.mID = id;
+	record.mIdx = idx;
+	record.mBodySize = bodysize;
+	record.mFreeIdx = -1;
+	apply(record);
+	appendJournal(record);
+}
+
+void LLTextureCacheIndex::remove(const LLUUID& id, bool free_idx)
+{
+	S32 bodysize;
+	S32 idx = find(id, bodysize);
+	if (idx < 0)
+	{
+		return;
+	}
+	JournalRecord record;
+	record.mID = id;
+	record.mIdx = -1;
+	record.mBodySize = 0;
+	record.mFreeIdx = free_idx ? idx : -1;
+	apply(record);
+	appendJournal(record);
+}
+
+void LLTextureCacheIndex::addFreeEntry(S32 idx)
+{
+	if (mFreeEntries.insert(idx).second)
+	{
+		JournalRecord record;
+		record.mID.setNull();
+		record.mIdx = -1;
+		record.mBodySize = 0;
+		record.mFreeIdx = idx;
+		appendJournal(record);
+	}
+}
+
+S32 LLTextureCacheIndex::popFreeEntry()
+{
+	if (mFreeEntries.empty())
+	{
+		return -1;
+	}
+	// Journaled by the set() that uses it
+	S32 idx = *mFreeEntries.begin();
+	mFreeEntries.erase(mFreeEntries.begin());
+	return idx;
+}
+
+//----------------------------------------------------------------------------
+
+bool LLTextureCacheIndex::needsCompaction() const
+{
+	return mJournalFP && !mRebuilding && mOverlay.size() >= llmax(MIN_COMPACT_RECORDS, mNumIDs / 4);
+}
+
+bool LLTextureCacheIndex::compact()
+{
+	if (mReadOnly)
+	{
+		return false;
+	}
+
+	U32 capacity = MIN_INDEX_CAPACITY;
+	while (capacity < mNumIDs * 2)
+	{
+		capacity <<= 1;
+	}
+
+	std::vector<Slot> slots(capacity);
+	for (U32 i = 0; i < capacity; i++)
+	{
+		slots[i].mIdx = -1;
+		slots[i].mBodySize = 0;
+	}
+	U32 num_ids = 0;
+	S64 total = 0;
+	// Collect the ids of the old index that did not change, then the changed ones
+	for (U32 pass = 0; pass < 2; pass++)
+	{
+		U32 old_capacity = pass == 0 && mHeader ? mHeader->mCapacity : 0;
+		overlay_map_t::iterator overlay_iter = mOverlay.begin();
+		for (U32 i = 0; ; i++)
+		{
+			const Slot* src;
+			if (pass == 0)
+			{
+				if (i >= old_capacity)
+					break;
+				src = &mSlots[i];
+				if (src->mIdx < 0 || mOverlay.find(src->mID) != mOverlay.end())
+					continue;
+			}
+			else
+			{
+				if (overlay_iter == mOverlay.end())
+					break;
+				src = &(overlay_iter++)->second;
+				if (src->mIdx < 0)
+					continue;
+			}
+			U32 h = hashID(src->mID) & (capacity - 1);
+			while (slots[h].mIdx >= 0)
+			{
+				h = (h + 1) & (capacity - 1);
+			}
+			slots[h] = *src;
+			num_ids++;
+			total += src->mBodySize;
+		}
+	}
+	llassert(num_ids == mNumIDs);
+
+	Header header;
+	header.mMagic = INDEX_MAGIC;
+	header.mVersion = INDEX_VERSION;
+	header.mSerial = mSerial + 1;
+	header.mCapacity = capacity;
+	header.mNumIDs = num_ids;
+	header.mNumFree = (U32)mFreeEntries.size();
+	header.mBodySizeTotal = total;
+	std::vector<S32> free_list(mFreeEntries.begin(), mFreeEntries.end());
+
+	std::string tmp_filename = mIndexFileName + ".tmp";
+	LLFILE* fp = LLFile::fopen(tmp_filename, "wb");
+	if (!fp)
+	{
+		llwarns << "Unable to write " << tmp_filename << llendl;
+		return false;
+	}
+	bool ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+	ok = ok && fwrite(&slots[0], sizeof(Slot), capacity, fp) == capacity;
+	ok = ok && (free_list.empty() || fwrite(&free_list[0], sizeof(S32), free_list.size(), fp) == free_list.size());
+	ok = (fclose(fp) == 0) && ok;
+	if (!ok)
+	{
+		llwarns << "Unable to write " << tmp_filename << llendl;
+		LLFile::remove(tmp_filename);
+		return false;
+	}
+
+	// Swap in the new index.  A crash before the journal is emptied leaves
+	// a serial mismatch, which makes the next startup rebuild the index.
+	unmapIndex();
+	if (mJournalFP)
+	{
+		fclose(mJournalFP);
+		mJournalFP = NULL;
+	}
+	LLFile::remove(mIndexFileName);
+	bool renamed = LLFile::rename(tmp_filename, mIndexFileName) == 0;
+	if (renamed)
+	{
+		mSerial = header.mSerial;
+		openJournal(true);
+		mapIndex();
+	}
+	mOverlay.clear();
+	if (!mHeader)
+	{
+		// Keep everything in memory, the files get rebuilt at the next startup
+		llwarns << "Unable to replace " << mIndexFileName << llendl;
+		LLFile::remove(tmp_filename);
+		if (mJournalFP)
+		{
+			fclose(mJournalFP);
+			mJournalFP = NULL;
+		}
+		for (U32 i = 0; i < capacity; i++)
+		{
+			if (slots[i].mIdx >= 0)
+			{
+				mOverlay[slots[i].mID] = slots[i];
+			}
+		}
+		return false;
+	}
+	return true;
+}
+
+//----------------------------------------------------------------------------
+
+// static
+U32 LLTextureCacheIndex::hashID(const LLUUID& id)
+{
+	// Texture ids are random, any 4 bytes will do
+	U32 h;
+	memcpy(&h, id.mData, sizeof(h));
+	return h;
+}
+
+const LLTextureCacheIndex::Slot* LLTextureCacheIndex::findMapped(const LLUUID& id) const
+{
+	if (!mHeader)
+	{
+		return NULL;
+	}
+	U32 mask = mHeader->mCapacity - 1;
+	for (U32 h = hashID(id) & mask; ; h = (h + 1) & mask)
+	{
+		const Slot& slot = mSlots[h];
+		if (slot.mIdx < 0)
+		{
+			return NULL;
+		}
+		if (slot.mID == id)
+		{
+			return &slot;
+		}
+	}
+}
+
+void LLTextureCacheIndex::apply(const JournalRecord& record)
+{
+	if (record.mID.notNull())
+	{
+		S32 old_bodysize;
+		S32 old_idx = find(record.mID, old_bodysize);
+		if (old_idx >= 0)
+		{
+			mNumIDs--;
+			mBodySizeTotal -= old_bodysize;
+		}
+		Slot& slot = mOverlay[record.mID];
+		slot.mID = record.mID;
+		slot.mIdx = record.mIdx;
+		slot.mBodySize = record.mIdx >= 0 ? record.mBodySize : 0;
+		if (record.mIdx >= 0)
+		{
+			mNumIDs++;
+			mBodySizeTotal += record.mBodySize;
+			mFreeEntries.erase(record.mIdx);
+		}
+	}
+	if (record.mFreeIdx >= 0)
+	{
+		mFreeEntries.insert(record.mFreeIdx);
+	}
+}
+
+void LLTextureCacheIndex::appendJournal(const JournalRecord& record)
+{
+	if (mJournalFP && !mRebuilding)
+	{
+		fwrite(&record, sizeof(record), 1, mJournalFP);
+		// No fsync: losing the tail of the journal only loses cache entries
+		fflush(mJournalFP);
+	}
+}
+
+bool LLTextureCacheIndex::openJournal(bool truncate)
+{
+	mJournalFP = LLFile::fopen(mJournalFileName, truncate ? "wb" : "ab");
+	if (!mJournalFP)
+	{
+		llwarns << "Unable to open " << mJournalFileName << llendl;
+		return false;
+	}
+	if (truncate)
+	{
+		fwrite(&mSerial, sizeof(mSerial), 1, mJournalFP);
+		fflush(mJournalFP);
+	}
+	return true;
+}
+
+void LLTextureCacheIndex::mapIndex()
+{
+	unmapIndex();
+	LLFILE* fp = LLFile::fopen(mIndexFileName, "rb");
+	if (!fp)
+	{
+		return;
+	}
+	fseek(fp, 0, SEEK_END);
+	long size = ftell(fp);
+	if (size < (long)sizeof(Header))
+	{
+		fclose(fp);
+		return;
+	}
+#if LL_WINDOWS
+	HANDLE file = (HANDLE)_get_osfhandle(_fileno(fp));
+	HANDLE mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping)
+	{
+		void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, size);
+		if (view)
+		{
+			mMappingHandle = mapping;
+			mMappedData = (const U8*)view;
+		}
+		else
+		{
+			CloseHandle(mapping);
+		}
+	}
+#else
+	void* view = mmap(NULL, size, PROT_READ, MAP_SHARED, fileno(fp), 0);
+	if (view != MAP_FAILED)
+	{
+		mMappedData = (const U8*)view;
+	}
+#endif
+	// The mapping stays valid after the file is closed
+	fclose(fp);
+	if (!mMappedData)
+	{
+		llwarns << "Unable to map " << mIndexFileName << llendl;
+		return;
+	}
+	mMappedSize = (U32)size;
+
+	const Header* header = (const Header*)mMappedData;
+	if (header->mMagic != INDEX_MAGIC || header->mVersion != INDEX_VERSION ||
+		header->mCapacity < MIN_INDEX_CAPACITY || (header->mCapacity & (header->mCapacity - 1)) ||
+		(U64)mMappedSize != sizeof(Header) + (U64)header->mCapacity * sizeof(Slot) + (U64)header->mNumFree * sizeof(S32))
+	{
+		llwarns << "Invalid texture cache index" << llendl;
+		unmapIndex();
+		return;
+	}
+	mHeader = header;
+	mSlots = (const Slot*)(mMappedData + sizeof(Header));
+}
+
+void LLTextureCacheIndex::unmapIndex()
+{
+	mHeader = NULL;
+	mSlots = NULL;
+	if (!mMappedData)
+	{
+		return;
+	}
+#if LL_WINDOWS
+	UnmapViewOfFile(mMappedData);
+	CloseHandle((HANDLE)mMappingHandle);
+	mMappingHandle = NULL;
+#else
+	munmap((void*)mMappedData, mMappedSize);
+#endif
+	mMappedData = NULL;
+	mMappedSize = 0;
+}
@@ -0,0 +1,151 @@
+/** 
+ * @file lltexturecacheindex.h
+ * @brief Mapped texture cache index with an update journal.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ * 
+ * Copyright (c) 2009, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLTEXTURECACHEINDEX_H
+#define LL_LLTEXTURECACHEINDEX_H
+
+#include <map>
+#include <set>
+
+#include "lluuid.h"
+
+// Maps texture ids to their slot in texture.entries without parsing the
+// entries file at startup.
+//
+// texture.index is an open addressing hash table (plus the list of free
+// entry slots) that is memory mapped and searched in place.  It is never
+// modified once written; updates are kept in memory and appended to
+// texture.journal, and compact() folds them into a new index.  Loading is
+// therefore proportional to the size of the journal, not of the cache.
+//
+// Not thread safe, LLTextureCache calls it with mHeaderMutex locked.
+class LLTextureCacheIndex
+{
+public:
+	LLTextureCacheIndex();
+	~LLTextureCacheIndex();
+
+	void setFileNames(const std::string& index_filename, const std::string& journal_filename, bool read_only);
+
+	// Maps the index and replays the journal. Returns false if they are missing or
+	// don't match, in which case the caller must rebuild the index from the entries.
+	bool open();
+	void close();
+	// Empties the index and writes it out
+	void clear();
+	// True while an index file is mapped, i.e. no rebuild is needed
+	bool isOpen() const { return mHeader != NULL; }
+
+	// Full rebuild: call set() and addFreeEntry() for every entry, then endRebuild().
+	// When the index is open, calling set() and addFreeEntry() without a rebuild
+	// only journals the entries that disagree with it.
+	void beginRebuild();
+	void endRebuild();
+
+	// Returns the entry slot of id or -1. bodysize is set to the size of its body.
+	S32 find(const LLUUID& id, S32& bodysize) const;
+	void set(const LLUUID& id, S32 idx, S32 bodysize);
+	// free_idx: put the entry slot of id on the free list
+	void remove(const LLUUID& id, bool free_idx);
+
+	void addFreeEntry(S32 idx);
+	// Returns a free entry slot or -1
+	S32 popFreeEntry();
+
+	S64 getBodySizeTotal() const { return mBodySizeTotal; }
+	U32 getNumIDs() const { return mNumIDs; }
+	U32 getJournalSize() const { return (U32)mOverlay.size(); }
+
+	// True when enough updates are journaled for compact() to be worth it
+	bool needsCompaction() const;
+	// Writes a new index from the current state and empties the journal
+	bool compact();
+
+private:
+	struct Slot
+	{
+		LLUUID mID;
+		S32 mIdx; // -1: removed (overlay) or empty (index)
+		S32 mBodySize;
+	};
+	struct JournalRecord
+	{
+		LLUUID mID;
+		S32 mIdx; // -1: removed
+		S32 mBodySize;
+		S32 mFreeIdx; // entry slot put on the free list, or -1
+	};
+	struct Header
+	{
+		U32 mMagic;
+		U32 mVersion;
+		U32 mSerial; // must match the journal
+		U32 mCapacity; // hash slots, power of 2
+		U32 mNumIDs;
+		U32 mNumFree;
+		S64 mBodySizeTotal;
+	};
+
+	const Slot* findMapped(const LLUUID& id) const;
+	void apply(const JournalRecord& record);
+	void appendJournal(const JournalRecord& record);
+	bool openJournal(bool truncate);
+	void mapIndex();
+	void unmapIndex();
+
+	static U32 hashID(const LLUUID& id);
+
+private:
+	std::string mIndexFileName;
+	std::string mJournalFileName;
+	bool mReadOnly;
+	bool mRebuilding;
+
+	// Mapped index
+	const U8* mMappedData;
+	U32 mMappedSize;
+	void* mMappingHandle;
+	const Header* mHeader;
+	const Slot* mSlots;
+
+	// Changes since the index was written, removals included
+	typedef std::map<LLUUID, Slot> overlay_map_t;
+	overlay_map_t mOverlay;
+	std::set<S32> mFreeEntries;
+	U32 mSerial;
+	U32 mNumIDs;
+	S64 mBodySizeTotal;
+
+	LLFILE* mJournalFP;
+};
+
+#endif // LL_LLTEXTURECACHEINDEX_H
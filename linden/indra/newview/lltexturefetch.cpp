@@ -72,13 +72,13 @@ private:
 		}
 		virtual void completed(bool success)
 		{
-			mFetcher->lockQueue();
+			mFetcher->lockQueue(mID);
 			LLTextureFetchWorker* worker = mFetcher->getWorker(mID);
 			if (worker)
 			{
  				worker->callbackCacheRead(success, mFormattedImage, mImageSize, mImageLocal);
 			}
-			mFetcher->unlockQueue();
+			mFetcher->unlockQueue(mID);
 		}
 	private:
 		LLTextureFetch* mFetcher;
@@ -94,13 +94,13 @@ private:
 		}
 		virtual void completed(bool success)
 		{
-			mFetcher->lockQueue();
+			mFetcher->lockQueue(mID);
 			LLTextureFetchWorker* worker = mFetcher->getWorker(mID);
 			if (worker)
 			{
 				worker->callbackCacheWrite(success);
 			}
-			mFetcher->unlockQueue();
+			mFetcher->unlockQueue(mID);
 		}
 	private:
 		LLTextureFetch* mFetcher;
@@ -116,13 +116,13 @@ private:
 		}
 		virtual void completed(bool success, LLImageRaw* raw, LLImageRaw* aux)
 		{
-			mFetcher->lockQueue();
+			mFetcher->lockQueue(mID);
 			LLTextureFetchWorker* worker = mFetcher->getWorker(mID);
 			if (worker)
 			{
  				worker->callbackDecoded(success, raw, aux);
 			}
-			mFetcher->unlockQueue();
+			mFetcher->unlockQueue(mID);
 		}
 	private:
 		LLTextureFetch* mFetcher;
@@ -267,6 +267,7 @@ private:
 	bool mCanUseHTTP ;
 	bool mCanUseNET ; //can get from asset server.
 	S32 mHTTPFailCount;
+	bool mSampleNeed; // Tell mHTTPRangeEstimator what the texture needs once it is known
 	S32 mRetryAttempt;
 	S32 mActiveCount;
 	U32 mGetStatus;
@@ -318,7 +319,7 @@ public:
 		}
 
 		LL_DEBUGS("TextureFetch") << "HTTP COMPLETE: " << mID << " with status: " << status << LL_ENDL;
-		mFetcher->lockQueue();
+		mFetcher->lockQueue(mID);
 		LLTextureFetchWorker* worker = mFetcher->getWorker(mID);
 		if (worker)
 		{
@@ -332,6 +333,9 @@ public:
 				{
 					partial = true;
 				}
+				S32 data_size = buffer->countAfter(channels.in(), NULL);
+				F64 seconds = (F64)(LLTimer::getTotalTime() - mStartTime) / 1000000.0;
+				mFetcher->mHTTPRangeEstimator.addTransfer(data_size, seconds);
 			}
 			else if (status == HTTP_REQUESTED_RANGE_NOT_SATISFIABLE)
 			{
@@ -352,7 +356,7 @@ public:
 			mFetcher->removeFromHTTPQueue(mID);
  			llwarns << "Worker not found: " << mID << llendl;
 		}
-		mFetcher->unlockQueue();
+		mFetcher->unlockQueue(mID);
 	}
 	
 private:
@@ -425,6 +429,7 @@ LLTextureFetchWorker::LLTextureFetchWorker(LLTextureFetch* fetcher,
 	  mInLocalCache(FALSE),
 	  mCanUseHTTP(can_use_http),
 	  mHTTPFailCount(0),
+	  mSampleNeed(false),
 	  mRetryAttempt(0),
 	  mActiveCount(0),
 	  mGetStatus(0),
@@ -655,6 +660,21 @@ bool LLTextureFetchWorker::doWork(S32 param)
 			U32 cache_priority = mWorkPriority;
 			S32 offset = mFormattedImage.notNull() ? mFormattedImage->getDataSize() : 0;
 			S32 size = mDesiredSize - offset;
+			if (mSampleNeed && offset > 0 && mDesiredSize != FIRST_PACKET_SIZE)
+			{
+				// The size is known now, so this is what the texture needs;
+				// a whole image needs all of it, which may still be coming.
+				if (mDesiredSize < MAX_IMAGE_DATA_SIZE)
+				{
+					mFetcher->mHTTPRangeEstimator.addNeed(mDesiredSize);
+					mSampleNeed = false;
+				}
+				else if (mFormattedImage->getDiscardLevel() == 0)
+				{
+					mFetcher->mHTTPRangeEstimator.addNeed(offset);
+					mSampleNeed = false;
+				}
+			}
 			if (size <= 0)
 			{
 				mState = CACHE_POST;
@@ -846,14 +866,14 @@ bool LLTextureFetchWorker::doWork(S32 param)
 	{
 		if(mCanUseHTTP)
 		{
-			const S32 HTTP_QUEUE_MAX_SIZE = 8;
 			// *TODO: Integrate this with llviewerthrottle
 			// Note: LLViewerThrottle uses dynamic throttling which makes sense for UDP,
 			// but probably not for Textures.
 			// Set the throttle to the entire bandwidth, assuming UDP packets will get priority
 			// when they are needed
 			F32 max_bandwidth = mFetcher->mMaxBandwidth;
-			if ((mFetcher->getNumHTTPRequests() >= HTTP_QUEUE_MAX_SIZE) ||
+			if ((mFetcher->getNumHTTPRequests() >= mFetcher->mMaxHTTPRequests) ||
+				(mFetcher->mCurlGetRequest->getHostActive(mUrl) >= mFetcher->mHTTPHostConnections) ||
 				(mFetcher->getTextureBandwidth() > max_bandwidth))
 			{
 				// Make normal priority and return (i.e. wait until there is room in the queue)
@@ -876,6 +896,13 @@ bool LLTextureFetchWorker::doWork(S32 param)
 
 			mRequestedSize = mDesiredSize;
 			mRequestedDiscard = mDesiredDiscard;
+			if (cur_size == 0 && mDesiredSize == FIRST_PACKET_SIZE && mFetcher->mHTTPAdaptiveRange)
+			{
+				// Rather than just the header, ask for as much as textures
+				// have been needing, so most are done in one request.
+				mRequestedSize = llmax(mRequestedSize, mFetcher->mHTTPRangeEstimator.getFirstRange());
+				mSampleNeed = true;
+			}
 			mRequestedSize -= cur_size;
 // 			F32 priority = mImagePriority / (F32)LLViewerImage::maxDecodePriority(); // 0-1
 			S32 offset = cur_size;
@@ -1010,6 +1037,11 @@ bool LLTextureFetchWorker::doWork(S32 param)
 			if (mHaveAllData && mRequestedDiscard == 0) //the image file is fully loaded.
 			{
 				mFileSize = mBufferSize;
+				if (mSampleNeed && mDesiredSize >= MAX_IMAGE_DATA_SIZE)
+				{
+					mFetcher->mHTTPRangeEstimator.addNeed(mBufferSize);
+					mSampleNeed = false;
+				}
 			}
 			else //the file size is unknown.
 			{
@@ -1537,6 +1569,9 @@ bool LLTextureFetchWorker::writeToCacheComplete()
 //////////////////////////////////////////////////////////////////////////////
 // public
 
+// The first HTTP range never goes past this, however fast the network is.
+static const S32 HTTP_MAX_FIRST_RANGE = 128 * 1024;
+
 LLTextureFetch::LLTextureFetch(LLTextureCache* cache, LLImageDecodeThread* imagedecodethread, bool threaded)
 	: LLWorkerThread("TextureFetch", threaded),
 	  mDebugCount(0),
@@ -1546,9 +1581,15 @@ LLTextureFetch::LLTextureFetch(LLTextureCache* cache, LLImageDecodeThread* image
 	  mTextureCache(cache),
 	  mImageDecodeThread(imagedecodethread),
 	  mTextureBandwidth(0),
-	  mCurlGetRequest(NULL)
+	  mCurlGetRequest(NULL),
+	  mNumRequests(0),
+	  mNumHTTPRequests(0),
+	  mHTTPRangeEstimator(FIRST_PACKET_SIZE, HTTP_MAX_FIRST_RANGE)
 {
 	mMaxBandwidth = gSavedSettings.getF32("ThrottleBandwidthKBPS");
+	mMaxHTTPRequests = llmax(1, (S32)gSavedSettings.getU32("ImagePipelineHTTPMaxRequests"));
+	mHTTPHostConnections = llmax(1, (S32)gSavedSettings.getU32("ImagePipelineHTTPHostConnections"));
+	mHTTPAdaptiveRange = gSavedSettings.getBOOL("ImagePipelineHTTPAdaptiveRange");
 	mTextureInfo.setUpLogging(gSavedSettings.getBOOL("LogTextureDownloadsToViewerLog"), gSavedSettings.getBOOL("LogTextureDownloadsToSimulator"), gSavedSettings.getU32("TextureLoggingThreshold"));
 }
 
@@ -1566,9 +1607,10 @@ bool LLTextureFetch::createRequest(const std::string& url, const LLUUID& id, con
 	}
 	
 	LLTextureFetchWorker* worker = NULL;
-	LLMutexLock lock(&mQueueMutex);
-	map_t::iterator iter = mRequestMap.find(id);
-	if (iter != mRequestMap.end())
+	RequestShard& shard = getShard(id);
+	LLMutexLock lock(&shard.mMutex);
+	map_t::iterator iter = shard.mRequestMap.find(id);
+	if (iter != shard.mRequestMap.end())
 	{
 		worker = iter->second;
 		if (worker->mHost != host)
@@ -1637,7 +1679,8 @@ bool LLTextureFetch::createRequest(const std::string& url, const LLUUID& id, con
 	else
 	{
 		worker = new LLTextureFetchWorker(this, url, id, host, priority, desired_discard, desired_size, can_use_http);
-		mRequestMap[id] = worker;
+		shard.mRequestMap[id] = worker;
+		mNumRequests++;
 	}
 	worker->mActiveCount++;
 	worker->mNeedsAux = needs_aux;
@@ -1647,7 +1690,7 @@ bool LLTextureFetch::createRequest(const std::string& url, const LLUUID& id, con
 
 void LLTextureFetch::deleteRequest(const LLUUID& id, bool cancel)
 {
-	LLMutexLock lock(&mQueueMutex);
+	LLMutexLock lock(&getShard(id).mMutex);
 	LLTextureFetchWorker* worker = getWorker(id);
 	if (worker)
 	{		
@@ -1656,56 +1699,84 @@ void LLTextureFetch::deleteRequest(const LLUUID& id, bool cancel)
 }
 
 // protected
+// Any thread; the change is applied by applyNetworkQueueOps().
 void LLTextureFetch::addToNetworkQueue(LLTextureFetchWorker* worker)
 {
-	LLMutexLock lock(&mNetworkQueueMutex);
-	mNetworkQueue.insert(worker->mID);
-	for (cancel_queue_t::iterator iter1 = mCancelQueue.begin(); iter1 != mCancelQueue.end(); ++iter1)
-	{
-		iter1->second.erase(worker->mID);
-	}
+	NetworkQueueOp op;
+	op.mOp = NetworkQueueOp::ADD;
+	op.mID = worker->mID;
+	op.mHost = worker->mHost;
+	mNetworkQueueOps.push(op);
 }
 
 void LLTextureFetch::removeFromNetworkQueue(LLTextureFetchWorker* worker, bool cancel)
 {
-	LLMutexLock lock(&mNetworkQueueMutex);
-	size_t erased = mNetworkQueue.erase(worker->mID);
-	if (cancel && erased > 0)
+	NetworkQueueOp op;
+	op.mOp = cancel ? NetworkQueueOp::REMOVE_AND_CANCEL : NetworkQueueOp::REMOVE;
+	op.mID = worker->mID;
+	op.mHost = worker->mHost;
+	mNetworkQueueOps.push(op);
+}
+
+// MAIN THREAD
+void LLTextureFetch::applyNetworkQueueOps()
+{
+	std::vector<NetworkQueueOp> ops;
+	mNetworkQueueOps.popAll(ops);
+	for (std::vector<NetworkQueueOp>::iterator iter = ops.begin(); iter != ops.end(); ++iter)
 	{
-		mCancelQueue[worker->mHost].insert(worker->mID);
+		if (iter->mOp == NetworkQueueOp::ADD)
+		{
+			mNetworkQueue.insert(iter->mID);
+			for (cancel_queue_t::iterator iter1 = mCancelQueue.begin(); iter1 != mCancelQueue.end(); ++iter1)
+			{
+				iter1->second.erase(iter->mID);
+			}
+		}
+		else
+		{
+			size_t erased = mNetworkQueue.erase(iter->mID);
+			if (iter->mOp == NetworkQueueOp::REMOVE_AND_CANCEL && erased > 0)
+			{
+				mCancelQueue[iter->mHost].insert(iter->mID);
+			}
+		}
 	}
 }
 
 // protected
+// WORKER THREAD
 void LLTextureFetch::addToHTTPQueue(const LLUUID& id)
 {
-	LLMutexLock lock(&mNetworkQueueMutex);
 	mHTTPTextureQueue.insert(id);
+	mNumHTTPRequests = (S32)mHTTPTextureQueue.size();
 }
 
 void LLTextureFetch::removeFromHTTPQueue(const LLUUID& id)
 {
-	LLMutexLock lock(&mNetworkQueueMutex);
 	mHTTPTextureQueue.erase(id);
+	mNumHTTPRequests = (S32)mHTTPTextureQueue.size();
 }
 
-// call lockQueue() first!
+// call lockQueue(worker->mID) first!
 void LLTextureFetch::removeRequest(LLTextureFetchWorker* worker, bool cancel)
 {
-	size_t erased_1 = mRequestMap.erase(worker->mID);
+	size_t erased_1 = getShard(worker->mID).mRequestMap.erase(worker->mID);
 	llassert_always(erased_1 > 0) ;
+	mNumRequests--;
 	removeFromNetworkQueue(worker, cancel);
 	llassert_always(!(worker->getFlags(LLWorkerClass::WCF_DELETE_REQUESTED))) ;
 
 	worker->scheduleDelete();	
 }
 
-// call lockQueue() first!
+// call lockQueue(id) first!
 LLTextureFetchWorker* LLTextureFetch::getWorker(const LLUUID& id)
 {
 	LLTextureFetchWorker* res = NULL;
-	map_t::iterator iter = mRequestMap.find(id);
-	if (iter != mRequestMap.end())
+	RequestShard& shard = getShard(id);
+	map_t::iterator iter = shard.mRequestMap.find(id);
+	if (iter != shard.mRequestMap.end())
 	{
 		res = iter->second;
 	}
@@ -1717,7 +1788,7 @@ bool LLTextureFetch::getRequestFinished(const LLUUID& id, S32& discard_level,
 										LLPointer<LLImageRaw>& raw, LLPointer<LLImageRaw>& aux)
 {
 	bool res = false;
-	LLMutexLock lock(&mQueueMutex);
+	LLMutexLock lock(&getShard(id).mMutex);
 	LLTextureFetchWorker* worker = getWorker(id);
 	if (worker)
 	{
@@ -1763,19 +1834,50 @@ bool LLTextureFetch::getRequestFinished(const LLUUID& id, S32& discard_level,
 	return res;
 }
 
-bool LLTextureFetch::updateRequestPriority(const LLUUID& id, F32 priority)
+void LLTextureFetch::updateRequestPriority(const LLUUID& id, F32 priority)
 {
-	bool res = false;
-	LLMutexLock lock(&mQueueMutex);
-	LLTextureFetchWorker* worker = getWorker(id);
-	if (worker)
+	mPendingPriorities[id] = priority;
+}
+
+// MAIN THREAD
+void LLTextureFetch::flushPriorityUpdates()
+{
+	if (mPendingPriorities.empty())
 	{
-		worker->lockWorkMutex();
-		worker->setImagePriority(priority);
-		worker->unlockWorkMutex();
-		res = true;
+		return;
+	}
+	priority_update_list_t batch;
+	batch.reserve(mPendingPriorities.size());
+	for (priority_map_t::iterator iter = mPendingPriorities.begin(); iter != mPendingPriorities.end(); ++iter)
+	{
+		PriorityUpdate update;
+		update.mID = iter->first;
+		update.mPriority = iter->second;
+		batch.push_back(update);
+	}
+	mPendingPriorities.clear();
+	mPriorityUpdates.push(batch);
+}
+
+// WORKER THREAD (or the main thread when not threaded)
+void LLTextureFetch::applyPriorityUpdates()
+{
+	std::vector<priority_update_list_t> batches;
+	mPriorityUpdates.popAll(batches);
+	for (std::vector<priority_update_list_t>::iterator batch = batches.begin(); batch != batches.end(); ++batch)
+	{
+		for (priority_update_list_t::iterator iter = batch->begin(); iter != batch->end(); ++iter)
+		{
+			LLMutexLock lock(&getShard(iter->mID).mMutex);
+			LLTextureFetchWorker* worker = getWorker(iter->mID);
+			if (worker)
+			{
+				worker->lockWorkMutex();
+				worker->setImagePriority(iter->mPriority);
+				worker->unlockWorkMutex();
+			}
+		}
 	}
-	return res;
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -1787,9 +1889,20 @@ S32 LLTextureFetch::update(U32 max_time_ms)
 	S32 res;
 	
 	mMaxBandwidth = gSavedSettings.getF32("ThrottleBandwidthKBPS");
+	static LLCachedControl<U32> sMaxHTTPRequests(gSavedSettings, "ImagePipelineHTTPMaxRequests");
+	static LLCachedControl<bool> sHTTPAdaptiveRange(gSavedSettings, "ImagePipelineHTTPAdaptiveRange");
+	mMaxHTTPRequests = llmax(1, (S32)(U32)sMaxHTTPRequests);
+	mHTTPAdaptiveRange = sHTTPAdaptiveRange;
 	
+	flushPriorityUpdates();
+	if (!getThreaded())
+	{
+		applyPriorityUpdates();
+	}
+
 	res = LLWorkerThread::update(max_time_ms);
 	
+	applyNetworkQueueOps();
 	if (!mDebugPause)
 	{
 		sendRequestListToSimulators();
@@ -1803,6 +1916,7 @@ void LLTextureFetch::startThread()
 {
 	// Construct mCurlGetRequest from Worker Thread
 	mCurlGetRequest = new LLCurlRequest();
+	mCurlGetRequest->setHostLimit(mHTTPHostConnections);
 }
 
 // WORKER THREAD
@@ -1818,6 +1932,8 @@ void LLTextureFetch::threadedUpdate()
 {
 	llassert_always(mCurlGetRequest);
 	
+	applyPriorityUpdates();
+
 	// Limit update frequency
 	const F32 PROCESS_TIME = 0.05f; 
 	static LLFrameTimer process_timer;
@@ -1872,18 +1988,18 @@ void LLTextureFetch::sendRequestListToSimulators()
 	}
 	timer.reset();
 	
-	LLMutexLock lock(&mQueueMutex);
-
 	// Send requests
+	// Workers are only deleted on the main thread, so the ones found here
+	// stay valid after their shard is unlocked.
 	typedef std::set<LLTextureFetchWorker*,LLTextureFetchWorker::Compare> request_list_t;
 	typedef std::map< LLHost, request_list_t > work_request_map_t;
 	work_request_map_t requests;
-	{
-	LLMutexLock lock2(&mNetworkQueueMutex);
 	for (queue_t::iterator iter = mNetworkQueue.begin(); iter != mNetworkQueue.end(); )
 	{
 		queue_t::iterator curiter = iter++;
+		lockQueue(*curiter);
 		LLTextureFetchWorker* req = getWorker(*curiter);
+		unlockQueue(*curiter);
 		if (!req)
 		{
 			// This happens when a request was removed from mRequestMap in a race
@@ -1923,7 +2039,6 @@ void LLTextureFetch::sendRequestListToSimulators()
 			}
 		}
 	}
-	}
 
 	for (work_request_map_t::iterator iter1 = requests.begin();
 		 iter1 != requests.end(); ++iter1)
@@ -2000,8 +2115,6 @@ void LLTextureFetch::sendRequestListToSimulators()
 	}
 	
 	// Send cancelations
-	{
-	LLMutexLock lock2(&mNetworkQueueMutex);
 	if (gMessageSystem && !mCancelQueue.empty())
 	{
 		for (cancel_queue_t::iterator iter1 = mCancelQueue.begin();
@@ -2045,7 +2158,6 @@ void LLTextureFetch::sendRequestListToSimulators()
 		}
 		mCancelQueue.clear();
 	}
-	}
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -2085,7 +2197,7 @@ bool LLTextureFetchWorker::insertPacket(S32 index, U8* data, S32 size)
 bool LLTextureFetch::receiveImageHeader(const LLHost& host, const LLUUID& id, U8 codec, U16 packets, U32 totalbytes,
 										U16 data_size, U8* data)
 {
-	LLMutexLock lock(&mQueueMutex);
+	LLMutexLock lock(&getShard(id).mMutex);
 	LLTextureFetchWorker* worker = getWorker(id);
 
 	++mPacketCount;
@@ -2094,7 +2206,6 @@ bool LLTextureFetch::receiveImageHeader(const LLHost& host, const LLUUID& id, U8
 	{
 // 		llwarns << "Received header for non active worker: " << id << llendl;
 		++mBadPacketCount;
-		LLMutexLock lock2(&mNetworkQueueMutex);
 		mCancelQueue[host].insert(id);
 		return false;
 	}
@@ -2123,7 +2234,6 @@ bool LLTextureFetch::receiveImageHeader(const LLHost& host, const LLUUID& id, U8
 	if (!res)
 	{
 		++mBadPacketCount;
-		LLMutexLock lock2(&mNetworkQueueMutex);
 		mCancelQueue[host].insert(id);
 	}
 	else
@@ -2144,7 +2254,7 @@ bool LLTextureFetch::receiveImageHeader(const LLHost& host, const LLUUID& id, U8
 
 bool LLTextureFetch::receiveImagePacket(const LLHost& host, const LLUUID& id, U16 packet_num, U16 data_size, U8* data)
 {
-	LLMutexLock lock(&mQueueMutex);
+	LLMutexLock lock(&getShard(id).mMutex);
 	LLTextureFetchWorker* worker = getWorker(id);
 	bool res = true;
 
@@ -2168,7 +2278,6 @@ bool LLTextureFetch::receiveImagePacket(const LLHost& host, const LLUUID& id, U1
 	if (!res)
 	{
 		++mBadPacketCount;
-		LLMutexLock lock2(&mNetworkQueueMutex);
 		mCancelQueue[host].insert(id);
 		return false;
 	}
@@ -2215,7 +2324,7 @@ S32 LLTextureFetch::getFetchState(const LLUUID& id, F32& data_progress_p, F32& r
 	F32 request_dtime = 999999.f;
 	U32 fetch_priority = 0;
 	
-	LLMutexLock lock(&mQueueMutex);
+	LLMutexLock lock(&getShard(id).mMutex);
 	LLTextureFetchWorker* worker = getWorker(id);
 	if (worker && worker->haveWork())
 	{
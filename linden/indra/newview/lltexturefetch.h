@@ -34,10 +34,13 @@
 #define LL_LLTEXTUREFETCH_H
 
 #include "lldir.h"
+#include "llhost.h"
 #include "llimage.h"
+#include "llmpscqueue.h"
 #include "lluuid.h"
 #include "llworkerthread.h"
 #include "llcurl.h"
+#include "llhttprangeestimator.h"
 #include "lltextureinfo.h"
 
 class LLViewerImage;
@@ -45,7 +48,6 @@ class LLTextureFetchWorker;
 class HTTPGetResponder;
 class LLTextureCache;
 class LLImageDecodeThread;
-class LLHost;
 
 // Interface class
 class LLTextureFetch : public LLWorkerThread
@@ -64,7 +66,8 @@ public:
 	void deleteRequest(const LLUUID& id, bool cancel);
 	bool getRequestFinished(const LLUUID& id, S32& discard_level,
 							LLPointer<LLImageRaw>& raw, LLPointer<LLImageRaw>& aux);
-	bool updateRequestPriority(const LLUUID& id, F32 priority);
+	// Applied on the fetch thread, so it never waits on it.
+	void updateRequestPriority(const LLUUID& id, F32 priority);
 
 	bool receiveImageHeader(const LLHost& host, const LLUUID& id, U8 codec, U16 packets, U32 totalbytes, U16 data_size, U8* data);
 	bool receiveImagePacket(const LLHost& host, const LLUUID& id, U16 packet_num, U16 data_size, U8* data);
@@ -76,12 +79,13 @@ public:
 	S32 getFetchState(const LLUUID& id, F32& decode_progress_p, F32& requested_priority_p,
 					  U32& fetch_priority_p, F32& fetch_dtime_p, F32& request_dtime_p);
 	void dump();
-	S32 getNumRequests() const { LLMutexLock lock(&mQueueMutex); return mRequestMap.size(); }
-	S32 getNumHTTPRequests() const { LLMutexLock lock(&mNetworkQueueMutex); return mHTTPTextureQueue.size(); }
+	S32 getNumRequests() { return mNumRequests; }
+	S32 getNumHTTPRequests() { return mNumHTTPRequests; }
 	
-	// Public for access by callbacks
-	void lockQueue() { mQueueMutex.lock(); }
-	void unlockQueue() { mQueueMutex.unlock(); }
+	// Public for access by callbacks.  Locks only the shard of the request
+	// map that holds id; a worker found while it is locked stays alive.
+	void lockQueue(const LLUUID& id) { getShard(id).mMutex.lock(); }
+	void unlockQueue(const LLUUID& id) { getShard(id).mMutex.unlock(); }
 	LLTextureFetchWorker* getWorker(const LLUUID& id);
 
 	LLTextureInfo* getTextureInfo() { return &mTextureInfo; }
@@ -96,6 +100,9 @@ protected:
 	void processCurlRequests();	
 
 private:
+	void flushPriorityUpdates();
+	void applyPriorityUpdates();
+	void applyNetworkQueueOps();
 	void sendRequestListToSimulators();
 	/*virtual*/ void startThread(void);
 	/*virtual*/ void endThread(void);
@@ -109,25 +116,65 @@ public:
 	S32 mBadPacketCount;
 	
 private:
-	mutable LLMutex mQueueMutex;
-	mutable LLMutex mNetworkQueueMutex;
-
 	LLTextureCache* mTextureCache;
 	LLImageDecodeThread* mImageDecodeThread;
 	LLCurlRequest* mCurlGetRequest;
 	
-	// Map of all requests by UUID
+	// Map of all requests by UUID, split in shards with their own mutex so
+	// the main thread and the fetch, cache and decode threads rarely wait
+	// on each other.
+	enum { REQUEST_SHARDS = 16 }; // power of 2
 	typedef std::map<LLUUID,LLTextureFetchWorker*> map_t;
-	map_t mRequestMap;
+	struct RequestShard
+	{
+		LLMutex mMutex;
+		map_t mRequestMap;
+	};
+	RequestShard& getShard(const LLUUID& id) { return mShards[id.mData[0] & (REQUEST_SHARDS - 1)]; }
+	RequestShard mShards[REQUEST_SHARDS];
+	LLAtomicS32 mNumRequests;
+
+	// Priority changes from the main thread, applied by the fetch thread.
+	// The main thread keeps only the latest priority per request and hands
+	// them over once a frame as one batch.
+	struct PriorityUpdate
+	{
+		LLUUID mID;
+		F32 mPriority;
+	};
+	typedef std::vector<PriorityUpdate> priority_update_list_t;
+	typedef std::map<LLUUID, F32> priority_map_t;
+	priority_map_t mPendingPriorities;	// main thread only
+	LLMPSCQueue<priority_update_list_t> mPriorityUpdates;
+
+	// Changes to mNetworkQueue and mCancelQueue from any thread, applied
+	// by the main thread, which owns both.
+	struct NetworkQueueOp
+	{
+		enum EOp { ADD, REMOVE, REMOVE_AND_CANCEL };
+		EOp mOp;
+		LLUUID mID;
+		LLHost mHost;
+	};
+	LLMPSCQueue<NetworkQueueOp> mNetworkQueueOps;
 
 	// Set of requests that require network data
 	typedef std::set<LLUUID> queue_t;
 	queue_t mNetworkQueue;
-	queue_t mHTTPTextureQueue;
 	typedef std::map<LLHost,std::set<LLUUID> > cancel_queue_t;
 	cancel_queue_t mCancelQueue;
+
+	// Only touched by the fetch thread; the count may be read anywhere.
+	queue_t mHTTPTextureQueue;
+	LLAtomicS32 mNumHTTPRequests;
+
 	F32 mTextureBandwidth;
 	F32 mMaxBandwidth;
+	S32 mMaxHTTPRequests;
+	S32 mHTTPHostConnections; // Per host, also the connections kept open
+	bool mHTTPAdaptiveRange;
+	// Fetch thread only
+	LLHTTPRangeEstimator mHTTPRangeEstimator;
 	LLTextureInfo mTextureInfo;
 };
 
@@ -478,13 +478,15 @@ void LLGLTexMemBar::draw()
 #endif
 	//----------------------------------------------------------------------------
 
-	text = llformat("Textures: %d Fetch: %d(%d) Pkts:%d(%d) Cache R/W: %d/%d LFS:%d IW:%d RAW:%d HTP:%d",
+	text = llformat("Textures: %d Fetch: %d(%d) Pkts:%d(%d) Cache R/W: %d/%d LFS:%d IW:%d(%d/%d) RAW:%d HTP:%d",
 					gImageList.getNumImages(),
 					LLAppViewer::getTextureFetch()->getNumRequests(), LLAppViewer::getTextureFetch()->getNumDeletes(),
 					LLAppViewer::getTextureFetch()->mPacketCount, LLAppViewer::getTextureFetch()->mBadPacketCount, 
 					LLAppViewer::getTextureCache()->getNumReads(), LLAppViewer::getTextureCache()->getNumWrites(),
 					LLLFSThread::sLocal->getPending(),
 					LLAppViewer::getImageDecodeThread()->getPending(), 
+					LLAppViewer::getImageDecodeThread()->getNumBusyWorkers(),
+					LLAppViewer::getImageDecodeThread()->getNumWorkers(),
 					LLImageRaw::sRawImageCount,
 					LLAppViewer::getTextureFetch()->getNumHTTPRequests());
 
@@ -662,10 +664,9 @@ void LLTextureView::draw()
 			llinfos << "ID\tMEM\tBOOST\tPRI\tWIDTH\tHEIGHT\tDISCARD" << llendl;
 		}
 	
-		for (LLViewerImageList::image_priority_list_t::iterator iter = gImageList.mImageList.begin();
-			 iter != gImageList.mImageList.end(); )
+		for (S32 i = 0; i < gImageList.mImageList.size(); ++i)
 		{
-			LLPointer<LLViewerImage> imagep = *iter++;
+			LLPointer<LLViewerImage> imagep = gImageList.mImageList.getAt(i);
 			if(!imagep->hasFetcher())
 			{
 				continue ;
@@ -110,6 +110,7 @@ BOOL gSnapshot = FALSE;
 U32 gRecentFrameCount = 0; // number of 'recent' frames
 LLFrameTimer gRecentFPSTime;
 LLFrameTimer gRecentMemoryTime;
+LLFrameTimer gRecentSettingsLookupTime;
 
 // Rendering stuff
 void pre_show_depth_buffer();
@@ -199,10 +200,33 @@ void display_update_camera()
 	LLWorld::getInstance()->setLandFarClip(final_far);
 }
 
+// Logs the settings looked up by name most often per frame since the
+// last call, to find the ones worth an LLCachedControl.
+void display_settings_lookups()
+{
+	static U32 last_frame_count = gFrameCount;
+	F32 frames = (F32)llmax(gFrameCount - last_frame_count, (U32)1);
+	last_frame_count = gFrameCount;
+
+	LLControlGroup::lookup_count_list_t counts;
+	gSavedSettings.getLookupCounts(counts, 10, true);
+	std::ostringstream lookups;
+	for (LLControlGroup::lookup_count_list_t::iterator iter = counts.begin();
+		 iter != counts.end(); ++iter)
+	{
+		lookups << " " << iter->first << llformat(" %.1f", iter->second / frames);
+	}
+	llinfos << "SETTINGS LOOKUPS PER FRAME:" << lookups.str() << llendl;
+}
+
 // Write some stats to llinfos
 void display_stats()
 {
-	F32 fps_log_freq = gSavedSettings.getF32("FPSLogFrequency");
+	static LLCachedControl<F32> sFPSLogFrequency(gSavedSettings, "FPSLogFrequency");
+	static LLCachedControl<F32> sMemoryLogFrequency(gSavedSettings, "MemoryLogFrequency");
+	static LLCachedControl<F32> sSettingsLookupLogFrequency(gSavedSettings, "SettingsLookupLogFrequency");
+
+	F32 fps_log_freq = sFPSLogFrequency;
 	if (fps_log_freq > 0.f && gRecentFPSTime.getElapsedTimeF32() >= fps_log_freq)
 	{
 		F32 fps = gRecentFrameCount / fps_log_freq;
@@ -210,7 +234,7 @@ void display_stats()
 		gRecentFrameCount = 0;
 		gRecentFPSTime.reset();
 	}
-	F32 mem_log_freq = gSavedSettings.getF32("MemoryLogFrequency");
+	F32 mem_log_freq = sMemoryLogFrequency;
 	if (mem_log_freq > 0.f && gRecentMemoryTime.getElapsedTimeF32() >= mem_log_freq)
 	{
 		gMemoryAllocated = getCurrentRSS();
@@ -218,6 +242,12 @@ void display_stats()
 		llinfos << llformat("MEMORY: %d MB", memory) << llendl;
 		gRecentMemoryTime.reset();
 	}
+	F32 lookup_log_freq = sSettingsLookupLogFrequency;
+	if (lookup_log_freq > 0.f && gRecentSettingsLookupTime.getElapsedTimeF32() >= lookup_log_freq)
+	{
+		display_settings_lookups();
+		gRecentSettingsLookupTime.reset();
+	}
 }
 
 // Paint the display!
@@ -225,6 +255,17 @@ void display(BOOL rebuild, F32 zoom_factor, int subfield, BOOL for_snapshot)
 {
 	LLFastTimer t(LLFastTimer::FTM_RENDER);
 
+	static LLCachedControl<S32> sRenderNameSetting(gSavedSettings, "RenderName");
+	static LLCachedControl<BOOL> sRenderHideGroupTitleAll(gSavedSettings, "RenderHideGroupTitleAll");
+	static LLCachedControl<BOOL> sDisableTeleportScreens(gSavedSettings, "DisableTeleportScreens");
+	static LLCachedControl<U32> sSpeedRezInterval(gSavedSettings, "SpeedRezInterval");
+	static LLCachedControl<BOOL> sUseOcclusionSetting(gSavedSettings, "UseOcclusion");
+	static LLCachedControl<BOOL> sRenderFastAlpha(gSavedSettings, "RenderFastAlpha");
+	static LLCachedControl<BOOL> sRenderUseFarClip(gSavedSettings, "RenderUseFarClip");
+	static LLCachedControl<S32> sRenderAvatarMaxVisible(gSavedSettings, "RenderAvatarMaxVisible");
+	static LLCachedControl<BOOL> sRenderDelayVBUpdate(gSavedSettings, "RenderDelayVBUpdate");
+	static LLCachedControl<BOOL> sRenderWater(gSavedSettings, "RenderWater");
+
 	if (LLPipeline::sRenderFrameTest)
 	{
 		send_agent_pause();
@@ -319,13 +360,13 @@ void display(BOOL rebuild, F32 zoom_factor, int subfield, BOOL for_snapshot)
 
 	LLImageGL::updateStats(gFrameTimeSeconds);
 	
-	S32 RenderName = gSavedSettings.getS32("RenderName");
+	S32 RenderName = sRenderNameSetting;
 
 	if(RenderName > gHippoLimits->mRenderName)//The most restricted gets set here
 		RenderName = gHippoLimits->mRenderName;
 
 	LLVOAvatar::sRenderName = RenderName;
-	LLVOAvatar::sRenderGroupTitles = !gSavedSettings.getBOOL("RenderHideGroupTitleAll");
+	LLVOAvatar::sRenderGroupTitles = !sRenderHideGroupTitleAll;
 	
 	gPipeline.mBackfaceCull = TRUE;
 	gFrameCount++;
@@ -367,7 +408,7 @@ void display(BOOL rebuild, F32 zoom_factor, int subfield, BOOL for_snapshot)
 			// Transition to REQUESTED.  Viewer has sent some kind
 			// of TeleportRequest to the source simulator
 			gTeleportDisplayTimer.reset();
-			if (!gSavedSettings.getBOOL("DisableTeleportScreens"))
+			if (!sDisableTeleportScreens)
 			{
 				gViewerWindow->setShowProgress(TRUE);
 			}
@@ -381,7 +422,7 @@ void display(BOOL rebuild, F32 zoom_factor, int subfield, BOOL for_snapshot)
 			// Waiting for source simulator to respond
 			gViewerWindow->setProgressPercent( llmin(teleport_percent, 37.5f) );
 			gTeleportDisplayTimer.reset();
-			if (!gSavedSettings.getBOOL("DisableTeleportScreens"))
+			if (!sDisableTeleportScreens)
 			{
 				gViewerWindow->setProgressString(message);
 			}
@@ -394,7 +435,7 @@ void display(BOOL rebuild, F32 zoom_factor, int subfield, BOOL for_snapshot)
 		case LLAgent::TELEPORT_MOVING:
 			// Viewer has received destination location from source simulator
 			gViewerWindow->setProgressPercent( llmin(teleport_percent, 75.f) );
-			if (!gSavedSettings.getBOOL("DisableTeleportScreens"))
+			if (!sDisableTeleportScreens)
 			{
 				gViewerWindow->setProgressString(message);
 			}
@@ -413,7 +454,7 @@ void display(BOOL rebuild, F32 zoom_factor, int subfield, BOOL for_snapshot)
 			gAgent.setTeleportMessage(
 				LLAgent::sTeleportProgressMessages["arriving"]);
 			gImageList.mForceResetTextureStats = TRUE;
-			if (!gSavedSettings.getBOOL("DisableTeleportScreens"))
+			if (!sDisableTeleportScreens)
 			{
 				gAgent.resetView(TRUE, TRUE);
 			}
@@ -427,7 +468,7 @@ void display(BOOL rebuild, F32 zoom_factor, int subfield, BOOL for_snapshot)
 			// Make the user wait while content "pre-caches"
 			{
 				F32 arrival_fraction = (gTeleportArrivalTimer.getElapsedTimeF32() / TELEPORT_ARRIVAL_DELAY);
-				if( arrival_fraction > 1.f || gSavedSettings.getBOOL("DisableTeleportScreens"))
+				if( arrival_fraction > 1.f || sDisableTeleportScreens)
 				{
 					arrival_fraction = 1.f;
 					LLFirstUse::useTeleport();
@@ -435,7 +476,7 @@ void display(BOOL rebuild, F32 zoom_factor, int subfield, BOOL for_snapshot)
 				}
 				gViewerWindow->setProgressCancelButtonVisible(FALSE, std::string("Cancel")); //TODO: Translate
 				gViewerWindow->setProgressPercent(  arrival_fraction * 25.f + 75.f);
-				if ( !gSavedSettings.getBOOL("DisableTeleportScreens") )
+				if ( !sDisableTeleportScreens )
 				{
 					gViewerWindow->setProgressString(message);
 				}
@@ -496,7 +537,7 @@ void display(BOOL rebuild, F32 zoom_factor, int subfield, BOOL for_snapshot)
 	if (gSavedDrawDistance > 0.0f && gAgent.getTeleportState() == LLAgent::TELEPORT_NONE)
 	{
 		if (gTeleportArrivalTimer.getElapsedTimeF32() >=
-			(F32)gSavedSettings.getU32("SpeedRezInterval"))
+			(F32)sSpeedRezInterval)
 		{
 			gTeleportArrivalTimer.reset();
 			F32 current = gSavedSettings.getF32("RenderFarClip");
@@ -641,7 +682,7 @@ void display(BOOL rebuild, F32 zoom_factor, int subfield, BOOL for_snapshot)
 		LLPipeline::sUseOcclusion = 
 				(!gUseWireframe
 				&& LLFeatureManager::getInstance()->isFeatureAvailable("UseOcclusion") 
-				&& gSavedSettings.getBOOL("UseOcclusion") 
+				&& sUseOcclusionSetting 
 				&& gGLManager.mHasOcclusionQuery) ? 2 : 0;
 
 		if (LLPipeline::sUseOcclusion && LLPipeline::sRenderDeferred)
@@ -649,10 +690,10 @@ void display(BOOL rebuild, F32 zoom_factor, int subfield, BOOL for_snapshot)
 			LLPipeline::sUseOcclusion = 3;
 		}
 
-		LLPipeline::sFastAlpha = gSavedSettings.getBOOL("RenderFastAlpha");
-		LLPipeline::sUseFarClip = gSavedSettings.getBOOL("RenderUseFarClip");
-		LLVOAvatar::sMaxVisible = gSavedSettings.getS32("RenderAvatarMaxVisible");
-		LLPipeline::sDelayVBUpdate = gSavedSettings.getBOOL("RenderDelayVBUpdate");
+		LLPipeline::sFastAlpha = sRenderFastAlpha;
+		LLPipeline::sUseFarClip = sRenderUseFarClip;
+		LLVOAvatar::sMaxVisible = sRenderAvatarMaxVisible;
+		LLPipeline::sDelayVBUpdate = sRenderDelayVBUpdate;
 
 		S32 occlusion = LLPipeline::sUseOcclusion;
 		if (gDepthDirty)
@@ -850,7 +891,7 @@ void display(BOOL rebuild, F32 zoom_factor, int subfield, BOOL for_snapshot)
 		LLPipeline::sUnderWaterRender = LLViewerCamera::getInstance()->cameraUnderWater() ? TRUE : FALSE;
 		
 		//Check for RenderWater
-		if (!gSavedSettings.getBOOL("RenderWater") || !gHippoLimits->mRenderWater)
+		if (!sRenderWater || !gHippoLimits->mRenderWater)
 			LLPipeline::sUnderWaterRender = FALSE;
 		
 		LLPipeline::updateRenderDeferred();
@@ -981,7 +1022,8 @@ void render_hud_attachments()
 		hud_cam.setAxes(LLVector3(1,0,0), LLVector3(0,1,0), LLVector3(0,0,1));
 		LLViewerCamera::updateFrustumPlanes(hud_cam, TRUE);
 
-		bool render_particles = gPipeline.hasRenderType(LLPipeline::RENDER_TYPE_PARTICLES) && gSavedSettings.getBOOL("RenderHUDParticles");
+		static LLCachedControl<BOOL> sRenderHUDParticles(gSavedSettings, "RenderHUDParticles");
+		bool render_particles = gPipeline.hasRenderType(LLPipeline::RENDER_TYPE_PARTICLES) && sRenderHUDParticles;
 		
 		//only render hud objects
 		U32 mask = gPipeline.getRenderTypeMask();
@@ -1252,6 +1294,8 @@ void draw_axes()
 
 void render_ui_3d()
 {
+	static LLCachedControl<BOOL> sShowAxes(gSavedSettings, "ShowAxes");
+
 	LLGLSPipeline gls_pipeline;
 
 	//////////////////////////////////////
@@ -1270,7 +1314,7 @@ void render_ui_3d()
 	// Debugging stuff goes before the UI.
 
 	// Coordinate axes
-	if (gSavedSettings.getBOOL("ShowAxes"))
+	if (sShowAxes)
 	{
 		draw_axes();
 	}
@@ -319,6 +319,7 @@ void LLViewerImage::init(bool firstinit)
 	{
 		mDecodePriority = 0.f;
 		mInImageList = 0;
+		mImageListHandle = -1;
 	}
 	mIsMediaTexture = FALSE;
 
@@ -812,6 +813,16 @@ void LLViewerImage::switchToCachedImage()
 //============================================================================
 
 F32 LLViewerImage::calcDecodePriority()
+{
+	F32 priority;
+	LLViewerImage* image = this;
+	calcDecodePriorities(&image, 1, &priority);
+	return priority;
+}
+
+// Fills in what calcDecodePriority(input) needs, and counts a decode frame
+// the same way the per-image calculation always has.
+void LLViewerImage::getDecodePriorityInput(DecodePriorityInput& input)
 {
 #ifndef LL_RELEASE_FOR_DOWNLOAD
 	if (mID == LLAppViewer::getTextureFetch()->mDebugID)
@@ -819,17 +830,72 @@ F32 LLViewerImage::calcDecodePriority()
 		LLAppViewer::getTextureFetch()->mDebugCount++; // for setting breakpoints
 	}
 #endif
-	
+
+	input.mOldPriority = mDecodePriority;
+	input.mFlags = 0;
 	if (mNeedsCreateTexture)
 	{
-		return mDecodePriority; // no change while waiting to create
+		input.mFlags = DECODE_KEEP_PRIORITY; // no change while waiting to create
+		return;
 	}
-	if(mForceToSaveRawImage)
+	if (mForceToSaveRawImage)
+	{
+		input.mFlags = DECODE_MAX_PRIORITY;
+		return;
+	}
+
+	input.mPixelPriority = fsqrtf(mMaxVirtualSize);
+	input.mAdditionalPriority = mAdditionalDecodePriority;
+	input.mCurDiscard = getDiscardLevel();
+	input.mDesiredDiscard = mDesiredDiscardLevel;
+	input.mMaxDiscard = mMaxDiscardLevel;
+	input.mMinDiscard = mMinDiscardLevel;
+	input.mCachedRawDiscard = mCachedRawDiscardLevel;
+	input.mBoostLevel = mBoostLevel;
+
+	const S32 MIN_NOT_VISIBLE_FRAMES = 30; // NOTE: this function is not called every frame
+	mDecodeFrame++;
+	if (input.mPixelPriority > 0.f)
+	{
+		mVisibleFrame = mDecodeFrame;
+	}
+	if (mVisibleFrame == 0 || (mDecodeFrame - mVisibleFrame > MIN_NOT_VISIBLE_FRAMES))
+	{
+		input.mFlags |= DECODE_NOT_VISIBLE;
+	}
+	if (mIsMissingAsset)
+	{
+		input.mFlags |= DECODE_MISSING_ASSET;
+	}
+	if (!isJustBound() && mCachedRawImageReady)
+	{
+		input.mFlags |= DECODE_CACHED_RAW_READY;
+	}
+	if (getDontDiscard())
+	{
+		input.mFlags |= DECODE_DONT_DISCARD;
+	}
+	if (getBoundRecently())
+	{
+		input.mFlags |= DECODE_BOUND_RECENTLY;
+	}
+}
+
+//static
+F32 LLViewerImage::calcDecodePriority(const DecodePriorityInput& input)
+{
+	if (input.mFlags & DECODE_KEEP_PRIORITY)
+	{
+		return input.mOldPriority;
+	}
+	if (input.mFlags & DECODE_MAX_PRIORITY)
 	{
-		return maxDecodePriority() ;
+		return maxDecodePriority();
 	}
 
-	S32 cur_discard = getDiscardLevel();
+	const S32 cur_discard = input.mCurDiscard;
+	const S32 desired_discard = input.mDesiredDiscard;
+	const S32 boost_level = input.mBoostLevel;
 	
 	//no need to update if the texture reaches its highest res and the memory is sufficient.
 	//if(LLViewerImage::sFreezeImageScalingDown && !cur_discard)
@@ -837,50 +903,44 @@ F32 LLViewerImage::calcDecodePriority()
 	//	return -5.0f ;
 	//}
 
-	bool have_all_data = (cur_discard >= 0 && (cur_discard <= mDesiredDiscardLevel));
-	F32 pixel_priority = fsqrtf(mMaxVirtualSize);
-	const S32 MIN_NOT_VISIBLE_FRAMES = 30; // NOTE: this function is not called every frame
-	mDecodeFrame++;
-	if (pixel_priority > 0.f)
-	{
-		mVisibleFrame = mDecodeFrame;
-	}
+	bool have_all_data = (cur_discard >= 0 && (cur_discard <= desired_discard));
+	F32 pixel_priority = input.mPixelPriority;
 	
 	F32 priority = 0.f;	
-	if (mIsMissingAsset)
+	if (input.mFlags & DECODE_MISSING_ASSET)
 	{
 		priority = 0.0f;
 	}	
-	else if(mDesiredDiscardLevel >= cur_discard && cur_discard > -1)
+	else if(desired_discard >= cur_discard && cur_discard > -1)
 	{
 		priority = -1.0f ;
 	}
-	else if (!isJustBound() && mCachedRawImageReady)
+	else if (input.mFlags & DECODE_CACHED_RAW_READY)
 	{
 		priority = -1.0f;
 	}
-	else if(mCachedRawDiscardLevel > -1 && mDesiredDiscardLevel >= mCachedRawDiscardLevel)
+	else if(input.mCachedRawDiscard > -1 && desired_discard >= input.mCachedRawDiscard)
 	{
 		priority = -1.0f;
 	}
-	else if (mDesiredDiscardLevel > mMaxDiscardLevel)
+	else if (desired_discard > input.mMaxDiscard)
 	{
 		// Don't decode anything we don't need
 		priority = -1.0f;
 	}
-	else if (mBoostLevel == LLViewerImageBoostLevel::BOOST_UI && !have_all_data)
+	else if (boost_level == LLViewerImageBoostLevel::BOOST_UI && !have_all_data)
 	{
 		priority = 1.f;
 	}
 	else if (pixel_priority <= 0.f && !have_all_data)
 	{
 		// Not on screen but we might want some data
-		if (mBoostLevel > LLViewerImageBoostLevel::BOOST_HIGH)
+		if (boost_level > LLViewerImageBoostLevel::BOOST_HIGH)
 		{
 			// Always want high boosted images
 			priority = 1.f;
 		}
-		else if (mVisibleFrame == 0 || (mDecodeFrame - mVisibleFrame > MIN_NOT_VISIBLE_FRAMES))
+		else if (input.mFlags & DECODE_NOT_VISIBLE)
 		{
 			// Don't decode anything that isn't visible unless it's important
 			priority = -2.0f;
@@ -888,7 +948,7 @@ F32 LLViewerImage::calcDecodePriority()
 		else
 		{
 			// Leave the priority as-is
-			return mDecodePriority;
+			return input.mOldPriority;
 		}
 	}
 	else if (cur_discard < 0)
@@ -901,24 +961,24 @@ F32 LLViewerImage::calcDecodePriority()
 		ddiscard = llclamp(ddiscard, 1, 9);
 		priority = ddiscard*100000.f;
 	}
-	else if ((mMinDiscardLevel > 0) && (cur_discard <= mMinDiscardLevel))
+	else if ((input.mMinDiscard > 0) && (cur_discard <= input.mMinDiscard))
 	{
 		// larger mips are corrupted
 		priority = -3.0f;
 	}
-	else if (cur_discard <= mDesiredDiscardLevel)
+	else if (cur_discard <= desired_discard)
 	{
 		priority = -4.0f;
 	}
 	else
 	{
 		// priority range = 100000-400000
-		S32 ddiscard = cur_discard - mDesiredDiscardLevel;
-		if (getDontDiscard())
+		S32 ddiscard = cur_discard - desired_discard;
+		if (input.mFlags & DECODE_DONT_DISCARD)
 		{
 			ddiscard+=2;
 		}
-		else if (!getBoundRecently() && mBoostLevel == 0)
+		else if (!(input.mFlags & DECODE_BOUND_RECENTLY) && boost_level == 0)
 		{
 			ddiscard-=2;
 		}
@@ -932,25 +992,42 @@ F32 LLViewerImage::calcDecodePriority()
 		pixel_priority = llclamp(pixel_priority, 0.0f, priority-1.f); 
 
 		// priority range = [100000.f, 2000000.f]
-		if ( mBoostLevel > LLViewerImageBoostLevel::BOOST_HIGH)
+		if ( boost_level > LLViewerImageBoostLevel::BOOST_HIGH)
 		{
-			priority = 1000000.f + pixel_priority + 1000.f * mBoostLevel;
+			priority = 1000000.f + pixel_priority + 1000.f * boost_level;
 		}
 		else
 		{
-			priority +=      0.f + pixel_priority + 1000.f * mBoostLevel;
+			priority +=      0.f + pixel_priority + 1000.f * boost_level;
 		}
 		
 		// priority range = [2100000.f, 5000000.f] if mAdditionalDecodePriority > 1.0
-		if(mAdditionalDecodePriority > 1.0f)
+		if(input.mAdditionalPriority > 1.0f)
 		{
-			priority += 2000000.f + mAdditionalDecodePriority ;
+			priority += 2000000.f + input.mAdditionalPriority ;
 		}
 	}
 
 	return priority;
 }
 
+// Gathering first keeps the priority loop free of calls into the images,
+// so it runs over one packed array however many images there are.
+//static
+void LLViewerImage::calcDecodePriorities(LLViewerImage* const* images, S32 count, F32* priorities)
+{
+	static std::vector<DecodePriorityInput> inputs;
+	inputs.resize(count);
+	for (S32 i = 0; i < count; ++i)
+	{
+		images[i]->getDecodePriorityInput(inputs[i]);
+	}
+	for (S32 i = 0; i < count; ++i)
+	{
+		priorities[i] = calcDecodePriority(inputs[i]);
+	}
+}
+
 // A value >= max value calculated above for normalization
 //static
 F32 LLViewerImage::maxDecodePriority()
@@ -120,6 +120,7 @@ class LLViewerImage : public LLImageGL
 
 	friend class LLTextureBar; // debug info only
 	friend class LLTextureView; // debug info only
+	friend class LLViewerImageList; // keeps mDecodePriority in step with its heap
 	
 public:
 	static void initClass();
@@ -274,6 +275,36 @@ public:
 	F32 getDecodePriority() const { return mDecodePriority; };
 	F32 calcDecodePriority();
 	static F32 maxDecodePriority();
+
+	// What the decode priority depends on, packed so that the priorities of
+	// a batch of images can be calculated in one loop.
+	enum
+	{
+		DECODE_KEEP_PRIORITY	= 1 << 0,
+		DECODE_MAX_PRIORITY		= 1 << 1,
+		DECODE_NOT_VISIBLE		= 1 << 2,
+		DECODE_MISSING_ASSET	= 1 << 3,
+		DECODE_CACHED_RAW_READY	= 1 << 4,	// and not just bound
+		DECODE_DONT_DISCARD		= 1 << 5,
+		DECODE_BOUND_RECENTLY	= 1 << 6
+	};
+	struct DecodePriorityInput
+	{
+		F32 mPixelPriority;
+		F32 mOldPriority;
+		F32 mAdditionalPriority;
+		S32 mCurDiscard;
+		S32 mDesiredDiscard;
+		S32 mMaxDiscard;
+		S32 mMinDiscard;
+		S32 mCachedRawDiscard;
+		S32 mBoostLevel;
+		U32 mFlags;
+	};
+	void getDecodePriorityInput(DecodePriorityInput& input);
+	static F32 calcDecodePriority(const DecodePriorityInput& input);
+	// Like calling calcDecodePriority() on each image
+	static void calcDecodePriorities(LLViewerImage* const* images, S32 count, F32* priorities);
 	
 	// Set the decode priority for this image...
 	// DON'T CALL THIS UNLESS YOU KNOW WHAT YOU'RE DOING, it can mess up
@@ -360,6 +391,7 @@ public:
 	F32 mDiscardVirtualSize;		// Virtual size used to calculate desired discard
 	
 	S8  mInImageList;				// TRUE if image is in list (in which case don't reset priority!)
+	S32 mImageListHandle;			// Handle in gImageList's priority heap while mInImageList
 	S8  mIsMediaTexture;			// TRUE if image is being replaced by media (in which case don't update)
 
 	// Various info regarding image requests
@@ -90,6 +90,8 @@ LLStat LLViewerImageList::sFormattedMemStat(32, TRUE);
 
 LLViewerImageList::LLViewerImageList() 
 	: mForceResetTextureStats(FALSE),
+	mLastUpdateHandle(0),
+	mLastFetchHandle(0),
 	mUpdateStats(FALSE),
 	mMaxResidentTexMemInMegaBytes(0),
 	mMaxTotalTextureMemInMegaBytes(0)
@@ -256,10 +258,9 @@ void LLViewerImageList::shutdown()
 	// Write out list of currently loaded textures for precaching on startup
 	typedef std::set<std::pair<S32,LLViewerImage*> > image_area_list_t;
 	image_area_list_t image_area_list;
-	for (image_priority_list_t::iterator iter = mImageList.begin();
-		 iter != mImageList.end(); ++iter)
+	for (S32 i = 0; i < mImageList.size(); ++i)
 	{
-		LLViewerImage* image = *iter;
+		LLViewerImage* image = mImageList.getAt(i);
 		if (!image->getUseDiscard() ||
 			image->needsAux() ||
 			image->getTargetHost() != LLHost::invalid)
@@ -316,7 +317,9 @@ void LLViewerImageList::shutdown()
 void LLViewerImageList::dump()
 {
 	llinfos << "LLViewerImageList::dump()" << llendl;
-	for (image_priority_list_t::iterator it = mImageList.begin(); it != mImageList.end(); ++it)
+	std::vector<LLPointer<LLViewerImage> > images;
+	mImageList.getTop(mImageList.size(), images);
+	for (std::vector<LLPointer<LLViewerImage> >::iterator it = images.begin(); it != images.end(); ++it)
 	{
 		LLViewerImage* image = *it;
 		
@@ -482,7 +485,7 @@ void LLViewerImageList::addImageToList(LLViewerImage *image)
 	{
 		llerrs << "LLViewerImageList::addImageToList - Image already in list" << llendl;
 	}
-	llverify((mImageList.insert(image)).second == true);
+	image->mImageListHandle = mImageList.insert(image, image->getDecodePriority());
 	image->mInImageList = TRUE;
 }
 
@@ -499,10 +502,34 @@ void LLViewerImageList::removeImageFromList(LLViewerImage *image)
 		}
 		llerrs << "LLViewerImageList::removeImageFromList - Image not in list" << llendl;
 	}
-	llverify(mImageList.erase(image) == 1);
+	llassert(mImageList.get(image->mImageListHandle) == image);
+	mImageList.erase(image->mImageListHandle);
+	image->mImageListHandle = -1;
 	image->mInImageList = FALSE;
 }
 
+void LLViewerImageList::setDecodePriority(LLViewerImage* image, F32 priority)
+{
+	llassert(image->mInImageList);
+	image->mDecodePriority = priority;
+	mImageList.setPriority(image->mImageListHandle, priority);
+}
+
+void LLViewerImageList::updateBatchDecodePriorities()
+{
+	S32 count = (S32)mPriorityBatch.size();
+	if (count > 0)
+	{
+		mPriorityBatchResults.resize(count);
+		LLViewerImage::calcDecodePriorities(&mPriorityBatch[0], count, &mPriorityBatchResults[0]);
+		for (S32 i = 0; i < count; ++i)
+		{
+			setDecodePriority(mPriorityBatch[i], mPriorityBatchResults[i]);
+		}
+	}
+	mPriorityBatch.clear();
+}
+
 void LLViewerImageList::addImage(LLViewerImage *new_image)
 {
 	if (!new_image)
@@ -613,20 +640,19 @@ void LLViewerImageList::updateImages(F32 max_time)
 
 void LLViewerImageList::updateImagesDecodePriorities()
 {
-	// Update the decode priority for N images each frame
+	// Update the decode priority of every image about once a second
 	{
-		const size_t max_update_count = llmin((S32) (1024*gFrameIntervalSeconds) + 1, 32); //target 1024 textures per second
-		S32 update_counter = llmin(max_update_count, mUUIDMap.size()/10);
-		uuid_map_t::iterator iter = mUUIDMap.upper_bound(mLastUpdateUUID);
-		while(update_counter > 0 && !mUUIDMap.empty())
+		const S32 MAX_UPDATE_COUNT = 4096;
+		S32 update_counter = llclamp((S32)(mImageList.size()*gFrameIntervalSeconds) + 1, 32, MAX_UPDATE_COUNT);
+		const S32 handle_count = mImageList.getHandleCount();
+		for (S32 visited = 0; update_counter > 0 && visited < handle_count; ++visited)
 		{
-			if (iter == mUUIDMap.end())
+			mLastUpdateHandle = (mLastUpdateHandle + 1) % handle_count;
+			if (!mImageList.isValid(mLastUpdateHandle))
 			{
-				iter = mUUIDMap.begin();
+				continue;
 			}
-			mLastUpdateUUID = iter->first;
-			LLPointer<LLViewerImage> imagep = iter->second;
-			++iter; // safe to incrament now
+			LLPointer<LLViewerImage> imagep = mImageList.get(mLastUpdateHandle);
 
 			//
 			// Flush formatted images using a lazy flush
@@ -678,21 +704,12 @@ void LLViewerImageList::updateImagesDecodePriorities()
 			}
 
 			imagep->processTextureStats();
-			F32 old_priority = imagep->getDecodePriority();
-			F32 old_priority_test = llmax(old_priority, 0.0f);
-			F32 decode_priority = imagep->calcDecodePriority();
-			F32 decode_priority_test = llmax(decode_priority, 0.0f);
-			// Ignore < 20% difference
-			if ((decode_priority_test < old_priority_test * .8f) ||
-				(decode_priority_test > old_priority_test * 1.25f))
-			{
-				removeImageFromList(imagep);
-				imagep->setDecodePriority(decode_priority);
-				addImageToList(imagep);
-			}
+			// The list keeps it alive until the batch is done
+			mPriorityBatch.push_back(imagep);
 			update_counter--;
 		}
 	}
+	updateBatchDecodePriorities();
 }
 
 /*
@@ -763,14 +780,19 @@ void LLViewerImageList::bumpToMaxDecodePriority(LLViewerImage* imagep)
 			// Already at maximum.
 		  	return;
 		}
-		removeImageFromList(imagep);
 	}
 
 	imagep->processTextureStats();
 	F32 decode_priority = LLViewerImage::maxDecodePriority() ;
-	imagep->setDecodePriority(decode_priority);
-	mImageList.insert(imagep);
-	imagep->mInImageList = TRUE;
+	if (imagep->mInImageList)
+	{
+		setDecodePriority(imagep, decode_priority);
+	}
+	else
+	{
+		imagep->setDecodePriority(decode_priority);
+		addImageToList(imagep);
+	}
 
 	return ;
 }
@@ -785,34 +807,21 @@ F32 LLViewerImageList::updateImagesFetchTextures(F32 max_time)
 	const size_t max_update_count = llmin((S32) (1024*10.f*gFrameIntervalSeconds)+1, 256);
 	
 	// 32 high priority entries
-	typedef std::vector<LLViewerImage*> entries_list_t;
+	typedef std::vector<LLPointer<LLViewerImage> > entries_list_t;
 	entries_list_t entries;
-	size_t update_counter = llmin(max_priority_count, mImageList.size());
-	image_priority_list_t::iterator iter1 = mImageList.begin();
-	while(update_counter > 0)
-	{
-		entries.push_back(*iter1);
-		++iter1;
-		update_counter--;
-	}
+	mImageList.getTop((S32)max_priority_count, entries);
 	
 	// 256 cycled entries
-	update_counter = llmin(max_update_count, mUUIDMap.size());
-	if (update_counter > 0)
+	size_t update_counter = llmin(max_update_count, (size_t)mImageList.size());
+	const S32 handle_count = mImageList.getHandleCount();
+	for (S32 visited = 0; update_counter > 0 && visited < handle_count; ++visited)
 	{
-		uuid_map_t::iterator iter2 = mUUIDMap.upper_bound(mLastFetchUUID);
-		uuid_map_t::iterator iter2p = iter2;
-		while(update_counter > 0)
+		mLastFetchHandle = (mLastFetchHandle + 1) % handle_count;
+		if (mImageList.isValid(mLastFetchHandle))
 		{
-			if (iter2 == mUUIDMap.end())
-			{
-				iter2 = mUUIDMap.begin();
-			}
-			entries.push_back(iter2->second);
-			iter2p = iter2++;
+			entries.push_back(mImageList.get(mLastFetchHandle));
 			update_counter--;
 		}
-		mLastFetchUUID = iter2p->first;
 	}
 	
 	S32 fetch_count = 0;
@@ -850,10 +859,9 @@ void LLViewerImageList::updateImagesUpdateStats()
 {
 	if (mUpdateStats && mForceResetTextureStats)
 	{
-		for (image_priority_list_t::iterator iter = mImageList.begin();
-			 iter != mImageList.end(); )
+		for (S32 i = 0; i < mImageList.size(); ++i)
 		{
-			LLViewerImage* imagep = *iter++;
+			LLViewerImage* imagep = mImageList.getAt(i);
 			imagep->resetTextureStats();
 		}
 		mUpdateStats = FALSE;
@@ -868,31 +876,23 @@ void LLViewerImageList::decodeAllImages(F32 max_time)
 	
 	// Update texture stats and priorities
 	std::vector<LLPointer<LLViewerImage> > image_list;
-	for (image_priority_list_t::iterator iter = mImageList.begin();
-		 iter != mImageList.end(); )
-	{
-		LLViewerImage* imagep = *iter++;
-		image_list.push_back(imagep);
-		imagep->mInImageList = FALSE;
-	}
-	mImageList.clear();
+	mImageList.getTop(mImageList.size(), image_list);
 	for (std::vector<LLPointer<LLViewerImage> >::iterator iter = image_list.begin();
 		 iter != image_list.end(); ++iter)
 	{
 		LLViewerImage* imagep = *iter;
 		imagep->processTextureStats();
-		F32 decode_priority = imagep->calcDecodePriority();
-		imagep->setDecodePriority(decode_priority);
-		mImageList.insert(imagep);
-		imagep->mInImageList = TRUE;
+		mPriorityBatch.push_back(imagep);
 	}
+	updateBatchDecodePriorities();
 	image_list.clear();
 	
 	// Update fetch (decode)
-	for (image_priority_list_t::iterator iter = mImageList.begin();
-		 iter != mImageList.end(); )
+	mImageList.getTop(mImageList.size(), image_list);
+	for (std::vector<LLPointer<LLViewerImage> >::iterator iter = image_list.begin();
+		 iter != image_list.end(); ++iter)
 	{
-		LLViewerImage* imagep = *iter++;
+		LLViewerImage* imagep = *iter;
 		imagep->updateFetch();
 	}
 	// Run threads
@@ -908,10 +908,10 @@ void LLViewerImageList::decodeAllImages(F32 max_time)
 		}
 	}
 	// Update fetch again
-	for (image_priority_list_t::iterator iter = mImageList.begin();
-		 iter != mImageList.end(); )
+	for (std::vector<LLPointer<LLViewerImage> >::iterator iter = image_list.begin();
+		 iter != image_list.end(); ++iter)
 	{
-		LLViewerImage* imagep = *iter++;
+		LLViewerImage* imagep = *iter;
 		imagep->updateFetch();
 	}
 	max_time -= timer.getElapsedTimeF32();
@@ -36,11 +36,17 @@
 #include "lluuid.h"
 //#include "message.h"
 #include "llgl.h"
+#include "llpriorityheap.h"
 #include "llstat.h"
 #include "llviewerimage.h"
 #include "llui.h"
 #include <list>
 #include <set>
+#if LL_WINDOWS
+#include <hash_map>
+#else
+#include <ext/hash_map>
+#endif
 
 const U32 LL_IMAGE_REZ_LOSSLESS_CUTOFF = 128;
 
@@ -155,6 +161,10 @@ private:
 	F32  updateImagesCreateTextures(F32 max_time);
 	F32  updateImagesFetchTextures(F32 max_time);
 	void updateImagesUpdateStats();
+	// Sets the decode priority of an image in mImageList
+	void setDecodePriority(LLViewerImage* image, F32 priority);
+	// Calculates and sets the priorities of the images in mPriorityBatch
+	void updateBatchDecodePriorities();
 	
 public:
 	typedef std::set<LLPointer<LLViewerImage> > image_list_t;	
@@ -168,13 +178,21 @@ public:
 	BOOL mForceResetTextureStats;
     
 private:
-	typedef std::map< LLUUID, LLPointer<LLViewerImage> > uuid_map_t;
+#if LL_WINDOWS
+	typedef stdext::hash_map< LLUUID, LLPointer<LLViewerImage>, lluuid_hash > uuid_map_t;
+#else
+	typedef __gnu_cxx::hash_map< LLUUID, LLPointer<LLViewerImage>, lluuid_hash > uuid_map_t;
+#endif
 	uuid_map_t mUUIDMap;
-	LLUUID mLastUpdateUUID;
-	LLUUID mLastFetchUUID;
 	
-	typedef std::set<LLPointer<LLViewerImage>, LLViewerImage::Compare> image_priority_list_t;	
+	// Images by decode priority.  The periodic passes walk its handles,
+	// each carrying on from where it stopped last frame.
+	typedef LLPriorityHeap<LLPointer<LLViewerImage> > image_priority_list_t;
 	image_priority_list_t mImageList;
+	S32 mLastUpdateHandle;
+	S32 mLastFetchHandle;
+	std::vector<LLViewerImage*> mPriorityBatch;
+	std::vector<F32> mPriorityBatchResults;
 
 	// simply holds on to LLViewerImage references to stop them from being purged too soon
 	std::set<LLPointer<LLViewerImage> > mImagePreloads;
@@ -456,6 +456,16 @@ void LLViewerJoint::updateJointGeometry()
 	}
 }
 
+void LLViewerJoint::getSkinnedMeshes(std::vector<LLViewerJointMesh*>& meshes)
+{
+	for (child_list_t::iterator iter = mChildren.begin();
+		 iter != mChildren.end(); ++iter)
+	{
+		LLViewerJoint* joint = (LLViewerJoint*)(*iter);
+		joint->getSkinnedMeshes(meshes);
+	}
+}
+
 
 BOOL LLViewerJoint::updateLOD(F32 pixel_area, BOOL activate)
 {
@@ -130,6 +130,8 @@ public:
 	virtual void updateFaceData(LLFace *face, F32 pixel_area, BOOL damp_wind = FALSE);
 	virtual BOOL updateLOD(F32 pixel_area, BOOL activate);
 	virtual void updateJointGeometry();
+	// Appends the meshes updateJointGeometry() would skin
+	virtual void getSkinnedMeshes(std::vector<LLViewerJointMesh*>& meshes);
 	virtual void dump();
 
 	void setVisible( BOOL visible, BOOL recursive );
@@ -49,6 +49,7 @@
 #include "llface.h"
 #include "llgldbg.h"
 #include "llglheaders.h"
+#include "lljobpool.h"
 #include "lltexlayer.h"
 #include "llviewercamera.h"
 #include "llviewercontrol.h"
@@ -56,6 +57,8 @@
 #include "llviewerjointmesh.h"
 #include "llvoavatar.h"
 #include "llsky.h"
+#include "llskinjob.h"
+#include "llsys.h"
 #include "pipeline.h"
 #include "llviewershadermgr.h"
 #include "llmath.h"
@@ -383,17 +386,17 @@ const S32 NUM_AXES = 3;
 
 static LLMatrix4	gJointMatUnaligned[32];
 static LLMatrix3	gJointRotUnaligned[32];
-static LLVector4	gJointPivot[32];
+
+static LLJobPool*	sSkinJobPool = NULL;
 
 //-----------------------------------------------------------------------------
-// uploadJointMatrices()
+// computeJointMatrices()
 //-----------------------------------------------------------------------------
-void LLViewerJointMesh::uploadJointMatrices()
+void LLViewerJointMesh::computeJointMatrices(LLMatrix4* joint_mats, LLMatrix3* joint_rots, BOOL hardware_skinning)
 {
 	S32 joint_num;
 	LLPolyMesh *reference_mesh = mMesh->getReferenceMesh();
-	LLDrawPool *poolp = mFace ? mFace->getPool() : NULL;
-	BOOL hardware_skinning = (poolp && poolp->getVertexShaderLevel() > 0) ? TRUE : FALSE;
+	LLVector4 joint_pivots[32];
 
 	//calculate joint matrices
 	for (joint_num = 0; joint_num < reference_mesh->mJointRenderData.count(); joint_num++)
@@ -404,8 +407,8 @@ void LLViewerJointMesh::uploadJointMatrices()
 		{
 			joint_mat *= LLDrawPoolAvatar::getModelView();
 		}
-		gJointMatUnaligned[joint_num] = joint_mat;
-		gJointRotUnaligned[joint_num] = joint_mat.getMat3();
+		joint_mats[joint_num] = joint_mat;
+		joint_rots[joint_num] = joint_mat.getMat3();
 	}
 
 	BOOL last_pivot_uploaded = FALSE;
@@ -421,13 +424,13 @@ void LLViewerJointMesh::uploadJointMatrices()
 			{
 				LLVector4 parent_pivot(sj->mRootToParentJointSkinOffset);
 				parent_pivot.mV[VW] = 0.f;
-				gJointPivot[j++] = parent_pivot;
+				joint_pivots[j++] = parent_pivot;
 			}
 
 			LLVector4 child_pivot(sj->mRootToJointSkinOffset);
 			child_pivot.mV[VW] = 0.f;
 
-			gJointPivot[j++] = child_pivot;
+			joint_pivots[j++] = child_pivot;
 
 			last_pivot_uploaded = TRUE;
 		}
@@ -441,10 +444,23 @@ void LLViewerJointMesh::uploadJointMatrices()
 	for (S32 i = 0; i < j; i++)
 	{
 		LLVector3 pivot;
-		pivot = LLVector3(gJointPivot[i]);
-		pivot = pivot * gJointRotUnaligned[i];
-		gJointMatUnaligned[i].translate(pivot);
+		pivot = LLVector3(joint_pivots[i]);
+		pivot = pivot * joint_rots[i];
+		joint_mats[i].translate(pivot);
 	}
+}
+
+//-----------------------------------------------------------------------------
+// uploadJointMatrices()
+//-----------------------------------------------------------------------------
+void LLViewerJointMesh::uploadJointMatrices()
+{
+	S32 joint_num;
+	LLPolyMesh *reference_mesh = mMesh->getReferenceMesh();
+	LLDrawPool *poolp = mFace ? mFace->getPool() : NULL;
+	BOOL hardware_skinning = (poolp && poolp->getVertexShaderLevel() > 0) ? TRUE : FALSE;
+
+	computeJointMatrices(gJointMatUnaligned, gJointRotUnaligned, hardware_skinning);
 
 	// upload matrices
 	if (hardware_skinning)
@@ -736,89 +752,12 @@ void LLViewerJointMesh::updateGeometryOriginal(LLFace *mFace, LLPolyMesh *mMesh)
 
 	//get vertex and normal striders
 	LLVertexBuffer *buffer = mFace->mVertexBuffer;
-	buffer->getVertexStrider(o_vertices,  0);
-	buffer->getNormalStrider(o_normals,   0);
-
-	F32 last_weight = F32_MAX;
-	LLMatrix4 gBlendMat;
-	LLMatrix3 gBlendRotMat;
-
-	const F32* weights = mMesh->getWeights();
-	const LLVector3* coords = mMesh->getCoords();
-	const LLVector3* normals = mMesh->getNormals();
-	for (U32 index = 0; index < mMesh->getNumVertices(); index++)
-	{
-		U32 bidx = index + mMesh->mFaceVertexOffset;
-		
-		// blend by first matrix
-		F32 w = weights[index]; 
-		
-		// Maybe we don't have to change gBlendMat.
-		// Profiles of a single-avatar scene on a Mac show this to be a very
-		// common case.  JC
-		if (w == last_weight)
-		{
-			o_vertices[bidx] = coords[index] * gBlendMat;
-			o_normals[bidx] = normals[index] * gBlendRotMat;
-			continue;
-		}
-		
-		last_weight = w;
-
-		S32 joint = llfloor(w);
-		w -= joint;
-		
-		// No lerp required in this case.
-		if (w == 1.0f)
-		{
-			gBlendMat = gJointMatUnaligned[joint+1];
-			o_vertices[bidx] = coords[index] * gBlendMat;
-			gBlendRotMat = gJointRotUnaligned[joint+1];
-			o_normals[bidx] = normals[index] * gBlendRotMat;
-			continue;
-		}
-		
-		// Try to keep all the accesses to the matrix data as close
-		// together as possible.  This function is a hot spot on the
-		// Mac. JC
-		LLMatrix4 &m0 = gJointMatUnaligned[joint+1];
-		LLMatrix4 &m1 = gJointMatUnaligned[joint+0];
-		
-		gBlendMat.mMatrix[VX][VX] = lerp(m1.mMatrix[VX][VX], m0.mMatrix[VX][VX], w);
-		gBlendMat.mMatrix[VX][VY] = lerp(m1.mMatrix[VX][VY], m0.mMatrix[VX][VY], w);
-		gBlendMat.mMatrix[VX][VZ] = lerp(m1.mMatrix[VX][VZ], m0.mMatrix[VX][VZ], w);
-
-		gBlendMat.mMatrix[VY][VX] = lerp(m1.mMatrix[VY][VX], m0.mMatrix[VY][VX], w);
-		gBlendMat.mMatrix[VY][VY] = lerp(m1.mMatrix[VY][VY], m0.mMatrix[VY][VY], w);
-		gBlendMat.mMatrix[VY][VZ] = lerp(m1.mMatrix[VY][VZ], m0.mMatrix[VY][VZ], w);
-
-		gBlendMat.mMatrix[VZ][VX] = lerp(m1.mMatrix[VZ][VX], m0.mMatrix[VZ][VX], w);
-		gBlendMat.mMatrix[VZ][VY] = lerp(m1.mMatrix[VZ][VY], m0.mMatrix[VZ][VY], w);
-		gBlendMat.mMatrix[VZ][VZ] = lerp(m1.mMatrix[VZ][VZ], m0.mMatrix[VZ][VZ], w);
-
-		gBlendMat.mMatrix[VW][VX] = lerp(m1.mMatrix[VW][VX], m0.mMatrix[VW][VX], w);
-		gBlendMat.mMatrix[VW][VY] = lerp(m1.mMatrix[VW][VY], m0.mMatrix[VW][VY], w);
-		gBlendMat.mMatrix[VW][VZ] = lerp(m1.mMatrix[VW][VZ], m0.mMatrix[VW][VZ], w);
-
-		o_vertices[bidx] = coords[index] * gBlendMat;
-		
-		LLMatrix3 &n0 = gJointRotUnaligned[joint+1];
-		LLMatrix3 &n1 = gJointRotUnaligned[joint+0];
-		
-		gBlendRotMat.mMatrix[VX][VX] = lerp(n1.mMatrix[VX][VX], n0.mMatrix[VX][VX], w);
-		gBlendRotMat.mMatrix[VX][VY] = lerp(n1.mMatrix[VX][VY], n0.mMatrix[VX][VY], w);
-		gBlendRotMat.mMatrix[VX][VZ] = lerp(n1.mMatrix[VX][VZ], n0.mMatrix[VX][VZ], w);
-
-		gBlendRotMat.mMatrix[VY][VX] = lerp(n1.mMatrix[VY][VX], n0.mMatrix[VY][VX], w);
-		gBlendRotMat.mMatrix[VY][VY] = lerp(n1.mMatrix[VY][VY], n0.mMatrix[VY][VY], w);
-		gBlendRotMat.mMatrix[VY][VZ] = lerp(n1.mMatrix[VY][VZ], n0.mMatrix[VY][VZ], w);
+	buffer->getVertexStrider(o_vertices,  mMesh->mFaceVertexOffset);
+	buffer->getNormalStrider(o_normals,   mMesh->mFaceVertexOffset);
 
-		gBlendRotMat.mMatrix[VZ][VX] = lerp(n1.mMatrix[VZ][VX], n0.mMatrix[VZ][VX], w);
-		gBlendRotMat.mMatrix[VZ][VY] = lerp(n1.mMatrix[VZ][VY], n0.mMatrix[VZ][VY], w);
-		gBlendRotMat.mMatrix[VZ][VZ] = lerp(n1.mMatrix[VZ][VZ], n0.mMatrix[VZ][VZ], w);
-		
-		o_normals[bidx] = normals[index] * gBlendRotMat;
-	}
+	LLSkinJob::skin(gJointMatUnaligned, gJointRotUnaligned,
+					mMesh->getWeights(), mMesh->getCoords(), mMesh->getNormals(),
+					mMesh->getNumVertices(), o_vertices, o_normals);
 
 	buffer->setBuffer(0);
 }
@@ -880,14 +819,102 @@ void LLViewerJointMesh::updateVectorize()
 	}
 }
 
+BOOL LLViewerJointMesh::needsSoftwareSkinning()
+{
+	return mValid
+		&& mMesh
+		&& mFace
+		&& mMesh->hasWeights()
+		&& mFace->mVertexBuffer.notNull()
+		&& LLViewerShaderMgr::instance()->getVertexShaderLevel(LLViewerShaderMgr::SHADER_AVATAR) == 0;
+}
+
+//virtual
+void LLViewerJointMesh::getSkinnedMeshes(std::vector<LLViewerJointMesh*>& meshes)
+{
+	if (needsSoftwareSkinning())
+	{
+		meshes.push_back(this);
+	}
+}
+
+namespace
+{
+	class LLSkinJobList : public LLJobPool::Job
+	{
+	public:
+		LLSkinJobList(std::vector<LLSkinJob>& jobs) : mJobs(jobs) {}
+		/*virtual*/ void run(S32 index) { mJobs[index].run(); }
+	private:
+		std::vector<LLSkinJob>& mJobs;
+	};
+}
+
+//static
+BOOL LLViewerJointMesh::skinMeshes(const std::vector<LLViewerJointMesh*>& meshes)
+{
+	LLFastTimer t(LLFastTimer::FTM_AVATAR_SKINNING);
+	static LLCachedControl<bool> sAvatarSkinThreaded(gSavedSettings, "AvatarSkinThreaded");
+	if (!sAvatarSkinThreaded || sVectorizePerfTest)
+	{
+		return FALSE;
+	}
+	if (!sSkinJobPool)
+	{
+		S32 threads = llmax((S32)LLCPUInfo::getNumCores() - 1, 0);
+		sSkinJobPool = new LLJobPool("skin", threads);
+	}
+
+	// Joint matrices and buffer mappings are set up here; only the
+	// blending runs on the pool.  The jobs keep their capacity.
+	static std::vector<LLSkinJob> jobs;
+	static std::vector<LLVertexBuffer*> buffers;
+	jobs.resize(meshes.size());
+	buffers.clear();
+	S32 count = 0;
+	for (std::vector<LLViewerJointMesh*>::const_iterator iter = meshes.begin(); iter != meshes.end(); ++iter)
+	{
+		LLViewerJointMesh* mesh = *iter;
+		LLSkinJob& job = jobs[count];
+		LLVertexBuffer* buffer = mesh->mFace->mVertexBuffer;
+		if (!buffer->getVertexStrider(job.mOutVertices, mesh->mMesh->mFaceVertexOffset))
+		{
+			continue;
+		}
+		// mapped now, so it must be unmapped below even if the normals fail
+		buffers.push_back(buffer);
+		if (!buffer->getNormalStrider(job.mOutNormals, mesh->mMesh->mFaceVertexOffset))
+		{
+			continue;
+		}
+		mesh->computeJointMatrices(job.mJointMat, job.mJointRot, FALSE);
+		job.mWeights = mesh->mMesh->getWeights();
+		job.mCoords = mesh->mMesh->getCoords();
+		job.mNormals = mesh->mMesh->getNormals();
+		job.mNumVertices = mesh->mMesh->getNumVertices();
+		count++;
+	}
+
+	LLSkinJobList job_list(jobs);
+	sSkinJobPool->run(job_list, count);
+
+	for (std::vector<LLVertexBuffer*>::iterator iter = buffers.begin(); iter != buffers.end(); ++iter)
+	{
+		(*iter)->setBuffer(0);
+	}
+	return TRUE;
+}
+
+//static
+void LLViewerJointMesh::cleanupClass()
+{
+	delete sSkinJobPool;
+	sSkinJobPool = NULL;
+}
+
 void LLViewerJointMesh::updateJointGeometry()
 {
-	if (!(mValid
-		  && mMesh
-		  && mFace
-		  && mMesh->hasWeights()
-		  && mFace->mVertexBuffer.notNull()
-		  && LLViewerShaderMgr::instance()->getVertexShaderLevel(LLViewerShaderMgr::SHADER_AVATAR) == 0))
+	if (!needsSoftwareSkinning())
 	{
 		return;
 	}
@@ -43,6 +43,7 @@ class LLDrawable;
 class LLFace;
 class LLCharacter;
 class LLTexLayerSet;
+class LLSkinJob;
 
 typedef enum e_avatar_render_pass
 {
@@ -144,6 +145,7 @@ public:
 	/*virtual*/ void updateFaceData(LLFace *face, F32 pixel_area, BOOL damp_wind = FALSE);
 	/*virtual*/ BOOL updateLOD(F32 pixel_area, BOOL activate);
 	/*virtual*/ void updateJointGeometry();
+	/*virtual*/ void getSkinnedMeshes(std::vector<LLViewerJointMesh*>& meshes);
 	/*virtual*/ void dump();
 
 	void setIsTransparent(BOOL is_transparent) { mIsTransparent = is_transparent; }
@@ -151,6 +153,12 @@ public:
 	/*virtual*/ BOOL isAnimatable() { return FALSE; }
 	
 	static void updateVectorize(); // Update globals when settings variables change
+
+	// Skins meshes, as updateJointGeometry() would, spread over a pool of
+	// worker threads.  Returns FALSE, having done nothing, when threaded
+	// skinning is turned off.
+	static BOOL skinMeshes(const std::vector<LLViewerJointMesh*>& meshes);
+	static void cleanupClass();
 	
 private:
 	// Avatar vertex skinning is a significant performance issue on computers
@@ -169,6 +177,9 @@ private:
 	static void (*sUpdateGeometryFunc)(LLFace* face, LLPolyMesh* mesh);
 
 private:
+	BOOL needsSoftwareSkinning();
+	void computeJointMatrices(LLMatrix4* joint_mats, LLMatrix3* joint_rots, BOOL hardware_skinning);
+
 	// Allocate skin data
 	BOOL allocateSkinData( U32 numSkinJoints );
 
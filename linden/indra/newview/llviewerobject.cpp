@@ -459,8 +459,10 @@ void LLViewerObject::cleanupVOClasses()
 {
 	LLVOGrass::cleanupClass();
 	LLVOWater::cleanupClass();
+	LLVOSky::cleanupClass();
 	LLVOTree::cleanupClass();
 	LLVOAvatar::cleanupClass();
+	LLVOVolume::cleanupClass();
 }
 
 // Replaces all name value pairs with data from \n delimited list
@@ -1824,6 +1826,7 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
 
 	if (gPingInterpolate)
 	{ 
+		LLMessageSystem::LLCircuitLock lock(gMessageSystem);
 		LLCircuitData *cdp = gMessageSystem->mCircuitInfo.findCircuit(mesgsys->getSender());
 		if (cdp)
 		{
@@ -81,21 +81,11 @@ F32 calc_desired_size(LLVector3 pos, LLVector2 scale)
 LLViewerPart::LLViewerPart() :
 	mPartID(0),
 	mLastUpdateTime(0.f),
+	mSkipOffset(0.f),
 	mVPCallback(NULL),
 	mImagep(NULL)
 {
-	LLMemType mt(LLMemType::MTYPE_PARTICLES);
-	mPartSourcep = NULL;
-
-	++LLViewerPartSim::sParticleCount2 ;
-}
-
-LLViewerPart::~LLViewerPart()
-{
-	LLMemType mt(LLMemType::MTYPE_PARTICLES);
 	mPartSourcep = NULL;
-
-	--LLViewerPartSim::sParticleCount2 ;
 }
 
 void LLViewerPart::init(LLPointer<LLViewerPartSource> sourcep, LLViewerImage *imagep, LLVPCallback cb)
@@ -185,13 +175,12 @@ LLViewerPartGroup::~LLViewerPartGroup()
 	LLMemType mt(LLMemType::MTYPE_PARTICLES);
 	cleanup();
 	
-	S32 count = (S32) mParticles.size();
-	for(S32 i = 0 ; i < count ; i++)
-	{
-		delete mParticles[i] ;
-	}
+	S32 count = mParticles.size();
 	mParticles.clear();
+	mPartRefs.clear();
+	mFreePartRefs.clear();
 	
+	LLViewerPartSim::sParticleCount2 -= count;
 	LLViewerPartSim::decPartCount(count);
 }
 
@@ -236,19 +225,19 @@ BOOL LLViewerPartGroup::posInGroup(const LLVector3 &pos, const F32 desired_size)
 }
 
 
-BOOL LLViewerPartGroup::addPart(LLViewerPart* part, F32 desired_size)
+BOOL LLViewerPartGroup::addPart(const LLViewerPart& part, F32 desired_size)
 {
 	LLMemType mt(LLMemType::MTYPE_PARTICLES);
 
-	if (part->mFlags & LLPartData::LL_PART_HUD && !mHud)
+	if (part.mFlags & LLPartData::LL_PART_HUD && !mHud)
 	{
 		return FALSE;
 	}
 
-	BOOL uniform_part = part->mScale.mV[0] == part->mScale.mV[1] && 
-					!(part->mFlags & LLPartData::LL_PART_FOLLOW_VELOCITY_MASK);
+	BOOL uniform_part = part.mScale.mV[0] == part.mScale.mV[1] && 
+					!(part.mFlags & LLPartData::LL_PART_FOLLOW_VELOCITY_MASK);
 
-	if (!posInGroup(part->mPosAgent, desired_size) ||
+	if (!posInGroup(part.mPosAgent, desired_size) ||
 		(mUniformParticles && !uniform_part) ||
 		(!mUniformParticles && uniform_part))
 	{
@@ -257,150 +246,113 @@ BOOL LLViewerPartGroup::addPart(LLViewerPart* part, F32 desired_size)
 
 	gPipeline.markRebuild(mVOPartGroupp->mDrawable, LLDrawable::REBUILD_ALL, TRUE);
 	
-	mParticles.push_back(part);
-	part->mSkipOffset=mSkippedTime;
+	S32 slot;
+	if (!mFreePartRefs.empty())
+	{
+		slot = mFreePartRefs.back();
+		mFreePartRefs.pop_back();
+	}
+	else
+	{
+		slot = (S32)mPartRefs.size();
+		mPartRefs.push_back(PartRef());
+	}
+
+	bool complex = part.mVPCallback || (part.mFlags & LLPartStore::COMPLEX_MASK);
+	S32 index = mParticles.add(part, complex);
+	mParticles.mSlot[index] = slot;
+	setPart(index, part);
+	mParticles.mSkipOffset[index] = mSkippedTime;
+	++LLViewerPartSim::sParticleCount2;
 	LLViewerPartSim::incPartCount(1);
 	return TRUE;
 }
 
-
-void LLViewerPartGroup::updateParticles(const F32 lastdt)
+void LLViewerPartGroup::getPart(S32 index, LLViewerPart& part) const
 {
-	LLMemType mt(LLMemType::MTYPE_PARTICLES);
-	F32 dt;
-	
-	LLVector3 gravity(0.f, 0.f, GRAVITY);
-
-	LLViewerPartSim::checkParticleCount(mParticles.size());
-
-	LLViewerRegion *regionp = getRegion();
-	S32 end = (S32) mParticles.size();
-	for (S32 i = 0 ; i < (S32)mParticles.size();)
-	{
-		LLVector3 a(0.f, 0.f, 0.f);
-		LLViewerPart* part = mParticles[i] ;
-
-		dt = lastdt + mSkippedTime - part->mSkipOffset;
-		part->mSkipOffset = 0.f;
-
-		// Update current time
-		const F32 cur_time = part->mLastUpdateTime + dt;
-		const F32 frac = cur_time / part->mMaxAge;
-
-		// "Drift" the object based on the source object
-		if (part->mFlags & LLPartData::LL_PART_FOLLOW_SRC_MASK)
-		{
-			part->mPosAgent = part->mPartSourcep->mPosAgent;
-			part->mPosAgent += part->mPosOffset;
-		}
-
-		// Do a custom callback if we have one...
-		if (part->mVPCallback)
-		{
-			(*part->mVPCallback)(*part, dt);
-		}
-
-		if (part->mFlags & LLPartData::LL_PART_WIND_MASK)
-		{
-			LLVector3 tempVel(part->mVelocity);
-			part->mVelocity *= 1.f - 0.1f*dt;
-			part->mVelocity += 0.1f*dt*regionp->mWind.getVelocity(regionp->getPosRegionFromAgent(part->mPosAgent));
-		}
-
-		// Now do interpolation towards a target
-		if (part->mFlags & LLPartData::LL_PART_TARGET_POS_MASK)
-		{
-			F32 remaining = part->mMaxAge - part->mLastUpdateTime;
-			F32 step = dt / remaining;
-
-			step = llclamp(step, 0.f, 0.1f);
-			step *= 5.f;
-			// we want a velocity that will result in reaching the target in the 
-			// Interpolate towards the target.
-			LLVector3 delta_pos = part->mPartSourcep->mTargetPosAgent - part->mPosAgent;
-
-			delta_pos /= remaining;
-
-			part->mVelocity *= (1.f - step);
-			part->mVelocity += step*delta_pos;
-		}
-
+	mParticles.getPartData(index, part);
+	const PartRef& ref = mPartRefs[mParticles.mSlot[index]];
+	part.mPartID = ref.mPartID;
+	part.mVPCallback = ref.mVPCallback;
+	part.mPartSourcep = ref.mPartSourcep;
+	part.mImagep = ref.mImagep;
+	part.mLastUpdateTime = mParticles.mAge[index];
+	part.mSkipOffset = mParticles.mSkipOffset[index];
+	part.mPosAgent = mParticles.mPosAgent[index];
+	part.mVelocity = mParticles.mVelocity[index];
+	part.mAccel = mParticles.mAccel[index];
+	part.mColor = mParticles.mColor[index];
+	part.mScale = mParticles.mScale[index];
+}
 
-		if (part->mFlags & LLPartData::LL_PART_TARGET_LINEAR_MASK)
-		{
-			LLVector3 delta_pos = part->mPartSourcep->mTargetPosAgent - part->mPartSourcep->mPosAgent;			
-			part->mPosAgent = part->mPartSourcep->mPosAgent;
-			part->mPosAgent += frac*delta_pos;
-			part->mVelocity = delta_pos;
-		}
-		else
-		{
-			// Do velocity interpolation
-			part->mPosAgent += dt*part->mVelocity;
-			part->mPosAgent += 0.5f*dt*dt*part->mAccel;
-			part->mVelocity += part->mAccel*dt;
-		}
+void LLViewerPartGroup::setPart(S32 index, const LLViewerPart& part)
+{
+	mParticles.setPartData(index, part);
+	PartRef& ref = mPartRefs[mParticles.mSlot[index]];
+	ref.mPartID = part.mPartID;
+	ref.mVPCallback = part.mVPCallback;
+	ref.mPartSourcep = part.mPartSourcep;
+	ref.mImagep = part.mImagep;
+	mParticles.mAge[index] = part.mLastUpdateTime;
+	mParticles.mSkipOffset[index] = part.mSkipOffset;
+	mParticles.mPosAgent[index] = part.mPosAgent;
+	mParticles.mVelocity[index] = part.mVelocity;
+	mParticles.mAccel[index] = part.mAccel;
+	mParticles.mColor[index] = part.mColor;
+	mParticles.mScale[index] = part.mScale;
+}
 
-		// Do a bounce test
-		if (part->mFlags & LLPartData::LL_PART_BOUNCE_MASK)
-		{
-			// Need to do point vs. plane check...
-			// For now, just check relative to object height...
-			F32 dz = part->mPosAgent.mV[VZ] - part->mPartSourcep->mPosAgent.mV[VZ];
-			if (dz < 0)
-			{
-				part->mPosAgent.mV[VZ] += -2.f*dz;
-				part->mVelocity.mV[VZ] *= -0.75f;
-			}
-		}
+void LLViewerPartGroup::removePart(S32 index)
+{
+	S32 slot = mParticles.mSlot[index];
+	PartRef& ref = mPartRefs[slot];
+	ref.mVPCallback = NULL;
+	ref.mPartSourcep = NULL;
+	ref.mImagep = NULL;
+	mFreePartRefs.push_back(slot);
+	mParticles.remove(index);
+	--LLViewerPartSim::sParticleCount2;
+}
 
 
-		// Reset the offset from the source position
-		if (part->mFlags & LLPartData::LL_PART_FOLLOW_SRC_MASK)
-		{
-			part->mPosOffset = part->mPosAgent;
-			part->mPosOffset -= part->mPartSourcep->mPosAgent;
-		}
+void LLViewerPartGroup::updateParticles(const F32 lastdt)
+{
+	LLMemType mt(LLMemType::MTYPE_PARTICLES);
 
-		// Do color interpolation
-		if (part->mFlags & LLPartData::LL_PART_INTERP_COLOR_MASK)
-		{
-			part->mColor.setVec(part->mStartColor);
-			// note: LLColor4's v%k means multiply-alpha-only,
-			//       LLColor4's v*k means multiply-rgb-only
-			part->mColor *= 1.f - frac; // rgb*k
-			part->mColor %= 1.f - frac; // alpha*k
-			part->mColor += frac%(frac*part->mEndColor); // rgb,alpha
-		}
+	LLViewerPartSim::checkParticleCount(mParticles.size());
 
-		// Do scale interpolation
-		if (part->mFlags & LLPartData::LL_PART_INTERP_SCALE_MASK)
-		{
-			part->mScale.setVec(part->mStartScale);
-			part->mScale *= 1.f - frac;
-			part->mScale += frac*part->mEndScale;
-		}
+	S32 end = mParticles.size();
 
-		// Set the last update time to now.
-		part->mLastUpdateTime = cur_time;
+	// Particles without callbacks or per-particle behaviors, all at once
+	mParticles.updateSimple(lastdt, mSkippedTime);
 
+	// The rest one at a time
+	LLViewerPart part;
+	for (S32 i = mParticles.getNumSimple(); i < mParticles.size(); i++)
+	{
+		getPart(i, part);
+		F32 dt = lastdt + mSkippedTime - part.mSkipOffset;
+		part.mSkipOffset = 0.f;
+		updateComplexPart(part, dt);
+		setPart(i, part);
+	}
 
+	for (S32 i = 0 ; i < mParticles.size();)
+	{
 		// Kill dead particles (either flagged dead, or too old)
-		if ((part->mLastUpdateTime > part->mMaxAge) || (LLViewerPart::LL_PART_DEAD_MASK == part->mFlags))
+		if ((mParticles.mAge[i] > mParticles.mMaxAge[i]) || (LLViewerPart::LL_PART_DEAD_MASK == mParticles.mFlags[i]))
 		{
-			mParticles[i] = mParticles.back() ;
-			mParticles.pop_back() ;
-			delete part ;
+			removePart(i);
 		}
 		else 
 		{
-			F32 desired_size = calc_desired_size(part->mPosAgent, part->mScale);
-			if (!posInGroup(part->mPosAgent, desired_size))
+			F32 desired_size = calc_desired_size(mParticles.mPosAgent[i], mParticles.mScale[i]);
+			if (!posInGroup(mParticles.mPosAgent[i], desired_size))
 			{
 				// Transfer particles between groups
+				getPart(i, part);
+				removePart(i);
 				LLViewerPartSim::getInstance()->put(part) ;
-				mParticles[i] = mParticles.back() ;
-				mParticles.pop_back() ;
 			}
 			else
 			{
@@ -409,7 +361,7 @@ void LLViewerPartGroup::updateParticles(const F32 lastdt)
 		}
 	}
 
-	S32 removed = end - (S32)mParticles.size();
+	S32 removed = end - mParticles.size();
 	if (removed > 0)
 	{
 		// we removed one or more particles, so flag this group for update
@@ -430,6 +382,113 @@ void LLViewerPartGroup::updateParticles(const F32 lastdt)
 	LLViewerPartSim::checkParticleCount() ;
 }
 
+// Full update of one particle, for the ones LLPartStore::updateSimple() skips
+void LLViewerPartGroup::updateComplexPart(LLViewerPart& part, const F32 dt)
+{
+	LLViewerRegion *regionp = getRegion();
+
+	// Update current time
+	const F32 cur_time = part.mLastUpdateTime + dt;
+	const F32 frac = cur_time / part.mMaxAge;
+
+	// "Drift" the object based on the source object
+	if (part.mFlags & LLPartData::LL_PART_FOLLOW_SRC_MASK)
+	{
+		part.mPosAgent = part.mPartSourcep->mPosAgent;
+		part.mPosAgent += part.mPosOffset;
+	}
+
+	// Do a custom callback if we have one...
+	if (part.mVPCallback)
+	{
+		(*part.mVPCallback)(part, dt);
+	}
+
+	if (part.mFlags & LLPartData::LL_PART_WIND_MASK)
+	{
+		LLVector3 tempVel(part.mVelocity);
+		part.mVelocity *= 1.f - 0.1f*dt;
+		part.mVelocity += 0.1f*dt*regionp->mWind.getVelocity(regionp->getPosRegionFromAgent(part.mPosAgent));
+	}
+
+	// Now do interpolation towards a target
+	if (part.mFlags & LLPartData::LL_PART_TARGET_POS_MASK)
+	{
+		F32 remaining = part.mMaxAge - part.mLastUpdateTime;
+		F32 step = dt / remaining;
+
+		step = llclamp(step, 0.f, 0.1f);
+		step *= 5.f;
+		// we want a velocity that will result in reaching the target in the 
+		// Interpolate towards the target.
+		LLVector3 delta_pos = part.mPartSourcep->mTargetPosAgent - part.mPosAgent;
+
+		delta_pos /= remaining;
+
+		part.mVelocity *= (1.f - step);
+		part.mVelocity += step*delta_pos;
+	}
+
+
+	if (part.mFlags & LLPartData::LL_PART_TARGET_LINEAR_MASK)
+	{
+		LLVector3 delta_pos = part.mPartSourcep->mTargetPosAgent - part.mPartSourcep->mPosAgent;			
+		part.mPosAgent = part.mPartSourcep->mPosAgent;
+		part.mPosAgent += frac*delta_pos;
+		part.mVelocity = delta_pos;
+	}
+	else
+	{
+		// Do velocity interpolation
+		part.mPosAgent += dt*part.mVelocity;
+		part.mPosAgent += 0.5f*dt*dt*part.mAccel;
+		part.mVelocity += part.mAccel*dt;
+	}
+
+	// Do a bounce test
+	if (part.mFlags & LLPartData::LL_PART_BOUNCE_MASK)
+	{
+		// Need to do point vs. plane check...
+		// For now, just check relative to object height...
+		F32 dz = part.mPosAgent.mV[VZ] - part.mPartSourcep->mPosAgent.mV[VZ];
+		if (dz < 0)
+		{
+			part.mPosAgent.mV[VZ] += -2.f*dz;
+			part.mVelocity.mV[VZ] *= -0.75f;
+		}
+	}
+
+
+	// Reset the offset from the source position
+	if (part.mFlags & LLPartData::LL_PART_FOLLOW_SRC_MASK)
+	{
+		part.mPosOffset = part.mPosAgent;
+		part.mPosOffset -= part.mPartSourcep->mPosAgent;
+	}
+
+	// Do color interpolation
+	if (part.mFlags & LLPartData::LL_PART_INTERP_COLOR_MASK)
+	{
+		part.mColor.setVec(part.mStartColor);
+		// note: LLColor4's v%k means multiply-alpha-only,
+		//       LLColor4's v*k means multiply-rgb-only
+		part.mColor *= 1.f - frac; // rgb*k
+		part.mColor %= 1.f - frac; // alpha*k
+		part.mColor += frac%(frac*part.mEndColor); // rgb,alpha
+	}
+
+	// Do scale interpolation
+	if (part.mFlags & LLPartData::LL_PART_INTERP_SCALE_MASK)
+	{
+		part.mScale.setVec(part.mStartScale);
+		part.mScale *= 1.f - frac;
+		part.mScale += frac*part.mEndScale;
+	}
+
+	// Set the last update time to now.
+	part.mLastUpdateTime = cur_time;
+}
+
 
 void LLViewerPartGroup::shift(const LLVector3 &offset)
 {
@@ -438,9 +497,9 @@ void LLViewerPartGroup::shift(const LLVector3 &offset)
 	mMinObjPos += offset;
 	mMaxObjPos += offset;
 
-	for (S32 i = 0 ; i < (S32)mParticles.size(); i++)
+	for (S32 i = 0 ; i < mParticles.size(); i++)
 	{
-		mParticles[i]->mPosAgent += offset;
+		mParticles.mPosAgent[i] += offset;
 	}
 }
 
@@ -448,11 +507,11 @@ void LLViewerPartGroup::removeParticlesByID(const U32 source_id)
 {
 	LLMemType mt(LLMemType::MTYPE_PARTICLES);
 
-	for (S32 i = 0; i < (S32)mParticles.size(); i++)
+	for (S32 i = 0; i < mParticles.size(); i++)
 	{
-		if(mParticles[i]->mPartSourcep->getID() == source_id)
+		if(mPartRefs[mParticles.mSlot[i]].mPartSourcep->getID() == source_id)
 		{
-			mParticles[i]->mFlags = LLViewerPart::LL_PART_DEAD_MASK;
+			mParticles.mFlags[i] = LLViewerPart::LL_PART_DEAD_MASK;
 		}		
 	}
 }
@@ -527,37 +586,31 @@ BOOL LLViewerPartSim::shouldAddPart()
 	return TRUE;
 }
 
-void LLViewerPartSim::addPart(LLViewerPart* part)
+void LLViewerPartSim::addPart(const LLViewerPart& part)
 {
 	LLMemType mt(LLMemType::MTYPE_PARTICLES);
 	if (sParticleCount < MAX_PART_COUNT)
 	{
 		put(part);
 	}
-	else
-	{
-		//delete the particle if can not add it in
-		delete part ;
-		part = NULL ;
-	}
 }
 
 
-LLViewerPartGroup *LLViewerPartSim::put(LLViewerPart* part)
+LLViewerPartGroup *LLViewerPartSim::put(const LLViewerPart& part)
 {
 	LLMemType mt(LLMemType::MTYPE_PARTICLES);
 	const F32 MAX_MAG = 1000000.f*1000000.f; // 1 million
 	LLViewerPartGroup *return_group = NULL ;
-	if (part->mPosAgent.magVecSquared() > MAX_MAG || !part->mPosAgent.isFinite())
+	if (part.mPosAgent.magVecSquared() > MAX_MAG || !part.mPosAgent.isFinite())
 	{
 #if 0 && !LL_RELEASE_FOR_DOWNLOAD
 		llwarns << "LLViewerPartSim::put Part out of range!" << llendl;
-		llwarns << part->mPosAgent << llendl;
+		llwarns << part.mPosAgent << llendl;
 #endif
 	}
 	else
 	{	
-		F32 desired_size = calc_desired_size(part->mPosAgent, part->mScale);
+		F32 desired_size = calc_desired_size(part.mPosAgent, part.mScale);
 
 		S32 count = (S32) mViewerPartGroups.size();
 		for (S32 i = 0; i < count; i++)
@@ -574,15 +627,15 @@ LLViewerPartGroup *LLViewerPartSim::put(LLViewerPart* part)
 		// Create a new one...
 		if(!return_group)
 		{
-			llassert_always(part->mPosAgent.isFinite());
-			LLViewerPartGroup *groupp = createViewerPartGroup(part->mPosAgent, desired_size, part->mFlags & LLPartData::LL_PART_HUD);
-			groupp->mUniformParticles = (part->mScale.mV[0] == part->mScale.mV[1] && 
-									!(part->mFlags & LLPartData::LL_PART_FOLLOW_VELOCITY_MASK));
+			llassert_always(part.mPosAgent.isFinite());
+			LLViewerPartGroup *groupp = createViewerPartGroup(part.mPosAgent, desired_size, part.mFlags & LLPartData::LL_PART_HUD);
+			groupp->mUniformParticles = (part.mScale.mV[0] == part.mScale.mV[1] && 
+									!(part.mFlags & LLPartData::LL_PART_FOLLOW_VELOCITY_MASK));
 			if (!groupp->addPart(part))
 			{
 				llwarns << "LLViewerPartSim::put - Particle didn't go into its box!" << llendl;
 				llinfos << groupp->getCenterAgent() << llendl;
-				llinfos << part->mPosAgent << llendl;
+				llinfos << part.mPosAgent << llendl;
 				mViewerPartGroups.pop_back() ;
 				delete groupp;
 				groupp = NULL ;
@@ -591,12 +644,7 @@ LLViewerPartGroup *LLViewerPartSim::put(LLViewerPart* part)
 		}
 	}
 
-	if(!return_group) //failed to insert the particle
-	{
-		delete part ;
-		part = NULL ;
-	}
-
+	// if no group took the particle, it is dropped
 	return return_group ;
 }
 
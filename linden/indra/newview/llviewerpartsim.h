@@ -37,6 +37,7 @@
 #include "llframetimer.h"
 #include "llmemory.h"
 #include "llpartdata.h"
+#include "llpartstore.h"
 #include "llviewerpartsource.h"
 
 class LLViewerImage;
@@ -49,14 +50,13 @@ typedef void (*LLVPCallback)(LLViewerPart &part, const F32 dt);
 
 ///////////////////
 //
-// An individual particle
+// An individual particle, as created by a particle source and as seen by
+// its callback.  Particle groups keep their particles in an LLPartStore.
 //
 
 
 class LLViewerPart : public LLPartData
 {
-public:
-	~LLViewerPart();
 public:
 	LLViewerPart();
 
@@ -94,7 +94,7 @@ public:
 
 	void cleanup();
 
-	BOOL addPart(LLViewerPart* part, const F32 desired_size = -1.f);
+	BOOL addPart(const LLViewerPart& part, const F32 desired_size = -1.f);
 	
 	void updateParticles(const F32 lastdt);
 
@@ -102,12 +102,17 @@ public:
 
 	void shift(const LLVector3 &offset);
 
-	typedef std::vector<LLViewerPart*>  part_list_t;
-	part_list_t mParticles;
+	// Copy a particle out of and back into mParticles
+	void getPart(S32 index, LLViewerPart& part) const;
+	void setPart(S32 index, const LLViewerPart& part);
+	void removePart(S32 index);
+
+	LLPartStore mParticles;
 
 	const LLVector3 &getCenterAgent() const		{ return mCenterAgent; }
-	S32 getCount() const					{ return (S32) mParticles.size(); }
+	S32 getCount() const					{ return mParticles.size(); }
 	LLViewerRegion *getRegion() const		{ return mRegionp; }
+	LLViewerImage* getPartImage(S32 index) const	{ return mPartRefs[mParticles.mSlot[index]].mImagep; }
 
 	void removeParticlesByID(const U32 source_id);
 	
@@ -120,12 +125,26 @@ public:
 	bool mHud;
 
 protected:
+	void updateComplexPart(LLViewerPart& part, const F32 dt);
+
 	LLVector3 mCenterAgent;
 	F32 mBoxRadius;
 	LLVector3 mMinObjPos;
 	LLVector3 mMaxObjPos;
 
 	LLViewerRegion *mRegionp;
+
+	// Particle data the update kernel has no use for, indexed by
+	// LLPartStore::mSlot.  Freed entries are reused.
+	struct PartRef
+	{
+		U32 mPartID;
+		LLVPCallback mVPCallback;
+		LLPointer<LLViewerPartSource> mPartSourcep;
+		LLPointer<LLViewerImage> mImagep;
+	};
+	std::vector<PartRef> mPartRefs;
+	std::vector<S32> mFreePartRefs;
 };
 
 class LLViewerPartSim : public LLSingleton<LLViewerPartSim>
@@ -161,7 +180,7 @@ public:
 	}
 	F32 getRefRate() { return sParticleAdaptiveRate; }
 	F32 getBurstRate() {return sParticleBurstRate; }
-	void addPart(LLViewerPart* part);
+	void addPart(const LLViewerPart& part);
 	void updatePartBurstRate() ;
 	void clearParticlesByID(const U32 system_id);
 	void clearParticlesByOwnerID(const LLUUID& task_id);
@@ -182,7 +201,7 @@ public:
 
 protected:
 	LLViewerPartGroup *createViewerPartGroup(const LLVector3 &pos_agent, const F32 desired_size, bool hud);
-	LLViewerPartGroup *put(LLViewerPart* part);
+	LLViewerPartGroup *put(const LLViewerPart& part);
 
 	group_list_t mViewerPartGroups;
 	source_list_t mViewerPartSources;
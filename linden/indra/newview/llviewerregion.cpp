@@ -67,11 +67,6 @@
 #include "llspatialpartition.h"
 #include "llviewerparcelmgr.h"
 
-// Viewer object cache version, change if object update
-// format changes. JC
-const U32 INDRA_OBJECT_CACHE_VERSION = 14;
-
-
 extern BOOL gNoRender;
 
 const F32 WATER_TEXTURE_SCALE = 8.f;			//  Number of times to repeat the water texture across a region
@@ -288,81 +283,15 @@ void LLViewerRegion::loadCache()
 		return;
 	}
 
-	// Presume success.  If it fails, we don't want to try again.
+	// Objects are fetched from the object cache as the simulator asks for
+	// them, all that is left to do here is check the cache id.
 	mCacheLoaded = TRUE;
 
-	LLVOCacheEntry *entry;
-
-	std::string filename;
-	filename = gDirUtilp->getExpandedFilename(LL_PATH_CACHE,"") + gDirUtilp->getDirDelimiter() +
-		llformat("objects_%d_%d.slc",U32(mHandle>>32)/REGION_WIDTH_UNITS, U32(mHandle)/REGION_WIDTH_UNITS );
-
-	LLFILE* fp = LLFile::fopen(filename, "rb");		/* Flawfinder: ignore */
-	if (!fp)
+	LLVOCache* cache = LLVOCache::getInstance();
+	if (cache)
 	{
-		// might not have a file, which is normal
-		return;
-	}
-
-	U32 zero;
-	size_t nread;
-	nread = fread(&zero, sizeof(U32), 1, fp);
-	if (nread != 1 || zero)
-	{
-		// a non-zero value here means bad things!
-		// skip reading the cached values
-		llinfos << "Cache file invalid" << llendl;
-		fclose(fp);
-		return;
-	}
-
-	U32 version;
-	nread = fread(&version, sizeof(U32), 1, fp);
-	if (nread != 1 || version != INDRA_OBJECT_CACHE_VERSION)
-	{
-		// a version mismatch here means we've changed the binary format!
-		// skip reading the cached values
-		llinfos << "Cache version changed, discarding" << llendl;
-		fclose(fp);
-		return;
-	}
-
-	LLUUID cache_id;
-	nread = fread(&cache_id.mData, 1, UUID_BYTES, fp);
-	if (nread != (size_t)UUID_BYTES || mCacheID != cache_id)
-	{
-		llinfos << "Cache ID doesn't match for this region, discarding"
-			<< llendl;
-		fclose(fp);
-		return;
+		cache->setRegionCacheID(mHandle, mCacheID);
 	}
-
-	S32 num_entries;
-	nread = fread(&num_entries, sizeof(S32), 1, fp);
-	if (nread != 1)
-	{
-		llinfos << "Short read, discarding" << llendl;
-		fclose(fp);
-		return;
-	}
-	
-	S32 i;
-	for (i = 0; i < num_entries; i++)
-	{
-		entry = new LLVOCacheEntry(fp);
-		if (!entry->getLocalID())
-		{
-			llwarns << "Aborting cache file load for " << filename << ", cache file corruption!" << llendl;
-			delete entry;
-			entry = NULL;
-			break;
-		}
-		mCacheEnd.insert(*entry);
-		mCacheMap[entry->getLocalID()] = entry;
-		mCacheEntriesCount++;
-	}
-
-	fclose(fp);
 }
 
 
@@ -379,47 +308,21 @@ void LLViewerRegion::saveCache()
 		return;
 	}
 
-	std::string filename;
-	filename = gDirUtilp->getExpandedFilename(LL_PATH_CACHE,"") + gDirUtilp->getDirDelimiter() +
-		llformat("objects_%d_%d.slc", U32(mHandle>>32)/REGION_WIDTH_UNITS, U32(mHandle)/REGION_WIDTH_UNITS );
-
-	LLFILE* fp = LLFile::fopen(filename, "wb");		/* Flawfinder: ignore */
-	if (!fp)
-	{
-		llwarns << "Unable to write cache file " << filename << llendl;
-		return;
-	}
-
-	// write out zero to indicate a version cache file
-	U32 zero = 0;
-	if (fwrite(&zero, sizeof(U32), 1, fp) != 1)
-	{
-		llwarns << "Short write" << llendl;
-	}
-
-	// write out version number
-	U32 version = INDRA_OBJECT_CACHE_VERSION;
-	if (fwrite(&version, sizeof(U32), 1, fp) != 1)
-	{
-		llwarns << "Short write" << llendl;
-	}
-
-	// write the cache id for this sim
-	if (fwrite(&mCacheID.mData, 1, UUID_BYTES, fp) != (size_t)UUID_BYTES)
-	{
-		llwarns << "Short write" << llendl;
-	}
-
-	if (fwrite(&num_entries, sizeof(S32), 1, fp) != 1)
-	{
-		llwarns << "Short write" << llendl;
-	}
-
 	LLVOCacheEntry *entry;
 
-	for (entry = mCacheStart.getNext(); entry && (entry != &mCacheEnd); entry = entry->getNext())
+	// Only new and changed objects are written back, on the cache thread
+	LLVOCache* cache = LLVOCache::getInstance();
+	if (cache)
 	{
-		entry->writeToFile(fp);
+		std::vector<LLVOCacheEntry*> entries;
+		for (entry = mCacheStart.getNext(); entry && (entry != &mCacheEnd); entry = entry->getNext())
+		{
+			if (entry->isDirty())
+			{
+				entries.push_back(entry);
+			}
+		}
+		cache->write(mHandle, mCacheID, entries);
 	}
 
 	mCacheMap.clear();
@@ -427,8 +330,6 @@ void LLViewerRegion::saveCache()
 	mCacheEnd.init();
 	mCacheStart.deleteAll();
 	mCacheStart.init();
-
-	fclose(fp);
 }
 
 void LLViewerRegion::sendMessage()
@@ -802,6 +703,7 @@ void LLViewerRegion::updateNetStats()
 {
 	F32 dt = mLastNetUpdate.getElapsedTimeAndResetF32();
 
+	LLMessageSystem::LLCircuitLock lock(gMessageSystem);
 	LLCircuitData *cdp = gMessageSystem->mCircuitInfo.findCircuit(mHost);
 	if (!cdp)
 	{
@@ -831,6 +733,7 @@ void LLViewerRegion::updateNetStats()
 
 U32 LLViewerRegion::getPacketsLost() const
 {
+	LLMessageSystem::LLCircuitLock lock(gMessageSystem);
 	LLCircuitData *cdp = gMessageSystem->mCircuitInfo.findCircuit(mHost);
 	if (!cdp)
 	{
@@ -1121,20 +1024,29 @@ void LLViewerRegion::cacheFullUpdate(LLViewerObject* objectp, LLDataPackerBinary
 		// we haven't seen this object before
 
 		// Create new entry and add to map
-		if (mCacheEntriesCount > MAX_OBJECT_CACHE_ENTRIES)
+		addCacheEntry(new LLVOCacheEntry(local_id, crc, dp));
+	}
+	return ;
+}
+
+void LLViewerRegion::addCacheEntry(LLVOCacheEntry* entry)
+{
+	if (mCacheEntriesCount > MAX_OBJECT_CACHE_ENTRIES)
+	{
+		LLVOCacheEntry* oldest = mCacheStart.getNext();
+		LLVOCache* cache = LLVOCache::getInstance();
+		if (cache && oldest->isDirty())
 		{
-			entry = mCacheStart.getNext();
-			mCacheMap.erase(entry->getLocalID());
-			delete entry;
-			mCacheEntriesCount--;
+			cache->write(mHandle, mCacheID, std::vector<LLVOCacheEntry*>(1, oldest));
 		}
-		entry = new LLVOCacheEntry(local_id, crc, dp);
-
-		mCacheEnd.insert(*entry);
-		mCacheMap[local_id] = entry;
-		mCacheEntriesCount++;
+		mCacheMap.erase(oldest->getLocalID());
+		delete oldest;
+		mCacheEntriesCount--;
 	}
-	return ;
+
+	mCacheEnd.insert(*entry);
+	mCacheMap[entry->getLocalID()] = entry;
+	mCacheEntriesCount++;
 }
 
 // Get data packer for this object, if we have cached data
@@ -1145,6 +1057,24 @@ LLDataPacker *LLViewerRegion::getDP(U32 local_id, U32 crc)
 
 	LLVOCacheEntry* entry = get_if_there(mCacheMap, local_id, (LLVOCacheEntry*)NULL);
 
+	if (!entry)
+	{
+		// not used this session yet, look in the object cache
+		LLVOCache* cache = LLVOCache::getInstance();
+		bool crc_miss = false;
+		entry = cache ? cache->fetch(mHandle, local_id, crc, crc_miss) : NULL;
+		if (entry)
+		{
+			addCacheEntry(entry);
+		}
+		else if (crc_miss)
+		{
+			// llinfos << "CRC miss for " << local_id << llendl;
+			mCacheMissCRC.put(local_id);
+			return NULL;
+		}
+	}
+
 	if (entry)
 	{
 		// we've seen this object before
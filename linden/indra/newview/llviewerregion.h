@@ -301,6 +301,8 @@ protected:
 	void disconnectAllNeighbors();
 	void initStats();
 	void setFlags(BOOL b, U32 flags);
+	// Adds to the objects used this session, dropping the oldest if full
+	void addCacheEntry(LLVOCacheEntry* entry);
 
 public:
 	LLWind  mWind;
@@ -37,6 +37,8 @@
 
 #include "message.h"
 #include "lltimer.h"
+#include "llprimitive.h"
+#include "llvolumemgr.h"
 
 #include "llappviewer.h"
 
@@ -231,6 +233,8 @@ void LLViewerStats::resetStats()
 	LLViewerStats::getInstance()->mObjectKBitStat.reset();
 	LLViewerStats::getInstance()->mTextureKBitStat.reset();
 	LLViewerStats::getInstance()->mVFSPendingOperations.reset();
+	LLViewerStats::getInstance()->mVolumeBuildQueueStat.reset();
+	LLViewerStats::getInstance()->mVolumeBuildMsecStat.reset();
 	LLViewerStats::getInstance()->mAssetKBitStat.reset();
 	LLViewerStats::getInstance()->mPacketsInStat.reset();
 	LLViewerStats::getInstance()->mPacketsLostStat.reset();
@@ -549,16 +553,19 @@ void update_statistics(U32 frame_count)
 	LLViewerStats::getInstance()->setStat(LLViewerStats::ST_REBUILD_SECS, gDebugView->mFastTimerView->getTime(LLFastTimer::FTM_STATESORT ));
 	LLViewerStats::getInstance()->setStat(LLViewerStats::ST_RENDER_SECS, gDebugView->mFastTimerView->getTime(LLFastTimer::FTM_RENDER_GEOMETRY));
 		
-	LLCircuitData *cdp = gMessageSystem->mCircuitInfo.findCircuit(gAgent.getRegion()->getHost());
-	if (cdp)
 	{
-		LLViewerStats::getInstance()->mSimPingStat.addValue(cdp->getPingDelay());
-		gAvgSimPing = ((gAvgSimPing * (F32)gSimPingCount) + (F32)(cdp->getPingDelay())) / ((F32)gSimPingCount + 1);
-		gSimPingCount++;
-	}
-	else
-	{
-		LLViewerStats::getInstance()->mSimPingStat.addValue(10000);
+		LLMessageSystem::LLCircuitLock lock(gMessageSystem);
+		LLCircuitData *cdp = gMessageSystem->mCircuitInfo.findCircuit(gAgent.getRegion()->getHost());
+		if (cdp)
+		{
+			LLViewerStats::getInstance()->mSimPingStat.addValue(cdp->getPingDelay());
+			gAvgSimPing = ((gAvgSimPing * (F32)gSimPingCount) + (F32)(cdp->getPingDelay())) / ((F32)gSimPingCount + 1);
+			gSimPingCount++;
+		}
+		else
+		{
+			LLViewerStats::getInstance()->mSimPingStat.addValue(10000);
+		}
 	}
 
 	LLViewerStats::getInstance()->mFPSStat.addValue(1);
@@ -566,6 +573,10 @@ void update_statistics(U32 frame_count)
 	LLViewerStats::getInstance()->mLayersKBitStat.addValue(layer_bits/1024.f);
 	LLViewerStats::getInstance()->mObjectKBitStat.addValue(gObjectBits/1024.f);
 	LLViewerStats::getInstance()->mVFSPendingOperations.addValue(LLVFile::getVFSThread()->getPending());
+	LLVolumeMgr* volume_mgr = LLPrimitive::getVolumeManager();
+	S32 volume_builds = 0;
+	LLViewerStats::getInstance()->mVolumeBuildQueueStat.addValue(volume_mgr->getNumPendingBuilds());
+	LLViewerStats::getInstance()->mVolumeBuildMsecStat.addValue(volume_mgr->getBuildTime(volume_builds) * 1000.f);
 	LLViewerStats::getInstance()->mAssetKBitStat.addValue(gTransferManager.getTransferBitsIn(LLTCT_ASSET)/1024.f);
 	gTransferManager.resetTransferBitsIn(LLTCT_ASSET);
 
@@ -45,6 +45,8 @@ public:
 	LLStat mAssetKBitStat;
 	LLStat mTextureKBitStat;
 	LLStat mVFSPendingOperations;
+	LLStat mVolumeBuildQueueStat;
+	LLStat mVolumeBuildMsecStat;	// worker time per frame spent building volumes
 	LLStat mObjectsDrawnStat;
 	LLStat mObjectsCulledStat;
 	LLStat mObjectsTestedStat;
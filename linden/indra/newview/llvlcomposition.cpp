@@ -92,6 +92,34 @@ LLVLComposition::LLVLComposition(LLSurface *surfacep, const U32 width, const F32
 
 LLVLComposition::~LLVLComposition()
 {
+	if (sCompositeThread)
+	{
+		for (pending_tile_map_t::iterator iter = mPendingTiles.begin(); iter != mPendingTiles.end(); ++iter)
+		{
+			sCompositeThread->abandon(iter->second.mHandle);
+		}
+	}
+	mPendingTiles.clear();
+}
+
+// static
+void LLVLComposition::initClass(bool threaded)
+{
+	if (threaded && !sCompositeThread)
+	{
+		sCompositeThread = new LLTerrainCompositeThread(true);
+	}
+}
+
+// static
+void LLVLComposition::cleanupClass()
+{
+	if (sCompositeThread)
+	{
+		sCompositeThread->shutdown();
+		delete sCompositeThread;
+		sCompositeThread = NULL;
+	}
 }
 
 
@@ -110,6 +138,7 @@ void LLVLComposition::setDetailTextureID(S32 corner, const LLUUID& id)
 	mDetailTextures[corner] = gImageList.getImage(id);
 	mDetailTextures[corner]->setNoDelete() ;
 	mRawImages[corner] = NULL;
+	invalidatePendingTiles();
 }
 
 void LLVLComposition::setDetailTextureID(S32 corner, const std::string& filename, const bool& usemipmap, const bool& levelimmediate,  LLGLint internal_format, LLGLenum primary_format, const LLUUID& force_id)
@@ -121,6 +150,16 @@ void LLVLComposition::setDetailTextureID(S32 corner, const std::string& filename
 	mDetailTextures[corner] = gImageList.getImageFromFile(filename, usemipmap, levelimmediate, internal_format, primary_format, force_id);
 	mDetailTextures[corner]->setNoDelete() ;
 	mRawImages[corner] = NULL;
+	invalidatePendingTiles();
+}
+
+// Tiles on the compositing thread were blended from the old detail images
+void LLVLComposition::invalidatePendingTiles()
+{
+	for (pending_tile_map_t::iterator iter = mPendingTiles.begin(); iter != mPendingTiles.end(); ++iter)
+	{
+		iter->second.mStale = TRUE;
+	}
 }
 
 BOOL LLVLComposition::generateHeights(const F32 x, const F32 y,
@@ -156,6 +195,17 @@ BOOL LLVLComposition::generateHeights(const F32 x, const F32 y,
 		y_end = mWidth;
 	}
 
+	// Tiles already on the compositing thread have the old values
+	for (pending_tile_map_t::iterator iter = mPendingTiles.begin(); iter != mPendingTiles.end(); ++iter)
+	{
+		PendingTile& pending = iter->second;
+		if (pending.mCompXBegin < x_end && x_begin < pending.mCompXEnd &&
+			pending.mCompYBegin < y_end && y_begin < pending.mCompYEnd)
+		{
+			pending.mStale = TRUE;
+		}
+	}
+
 	LLVector3d origin_global = from_region_handle(mSurfacep->getRegion()->getHandle());
 
 	// For perlin noise generation...
@@ -228,6 +278,9 @@ BOOL LLVLComposition::generateHeights(const F32 x, const F32 y,
 
 static const S32 BASE_SIZE = 128;
 
+LLTerrainCompositeThread* LLVLComposition::sCompositeThread = NULL;
+LLTerrainBlend LLVLComposition::sBlend;
+
 BOOL LLVLComposition::generateComposition()
 {
 
@@ -267,31 +320,14 @@ BOOL LLVLComposition::generateComposition()
 	return TRUE;
 }
 
-BOOL LLVLComposition::generateTexture(const F32 x, const F32 y,
-									  const F32 width, const F32 height)
+BOOL LLVLComposition::generateRawImages()
 {
-	llassert(mSurfacep);
-	llassert(x >= 0.f);
-	llassert(y >= 0.f);
-
-	LLTimer gen_timer;
-
-	///////////////////////////
-	//
-	// Generate raw data arrays for surface textures
-	//
-	//
-
 	// These have already been validated by generateComposition.
-	U8* st_data[4];
-	S32 st_data_size[4]; // for debugging
-
 	for (S32 i = 0; i < 4; i++)
 	{
 		if (mRawImages[i].isNull())
 		{
 			// Read back a raw image for this discard level, if it exists
-			mRawImages[i] = new LLImageRaw;
 			S32 min_dim = llmin(mDetailTextures[i]->getWidth(0), mDetailTextures[i]->getHeight(0));
 			S32 ddiscard = 0;
 			while (min_dim > BASE_SIZE && ddiscard < MAX_DISCARD_LEVEL)
@@ -313,10 +349,25 @@ BOOL LLVLComposition::generateTexture(const F32 x, const F32 y,
 				newraw->composite(mRawImages[i]);
 				mRawImages[i] = newraw; // deletes old
 			}
+			else
+			{
+				// Our own copy, as the compositing thread reads it
+				mRawImages[i] = new LLImageRaw(mRawImages[i]->getData(), mRawImages[i]->getWidth(),
+											   mRawImages[i]->getHeight(), mRawImages[i]->getComponents());
+			}
 		}
-		st_data[i] = mRawImages[i]->getData();
-		st_data_size[i] = mRawImages[i]->getDataSize();
 	}
+	return TRUE;
+}
+
+BOOL LLVLComposition::generateTexture(const F32 x, const F32 y,
+									  const F32 width, const F32 height)
+{
+	llassert(mSurfacep);
+	llassert(x >= 0.f);
+	llassert(y >= 0.f);
+
+	LLTimer gen_timer;
 
 	///////////////////////////////////////
 	//
@@ -350,7 +401,6 @@ BOOL LLVLComposition::generateTexture(const F32 x, const F32 y,
 
 	LLViewerImage *texturep;
 	U32 tex_width, tex_height, tex_comps;
-	U32 tex_stride;
 	F32 tex_x_scalef, tex_y_scalef;
 	S32 tex_x_begin, tex_y_begin, tex_x_end, tex_y_end;
 	F32 tex_x_ratiof, tex_y_ratiof;
@@ -359,7 +409,6 @@ BOOL LLVLComposition::generateTexture(const F32 x, const F32 y,
 	tex_width = texturep->getWidth();
 	tex_height = texturep->getHeight();
 	tex_comps = texturep->getComponents();
-	tex_stride = tex_width * tex_comps;
 
 	S32 st_comps = 3;
 	S32 st_width = BASE_SIZE;
@@ -381,80 +430,128 @@ BOOL LLVLComposition::generateTexture(const F32 x, const F32 y,
 	tex_x_ratiof = (F32)mWidth*mScale / (F32)tex_width;
 	tex_y_ratiof = (F32)mWidth*mScale / (F32)tex_height;
 
-	LLPointer<LLImageRaw> raw = new LLImageRaw(tex_width, tex_height, tex_comps);
-	U8 *rawp = raw->getData();
+	if (tex_x_end <= tex_x_begin || tex_y_end <= tex_y_begin)
+	{
+		return TRUE;
+	}
+
+	if (!sCompositeThread)
+	{
+		mPendingTiles.clear();
+	}
+	else
+	{
+		sCompositeThread->completeAbandoned();
+	}
 
-	F32 st_x_stride, st_y_stride;
-	st_x_stride = ((F32)st_width / (F32)mTexScaleX)*((F32)mWidth / (F32)tex_width);
-	st_y_stride = ((F32)st_height / (F32)mTexScaleY)*((F32)mWidth / (F32)tex_height);
+	U32 tile = ((U32)tex_y_begin << 16) | (U32)tex_x_begin;
+	pending_tile_map_t::iterator pending = mPendingTiles.find(tile);
+	if (pending != mPendingTiles.end())
+	{
+		LLQueuedThread::handle_t handle = pending->second.mHandle;
+		if (sCompositeThread->getRequestStatus(handle) != LLQueuedThread::STATUS_COMPLETE)
+		{
+			return FALSE;
+		}
 
-	llassert(st_x_stride > 0.f);
-	llassert(st_y_stride > 0.f);
-	////////////////////////////////
+		LLTerrainCompositeThread::CompositeRequest* req = sCompositeThread->getCompositeRequest(handle);
+		LLPointer<LLImageRaw> target = req->getTarget();
+		F32 blend_time = req->getBlendTime();
+		BOOL stale = pending->second.mStale;
+		sCompositeThread->completeComposite(handle);
+		mPendingTiles.erase(pending);
+
+		if (!stale && target->getWidth() == (S32)tex_width && target->getHeight() == (S32)tex_height)
+		{
+			uploadTexture(target, tex_x_begin, tex_y_begin, tex_x_end, tex_y_end, blend_time);
+			return TRUE;
+		}
+		// The heights or the surface texture changed since, so start again
+	}
+
+	///////////////////////////
 	//
-	// Iterate through the target texture, striding through the
-	// subtextures and interpolating appropriately.
+	// Generate raw data arrays for surface textures
 	//
 	//
 
-	F32 sti, stj;
-	S32 st_offset;
-	sti = (tex_x_begin * st_x_stride) - st_width*(llfloor((tex_x_begin * st_x_stride)/st_width));
-	stj = (tex_y_begin * st_y_stride) - st_height*(llfloor((tex_y_begin * st_y_stride)/st_height));
+	if (!generateRawImages())
+	{
+		return FALSE;
+	}
 
-	st_offset = (llfloor(stj * st_width) + llfloor(sti)) * st_comps;
-	for (S32 j = tex_y_begin; j < tex_y_end; j++)
+	if (mTextureRaw.isNull() ||
+		mTextureRaw->getWidth() != (S32)tex_width ||
+		mTextureRaw->getHeight() != (S32)tex_height)
 	{
-		U32 offset = j * tex_stride + tex_x_begin * tex_comps;
-		sti = (tex_x_begin * st_x_stride) - st_width*((U32)(tex_x_begin * st_x_stride)/st_width);
-		for (S32 i = tex_x_begin; i < tex_x_end; i++)
-		{
-			S32 tex0, tex1;
-			F32 composition = getValueScaled(i*tex_x_ratiof, j*tex_y_ratiof);
+		mTextureRaw = new LLImageRaw(tex_width, tex_height, tex_comps);
+	}
 
-			tex0 = llfloor( composition );
-			tex0 = llclamp(tex0, 0, 3);
-			composition -= tex0;
-			tex1 = tex0 + 1;
-			tex1 = llclamp(tex1, 0, 3);
+	F32 st_x_stride, st_y_stride;
+	st_x_stride = ((F32)st_width / (F32)mTexScaleX)*((F32)mWidth / (F32)tex_width);
+	st_y_stride = ((F32)st_height / (F32)mTexScaleY)*((F32)mWidth / (F32)tex_height);
 
-			st_offset = (lltrunc(sti) + lltrunc(stj)*st_width) * st_comps;
-			for (U32 k = 0; k < tex_comps; k++)
-			{
-				// Linearly interpolate based on composition.
-				if (st_offset >= st_data_size[tex0] || st_offset >= st_data_size[tex1])
-				{
-					// SJB: This shouldn't be happening, but does... Rounding error?
-					//llwarns << "offset 0 [" << tex0 << "] =" << st_offset << " >= size=" << st_data_size[tex0] << llendl;
-					//llwarns << "offset 1 [" << tex1 << "] =" << st_offset << " >= size=" << st_data_size[tex1] << llendl;
-				}
-				else
-				{
-					F32 a = *(st_data[tex0] + st_offset);
-					F32 b = *(st_data[tex1] + st_offset);
-					rawp[ offset ] = (U8)lltrunc( a + composition * (b - a) );
-				}
-				offset++;
-				st_offset++;
-			}
+	llassert(st_x_stride > 0.f);
+	llassert(st_y_stride > 0.f);
 
-			sti += st_x_stride;
-			if (sti >= st_width)
-			{
-				sti -= st_width;
-			}
-		}
+	LLTerrainBlend::Params params;
+	for (S32 i = 0; i < 4; i++)
+	{
+		params.mDetail[i] = mRawImages[i]->getData();
+		params.mDetailDataSize[i] = mRawImages[i]->getDataSize();
+	}
+	params.mDetailSize = BASE_SIZE;
+	params.mDetailStrideX = st_x_stride;
+	params.mDetailStrideY = st_y_stride;
+	params.mCompWidth = mWidth;
+	params.mCompScaleInv = mScaleInv;
+	params.mTexRatioX = tex_x_ratiof;
+	params.mTexRatioY = tex_y_ratiof;
+
+	if (!sCompositeThread)
+	{
+		params.mComposition = mDatap;
+		params.mCompX = 0;
+		params.mCompY = 0;
+		params.mCompRowLength = mWidth;
+
+		U8* out = mTextureRaw->getData() + (tex_y_begin*tex_width + tex_x_begin)*tex_comps;
+		sBlend.blend(params, tex_x_begin, tex_y_begin, tex_x_end, tex_y_end, out, tex_width*tex_comps);
+		uploadTexture(mTextureRaw, tex_x_begin, tex_y_begin, tex_x_end, tex_y_end, gen_timer.getElapsedTimeF32());
+		return TRUE;
+	}
 
-		stj += st_y_stride;
-		if (stj >= st_height)
-		{
-			stj -= st_height;
-		}
+	// Hand the thread a copy of just the composition values it needs
+	PendingTile pending_tile;
+	LLTerrainBlend::getCompositionBounds(params, tex_x_begin, tex_y_begin, tex_x_end, tex_y_end,
+										 pending_tile.mCompXBegin, pending_tile.mCompYBegin,
+										 pending_tile.mCompXEnd, pending_tile.mCompYEnd);
+	S32 comp_row_length = pending_tile.mCompXEnd - pending_tile.mCompXBegin;
+	std::vector<F32> composition(comp_row_length*(pending_tile.mCompYEnd - pending_tile.mCompYBegin));
+	for (S32 j = pending_tile.mCompYBegin; j < pending_tile.mCompYEnd; j++)
+	{
+		memcpy(&composition[(j - pending_tile.mCompYBegin)*comp_row_length],
+			   mDatap + j*mWidth + pending_tile.mCompXBegin, comp_row_length*sizeof(F32));
 	}
+	params.mComposition = NULL;
+	params.mCompX = pending_tile.mCompXBegin;
+	params.mCompY = pending_tile.mCompYBegin;
+	params.mCompRowLength = comp_row_length;
+
+	pending_tile.mHandle = sCompositeThread->composite(params, mRawImages, composition, mTextureRaw,
+													   tex_x_begin, tex_y_begin, tex_x_end, tex_y_end);
+	pending_tile.mStale = FALSE;
+	mPendingTiles[tile] = pending_tile;
+	return FALSE;
+}
 
-	texturep->setSubImage(raw, tex_x_begin, tex_y_begin, tex_x_end - tex_x_begin, tex_y_end - tex_y_begin);
-	LLSurface::sTextureUpdateTime += gen_timer.getElapsedTimeF32();
-	LLSurface::sTexelsUpdated += (tex_x_end - tex_x_begin) * (tex_y_end - tex_y_begin);
+void LLVLComposition::uploadTexture(LLImageRaw* raw, S32 x_begin, S32 y_begin, S32 x_end, S32 y_end, F32 blend_time)
+{
+	LLTimer upload_timer;
+	LLViewerImage* texturep = mSurfacep->getSTexture();
+	texturep->setSubImage(raw, x_begin, y_begin, x_end - x_begin, y_end - y_begin);
+	LLSurface::sTextureUpdateTime += blend_time + upload_timer.getElapsedTimeF32();
+	LLSurface::sTexelsUpdated += (x_end - x_begin) * (y_end - y_begin);
 
 	for (S32 i = 0; i < 4; i++)
 	{
@@ -462,8 +559,6 @@ BOOL LLVLComposition::generateTexture(const F32 x, const F32 y,
 		mDetailTextures[i]->setBoostLevel(LLViewerImageBoostLevel::BOOST_NONE);
 		mDetailTextures[i]->setMinDiscardLevel(MAX_DISCARD_LEVEL + 1);
 	}
-	
-	return TRUE;
 }
 
 LLUUID LLVLComposition::getDetailTextureID(S32 corner)
@@ -495,3 +590,115 @@ void LLVLComposition::setHeightRange(S32 corner, const F32 range)
 {
 	mHeightRange[corner] = range;
 }
+
+//----------------------------------------------------------------------------
+// LLTerrainCompositeThread
+//----------------------------------------------------------------------------
+
+LLTerrainCompositeThread::LLTerrainCompositeThread(bool threaded)
+	: LLQueuedThread("Terrain composite", threaded)
+{
+}
+
+LLTerrainCompositeThread::handle_t LLTerrainCompositeThread::composite(const LLTerrainBlend::Params& params,
+																	   LLPointer<LLImageRaw>* details,
+																	   std::vector<F32>& composition,
+																	   LLImageRaw* target,
+																	   S32 x_begin, S32 y_begin, S32 x_end, S32 y_end)
+{
+	handle_t handle = generateHandle();
+	CompositeRequest* req = new CompositeRequest(handle, mBlend, params, details, composition, target,
+												 x_begin, y_begin, x_end, y_end);
+	bool res = addRequest(req);
+	if (!res)
+	{
+		llerrs << "LLTerrainCompositeThread::composite called after shutdown()" << llendl;
+	}
+	return handle;
+}
+
+LLTerrainCompositeThread::CompositeRequest* LLTerrainCompositeThread::getCompositeRequest(handle_t handle)
+{
+	return (CompositeRequest*)getRequest(handle);
+}
+
+void LLTerrainCompositeThread::completeComposite(handle_t handle)
+{
+	CompositeRequest* req = getCompositeRequest(handle);
+	if (req)
+	{
+		req->releaseImages();
+		completeRequest(handle);
+	}
+}
+
+void LLTerrainCompositeThread::abandon(handle_t handle)
+{
+	abortRequest(handle, false);
+	mAbandoned.push_back(handle);
+}
+
+void LLTerrainCompositeThread::completeAbandoned()
+{
+	std::vector<handle_t>::iterator iter = mAbandoned.begin();
+	while (iter != mAbandoned.end())
+	{
+		status_t status = getRequestStatus(*iter);
+		if (status == STATUS_QUEUED || status == STATUS_INPROGRESS)
+		{
+			++iter;
+			continue;
+		}
+		completeComposite(*iter);
+		iter = mAbandoned.erase(iter);
+	}
+}
+
+LLTerrainCompositeThread::CompositeRequest::CompositeRequest(handle_t handle, LLTerrainBlend& blend,
+															 const LLTerrainBlend::Params& params,
+															 LLPointer<LLImageRaw>* details,
+															 std::vector<F32>& composition,
+															 LLImageRaw* target,
+															 S32 x_begin, S32 y_begin, S32 x_end, S32 y_end)
+	: LLQueuedThread::QueuedRequest(handle, LLQueuedThread::PRIORITY_NORMAL, 0),
+	  mBlend(blend),
+	  mParams(params),
+	  mTarget(target),
+	  mXBegin(x_begin),
+	  mYBegin(y_begin),
+	  mXEnd(x_end),
+	  mYEnd(y_end),
+	  mBlendTime(0.f)
+{
+	for (S32 i = 0; i < LLTerrainBlend::NUM_DETAILS; i++)
+	{
+		mDetails[i] = details[i];
+		mParams.mDetail[i] = mDetails[i]->getData();
+	}
+	mComposition.swap(composition);
+	mParams.mComposition = &mComposition[0];
+}
+
+LLTerrainCompositeThread::CompositeRequest::~CompositeRequest()
+{
+}
+
+void LLTerrainCompositeThread::CompositeRequest::releaseImages()
+{
+	for (S32 i = 0; i < LLTerrainBlend::NUM_DETAILS; i++)
+	{
+		mDetails[i] = NULL;
+	}
+	mTarget = NULL;
+}
+
+// virtual
+bool LLTerrainCompositeThread::CompositeRequest::processRequest()
+{
+	LLTimer blend_timer;
+	const S32 stride = mTarget->getWidth()*mTarget->getComponents();
+	U8* out = mTarget->getData() + mYBegin*stride + mXBegin*mTarget->getComponents();
+	mBlend.blend(mParams, mXBegin, mYBegin, mXEnd, mYEnd, out, stride);
+	mBlendTime = blend_timer.getElapsedTimeF32();
+	return true;
+}
@@ -33,10 +33,13 @@
 #ifndef LL_LLVLCOMPOSITION_H
 #define LL_LLVLCOMPOSITION_H
 
+#include "llqueuedthread.h"
+#include "llterrainblend.h"
 #include "llviewerlayer.h"
 #include "llviewerimage.h"
 
 class LLSurface;
+class LLTerrainCompositeThread;
 
 class LLVLComposition : public LLViewerLayer
 {
@@ -49,9 +52,14 @@ public:
 	// Viewer side hack to generate composition values
 	BOOL generateHeights(const F32 x, const F32 y, const F32 width, const F32 height);
 	BOOL generateComposition();
-	// Generate texture from composition values.
+	// Generate texture from composition values.  With the compositing
+	// thread running, the first call starts the work and returns FALSE,
+	// and a call after it is done uploads the texels and returns TRUE.
 	BOOL generateTexture(const F32 x, const F32 y, const F32 width, const F32 height);		
 
+	static void initClass(bool threaded);
+	static void cleanupClass();
+
 	// Use these as indeces ito the get/setters below that use 'corner'
 	enum ECorner
 	{
@@ -76,6 +84,9 @@ public:
 	void setParamsReady()		{ mParamsReady = TRUE; }
 	BOOL getParamsReady() const	{ return mParamsReady; }
 protected:
+	BOOL generateRawImages();
+	void uploadTexture(LLImageRaw* raw, S32 x_begin, S32 y_begin, S32 x_end, S32 y_end, F32 blend_time);
+
 	BOOL mParamsReady;
 	LLSurface *mSurfacep;
 	BOOL mTexturesLoaded;
@@ -88,6 +99,87 @@ protected:
 
 	F32 mTexScaleX;
 	F32 mTexScaleY;
+
+	// Tiles on the compositing thread, by texel origin
+	struct PendingTile
+	{
+		LLQueuedThread::handle_t mHandle;
+		S32 mCompXBegin;				// composition values it copied
+		S32 mCompYBegin;
+		S32 mCompXEnd;
+		S32 mCompYEnd;
+		BOOL mStale;					// heights or detail textures changed since
+	};
+	typedef std::map<U32, PendingTile> pending_tile_map_t;
+	pending_tile_map_t mPendingTiles;
+	LLPointer<LLImageRaw> mTextureRaw;	// surface texture sized, tiles are written in place
+
+	void invalidatePendingTiles();
+
+	static LLTerrainCompositeThread* sCompositeThread;
+	static LLTerrainBlend sBlend;		// main thread compositing
+};
+
+// Composites terrain texture tiles in the background.  The request keeps
+// its own references to the detail images and its own copy of the
+// composition values it reads, so the region can change or go away.
+// Requests are deleted on the compositing thread, so the main thread drops
+// those references before completing them; LLRefCount is not thread safe.
+class LLTerrainCompositeThread : public LLQueuedThread
+{
+public:
+	class CompositeRequest : public LLQueuedThread::QueuedRequest
+	{
+	protected:
+		virtual ~CompositeRequest(); // use deleteRequest()
+
+	public:
+		CompositeRequest(handle_t handle, LLTerrainBlend& blend, const LLTerrainBlend::Params& params,
+						 LLPointer<LLImageRaw>* details, std::vector<F32>& composition,
+						 LLImageRaw* target, S32 x_begin, S32 y_begin, S32 x_end, S32 y_end);
+
+		/*virtual*/ bool processRequest();
+
+		LLImageRaw* getTarget() const { return mTarget; }
+		F32 getBlendTime() const { return mBlendTime; }
+
+		// MAIN THREAD, once the request is no longer queued or in progress
+		void releaseImages();
+
+	private:
+		LLTerrainBlend& mBlend;
+		LLTerrainBlend::Params mParams;
+		LLPointer<LLImageRaw> mDetails[LLTerrainBlend::NUM_DETAILS];
+		std::vector<F32> mComposition;
+		LLPointer<LLImageRaw> mTarget;
+		S32 mXBegin;
+		S32 mYBegin;
+		S32 mXEnd;
+		S32 mYEnd;
+		F32 mBlendTime;
+	};
+
+	LLTerrainCompositeThread(bool threaded = true);
+
+	// Takes composition's contents.  The texels go into target at their
+	// own position.
+	handle_t composite(const LLTerrainBlend::Params& params, LLPointer<LLImageRaw>* details,
+					   std::vector<F32>& composition, LLImageRaw* target,
+					   S32 x_begin, S32 y_begin, S32 x_end, S32 y_end);
+
+	CompositeRequest* getCompositeRequest(handle_t handle);
+
+	// Releases a finished request's images and completes it
+	void completeComposite(handle_t handle);
+
+	// Aborts a request nobody will collect; completeAbandoned() completes
+	// it once the thread is done with it.
+	void abandon(handle_t handle);
+	void completeAbandoned();
+
+private:
+	LLTerrainBlend mBlend;
+	std::vector<handle_t> mAbandoned;
 };
 
 #endif //LL_LLVLCOMPOSITION_H
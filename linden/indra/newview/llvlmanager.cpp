@@ -38,13 +38,24 @@
 #include "bitpack.h"
 #include "patch_code.h"
 #include "patch_dct.h"
+#include "llpatchdecoder.h"
 #include "llviewerregion.h"
 #include "llframetimer.h"
 #include "llagent.h"
 #include "llsurface.h"
+#include "llappviewer.h"
+#include "llworld.h"
 
 LLVLManager gVLManager;
 
+LLVLManager::LLVLManager()
+	: mDecodeThread(NULL),
+	  mLandBits(0),
+	  mWindBits(0),
+	  mCloudBits(0)
+{
+}
+
 LLVLManager::~LLVLManager()
 {
 	S32 i;
@@ -53,6 +64,26 @@ LLVLManager::~LLVLManager()
 		delete mPacketData[i];
 	}
 	mPacketData.reset();
+	shutdownThread();
+}
+
+void LLVLManager::initThread(bool threaded)
+{
+	if (threaded && !mDecodeThread)
+	{
+		mDecodeThread = new LLPatchDecodeThread(true);
+	}
+}
+
+void LLVLManager::shutdownThread()
+{
+	if (mDecodeThread)
+	{
+		mDecodeThread->shutdown();
+		delete mDecodeThread;
+		mDecodeThread = NULL;
+	}
+	mDecodeHandles.clear();
 }
 
 void LLVLManager::addLayerData(LLVLData *vl_datap, const S32 mesg_size)
@@ -88,6 +119,19 @@ void LLVLManager::unpackData(const S32 num_packets)
 	{
 		LLVLData *datap = mPacketData[i];
 
+		if (mDecodeThread &&
+			(LAND_LAYER_CODE == datap->mType || AURORA_LAND_LAYER_CODE == datap->mType))
+		{
+			// The thread takes the data and reads the group header itself
+			BOOL b_large_patch = (AURORA_LAND_LAYER_CODE == datap->mType);
+			S32 patches_per_edge = datap->mRegionp->getLand().getPatchesPerEdge();
+			mDecodeHandles.push_back(mDecodeThread->decode(datap->mRegionp->getHandle(),
+														   datap->mData, datap->mSize,
+														   b_large_patch, patches_per_edge));
+			datap->mData = NULL;
+			continue;
+		}
+
 		LLBitPack bit_pack(datap->mData, datap->mSize);
 		LLGroupHeader goph;
 
@@ -118,6 +162,42 @@ void LLVLManager::unpackData(const S32 num_packets)
 	}
 	mPacketData.reset();
 
+	applyDecodedLand();
+}
+
+void LLVLManager::applyDecodedLand()
+{
+	if (!mDecodeThread)
+	{
+		return;
+	}
+
+	mDecodeThread->update(0);
+
+	// Apply in arrival order, so a newer layer for a patch lands last
+	while (!mDecodeHandles.empty())
+	{
+		LLQueuedThread::handle_t handle = mDecodeHandles.front();
+		if (mDecodeThread->getRequestStatus(handle) != LLQueuedThread::STATUS_COMPLETE)
+		{
+			break;
+		}
+
+		LLPatchDecodeThread::DecodeRequest* req = mDecodeThread->getDecodeRequest(handle);
+		LLViewerRegion* regionp = LLWorld::getInstance()->getRegionFromHandle(req->getRegionHandle());
+		if (regionp)
+		{
+			regionp->getLand().applyDecodedPatches(req->getPatches(), req->getPatchSize());
+		}
+		BOOL valid = req->isValid();
+		mDecodeThread->completeRequest(handle);
+		mDecodeHandles.pop_front();
+
+		if (regionp && !valid)
+		{
+			LLAppViewer::instance()->badNetworkHandler();
+		}
+	}
 }
 
 void LLVLManager::resetBitCounts()
@@ -35,17 +35,27 @@
 
 // This class manages the data coming in for viewer layers from the network.
 
+#include <deque>
+
 #include "stdtypes.h"
 #include "lldarray.h"
+#include "llqueuedthread.h"
 
+class LLPatchDecodeThread;
 class LLVLData;
 class LLViewerRegion;
 
 class LLVLManager
 {
 public:
+	LLVLManager();
 	~LLVLManager();
 
+	// With threaded, land layers are decoded on a background thread and
+	// applied by a later unpackData(); otherwise unpackData() decodes them.
+	void initThread(bool threaded);
+	void shutdownThread();
+
 	void addLayerData(LLVLData *vl_datap, const S32 mesg_size);
 
 	void unpackData(const S32 num_packets = 10);
@@ -61,7 +71,11 @@ public:
 	void cleanupData(LLViewerRegion *regionp);
 protected:
 
+	void applyDecodedLand();
+
 	LLDynamicArray<LLVLData *> mPacketData;
+	LLPatchDecodeThread* mDecodeThread;
+	std::deque<LLQueuedThread::handle_t> mDecodeHandles;	// In the order the layers arrived
 	U32 mLandBits;
 	U32 mWindBits;
 	U32 mCloudBits;
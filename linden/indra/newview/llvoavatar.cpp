@@ -1494,6 +1494,7 @@ void LLVOAvatar::cleanupClass()
 	sAvatarDictionary = NULL;
 	sSkeletonXMLTree.cleanup();
 	sXMLTree.cleanup();
+	LLViewerJointMesh::cleanupClass();
 }
 
 LLPartSysData LLVOAvatar::sCloud;
@@ -2976,12 +2977,14 @@ void LLVOAvatar::idleUpdateAppearanceAnimation()
 			}
 
 			// apply all params
+			LLPolyMesh::beginMorphBatch();
 			for (param = getFirstVisualParam();
 				 param;
 				 param = getNextVisualParam())
 			{
 				param->apply(avatar_sex);
 			}
+			LLPolyMesh::endMorphBatch();
 
 			mLastAppearanceBlendTime = appearance_anim_time;
 		}
@@ -3264,6 +3267,8 @@ bool LLVOAvatar::loadClientTags()
 
 void LLVOAvatar::resolveClient(LLColor4& avatar_name_color, std::string& client, LLVOAvatar* avatar)
 {
+	static LLCachedControl<LLColor4> sImprudenceTagColor(gSavedSettings, "ImprudenceTagColor");
+
 	LLUUID idx = avatar->getTE(0)->getID();
 
 	// We start locally with Imprudence in case the user has a local color they prefer.
@@ -3272,7 +3277,7 @@ void LLVOAvatar::resolveClient(LLColor4& avatar_name_color, std::string& client,
 	if(idx == LLUUID("cc7a030f-282f-c165-44d2-b5ee572e72bf"))
 	{
 		// defaults to LLColor4(0.79f,0.44f,0.88f)
-		avatar_name_color = gSavedSettings.getColor4("ImprudenceTagColor"); //Imprudence
+		avatar_name_color = sImprudenceTagColor; //Imprudence
 		client = "Imprudence";
 	}
 	else if (LLVOAvatar::sClientResolutionList.has("isComplete") &&
@@ -3506,6 +3511,10 @@ void LLVOAvatar::resolveClient(LLColor4& avatar_name_color, std::string& client,
 
 void LLVOAvatar::idleUpdateNameTag(const LLVector3& root_pos_last)
 {
+	static LLCachedControl<BOOL> sRenderNameHideSelf(gSavedSettings, "RenderNameHideSelf");
+	static LLCachedControl<LLColor4> sImprudenceTagColor(gSavedSettings, "ImprudenceTagColor");
+	static LLCachedControl<BOOL> sHighlightFriends(gSavedSettings, "HighlightFriends");
+
 	// update chat bubble
 	//--------------------------------------------------------------------
 	// draw text label over characters head
@@ -3542,7 +3551,7 @@ void LLVOAvatar::idleUpdateNameTag(const LLVector3& root_pos_last)
 	{
 		render_name = render_name
 						&& !gAgent.cameraMouselook()
-						&& (visible_chat || !gSavedSettings.getBOOL("RenderNameHideSelf"));
+						&& (visible_chat || !sRenderNameHideSelf);
 	}
 
 	if ( render_name )
@@ -3626,7 +3635,7 @@ void LLVOAvatar::idleUpdateNameTag(const LLVector3& root_pos_last)
 				else
 				{
 					// Set your own name to the Imprudence color -- MC
-					client_color = gSavedSettings.getColor4("ImprudenceTagColor");
+					client_color = sImprudenceTagColor;
 				}
 
 				static BOOL* sShowClientColor = rebind_llcontrol<BOOL>("ShowClientColor", &gSavedSettings, true);
@@ -3888,7 +3897,7 @@ void LLVOAvatar::idleUpdateNameTag(const LLVector3& root_pos_last)
 			{
 				S32 style = LLFontGL::NORMAL;
 
-				if (!mIsSelf && gSavedSettings.getBOOL("HighlightFriends"))
+				if (!mIsSelf && sHighlightFriends)
 				{
 					if (is_agent_friend(this->getID())) // Ele: bold for friends
 						style |= LLFontGL::BOLD;
@@ -3957,6 +3966,9 @@ void LLVOAvatar::invalidateNameTags()
 
 void LLVOAvatar::idleUpdateTractorBeam()
 {
+	static LLCachedControl<BOOL> sParticleChat(gSavedSettings, "ParticleChat");
+	static LLCachedControl<S32> sParticleChatChannel(gSavedSettings, "ParticleChatChannel");
+
 	//--------------------------------------------------------------------
 	// draw tractor beam when editing objects
 	//--------------------------------------------------------------------
@@ -3981,7 +3993,7 @@ void LLVOAvatar::idleUpdateTractorBeam()
 	if (!needsRenderBeam() || !mIsBuilt)
 	{
 		mBeam = NULL;
-		if(gSavedSettings.getBOOL("ParticleChat"))
+		if(sParticleChat)
 		{
 			if(sPartsNow != FALSE)
 			{
@@ -3994,7 +4006,7 @@ void LLVOAvatar::idleUpdateTractorBeam()
 				msg->nextBlockFast(_PREHASH_ChatData);
 				msg->addStringFast(_PREHASH_Message, "stop");
 				msg->addU8Fast(_PREHASH_Type, CHAT_TYPE_WHISPER);
-				msg->addS32("Channel", gSavedSettings.getS32("ParticleChatChannel"));
+				msg->addS32("Channel", sParticleChatChannel);
 				
 				gAgent.sendReliableMessage();
 				sBeamLastAt  =  LLVector3d::zero;
@@ -4022,7 +4034,7 @@ void LLVOAvatar::idleUpdateTractorBeam()
 			mBeam->setPositionGlobal(gAgent.mPointAt->getPointAtPosGlobal());
 
 			//lgg crap
-			if(gSavedSettings.getBOOL("ParticleChat"))
+			if(sParticleChat)
 			{
 				if(sPartsNow != TRUE)
 				{
@@ -4037,7 +4049,7 @@ void LLVOAvatar::idleUpdateTractorBeam()
 						msg->nextBlockFast(_PREHASH_ChatData);
 						msg->addStringFast(_PREHASH_Message, "start"+obj_sel->getID().asString());
 						msg->addU8Fast(_PREHASH_Type, CHAT_TYPE_WHISPER);
-						msg->addS32("Channel", gSavedSettings.getS32("ParticleChatChannel"));
+						msg->addS32("Channel", sParticleChatChannel);
 						
 						gAgent.sendReliableMessage();
 					}
@@ -4058,7 +4070,7 @@ void LLVOAvatar::idleUpdateTractorBeam()
 						msg->nextBlockFast(_PREHASH_ChatData);
 						msg->addStringFast(_PREHASH_Message, "start"+obj_sel->getID().asString());
 						msg->addU8Fast(_PREHASH_Type, CHAT_TYPE_WHISPER);
-						msg->addS32("Channel", gSavedSettings.getS32("ParticleChatChannel"));
+						msg->addS32("Channel", sParticleChatChannel);
 						
 						gAgent.sendReliableMessage();
 					}
@@ -4135,6 +4147,8 @@ void LLVOAvatar::slamPosition()
 //------------------------------------------------------------------------
 BOOL LLVOAvatar::updateCharacter(LLAgent &agent)
 {
+	static LLCachedControl<BOOL> sMuteAmbient(gSavedSettings, "MuteAmbient");
+
 	LLMemType mt(LLMemType::MTYPE_AVATAR);
 	// update screen joint size
 
@@ -4566,7 +4580,7 @@ BOOL LLVOAvatar::updateCharacter(LLAgent &agent)
 	const LLUUID AGENT_FOOTSTEP_ANIMS[] = {ANIM_AGENT_WALK, ANIM_AGENT_RUN, ANIM_AGENT_LAND};
 	const S32 NUM_AGENT_FOOTSTEP_ANIMS = LL_ARRAY_SIZE(AGENT_FOOTSTEP_ANIMS);
 
-	if ( gAudiop && !gSavedSettings.getBOOL("MuteAmbient") && isAnyAnimationSignaled(AGENT_FOOTSTEP_ANIMS, NUM_AGENT_FOOTSTEP_ANIMS) )
+	if ( gAudiop && !sMuteAmbient && isAnyAnimationSignaled(AGENT_FOOTSTEP_ANIMS, NUM_AGENT_FOOTSTEP_ANIMS) )
 	{
 		BOOL playSound = FALSE;
 		LLVector3 foot_pos_agent;
@@ -4807,6 +4821,81 @@ BOOL LLVOAvatar::needsRenderBeam()
 	return is_touching_or_grabbing || (mState & AGENT_STATE_EDITING && LLSelectMgr::getInstance()->shouldShowSelection());
 }
 
+//-----------------------------------------------------------------------------
+// getSkinnedJoints()
+//-----------------------------------------------------------------------------
+void LLVOAvatar::getSkinnedJoints(std::vector<LLViewerJoint*>& joints)
+{
+	joints.push_back(mMeshLOD[MESH_ID_LOWER_BODY]);
+	joints.push_back(mMeshLOD[MESH_ID_UPPER_BODY]);
+
+	if( isWearingWearableType( WT_SKIRT ) )
+	{
+		joints.push_back(mMeshLOD[MESH_ID_SKIRT]);
+	}
+
+	if (!mIsSelf || gAgent.needsRenderHead() || LLPipeline::sShadowRender)
+	{
+		joints.push_back(mMeshLOD[MESH_ID_EYELASH]);
+		joints.push_back(mMeshLOD[MESH_ID_HEAD]);
+		joints.push_back(mMeshLOD[MESH_ID_HAIR]);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// skinAvatars()
+//-----------------------------------------------------------------------------
+// static
+void LLVOAvatar::skinAvatars()
+{
+	if (LLViewerShaderMgr::instance()->getVertexShaderLevel(LLViewerShaderMgr::SHADER_AVATAR) > 0)
+	{
+		return;
+	}
+
+	// Avatars whose mesh needs rebuilding first are left to renderSkinned()
+	std::vector<LLVOAvatar*> avatars;
+	std::vector<LLViewerJoint*> joints;
+	for (std::vector<LLCharacter*>::iterator iter = LLCharacter::sInstances.begin();
+		 iter != LLCharacter::sInstances.end(); ++iter)
+	{
+		LLVOAvatar* avatarp = (LLVOAvatar*)*iter;
+		if (!avatarp->mNeedsSkin
+			|| !avatarp->mIsBuilt
+			|| avatarp->mIsDummy
+			|| avatarp->isDead()
+			|| avatarp->mDrawable.isNull()
+			|| avatarp->mDirtyMesh
+			|| avatarp->mDrawable->isState(LLDrawable::REBUILD_GEOMETRY)
+			|| !avatarp->isVisible()
+			|| !avatarp->isFullyLoaded())
+		{
+			continue;
+		}
+		avatars.push_back(avatarp);
+		avatarp->getSkinnedJoints(joints);
+	}
+	if (avatars.empty())
+	{
+		return;
+	}
+
+	std::vector<LLViewerJointMesh*> meshes;
+	for (std::vector<LLViewerJoint*>::iterator iter = joints.begin(); iter != joints.end(); ++iter)
+	{
+		(*iter)->getSkinnedMeshes(meshes);
+	}
+	if (!LLViewerJointMesh::skinMeshes(meshes))
+	{
+		return;
+	}
+
+	for (std::vector<LLVOAvatar*>::iterator iter = avatars.begin(); iter != avatars.end(); ++iter)
+	{
+		(*iter)->mNeedsSkin = FALSE;
+	}
+}
+
 //-----------------------------------------------------------------------------
 // renderSkinned()
 //-----------------------------------------------------------------------------
@@ -4832,19 +4921,11 @@ U32 LLVOAvatar::renderSkinned(EAvatarRenderPass pass)
 		if (mNeedsSkin)
 		{
 			//generate animated mesh
-			mMeshLOD[MESH_ID_LOWER_BODY]->updateJointGeometry();
-			mMeshLOD[MESH_ID_UPPER_BODY]->updateJointGeometry();
-
-			if( isWearingWearableType( WT_SKIRT ) )
+			std::vector<LLViewerJoint*> joints;
+			getSkinnedJoints(joints);
+			for (std::vector<LLViewerJoint*>::iterator iter = joints.begin(); iter != joints.end(); ++iter)
 			{
-				mMeshLOD[MESH_ID_SKIRT]->updateJointGeometry();
-			}
-
-			if (!mIsSelf || gAgent.needsRenderHead() || LLPipeline::sShadowRender)
-			{
-				mMeshLOD[MESH_ID_EYELASH]->updateJointGeometry();
-				mMeshLOD[MESH_ID_HEAD]->updateJointGeometry();
-				mMeshLOD[MESH_ID_HAIR]->updateJointGeometry();
+				(*iter)->updateJointGeometry();
 			}
 			mNeedsSkin = FALSE;
 
@@ -5409,6 +5490,8 @@ const LLUUID& LLVOAvatar::getStepSound() const
 //-----------------------------------------------------------------------------
 void LLVOAvatar::processAnimationStateChanges()
 {
+	static LLCachedControl<BOOL> sAOEnabled(gSavedSettings, "AOEnabled");
+
 	LLMemType mt(LLMemType::MTYPE_AVATAR);
 
 	if (gNoRender)
@@ -5454,7 +5537,7 @@ void LLVOAvatar::processAnimationStateChanges()
 		{
 			if (mIsSelf)
 			{
-				if ((gSavedSettings.getBOOL("AOEnabled")) && LLFloaterAO::stopMotion(anim_it->first, FALSE)) // if the AO replaced this anim serverside then stop it serverside
+				if ((sAOEnabled) && LLFloaterAO::stopMotion(anim_it->first, FALSE)) // if the AO replaced this anim serverside then stop it serverside
 				{
 //					return TRUE; //no local stop needed
 				}
@@ -5481,7 +5564,7 @@ void LLVOAvatar::processAnimationStateChanges()
 
 				if (mIsSelf) // AO is only for ME
 				{
-					if (gSavedSettings.getBOOL("AOEnabled"))
+					if (sAOEnabled)
 					{
 						if (LLFloaterAO::startMotion(anim_it->first, 0,FALSE)) // AO overrides the anim if needed
 						{
@@ -5614,11 +5697,13 @@ void LLVOAvatar::resetAnimations()
 //-----------------------------------------------------------------------------
 BOOL LLVOAvatar::startMotion(const LLUUID& id, F32 time_offset)
 {
+	static LLCachedControl<BOOL> sDisableInternalFlyUpAnimation(gSavedSettings, "DisableInternalFlyUpAnimation");
+
 	// [Ansariel Hiller]: Disable pesky hover up animation that changes
 	//                    hand and finger position and often breaks correct
 	//                    fit of prim nails, rings etc. when flying and
 	//                    using an AO.
-	if ("62c5de58-cb33-5743-3d07-9e4cd4352864" == id.getString() && gSavedSettings.getBOOL("DisableInternalFlyUpAnimation"))
+	if ("62c5de58-cb33-5743-3d07-9e4cd4352864" == id.getString() && sDisableInternalFlyUpAnimation)
 	{
 		return TRUE;
 	}
@@ -6376,7 +6461,10 @@ void LLVOAvatar::updateVisualParams()
 
 	setSex( (getVisualParamWeight( "male" ) > 0.5f) ? SEX_MALE : SEX_FEMALE );
 
+	// apply all the changed morphs to each mesh in one pass
+	LLPolyMesh::beginMorphBatch();
 	LLCharacter::updateVisualParams();
+	LLPolyMesh::endMorphBatch();
 
 	if (mLastSkeletonSerialNum != mSkeletonSerialNum)
 	{
@@ -133,6 +133,12 @@ public:
 	U32 renderImpostor(LLColor4U color = LLColor4U(255,255,255,255));
 	U32 renderRigid();
 	U32 renderSkinned(EAvatarRenderPass pass);
+	// Skins the meshes of every avatar about to be drawn with software
+	// skinning in one batch, before renderSkinned() would do it avatar
+	// by avatar.
+	static void skinAvatars();
+	// The mesh LODs renderSkinned() skins this frame
+	void getSkinnedJoints(std::vector<LLViewerJoint*>& joints);
 	U32 renderTransparent(BOOL first_pass);
 	void renderCollisionVolumes();
 	
@@ -30,11 +30,31 @@
  * $/LicenseInfo$
  */
 
+
 #include "llviewerprecompiledheaders.h"
 
 #include "llvocache.h"
 
+#include <algorithm>
+
+#include "apr_portable.h"
+#if !LL_WINDOWS
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 #include "llerror.h"
+#include "llfile.h"
+
+// Viewer object cache version, change if object update
+// format changes. JC
+const U32 INDRA_OBJECT_CACHE_VERSION = 14;
+
+static const U32 CACHE_MAGIC = 0x43435653; // "SVCC"
+static const U32 RECORD_MAGIC = 0x52435653; // "SVCR"
+static const U32 MIN_CAPACITY = 4096;
+// Same sanity check as the old per region cache files
+static const S32 MAX_ENTRY_SIZE = 10000;
 
 //---------------------------------------------------------------------------
 // LLVOCacheEntry
@@ -47,11 +67,27 @@ LLVOCacheEntry::LLVOCacheEntry(U32 local_id, U32 crc, LLDataPackerBinaryBuffer &
 	mHitCount = 0;
 	mDupeCount = 0;
 	mCRCChangeCount = 0;
+	mDirty = true;
 	mBuffer = new U8[dp.getBufferSize()];
+	mDataBuffer = mBuffer;
 	mDP.assignBuffer(mBuffer, dp.getBufferSize());
 	mDP = dp;
 }
 
+LLVOCacheEntry::LLVOCacheEntry(U32 local_id, U32 crc, U8 *buffer, S32 size, bool owns_buffer)
+{
+	mLocalID = local_id;
+	mCRC = crc;
+	mHitCount = 0;
+	mDupeCount = 0;
+	mCRCChangeCount = 0;
+	mDirty = false;
+	mBuffer = owns_buffer ? buffer : NULL;
+	mDataBuffer = buffer;
+	// Only ever unpacked from, so mapped data is safe to hand out
+	mDP.assignBuffer(buffer, size);
+}
+
 LLVOCacheEntry::LLVOCacheEntry()
 {
 	mLocalID = 0;
@@ -59,49 +95,12 @@ LLVOCacheEntry::LLVOCacheEntry()
 	mHitCount = 0;
 	mDupeCount = 0;
 	mCRCChangeCount = 0;
+	mDirty = false;
 	mBuffer = NULL;
+	mDataBuffer = NULL;
 	mDP.assignBuffer(mBuffer, 0);
 }
 
-
-static inline void checkedRead(LLFILE *fp, void *data, size_t nbytes)
-{
-	if (fread(data, 1, nbytes, fp) != nbytes)
-	{
-		llwarns << "Short read" << llendl;
-		memset(data, 0, nbytes);
-	}
-}
-
-LLVOCacheEntry::LLVOCacheEntry(LLFILE *fp)
-{
-	S32 size;
-	checkedRead(fp, &mLocalID, sizeof(U32));
-	checkedRead(fp, &mCRC, sizeof(U32));
-	checkedRead(fp, &mHitCount, sizeof(S32));
-	checkedRead(fp, &mDupeCount, sizeof(S32));
-	checkedRead(fp, &mCRCChangeCount, sizeof(S32));
-
-	checkedRead(fp, &size, sizeof(S32));
-
-	// Corruption in the cache entries
-	if ((size > 10000) || (size < 1))
-	{
-		// We've got a bogus size, skip reading it.
-		// We won't bother seeking, because the rest of this file
-		// is likely bogus, and will be tossed anyway.
-		llwarns << "Bogus cache entry, size " << size << ", aborting!" << llendl;
-		mLocalID = 0;
-		mCRC = 0;
-		mBuffer = NULL;
-		return;
-	}
-
-	mBuffer = new U8[size];
-	checkedRead(fp, mBuffer, size);
-	mDP.assignBuffer(mBuffer, size);
-}
-
 LLVOCacheEntry::~LLVOCacheEntry()
 {
 	if (mBuffer)
@@ -120,9 +119,12 @@ void LLVOCacheEntry::assignCRC(U32 crc, LLDataPackerBinaryBuffer &dp)
 		mCRC = crc;
 		mHitCount = 0;
 		mCRCChangeCount++;
+		mDirty = true;
 
-		mDP.freeBuffer();
+		// Not mDP.freeBuffer(), the old data may be mapped
+		delete [] mBuffer;
 		mBuffer = new U8[dp.getBufferSize()];
+		mDataBuffer = mBuffer;
 		mDP.assignBuffer(mBuffer, dp.getBufferSize());
 		mDP = dp;
 	}
@@ -146,6 +148,13 @@ void LLVOCacheEntry::recordHit()
 	mHitCount++;
 }
 
+void LLVOCacheEntry::setCounts(S32 hits, S32 dupes, S32 crc_changes)
+{
+	mHitCount = hits;
+	mDupeCount = dupes;
+	mCRCChangeCount = crc_changes;
+}
+
 
 void LLVOCacheEntry::dump() const
 {
@@ -157,22 +166,820 @@ void LLVOCacheEntry::dump() const
 		<< llendl;
 }
 
-static inline void checkedWrite(LLFILE *fp, const void *data, size_t nbytes)
+//---------------------------------------------------------------------------
+// LLVOCache
+//---------------------------------------------------------------------------
+
+LLVOCache* LLVOCache::sInstance = NULL;
+
+//static
+void LLVOCache::initClass(const std::string& filename, U32 max_size)
+{
+	cleanupClass();
+	sInstance = new LLVOCache(filename, max_size);
+}
+
+//static
+void LLVOCache::cleanupClass()
+{
+	if (sInstance)
+	{
+		// Let the queued writes land before the index is written
+		while (sInstance->getPending())
+		{
+			sInstance->update(0);
+			ms_sleep(1);
+		}
+		sInstance->shutdown();
+		delete sInstance;
+		sInstance = NULL;
+	}
+}
+
+LLVOCache::LLVOCache(const std::string& filename, U32 max_size)
+	: LLQueuedThread("VOCache"),
+	  mFileName(filename),
+	  mMaxSize(max_size),
+	  mMappedData(NULL),
+	  mMappedSize(0),
+	  mMappingHandle(NULL),
+	  mNumEntries(0),
+	  mLiveSize(0),
+	  mDataEnd(sizeof(Header)),
+	  mClock(0)
+{
+	clearIndex();
+	if (!open())
+	{
+		llwarns << "Object cache disabled" << llendl;
+	}
+}
+
+LLVOCache::~LLVOCache()
+{
+	close();
+}
+
+//----------------------------------------------------------------------------
+
+bool LLVOCache::open()
+{
+	LLMutexLock lock(&mIndexMutex);
+	if (mFile.open(mFileName, APR_READ|APR_WRITE|APR_CREATE|APR_BINARY, LLAPRFile::global) != APR_SUCCESS)
+	{
+		llwarns << "Unable to open object cache " << mFileName << llendl;
+		return false;
+	}
+
+	Header header;
+	if (readAt(0, (U8*)&header, sizeof(Header)) != sizeof(Header) ||
+		header.mMagic != CACHE_MAGIC || header.mVersion != INDRA_OBJECT_CACHE_VERSION)
+	{
+		// a version mismatch here means we've changed the binary format!
+		llinfos << "Object cache missing or version changed, discarding" << llendl;
+		reset();
+	}
+	else if (!header.mClean || !readIndex(header))
+	{
+		llinfos << "Object cache index missing, scanning " << mFileName << llendl;
+		mClock = header.mClock;
+		scanRecords();
+	}
+	llinfos << "Object cache has " << mNumEntries << " objects, " << mLiveSize << " bytes" << llendl;
+
+	// Records get appended over the index, so it is only valid again
+	// once close() has written it.
+	writeHeader(false);
+	map();
+	return true;
+}
+
+void LLVOCache::close()
+{
+	if (!mFile.getFileHandle())
+	{
+		return;
+	}
+	LLMutexLock lock(&mIndexMutex);
+	// Replaced and evicted records are only reclaimed here, once no entry
+	// points into the mapping any more.
+	S64 dead_size = mDataEnd - (S64)sizeof(Header) - mLiveSize;
+	if (dead_size > mLiveSize || dead_size > mMaxSize / 4)
+	{
+		if (!compact())
+		{
+			llwarns << "Unable to compact object cache " << mFileName << llendl;
+		}
+	}
+	unmap();
+	if (mFile.getFileHandle())
+	{
+		writeIndex();
+		mFile.close();
+	}
+}
+
+void LLVOCache::reset()
+{
+	clearIndex();
+	mRegions.clear();
+	mDataEnd = sizeof(Header);
+	apr_file_trunc(mFile.getFileHandle(), 0);
+}
+
+bool LLVOCache::readIndex(const Header& header)
+{
+	if (header.mDataEnd < (S64)sizeof(Header) || header.mCapacity < MIN_CAPACITY ||
+		(header.mCapacity & (header.mCapacity - 1)))
+	{
+		return false;
+	}
+	std::vector<RegionRecord> regions(header.mNumRegions);
+	S32 regions_size = (S32)(header.mNumRegions * sizeof(RegionRecord));
+	if (regions_size && readAt(header.mDataEnd, (U8*)&regions[0], regions_size) != regions_size)
+	{
+		return false;
+	}
+	mSlots.resize(header.mCapacity);
+	S32 slots_size = (S32)(header.mCapacity * sizeof(Slot));
+	if (readAt(header.mDataEnd + regions_size, (U8*)&mSlots[0], slots_size) != slots_size)
+	{
+		clearIndex();
+		return false;
+	}
+
+	mNumEntries = 0;
+	mLiveSize = 0;
+	for (U32 i = 0; i < header.mCapacity; ++i)
+	{
+		const Slot& slot = mSlots[i];
+		if (!slot.mLocalID)
+		{
+			continue;
+		}
+		if (slot.mOffset < (S64)sizeof(Header) || slot.mSize < 1 || slot.mSize > MAX_ENTRY_SIZE ||
+			slot.mOffset + (S64)sizeof(RecordHeader) + slot.mSize > header.mDataEnd)
+		{
+			llwarns << "Bogus object cache index entry, rebuilding" << llendl;
+			clearIndex();
+			return false;
+		}
+		mNumEntries++;
+		mLiveSize += sizeof(RecordHeader) + slot.mSize;
+	}
+	for (U32 i = 0; i < header.mNumRegions; ++i)
+	{
+		mRegions[regions[i].mHandle] = regions[i].mCacheID;
+	}
+	mDataEnd = header.mDataEnd;
+	mClock = header.mClock;
+	return true;
+}
+
+void LLVOCache::scanRecords()
+{
+	clearIndex();
+	mRegions.clear();
+
+	apr_off_t end = 0;
+	apr_file_seek(mFile.getFileHandle(), APR_END, &end);
+
+	S64 offset = sizeof(Header);
+	RecordHeader record;
+	U8 data[MAX_ENTRY_SIZE];
+	while (offset + (S64)sizeof(RecordHeader) <= (S64)end)
+	{
+		if (readAt(offset, (U8*)&record, sizeof(RecordHeader)) != sizeof(RecordHeader) ||
+			record.mMagic != RECORD_MAGIC || record.mSize < 1 || record.mSize > MAX_ENTRY_SIZE ||
+			offset + (S64)sizeof(RecordHeader) + record.mSize > (S64)end)
+		{
+			// Whatever follows was never completely written
+			break;
+		}
+		if (!record.mLocalID)
+		{
+			if (record.mSize != UUID_BYTES ||
+				readAt(offset + sizeof(RecordHeader), data, UUID_BYTES) != UUID_BYTES)
+			{
+				break;
+			}
+		}
+		applyRecord(record, data, offset);
+		offset += sizeof(RecordHeader) + record.mSize;
+	}
+	mDataEnd = offset;
+}
+
+bool LLVOCache::compact()
+{
+	std::string temp_filename = mFileName + ".tmp";
+	LLFILE* fp = LLFile::fopen(temp_filename, "wb");
+	if (!fp)
+	{
+		return false;
+	}
+
+	// Map everything written since open() as well
+	map();
+
+	Header header;
+	memset(&header, 0, sizeof(Header));
+	bool success = fwrite(&header, sizeof(Header), 1, fp) == 1;
+	S64 offset = sizeof(Header);
+
+	RecordHeader record;
+	memset(&record, 0, sizeof(RecordHeader));
+	record.mMagic = RECORD_MAGIC;
+	record.mSize = UUID_BYTES;
+	for (region_map_t::iterator iter = mRegions.begin(); success && iter != mRegions.end(); ++iter)
+	{
+		record.mHandle = iter->first;
+		success = fwrite(&record, sizeof(RecordHeader), 1, fp) == 1 &&
+			fwrite(iter->second.mData, UUID_BYTES, 1, fp) == 1;
+		offset += sizeof(RecordHeader) + UUID_BYTES;
+	}
+
+	// Copy the records in file order
+	std::vector<std::pair<S64, U32> > order;
+	order.reserve(mNumEntries);
+	for (U32 i = 0; i < (U32)mSlots.size(); ++i)
+	{
+		if (mSlots[i].mLocalID)
+		{
+			order.push_back(std::make_pair(mSlots[i].mOffset, i));
+		}
+	}
+	std::sort(order.begin(), order.end());
+
+	std::vector<U8> buffer;
+	for (U32 i = 0; success && i < (U32)order.size(); ++i)
+	{
+		Slot& slot = mSlots[order[i].second];
+		S32 record_size = sizeof(RecordHeader) + slot.mSize;
+		const U8* data;
+		if (slot.mOffset + record_size <= mMappedSize)
+		{
+			data = mMappedData + slot.mOffset;
+		}
+		else
+		{
+			buffer.resize(record_size);
+			if (readAt(slot.mOffset, &buffer[0], record_size) != record_size)
+			{
+				success = false;
+				break;
+			}
+			data = &buffer[0];
+		}
+		success = fwrite(data, record_size, 1, fp) == 1;
+		slot.mOffset = offset;
+		offset += record_size;
+	}
+	fclose(fp);
+
+	unmap();
+	if (success)
+	{
+		mFile.close();
+		LLFile::remove(mFileName);
+		success = LLFile::rename(temp_filename, mFileName) == 0;
+		if (mFile.open(mFileName, APR_READ|APR_WRITE|APR_BINARY, LLAPRFile::global) != APR_SUCCESS)
+		{
+			llwarns << "Unable to reopen object cache " << mFileName << llendl;
+		}
+	}
+	if (!success)
+	{
+		// The offsets may point anywhere now; start over next time.
+		LLFile::remove(temp_filename);
+		if (mFile.getFileHandle())
+		{
+			reset();
+		}
+		return false;
+	}
+	mDataEnd = offset;
+	return true;
+}
+
+void LLVOCache::writeIndex()
 {
-	if (fwrite(data, 1, nbytes, fp) != nbytes)
+	std::vector<RegionRecord> regions;
+	for (region_map_t::iterator iter = mRegions.begin(); iter != mRegions.end(); ++iter)
+	{
+		RegionRecord region;
+		region.mHandle = iter->first;
+		region.mCacheID = iter->second;
+		regions.push_back(region);
+	}
+	S32 regions_size = (S32)(regions.size() * sizeof(RegionRecord));
+	S32 slots_size = (S32)(mSlots.size() * sizeof(Slot));
+	if ((regions_size && writeAt(mDataEnd, (U8*)&regions[0], regions_size) != regions_size) ||
+		writeAt(mDataEnd + regions_size, (U8*)&mSlots[0], slots_size) != slots_size)
+	{
+		// The header stays unclean, the next startup scans the records
+		llwarns << "Unable to write object cache index" << llendl;
+		return;
+	}
+	apr_file_trunc(mFile.getFileHandle(), mDataEnd + regions_size + slots_size);
+	writeHeader(true);
+}
+
+void LLVOCache::writeHeader(bool clean)
+{
+	Header header;
+	header.mMagic = CACHE_MAGIC;
+	header.mVersion = INDRA_OBJECT_CACHE_VERSION;
+	header.mClean = clean ? 1 : 0;
+	header.mClock = mClock;
+	header.mDataEnd = mDataEnd;
+	header.mNumRegions = (U32)mRegions.size();
+	header.mCapacity = (U32)mSlots.size();
+	if (writeAt(0, (U8*)&header, sizeof(Header)) != sizeof(Header))
 	{
 		llwarns << "Short write" << llendl;
 	}
 }
 
-void LLVOCacheEntry::writeToFile(LLFILE *fp) const
+void LLVOCache::map()
+{
+	unmap();
+	if (mDataEnd <= (S64)sizeof(Header))
+	{
+		return;
+	}
+	apr_os_file_t fd;
+	apr_os_file_get(&fd, mFile.getFileHandle());
+#if LL_WINDOWS
+	HANDLE mapping = CreateFileMapping(fd, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping)
+	{
+		void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, (SIZE_T)mDataEnd);
+		if (view)
+		{
+			mMappingHandle = mapping;
+			mMappedData = (const U8*)view;
+		}
+		else
+		{
+			CloseHandle(mapping);
+		}
+	}
+#else
+	void* view = mmap(NULL, (size_t)mDataEnd, PROT_READ, MAP_SHARED, fd, 0);
+	if (view != MAP_FAILED)
+	{
+		mMappedData = (const U8*)view;
+	}
+#endif
+	if (!mMappedData)
+	{
+		// Everything gets read from the file instead
+		llwarns << "Unable to map " << mFileName << llendl;
+		return;
+	}
+	mMappedSize = mDataEnd;
+}
+
+void LLVOCache::unmap()
 {
-	checkedWrite(fp, &mLocalID, sizeof(U32));
-	checkedWrite(fp, &mCRC, sizeof(U32));
-	checkedWrite(fp, &mHitCount, sizeof(S32));
-	checkedWrite(fp, &mDupeCount, sizeof(S32));
-	checkedWrite(fp, &mCRCChangeCount, sizeof(S32));
-	S32 size = mDP.getBufferSize();
-	checkedWrite(fp, &size, sizeof(S32));
-	checkedWrite(fp, mBuffer, size);
+	if (mMappedData)
+	{
+#if LL_WINDOWS
+		UnmapViewOfFile(mMappedData);
+		CloseHandle((HANDLE)mMappingHandle);
+		mMappingHandle = NULL;
+#else
+		munmap((void*)mMappedData, (size_t)mMappedSize);
+#endif
+	}
+	mMappedData = NULL;
+	mMappedSize = 0;
+}
+
+//----------------------------------------------------------------------------
+
+void LLVOCache::setRegionCacheID(U64 handle, const LLUUID& cache_id)
+{
+	LLMutexLock lock(&mIndexMutex);
+	region_map_t::iterator iter = mRegions.find(handle);
+	if (iter != mRegions.end() && iter->second != cache_id)
+	{
+		llinfos << "Cache ID doesn't match for this region, discarding" << llendl;
+		removeRegion(handle);
+	}
+	mRegions[handle] = cache_id;
+}
+
+LLVOCacheEntry* LLVOCache::fetch(U64 handle, U32 local_id, U32 crc, bool& crc_miss)
+{
+	crc_miss = false;
+	if (!mFile.getFileHandle())
+	{
+		return NULL;
+	}
+
+	Slot slot;
+	{
+		LLMutexLock lock(&mIndexMutex);
+		Slot* slotp = findSlot(handle, local_id);
+		if (!slotp)
+		{
+			return NULL;
+		}
+		if (slotp->mCRC != crc)
+		{
+			crc_miss = true;
+			return NULL;
+		}
+		slotp->mLastUsed = ++mClock;
+		slot = *slotp;
+	}
+
+	// Records are complete before they are indexed, and never change after.
+	RecordHeader record;
+	U8* data;
+	bool owns_data;
+	if (slot.mOffset + (S64)sizeof(RecordHeader) + slot.mSize <= mMappedSize)
+	{
+		memcpy(&record, mMappedData + slot.mOffset, sizeof(RecordHeader));
+		data = (U8*)mMappedData + slot.mOffset + sizeof(RecordHeader);
+		owns_data = false;
+	}
+	else
+	{
+		data = new U8[slot.mSize];
+		owns_data = true;
+		if (readAt(slot.mOffset, (U8*)&record, sizeof(RecordHeader)) != sizeof(RecordHeader) ||
+			readAt(slot.mOffset + sizeof(RecordHeader), data, slot.mSize) != slot.mSize)
+		{
+			record.mMagic = 0;
+		}
+	}
+	if (record.mMagic != RECORD_MAGIC || record.mLocalID != local_id ||
+		record.mHandle != handle || record.mSize != slot.mSize)
+	{
+		llwarns << "Bogus object cache record for " << local_id << llendl;
+		if (owns_data)
+		{
+			delete [] data;
+		}
+		return NULL;
+	}
+
+	LLVOCacheEntry* entry = new LLVOCacheEntry(local_id, crc, data, slot.mSize, owns_data);
+	entry->setCounts(record.mHitCount, record.mDupeCount, record.mCRCChangeCount);
+	return entry;
+}
+
+void LLVOCache::write(U64 handle, const LLUUID& cache_id, const std::vector<LLVOCacheEntry*>& entries)
+{
+	if (!mFile.getFileHandle() || entries.empty())
+	{
+		return;
+	}
+
+	// Each batch starts with the cache id, so that scanRecords() can tell
+	// which records are stale.
+	S32 size = sizeof(RecordHeader) + UUID_BYTES;
+	for (U32 i = 0; i < (U32)entries.size(); ++i)
+	{
+		size += sizeof(RecordHeader) + entries[i]->getSize();
+	}
+
+	WriteRequest* req = new WriteRequest(this, generateHandle());
+	req->mData.resize(size);
+	U8* datap = &req->mData[0];
+
+	RecordHeader record;
+	memset(&record, 0, sizeof(RecordHeader));
+	record.mMagic = RECORD_MAGIC;
+	record.mHandle = handle;
+	record.mSize = UUID_BYTES;
+	memcpy(datap, &record, sizeof(RecordHeader));
+	memcpy(datap + sizeof(RecordHeader), cache_id.mData, UUID_BYTES);
+	datap += sizeof(RecordHeader) + UUID_BYTES;
+
+	for (U32 i = 0; i < (U32)entries.size(); ++i)
+	{
+		const LLVOCacheEntry* entry = entries[i];
+		record.mLocalID = entry->getLocalID();
+		record.mCRC = entry->getCRC();
+		record.mHitCount = entry->getHitCount();
+		record.mDupeCount = entry->getDupeCount();
+		record.mCRCChangeCount = entry->getCRCChangeCount();
+		record.mSize = entry->getSize();
+		memcpy(datap, &record, sizeof(RecordHeader));
+		memcpy(datap + sizeof(RecordHeader), entry->getData(), record.mSize);
+		datap += sizeof(RecordHeader) + record.mSize;
+	}
+
+	if (!addRequest(req))
+	{
+		llwarns << "Unable to queue object cache write" << llendl;
+	}
+}
+
+void LLVOCache::removeAll()
+{
+	LLMutexLock lock(&mIndexMutex);
+	clearIndex();
+	mRegions.clear();
+}
+
+//----------------------------------------------------------------------------
+
+LLVOCache::WriteRequest::WriteRequest(LLVOCache* cache, handle_t handle)
+	: LLQueuedThread::QueuedRequest(handle, LLQueuedThread::PRIORITY_LOW, FLAG_AUTO_COMPLETE),
+	  mCache(cache)
+{
+}
+
+// virtual (WORKER THREAD)
+bool LLVOCache::WriteRequest::processRequest()
+{
+	mCache->writeRecords(mData);
+	return true;
+}
+
+void LLVOCache::writeRecords(const std::vector<U8>& data)
+{
+	S64 offset;
+	{
+		LLMutexLock lock(&mIndexMutex);
+		offset = mDataEnd;
+		mDataEnd += data.size();
+	}
+	if (writeAt(offset, &data[0], (S32)data.size()) != (S32)data.size())
+	{
+		// Not indexed; scanRecords() stops at the partial record
+		llwarns << "Short write to object cache" << llendl;
+		return;
+	}
+
+	LLMutexLock lock(&mIndexMutex);
+	S32 pos = 0;
+	while (pos < (S32)data.size())
+	{
+		RecordHeader record;
+		memcpy(&record, &data[pos], sizeof(RecordHeader));
+		applyRecord(record, &data[pos + sizeof(RecordHeader)], offset + pos);
+		pos += sizeof(RecordHeader) + record.mSize;
+	}
+	evict();
+}
+
+//----------------------------------------------------------------------------
+// mIndexMutex must be locked for the following functions!
+
+void LLVOCache::applyRecord(const RecordHeader& record, const U8* data, S64 offset)
+{
+	if (!record.mLocalID)
+	{
+		LLUUID cache_id;
+		memcpy(cache_id.mData, data, UUID_BYTES);
+		region_map_t::iterator iter = mRegions.find(record.mHandle);
+		if (iter != mRegions.end() && iter->second != cache_id)
+		{
+			removeRegion(record.mHandle);
+		}
+		mRegions[record.mHandle] = cache_id;
+		return;
+	}
+	Slot slot;
+	slot.mHandle = record.mHandle;
+	slot.mLocalID = record.mLocalID;
+	slot.mCRC = record.mCRC;
+	slot.mOffset = offset;
+	slot.mSize = record.mSize;
+	slot.mLastUsed = ++mClock;
+	insertSlot(slot);
+}
+
+void LLVOCache::clearIndex()
+{
+	Slot empty;
+	memset(&empty, 0, sizeof(Slot));
+	mSlots.assign(MIN_CAPACITY, empty);
+	mNumEntries = 0;
+	mLiveSize = 0;
+}
+
+//static
+U32 LLVOCache::hashKey(U64 handle, U32 local_id)
+{
+	U64 key = handle ^ ((U64)local_id * 0x9E3779B97F4A7C15ULL);
+	key ^= key >> 31;
+	key *= 0xBF58476D1CE4E5B9ULL;
+	key ^= key >> 29;
+	return (U32)key;
+}
+
+LLVOCache::Slot* LLVOCache::findSlot(U64 handle, U32 local_id)
+{
+	U32 mask = (U32)mSlots.size() - 1;
+	for (U32 i = hashKey(handle, local_id) & mask; mSlots[i].mLocalID; i = (i + 1) & mask)
+	{
+		if (mSlots[i].mLocalID == local_id && mSlots[i].mHandle == handle)
+		{
+			return &mSlots[i];
+		}
+	}
+	return NULL;
+}
+
+void LLVOCache::insertSlot(const Slot& slot)
+{
+	Slot* existing = findSlot(slot.mHandle, slot.mLocalID);
+	if (existing)
+	{
+		mLiveSize += slot.mSize - existing->mSize;
+		*existing = slot;
+		return;
+	}
+	// Keep the table at most half full
+	if ((mNumEntries + 1) * 2 > (U32)mSlots.size())
+	{
+		resize((U32)mSlots.size() * 2);
+	}
+	U32 mask = (U32)mSlots.size() - 1;
+	U32 i = hashKey(slot.mHandle, slot.mLocalID) & mask;
+	while (mSlots[i].mLocalID)
+	{
+		i = (i + 1) & mask;
+	}
+	mSlots[i] = slot;
+	mNumEntries++;
+	mLiveSize += sizeof(RecordHeader) + slot.mSize;
+}
+
+// Linear probing without tombstones: later slots of the probe sequence are
+// shifted back into the hole.
+void LLVOCache::removeSlot(Slot* slot)
+{
+	mNumEntries--;
+	mLiveSize -= sizeof(RecordHeader) + slot->mSize;
+
+	U32 mask = (U32)mSlots.size() - 1;
+	U32 hole = (U32)(slot - &mSlots[0]);
+	U32 i = hole;
+	while (1)
+	{
+		i = (i + 1) & mask;
+		if (!mSlots[i].mLocalID)
+		{
+			break;
+		}
+		U32 home = hashKey(mSlots[i].mHandle, mSlots[i].mLocalID) & mask;
+		// Move it unless its home lies cyclically in (hole, i]
+		bool in_place = (hole <= i) ? (home > hole && home <= i) : (home > hole || home <= i);
+		if (!in_place)
+		{
+			mSlots[hole] = mSlots[i];
+			hole = i;
+		}
+	}
+	mSlots[hole].mLocalID = 0;
+}
+
+void LLVOCache::removeRegion(U64 handle)
+{
+	std::vector<Slot> slots;
+	slots.swap(mSlots);
+	Slot empty;
+	memset(&empty, 0, sizeof(Slot));
+	mSlots.assign(slots.size(), empty);
+	mNumEntries = 0;
+	mLiveSize = 0;
+	for (U32 i = 0; i < (U32)slots.size(); ++i)
+	{
+		if (slots[i].mLocalID && slots[i].mHandle != handle)
+		{
+			insertSlot(slots[i]);
+		}
+	}
+}
+
+void LLVOCache::resize(U32 capacity)
+{
+	std::vector<Slot> slots;
+	slots.swap(mSlots);
+	Slot empty;
+	memset(&empty, 0, sizeof(Slot));
+	mSlots.assign(capacity, empty);
+	mNumEntries = 0;
+	mLiveSize = 0;
+	for (U32 i = 0; i < (U32)slots.size(); ++i)
+	{
+		if (slots[i].mLocalID)
+		{
+			insertSlot(slots[i]);
+		}
+	}
+}
+
+// Drops the least recently used objects of any region until the cache is
+// back under its size limit, with some slack so this doesn't run on every
+// write.
+void LLVOCache::evict()
+{
+	if (mLiveSize <= mMaxSize)
+	{
+		return;
+	}
+
+	std::vector<std::pair<U32, std::pair<U64, U32> > > lru;
+	lru.reserve(mNumEntries);
+	for (U32 i = 0; i < (U32)mSlots.size(); ++i)
+	{
+		const Slot& slot = mSlots[i];
+		if (slot.mLocalID)
+		{
+			lru.push_back(std::make_pair(slot.mLastUsed, std::make_pair(slot.mHandle, slot.mLocalID)));
+		}
+	}
+	std::sort(lru.begin(), lru.end());
+
+	S64 target_size = mMaxSize - mMaxSize / 8;
+	U32 evicted = 0;
+	for (U32 i = 0; i < (U32)lru.size() && mLiveSize > target_size; ++i)
+	{
+		Slot* slot = findSlot(lru[i].second.first, lru[i].second.second);
+		if (slot)
+		{
+			removeSlot(slot);
+			evicted++;
+		}
+	}
+	llinfos << "Evicted " << evicted << " objects from the object cache" << llendl;
+}
+
+//----------------------------------------------------------------------------
+
+S32 LLVOCache::readAt(S64 offset, U8* buffer, S32 size)
+{
+	apr_file_t* file = mFile.getFileHandle();
+	if (!file)
+	{
+		return 0;
+	}
+#if LL_WINDOWS
+	LLMutexLock lock(&mFileMutex);
+	apr_off_t pos = offset;
+	if (apr_file_seek(file, APR_SET, &pos) != APR_SUCCESS)
+	{
+		return 0;
+	}
+	apr_size_t bytes = size;
+	apr_file_read(file, buffer, &bytes);
+	return (S32)bytes;
+#else
+	apr_os_file_t fd;
+	apr_os_file_get(&fd, file);
+	S32 total = 0;
+	while (total < size)
+	{
+		ssize_t res = pread(fd, buffer + total, size - total, (off_t)(offset + total));
+		if (res <= 0)
+		{
+			break;
+		}
+		total += (S32)res;
+	}
+	return total;
+#endif
+}
+
+S32 LLVOCache::writeAt(S64 offset, const U8* buffer, S32 size)
+{
+	apr_file_t* file = mFile.getFileHandle();
+	if (!file)
+	{
+		return 0;
+	}
+#if LL_WINDOWS
+	LLMutexLock lock(&mFileMutex);
+	apr_off_t pos = offset;
+	if (apr_file_seek(file, APR_SET, &pos) != APR_SUCCESS)
+	{
+		return 0;
+	}
+	apr_size_t bytes = size;
+	apr_file_write(file, buffer, &bytes);
+	return (S32)bytes;
+#else
+	apr_os_file_t fd;
+	apr_os_file_get(&fd, file);
+	S32 total = 0;
+	while (total < size)
+	{
+		ssize_t res = pwrite(fd, buffer + total, size - total, (off_t)(offset + total));
+		if (res <= 0)
+		{
+			break;
+		}
+		total += (S32)res;
+	}
+	return total;
+#endif
 }
@@ -33,9 +33,14 @@
 #ifndef LL_LLVOCACHE_H
 #define LL_LLVOCACHE_H
 
+#include <map>
+#include <vector>
+
+#include "llapr.h"
 #include "lluuid.h"
 #include "lldatapacker.h"
 #include "lldlinked.h"
+#include "llqueuedthread.h"
 
 
 //---------------------------------------------------------------------------
@@ -46,21 +51,30 @@ class LLVOCacheEntry : public LLDLinked<LLVOCacheEntry>
 {
 public:
 	LLVOCacheEntry(U32 local_id, U32 crc, LLDataPackerBinaryBuffer &dp);
-	LLVOCacheEntry(LLFILE *fp);
+	// Entry read back from LLVOCache.  Takes ownership of buffer unless it
+	// points into the cache file mapping.
+	LLVOCacheEntry(U32 local_id, U32 crc, U8 *buffer, S32 size, bool owns_buffer);
 	LLVOCacheEntry();
 	~LLVOCacheEntry();
 
 	U32 getLocalID() const			{ return mLocalID; }
 	U32 getCRC() const				{ return mCRC; }
 	S32 getHitCount() const			{ return mHitCount; }
+	S32 getDupeCount() const		{ return mDupeCount; }
 	S32 getCRCChangeCount() const	{ return mCRCChangeCount; }
+	const U8 *getData() const		{ return mDataBuffer; }
+	S32 getSize() const				{ return mDP.getBufferSize(); }
 
 	void dump() const;
-	void writeToFile(LLFILE *fp) const;
 	void assignCRC(U32 crc, LLDataPackerBinaryBuffer &dp);
 	LLDataPackerBinaryBuffer *getDP(U32 crc);
 	void recordHit();
 	void recordDupe() { mDupeCount++; }
+	void setCounts(S32 hits, S32 dupes, S32 crc_changes);
+
+	// True when the entry has changed since it was read from LLVOCache
+	bool isDirty() const			{ return mDirty; }
+	void setDirty(bool dirty)		{ mDirty = dirty; }
 
 protected:
 	U32							mLocalID;
@@ -68,8 +82,155 @@ protected:
 	S32							mHitCount;
 	S32							mDupeCount;
 	S32							mCRCChangeCount;
+	bool						mDirty;
 	LLDataPackerBinaryBuffer	mDP;
-	U8							*mBuffer;
+	U8							*mBuffer;		// owned, NULL for mapped entries
+	const U8					*mDataBuffer;	// mBuffer or the mapped data
+};
+
+//---------------------------------------------------------------------------
+// Object cache for all regions of a grid, kept in a single file.
+//
+// The file is an append-only log of object records followed, after a clean
+// shutdown, by the index: the simulators' cache ids and an open addressing
+// hash table of (region handle, local id) -> record.  Startup reads the index
+// in one go and maps the records, so a region connect costs nothing and each
+// object is fetched from the mapping when an ObjectUpdateCached asks for it.
+// If the viewer didn't shut down cleanly the index is rebuilt by scanning
+// the records.
+//
+// Regions hand their changed entries to write() when they are disconnected;
+// records are appended on the cache thread.  The live size is bounded by
+// LRU eviction across all regions, and the space of replaced and evicted
+// records is reclaimed when the cache is closed.
+class LLVOCache : public LLQueuedThread
+{
+public:
+	static void initClass(const std::string& filename, U32 max_size);
+	static void cleanupClass();
+	// NULL unless logged in
+	static LLVOCache* getInstance() { return sInstance; }
+
+	// Forgets the region's objects if the simulator's cache id has changed.
+	void setRegionCacheID(U64 handle, const LLUUID& cache_id);
+	// Returns a new entry for the object, or NULL if it isn't cached with
+	// this crc.  crc_miss is set if it is cached with another one.
+	LLVOCacheEntry* fetch(U64 handle, U32 local_id, U32 crc, bool& crc_miss);
+	// Copies the entries and queues them to be written on the cache thread.
+	void write(U64 handle, const LLUUID& cache_id, const std::vector<LLVOCacheEntry*>& entries);
+	// Forgets every object, for when the cached data turns out to be bogus.
+	void removeAll();
+
+	U32 getNumEntries() const { return mNumEntries; }
+
+private:
+	LLVOCache(const std::string& filename, U32 max_size);
+	~LLVOCache();
+
+	struct Header
+	{
+		U32 mMagic;
+		U32 mVersion;
+		U32 mClean;			// the index follows the records
+		U32 mClock;			// LRU clock
+		S64 mDataEnd;
+		U32 mNumRegions;
+		U32 mCapacity;		// hash slots, power of 2
+	};
+	// Records with a local id of 0 carry the region's cache id as data.
+	struct RecordHeader
+	{
+		U32 mMagic;
+		U32 mLocalID;
+		U64 mHandle;
+		U32 mCRC;
+		S32 mHitCount;
+		S32 mDupeCount;
+		S32 mCRCChangeCount;
+		S32 mSize;
+		U32 mPad;
+	};
+	struct RegionRecord
+	{
+		U64 mHandle;
+		LLUUID mCacheID;
+	};
+	struct Slot
+	{
+		U64 mHandle;
+		U32 mLocalID;		// 0: empty
+		U32 mCRC;
+		S64 mOffset;		// of the RecordHeader
+		S32 mSize;
+		U32 mLastUsed;
+	};
+
+	class WriteRequest : public LLQueuedThread::QueuedRequest
+	{
+	public:
+		WriteRequest(LLVOCache* cache, handle_t handle);
+		/*virtual*/ bool processRequest();
+
+		std::vector<U8> mData;		// RecordHeaders and object data
+	protected:
+		/*virtual*/ ~WriteRequest() {}
+	private:
+		LLVOCache* mCache;
+	};
+
+	bool open();
+	void close();
+	void reset();
+	bool readIndex(const Header& header);
+	void scanRecords();
+	bool compact();
+	void writeIndex();
+	void writeHeader(bool clean);
+	void map();
+	void unmap();
+
+	// mIndexMutex must be locked for the following functions
+	void applyRecord(const RecordHeader& record, const U8* data, S64 offset);
+	void clearIndex();
+	Slot* findSlot(U64 handle, U32 local_id);
+	void insertSlot(const Slot& slot);
+	void removeSlot(Slot* slot);
+	void removeRegion(U64 handle);
+	void resize(U32 capacity);
+	void evict();
+
+	// Cache thread
+	void writeRecords(const std::vector<U8>& data);
+
+	S32 readAt(S64 offset, U8* buffer, S32 size);
+	S32 writeAt(S64 offset, const U8* buffer, S32 size);
+
+	static U32 hashKey(U64 handle, U32 local_id);
+
+private:
+	static LLVOCache* sInstance;
+
+	std::string mFileName;
+	LLAPRFile mFile;
+	S64 mMaxSize;
+
+	// Read only mapping of the records that were in the file when it was
+	// opened; they are never moved or overwritten until close().
+	const U8* mMappedData;
+	S64 mMappedSize;
+	void* mMappingHandle;
+
+	LLMutex mIndexMutex;
+	std::vector<Slot> mSlots;
+	U32 mNumEntries;
+	S64 mLiveSize;		// bytes of the records in mSlots
+	S64 mDataEnd;
+	U32 mClock;
+	typedef std::map<U64, LLUUID> region_map_t;
+	region_map_t mRegions;
+#if LL_WINDOWS
+	LLMutex mFileMutex; // no positioned reads on windows
+#endif
 };
 
 #endif
@@ -126,9 +126,9 @@ LLDrawable* LLVOPartGroup::createDrawable(LLPipeline *pipeline)
 
 F32 LLVOPartGroup::getPartSize(S32 idx)
 {
-	if (idx < (S32) mViewerPartGroupp->mParticles.size())
+	if (idx < mViewerPartGroupp->getCount())
 	{
-		return mViewerPartGroupp->mParticles[idx]->mScale.mV[0];
+		return mViewerPartGroupp->mParticles.mScale[idx].mV[0];
 	}
 
 	return 0.f;
@@ -181,17 +181,16 @@ BOOL LLVOPartGroup::updateGeometry(LLDrawable *drawable)
 	F32 pixel_meter_ratio = LLViewerCamera::getInstance()->getPixelMeterRatio();
 	pixel_meter_ratio *= pixel_meter_ratio;
 
-	LLViewerPartSim::checkParticleCount(mViewerPartGroupp->mParticles.size()) ;
+	const LLPartStore& parts = mViewerPartGroupp->mParticles;
+	LLViewerPartSim::checkParticleCount(parts.size()) ;
 
 	S32 count=0;
 	mDepth = 0.f;
 	S32 i = 0 ;
 	LLVector3 camera_agent = getCameraPosition();
-	for (i = 0 ; i < (S32)mViewerPartGroupp->mParticles.size(); i++)
+	for (i = 0 ; i < parts.size(); i++)
 	{
-		const LLViewerPart *part = mViewerPartGroupp->mParticles[i];
-
-		LLVector3 part_pos_agent(part->mPosAgent);
+		LLVector3 part_pos_agent(parts.mPosAgent[i]);
 		LLVector3 at(part_pos_agent - camera_agent);
 
 		F32 camera_dist_squared = at.lengthSquared();
@@ -200,7 +199,7 @@ BOOL LLVOPartGroup::updateGeometry(LLDrawable *drawable)
 			inv_camera_dist_squared = 1.f / camera_dist_squared;
 		else
 			inv_camera_dist_squared = 1.f;
-		F32 area = part->mScale.mV[0] * part->mScale.mV[1] * inv_camera_dist_squared;
+		F32 area = parts.mScale[i].mV[0] * parts.mScale[i].mV[1] * inv_camera_dist_squared;
 		tot_area = llmax(tot_area, area);
  		
 		if (tot_area > max_area)
@@ -231,7 +230,7 @@ BOOL LLVOPartGroup::updateGeometry(LLDrawable *drawable)
 		
 		facep->setViewerObject(this);
 
-		if (part->mFlags & LLPartData::LL_PART_EMISSIVE_MASK)
+		if (parts.mFlags[i] & LLPartData::LL_PART_EMISSIVE_MASK)
 		{
 			facep->setState(LLFace::FULLBRIGHT);
 		}
@@ -240,9 +239,9 @@ BOOL LLVOPartGroup::updateGeometry(LLDrawable *drawable)
 			facep->clearState(LLFace::FULLBRIGHT);
 		}
 
-		facep->mCenterLocal = part->mPosAgent;
-		facep->setFaceColor(part->mColor);
-		facep->setTexture(part->mImagep);
+		facep->mCenterLocal = parts.mPosAgent[i];
+		facep->setFaceColor(parts.mColor[i]);
+		facep->setTexture(mViewerPartGroupp->getPartImage(i));
 
 		mPixelArea = tot_area * pixel_meter_ratio;
 		const F32 area_scale = 10.f; // scale area to increase priority a bit
@@ -272,17 +271,16 @@ void LLVOPartGroup::getGeometry(S32 idx,
 								LLStrider<LLColor4U>& colorsp, 
 								LLStrider<U16>& indicesp)
 {
-	if (idx >= (S32) mViewerPartGroupp->mParticles.size())
+	const LLPartStore& parts = mViewerPartGroupp->mParticles;
+	if (idx >= parts.size())
 	{
 		return;
 	}
 
-	const LLViewerPart &part = *((LLViewerPart*) (mViewerPartGroupp->mParticles[idx]));
-
 	U32 vert_offset = mDrawable->getFace(idx)->getGeomIndex();
 
 	
-	LLVector3 part_pos_agent(part.mPosAgent);
+	LLVector3 part_pos_agent(parts.mPosAgent[idx]);
 	LLVector3 camera_agent = getCameraPosition(); 
 	LLVector3 at = part_pos_agent - camera_agent;
 	LLVector3 up;
@@ -293,9 +291,9 @@ void LLVOPartGroup::getGeometry(S32 idx,
 	up = right % at;
 	up.normalize();
 
-	if (part.mFlags & LLPartData::LL_PART_FOLLOW_VELOCITY_MASK)
+	if (parts.mFlags[idx] & LLPartData::LL_PART_FOLLOW_VELOCITY_MASK)
 	{
-		LLVector3 normvel = part.mVelocity;
+		LLVector3 normvel = parts.mVelocity[idx];
 		normvel.normalize();
 		LLVector2 up_fracs;
 		up_fracs.mV[0] = normvel*right;
@@ -311,8 +309,8 @@ void LLVOPartGroup::getGeometry(S32 idx,
 		right.normalize();
 	}
 
-	right *= 0.5f*part.mScale.mV[0];
-	up *= 0.5f*part.mScale.mV[1];
+	right *= 0.5f*parts.mScale[idx].mV[0];
+	up *= 0.5f*parts.mScale[idx].mV[1];
 
 
 	LLVector3 normal = -LLViewerCamera::getInstance()->getXAxis();
@@ -322,10 +320,11 @@ void LLVOPartGroup::getGeometry(S32 idx,
 	*verticesp++ = part_pos_agent + up + right;
 	*verticesp++ = part_pos_agent - up + right;
 
-	*colorsp++ = part.mColor;
-	*colorsp++ = part.mColor;
-	*colorsp++ = part.mColor;
-	*colorsp++ = part.mColor;
+	LLColor4U color = parts.mColor[idx];
+	*colorsp++ = color;
+	*colorsp++ = color;
+	*colorsp++ = color;
+	*colorsp++ = color;
 
 	*texcoordsp++ = LLVector2(0.f, 1.f);
 	*texcoordsp++ = LLVector2(0.f, 0.f);
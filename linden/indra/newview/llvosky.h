@@ -39,6 +39,7 @@
 #include "llviewerimage.h"
 #include "llviewerobject.h"
 #include "llframetimer.h"
+#include "llskyeval.h"
 
 
 //////////////////////////////////
@@ -452,14 +453,6 @@ public:
 	LLColor3 createDiffuseFromWL(LLColor3 diffuse, LLColor3 ambient, LLColor3 sundiffuse, LLColor3 sunambient);
 	LLColor3 createAmbientFromWL(LLColor3 ambient, LLColor3 sundiffuse, LLColor3 sunambient);
 
-	void calcSkyColorWLVert(LLVector3 & Pn, LLColor3 & vary_HazeColor, LLColor3 & vary_CloudColorSun, 
-							LLColor3 & vary_CloudColorAmbient, F32 & vary_CloudDensity, 
-							LLVector2 vary_HorizontalProjection[2]);
-
-	LLColor3 calcSkyColorWLFrag(LLVector3 & Pn, LLColor3 & vary_HazeColor,	LLColor3 & vary_CloudColorSun, 
-							LLColor3 & vary_CloudColorAmbient, F32 & vary_CloudDensity, 
-							LLVector2 vary_HorizontalProjection[2]);
-
 public:
 	enum
 	{
@@ -481,6 +474,7 @@ public:
 
 	// Initialize/delete data that's only inited once per class.
 	static void initClass();
+	static void cleanupClass();
 	void init();
 	void initCubeMap();
 	void initEmpty();
@@ -499,6 +493,8 @@ public:
 
 	void initSkyTextureDirs(const S32 side, const S32 tile);
 	void createSkyTexture(const S32 side, const S32 tile);
+	// All six faces, on worker threads when SkyTextureThreaded is on
+	void createSkyTextures();
 
 	LLColor4 calcSkyColorInDir(const LLVector3& dir, bool isShiny = false);
 	
@@ -634,6 +630,9 @@ protected:
 
 	LLFrameTimer		mUpdateTimer;
 
+	LLSkyEval			mSkyEval;
+	void updateSkyEval();
+
 public:
 	//by bao
 	//fake vertex buffer updating
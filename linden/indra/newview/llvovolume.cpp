@@ -60,6 +60,7 @@
 #include "llviewerimagelist.h"
 #include "llviewerregion.h"
 #include "llviewertextureanim.h"
+#include "llvocache.h"
 #include "llworld.h"
 #include "llselectmgr.h"
 #include "pipeline.h"
@@ -82,6 +83,7 @@ F32 LLVOVolume::sLODFactor = 1.f;
 F32	LLVOVolume::sLODSlopDistanceFactor = 0.5f; //Changing this to zero, effectively disables the LOD transition slop 
 F32 LLVOVolume::sDistanceFactor = 1.0f;
 S32 LLVOVolume::sNumLODChanges = 0;
+std::vector<LLPointer<LLVOVolume> > LLVOVolume::sPendingBuilds;
 LLPointer<LLObjectMediaDataClient> LLVOVolume::sObjectMediaClient = NULL;
 LLPointer<LLObjectMediaNavigateClient> LLVOVolume::sObjectMediaNavigateClient = NULL;
 
@@ -184,6 +186,7 @@ LLVOVolume::LLVOVolume(const LLUUID &id, const LLPCode pcode, LLViewerRegion *re
 	mNumFaces = 0;
 	mLODChanged = FALSE;
 	mSculptChanged = FALSE;
+	mVolumeBuildPending = FALSE;
 	mIndexInTex = 0;
 }
 
@@ -227,6 +230,12 @@ void LLVOVolume::initClass()
 	}
 }
 
+// static
+void LLVOVolume::cleanupClass()
+{
+	sPendingBuilds.clear();
+}
+
 
 U32 LLVOVolume::processUpdateMessage(LLMessageSystem *mesgsys,
 										  void **user_data,
@@ -336,10 +345,11 @@ U32 LLVOVolume::processUpdateMessage(LLMessageSystem *mesgsys,
 			{
 				// Well, crap, there's something bogus in the data that we're unpacking.
 				dp->dumpBufferToLog();
-				llwarns << "Flushing cache files" << llendl;
-				std::string mask;
-				mask = gDirUtilp->getDirDelimiter() + "*.slc";
-				gDirUtilp->deleteFilesInDir(gDirUtilp->getExpandedFilename(LL_PATH_CACHE,""), mask);
+				llwarns << "Flushing object cache" << llendl;
+				if (LLVOCache::getInstance())
+				{
+					LLVOCache::getInstance()->removeAll();
+				}
 // 				llerrs << "Bogus TE data in " << getID() << ", crashing!" << llendl;
 				llwarns << "Bogus TE data in " << getID() << llendl;
 			}
@@ -684,7 +694,8 @@ void LLVOVolume::updateTextureVirtualSize()
 			S32 texture_discard = mSculptTexture->getDiscardLevel(); //try to match the texture
 			S32 current_discard = getVolume() ? getVolume()->getSculptLevel() : -2;
 
-			if (texture_discard >= 0 && //texture has some data available
+			if (!mVolumeBuildPending && //not already waiting on a background build
+				texture_discard >= 0 && //texture has some data available
 				(texture_discard < current_discard || //texture has more data than last rebuild
 				current_discard < 0)) //no previous rebuild
 			{
@@ -826,6 +837,11 @@ BOOL LLVOVolume::setVolume(const LLVolumeParams &volume_params, const S32 detail
 			}
 		}
 	}
+
+	if (deferVolumeBuild(volume_params))
+	{
+		return FALSE;
+	}
 	
 	if ((LLPrimitive::setVolume(volume_params, mLOD, (mVolumeImpl && mVolumeImpl->isVolumeUnique()))) || mSculptChanged)
 	{
@@ -887,6 +903,120 @@ void LLVOVolume::updateSculptTexture()
 }
 
 
+// Keeps the current volume while the volume for a new LOD is built in the
+// background.  New shapes and unique volumes are still built right away.
+BOOL LLVOVolume::deferVolumeBuild(const LLVolumeParams& volume_params)
+{
+	LLVolumeMgr* volume_mgr = getVolumeManager();
+	LLVolume* volumep = getVolume();
+	if (!volume_mgr->hasBuildQueue() || !volumep || volumep->isUnique() ||
+		(mVolumeImpl && mVolumeImpl->isVolumeUnique()) ||
+		volumep->getParams() != volume_params)
+	{
+		return FALSE;
+	}
+
+	if (volumep->getDetail() == LLVolumeLODGroup::getVolumeScaleFromDetail(mLOD) ||
+		volume_mgr->isVolumeReady(volume_params, mLOD))
+	{
+		return FALSE;
+	}
+
+	if (isSculpted() && mSculptTexture.notNull())
+	{
+		U16 sculpt_width, sculpt_height;
+		S8 sculpt_components;
+		const U8* sculpt_data;
+		S32 discard_level;
+		getSculptData(sculpt_width, sculpt_height, sculpt_components, sculpt_data, discard_level);
+		volume_mgr->requestBuild(volume_params, mLOD, sculpt_width, sculpt_height, sculpt_components,
+								 sculpt_data, discard_level);
+	}
+	else
+	{
+		volume_mgr->requestBuild(volume_params, mLOD);
+	}
+	addPendingBuild();
+	return TRUE;
+}
+
+void LLVOVolume::addPendingBuild()
+{
+	if (!mVolumeBuildPending)
+	{
+		mVolumeBuildPending = TRUE;
+		sPendingBuilds.push_back(this);
+	}
+}
+
+// static
+void LLVOVolume::updateVolumeBuilds()
+{
+	LLVolumeMgr* volume_mgr = getVolumeManager();
+	if (!volume_mgr->hasBuildQueue())
+	{
+		return;
+	}
+	volume_mgr->updateBuilds();
+
+	for (S32 i = 0; i < (S32)sPendingBuilds.size(); )
+	{
+		LLVOVolume* objectp = sPendingBuilds[i];
+		LLVolume* volumep = objectp->getVolume();
+		if (!objectp->isDead() && volumep)
+		{
+			const LLVolumeParams& params = volumep->getParams();
+			S32 detail = LLVolumeLODGroup::getVolumeDetailFromScale(volumep->getDetail());
+			if (volume_mgr->isBuildPending(params, detail) ||
+				volume_mgr->isBuildPending(params, objectp->mLOD))
+			{
+				i++;
+				continue;
+			}
+
+			// let updateGeometry() pick up the new volume
+			if (objectp->mDrawable.notNull())
+			{
+				gPipeline.markRebuild(objectp->mDrawable, LLDrawable::REBUILD_VOLUME, FALSE);
+				objectp->mLODChanged = TRUE;
+				if (objectp->isSculpted())
+				{
+					objectp->mSculptChanged = TRUE;
+					objectp->rebuildSculptVolumes();
+				}
+			}
+		}
+		objectp->mVolumeBuildPending = FALSE;
+		sPendingBuilds[i] = sPendingBuilds.back();
+		sPendingBuilds.pop_back();
+	}
+}
+
+// Current sculpt map and the discard level it represents
+void LLVOVolume::getSculptData(U16& width, U16& height, S8& components, const U8*& data, S32& discard_level)
+{
+	discard_level = mSculptTexture->getDiscardLevel();
+	S32 max_discard = mSculptTexture->getMaxDiscardLevel();
+	if (discard_level > max_discard)
+		discard_level = max_discard;    // clamp to the best we can do
+
+	LLImageRaw* raw_image = mSculptTexture->getCachedRawImage();
+	if (!raw_image)
+	{
+		width = 0;
+		height = 0;
+		components = 0;
+		data = NULL;
+	}
+	else
+	{
+		height = raw_image->getHeight();
+		width = raw_image->getWidth();
+		components = raw_image->getComponents();
+		data = raw_image->getData();
+	}
+}
+
 // sculpt replaces generate() for sculpted surfaces
 void LLVOVolume::sculpt()
 {	
@@ -896,13 +1026,9 @@ void LLVOVolume::sculpt()
 		U16 sculpt_width = 0;
 		S8 sculpt_components = 0;
 		const U8* sculpt_data = NULL;
-	
-		S32 discard_level = mSculptTexture->getDiscardLevel() ;
-		LLImageRaw* raw_image = mSculptTexture->getCachedRawImage() ;
-		
-		S32 max_discard = mSculptTexture->getMaxDiscardLevel();
-		if (discard_level > max_discard)
-			discard_level = max_discard;    // clamp to the best we can do
+		S32 discard_level = 0;
+
+		getSculptData(sculpt_width, sculpt_height, sculpt_components, sculpt_data, discard_level);
 
 		S32 current_discard = getVolume()->getSculptLevel();
 		if(current_discard < -2)
@@ -924,31 +1050,37 @@ void LLVOVolume::sculpt()
 
 		if (current_discard == discard_level)  // no work to do here
 			return;
-		
-		if(!raw_image)
+
+		LLVolumeMgr* volume_mgr = getVolumeManager();
+		if (volume_mgr->hasBuildQueue() && !getVolume()->isUnique())
 		{
-			sculpt_width = 0;
-			sculpt_height = 0;
-			sculpt_data = NULL ;
-		}
-		else
-		{					
-			sculpt_height = raw_image->getHeight();
-			sculpt_width = raw_image->getWidth();
-			sculpt_components = raw_image->getComponents();		
-					   
-			sculpt_data = raw_image->getData();
+			// the shared volume is updated in place once the build is done
+			LLVolume* volumep = getVolume();
+			volume_mgr->requestBuild(volumep->getParams(),
+									 LLVolumeLODGroup::getVolumeDetailFromScale(volumep->getDetail()),
+									 sculpt_width, sculpt_height, sculpt_components, sculpt_data, discard_level);
+			addPendingBuild();
+			return;
 		}
+
 		getVolume()->sculpt(sculpt_width, sculpt_height, sculpt_components, sculpt_data, discard_level);
+		rebuildSculptVolumes();
+	}
+}
 
-		//notify rebuild any other VOVolumes that reference this sculpty volume
-		for (S32 i = 0; i < mSculptTexture->getNumVolumes(); ++i)
+// notify rebuild any other VOVolumes that reference this sculpty volume
+void LLVOVolume::rebuildSculptVolumes()
+{
+	if (mSculptTexture.isNull())
+	{
+		return;
+	}
+	for (S32 i = 0; i < mSculptTexture->getNumVolumes(); ++i)
+	{
+		LLVOVolume* volume = (*(mSculptTexture->getVolumeList()))[i];
+		if (volume && volume != this && volume->getVolume() == getVolume())
 		{
-			LLVOVolume* volume = (*(mSculptTexture->getVolumeList()))[i];
-			if (volume && volume != this && volume->getVolume() == getVolume())
-			{
-				gPipeline.markRebuild(volume->mDrawable, LLDrawable::REBUILD_GEOMETRY, FALSE);
-			}
+			gPipeline.markRebuild(volume->mDrawable, LLDrawable::REBUILD_GEOMETRY, FALSE);
 		}
 	}
 }
@@ -82,7 +82,10 @@ protected:
 
 public:
 	static		void	initClass();
+	static		void	cleanupClass();
 	static 		void 	preUpdateGeom();
+	// Swaps in volumes built in the background and rebuilds the objects waiting on them
+	static		void	updateVolumeBuilds();
 	
 	enum 
 	{
@@ -265,6 +268,10 @@ public:
 protected:
 	S32	computeLODDetail(F32	distance, F32 radius);
 	BOOL calcLOD();
+	BOOL deferVolumeBuild(const LLVolumeParams& volume_params);
+	void addPendingBuild();
+	void getSculptData(U16& width, U16& height, S8& components, const U8*& data, S32& discard_level);
+	void rebuildSculptVolumes();
 	LLFace* addFace(S32 face_index);
 	void updateTEData();
 
@@ -284,6 +291,7 @@ private:
 	S32			mLOD;
 	BOOL		mLODChanged;
 	BOOL		mSculptChanged;
+	BOOL		mVolumeBuildPending;	// waiting on LLVolumeMgr for a new LOD or sculpt
 	LLMatrix4	mRelativeXform;
 	LLMatrix3	mRelativeXformInvTrans;
 	BOOL		mVolumeChanged;
@@ -304,6 +312,7 @@ public:
 		
 protected:
 	static S32 sNumLODChanges;
+	static std::vector<LLPointer<LLVOVolume> > sPendingBuilds;
 	
 	friend class LLVolumeImplFlexible;
 };
@@ -788,6 +788,7 @@ void LLWorld::printPacketsLost()
 	llinfos << "Simulators:" << llendl;
 	llinfos << "----------" << llendl;
 
+	LLMessageSystem::LLCircuitLock lock(gMessageSystem);
 	LLCircuitData *cdp = NULL;
 	for (region_list_t::iterator iter = mActiveRegionList.begin();
 		 iter != mActiveRegionList.end(); ++iter)
@@ -2076,6 +2076,8 @@ void LLPipeline::forAllVisibleDrawables(void (*func)(LLDrawable*))
 //function for creating scripted beacons
 void renderScriptedBeacons(LLDrawable* drawablep)
 {
+	static LLCachedControl<S32> sDebugBeaconLineWidth(gSavedSettings, "DebugBeaconLineWidth");
+
 	LLViewerObject *vobj = drawablep->getVObj();
 	if (vobj 
 		&& !vobj->isAvatar() 
@@ -2084,7 +2086,7 @@ void renderScriptedBeacons(LLDrawable* drawablep)
 	{
 		if (gPipeline.sRenderBeacons)
 		{
-			gObjectList.addDebugBeacon(vobj->getPositionAgent(), "", LLColor4(1.f, 0.f, 0.f, 0.5f), LLColor4(1.f, 1.f, 1.f, 0.5f), gSavedSettings.getS32("DebugBeaconLineWidth"));
+			gObjectList.addDebugBeacon(vobj->getPositionAgent(), "", LLColor4(1.f, 0.f, 0.f, 0.5f), LLColor4(1.f, 1.f, 1.f, 0.5f), sDebugBeaconLineWidth);
 		}
 
 		if (gPipeline.sRenderHighlight)
@@ -2101,6 +2103,8 @@ void renderScriptedBeacons(LLDrawable* drawablep)
 
 void renderScriptedTouchBeacons(LLDrawable* drawablep)
 {
+	static LLCachedControl<S32> sDebugBeaconLineWidth(gSavedSettings, "DebugBeaconLineWidth");
+
 	LLViewerObject *vobj = drawablep->getVObj();
 	if (vobj 
 		&& !vobj->isAvatar() 
@@ -2110,7 +2114,7 @@ void renderScriptedTouchBeacons(LLDrawable* drawablep)
 	{
 		if (gPipeline.sRenderBeacons)
 		{
-			gObjectList.addDebugBeacon(vobj->getPositionAgent(), "", LLColor4(1.f, 0.f, 0.f, 0.5f), LLColor4(1.f, 1.f, 1.f, 0.5f), gSavedSettings.getS32("DebugBeaconLineWidth"));
+			gObjectList.addDebugBeacon(vobj->getPositionAgent(), "", LLColor4(1.f, 0.f, 0.f, 0.5f), LLColor4(1.f, 1.f, 1.f, 0.5f), sDebugBeaconLineWidth);
 		}
 
 		if (gPipeline.sRenderHighlight)
@@ -2127,6 +2131,8 @@ void renderScriptedTouchBeacons(LLDrawable* drawablep)
 
 void renderPhysicalBeacons(LLDrawable* drawablep)
 {
+	static LLCachedControl<S32> sDebugBeaconLineWidth(gSavedSettings, "DebugBeaconLineWidth");
+
 	LLViewerObject *vobj = drawablep->getVObj();
 	if (vobj 
 		&& !vobj->isAvatar() 
@@ -2135,7 +2141,7 @@ void renderPhysicalBeacons(LLDrawable* drawablep)
 	{
 		if (gPipeline.sRenderBeacons)
 		{
-			gObjectList.addDebugBeacon(vobj->getPositionAgent(), "", LLColor4(0.f, 1.f, 0.f, 0.5f), LLColor4(1.f, 1.f, 1.f, 0.5f), gSavedSettings.getS32("DebugBeaconLineWidth"));
+			gObjectList.addDebugBeacon(vobj->getPositionAgent(), "", LLColor4(0.f, 1.f, 0.f, 0.5f), LLColor4(1.f, 1.f, 1.f, 0.5f), sDebugBeaconLineWidth);
 		}
 
 		if (gPipeline.sRenderHighlight)
@@ -2152,6 +2158,8 @@ void renderPhysicalBeacons(LLDrawable* drawablep)
 
 void renderMOAPBeacons(LLDrawable* drawablep)
 {
+	static LLCachedControl<S32> sDebugBeaconLineWidth(gSavedSettings, "DebugBeaconLineWidth");
+
 	LLViewerObject *vobj = drawablep->getVObj();
 
 	if(!vobj || vobj->isAvatar())
@@ -2171,7 +2179,7 @@ void renderMOAPBeacons(LLDrawable* drawablep)
 	{
 		if (gPipeline.sRenderBeacons)
 		{
-			gObjectList.addDebugBeacon(vobj->getPositionAgent(), "", LLColor4(0.f, 1.f, 0.f, 0.5f), LLColor4(1.f, 1.f, 1.f, 0.5f), gSavedSettings.getS32("DebugBeaconLineWidth"));
+			gObjectList.addDebugBeacon(vobj->getPositionAgent(), "", LLColor4(0.f, 1.f, 0.f, 0.5f), LLColor4(1.f, 1.f, 1.f, 0.5f), sDebugBeaconLineWidth);
 		}
 
 		if (gPipeline.sRenderHighlight)
@@ -2189,6 +2197,8 @@ void renderMOAPBeacons(LLDrawable* drawablep)
 
 void renderParticleBeacons(LLDrawable* drawablep)
 {
+	static LLCachedControl<S32> sDebugBeaconLineWidth(gSavedSettings, "DebugBeaconLineWidth");
+
 	// Look for attachments, objects, etc.
 	LLViewerObject *vobj = drawablep->getVObj();
 	if (vobj 
@@ -2197,7 +2207,7 @@ void renderParticleBeacons(LLDrawable* drawablep)
 		if (gPipeline.sRenderBeacons)
 		{
 			LLColor4 light_blue(0.5f, 0.5f, 1.f, 0.5f);
-			gObjectList.addDebugBeacon(vobj->getPositionAgent(), "", light_blue, LLColor4(1.f, 1.f, 1.f, 0.5f), gSavedSettings.getS32("DebugBeaconLineWidth"));
+			gObjectList.addDebugBeacon(vobj->getPositionAgent(), "", light_blue, LLColor4(1.f, 1.f, 1.f, 0.5f), sDebugBeaconLineWidth);
 		}
 
 		if (gPipeline.sRenderHighlight)
@@ -2232,6 +2242,8 @@ void renderSoundHighlights(LLDrawable* drawablep)
 
 void LLPipeline::postSort(LLCamera& camera)
 {
+	static LLCachedControl<S32> sDebugBeaconLineWidth(gSavedSettings, "DebugBeaconLineWidth");
+
 	LLMemType mt(LLMemType::MTYPE_PIPELINE);
 	LLFastTimer ftm(LLFastTimer::FTM_STATESORT_POSTSORT);
 
@@ -2385,7 +2397,7 @@ void LLPipeline::postSort(LLCamera& camera)
 				if (gPipeline.sRenderBeacons)
 				{
 					//pos += LLVector3(0.f, 0.f, 0.2f);
-					gObjectList.addDebugBeacon(pos, "", LLColor4(1.f, 1.f, 0.f, 0.5f), LLColor4(1.f, 1.f, 1.f, 0.5f), gSavedSettings.getS32("DebugBeaconLineWidth"));
+					gObjectList.addDebugBeacon(pos, "", LLColor4(1.f, 1.f, 0.f, 0.5f), LLColor4(1.f, 1.f, 1.f, 0.5f), sDebugBeaconLineWidth);
 				}
 			}
 			// now deal with highlights for all those seeable sound sources
@@ -2635,6 +2647,12 @@ void LLPipeline::renderGeom(LLCamera& camera, BOOL forceVBOUpdate)
 		}
 	}
 
+	if (hasRenderType(LLPipeline::RENDER_TYPE_AVATAR))
+	{
+		// Skins every avatar that needs it at once, before the pools draw
+		LLVOAvatar::skinAvatars();
+	}
+
 	if (gPipeline.hasRenderDebugMask(LLPipeline::RENDER_DEBUG_PICKING))
 	{
 		LLAppViewer::instance()->pingMainloopTimeout("Pipeline:RenderForSelect");
@@ -5055,6 +5073,17 @@ void LLPipeline::bindScreenToTexture()
 
 void LLPipeline::renderBloom(BOOL for_snapshot, F32 zoom_factor, int subfield)
 {
+	static LLCachedControl<U32> sRenderResolutionDivisor(gSavedSettings, "RenderResolutionDivisor");
+	static LLCachedControl<F32> sRenderGlowMinLuminance(gSavedSettings, "RenderGlowMinLuminance");
+	static LLCachedControl<F32> sRenderGlowMaxExtractAlpha(gSavedSettings, "RenderGlowMaxExtractAlpha");
+	static LLCachedControl<F32> sRenderGlowWarmthAmount(gSavedSettings, "RenderGlowWarmthAmount");
+	static LLCachedControl<LLVector3> sRenderGlowLumWeights(gSavedSettings, "RenderGlowLumWeights");
+	static LLCachedControl<LLVector3> sRenderGlowWarmthWeights(gSavedSettings, "RenderGlowWarmthWeights");
+	static LLCachedControl<S32> sRenderGlowResolutionPow(gSavedSettings, "RenderGlowResolutionPow");
+	static LLCachedControl<S32> sRenderGlowIterations(gSavedSettings, "RenderGlowIterations");
+	static LLCachedControl<F32> sRenderGlowWidth(gSavedSettings, "RenderGlowWidth");
+	static LLCachedControl<F32> sRenderGlowStrength(gSavedSettings, "RenderGlowStrength");
+
 	if (!(gPipeline.canUseVertexShaders() &&
 		sRenderGlow))
 	{
@@ -5072,7 +5101,7 @@ void LLPipeline::renderBloom(BOOL for_snapshot, F32 zoom_factor, int subfield)
 		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 	}
 
-	U32 res_mod = gSavedSettings.getU32("RenderResolutionDivisor");
+	U32 res_mod = sRenderResolutionDivisor;
 
 	LLVector2 tc1(0,0);
 	LLVector2 tc2((F32) gViewerWindow->getWindowDisplayWidth()*2,
@@ -5166,11 +5195,11 @@ void LLPipeline::renderBloom(BOOL for_snapshot, F32 zoom_factor, int subfield)
 		}
 		
 		gGlowExtractProgram.bind();
-		F32 minLum = llmax(gSavedSettings.getF32("RenderGlowMinLuminance"), 0.0f);
-		F32 maxAlpha = gSavedSettings.getF32("RenderGlowMaxExtractAlpha");		
-		F32 warmthAmount = gSavedSettings.getF32("RenderGlowWarmthAmount");	
-		LLVector3 lumWeights = gSavedSettings.getVector3("RenderGlowLumWeights");
-		LLVector3 warmthWeights = gSavedSettings.getVector3("RenderGlowWarmthWeights");
+		F32 minLum = llmax((F32)sRenderGlowMinLuminance, 0.0f);
+		F32 maxAlpha = sRenderGlowMaxExtractAlpha;		
+		F32 warmthAmount = sRenderGlowWarmthAmount;	
+		LLVector3 lumWeights = sRenderGlowLumWeights;
+		LLVector3 warmthWeights = sRenderGlowWarmthWeights;
 		gGlowExtractProgram.uniform1f("minLuminance", minLum);
 		gGlowExtractProgram.uniform1f("maxExtractAlpha", maxAlpha);
 		gGlowExtractProgram.uniform3f("lumWeights", lumWeights.mV[0], lumWeights.mV[1], lumWeights.mV[2]);
@@ -5211,19 +5240,19 @@ void LLPipeline::renderBloom(BOOL for_snapshot, F32 zoom_factor, int subfield)
 
 
 	// power of two between 1 and 1024
-	U32 glowResPow = gSavedSettings.getS32("RenderGlowResolutionPow");
+	U32 glowResPow = sRenderGlowResolutionPow;
 	const U32 glow_res = llmax(1, 
 		llmin(1024, 1 << glowResPow));
 
-	S32 kernel = gSavedSettings.getS32("RenderGlowIterations")*2;
-	F32 delta = gSavedSettings.getF32("RenderGlowWidth") / glow_res;
+	S32 kernel = sRenderGlowIterations*2;
+	F32 delta = sRenderGlowWidth / glow_res;
 	// Use half the glow width if we have the res set to less than 9 so that it looks
 	// almost the same in either case.
 	if (glowResPow < 9)
 	{
 		delta *= 0.5f;
 	}
-	F32 strength = gSavedSettings.getF32("RenderGlowStrength");
+	F32 strength = sRenderGlowStrength;
 
 	gGlowProgram.bind();
 	gGlowProgram.uniform1f("glowStrength", strength);
@@ -5363,6 +5392,15 @@ void LLPipeline::renderBloom(BOOL for_snapshot, F32 zoom_factor, int subfield)
 
 void LLPipeline::bindDeferredShader(LLGLSLShader& shader, U32 light_index)
 {
+	static LLCachedControl<F32> sRenderDeferredSunWash(gSavedSettings, "RenderDeferredSunWash");
+	static LLCachedControl<F32> sRenderShadowNoise(gSavedSettings, "RenderShadowNoise");
+	static LLCachedControl<F32> sRenderShadowBlurSize(gSavedSettings, "RenderShadowBlurSize");
+	static LLCachedControl<F32> sRenderSSAOScale(gSavedSettings, "RenderSSAOScale");
+	static LLCachedControl<U32> sRenderSSAOMaxScale(gSavedSettings, "RenderSSAOMaxScale");
+	static LLCachedControl<F32> sRenderSSAOFactor(gSavedSettings, "RenderSSAOFactor");
+	static LLCachedControl<LLVector3> sRenderSSAOEffect(gSavedSettings, "RenderSSAOEffect");
+	static LLCachedControl<F32> sRenderDeferredAlphaSoften(gSavedSettings, "RenderDeferredAlphaSoften");
+
 	shader.bind();
 	S32 channel = 0;
 	channel = shader.enableTexture(LLViewerShaderMgr::DEFERRED_DIFFUSE, LLTexUnit::TT_RECT_TEXTURE);
@@ -5467,18 +5505,18 @@ void LLPipeline::bindDeferredShader(LLGLSLShader& shader, U32 light_index)
 	}
 
 	shader.uniform4fv("shadow_clip", 1, mSunClipPlanes.mV);
-	shader.uniform1f("sun_wash", gSavedSettings.getF32("RenderDeferredSunWash"));
-	shader.uniform1f("shadow_noise", gSavedSettings.getF32("RenderShadowNoise"));
-	shader.uniform1f("blur_size", gSavedSettings.getF32("RenderShadowBlurSize"));
+	shader.uniform1f("sun_wash", sRenderDeferredSunWash);
+	shader.uniform1f("shadow_noise", sRenderShadowNoise);
+	shader.uniform1f("blur_size", sRenderShadowBlurSize);
 
-	shader.uniform1f("ssao_radius", gSavedSettings.getF32("RenderSSAOScale"));
-	shader.uniform1f("ssao_max_radius", gSavedSettings.getU32("RenderSSAOMaxScale"));
+	shader.uniform1f("ssao_radius", sRenderSSAOScale);
+	shader.uniform1f("ssao_max_radius", sRenderSSAOMaxScale);
 
-	F32 ssao_factor = gSavedSettings.getF32("RenderSSAOFactor");
+	F32 ssao_factor = sRenderSSAOFactor;
 	shader.uniform1f("ssao_factor", ssao_factor);
 	shader.uniform1f("ssao_factor_inv", 1.0/ssao_factor);
 
-	LLVector3 ssao_effect = gSavedSettings.getVector3("RenderSSAOEffect");
+	LLVector3 ssao_effect = sRenderSSAOEffect;
 	F32 matrix_diag = (ssao_effect[0] + 2.0*ssao_effect[1])/3.0;
 	F32 matrix_nondiag = (ssao_effect[0] - ssao_effect[1])/3.0;
 	// This matrix scales (proj of color onto <1/rt(3),1/rt(3),1/rt(3)>) by
@@ -5490,11 +5528,15 @@ void LLPipeline::bindDeferredShader(LLGLSLShader& shader, U32 light_index)
 
 	shader.uniform2f("screen_res", mDeferredScreen.getWidth(), mDeferredScreen.getHeight());
 	shader.uniform1f("near_clip", LLViewerCamera::getInstance()->getNear()*2.f);
-	shader.uniform1f("alpha_soften", gSavedSettings.getF32("RenderDeferredAlphaSoften"));
+	shader.uniform1f("alpha_soften", sRenderDeferredAlphaSoften);
 }
 
 void LLPipeline::renderDeferredLighting()
 {
+	static LLCachedControl<LLVector3> sRenderShadowGaussian(gSavedSettings, "RenderShadowGaussian");
+	static LLCachedControl<U32> sRenderShadowBlurSamples(gSavedSettings, "RenderShadowBlurSamples");
+	static LLCachedControl<F32> sRenderShadowBlurSize(gSavedSettings, "RenderShadowBlurSize");
+
 	if (!sCull)
 	{
 		return;
@@ -5597,9 +5639,9 @@ void LLPipeline::renderDeferredLighting()
 
 	LLVector3 gauss[32]; // xweight, yweight, offset
 
-	LLVector3 go = gSavedSettings.getVector3("RenderShadowGaussian");
-	U32 kern_length = llclamp(gSavedSettings.getU32("RenderShadowBlurSamples"), (U32) 1, (U32) 16)*2 - 1;
-	F32 blur_size = gSavedSettings.getF32("RenderShadowBlurSize");
+	LLVector3 go = sRenderShadowGaussian;
+	U32 kern_length = llclamp((U32)sRenderShadowBlurSamples, (U32) 1, (U32) 16)*2 - 1;
+	F32 blur_size = sRenderShadowBlurSize;
 
 	// sample symmetrically with the middle sample falling exactly on 0.0
 	F32 x = -(kern_length/2.0f) + 0.5f;
@@ -5880,6 +5922,10 @@ inline float sgn(float a)
 
 void LLPipeline::generateWaterReflection(LLCamera& camera_in)
 {
+	static LLCachedControl<BOOL> sRenderWaterReflections(gSavedSettings, "RenderWaterReflections");
+	static LLCachedControl<S32> sRenderReflectionDetail(gSavedSettings, "RenderReflectionDetail");
+	static LLCachedControl<BOOL> sRenderWater(gSavedSettings, "RenderWater");
+
 	if (LLPipeline::sWaterReflections && assertInitialized() && LLDrawPoolWater::sNeedsReflectionUpdate)
 	{
 		LLVOAvatar* agent = gAgent.getAvatarObject();
@@ -5989,10 +6035,10 @@ void LLPipeline::generateWaterReflection(LLCamera& camera_in)
 				                     (1<<LLPipeline::RENDER_TYPE_SKY) |
 				                     (1<<LLPipeline::RENDER_TYPE_CLOUDS));
 
-				if (gSavedSettings.getBOOL("RenderWaterReflections"))
+				if (sRenderWaterReflections)
 				{ //mask out selected geometry based on reflection detail
 
-					S32 detail = gSavedSettings.getS32("RenderReflectionDetail");
+					S32 detail = sRenderReflectionDetail;
 					if (detail < 3)
 					{
 						mRenderTypeMask &= ~(1 << LLPipeline::RENDER_TYPE_PARTICLES);
@@ -6036,7 +6082,7 @@ void LLPipeline::generateWaterReflection(LLCamera& camera_in)
 
 			LLPipeline::sUnderWaterRender = LLViewerCamera::getInstance()->cameraUnderWater() ? FALSE : TRUE;
 			
-			if (!gSavedSettings.getBOOL("RenderWater") || !gHippoLimits->mRenderWater)
+			if (!sRenderWater || !gHippoLimits->mRenderWater)
 				LLPipeline::sUnderWaterRender = FALSE;
 
 			if (LLPipeline::sUnderWaterRender)
@@ -6170,6 +6216,11 @@ glh::matrix4f scale_translate_to_fit(const LLVector3 min, const LLVector3 max)
 
 void LLPipeline::generateSunShadow(LLCamera& camera)
 {
+	static LLCachedControl<BOOL> sRenderDeferredSunShadow(gSavedSettings, "RenderDeferredSunShadow");
+	static LLCachedControl<LLVector3> sRenderShadowClipPlanes(gSavedSettings, "RenderShadowClipPlanes");
+	static LLCachedControl<LLVector3> sRenderShadowNearDist(gSavedSettings, "RenderShadowNearDist");
+	static LLCachedControl<BOOL> sCameraOffset(gSavedSettings, "CameraOffset");
+
 
 	if (!sRenderDeferred)
 	{
@@ -6178,7 +6229,7 @@ void LLPipeline::generateSunShadow(LLCamera& camera)
 
 	//temporary hack to disable shadows but keep local lights
 	static BOOL clear = TRUE;
-	BOOL gen_shadow = gSavedSettings.getBOOL("RenderDeferredSunShadow");
+	BOOL gen_shadow = sRenderDeferredSunShadow;
 	if (!gen_shadow)
 	{
 		if (clear)
@@ -6211,7 +6262,7 @@ void LLPipeline::generateSunShadow(LLCamera& camera)
 	LLVector3 up;
 
 	//clip contains parallel split distances for 3 splits
-	LLVector3 clip = gSavedSettings.getVector3("RenderShadowClipPlanes");
+	LLVector3 clip = sRenderShadowClipPlanes;
 
 	//far clip on last split is minimum of camera view distance and 128
 	mSunClipPlanes = LLVector4(clip, clip.mV[2] * clip.mV[2]/clip.mV[1]);
@@ -6228,7 +6279,7 @@ void LLPipeline::generateSunShadow(LLCamera& camera)
 	F32 dist[] = { 0.1f, mSunClipPlanes.mV[0], mSunClipPlanes.mV[1], mSunClipPlanes.mV[2], mSunClipPlanes.mV[3] };
 
 	//currently used for amount to extrude frusta corners for constructing shadow frusta
-	LLVector3 n = gSavedSettings.getVector3("RenderShadowNearDist");
+	LLVector3 n = sRenderShadowNearDist;
 	F32 nearDist[] = { n.mV[0], n.mV[1], n.mV[2], n.mV[2] };
 
 	for (S32 j = 0; j < 4; j++)
@@ -6494,7 +6545,7 @@ void LLPipeline::generateSunShadow(LLCamera& camera)
 		mSunShadow[j].flush();
 	}
 
-	if (!gSavedSettings.getBOOL("CameraOffset"))
+	if (!sCameraOffset)
 	{
 		glh_set_current_modelview(saved_view);
 		glh_set_current_projection(saved_proj);
@@ -145,4 +145,52 @@ namespace tut
 		ensure("listener fired on changed setting", mListenerFired);	   
 	}
 
+	//cached controls
+	template<> template<>
+	void control_group_t::test<5>()
+	{
+		mCG->loadFromFile(mTestConfigFile.c_str());
+		LLCachedControl<U32> cached(*mCG, "TestSetting");
+		ensure_equals("initial cached value", (U32)cached, 12);
+		mCG->setU32("TestSetting", 14);
+		ensure_equals("cached value follows the control", (U32)cached, 14);
+		cached = 15;
+		ensure_equals("assigning sets the control", mCG->getU32("TestSetting"), 15);
+		ensure_equals("assigning updates the cache", cached.get(), 15);
+
+		{
+			LLCachedControl<F32> declared(*mCG, "TestDeclaredSetting", 2.5f);
+			ensure("missing control declared", mCG->controlExists("TestDeclaredSetting"));
+			ensure_equals("declared default", (F32)declared, 2.5f);
+		}
+		// the cache disconnected when it went away
+		mCG->setF32("TestDeclaredSetting", 3.f);
+		ensure_equals("declared control still usable", mCG->getF32("TestDeclaredSetting"), 3.f);
+	}
+
+	//lookup counts
+	template<> template<>
+	void control_group_t::test<6>()
+	{
+		mCG->loadFromFile(mTestConfigFile.c_str());
+		mCG->declareBOOL("TestBusySetting", TRUE, "Dummy setting used for testing");
+		LLControlGroup::lookup_count_list_t counts;
+		mCG->getLookupCounts(counts, 10, true);
+
+		LLCachedControl<U32> cached(*mCG, "TestSetting");
+		for (S32 i = 0; i < 5; ++i)
+		{
+			mCG->getBOOL("TestBusySetting");
+			ensure_equals("cached read", (U32)cached, 12);
+		}
+
+		mCG->getLookupCounts(counts, 10, true);
+		ensure_equals("controls looked up", counts.size(), 2);
+		ensure_equals("busiest first", counts[0].first, "TestBusySetting");
+		ensure_equals("lookups by name", counts[0].second, 5);
+		ensure_equals("cached control looked up once", counts[1].second, 1);
+
+		mCG->getLookupCounts(counts, 10, false);
+		ensure("counts reset", counts.empty());
+	}
 }
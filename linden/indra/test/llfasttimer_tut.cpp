@@ -0,0 +1,182 @@
+/**
+ * @file llfasttimer_tut.cpp
+ * @brief LLFastTimer thread stack, named timer and trace export tests.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#include <tut/tut.hpp>
+#include "linden_common.h"
+#include "lltut.h"
+
+#include <sstream>
+
+#include "llfasttimer.h"
+#include "llthread.h"
+#include "lltimer.h"
+
+namespace
+{
+	const S32 NUM_THREADS = 3;
+	const S32 CALLS_PER_THREAD = 1000;
+
+	LLFastTimer::NamedTimer sOuterTimer("Test outer");
+	LLFastTimer::NamedTimer sInnerTimer("Test inner");
+
+	class TimedThread : public LLThread
+	{
+	public:
+		TimedThread() : LLThread("Timed thread") {}
+
+		/*virtual*/ void run()
+		{
+			for (S32 i = 0; i < CALLS_PER_THREAD; ++i)
+			{
+				LLFastTimer outer(sOuterTimer);
+				LLFastTimer inner(sInnerTimer);
+			}
+		}
+	};
+
+	void run_threads()
+	{
+		std::vector<LLThread*> threads;
+		for (S32 i = 0; i < NUM_THREADS; ++i)
+		{
+			threads.push_back(new TimedThread);
+			threads.back()->start();
+		}
+		for (std::vector<LLThread*>::iterator iter = threads.begin(); iter != threads.end(); ++iter)
+		{
+			while (!(*iter)->isStopped())
+			{
+				ms_sleep(1);
+			}
+			delete *iter;
+		}
+	}
+
+	S32 count(const std::string& text, const std::string& what)
+	{
+		S32 found = 0;
+		for (size_t pos = text.find(what); pos != std::string::npos; pos = text.find(what, pos + 1))
+		{
+			found++;
+		}
+		return found;
+	}
+}
+
+namespace tut
+{
+	struct LLFastTimerTestData
+	{
+		LLFastTimerTestData()
+		{
+			LLFastTimer::setCapture(false);
+			LLFastTimer::reset();
+		}
+		~LLFastTimerTestData()
+		{
+			LLFastTimer::setCapture(false);
+		}
+	};
+
+	typedef test_group<LLFastTimerTestData> LLFastTimerTestGroup;
+	typedef LLFastTimerTestGroup::object LLFastTimerTestObject;
+	LLFastTimerTestGroup fastTimerTestGroup("LLFastTimer");
+
+	template<> template<>
+	void LLFastTimerTestObject::test<1>()
+		// named timers get their own ids after the enum
+	{
+		ensure("named id", sOuterTimer.getID() >= LLFastTimer::FTM_NUM_TYPES);
+		ensure("named id in range", sOuterTimer.getID() < LLFastTimer::FTM_MAX_TIMERS);
+		ensure("distinct ids", sOuterTimer.getID() != sInnerTimer.getID());
+
+		LLFastTimer::NamedTimer again("Test outer");
+		ensure_equals("same name, same id", again.getID(), sOuterTimer.getID());
+		ensure_equals("timer name", LLFastTimer::getTimerName(sOuterTimer.getID()), std::string("Test outer"));
+
+		{
+			LLFastTimer outer(sOuterTimer);
+			LLFastTimer inner(sInnerTimer);
+		}
+		ensure_equals("outer calls", LLFastTimer::sCalls[sOuterTimer.getID()], (U64)1);
+		ensure_equals("inner calls", LLFastTimer::sCalls[sInnerTimer.getID()], (U64)1);
+	}
+
+	template<> template<>
+	void LLFastTimerTestObject::test<2>()
+		// timers on other threads keep their own stacks and stay out of
+		// the frame thread's totals
+	{
+		{
+			LLFastTimer frame(LLFastTimer::FTM_TEMP1);
+			run_threads();
+		}
+		ensure_equals("frame timer calls", LLFastTimer::sCalls[LLFastTimer::FTM_TEMP1], (U64)1);
+		ensure_equals("worker calls not counted", LLFastTimer::sCalls[sOuterTimer.getID()], (U64)0);
+
+		// would llerrs if the workers had left anything on this thread's stack
+		LLFastTimer::reset();
+	}
+
+	template<> template<>
+	void LLFastTimerTestObject::test<3>()
+		// a capture exports every thread's timers as trace events
+	{
+		LLFastTimer::setTimerName(LLFastTimer::FTM_TEMP2, "Test frame");
+		LLFastTimer::setCapture(true);
+		LLFastTimer::reset();
+		{
+			LLFastTimer frame(LLFastTimer::FTM_TEMP2);
+			run_threads();
+		}
+		LLFastTimer::reset();
+		LLFastTimer::setCapture(false);
+
+		std::ostringstream out;
+		LLFastTimer::exportChromeTrace(out, 1);
+		std::string trace = out.str();
+
+		ensure("trace object", trace.find("{\"traceEvents\":[") == 0);
+		ensure_equals("frame thread events", count(trace, "\"name\":\"Test frame\""), 1);
+		ensure_equals("outer events", count(trace, "\"name\":\"Test outer\""), NUM_THREADS * CALLS_PER_THREAD);
+		ensure_equals("inner events", count(trace, "\"name\":\"Test inner\""), NUM_THREADS * CALLS_PER_THREAD);
+		ensure("thread names", count(trace, "\"args\":{\"name\":\"Timed thread\"}") >= 1);
+		ensure_equals("balanced braces", count(trace, "{"), count(trace, "}"));
+
+		// nothing from before the last frame
+		std::ostringstream none;
+		LLFastTimer::reset();
+		LLFastTimer::exportChromeTrace(none, 1);
+		ensure_equals("no events in an empty frame", count(none.str(), "\"ph\":\"X\""), 0);
+	}
+}
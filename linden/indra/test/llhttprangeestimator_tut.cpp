@@ -0,0 +1,299 @@
+/**
+ * @file llhttprangeestimator_tut.cpp
+ * @brief LLHTTPRangeEstimator tests, and texture HTTP fetches from a local server.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#include <tut/tut.hpp>
+#include "linden_common.h"
+#include "lltut.h"
+
+#include "llbuffer.h"
+#include "llcurl.h"
+#include "llhttprangeestimator.h"
+#include "lltextureserver.h"
+#include "lltimer.h"
+
+namespace
+{
+	const S32 MIN_RANGE = 600;			// FIRST_PACKET_SIZE in llimage.h
+	const S32 MAX_RANGE = 128 * 1024;
+
+	// Feeds the estimator requests that took latency + bytes / bandwidth.
+	void add_transfers(LLHTTPRangeEstimator& estimator, F64 latency, F64 bandwidth)
+	{
+		for (S32 i = 0; i < 32; ++i)
+		{
+			S32 bytes = 1000 + i * 2000;
+			estimator.addTransfer(bytes, latency + bytes / bandwidth);
+		}
+	}
+
+	// Textures fetched by range from a local server with a fixed round
+	// trip time, a few at a time, the way LLTextureFetch does.
+	const U16 TEXTURE_SERVER_PORT = 8891;
+	const S32 SERVER_LATENCY_MS = 20;
+	const S32 NUM_TEXTURES = 200;
+	const S32 HOST_CONNECTIONS = 8;
+
+	struct TextureFetch
+	{
+		enum EState { QUEUED, WAITING, ARRIVED, DONE };
+
+		EState mState;
+		S32 mNeed;				// Bytes the texture turns out to need
+		std::string mData;
+		S32 mRequested;
+		S32 mReceived;
+		U32 mStatus;
+		S32 mRequests;
+		LLTimer mTimer;
+
+		TextureFetch() : mState(QUEUED), mNeed(0), mRequested(0), mReceived(0), mStatus(0), mRequests(0) {}
+	};
+
+	class TextureResponder : public LLCurl::Responder
+	{
+	public:
+		TextureResponder(TextureFetch& fetch) : mFetch(fetch) {}
+
+		/*virtual*/ void completedRaw(U32 status, const std::string& reason,
+			const LLChannelDescriptors& channels, const LLIOPipe::buffer_ptr_t& buffer)
+		{
+			S32 size = buffer->countAfter(channels.in(), NULL);
+			if (size > 0)
+			{
+				std::vector<U8> data(size);
+				buffer->readAfter(channels.in(), NULL, &data[0], size);
+				mFetch.mData.append((const char*)&data[0], size);
+			}
+			mFetch.mStatus = status;
+			mFetch.mReceived = llmax(size, 0);
+			mFetch.mState = TextureFetch::ARRIVED;
+		}
+
+	private:
+		TextureFetch& mFetch;
+	};
+
+	struct FetchResults
+	{
+		S32 mRequests;
+		S32 mConnections;
+		S32 mFirstRange;
+		bool mComplete;
+	};
+
+	// Fetches every texture on the server up to its need.  pooled uses a
+	// host limit and sizes first ranges with an estimator; otherwise every
+	// texture starts with MIN_RANGE bytes on whatever connections curl has.
+	FetchResults fetch_textures(LLTextureServer& server, const std::vector<S32>& needs, bool pooled)
+	{
+		S32 start_connections = server.getConnections();
+		LLCurlRequest request;
+		if (pooled)
+		{
+			request.setHostLimit(HOST_CONNECTIONS);
+		}
+		LLHTTPRangeEstimator estimator(MIN_RANGE, MAX_RANGE);
+		std::vector<TextureFetch> fetches(server.getNumTextures());
+		for (S32 i = 0; i < (S32)fetches.size(); ++i)
+		{
+			fetches[i].mNeed = needs[i];
+		}
+
+		FetchResults results;
+		results.mComplete = true;
+		LLTimer timer;
+		S32 active = 0;
+		S32 done = 0;
+		while (done < (S32)fetches.size() && timer.getElapsedTimeF64() < 60.0)
+		{
+			for (S32 i = 0; i < (S32)fetches.size(); ++i)
+			{
+				TextureFetch& fetch = fetches[i];
+				if (fetch.mState == TextureFetch::ARRIVED)
+				{
+					active--;
+					S32 cur_size = (S32)fetch.mData.size();
+					bool good = fetch.mStatus >= 200 && fetch.mStatus < 300;
+					if (good && pooled)
+					{
+						estimator.addTransfer(fetch.mReceived, fetch.mTimer.getElapsedTimeF64());
+					}
+					if (!good || cur_size >= fetch.mNeed || fetch.mReceived < fetch.mRequested)
+					{
+						// done, or the server had nothing more
+						if (pooled)
+						{
+							estimator.addNeed(fetch.mNeed);
+						}
+						results.mComplete = results.mComplete && good;
+						fetch.mState = TextureFetch::DONE;
+						done++;
+					}
+					else
+					{
+						fetch.mState = TextureFetch::QUEUED;
+					}
+				}
+				if (fetch.mState == TextureFetch::QUEUED && active < HOST_CONNECTIONS)
+				{
+					S32 cur_size = (S32)fetch.mData.size();
+					S32 length = fetch.mNeed - cur_size;
+					if (cur_size == 0)
+					{
+						length = pooled ? estimator.getFirstRange() : MIN_RANGE;
+					}
+					fetch.mRequested = length;
+					fetch.mRequests++;
+					fetch.mTimer.reset();
+					fetch.mState = TextureFetch::WAITING;
+					request.getByteRange(server.getURL(i), LLCurlRequest::headers_t(), cur_size, length,
+										 new TextureResponder(fetch));
+					active++;
+				}
+			}
+			request.process();
+			ms_sleep(1);
+		}
+		results.mFirstRange = estimator.getFirstRange();
+
+		results.mRequests = 0;
+		for (S32 i = 0; i < (S32)fetches.size(); ++i)
+		{
+			const TextureFetch& fetch = fetches[i];
+			results.mComplete = results.mComplete && fetch.mState == TextureFetch::DONE &&
+				(S32)fetch.mData.size() >= fetch.mNeed &&
+				fetch.mData == server.getTexture(i).substr(0, fetch.mData.size());
+			results.mRequests += fetch.mRequests;
+		}
+		results.mConnections = server.getConnections() - start_connections;
+		return results;
+	}
+}
+
+namespace tut
+{
+	struct LLHTTPRangeEstimatorTestData
+	{
+	};
+
+	typedef test_group<LLHTTPRangeEstimatorTestData> LLHTTPRangeEstimatorTestGroup;
+	typedef LLHTTPRangeEstimatorTestGroup::object LLHTTPRangeEstimatorTestObject;
+	LLHTTPRangeEstimatorTestGroup httpRangeEstimatorTestGroup("LLHTTPRangeEstimator");
+
+	template<> template<>
+	void LLHTTPRangeEstimatorTestObject::test<1>()
+		// the minimum range until there is something to go on
+	{
+		LLHTTPRangeEstimator estimator(MIN_RANGE, MAX_RANGE);
+		ensure_equals("no data", estimator.getFirstRange(), MIN_RANGE);
+		ensure_equals("no latency", estimator.getLatency(), 0.0);
+		ensure_equals("no bandwidth", estimator.getBandwidth(), 0.0);
+
+		estimator.addTransfer(1000, 0.1);
+		estimator.addNeed(50000);
+		ensure_equals("one sample", estimator.getFirstRange(), MIN_RANGE);
+
+		add_transfers(estimator, 0.1, 100000.0);
+		ensure_equals("no needs", estimator.getFirstRange(), MIN_RANGE);
+	}
+
+	template<> template<>
+	void LLHTTPRangeEstimatorTestObject::test<2>()
+		// latency and bandwidth come from the transfer times
+	{
+		LLHTTPRangeEstimator estimator(MIN_RANGE, MAX_RANGE);
+		add_transfers(estimator, 0.1, 100000.0);
+		ensure_approximately_equals("latency", (F32)estimator.getLatency(), 0.1f, 12);
+		ensure_approximately_equals("bandwidth", (F32)(estimator.getBandwidth() / 1000.0), 100.f, 8);
+	}
+
+	template<> template<>
+	void LLHTTPRangeEstimatorTestObject::test<3>()
+		// the first range trades round trips against extra bytes
+	{
+		// a quarter of the items need a lot more than the rest
+		LLHTTPRangeEstimator slow_link(MIN_RANGE, MAX_RANGE);
+		LLHTTPRangeEstimator slow_server(MIN_RANGE, MAX_RANGE);
+		for (S32 i = 0; i < 32; ++i)
+		{
+			S32 need = (i % 4) ? 1000 : 50000;
+			slow_link.addNeed(need);
+			slow_server.addNeed(need);
+		}
+
+		// bytes are expensive: ask for what most items need
+		add_transfers(slow_link, 0.001, 10000.0);
+		ensure_equals("slow link", slow_link.getFirstRange(), 1000);
+
+		// round trips are expensive: ask for enough for all of them
+		add_transfers(slow_server, 1.0, 10000000.0);
+		ensure_equals("slow server", slow_server.getFirstRange(), 50000);
+
+		// never more than the maximum
+		LLHTTPRangeEstimator capped(MIN_RANGE, 20000);
+		for (S32 i = 0; i < 32; ++i)
+		{
+			capped.addNeed(50000);
+		}
+		add_transfers(capped, 1.0, 10000000.0);
+		ensure_equals("capped", capped.getFirstRange(), 20000);
+	}
+
+	template<> template<>
+	void LLHTTPRangeEstimatorTestObject::test<4>()
+		// textures from a server with a round trip time, with per-host
+		// connection pools and adaptive first ranges, and without
+	{
+		LLTextureServer server(TEXTURE_SERVER_PORT, SERVER_LATENCY_MS, 2 * HOST_CONNECTIONS);
+		std::vector<S32> needs;
+		U32 seed = 12345;
+		for (S32 i = 0; i < NUM_TEXTURES; ++i)
+		{
+			seed = seed * 1664525 + 1013904223;
+			S32 size = 4000 + (S32)((seed >> 8) % 60000);
+			server.addMadeUpTexture(512, 512, size);
+			// most textures are only needed to a middle discard level
+			needs.push_back((i % 4) ? size / 4 : size);
+		}
+		ensure("server started", server.start());
+
+		FetchResults fixed = fetch_textures(server, needs, false);
+		ensure("fixed ranges fetched", fixed.mComplete);
+
+		FetchResults pooled = fetch_textures(server, needs, true);
+		ensure("pooled fetched", pooled.mComplete);
+		ensure("pooled connections limited", pooled.mConnections <= HOST_CONNECTIONS);
+		ensure("adaptive first range", pooled.mFirstRange > MIN_RANGE);
+		ensure("fewer requests", pooled.mRequests < fixed.mRequests);
+	}
+}
@@ -0,0 +1,291 @@
+/**
+ * @file llinventorycache_tut.cpp
+ * @brief Binary inventory cache tests.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#include <tut/tut.hpp>
+#include "linden_common.h"
+#include "lltut.h"
+
+#include "llfile.h"
+#include "llinventorycache.h"
+
+namespace
+{
+	std::string temp_filename(const std::string& name)
+	{
+		LLUUID random;
+		random.generate();
+#if LL_WINDOWS
+		return "C:\\" + name + "-" + random.asString();
+#else
+		return "/tmp/" + name + "-" + random.asString();
+#endif
+	}
+
+	LLPointer<LLInventoryCategory> make_category(const LLUUID& parent, S32 index)
+	{
+		LLUUID id;
+		id.generate();
+		return new LLInventoryCategory(id, parent, LLAssetType::AT_NONE, llformat("Folder %d", index));
+	}
+
+	// Names repeat the way real inventories do; some are not ASCII.
+	LLPointer<LLInventoryItem> make_item(const LLUUID& parent, S32 index)
+	{
+		LLUUID id, asset_id, creator_id, owner_id, group_id;
+		id.generate();
+		asset_id.generate();
+		creator_id.generate();
+		owner_id.generate();
+		if (index % 7 == 0)
+		{
+			group_id.generate();
+		}
+
+		LLPermissions perm;
+		perm.init(creator_id, owner_id, creator_id, group_id);
+		perm.initMasks(PERM_ALL, PERM_ALL, index % 3 ? PERM_NONE : PERM_COPY,
+					   PERM_NONE, PERM_MOVE | PERM_TRANSFER | (index % 2 ? PERM_COPY : PERM_MODIFY));
+
+		static const LLAssetType::EType types[] = {
+			LLAssetType::AT_OBJECT, LLAssetType::AT_TEXTURE, LLAssetType::AT_NOTECARD,
+			LLAssetType::AT_LSL_TEXT, LLAssetType::AT_CLOTHING, LLAssetType::AT_LANDMARK };
+		LLAssetType::EType type = types[index % LL_ARRAY_SIZE(types)];
+
+		std::string name = index % 5 ? llformat("Object %d", index % 1000) : std::string("Caf\xc3\xa9 chair");
+		std::string desc = index % 4 ? std::string() : llformat("Description %d", index % 100);
+		LLSaleInfo sale(index % 11 ? LLSaleInfo::FS_NOT : LLSaleInfo::FS_COPY, index % 11 ? 0 : index % 500);
+
+		return new LLInventoryItem(id, parent, perm, asset_id, type,
+								   LLInventoryType::defaultForAssetType(type), name, desc,
+								   sale, index % 13 ? 0 : 0x100, 1200000000 + index);
+	}
+
+	void ensure_same_item(const std::string& msg, const LLInventoryItem* expected, const LLInventoryItem* actual)
+	{
+		tut::ensure_equals(msg + " id", actual->getUUID(), expected->getUUID());
+		tut::ensure_equals(msg + " parent", actual->getParentUUID(), expected->getParentUUID());
+		tut::ensure_equals(msg + " name", actual->getName(), expected->getName());
+		tut::ensure_equals(msg + " desc", actual->getDescription(), expected->getDescription());
+		tut::ensure_equals(msg + " type", actual->getType(), expected->getType());
+		tut::ensure_equals(msg + " inv type", actual->getInventoryType(), expected->getInventoryType());
+		tut::ensure_equals(msg + " flags", actual->getFlags(), expected->getFlags());
+		tut::ensure_equals(msg + " date", actual->getCreationDate(), expected->getCreationDate());
+		tut::ensure(msg + " permissions", actual->getPermissions() == expected->getPermissions());
+		tut::ensure(msg + " sale info", actual->getSaleInfo() == expected->getSaleInfo());
+		tut::ensure_equals(msg + " crc", actual->getCRC32(), expected->getCRC32());
+	}
+
+	struct TestInventory
+	{
+		LLUUID mOwner;
+		std::vector<LLPointer<LLInventoryCategory> > mCategories;
+		std::vector<LLPointer<LLInventoryItem> > mItems;
+
+		TestInventory(S32 num_categories, S32 num_items)
+		{
+			mOwner.generate();
+			for (S32 i = 0; i < num_categories; ++i)
+			{
+				mCategories.push_back(make_category(i ? mCategories[0]->getUUID() : LLUUID::null, i));
+			}
+			for (S32 i = 0; i < num_items; ++i)
+			{
+				// spread items over the folders, out of order
+				mItems.push_back(make_item(mCategories[(i * 7) % num_categories]->getUUID(), i));
+			}
+		}
+
+		void write(LLInventoryCacheWriter& writer) const
+		{
+			for (size_t i = 0; i < mCategories.size(); ++i)
+			{
+				writer.addCategory(*mCategories[i], mOwner, (S32)i + 1);
+			}
+			for (size_t i = 0; i < mItems.size(); ++i)
+			{
+				writer.addItem(*mItems[i]);
+			}
+		}
+	};
+}
+
+namespace tut
+{
+	struct LLInventoryCacheTestData
+	{
+		std::vector<std::string> mFiles;
+
+		std::string getFilename(const std::string& name)
+		{
+			mFiles.push_back(temp_filename(name));
+			return mFiles.back();
+		}
+
+		~LLInventoryCacheTestData()
+		{
+			for (size_t i = 0; i < mFiles.size(); ++i)
+			{
+				LLFile::remove(mFiles[i]);
+			}
+		}
+	};
+
+	typedef test_group<LLInventoryCacheTestData> LLInventoryCacheTestGroup;
+	typedef LLInventoryCacheTestGroup::object LLInventoryCacheTestObject;
+	LLInventoryCacheTestGroup inventoryCacheTestGroup("LLInventoryCache");
+
+	template<> template<>
+	void LLInventoryCacheTestObject::test<1>()
+		// items come back grouped by category, field for field
+	{
+		TestInventory inventory(5, 200);
+		// an item whose folder is not in the cache
+		LLUUID lost_folder;
+		lost_folder.generate();
+		inventory.mItems.push_back(make_item(lost_folder, 200));
+
+		LLInventoryCacheWriter writer;
+		inventory.write(writer);
+		std::string filename = getFilename("invcache");
+		ensure("saved", writer.save(filename, false));
+
+		LLInventoryCacheReader reader;
+		ensure("opened", reader.open(filename));
+		ensure_equals("categories", reader.getNumCategories(), 5);
+		ensure_equals("items", reader.getNumItems(), 201);
+		ensure_equals("indexed items", reader.getNumIndexedItems(), 200);
+
+		std::map<LLUUID, const LLInventoryItem*> expected;
+		for (size_t i = 0; i < inventory.mItems.size(); ++i)
+		{
+			expected[inventory.mItems[i]->getUUID()] = inventory.mItems[i];
+		}
+
+		for (S32 i = 0; i < reader.getNumCategories(); ++i)
+		{
+			const LLInventoryCategory* cat = inventory.mCategories[i];
+			LLPointer<LLInventoryCategory> loaded = new LLInventoryCategory;
+			LLUUID owner_id;
+			reader.getCategory(i, *loaded, owner_id);
+			ensure_equals("category id", reader.getCategoryID(i), cat->getUUID());
+			ensure_equals("category parent", loaded->getParentUUID(), cat->getParentUUID());
+			ensure_equals("category name", loaded->getName(), cat->getName());
+			ensure_equals("category owner", owner_id, inventory.mOwner);
+			ensure_equals("category version", reader.getCategoryVersion(i), i + 1);
+			ensure_equals("category item count", reader.getCategoryItemCount(i), 40);
+
+			S32 first = reader.getFirstItem(i);
+			for (S32 j = first; j < first + reader.getCategoryItemCount(i); ++j)
+			{
+				LLPointer<LLInventoryItem> item = new LLInventoryItem;
+				reader.getItem(j, *item);
+				ensure_equals("item in its category", item->getParentUUID(), cat->getUUID());
+				ensure("known item", expected.count(item->getUUID()) == 1);
+				ensure_same_item("item", expected[item->getUUID()], item);
+			}
+		}
+
+		LLPointer<LLInventoryItem> lost = new LLInventoryItem;
+		reader.getItem(200, *lost);
+		ensure_equals("unindexed item last", lost->getParentUUID(), lost_folder);
+	}
+
+	template<> template<>
+	void LLInventoryCacheTestObject::test<2>()
+		// gzipped files load the same; damaged files are refused
+	{
+		TestInventory inventory(3, 90);
+		LLInventoryCacheWriter writer;
+		inventory.write(writer);
+
+		std::string gz_filename = getFilename("invcache-gz");
+		ensure("saved gzipped", writer.save(gz_filename, true));
+		LLInventoryCacheReader reader;
+		ensure("opened gzipped", reader.open(gz_filename));
+		ensure("gzipped is not mapped", !reader.isMapped());
+		ensure_equals("gzipped items", reader.getNumItems(), 90);
+		LLPointer<LLInventoryItem> item = new LLInventoryItem;
+		reader.getItem(reader.getFirstItem(1), *item);
+		ensure_same_item("gzipped item", inventory.mItems[1], item);
+		reader.close();
+
+		std::string filename = getFilename("invcache-raw");
+		ensure("saved", writer.save(filename, false));
+		std::vector<U8> data;
+		{
+			LLFILE* fp = LLFile::fopen(filename, "rb");
+			ensure("reopened", fp != NULL);
+			fseek(fp, 0, SEEK_END);
+			data.resize(ftell(fp));
+			fseek(fp, 0, SEEK_SET);
+			ensure("read back", fread(&data[0], 1, data.size(), fp) == data.size());
+			fclose(fp);
+		}
+
+		std::string damaged = getFilename("invcache-damaged");
+		// truncated
+		{
+			LLFILE* fp = LLFile::fopen(damaged, "wb");
+			fwrite(&data[0], 1, data.size() - 1, fp);
+			fclose(fp);
+		}
+		ensure("truncated file refused", !reader.open(damaged));
+		ensure("closed after refusal", !reader.isOpen());
+
+		// from another version
+		{
+			std::vector<U8> other(data);
+			((LLInventoryCache::Header*)&other[0])->mVersion = LLInventoryCache::VERSION + 1;
+			LLFILE* fp = LLFile::fopen(damaged, "wb");
+			fwrite(&other[0], 1, other.size(), fp);
+			fclose(fp);
+		}
+		ensure("other version refused", !reader.open(damaged));
+
+		// string offset out of range
+		{
+			std::vector<U8> other(data);
+			LLInventoryCache::Header* header = (LLInventoryCache::Header*)&other[0];
+			LLInventoryCache::ItemRecord* items = (LLInventoryCache::ItemRecord*)
+				(&other[0] + sizeof(LLInventoryCache::Header) + header->mNumCategories * sizeof(LLInventoryCache::CategoryRecord));
+			items[5].mName = header->mStringsSize;
+			LLFILE* fp = LLFile::fopen(damaged, "wb");
+			fwrite(&other[0], 1, other.size(), fp);
+			fclose(fp);
+		}
+		ensure("bad string refused", !reader.open(damaged));
+
+		ensure("missing file", !reader.open(getFilename("invcache-missing")));
+		ensure("good file still opens", reader.open(filename));
+	}
+}
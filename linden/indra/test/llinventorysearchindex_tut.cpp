@@ -0,0 +1,228 @@
+/**
+ * @file llinventorysearchindex_tut.cpp
+ * @brief LLInventorySearchIndex tests.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#include <tut/tut.hpp>
+#include "linden_common.h"
+#include "lltut.h"
+
+#include "llinventorysearchindex.h"
+#include "llstring.h"
+
+namespace
+{
+	const S32 NUM_TYPED_NAMES = 5000;
+
+	LLUUID make_id()
+	{
+		LLUUID id;
+		id.generate();
+		return id;
+	}
+
+	// What LLInventoryFilter::check() did for every item before the index
+	void scan(const std::map<LLUUID, std::string>& names, const std::string& substring,
+			  LLInventorySearchIndex::uuid_vec_t& matches)
+	{
+		matches.clear();
+		for (std::map<LLUUID, std::string>::const_iterator iter = names.begin(); iter != names.end(); ++iter)
+		{
+			if (iter->second.find(substring) != std::string::npos)
+			{
+				matches.push_back(iter->first);
+			}
+		}
+	}
+
+	std::string random_name(S32 length)
+	{
+		// a small alphabet so that trigrams collide a lot
+		static const char letters[] = "abcAB c";
+		std::string name;
+		for (S32 i = 0; i < length; ++i)
+		{
+			name += letters[rand() % (sizeof(letters) - 1)];
+		}
+		return name;
+	}
+}
+
+namespace tut
+{
+	struct LLInventorySearchIndexTestData
+	{
+	};
+
+	typedef test_group<LLInventorySearchIndexTestData> LLInventorySearchIndexTestGroup;
+	typedef LLInventorySearchIndexTestGroup::object LLInventorySearchIndexTestObject;
+	LLInventorySearchIndexTestGroup inventorySearchIndexTestGroup("LLInventorySearchIndex");
+
+	template<> template<>
+	void LLInventorySearchIndexTestObject::test<1>()
+		// adding, renaming and removing
+	{
+		LLInventorySearchIndex index;
+		LLUUID chair = make_id();
+		LLUUID table = make_id();
+		LLUUID lamp = make_id();
+		index.update(chair, "Wooden chair");
+		index.update(table, "Wooden table");
+		index.update(lamp, "Lamp");
+		ensure_equals("size", index.size(), 3);
+		ensure_equals("text upper cased", *index.getText(chair), std::string("WOODEN CHAIR"));
+		ensure("unknown id", index.getText(make_id()) == NULL);
+
+		LLInventorySearchIndex::uuid_vec_t matches;
+		ensure("searched", index.find("WOOD", matches));
+		ensure_equals("both wooden", matches.size(), (size_t)2);
+		ensure("chair found", std::binary_search(matches.begin(), matches.end(), chair));
+		ensure("table found", std::binary_search(matches.begin(), matches.end(), table));
+
+		ensure("whole name", index.find("LAMP", matches));
+		ensure_equals("lamp only", matches.size(), (size_t)1);
+		ensure_equals("lamp", matches[0], lamp);
+
+		// trigrams present but not in that order
+		ensure("searched out of order", index.find("AIRCH", matches));
+		ensure("no match", matches.empty());
+		ensure("searched unknown", index.find("SOFA", matches));
+		ensure("no sofa", matches.empty());
+
+		ensure("short substring not searched", !index.find("WO", matches));
+
+		U32 revision = index.getRevision();
+		index.update(chair, "Wooden chair");
+		ensure_equals("same name changes nothing", index.getRevision(), revision);
+		index.update(chair, "Metal chair");
+		ensure("rename changes revision", index.getRevision() != revision);
+		index.find("WOOD", matches);
+		ensure_equals("renamed away", matches.size(), (size_t)1);
+		index.find("METAL", matches);
+		ensure_equals("renamed to", matches.size(), (size_t)1);
+
+		index.remove(table);
+		index.find("WOOD", matches);
+		ensure("removed", matches.empty());
+		ensure_equals("size after remove", index.size(), 2);
+
+		// the freed slot is reused
+		LLUUID stool = make_id();
+		index.update(stool, "Wooden stool");
+		index.find("WOODEN", matches);
+		ensure_equals("reused slot", matches.size(), (size_t)1);
+		ensure_equals("stool", matches[0], stool);
+
+		index.clear();
+		ensure_equals("cleared", index.size(), 0);
+		index.find("STOOL", matches);
+		ensure("nothing after clear", matches.empty());
+	}
+
+	template<> template<>
+	void LLInventorySearchIndexTestObject::test<2>()
+		// finds exactly what scanning every name finds, through random
+		// additions, renames and removals
+	{
+		srand(1234);
+		LLInventorySearchIndex index;
+		std::map<LLUUID, std::string> names;
+		std::vector<LLUUID> ids;
+		for (S32 step = 0; step < 5000; ++step)
+		{
+			S32 action = rand() % 10;
+			if (action < 6 || ids.empty())
+			{
+				ids.push_back(make_id());
+				std::string name = random_name(rand() % 12);
+				index.update(ids.back(), name);
+				LLStringUtil::toUpper(name);
+				names[ids.back()] = name;
+			}
+			else if (action < 8)
+			{
+				const LLUUID& id = ids[rand() % ids.size()];
+				std::string name = random_name(rand() % 12);
+				index.update(id, name);
+				LLStringUtil::toUpper(name);
+				names[id] = name;
+			}
+			else
+			{
+				S32 i = rand() % ids.size();
+				index.remove(ids[i]);
+				names.erase(ids[i]);
+				ids.erase(ids.begin() + i);
+			}
+
+			if (step % 50 == 0)
+			{
+				std::string substring = random_name(3 + rand() % 3);
+				LLStringUtil::toUpper(substring);
+				LLInventorySearchIndex::uuid_vec_t found, expected;
+				ensure("searched", index.find(substring, found));
+				scan(names, substring, expected);
+				ensure("same matches as a scan for " + substring, found == expected);
+			}
+		}
+		ensure_equals("size", index.size(), (S32)names.size());
+	}
+
+	template<> template<>
+	void LLInventorySearchIndexTestObject::test<3>()
+		// an inventory searched one keystroke at a time
+	{
+		LLInventorySearchIndex index;
+		std::map<LLUUID, std::string> names;
+		for (S32 i = 0; i < NUM_TYPED_NAMES; ++i)
+		{
+			LLUUID id = make_id();
+			std::string name = llformat("Object %d %s", i % 500, i % 3 ? "prim" : "sculpted chair");
+			index.update(id, name);
+			LLStringUtil::toUpper(name);
+			names[id] = name;
+		}
+
+		const std::string typed("SCULPTED CHAIR");
+		LLInventorySearchIndex::uuid_vec_t found, expected;
+		for (size_t length = 3; length <= typed.size(); ++length)
+		{
+			std::string substring = typed.substr(0, length);
+			index.find(substring, found);
+			scan(names, substring, expected);
+			ensure("same matches for " + substring, found == expected);
+		}
+
+		index.find("OBJECT 499 PRIM", found);
+		scan(names, "OBJECT 499 PRIM", expected);
+		ensure("rare name", !found.empty() && found == expected);
+	}
+}
@@ -0,0 +1,113 @@
+/**
+ * @file lljobpool_tut.cpp
+ * @brief LLJobPool tests.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#include <tut/tut.hpp>
+#include "linden_common.h"
+#include "lltut.h"
+
+#include "lljobpool.h"
+
+namespace
+{
+	class CountJob : public LLJobPool::Job
+	{
+	public:
+		CountJob(S32 count) : mRuns(count)
+		{
+			for (S32 i = 0; i < count; ++i)
+			{
+				mRuns[i] = 0;
+			}
+		}
+
+		/*virtual*/ void run(S32 index)
+		{
+			// a little work so that the workers get a share
+			F32 sum = 0.f;
+			for (S32 i = 0; i < 1000; ++i)
+			{
+				sum += (F32)(i * index);
+			}
+			mSum = sum;
+			mRuns[index]++;
+		}
+
+		std::vector<LLAtomicS32> mRuns;
+		volatile F32 mSum;
+	};
+}
+
+namespace tut
+{
+	struct LLJobPoolTestData
+	{
+	};
+
+	typedef test_group<LLJobPoolTestData> LLJobPoolTestGroup;
+	typedef LLJobPoolTestGroup::object LLJobPoolTestObject;
+	LLJobPoolTestGroup jobPoolTestGroup("LLJobPool");
+
+	template<> template<>
+	void LLJobPoolTestObject::test<1>()
+		// every index runs exactly once, job after job
+	{
+		LLJobPool pool("test", 3);
+		ensure_equals("threads", pool.getNumThreads(), 3);
+
+		static const S32 counts[] = { 0, 1, 2, 7, 100, 5000 };
+		for (S32 round = 0; round < 200; ++round)
+		{
+			S32 count = counts[round % LL_ARRAY_SIZE(counts)];
+			CountJob job(count);
+			pool.run(job, count);
+			for (S32 i = 0; i < count; ++i)
+			{
+				ensure_equals("ran once", (S32)job.mRuns[i], 1);
+			}
+		}
+	}
+
+	template<> template<>
+	void LLJobPoolTestObject::test<2>()
+		// without workers, the caller does everything
+	{
+		LLJobPool pool("test", 0);
+		ensure_equals("no threads", pool.getNumThreads(), 0);
+		CountJob job(50);
+		pool.run(job, 50);
+		for (S32 i = 0; i < 50; ++i)
+		{
+			ensure_equals("ran once", (S32)job.mRuns[i], 1);
+		}
+	}
+}
@@ -0,0 +1,245 @@
+/**
+ * @file llmorphbatch_tut.cpp
+ * @brief LLMorphBatch tests.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#include <tut/tut.hpp>
+#include "linden_common.h"
+#include "lltut.h"
+
+#include "llmorphbatch.h"
+#include "llrand.h"
+
+namespace
+{
+	const F32 SOFTEN = 0.65f;
+
+	LLVector3 rand_vec3()
+	{
+		return LLVector3(ll_frand(2.f) - 1.f, ll_frand(2.f) - 1.f, ll_frand(2.f) - 1.f);
+	}
+
+	// A morph as LLPolyMorphData loads it, plus its LLMorphDeltas
+	struct TestMorph
+	{
+		std::vector<U32> mIndices;
+		std::vector<LLVector3> mCoords;
+		std::vector<LLVector3> mNormals;
+		std::vector<LLVector3> mBinormals;
+		std::vector<LLVector2> mTexCoords;
+		std::vector<F32> mMask;
+		LLMorphDeltas mDeltas;
+
+		TestMorph(U32 num_mesh_vertices, U32 count)
+		{
+			// a contiguous region of the mesh, as real morphs touch
+			U32 first = rand() % (num_mesh_vertices - count);
+			for (U32 i = 0; i < count; ++i)
+			{
+				mIndices.push_back(first + i);
+				mCoords.push_back(rand_vec3() * 0.01f);
+				mNormals.push_back(rand_vec3() * 0.1f);
+				mBinormals.push_back(rand_vec3() * 0.1f);
+				mTexCoords.push_back(LLVector2(ll_frand(0.01f), ll_frand(0.01f)));
+				mMask.push_back(ll_frand(1.f));
+			}
+			mDeltas.set(count, &mIndices[0], &mCoords[0], &mNormals[0], &mBinormals[0], &mTexCoords[0]);
+		}
+	};
+
+	struct TestMesh
+	{
+		std::vector<LLVector3> mCoords;
+		std::vector<LLVector3> mScaledNormals;
+		std::vector<LLVector3> mNormals;
+		std::vector<LLVector3> mScaledBinormals;
+		std::vector<LLVector3> mBinormals;
+		std::vector<LLVector2> mTexCoords;
+		std::vector<LLVector4> mClothingWeights;
+
+		TestMesh(U32 num_vertices)
+		{
+			for (U32 i = 0; i < num_vertices; ++i)
+			{
+				mCoords.push_back(rand_vec3());
+				LLVector3 normal = rand_vec3();
+				normal.normVec();
+				mScaledNormals.push_back(normal);
+				mNormals.push_back(normal);
+				LLVector3 binormal = normal % rand_vec3();
+				binormal.normVec();
+				mScaledBinormals.push_back(binormal);
+				mBinormals.push_back(binormal);
+				mTexCoords.push_back(LLVector2(ll_frand(1.f), ll_frand(1.f)));
+				mClothingWeights.push_back(LLVector4());
+			}
+		}
+
+		LLMorphBatch::Mesh getMesh()
+		{
+			LLMorphBatch::Mesh mesh;
+			mesh.mNumVertices = mCoords.size();
+			mesh.mCoords = &mCoords[0];
+			mesh.mScaledNormals = &mScaledNormals[0];
+			mesh.mNormals = &mNormals[0];
+			mesh.mScaledBinormals = &mScaledBinormals[0];
+			mesh.mBinormals = &mBinormals[0];
+			mesh.mTexCoords = &mTexCoords[0];
+			mesh.mClothingWeights = &mClothingWeights[0];
+			return mesh;
+		}
+
+		// What LLPolyMorphTarget::apply() did for each morph before batching
+		void applyReference(const TestMorph& morph, F32 delta_weight, bool masked, bool clothing)
+		{
+			for (U32 i = 0; i < morph.mIndices.size(); ++i)
+			{
+				U32 v = morph.mIndices[i];
+				F32 mask = masked ? morph.mMask[i] : 1.f;
+				mCoords[v] += morph.mCoords[i] * delta_weight * mask;
+				if (clothing)
+				{
+					LLVector3 offset = morph.mCoords[i] * delta_weight * mask;
+					mClothingWeights[v].mV[VX] += offset.mV[VX];
+					mClothingWeights[v].mV[VY] += offset.mV[VY];
+					mClothingWeights[v].mV[VZ] += offset.mV[VZ];
+					mClothingWeights[v].mV[VW] = mask;
+				}
+				mScaledNormals[v] += morph.mNormals[i] * delta_weight * mask * SOFTEN;
+				LLVector3 normal = mScaledNormals[v];
+				normal.normVec();
+				mNormals[v] = normal;
+				mScaledBinormals[v] += morph.mBinormals[i] * delta_weight * mask * SOFTEN;
+				LLVector3 tangent = mScaledBinormals[v] % normal;
+				LLVector3 binormal = normal % tangent;
+				binormal.normVec();
+				mBinormals[v] = binormal;
+				mTexCoords[v] += morph.mTexCoords[i] * delta_weight * mask;
+			}
+		}
+	};
+
+	const F32 TOLERANCE = 1.0e-5f;
+
+	void ensure_same_mesh(const TestMesh& a, const TestMesh& b)
+	{
+		for (U32 v = 0; v < a.mCoords.size(); ++v)
+		{
+			tut::ensure("coords", dist_vec(a.mCoords[v], b.mCoords[v]) < TOLERANCE);
+			tut::ensure("scaled normals", dist_vec(a.mScaledNormals[v], b.mScaledNormals[v]) < TOLERANCE);
+			tut::ensure("normals", dist_vec(a.mNormals[v], b.mNormals[v]) < TOLERANCE);
+			tut::ensure("scaled binormals", dist_vec(a.mScaledBinormals[v], b.mScaledBinormals[v]) < TOLERANCE);
+			tut::ensure("binormals", dist_vec(a.mBinormals[v], b.mBinormals[v]) < TOLERANCE);
+			tut::ensure("tex coords", dist_vec(a.mTexCoords[v], b.mTexCoords[v]) < TOLERANCE);
+			tut::ensure("clothing weights", dist_vec(a.mClothingWeights[v], b.mClothingWeights[v]) < TOLERANCE);
+		}
+	}
+}
+
+namespace tut
+{
+	struct LLMorphBatchTestData
+	{
+	};
+
+	typedef test_group<LLMorphBatchTestData> LLMorphBatchTestGroup;
+	typedef LLMorphBatchTestGroup::object LLMorphBatchTestObject;
+	LLMorphBatchTestGroup morphBatchTestGroup("LLMorphBatch");
+
+	template<> template<>
+	void LLMorphBatchTestObject::test<1>()
+		// overlapping morphs applied in one batch give the mesh the
+		// one-at-a-time update gave it
+	{
+		srand(3);
+		const U32 NUM_VERTICES = 1000;
+		std::vector<TestMorph*> morphs;
+		for (S32 i = 0; i < 12; ++i)
+		{
+			morphs.push_back(new TestMorph(NUM_VERTICES, 50 + rand() % 300));
+		}
+
+		TestMesh reference(NUM_VERTICES);
+		TestMesh batched(reference);
+
+		LLMorphBatch batch;
+		for (S32 i = 0; i < (S32)morphs.size(); ++i)
+		{
+			F32 weight = ll_frand(2.f) - 1.f;
+			bool masked = (i % 3 == 0);
+			bool clothing = (i % 4 == 1);
+			reference.applyReference(*morphs[i], weight, masked, clothing);
+			batch.add(&morphs[i]->mDeltas, weight, masked ? &morphs[i]->mMask[0] : NULL, clothing);
+		}
+		ensure_equals("pending morphs", batch.getNumMorphs(), (S32)morphs.size());
+		batch.apply(batched.getMesh(), SOFTEN);
+		ensure("applied", batch.empty());
+
+		ensure_same_mesh(reference, batched);
+
+		for (S32 i = 0; i < (S32)morphs.size(); ++i)
+		{
+			delete morphs[i];
+		}
+	}
+
+	template<> template<>
+	void LLMorphBatchTestObject::test<2>()
+		// a morph added twice is applied once with the summed weight, and
+		// cancelling weights leave the mesh alone
+	{
+		srand(5);
+		const U32 NUM_VERTICES = 200;
+		TestMorph morph(NUM_VERTICES, 40);
+
+		TestMesh reference(NUM_VERTICES);
+		TestMesh batched(reference);
+
+		LLMorphBatch batch;
+		batch.add(&morph.mDeltas, 0.25f, NULL, false);
+		batch.add(&morph.mDeltas, 0.5f, NULL, false);
+		ensure_equals("merged", batch.getNumMorphs(), 1);
+		batch.add(&morph.mDeltas, 0.5f, &morph.mMask[0], false);
+		ensure_equals("different mask kept apart", batch.getNumMorphs(), 2);
+		batch.apply(batched.getMesh(), SOFTEN);
+
+		reference.applyReference(morph, 0.75f, false, false);
+		reference.applyReference(morph, 0.5f, true, false);
+		ensure_same_mesh(reference, batched);
+
+		TestMesh untouched(NUM_VERTICES);
+		TestMesh cancelled(untouched);
+		batch.add(&morph.mDeltas, 0.5f, NULL, true);
+		batch.add(&morph.mDeltas, -0.5f, NULL, true);
+		batch.apply(cancelled.getMesh(), SOFTEN);
+		ensure_same_mesh(untouched, cancelled);
+	}
+}
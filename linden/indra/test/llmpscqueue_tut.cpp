@@ -0,0 +1,148 @@
+/**
+ * @file llmpscqueue_tut.cpp
+ * @brief LLMPSCQueue tests.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include <tut/tut.hpp>
+#include "linden_common.h"
+#include "lltut.h"
+
+#include "llmpscqueue.h"
+#include "llthread.h"
+#include "lltimer.h"
+
+namespace
+{
+	const S32 NUM_PRODUCERS = 4;
+	const S32 ITEMS_PER_PRODUCER = 25000;
+
+	class ProducerThread : public LLThread
+	{
+	public:
+		ProducerThread(LLMPSCQueue<U32>& queue, U32 producer)
+			: LLThread("MPSC producer"), mQueue(queue), mProducer(producer)
+		{
+		}
+
+		/*virtual*/ void run()
+		{
+			for (U32 i = 0; i < (U32)ITEMS_PER_PRODUCER; ++i)
+			{
+				mQueue.push((mProducer << 24) | i);
+			}
+		}
+
+	private:
+		LLMPSCQueue<U32>& mQueue;
+		U32 mProducer;
+	};
+
+	void wait_for_threads(std::vector<LLThread*>& threads)
+	{
+		for (std::vector<LLThread*>::iterator iter = threads.begin(); iter != threads.end(); ++iter)
+		{
+			while (!(*iter)->isStopped())
+			{
+				ms_sleep(1);
+			}
+			delete *iter;
+		}
+		threads.clear();
+	}
+}
+
+namespace tut
+{
+	struct LLMPSCQueueTestData
+	{
+	};
+
+	typedef test_group<LLMPSCQueueTestData> LLMPSCQueueTestGroup;
+	typedef LLMPSCQueueTestGroup::object LLMPSCQueueTestObject;
+	LLMPSCQueueTestGroup mpscQueueTestGroup("LLMPSCQueue");
+
+	template<> template<>
+	void LLMPSCQueueTestObject::test<1>()
+		// items come out in the order they were pushed
+	{
+		LLMPSCQueue<S32> queue;
+		ensure("starts empty", queue.empty());
+		for (S32 i = 0; i < 100; ++i)
+		{
+			queue.push(i);
+		}
+		ensure("not empty", !queue.empty());
+
+		std::vector<S32> out;
+		ensure_equals("popped count", queue.popAll(out), 100);
+		for (S32 i = 0; i < 100; ++i)
+		{
+			ensure_equals("popped in order", out[i], i);
+		}
+		ensure("empty again", queue.empty());
+		ensure_equals("nothing left", queue.popAll(out), 0);
+
+		// items left behind are freed by the destructor
+		queue.push(1);
+	}
+
+	template<> template<>
+	void LLMPSCQueueTestObject::test<2>()
+		// concurrent producers lose nothing and keep their own order
+	{
+		LLMPSCQueue<U32> queue;
+		std::vector<LLThread*> threads;
+		for (S32 i = 0; i < NUM_PRODUCERS; ++i)
+		{
+			threads.push_back(new ProducerThread(queue, i));
+			threads.back()->start();
+		}
+
+		std::vector<U32> next(NUM_PRODUCERS, 0);
+		std::vector<U32> items;
+		S32 total = 0;
+		while (total < NUM_PRODUCERS * ITEMS_PER_PRODUCER)
+		{
+			items.clear();
+			total += queue.popAll(items);
+			for (std::vector<U32>::iterator iter = items.begin(); iter != items.end(); ++iter)
+			{
+				U32 producer = *iter >> 24;
+				ensure("valid producer", producer < (U32)NUM_PRODUCERS);
+				ensure_equals("producer order", *iter & 0xffffff, next[producer]);
+				next[producer]++;
+			}
+		}
+		wait_for_threads(threads);
+
+		ensure_equals("total items", total, NUM_PRODUCERS * ITEMS_PER_PRODUCER);
+		ensure("drained", queue.empty());
+	}
+}
@@ -0,0 +1,212 @@
+/**
+ * @file llpacketring_tut.cpp
+ * @brief LLPacketRing batched I/O tests.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include <tut/tut.hpp>
+#include "linden_common.h"
+#include "lltut.h"
+
+#include "lltimer.h"
+#include "llversionserver.h"
+#include "message.h"
+#include "message_prehash.h"
+#include "net.h"
+
+namespace
+{
+	// Only the message used by the replay stream, so the test does not
+	// depend on the location of the full message_template.msg.
+	const char* TEST_TEMPLATE =
+		"version 2.0\n"
+		"{\n"
+		"	TestMessage Low 1 NotTrusted Zerocoded\n"
+		"	{\n"
+		"		TestBlock1		Single\n"
+		"		{	Test1		U32	}\n"
+		"	}\n"
+		"	{\n"
+		"		NeighborBlock		Multiple		4\n"
+		"		{	Test0		U32	}\n"
+		"		{	Test1		U32	}\n"
+		"		{	Test2		U32	}\n"
+		"	}\n"
+		"}\n";
+
+	const S32 TEST_MESSAGE_NUMBER = 1;
+	const S32 TEST_MESSAGE_BODY_SIZE = 4 + 4 * 3 * 4;
+	const S32 REPLAY_CHUNK = 64;
+
+	S32 sReceivedCount = 0;
+	U32 sLastTestValue = 0;
+
+	void process_test_message(LLMessageSystem* msg, void**)
+	{
+		U32 value = 0;
+		msg->getU32Fast(_PREHASH_TestBlock1, _PREHASH_Test1, value);
+		sLastTestValue = value;
+		++sReceivedCount;
+	}
+}
+
+namespace tut
+{
+	struct LLPacketRingTestData
+	{
+		typedef std::vector<std::string> packet_list_t;
+
+		std::string mTemplateFile;
+		S32 mSendSocket;
+		LLHost mListenHost;
+		U32 mPacketID;
+
+		LLPacketRingTestData() : mSendSocket(0), mPacketID(1)
+		{
+			LLUUID random;
+			random.generate();
+#if LL_WINDOWS
+			mTemplateFile = "C:\\packetring-test-" + random.asString() + ".msg";
+#else
+			mTemplateFile = "/tmp/packetring-test-" + random.asString() + ".msg";
+#endif
+			llofstream file(mTemplateFile);
+			file << TEST_TEMPLATE;
+			file.close();
+
+			start_messaging_system(mTemplateFile, NET_USE_OS_ASSIGNED_PORT,
+								   LL_VERSION_MAJOR,
+								   LL_VERSION_MINOR,
+								   LL_VERSION_PATCH,
+								   FALSE,
+								   "notasharedsecret",
+								   NULL,
+								   false,
+								   5.f,
+								   100.f);
+			gMessageSystem->setHandlerFuncFast(_PREHASH_TestMessage, process_test_message);
+			mListenHost = LLHost(ip_string_to_u32("127.0.0.1"), gMessageSystem->getListenPort());
+
+			S32 send_port = NET_USE_OS_ASSIGNED_PORT;
+			start_net(mSendSocket, send_port);
+			gMessageSystem->enableCircuit(LLHost(ip_string_to_u32("127.0.0.1"), send_port), TRUE);
+			sReceivedCount = 0;
+		}
+
+		~LLPacketRingTestData()
+		{
+			end_net(mSendSocket);
+			// not end_messaging_system()
+			delete gMessageSystem;
+			gMessageSystem = NULL;
+			LLFile::remove(mTemplateFile);
+		}
+
+		// Builds a TestMessage datagram the way the wire carries it.
+		std::string makeTestPacket(U32 value)
+		{
+			std::string packet(LL_PACKET_ID_SIZE + 4 + TEST_MESSAGE_BODY_SIZE, '\0');
+			U8* buffer = (U8*)&packet[0];
+			U32 packet_id = htonl(mPacketID++);
+			memcpy(buffer + PHL_PACKET_ID, &packet_id, sizeof(packet_id));
+			U8* header = buffer + LL_PACKET_ID_SIZE;
+			header[0] = 255;
+			header[1] = 255;
+			U16 number = htons((U16)TEST_MESSAGE_NUMBER);
+			memcpy(header + 2, &number, sizeof(number));
+			htonmemcpy(header + 4, &value, MVT_U32, 4);
+			return packet;
+		}
+
+		// Replays the stream into the listen socket a chunk at a time and
+		// drains it through checkMessages().
+		void replay(const packet_list_t& packets)
+		{
+			S32 expected = sReceivedCount;
+			for (S32 i = 0; i < (S32)packets.size(); i += REPLAY_CHUNK)
+			{
+				S32 end = llmin(i + REPLAY_CHUNK, (S32)packets.size());
+				for (S32 j = i; j < end; ++j)
+				{
+					send_packet(mSendSocket, packets[j].data(), (int)packets[j].size(),
+								mListenHost.getAddress(), mListenHost.getPort());
+				}
+				expected += end - i;
+
+				// loopback delivery is immediate, but give a slow box a
+				// moment before declaring packets lost
+				LLTimer drain_timer;
+				while (sReceivedCount < expected && drain_timer.getElapsedTimeF32() < 2.f)
+				{
+					while (gMessageSystem->checkMessages())
+					{
+					}
+				}
+			}
+		}
+	};
+
+	typedef test_group<LLPacketRingTestData> LLPacketRingTestGroup;
+	typedef LLPacketRingTestGroup::object LLPacketRingTestObject;
+	LLPacketRingTestGroup packetRingTestGroup("LLPacketRing");
+
+	template<> template<>
+	void LLPacketRingTestObject::test<1>()
+		// every packet arrives intact through both receive paths
+	{
+		ensure("message system started", gMessageSystem && gMessageSystem->isOK());
+
+		packet_list_t packets;
+		for (U32 i = 0; i < 200; ++i)
+		{
+			packets.push_back(makeTestPacket(i + 1));
+		}
+
+		gMessageSystem->mPacketRing.setUseBatchIO(FALSE);
+		replay(packets);
+		ensure_equals("unbatched packets received", sReceivedCount, 200);
+		ensure_equals("unbatched last value", sLastTestValue, (U32)200);
+
+		if (!net_batch_supported())
+		{
+			return;
+		}
+
+		packets.clear();
+		for (U32 i = 0; i < 200; ++i)
+		{
+			packets.push_back(makeTestPacket(1000 + i));
+		}
+		gMessageSystem->mPacketRing.setUseBatchIO(TRUE);
+		replay(packets);
+		ensure_equals("batched packets received", sReceivedCount, 400);
+		ensure_equals("batched last value", sLastTestValue, (U32)1199);
+		gMessageSystem->mPacketRing.setUseBatchIO(FALSE);
+	}
+}
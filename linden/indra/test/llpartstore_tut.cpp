@@ -0,0 +1,296 @@
+/**
+ * @file llpartstore_tut.cpp
+ * @brief LLPartStore layout and update kernel tests.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include <tut/tut.hpp>
+#include "linden_common.h"
+#include "lltut.h"
+
+#include "llpartstore.h"
+#include "llrand.h"
+
+namespace
+{
+	// A particle the way LLViewerPartGroup used to keep them: one heap
+	// object each, updated one at a time.
+	struct TestPart : public LLPartData
+	{
+		F32 mAge;
+		F32 mSkipOffset;
+		LLVector3 mPosAgent;
+		LLVector3 mVelocity;
+		LLVector3 mAccel;
+		LLColor4 mColor;
+		LLVector2 mScale;
+
+		TestPart() : mAge(0.f), mSkipOffset(0.f) {}
+	};
+
+	const LLVector3 SOURCE_POS(128.f, 128.f, 20.f);
+
+	// The per-particle update from LLViewerPartGroup, less the parts that
+	// need a viewer (callbacks, wind, targets).
+	void update_part(TestPart& part, F32 dt)
+	{
+		const F32 cur_time = part.mAge + dt;
+		const F32 frac = cur_time / part.mMaxAge;
+
+		if (part.mFlags & LLPartData::LL_PART_FOLLOW_SRC_MASK)
+		{
+			part.mPosAgent = SOURCE_POS;
+			part.mPosAgent += part.mPosOffset;
+		}
+
+		part.mPosAgent += dt*part.mVelocity;
+		part.mPosAgent += 0.5f*dt*dt*part.mAccel;
+		part.mVelocity += part.mAccel*dt;
+
+		if (part.mFlags & LLPartData::LL_PART_BOUNCE_MASK)
+		{
+			F32 dz = part.mPosAgent.mV[VZ] - SOURCE_POS.mV[VZ];
+			if (dz < 0)
+			{
+				part.mPosAgent.mV[VZ] += -2.f*dz;
+				part.mVelocity.mV[VZ] *= -0.75f;
+			}
+		}
+
+		if (part.mFlags & LLPartData::LL_PART_FOLLOW_SRC_MASK)
+		{
+			part.mPosOffset = part.mPosAgent;
+			part.mPosOffset -= SOURCE_POS;
+		}
+
+		if (part.mFlags & LLPartData::LL_PART_INTERP_COLOR_MASK)
+		{
+			part.mColor.setVec(part.mStartColor);
+			part.mColor *= 1.f - frac;
+			part.mColor %= 1.f - frac;
+			part.mColor += frac%(frac*part.mEndColor);
+		}
+
+		if (part.mFlags & LLPartData::LL_PART_INTERP_SCALE_MASK)
+		{
+			part.mScale.setVec(part.mStartScale);
+			part.mScale *= 1.f - frac;
+			part.mScale += frac*part.mEndScale;
+		}
+
+		part.mAge = cur_time;
+	}
+
+	// Mixed flags: most particles only interpolate, some bounce or follow
+	// their source.
+	TestPart make_part(S32 i)
+	{
+		static const U32 FLAGS[] =
+		{
+			0,
+			LLPartData::LL_PART_INTERP_COLOR_MASK,
+			LLPartData::LL_PART_INTERP_SCALE_MASK,
+			LLPartData::LL_PART_INTERP_COLOR_MASK | LLPartData::LL_PART_INTERP_SCALE_MASK,
+			LLPartData::LL_PART_INTERP_COLOR_MASK | LLPartData::LL_PART_EMISSIVE_MASK,
+			LLPartData::LL_PART_INTERP_COLOR_MASK | LLPartData::LL_PART_FOLLOW_VELOCITY_MASK,
+			LLPartData::LL_PART_INTERP_COLOR_MASK | LLPartData::LL_PART_BOUNCE_MASK,
+			LLPartData::LL_PART_INTERP_SCALE_MASK | LLPartData::LL_PART_FOLLOW_SRC_MASK
+		};
+
+		TestPart part;
+		part.mFlags = FLAGS[i % LL_ARRAY_SIZE(FLAGS)];
+		part.mMaxAge = 1000.f + ll_frand(10.f);
+		part.mStartColor.setVec(ll_frand(), ll_frand(), ll_frand(), 1.f);
+		part.mEndColor.setVec(ll_frand(), ll_frand(), ll_frand(), 0.f);
+		part.mStartScale.setVec(0.1f + ll_frand(), 0.1f + ll_frand());
+		part.mEndScale.setVec(0.1f + ll_frand(), 0.1f + ll_frand());
+		part.mPosAgent = SOURCE_POS + LLVector3(ll_frand(2.f) - 1.f, ll_frand(2.f) - 1.f, ll_frand(2.f));
+		part.mPosOffset = part.mPosAgent - SOURCE_POS;
+		part.mVelocity.setVec(ll_frand(2.f) - 1.f, ll_frand(2.f) - 1.f, ll_frand(4.f));
+		part.mAccel.setVec(0.f, 0.f, -0.5f - ll_frand());
+		part.mColor = part.mStartColor;
+		part.mScale = part.mStartScale;
+		part.mSkipOffset = ll_frand(0.05f);
+		return part;
+	}
+
+	void set_part(LLPartStore& store, S32 index, const TestPart& part)
+	{
+		store.setPartData(index, part);
+		store.mAge[index] = part.mAge;
+		store.mSkipOffset[index] = part.mSkipOffset;
+		store.mPosAgent[index] = part.mPosAgent;
+		store.mVelocity[index] = part.mVelocity;
+		store.mAccel[index] = part.mAccel;
+		store.mColor[index] = part.mColor;
+		store.mScale[index] = part.mScale;
+	}
+
+	void get_part(const LLPartStore& store, S32 index, TestPart& part)
+	{
+		store.getPartData(index, part);
+		part.mAge = store.mAge[index];
+		part.mSkipOffset = store.mSkipOffset[index];
+		part.mPosAgent = store.mPosAgent[index];
+		part.mVelocity = store.mVelocity[index];
+		part.mAccel = store.mAccel[index];
+		part.mColor = store.mColor[index];
+		part.mScale = store.mScale[index];
+	}
+
+	S32 add_part(LLPartStore& store, const TestPart& part, S32 slot)
+	{
+		S32 index = store.add(part, (part.mFlags & LLPartStore::COMPLEX_MASK) != 0);
+		set_part(store, index, part);
+		store.mSlot[index] = slot;
+		return index;
+	}
+
+	// One frame the way LLViewerPartGroup::updateParticles() does it
+	void update_store(LLPartStore& store, F32 dt, F32 skipped_time)
+	{
+		store.updateSimple(dt, skipped_time);
+		TestPart part;
+		for (S32 i = store.getNumSimple(); i < store.size(); ++i)
+		{
+			get_part(store, i, part);
+			F32 part_dt = dt + skipped_time - part.mSkipOffset;
+			part.mSkipOffset = 0.f;
+			update_part(part, part_dt);
+			set_part(store, i, part);
+		}
+	}
+
+	void update_list(std::vector<TestPart*>& parts, F32 dt, F32 skipped_time)
+	{
+		for (std::vector<TestPart*>::iterator iter = parts.begin(); iter != parts.end(); ++iter)
+		{
+			TestPart* part = *iter;
+			F32 part_dt = dt + skipped_time - part->mSkipOffset;
+			part->mSkipOffset = 0.f;
+			update_part(*part, part_dt);
+		}
+	}
+}
+
+namespace tut
+{
+	struct LLPartStoreTestData
+	{
+	};
+
+	typedef test_group<LLPartStoreTestData> LLPartStoreTestGroup;
+	typedef LLPartStoreTestGroup::object LLPartStoreTestObject;
+	LLPartStoreTestGroup partStoreTestGroup("LLPartStore");
+
+	template<> template<>
+	void LLPartStoreTestObject::test<1>()
+		// simple particles stay in front across adds and removes
+	{
+		LLPartStore store;
+		const S32 COUNT = 200;
+		for (S32 i = 0; i < COUNT; ++i)
+		{
+			add_part(store, make_part(i), i);
+		}
+		ensure_equals("size", store.size(), COUNT);
+		ensure_equals("simple count", store.getNumSimple(), COUNT - 2 * COUNT / 8);
+
+		for (S32 i = 0; i < 50; ++i)
+		{
+			store.remove((i * 37) % store.size());
+		}
+		ensure_equals("size after remove", store.size(), COUNT - 50);
+
+		std::vector<bool> seen(COUNT, false);
+		for (S32 i = 0; i < store.size(); ++i)
+		{
+			bool complex = (store.mFlags[i] & LLPartStore::COMPLEX_MASK) != 0;
+			ensure_equals("partitioned", complex, i >= store.getNumSimple());
+			S32 slot = store.mSlot[i];
+			ensure("slot kept", slot >= 0 && slot < COUNT && !seen[slot]);
+			seen[slot] = true;
+
+			// each particle's data moved with it
+			ensure_equals("flags follow slot", store.mFlags[i], make_part(slot).mFlags);
+		}
+
+		store.clear();
+		ensure("cleared", store.empty());
+		ensure_equals("no simple left", store.getNumSimple(), 0);
+	}
+
+	template<> template<>
+	void LLPartStoreTestObject::test<2>()
+		// the kernel gives exactly what the per-particle update gives
+	{
+		LLPartStore store;
+		std::vector<TestPart> reference;
+		for (S32 i = 0; i < 500; ++i)
+		{
+			TestPart part = make_part(i);
+			reference.push_back(part);
+			add_part(store, part, i);
+		}
+
+		for (S32 frame = 0; frame < 10; ++frame)
+		{
+			const F32 dt = 0.02f + 0.001f * frame;
+			const F32 skipped = (frame % 3) ? 0.f : 0.04f;
+			update_store(store, dt, skipped);
+			for (S32 i = 0; i < (S32)reference.size(); ++i)
+			{
+				TestPart& part = reference[i];
+				F32 part_dt = dt + skipped - part.mSkipOffset;
+				part.mSkipOffset = 0.f;
+				update_part(part, part_dt);
+			}
+		}
+
+		for (S32 i = 0; i < store.size(); ++i)
+		{
+			const TestPart& part = reference[store.mSlot[i]];
+			ensure_equals("age", store.mAge[i], part.mAge);
+			ensure_equals("skip offset", store.mSkipOffset[i], 0.f);
+			for (S32 j = 0; j < 3; ++j)
+			{
+				ensure_equals("position", store.mPosAgent[i].mV[j], part.mPosAgent.mV[j]);
+				ensure_equals("velocity", store.mVelocity[i].mV[j], part.mVelocity.mV[j]);
+			}
+			for (S32 j = 0; j < 4; ++j)
+			{
+				ensure_equals("color", store.mColor[i].mV[j], part.mColor.mV[j]);
+			}
+			for (S32 j = 0; j < 2; ++j)
+			{
+				ensure_equals("scale", store.mScale[i].mV[j], part.mScale.mV[j]);
+			}
+		}
+	}
+}
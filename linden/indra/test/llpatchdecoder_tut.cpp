@@ -0,0 +1,258 @@
+/**
+ * @file llpatchdecoder_tut.cpp
+ * @brief LLPatchDecoder tests against the scalar terrain decoder.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#include <tut/tut.hpp>
+#include "linden_common.h"
+#include "lltut.h"
+
+#include "bitpack.h"
+#include "indra_constants.h"
+#include "llpatchdecoder.h"
+#include "llrand.h"
+#include "lltimer.h"
+#include "patch_code.h"
+#include "patch_dct.h"
+
+namespace
+{
+	const S32 PATCHES_PER_EDGE = 16;
+	const S32 GRIDS_PER_EDGE = PATCHES_PER_EDGE*NORMAL_PATCH_SIZE;
+	const S32 LAYER_BUFFER_SIZE = 512*1024;
+
+	// Rolling terrain with some noise, one region's worth
+	void make_terrain(std::vector<F32>& heights)
+	{
+		heights.resize(GRIDS_PER_EDGE*GRIDS_PER_EDGE);
+		for (S32 y = 0; y < GRIDS_PER_EDGE; ++y)
+		{
+			for (S32 x = 0; x < GRIDS_PER_EDGE; ++x)
+			{
+				heights[y*GRIDS_PER_EDGE + x] = 20.f + 15.f*sinf(x*0.05f)*cosf(y*0.04f) + ll_frand(0.5f);
+			}
+		}
+	}
+
+	// Codes every patch of the heights into a land layer, as the simulator does
+	S32 encode_land(std::vector<F32>& heights, U8* buffer)
+	{
+		LLBitPack bitpack(buffer, LAYER_BUFFER_SIZE);
+		init_patch_compressor(NORMAL_PATCH_SIZE, GRIDS_PER_EDGE, LAND_LAYER_CODE);
+		LLGroupHeader gopp;
+		get_patch_group_header(&gopp);
+		code_patch_group_header(bitpack, &gopp);
+
+		S32 cpatch[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
+		for (S32 j = 0; j < PATCHES_PER_EDGE; ++j)
+		{
+			for (S32 i = 0; i < PATCHES_PER_EDGE; ++i)
+			{
+				F32* patch = &heights[j*NORMAL_PATCH_SIZE*GRIDS_PER_EDGE + i*NORMAL_PATCH_SIZE];
+				LLPatchHeader ph;
+				F32 zmax, zmin;
+				prescan_patch(patch, &ph, zmax, zmin);
+				ph.patchids = (i << 5) | j;
+				compress_patch(patch, cpatch, &ph, 8);
+				code_patch_header(bitpack, &ph, cpatch);
+				code_patch(bitpack, cpatch, 0);
+			}
+		}
+		code_end_of_data(bitpack);
+		return bitpack.flushBitPack();
+	}
+
+	// What LLSurface::decompressDCTPatch() did before LLPatchDecoder
+	void decode_land_scalar(U8* buffer, S32 size, std::vector<F32>& heights)
+	{
+		heights.assign(GRIDS_PER_EDGE*GRIDS_PER_EDGE, 0.f);
+		LLBitPack bitpack(buffer, size);
+		LLGroupHeader gopp;
+		decode_patch_group_header(bitpack, &gopp);
+		init_patch_decompressor(gopp.patch_size);
+		gopp.stride = GRIDS_PER_EDGE;
+		set_group_of_patch_header(&gopp);
+
+		LLPatchHeader ph;
+		S32 cpatch[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
+		while (1)
+		{
+			decode_patch_header(bitpack, &ph, FALSE);
+			if (ph.quant_wbits == END_OF_PATCHES)
+			{
+				break;
+			}
+			S32 i = ph.patchids >> 5;
+			S32 j = ph.patchids & 0x1F;
+			decode_patch(bitpack, cpatch);
+			decompress_patch(&heights[j*NORMAL_PATCH_SIZE*GRIDS_PER_EDGE + i*NORMAL_PATCH_SIZE], cpatch, &ph);
+		}
+	}
+
+	void apply_patches(const std::vector<LLDecodedPatch>& patches, std::vector<F32>& heights)
+	{
+		heights.assign(GRIDS_PER_EDGE*GRIDS_PER_EDGE, 0.f);
+		for (std::vector<LLDecodedPatch>::const_iterator iter = patches.begin(); iter != patches.end(); ++iter)
+		{
+			F32* patch = &heights[iter->mY*NORMAL_PATCH_SIZE*GRIDS_PER_EDGE + iter->mX*NORMAL_PATCH_SIZE];
+			for (S32 j = 0; j < NORMAL_PATCH_SIZE; ++j)
+			{
+				memcpy(patch + j*GRIDS_PER_EDGE, iter->mHeights + j*NORMAL_PATCH_SIZE, NORMAL_PATCH_SIZE*sizeof(F32));
+			}
+		}
+	}
+
+	bool same_bits(const F32* a, const F32* b, S32 count)
+	{
+		return memcmp(a, b, count*sizeof(F32)) == 0;
+	}
+}
+
+namespace tut
+{
+	struct LLPatchDecoderTestData
+	{
+		LLPatchDecoder mDecoder;
+	};
+
+	typedef test_group<LLPatchDecoderTestData> LLPatchDecoderTestGroup;
+	typedef LLPatchDecoderTestGroup::object LLPatchDecoderTestObject;
+	LLPatchDecoderTestGroup patchDecoderTestGroup("LLPatchDecoder");
+
+	template<> template<>
+	void LLPatchDecoderTestObject::test<1>()
+		// random coefficients of both patch sizes decompress to exactly
+		// the heights decompress_patch() gives
+	{
+		srand(11);
+		S32 cpatch[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
+		F32 expected[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
+		F32 heights[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
+		for (S32 size = NORMAL_PATCH_SIZE; size <= LARGE_PATCH_SIZE; size *= 2)
+		{
+			init_patch_decompressor(size);
+			LLGroupHeader gopp;
+			gopp.patch_size = size;
+			gopp.stride = size;
+			set_group_of_patch_header(&gopp);
+
+			for (S32 trial = 0; trial < 200; ++trial)
+			{
+				for (S32 i = 0; i < size*size; ++i)
+				{
+					// mostly low frequencies, as real terrain
+					cpatch[i] = (i < 40 || rand() % 8 == 0) ? (rand() % 2001) - 1000 : 0;
+				}
+				LLPatchHeader ph;
+				ph.dc_offset = ll_frand(200.f) - 50.f;
+				ph.range = 1 + rand() % 300;
+				ph.quant_wbits = ((rand() % 8) << 4) | (rand() % 16);
+				ph.patchids = 0;
+
+				decompress_patch(expected, cpatch, &ph);
+				mDecoder.decompress(cpatch, ph, size, heights, size);
+				ensure("same heights", same_bits(expected, heights, size*size));
+			}
+		}
+	}
+
+	template<> template<>
+	void LLPatchDecoderTestObject::test<2>()
+		// a whole coded land layer decodes to the same region heights
+	{
+		std::vector<F32> terrain;
+		make_terrain(terrain);
+		std::vector<U8> buffer(LAYER_BUFFER_SIZE);
+		S32 size = encode_land(terrain, &buffer[0]);
+
+		std::vector<F32> expected;
+		decode_land_scalar(&buffer[0], size, expected);
+
+		LLBitPack bitpack(&buffer[0], size);
+		LLGroupHeader gopp;
+		unpack_patch_group_header(bitpack, &gopp);
+		std::vector<LLDecodedPatch> patches;
+		ensure("valid layer", mDecoder.decodeGroup(bitpack, gopp, FALSE, PATCHES_PER_EDGE, patches));
+		ensure_equals("every patch", (S32)patches.size(), PATCHES_PER_EDGE*PATCHES_PER_EDGE);
+
+		std::vector<F32> heights;
+		apply_patches(patches, heights);
+		ensure("same region heights", same_bits(&expected[0], &heights[0], expected.size()));
+
+		// a region too small for the patch ids is rejected
+		LLBitPack bad_bitpack(&buffer[0], size);
+		unpack_patch_group_header(bad_bitpack, &gopp);
+		patches.clear();
+		ensure("bad patch id", !mDecoder.decodeGroup(bad_bitpack, gopp, FALSE, PATCHES_PER_EDGE/2, patches));
+		ensure("patches before it kept", !patches.empty() && (S32)patches.size() < PATCHES_PER_EDGE*PATCHES_PER_EDGE);
+	}
+
+	template<> template<>
+	void LLPatchDecoderTestObject::test<3>()
+		// layers decoded on the thread come back complete and in order
+	{
+		std::vector<F32> terrain;
+		make_terrain(terrain);
+		std::vector<U8> buffer(LAYER_BUFFER_SIZE);
+		S32 size = encode_land(terrain, &buffer[0]);
+		std::vector<F32> expected;
+		decode_land_scalar(&buffer[0], size, expected);
+
+		LLPatchDecodeThread thread;
+		std::vector<LLQueuedThread::handle_t> handles;
+		for (U64 region = 0; region < 9; ++region)
+		{
+			U8* data = new U8[size];
+			memcpy(data, &buffer[0], size);
+			handles.push_back(thread.decode(region, data, size, FALSE, PATCHES_PER_EDGE));
+		}
+
+		for (U64 region = 0; region < 9; ++region)
+		{
+			LLQueuedThread::handle_t handle = handles[region];
+			while (thread.getRequestStatus(handle) != LLQueuedThread::STATUS_COMPLETE)
+			{
+				thread.update(0);
+				ms_sleep(1);
+			}
+			LLPatchDecodeThread::DecodeRequest* req = thread.getDecodeRequest(handle);
+			ensure_equals("region handle", req->getRegionHandle(), region);
+			ensure("valid", req->isValid());
+			ensure_equals("patch size", req->getPatchSize(), (S32)NORMAL_PATCH_SIZE);
+
+			std::vector<F32> heights;
+			apply_patches(req->getPatches(), heights);
+			ensure("same region heights", same_bits(&expected[0], &heights[0], expected.size()));
+			thread.completeRequest(handle);
+		}
+		thread.shutdown();
+	}
+}
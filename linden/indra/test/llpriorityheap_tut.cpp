@@ -0,0 +1,190 @@
+/**
+ * @file llpriorityheap_tut.cpp
+ * @brief LLPriorityHeap tests.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#include <tut/tut.hpp>
+#include "linden_common.h"
+#include "lltut.h"
+
+#include <set>
+
+#include "llpriorityheap.h"
+
+namespace
+{
+	typedef LLPriorityHeap<S32> heap_t;
+
+	// Repeatable, so that failures can be reproduced
+	U32 sRandomSeed = 1;
+	U32 next_random(U32 range)
+	{
+		sRandomSeed = sRandomSeed * 1664525 + 1013904223;
+		return (sRandomSeed >> 8) % range;
+	}
+
+	// Checks the heap against a sorted copy of what should be in it.
+	// priorities holds the priority of each item.
+	void ensure_heap_matches(const heap_t& heap, const std::vector<F32>& priorities, std::multiset<F32> expected)
+	{
+		tut::ensure_equals("size", heap.size(), (S32)expected.size());
+		std::vector<S32> top;
+		heap.getTop(heap.size(), top);
+		tut::ensure_equals("getTop size", (S32)top.size(), heap.size());
+		std::multiset<F32>::reverse_iterator riter = expected.rbegin();
+		for (std::vector<S32>::iterator iter = top.begin(); iter != top.end(); ++iter, ++riter)
+		{
+			tut::ensure_equals("priority order", priorities[*iter], *riter);
+		}
+	}
+}
+
+namespace tut
+{
+	struct LLPriorityHeapTestData
+	{
+	};
+
+	typedef test_group<LLPriorityHeapTestData> LLPriorityHeapTestGroup;
+	typedef LLPriorityHeapTestGroup::object LLPriorityHeapTestObject;
+	LLPriorityHeapTestGroup priorityHeapTestGroup("LLPriorityHeap");
+
+	template<> template<>
+	void LLPriorityHeapTestObject::test<1>()
+		// insert, erase and handles
+	{
+		heap_t heap;
+		ensure("starts empty", heap.empty());
+		ensure("no handles", !heap.isValid(0));
+
+		heap_t::handle_t low = heap.insert(1, 1.f);
+		heap_t::handle_t high = heap.insert(2, 5.f);
+		heap_t::handle_t mid = heap.insert(3, 3.f);
+		ensure_equals("size", heap.size(), 3);
+		ensure_equals("top", heap.top(), 2);
+		ensure_equals("top priority", heap.topPriority(), 5.f);
+		ensure_equals("item by handle", heap.get(mid), 3);
+		ensure_equals("priority by handle", heap.getPriority(low), 1.f);
+
+		heap.erase(high);
+		ensure("erased handle", !heap.isValid(high));
+		ensure("other handles", heap.isValid(low) && heap.isValid(mid));
+		ensure_equals("new top", heap.top(), 3);
+
+		heap_t::handle_t reused = heap.insert(4, 0.f);
+		ensure_equals("handle reused", reused, high);
+		ensure_equals("handle count", heap.getHandleCount(), 3);
+		ensure_equals("reused item", heap.get(reused), 4);
+
+		heap.clear();
+		ensure("cleared", heap.empty());
+		ensure("no handles after clear", !heap.isValid(low));
+	}
+
+	template<> template<>
+	void LLPriorityHeapTestObject::test<2>()
+		// priority changes move items both ways
+	{
+		heap_t heap;
+		std::vector<heap_t::handle_t> handles;
+		for (S32 i = 0; i < 100; ++i)
+		{
+			handles.push_back(heap.insert(i, (F32)i));
+		}
+		ensure_equals("highest", heap.top(), 99);
+
+		heap.setPriority(handles[10], 1000.f);
+		ensure_equals("raised to top", heap.top(), 10);
+
+		heap.setPriority(handles[10], -1.f);
+		ensure_equals("lowered", heap.top(), 99);
+		heap.setPriority(handles[99], -2.f);
+		ensure_equals("next highest", heap.top(), 98);
+
+		std::vector<S32> top;
+		heap.getTop(3, top);
+		ensure_equals("top count", (S32)top.size(), 3);
+		ensure_equals("top 0", top[0], 98);
+		ensure_equals("top 1", top[1], 97);
+		ensure_equals("top 2", top[2], 96);
+		ensure_equals("getTop leaves the heap", heap.size(), 100);
+
+		top.clear();
+		heap.getTop(200, top);
+		ensure_equals("no more than there are", (S32)top.size(), 100);
+		ensure_equals("lowest last", top.back(), 99);
+	}
+
+	template<> template<>
+	void LLPriorityHeapTestObject::test<3>()
+		// random inserts, erases and changes against a sorted set
+	{
+		const S32 STEPS = 5000;
+		heap_t heap;
+		std::vector<heap_t::handle_t> handles;
+		std::vector<F32> priorities(STEPS);
+		std::multiset<F32> expected;
+		for (S32 step = 0; step < STEPS; ++step)
+		{
+			F32 priority = (F32)next_random(1000);
+			S32 action = next_random(4);
+			if (handles.empty() || action == 0)
+			{
+				handles.push_back(heap.insert(step, priority));
+				priorities[step] = priority;
+				expected.insert(priority);
+			}
+			else
+			{
+				S32 index = next_random(handles.size());
+				heap_t::handle_t handle = handles[index];
+				expected.erase(expected.find(heap.getPriority(handle)));
+				if (action == 1)
+				{
+					heap.erase(handle);
+					handles[index] = handles.back();
+					handles.pop_back();
+				}
+				else
+				{
+					heap.setPriority(handle, priority);
+					priorities[heap.get(handle)] = priority;
+					expected.insert(priority);
+				}
+			}
+			if (step % 500 == 0)
+			{
+				ensure_heap_matches(heap, priorities, expected);
+			}
+		}
+		ensure_heap_matches(heap, priorities, expected);
+	}
+}
@@ -0,0 +1,200 @@
+/**
+ * @file llpumpthread_tut.cpp
+ * @brief LLPumpThread and threaded LLPumpIO tests.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include <tut/tut.hpp>
+#include "linden_common.h"
+#include "lltut.h"
+
+#include "llpumpio.h"
+#include "llpumpthread.h"
+#include "lltimer.h"
+
+namespace
+{
+	const S32 NUM_CHAINS = 50;
+
+	// Counts the responses run and remembers the thread they ran on.
+	class ResponsePipe : public LLIOPipe
+	{
+	public:
+		ResponsePipe(S32& count, U32& thread_id)
+			: mCount(count), mThreadID(thread_id)
+		{
+		}
+
+	protected:
+		/*virtual*/ EStatus process_impl(const LLChannelDescriptors& channels,
+			buffer_ptr_t& buffer, bool& eos, LLSD& context, LLPumpIO* pump)
+		{
+			mThreadID = LLThread::currentID();
+			++mCount;
+			return STATUS_DONE;
+		}
+
+		S32& mCount;
+		U32& mThreadID;
+	};
+
+	// Breaks for a few pumps, as a pipe waiting on curl would, then
+	// queues its response and finishes.
+	class RequestPipe : public LLIOPipe
+	{
+	public:
+		RequestPipe(LLIOPipe* response, U32& thread_id)
+			: mResponse(response), mThreadID(thread_id), mPumps(0)
+		{
+		}
+
+	protected:
+		/*virtual*/ EStatus process_impl(const LLChannelDescriptors& channels,
+			buffer_ptr_t& buffer, bool& eos, LLSD& context, LLPumpIO* pump)
+		{
+			mThreadID = LLThread::currentID();
+			if (++mPumps < 3)
+			{
+				return STATUS_BREAK;
+			}
+			pump->respond(mResponse.get());
+			mResponse = NULL;
+			return STATUS_DONE;
+		}
+
+		LLIOPipe::ptr_t mResponse;
+		U32& mThreadID;
+		S32 mPumps;
+	};
+
+	void add_chains(LLPumpIO& pump, S32& count, U32& request_thread, U32& response_thread)
+	{
+		for (S32 i = 0; i < NUM_CHAINS; ++i)
+		{
+			LLPumpIO::chain_t chain;
+			chain.push_back(LLIOPipe::ptr_t(new RequestPipe(
+				new ResponsePipe(count, response_thread), request_thread)));
+			pump.addChain(chain, DEFAULT_CHAIN_EXPIRY_SECS);
+		}
+	}
+}
+
+namespace tut
+{
+	struct LLPumpThreadTestData
+	{
+	};
+
+	typedef test_group<LLPumpThreadTestData> LLPumpThreadTestGroup;
+	typedef LLPumpThreadTestGroup::object LLPumpThreadTestObject;
+	LLPumpThreadTestGroup pumpThreadTestGroup("LLPumpThread");
+
+	template<> template<>
+	void LLPumpThreadTestObject::test<1>()
+		// an unthreaded pump runs chains and responses on the caller
+	{
+		LLPumpIO pump;
+		S32 count = 0;
+		U32 request_thread = 0;
+		U32 response_thread = 0;
+		add_chains(pump, count, request_thread, response_thread);
+
+		for (S32 i = 0; i < 10 && count < NUM_CHAINS; ++i)
+		{
+			pump.pump();
+			pump.callback();
+			// returns at once when not threaded
+			pump.waitForChains(1000000);
+		}
+		ensure_equals("responses", count, NUM_CHAINS);
+		ensure_equals("requests ran here", request_thread, LLThread::currentID());
+		ensure_equals("responses ran here", response_thread, LLThread::currentID());
+		ensure("chain latency recorded", pump.getChainLatencyStat()->getNumValues() > 0);
+		ensure("callback delay recorded", pump.getCallbackDelayStat()->getNumValues() > 0);
+	}
+
+	template<> template<>
+	void LLPumpThreadTestObject::test<2>()
+		// a pump thread runs the chains, callback() runs the responses
+	{
+		LLPumpIO pump;
+		LLPumpThread thread(&pump);
+		thread.start();
+
+		S32 count = 0;
+		U32 request_thread = 0;
+		U32 response_thread = 0;
+		add_chains(pump, count, request_thread, response_thread);
+
+		LLTimer timer;
+		while (count < NUM_CHAINS && timer.getElapsedTimeF32() < 10.f)
+		{
+			pump.callback();
+			ms_sleep(1);
+		}
+		thread.shutdown();
+		ensure("thread stopped", thread.isStopped());
+
+		ensure_equals("responses", count, NUM_CHAINS);
+		ensure("requests ran on the pump thread", request_thread != 0 && request_thread != LLThread::currentID());
+		ensure_equals("responses ran here", response_thread, LLThread::currentID());
+		ensure("chain latency recorded", pump.getChainLatencyStat()->getNumValues() > 0);
+		ensure("latency is sane", pump.getChainLatencyStat()->getMax() < 10000.f);
+	}
+
+	template<> template<>
+	void LLPumpThreadTestObject::test<3>()
+		// an idle pump thread wakes for new chains and for shutdown
+	{
+		LLPumpIO pump;
+		LLPumpThread thread(&pump);
+		thread.start();
+		ms_sleep(50);
+
+		S32 count = 0;
+		U32 request_thread = 0;
+		U32 response_thread = 0;
+		add_chains(pump, count, request_thread, response_thread);
+
+		LLTimer timer;
+		while (count < NUM_CHAINS && timer.getElapsedTimeF32() < 10.f)
+		{
+			pump.callback();
+			ms_sleep(1);
+		}
+		ensure_equals("responses", count, NUM_CHAINS);
+
+		// let the thread go back to waiting for chains
+		ms_sleep(50);
+		timer.reset();
+		thread.shutdown();
+		ensure("thread stopped", thread.isStopped());
+		ensure("shutdown did not time out", timer.getElapsedTimeF32() < 5.f);
+	}
+}
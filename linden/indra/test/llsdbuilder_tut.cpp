@@ -0,0 +1,461 @@
+/**
+ * @file llsdbuilder_tut.cpp
+ * @brief Tests for LLSDBuilder and the compact LLSD it makes
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+
+#include <tut/tut.hpp>
+#include "linden_common.h"
+#include "lltut.h"
+
+#include <sstream>
+
+#include "llformat.h"
+#include "llsd.h"
+#include "llsdserialize.h"
+
+namespace
+{
+	std::string to_xml(const LLSD& sd)
+	{
+		std::ostringstream stream;
+		LLSDSerialize::toXML(sd, stream);
+		return stream.str();
+	}
+
+	// Copies from into to with new values, the way the parsers used to
+	// build documents, or with builder when there is one.
+	void rebuild(const LLSD& from, LLSD& to, LLSDBuilder* builder)
+	{
+		switch (from.type())
+		{
+		case LLSD::TypeMap:
+			if (builder)
+			{
+				builder->makeMap(to);
+			}
+			else
+			{
+				to = LLSD::emptyMap();
+			}
+			for (LLSD::map_const_iterator iter = from.beginMap(); iter != from.endMap(); ++iter)
+			{
+				rebuild(iter->second, builder ? builder->add(to, iter->first) : to[iter->first], builder);
+			}
+			break;
+
+		case LLSD::TypeArray:
+			if (builder)
+			{
+				builder->makeArray(to);
+			}
+			else
+			{
+				to = LLSD::emptyArray();
+			}
+			for (LLSD::array_const_iterator iter = from.beginArray(); iter != from.endArray(); ++iter)
+			{
+				if (builder)
+				{
+					rebuild(*iter, builder->append(to), builder);
+				}
+				else
+				{
+					to.append(LLSD());
+					rebuild(*iter, to[to.size() - 1], builder);
+				}
+			}
+			break;
+
+		case LLSD::TypeBoolean:
+			builder ? builder->assign(to, from.asBoolean()) : to.assign(from.asBoolean());
+			break;
+		case LLSD::TypeInteger:
+			builder ? builder->assign(to, from.asInteger()) : to.assign(from.asInteger());
+			break;
+		case LLSD::TypeReal:
+			builder ? builder->assign(to, from.asReal()) : to.assign(from.asReal());
+			break;
+		case LLSD::TypeString:
+			builder ? builder->assign(to, from.asString()) : to.assign(from.asString());
+			break;
+		case LLSD::TypeUUID:
+			builder ? builder->assign(to, from.asUUID()) : to.assign(from.asUUID());
+			break;
+		case LLSD::TypeDate:
+			builder ? builder->assign(to, from.asDate()) : to.assign(from.asDate());
+			break;
+		case LLSD::TypeURI:
+			builder ? builder->assign(to, from.asURI()) : to.assign(from.asURI());
+			break;
+		case LLSD::TypeBinary:
+			builder ? builder->assign(to, from.asBinary()) : to.assign(from.asBinary());
+			break;
+		default:
+			to.clear();
+			break;
+		}
+	}
+
+	// A FetchInventoryDescendents reply with folder_count folders of
+	// item_count items each
+	LLSD make_inventory(S32 folder_count, S32 item_count)
+	{
+		LLSD folders = LLSD::emptyArray();
+		for (S32 f = 0; f < folder_count; ++f)
+		{
+			LLUUID folder_id;
+			folder_id.generate();
+			LLSD folder;
+			folder["folder_id"] = folder_id;
+			folder["owner_id"] = LLUUID::null;
+			folder["agent_id"] = LLUUID::null;
+			folder["descendents"] = item_count;
+			folder["version"] = f;
+			folder["categories"] = LLSD::emptyArray();
+			LLSD items = LLSD::emptyArray();
+			for (S32 i = 0; i < item_count; ++i)
+			{
+				LLSD item;
+				LLUUID id;
+				id.generate();
+				item["item_id"] = id;
+				item["parent_id"] = folder_id;
+				item["asset_id"] = id;
+				item["name"] = llformat("Object %d", i);
+				item["desc"] = "(No Description)";
+				item["type"] = 6;
+				item["inv_type"] = 6;
+				item["flags"] = 0;
+				item["created_at"] = 1234567890 + i;
+				LLSD sale_info;
+				sale_info["sale_price"] = 10;
+				sale_info["sale_type"] = "not";
+				item["sale_info"] = sale_info;
+				LLSD permissions;
+				permissions["creator_id"] = id;
+				permissions["owner_id"] = id;
+				permissions["group_id"] = LLUUID::null;
+				permissions["last_owner_id"] = id;
+				permissions["base_mask"] = 0x7fffffff;
+				permissions["owner_mask"] = 0x7fffffff;
+				permissions["group_mask"] = 0;
+				permissions["everyone_mask"] = 0;
+				permissions["next_owner_mask"] = 0x82000;
+				permissions["is_owner_group"] = false;
+				item["permissions"] = permissions;
+				items.append(item);
+			}
+			folder["items"] = items;
+			folders.append(folder);
+		}
+		LLSD reply;
+		reply["folders"] = folders;
+		return reply;
+	}
+
+	// Reads a few fields of every item, as the inventory code does
+	S32 read_inventory(const LLSD& reply)
+	{
+		S32 total = 0;
+		const LLSD& folders = reply["folders"];
+		for (S32 f = 0; f < folders.size(); ++f)
+		{
+			const LLSD& items = folders[f]["items"];
+			for (S32 i = 0; i < items.size(); ++i)
+			{
+				const LLSD& item = items[i];
+				total += item["type"].asInteger();
+				total += item["permissions"]["base_mask"].asInteger() & 1;
+				total += item["item_id"].asUUID().notNull() ? 1 : 0;
+			}
+		}
+		return total;
+	}
+}
+
+namespace tut
+{
+	struct LLSDBuilderTestData
+	{
+		LLSDBuilder mBuilder;
+	};
+
+	typedef test_group<LLSDBuilderTestData> LLSDBuilderTestGroup;
+	typedef LLSDBuilderTestGroup::object LLSDBuilderTestObject;
+	LLSDBuilderTestGroup builderTestGroup("LLSDBuilder");
+
+	template<> template<>
+	void LLSDBuilderTestObject::test<1>()
+		// maps: lookups, duplicate keys and iteration
+	{
+		LLSD map;
+		mBuilder.makeMap(map);
+		mBuilder.assign(mBuilder.add(map, "pear"), (LLSD::Integer)1);
+		mBuilder.assign(mBuilder.add(map, "apple"), (LLSD::Integer)2);
+		mBuilder.assign(mBuilder.add(map, "zebra"), (LLSD::Integer)3);
+		mBuilder.assign(mBuilder.add(map, "apple"), (LLSD::Integer)4);
+		mBuilder.assign(mBuilder.add(map, ""), (LLSD::Integer)5);
+
+		const LLSD& sd = map;
+		ensure("is a map", sd.isMap());
+		ensure_equals("size", sd.size(), 4);
+		ensure("has pear", sd.has("pear"));
+		ensure("no peach", !sd.has("peach"));
+		ensure_equals("later duplicate wins", sd["apple"].asInteger(), 4);
+		ensure_equals("empty key", sd[""].asInteger(), 5);
+		ensure_equals("get", sd.get("zebra").asInteger(), 3);
+		ensure("missing is undefined", sd["peach"].isUndefined());
+
+		const char* keys[] = { "", "apple", "pear", "zebra" };
+		S32 i = 0;
+		for (LLSD::map_const_iterator iter = sd.beginMap(); iter != sd.endMap(); ++iter, ++i)
+		{
+			ensure_equals("iteration order", iter->first, std::string(keys[i]));
+			ensure_equals("iteration value", iter->second, sd[keys[i]]);
+		}
+		ensure_equals("iteration count", i, 4);
+
+		// Building many small values only takes the arena's blocks
+		U32 start = LLSD::allocationCount();
+		LLSD big;
+		mBuilder.makeMap(big);
+		for (S32 i = 0; i < 1000; ++i)
+		{
+			mBuilder.assign(mBuilder.add(big, llformat("key %d", i)), llformat("value %d", i));
+		}
+		ensure_equals("big size", big.size(), 1000);
+		ensure_equals("big lookup", big["key 567"].asString(), std::string("value 567"));
+		ensure("few allocations", LLSD::allocationCount() - start < 20);
+	}
+
+	template<> template<>
+	void LLSDBuilderTestObject::test<2>()
+		// changing a built map copies it only when it has to
+	{
+		LLSD map;
+		mBuilder.makeMap(map);
+		mBuilder.assign(mBuilder.add(map, "a"), (LLSD::Integer)1);
+		mBuilder.assign(mBuilder.add(map, "b"), std::string("two"));
+
+		// Unshared, an existing key changes in place
+		U32 start = LLSD::allocationCount();
+		map["a"] = 10;
+		ensure_equals("no copy for an existing key", LLSD::allocationCount() - start, 0U);
+		ensure_equals("changed", map["a"].asInteger(), 10);
+
+		// Shared, the change goes to a copy
+		LLSD copy = map;
+		copy["a"] = 20;
+		ensure_equals("copy changed", copy["a"].asInteger(), 20);
+		ensure_equals("original kept", map["a"].asInteger(), 10);
+
+		// New keys, erasing and iterators make an ordinary map
+		map["c"] = 3;
+		ensure_equals("new key", map.size(), 3);
+		map.erase("b");
+		ensure("erased", !map.has("b"));
+		map.insert("d", 4);
+		S32 count = 0;
+		for (LLSD::map_iterator iter = map.beginMap(); iter != map.endMap(); ++iter)
+		{
+			iter->second = iter->second.asInteger() + 1;
+			++count;
+		}
+		ensure_equals("iterated", count, 3);
+		ensure_equals("a", map["a"].asInteger(), 11);
+		ensure_equals("c", map["c"].asInteger(), 4);
+		ensure_equals("d", map["d"].asInteger(), 5);
+		ensure_equals("copy untouched", copy.size(), 2);
+		ensure_equals("copy b", copy["b"].asString(), std::string("two"));
+
+		// Arrays are ordinary ones in the arena
+		LLSD array;
+		mBuilder.makeArray(array);
+		mBuilder.assign(mBuilder.append(array), (LLSD::Integer)1);
+		mBuilder.assign(mBuilder.append(array), (LLSD::Real)2.5);
+		array.append(3);
+		ensure_equals("array size", array.size(), 3);
+		ensure_equals("array real", array[1].asReal(), 2.5);
+		ensure_equals("array appended", array[2].asInteger(), 3);
+	}
+
+	template<> template<>
+	void LLSDBuilderTestObject::test<3>()
+		// scalars and arena strings convert like ordinary ones
+	{
+		LLSD value;
+		mBuilder.assign(value, std::string("12.75"));
+		ensure("string", value.isString());
+		ensure_equals("asInteger", value.asInteger(), LLSD("12.75").asInteger());
+		ensure_equals("asReal", value.asReal(), 12.75);
+		ensure("asBoolean", value.asBoolean());
+
+		LLSD empty;
+		mBuilder.assign(empty, "", 0);
+		ensure("empty string", empty.isString() && !empty.asBoolean());
+
+		LLUUID id;
+		id.generate();
+		LLSD id_string;
+		mBuilder.assign(id_string, id.asString());
+		ensure_equals("asUUID", id_string.asUUID(), id);
+
+		LLSD id_value;
+		mBuilder.assign(id_value, id);
+		ensure_equals("uuid", id_value.asUUID(), id);
+
+		LLSD date;
+		mBuilder.assign(date, LLDate(1234567890.0));
+		ensure_equals("date", date.asInteger(), 1234567890);
+
+		LLSD flag;
+		mBuilder.assign(flag, true);
+		ensure("boolean", flag.isBoolean() && flag.asBoolean());
+
+		// Assigning to a shared string leaves the other alone
+		LLSD copy = value;
+		value = "changed";
+		ensure_equals("assigned", value.asString(), std::string("changed"));
+		ensure_equals("copy kept", copy.asString(), std::string("12.75"));
+		copy = 5;
+		ensure("now an integer", copy.isInteger());
+	}
+
+	template<> template<>
+	void LLSDBuilderTestObject::test<4>()
+		// the arena lives as long as any value in it
+	{
+		U32 outstanding = LLSD::outstandingCount();
+		LLSD kept;
+		{
+			LLSD doc;
+			mBuilder.makeMap(doc);
+			LLSD& list = mBuilder.add(doc, "list");
+			mBuilder.makeArray(list);
+			for (S32 i = 0; i < 100; ++i)
+			{
+				mBuilder.assign(mBuilder.append(list), llformat("entry %d", i));
+			}
+			kept = doc["list"][50];
+			mBuilder.reset();
+		}
+		ensure_equals("kept value", kept.asString(), std::string("entry 50"));
+		ensure_equals("one value left", LLSD::outstandingCount(), outstanding + 1);
+		kept.clear();
+		ensure_equals("all freed", LLSD::outstandingCount(), outstanding);
+	}
+
+	template<> template<>
+	void LLSDBuilderTestObject::test<5>()
+		// the XML parser builds compact documents
+	{
+		LLSD reply = make_inventory(4, 25);
+		std::string xml = to_xml(reply);
+
+		U32 start = LLSD::allocationCount();
+		LLSD parsed;
+		std::istringstream stream(xml);
+		LLSDSerialize::fromXML(parsed, stream);
+		U32 allocations = LLSD::allocationCount() - start;
+
+		ensure_equals("same document", to_xml(parsed), xml);
+		ensure_equals("same reads", read_inventory(parsed), read_inventory(reply));
+		ensure("few allocations", allocations < 20);
+
+		// Duplicate keys keep the last value, as they did before
+		std::istringstream duplicates(
+			"<llsd><map><key>a</key><integer>1</integer>"
+			"<key>a</key><integer>2</integer></map></llsd>");
+		LLSD map;
+		LLSDSerialize::fromXML(map, duplicates);
+		ensure_equals("one key", map.size(), 1);
+		ensure_equals("last value", map["a"].asInteger(), 2);
+	}
+
+	template<> template<>
+	void LLSDBuilderTestObject::test<6>()
+		// an inventory reply built the old way and with the builder
+	{
+		LLSD reply = make_inventory(50, 100);
+
+		U32 start = LLSD::allocationCount();
+		LLSD plain;
+		rebuild(reply, plain, NULL);
+		U32 plain_allocations = LLSD::allocationCount() - start;
+
+		start = LLSD::allocationCount();
+		LLSD compact;
+		LLSDBuilder builder;
+		rebuild(reply, compact, &builder);
+		U32 compact_allocations = LLSD::allocationCount() - start;
+
+		ensure_equals("same reads", read_inventory(compact), read_inventory(plain));
+		ensure("fewer allocations", compact_allocations * 100 < plain_allocations);
+	}
+
+	template<> template<>
+	void LLSDBuilderTestObject::test<7>()
+		// iterators into a built map stay valid while it is written
+	{
+		LLSD map;
+		mBuilder.makeMap(map);
+		mBuilder.assign(mBuilder.add(map, "a"), (LLSD::Integer)1);
+		mBuilder.assign(mBuilder.add(map, "b"), (LLSD::Integer)2);
+
+		const LLSD& sd = map;
+		LLSD::map_const_iterator iter = sd.beginMap();
+		ensure_equals("first key", iter->first, std::string("a"));
+
+		// an existing key, then a new one, through the non-const alias
+		map["a"] = 10;
+		map["c"] = 3;
+		ensure_equals("iterator sees the write", iter->second.asInteger(), 10);
+		ensure_equals("lookup sees the write", sd["a"].asInteger(), 10);
+		ensure_equals("size", sd.size(), 3);
+		ensure("has new key", sd.has("c"));
+
+		S32 total = 0;
+		S32 count = 0;
+		for (; iter != sd.endMap(); ++iter, ++count)
+		{
+			total += iter->second.asInteger();
+		}
+		ensure_equals("iterated", count, 3);
+		ensure_equals("values", total, 15);
+
+		// a copy still writes to its own map
+		LLSD copy = map;
+		copy["b"] = 20;
+		ensure_equals("copy changed", copy["b"].asInteger(), 20);
+		ensure_equals("original kept", sd["b"].asInteger(), 2);
+	}
+}
@@ -159,4 +159,24 @@ namespace tut
 		LLSD sd1 = ll_sd_from_color4(c1);
 		ensure_equals("sd -> LLColor4 -> sd", sd, sd1);
 	}
+
+	template<> template<>
+	void llsdutil_object::test<9>()
+	{
+		LLSD sd;
+		sd["name"] = "pump";
+		sd["list"].append(1);
+		sd["list"].append(2.5);
+		sd["id"] = LLUUID::generateNewID();
+		LLSD clone = llsd_clone(sd);
+		ensure_equals("clone has the same string", clone["name"].asString(), sd["name"].asString());
+		ensure_equals("clone has the same array", clone["list"].size(), 2);
+		ensure_equals("clone has the same real", clone["list"][1].asReal(), 2.5);
+		ensure_equals("clone has the same uuid", clone["id"].asUUID(), sd["id"].asUUID());
+
+		sd["list"][0] = 7;
+		sd["name"] = "changed";
+		ensure_equals("clone array unchanged", clone["list"][0].asInteger(), 1);
+		ensure_equals("clone string unchanged", clone["name"].asString(), std::string("pump"));
+	}
 }
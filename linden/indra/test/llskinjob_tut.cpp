@@ -0,0 +1,208 @@
+/**
+ * @file llskinjob_tut.cpp
+ * @brief LLSkinJob tests.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#include <tut/tut.hpp>
+#include "linden_common.h"
+#include "lltut.h"
+
+#include "lljobpool.h"
+#include "llquaternion.h"
+#include "llrand.h"
+#include "llskinjob.h"
+
+namespace
+{
+	const S32 NUM_JOINTS = 15;		// LL_CHARACTER_MAX_JOINTS_PER_MESH
+
+	// Roughly the vertex counts of the highest avatar mesh LODs
+	const U32 MESH_VERTICES[] = { 1300, 1600, 1200, 300, 100, 900 };
+
+	// One synthetic mesh: a bind pose, weights in runs along the joint
+	// chain as a real mesh has them, and posed joints.
+	struct TestMesh
+	{
+		std::vector<F32> mWeights;
+		std::vector<LLVector3> mCoords;
+		std::vector<LLVector3> mNormals;
+		std::vector<LLVector3> mOutVertices;
+		std::vector<LLVector3> mOutNormals;
+		LLMatrix4 mJointMat[LLSkinJob::MAX_JOINTS];
+		LLMatrix3 mJointRot[LLSkinJob::MAX_JOINTS];
+
+		TestMesh(U32 num_vertices)
+			: mWeights(num_vertices), mCoords(num_vertices), mNormals(num_vertices),
+			  mOutVertices(num_vertices), mOutNormals(num_vertices)
+		{
+			F32 weight = 0.f;
+			for (U32 i = 0; i < num_vertices; ++i)
+			{
+				if (i % 8 == 0)
+				{
+					S32 joint = rand() % (NUM_JOINTS - 1);
+					// some vertices sit on a single joint
+					weight = joint + (rand() % 4 ? ll_frand(0.999f) : 1.f);
+				}
+				mWeights[i] = weight;
+				mCoords[i].setVec(ll_frand(1.f) - 0.5f, ll_frand(1.f) - 0.5f, ll_frand(2.f));
+				mNormals[i].setVec(ll_frand(1.f) - 0.5f, ll_frand(1.f) - 0.5f, ll_frand(1.f) - 0.5f);
+				mNormals[i].normVec();
+			}
+			for (S32 j = 0; j < NUM_JOINTS; ++j)
+			{
+				LLQuaternion rot(ll_frand(F_PI), LLVector3(ll_frand(1.f), ll_frand(1.f), 1.f));
+				LLVector3 pos(ll_frand(0.2f), ll_frand(0.2f), (F32)j * 0.1f);
+				mJointMat[j].initAll(LLVector3(1.f, 1.f, 1.f), rot, pos);
+				mJointRot[j] = mJointMat[j].getMat3();
+			}
+		}
+
+		void setupJob(LLSkinJob& job)
+		{
+			memcpy(job.mJointMat, mJointMat, sizeof(mJointMat));
+			memcpy(job.mJointRot, mJointRot, sizeof(mJointRot));
+			job.mWeights = &mWeights[0];
+			job.mCoords = &mCoords[0];
+			job.mNormals = &mNormals[0];
+			job.mNumVertices = mWeights.size();
+			job.mOutVertices = &mOutVertices[0];
+			job.mOutNormals = &mOutNormals[0];
+		}
+	};
+
+	class SkinJobList : public LLJobPool::Job
+	{
+	public:
+		SkinJobList(std::vector<LLSkinJob>& jobs) : mJobs(jobs) {}
+		/*virtual*/ void run(S32 index) { mJobs[index].run(); }
+	private:
+		std::vector<LLSkinJob>& mJobs;
+	};
+
+	struct Crowd
+	{
+		std::vector<TestMesh*> mMeshes;
+		std::vector<LLSkinJob> mJobs;
+
+		Crowd(S32 num_avatars)
+		{
+			for (S32 i = 0; i < num_avatars; ++i)
+			{
+				for (size_t j = 0; j < LL_ARRAY_SIZE(MESH_VERTICES); ++j)
+				{
+					mMeshes.push_back(new TestMesh(MESH_VERTICES[j]));
+				}
+			}
+			mJobs.resize(mMeshes.size());
+			for (size_t i = 0; i < mMeshes.size(); ++i)
+			{
+				mMeshes[i]->setupJob(mJobs[i]);
+			}
+		}
+
+		~Crowd()
+		{
+			for (size_t i = 0; i < mMeshes.size(); ++i)
+			{
+				delete mMeshes[i];
+			}
+		}
+	};
+}
+
+namespace tut
+{
+	struct LLSkinJobTestData
+	{
+	};
+
+	typedef test_group<LLSkinJobTestData> LLSkinJobTestGroup;
+	typedef LLSkinJobTestGroup::object LLSkinJobTestObject;
+	LLSkinJobTestGroup skinJobTestGroup("LLSkinJob");
+
+	template<> template<>
+	void LLSkinJobTestObject::test<1>()
+		// each vertex is blended between the two joints its weight names
+	{
+		srand(42);
+		TestMesh mesh(500);
+		LLSkinJob job;
+		mesh.setupJob(job);
+		job.run();
+
+		for (U32 i = 0; i < mesh.mWeights.size(); ++i)
+		{
+			S32 joint = llfloor(mesh.mWeights[i]);
+			F32 w = mesh.mWeights[i] - joint;
+			LLVector3 first = mesh.mCoords[i] * mesh.mJointMat[joint];
+			LLVector3 second = mesh.mCoords[i] * mesh.mJointMat[joint + 1];
+			LLVector3 expected = first + (second - first) * w;
+			ensure("vertex blended", dist_vec(expected, mesh.mOutVertices[i]) < 1.0e-4f);
+
+			LLVector3 first_normal = mesh.mNormals[i] * mesh.mJointRot[joint];
+			LLVector3 second_normal = mesh.mNormals[i] * mesh.mJointRot[joint + 1];
+			LLVector3 expected_normal = first_normal + (second_normal - first_normal) * w;
+			ensure("normal blended", dist_vec(expected_normal, mesh.mOutNormals[i]) < 1.0e-4f);
+		}
+	}
+
+	template<> template<>
+	void LLSkinJobTestObject::test<2>()
+		// a crowd skinned on a job pool matches skinning it one mesh at a
+		// time, bit for bit
+	{
+		srand(7);
+		Crowd crowd(8);
+		for (size_t i = 0; i < crowd.mJobs.size(); ++i)
+		{
+			crowd.mJobs[i].run();
+		}
+		std::vector<std::vector<LLVector3> > serial;
+		for (size_t i = 0; i < crowd.mMeshes.size(); ++i)
+		{
+			serial.push_back(crowd.mMeshes[i]->mOutVertices);
+			serial.push_back(crowd.mMeshes[i]->mOutNormals);
+			crowd.mMeshes[i]->mOutVertices.assign(crowd.mMeshes[i]->mOutVertices.size(), LLVector3::zero);
+			crowd.mMeshes[i]->mOutNormals.assign(crowd.mMeshes[i]->mOutNormals.size(), LLVector3::zero);
+		}
+
+		LLJobPool pool("skin", 3);
+		SkinJobList jobs(crowd.mJobs);
+		pool.run(jobs, crowd.mJobs.size());
+
+		for (size_t i = 0; i < crowd.mMeshes.size(); ++i)
+		{
+			ensure("same vertices", serial[2 * i] == crowd.mMeshes[i]->mOutVertices);
+			ensure("same normals", serial[2 * i + 1] == crowd.mMeshes[i]->mOutNormals);
+		}
+	}
+}
@@ -0,0 +1,364 @@
+/**
+ * @file llskyeval_tut.cpp
+ * @brief LLSkyEval tests against the scalar sky model.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#include <tut/tut.hpp>
+#include "linden_common.h"
+#include "lltut.h"
+
+#include "lljobpool.h"
+#include "llskyeval.h"
+
+namespace
+{
+	const S32 RESOLUTION = 64;		// LLSkyTex::sResolution
+	const S32 FACE_TEXELS = RESOLUTION * RESOLUTION;
+
+	// Default.xml with the sun at elevation sun_y
+	LLSkyEval::Params sky_params(F32 sun_y, bool wind_light_shaders)
+	{
+		LLSkyEval::Params params;
+		params.mDomeRadius = 15000.f;
+		params.mDomeOffsetRatio = 0.96f;
+		params.mSunlightColor.set(0.734f, 0.781f, 0.9f);
+		params.mAmbient.set(1.05f, 1.05f, 1.05f);
+		params.mBlueDensity.set(0.245f, 0.449f, 0.76f);
+		params.mBlueHorizon.set(0.495f, 0.495f, 0.64f);
+		params.mHazeDensity = 0.7f;
+		params.mHazeHorizon = 0.19f;
+		params.mDensityMultiplier = 0.00018f;
+		params.mMaxY = 1605.f;
+		params.mGlow.set(5.f, 0.001f, -0.48f);
+		params.mCloudShadow = 0.27f;
+		params.mLightNorm.set(sqrtf(1.f - sun_y * sun_y), llmax(sun_y, -0.1f), 0.f);
+		params.mFogColor.set(0.3f, 0.35f, 0.5f);
+		params.mWindLightShaders = wind_light_shaders;
+		return params;
+	}
+
+	// The directions of LLVOSky::initSkyTextureDirs(), texel (x, y) of a
+	// face at x * RESOLUTION + y
+	void face_dirs(S32 side, std::vector<LLVector3>& dirs)
+	{
+		dirs.resize(FACE_TEXELS);
+		F32 coeff[3] = {0, 0, 0};
+		const S32 curr_coef = side >> 1;
+		const S32 x_coef = (curr_coef + 1) % 3;
+		const S32 y_coef = (x_coef + 1) % 3;
+		coeff[curr_coef] = (F32)(((side & 1) << 1) - 1);
+		F32 inv_res = 1.f/RESOLUTION;
+		for (S32 x = 0; x < RESOLUTION; ++x)
+		{
+			for (S32 y = 0; y < RESOLUTION; ++y)
+			{
+				coeff[x_coef] = F32((x<<1) + 1) * inv_res - 1.f;
+				coeff[y_coef] = F32((y<<1) + 1) * inv_res - 1.f;
+				LLVector3 dir(coeff[0], coeff[1], coeff[2]);
+				dir.normalize();
+				dirs[x * RESOLUTION + y] = dir;
+			}
+		}
+	}
+
+	LLColor3 smear(F32 val)
+	{
+		return LLColor3(val, val, val);
+	}
+
+	LLColor3 component_exp(const LLColor3& v)
+	{
+		return LLColor3(exp(v.mV[0]), exp(v.mV[1]), exp(v.mV[2]));
+	}
+
+	LLColor3 component_sqrt(const LLColor3& v)
+	{
+		return LLColor3(sqrt(v.mV[0]), sqrt(v.mV[1]), sqrt(v.mV[2]));
+	}
+
+	// LLVOSky::calcSkyColorInDir() and the calcSkyColorWLVert() and
+	// calcSkyColorWLFrag() it calls, as they were
+	LLColor4 reference_color(const LLSkyEval::Params& p, const LLVector3& dir, bool is_shiny)
+	{
+		F32 saturation = 0.3f;
+		if (dir.mV[VZ] < -0.02f)
+		{
+			LLColor4 col = LLColor4(llmax(p.mFogColor.mV[0],0.2f), llmax(p.mFogColor.mV[1],0.2f), llmax(p.mFogColor.mV[2],0.22f),0.f);
+			if (is_shiny)
+			{
+				LLColor3 desat_fog = p.mFogColor;
+				F32 brightness = desat_fog.brightness();
+				if (brightness < 0.15f)
+				{
+					brightness = 0.15f;
+					desat_fog = smear(0.15f);
+				}
+				LLColor3 greyscale = smear(brightness);
+				desat_fog = desat_fog * saturation + greyscale * (1.0f - saturation);
+				col = LLColor4(p.mWindLightShaders ? desat_fog * 0.5f : desat_fog, 0.f);
+			}
+			float x = 1.0f-fabsf(-0.1f-dir.mV[VZ]);
+			x *= x;
+			col.mV[0] *= x*x;
+			col.mV[1] *= powf(x, 2.5f);
+			col.mV[2] *= x*x*x;
+			return col;
+		}
+
+		LLVector3 Pn = LLVector3(-dir[1] , -dir[2], -dir[0]);
+		const LLVector3& lightnorm = p.mLightNorm;
+
+		F32 phi = acos(Pn[1]);
+		F32 sinA = sin(F_PI - phi);
+		F32 Plen = p.mDomeRadius * sin(F_PI + phi + asin(p.mDomeOffsetRatio * sinA)) / sinA;
+		Pn *= Plen;
+		if (Pn[1] > 0.f)
+		{
+			Pn *= (p.mMaxY / Pn[1]);
+		}
+		else
+		{
+			Pn *= (-32000.f / Pn[1]);
+		}
+		Plen = Pn.length();
+		Pn /= Plen;
+
+		LLColor3 sunlight = p.mSunlightColor;
+		LLColor3 light_atten =
+			(p.mBlueDensity * 1.0 + smear(p.mHazeDensity * 0.25f)) * (p.mDensityMultiplier * p.mMaxY);
+		LLColor3 temp2(0.f, 0.f, 0.f);
+		LLColor3 temp1 = p.mBlueDensity + smear(p.mHazeDensity);
+		LLColor3 blue_weight(p.mBlueDensity.mV[0] / temp1.mV[0], p.mBlueDensity.mV[1] / temp1.mV[1], p.mBlueDensity.mV[2] / temp1.mV[2]);
+		LLColor3 haze_weight(p.mHazeDensity / temp1.mV[0], p.mHazeDensity / temp1.mV[1], p.mHazeDensity / temp1.mV[2]);
+
+		temp2.mV[1] = llmax(F_APPROXIMATELY_ZERO, llmax(0.f, Pn[1]) * 1.0f + lightnorm[1] );
+		temp2.mV[1] = 1.f / temp2.mV[1];
+		sunlight *= component_exp((light_atten * -1.f) * temp2.mV[1]);
+		temp2.mV[2] = Plen * p.mDensityMultiplier;
+		temp1 = component_exp((temp1 * -1.f) * temp2.mV[2]);
+
+		temp2.mV[0] = Pn * lightnorm;
+		temp2.mV[0] = 1.f - temp2.mV[0];
+		temp2.mV[0] = llmax(temp2.mV[0], .001f);
+		temp2.mV[0] *= p.mGlow.mV[0];
+		temp2.mV[0] = pow(temp2.mV[0], p.mGlow.mV[2]);
+		temp2.mV[0] += .25f;
+
+		LLColor3 haze_color = (p.mBlueHorizon * blue_weight * (sunlight + p.mAmbient)
+					+ (p.mHazeHorizon * haze_weight) * (sunlight * temp2.mV[0] + p.mAmbient));
+		LLColor3 tmpAmbient = p.mAmbient + (LLColor3::white - p.mAmbient) * p.mCloudShadow * 0.5f;
+		sunlight *= (1.f - p.mCloudShadow);
+		LLColor3 additiveColorBelowCloud = (p.mBlueHorizon * blue_weight * (sunlight + tmpAmbient)
+					+ (p.mHazeHorizon * haze_weight) * (sunlight * temp2.mV[0] + tmpAmbient));
+		haze_color *= LLColor3::white - temp1;
+
+		sunlight = p.mSunlightColor;
+		temp2.mV[1] = llmax(0.f, lightnorm[1] * 2.f);
+		temp2.mV[1] = 1.f / temp2.mV[1];
+		sunlight *= component_exp((light_atten * -1.f) * temp2.mV[1]);
+
+		temp1 = component_sqrt(temp1);
+		haze_color += (additiveColorBelowCloud - haze_color) * (LLColor3::white - component_sqrt(temp1));
+
+		if (Pn[1] < 0.f)
+		{
+			LLColor3 dark_brown(0.082f, 0.076f, 0.066f);
+			LLColor3 brown(0.430f, 0.386f, 0.322f);
+			LLColor3 sky_lighting = sunlight + p.mAmbient;
+			F32 haze_brightness = haze_color.brightness();
+			if (Pn[1] < -0.05f)
+			{
+				haze_color = (dark_brown + (brown - dark_brown) * (-Pn[1] * 0.9f)) * sky_lighting * haze_brightness;
+			}
+			if (Pn[1] > -0.1f)
+			{
+				LLColor3 grey = LLColor3::white * haze_brightness;
+				haze_color = grey + (haze_color - grey) * fabs((Pn[1] + 0.05f) * -20.f);
+			}
+		}
+
+		LLColor3 sky_color = haze_color;
+		if (!p.mWindLightShaders)
+		{
+			LLColor3 color1 = haze_color * 2.0f;
+			color1.set(llclamp(color1.mV[0], 0.f, 1.f), llclamp(color1.mV[1], 0.f, 1.f), llclamp(color1.mV[2], 0.f, 1.f));
+			color1 = smear(1.f) - color1;
+			sky_color = smear(1.f) - color1;
+		}
+		if (is_shiny)
+		{
+			F32 brightness = sky_color.brightness();
+			LLColor3 greyscale = smear(brightness);
+			sky_color = sky_color * saturation + greyscale * (1.0f - saturation);
+			sky_color *= (0.5f + 0.5f * brightness);
+		}
+		return LLColor4(sky_color, 0.0f);
+	}
+
+	// Largest difference relative to the larger of 1 and the reference
+	F32 color_error(const LLColor4& color, const LLColor4& reference)
+	{
+		F32 error = 0.f;
+		for (S32 c = 0; c < 4; ++c)
+		{
+			error = llmax(error, fabsf(color.mV[c] - reference.mV[c]) / llmax(1.f, fabsf(reference.mV[c])));
+		}
+		return error;
+	}
+
+	class SkyFaceJob : public LLJobPool::Job
+	{
+	public:
+		SkyFaceJob(const LLSkyEval& eval, std::vector<LLVector3>* dirs, std::vector<LLColor4>* sky,
+				   std::vector<LLColor4>* shiny)
+			: mEval(eval), mDirs(dirs), mSky(sky), mShiny(shiny)
+		{
+		}
+		/*virtual*/ void run(S32 side)
+		{
+			mEval.evaluate(&mDirs[side][0], FACE_TEXELS, &mSky[side][0], &mShiny[side][0]);
+		}
+	private:
+		const LLSkyEval& mEval;
+		std::vector<LLVector3>* mDirs;
+		std::vector<LLColor4>* mSky;
+		std::vector<LLColor4>* mShiny;
+	};
+}
+
+namespace tut
+{
+	struct LLSkyEvalTestData
+	{
+	};
+
+	typedef test_group<LLSkyEvalTestData> LLSkyEvalTestGroup;
+	typedef LLSkyEvalTestGroup::object LLSkyEvalTestObject;
+	LLSkyEvalTestGroup skyEvalTestGroup("LLSkyEval");
+
+	template<> template<>
+	void LLSkyEvalTestObject::test<1>()
+		// every texel of the six faces matches the scalar model, by day,
+		// at sunset and at night, with and without the WindLight shaders
+	{
+		const F32 SUN_Y[] = { 0.9f, 0.3f, 0.02f, -0.5f };
+		std::vector<LLVector3> dirs;
+		std::vector<LLColor4> sky(FACE_TEXELS);
+		std::vector<LLColor4> shiny(FACE_TEXELS);
+		LLSkyEval eval;
+		F32 max_error = 0.f;
+		for (S32 shaders = 0; shaders < 2; ++shaders)
+		{
+			for (size_t sun = 0; sun < LL_ARRAY_SIZE(SUN_Y); ++sun)
+			{
+				const LLSkyEval::Params params = sky_params(SUN_Y[sun], shaders != 0);
+				eval.setParams(params);
+				for (S32 side = 0; side < 6; ++side)
+				{
+					face_dirs(side, dirs);
+					eval.evaluate(&dirs[0], FACE_TEXELS, &sky[0], &shiny[0]);
+					for (S32 i = 0; i < FACE_TEXELS; ++i)
+					{
+						F32 error = color_error(sky[i], reference_color(params, dirs[i], false));
+						error = llmax(error, color_error(shiny[i], reference_color(params, dirs[i], true)));
+						max_error = llmax(max_error, error);
+					}
+				}
+			}
+		}
+		ensure("sky colors match the scalar model", max_error < 1.0e-3f);
+	}
+
+	template<> template<>
+	void LLSkyEvalTestObject::test<2>()
+		// a batch gives the same colors as its directions one at a time,
+		// whatever its length, and shiny may be left out
+	{
+		LLSkyEval eval;
+		eval.setParams(sky_params(0.5f, true));
+		std::vector<LLVector3> dirs;
+		face_dirs(2, dirs);
+
+		const S32 COUNT = 11;
+		LLColor4 sky[COUNT];
+		LLColor4 shiny[COUNT];
+		LLColor4 sky_only[COUNT];
+		eval.evaluate(&dirs[100], COUNT, sky, shiny);
+		eval.evaluate(&dirs[100], COUNT, sky_only, NULL);
+		for (S32 i = 0; i < COUNT; ++i)
+		{
+			LLColor4 one_sky;
+			LLColor4 one_shiny;
+			eval.evaluate(&dirs[100 + i], 1, &one_sky, &one_shiny);
+			ensure("sky matches alone", color_error(sky[i], one_sky) < 1.0e-3f);
+			ensure("shiny matches alone", color_error(shiny[i], one_shiny) < 1.0e-3f);
+			ensure("sky without shiny", sky[i] == sky_only[i]);
+		}
+	}
+
+	template<> template<>
+	void LLSkyEvalTestObject::test<3>()
+		// the six faces evaluated on a job pool, as LLVOSky does, come out
+		// as they do one face at a time on the caller
+	{
+		LLSkyEval eval;
+		eval.setParams(sky_params(0.3f, true));
+		std::vector<LLVector3> dirs[6];
+		std::vector<LLColor4> sky[6];
+		std::vector<LLColor4> shiny[6];
+		std::vector<LLColor4> pooled_sky[6];
+		std::vector<LLColor4> pooled_shiny[6];
+		for (S32 side = 0; side < 6; ++side)
+		{
+			face_dirs(side, dirs[side]);
+			sky[side].resize(FACE_TEXELS);
+			shiny[side].resize(FACE_TEXELS);
+			pooled_sky[side].resize(FACE_TEXELS);
+			pooled_shiny[side].resize(FACE_TEXELS);
+		}
+
+		SkyFaceJob job(eval, dirs, sky, shiny);
+		for (S32 side = 0; side < 6; ++side)
+		{
+			job.run(side);
+		}
+
+		LLJobPool pool("sky", 3);
+		SkyFaceJob pooled_job(eval, dirs, pooled_sky, pooled_shiny);
+		pool.run(pooled_job, 6);
+
+		for (S32 side = 0; side < 6; ++side)
+		{
+			ensure("same sky colors", sky[side] == pooled_sky[side]);
+			ensure("same shiny colors", shiny[side] == pooled_shiny[side]);
+		}
+	}
+}
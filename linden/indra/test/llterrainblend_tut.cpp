@@ -0,0 +1,323 @@
+/**
+ * @file llterrainblend_tut.cpp
+ * @brief LLTerrainBlend tests against the texel by texel compositing loop.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#include <tut/tut.hpp>
+#include "linden_common.h"
+#include "lltut.h"
+
+#include "llmath.h"
+#include "llterrainblend.h"
+
+namespace
+{
+	const S32 GRID_WIDTH = 256;		// composition values per region edge, 1 meter apart
+	const S32 DETAIL_SIZE = 128;
+	const F32 TEX_SCALE = 16.f;		// detail texture repeats per region
+	const U8 UNWRITTEN = 0xA5;
+
+	struct Terrain
+	{
+		std::vector<F32> mComposition;
+		std::vector<U8> mDetail[LLTerrainBlend::NUM_DETAILS];
+
+		Terrain()
+		{
+			mComposition.resize(GRID_WIDTH*GRID_WIDTH);
+			for (S32 j = 0; j < GRID_WIDTH; j++)
+			{
+				for (S32 i = 0; i < GRID_WIDTH; i++)
+				{
+					F32 value = 1.5f + 1.4f*sinf(i*0.07f)*cosf(j*0.05f) + 0.2f*((F32)rand()/(F32)RAND_MAX - 0.5f);
+					mComposition[j*GRID_WIDTH + i] = llclamp(value, 0.f, 3.f);
+				}
+			}
+			for (S32 d = 0; d < LLTerrainBlend::NUM_DETAILS; d++)
+			{
+				mDetail[d].resize(DETAIL_SIZE*DETAIL_SIZE*LLTerrainBlend::COMPONENTS);
+				for (size_t k = 0; k < mDetail[d].size(); k++)
+				{
+					mDetail[d][k] = (U8)(rand() & 0xff);
+				}
+			}
+		}
+
+		// LLViewerLayer::getValueScaled()
+		F32 getValueScaled(F32 x, F32 y) const
+		{
+			S32 x1, x2, y1, y2;
+			F32 x_frac, y_frac;
+
+			x_frac = x;
+			x1 = llfloor(x_frac);
+			x2 = x1 + 1;
+			x_frac -= x1;
+
+			y_frac = y;
+			y1 = llfloor(y_frac);
+			y2 = y1 + 1;
+			y_frac -= y1;
+
+			x1 = llmax(0, llmin(GRID_WIDTH-1, x1));
+			x2 = llmax(0, llmin(GRID_WIDTH-1, x2));
+			y1 = llmax(0, llmin(GRID_WIDTH-1, y1));
+			y2 = llmax(0, llmin(GRID_WIDTH-1, y2));
+
+			F32 row1_left  = mComposition[y1*GRID_WIDTH + x1];
+			F32 row1_right = mComposition[y1*GRID_WIDTH + x2];
+			F32 row2_left  = mComposition[y2*GRID_WIDTH + x1];
+			F32 row2_right = mComposition[y2*GRID_WIDTH + x2];
+
+			F32 row1_interp = row1_left - x_frac * (row1_left - row1_right);
+			F32 row2_interp = row2_left - x_frac * (row2_left - row2_right);
+			return row1_interp - y_frac * (row1_interp - row2_interp);
+		}
+	};
+
+	struct Target
+	{
+		S32 mWidth;
+		F32 mRatio;			// meters per texel
+		F32 mDetailStride;	// detail texels per texel
+		std::vector<U8> mData;
+
+		Target(S32 width)
+			: mWidth(width),
+			  mRatio((F32)GRID_WIDTH / (F32)width),
+			  mDetailStride(((F32)DETAIL_SIZE / TEX_SCALE)*((F32)GRID_WIDTH / (F32)width)),
+			  mData(width*width*LLTerrainBlend::COMPONENTS, UNWRITTEN)
+		{
+		}
+	};
+
+	// LLVLComposition::generateTexture()'s texel loop, as it was
+	void composite_texels(const Terrain& terrain, const S32* data_size, Target& target,
+						  S32 tex_x_begin, S32 tex_y_begin, S32 tex_x_end, S32 tex_y_end)
+	{
+		const S32 st_comps = 3;
+		const S32 st_width = DETAIL_SIZE;
+		const S32 st_height = DETAIL_SIZE;
+		const U32 tex_comps = 3;
+		const U32 tex_stride = target.mWidth * tex_comps;
+		const F32 st_x_stride = target.mDetailStride;
+		const F32 st_y_stride = target.mDetailStride;
+		U8* rawp = &target.mData[0];
+
+		F32 sti, stj;
+		S32 st_offset;
+		stj = (tex_y_begin * st_y_stride) - st_height*(llfloor((tex_y_begin * st_y_stride)/st_height));
+		for (S32 j = tex_y_begin; j < tex_y_end; j++)
+		{
+			U32 offset = j * tex_stride + tex_x_begin * tex_comps;
+			sti = (tex_x_begin * st_x_stride) - st_width*((U32)(tex_x_begin * st_x_stride)/st_width);
+			for (S32 i = tex_x_begin; i < tex_x_end; i++)
+			{
+				S32 tex0, tex1;
+				F32 composition = terrain.getValueScaled(i*target.mRatio, j*target.mRatio);
+
+				tex0 = llfloor( composition );
+				tex0 = llclamp(tex0, 0, 3);
+				composition -= tex0;
+				tex1 = tex0 + 1;
+				tex1 = llclamp(tex1, 0, 3);
+
+				st_offset = (lltrunc(sti) + lltrunc(stj)*st_width) * st_comps;
+				for (U32 k = 0; k < tex_comps; k++)
+				{
+					if (st_offset < data_size[tex0] && st_offset < data_size[tex1])
+					{
+						F32 a = terrain.mDetail[tex0][st_offset];
+						F32 b = terrain.mDetail[tex1][st_offset];
+						rawp[ offset ] = (U8)lltrunc( a + composition * (b - a) );
+					}
+					offset++;
+					st_offset++;
+				}
+
+				sti += st_x_stride;
+				if (sti >= st_width)
+				{
+					sti -= st_width;
+				}
+			}
+
+			stj += st_y_stride;
+			if (stj >= st_height)
+			{
+				stj -= st_height;
+			}
+		}
+	}
+
+	void setup_params(const Terrain& terrain, const S32* data_size, const Target& target,
+					  LLTerrainBlend::Params& params)
+	{
+		for (S32 d = 0; d < LLTerrainBlend::NUM_DETAILS; d++)
+		{
+			params.mDetail[d] = &terrain.mDetail[d][0];
+			params.mDetailDataSize[d] = data_size[d];
+		}
+		params.mDetailSize = DETAIL_SIZE;
+		params.mDetailStrideX = target.mDetailStride;
+		params.mDetailStrideY = target.mDetailStride;
+		params.mComposition = &terrain.mComposition[0];
+		params.mCompX = 0;
+		params.mCompY = 0;
+		params.mCompRowLength = GRID_WIDTH;
+		params.mCompWidth = GRID_WIDTH;
+		params.mCompScaleInv = 1.f;
+		params.mTexRatioX = target.mRatio;
+		params.mTexRatioY = target.mRatio;
+	}
+
+	// As LLVLComposition hands a tile to the compositing thread, with a
+	// copy of only the composition values it reads
+	void blend_tile(LLTerrainBlend& blend, const Terrain& terrain, const S32* data_size, Target& target,
+					S32 x_begin, S32 y_begin, S32 x_end, S32 y_end)
+	{
+		LLTerrainBlend::Params params;
+		setup_params(terrain, data_size, target, params);
+
+		S32 comp_x_begin, comp_y_begin, comp_x_end, comp_y_end;
+		LLTerrainBlend::getCompositionBounds(params, x_begin, y_begin, x_end, y_end,
+											 comp_x_begin, comp_y_begin, comp_x_end, comp_y_end);
+		S32 row_length = comp_x_end - comp_x_begin;
+		std::vector<F32> composition(row_length*(comp_y_end - comp_y_begin));
+		for (S32 j = comp_y_begin; j < comp_y_end; j++)
+		{
+			memcpy(&composition[(j - comp_y_begin)*row_length],
+				   &terrain.mComposition[j*GRID_WIDTH + comp_x_begin], row_length*sizeof(F32));
+		}
+		params.mComposition = &composition[0];
+		params.mCompX = comp_x_begin;
+		params.mCompY = comp_y_begin;
+		params.mCompRowLength = row_length;
+
+		const S32 stride = target.mWidth*LLTerrainBlend::COMPONENTS;
+		blend.blend(params, x_begin, y_begin, x_end, y_end,
+					&target.mData[y_begin*stride + x_begin*LLTerrainBlend::COMPONENTS], stride);
+	}
+}
+
+namespace tut
+{
+	struct LLTerrainBlendTestData
+	{
+		LLTerrainBlend mBlend;
+	};
+
+	typedef test_group<LLTerrainBlendTestData> LLTerrainBlendTestGroup;
+	typedef LLTerrainBlendTestGroup::object LLTerrainBlendTestObject;
+	LLTerrainBlendTestGroup terrainBlendTestGroup("LLTerrainBlend");
+
+	template<> template<>
+	void LLTerrainBlendTestObject::test<1>()
+		// patch by patch, from copied composition values, the texture
+		// comes out as the texel loop made it, at several texture sizes
+	{
+		srand(21);
+		Terrain terrain;
+		S32 data_size[LLTerrainBlend::NUM_DETAILS];
+		for (S32 d = 0; d < LLTerrainBlend::NUM_DETAILS; d++)
+		{
+			data_size[d] = (S32)terrain.mDetail[d].size();
+		}
+
+		const S32 PATCHES_PER_EDGE = 16;
+		for (S32 tex_width = 128; tex_width <= 512; tex_width *= 2)
+		{
+			Target expected(tex_width);
+			Target actual(tex_width);
+			const S32 tile = tex_width / PATCHES_PER_EDGE;
+			for (S32 y = 0; y < tex_width; y += tile)
+			{
+				for (S32 x = 0; x < tex_width; x += tile)
+				{
+					composite_texels(terrain, data_size, expected, x, y, x + tile, y + tile);
+					blend_tile(mBlend, terrain, data_size, actual, x, y, x + tile, y + tile);
+				}
+			}
+			ensure("same texels", expected.mData == actual.mData);
+		}
+	}
+
+	template<> template<>
+	void LLTerrainBlendTestObject::test<2>()
+		// odd tile sizes, and detail data too short for the texels it is
+		// asked for, which are left alone
+	{
+		srand(22);
+		Terrain terrain;
+		S32 data_size[LLTerrainBlend::NUM_DETAILS];
+		for (S32 d = 0; d < LLTerrainBlend::NUM_DETAILS; d++)
+		{
+			data_size[d] = (S32)terrain.mDetail[d].size();
+		}
+		data_size[2] -= DETAIL_SIZE*LLTerrainBlend::COMPONENTS*5 + 1;
+
+		Target expected(256);
+		Target actual(256);
+		composite_texels(terrain, data_size, expected, 3, 5, 250, 251);
+		blend_tile(mBlend, terrain, data_size, actual, 3, 5, 250, 251);
+		ensure("same texels", expected.mData == actual.mData);
+
+		bool skipped = false;
+		for (size_t k = 0; k < actual.mData.size() && !skipped; k++)
+		{
+			const S32 texel = (S32)k / LLTerrainBlend::COMPONENTS;
+			const S32 x = texel % 256;
+			const S32 y = texel / 256;
+			skipped = (x >= 3 && x < 250 && y >= 5 && y < 251 && actual.mData[k] == UNWRITTEN);
+		}
+		ensure("some texels skipped", skipped);
+	}
+
+	template<> template<>
+	void LLTerrainBlendTestObject::test<3>()
+		// a region's whole surface texture, texel loop against LLTerrainBlend
+	{
+		srand(23);
+		Terrain terrain;
+		S32 data_size[LLTerrainBlend::NUM_DETAILS];
+		for (S32 d = 0; d < LLTerrainBlend::NUM_DETAILS; d++)
+		{
+			data_size[d] = (S32)terrain.mDetail[d].size();
+		}
+
+		const S32 TEX_WIDTH = 256;
+		Target expected(TEX_WIDTH);
+		Target actual(TEX_WIDTH);
+		composite_texels(terrain, data_size, expected, 0, 0, TEX_WIDTH, TEX_WIDTH);
+		blend_tile(mBlend, terrain, data_size, actual, 0, 0, TEX_WIDTH, TEX_WIDTH);
+		ensure("same texels", expected.mData == actual.mData);
+	}
+}
@@ -0,0 +1,279 @@
+/**
+ * @file lltextureserver.cpp
+ * @brief A local stand-in for the HTTP texture service.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#include "linden_common.h"
+#include "lltextureserver.h"
+
+#include <sstream>
+
+#include "llformat.h"
+#include "llstl.h"
+#include "llstring.h"
+#include "llthread.h"
+#include "lltimer.h"
+
+// How often blocked threads look to see if the server is going away
+static const apr_interval_time_t POLL_USECS = 100000;
+
+class LLTextureServerThread : public LLThread
+{
+public:
+	LLTextureServerThread(LLTextureServer& server)
+		: LLThread("Texture server"), mServer(server)
+	{
+	}
+
+	/*virtual*/ void run()
+	{
+		while (!isQuitting())
+		{
+			// The sockets are made and destroyed here, on the thread whose
+			// pool they use.
+			apr_status_t status;
+			LLSocket::ptr_t socket = LLSocket::create(status, mServer.mListenSocket);
+			if (!socket)
+			{
+				// The listen socket does not block
+				ms_sleep(1);
+				continue;
+			}
+			mServer.mConnections++;
+			serve(socket->getSocket());
+		}
+	}
+
+private:
+	void serve(apr_socket_t* socket)
+	{
+		apr_socket_timeout_set(socket, POLL_USECS);
+		std::string input;
+		char buffer[4096];
+		while (!isQuitting())
+		{
+			apr_size_t len = sizeof(buffer);
+			apr_status_t status = apr_socket_recv(socket, buffer, &len);
+			input.append(buffer, len);
+			std::string::size_type end;
+			while ((end = input.find("\r\n\r\n")) != std::string::npos)
+			{
+				std::string request = input.substr(0, end + 4);
+				input.erase(0, end + 4);
+				if (!mServer.respond(request, socket))
+				{
+					return;
+				}
+			}
+			if (status != APR_SUCCESS && !APR_STATUS_IS_TIMEUP(status) && !APR_STATUS_IS_EAGAIN(status))
+			{
+				// Closed by the client
+				return;
+			}
+		}
+	}
+
+	LLTextureServer& mServer;
+};
+
+static bool send_all(apr_socket_t* socket, const std::string& data)
+{
+	const char* next = data.data();
+	apr_size_t left = data.size();
+	while (left > 0)
+	{
+		apr_size_t len = left;
+		apr_status_t status = apr_socket_send(socket, next, &len);
+		if (status != APR_SUCCESS && !APR_STATUS_IS_TIMEUP(status) && !APR_STATUS_IS_EAGAIN(status))
+		{
+			return false;
+		}
+		next += len;
+		left -= len;
+	}
+	return true;
+}
+
+LLTextureServer::LLTextureServer(U16 port, S32 latency_ms, S32 max_connections)
+	: mPort(port),
+	  mMaxConnections(max_connections)
+{
+	mLatencyMS = latency_ms;
+	mConnections = 0;
+	mRequests = 0;
+}
+
+LLTextureServer::~LLTextureServer()
+{
+	// ~LLThread() stops each thread first
+	for_each(mThreads.begin(), mThreads.end(), DeletePointer());
+	mThreads.clear();
+	mListenSocket.reset();
+}
+
+S32 LLTextureServer::addTexture(const std::string& data)
+{
+	llassert_always(mThreads.empty());
+	mTextures.push_back(data);
+	return (S32)mTextures.size() - 1;
+}
+
+S32 LLTextureServer::addMadeUpTexture(S32 width, S32 height, S32 size)
+{
+	const U8 components = 3;
+	std::string data;
+	data.reserve(llmax(size, 64));
+
+	// SOC, then SIZ with one tile and 8 bit unsigned components
+	const U8 marker[] = { 0xff, 0x4f, 0xff, 0x51 };
+	data.append((const char*)marker, sizeof(marker));
+	U32 fields[] = { (U32)width, (U32)height, 0, 0, (U32)width, (U32)height, 0, 0 };
+	U16 length = 38 + 3 * components;
+	data += (char)(length >> 8);
+	data += (char)(length & 0xff);
+	data += (char)0;
+	data += (char)0;
+	for (S32 i = 0; i < 8; ++i)
+	{
+		for (S32 shift = 24; shift >= 0; shift -= 8)
+		{
+			data += (char)((fields[i] >> shift) & 0xff);
+		}
+	}
+	data += (char)0;
+	data += (char)components;
+	for (U8 i = 0; i < components; ++i)
+	{
+		data += (char)7;
+		data += (char)1;
+		data += (char)1;
+	}
+
+	// Noise, the same for the same index, then EOC
+	U32 seed = 2654435761u * (U32)(mTextures.size() + 1);
+	while ((S32)data.size() < size - 2)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		data += (char)((seed >> 24) & 0x7f);
+	}
+	data += (char)0xff;
+	data += (char)0xd9;
+	return addTexture(data);
+}
+
+bool LLTextureServer::start()
+{
+	mListenSocket = LLSocket::create(LLSocket::STREAM_TCP, mPort);
+	if (!mListenSocket)
+	{
+		llwarns << "Texture server could not listen on port " << mPort << llendl;
+		return false;
+	}
+	for (S32 i = 0; i < mMaxConnections; ++i)
+	{
+		LLThread* thread = new LLTextureServerThread(*this);
+		mThreads.push_back(thread);
+		thread->start();
+	}
+	return true;
+}
+
+std::string LLTextureServer::getURL(S32 index) const
+{
+	return llformat("http://127.0.0.1:%d/texture/%d", (S32)mPort, index);
+}
+
+bool LLTextureServer::respond(const std::string& request, apr_socket_t* socket)
+{
+	mRequests++;
+	std::string header(request);
+	LLStringUtil::toLower(header);
+
+	S32 index = -1;
+	const std::string GET_TEXTURE("get /texture/");
+	if (header.compare(0, GET_TEXTURE.size(), GET_TEXTURE) == 0 && isdigit(header[GET_TEXTURE.size()]))
+	{
+		index = atoi(header.c_str() + GET_TEXTURE.size());
+	}
+	bool keep_alive = header.find(" http/1.1\r\n") != std::string::npos &&
+					  header.find("\r\nconnection: close") == std::string::npos;
+
+	ms_sleep(mLatencyMS);
+
+	std::ostringstream response;
+	std::string body;
+	if (index < 0 || index >= getNumTextures())
+	{
+		response << "HTTP/1.1 404 Not Found\r\n";
+	}
+	else
+	{
+		const std::string& texture = mTextures[index];
+		S32 size = (S32)texture.size();
+		std::string::size_type range = header.find("\r\nrange: bytes=");
+		if (range == std::string::npos)
+		{
+			body = texture;
+			response << "HTTP/1.1 200 OK\r\n";
+		}
+		else
+		{
+			// "first-last" or "first-"
+			const char* spec = header.c_str() + range + 15;
+			S32 first = atoi(spec);
+			S32 last = size - 1;
+			const char* dash = strchr(spec, '-');
+			if (dash && isdigit(dash[1]))
+			{
+				last = llmin(last, atoi(dash + 1));
+			}
+			if (first >= size || first > last)
+			{
+				response << "HTTP/1.1 416 Requested Range Not Satisfiable\r\n"
+						 << "Content-Range: bytes */" << size << "\r\n";
+			}
+			else
+			{
+				body = texture.substr(first, last - first + 1);
+				response << "HTTP/1.1 206 Partial Content\r\n"
+						 << "Content-Range: bytes " << first << "-" << last << "/" << size << "\r\n";
+			}
+		}
+		response << "Content-Type: image/x-j2c\r\n";
+	}
+	response << "Content-Length: " << body.size() << "\r\n";
+	if (!keep_alive)
+	{
+		response << "Connection: close\r\n";
+	}
+	response << "\r\n" << body;
+	return send_all(socket, response.str()) && keep_alive;
+}
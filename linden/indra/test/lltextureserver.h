@@ -0,0 +1,105 @@
+/**
+ * @file lltextureserver.h
+ * @brief A local stand-in for the HTTP texture service.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#ifndef LL_LLTEXTURESERVER_H
+#define LL_LLTEXTURESERVER_H
+
+#include <string>
+#include <vector>
+
+#include "llapr.h"
+#include "lliosocket.h"
+
+class LLThread;
+
+/**
+ * @brief Serves textures over HTTP/1.1 on a local port, for benchmarking
+ * texture fetching.
+ *
+ * GET /texture/<index> returns the texture, or the part of it asked for
+ * with a Range header, the way the simulator's GetTexture capability
+ * does.  Each response is sent latency milliseconds after its request
+ * arrives.  Connections are kept alive until the client closes them, and
+ * each is served by one of max_connections threads; further connections
+ * wait to be accepted.
+ */
+class LLTextureServer
+{
+public:
+	LLTextureServer(U16 port, S32 latency_ms, S32 max_connections);
+	~LLTextureServer();
+
+	/**
+	 * @brief Adds a texture, such as a J2C file read from disk, and
+	 * returns its index.  Textures can only be added before start().
+	 */
+	S32 addTexture(const std::string& data);
+
+	/**
+	 * @brief Adds a texture of size bytes: a J2C main header for a
+	 * width x height image followed by noise.  It will not decode.
+	 */
+	S32 addMadeUpTexture(S32 width, S32 height, S32 size);
+
+	/**
+	 * @brief Starts listening.  Returns false if the port is taken.
+	 */
+	bool start();
+
+	std::string getURL(S32 index) const;
+	S32 getNumTextures() const { return (S32)mTextures.size(); }
+	const std::string& getTexture(S32 index) const { return mTextures[index]; }
+
+	void setLatency(S32 latency_ms) { mLatencyMS = latency_ms; }
+
+	// Totals since start()
+	S32 getConnections() { return mConnections; }
+	S32 getRequests() { return mRequests; }
+
+private:
+	friend class LLTextureServerThread;
+
+	// Answers one request.  Returns false if the connection should close.
+	bool respond(const std::string& request, apr_socket_t* socket);
+
+	U16 mPort;
+	LLAtomicS32 mLatencyMS;
+	S32 mMaxConnections;
+	std::vector<std::string> mTextures;
+	LLSocket::ptr_t mListenSocket;
+	std::vector<LLThread*> mThreads;
+	LLAtomicS32 mConnections;
+	LLAtomicS32 mRequests;
+};
+
+#endif // LL_LLTEXTURESERVER_H
@@ -0,0 +1,235 @@
+/** 
+ * @file llvfs_tut.cpp
+ * @brief Tests for mapped, buffered and concurrent LLVFS reads.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ * 
+ * Copyright (c) 2009, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "lltut.h"
+
+#include "lldir.h"
+#include "llfile.h"
+#include "llthread.h"
+#include "lltimer.h"
+#include "llvfile.h"
+#include "llvfs.h"
+
+namespace tut
+{
+	const S32 VFS_TUT_FILE_COUNT = 64;
+	const S32 VFS_TUT_FILE_SIZE = 32 * 1024;
+	const S32 VFS_TUT_READ_PASSES = 20;
+	const S32 VFS_TUT_READERS = 4;
+
+	// Fills buffer with a pattern that depends on the file index
+	static void fill_pattern(U8* buffer, S32 size, S32 index)
+	{
+		for (S32 i = 0; i < size; ++i)
+		{
+			buffer[i] = (U8)((i * 7 + index * 13) & 0xff);
+		}
+	}
+
+	// Reads every test file through LLVFile, VFS_TUT_READ_PASSES times
+	class VFSReader : public LLThread
+	{
+	public:
+		VFSReader(LLVFS* vfs, const std::vector<LLUUID>& ids)
+			: LLThread("vfs reader"), mVFS(vfs), mIDs(ids), mErrors(0)
+		{
+		}
+
+		/*virtual*/ void run()
+		{
+			std::vector<U8> expected(VFS_TUT_FILE_SIZE);
+			std::vector<U8> buffer(VFS_TUT_FILE_SIZE);
+			for (S32 pass = 0; pass < VFS_TUT_READ_PASSES; ++pass)
+			{
+				for (S32 i = 0; i < (S32)mIDs.size(); ++i)
+				{
+					LLVFile file(mVFS, mIDs[i], LLAssetType::AT_NOTECARD, LLVFile::READ);
+					file.read(&buffer[0], VFS_TUT_FILE_SIZE);	/* Flawfinder: ignore */
+					fill_pattern(&expected[0], VFS_TUT_FILE_SIZE, i);
+					if (file.getLastBytesRead() != VFS_TUT_FILE_SIZE || buffer != expected)
+					{
+						++mErrors;
+					}
+				}
+			}
+		}
+
+		LLVFS* mVFS;
+		std::vector<LLUUID> mIDs;
+		S32 mErrors;
+	};
+
+	struct vfs_data
+	{
+		vfs_data()
+		{
+			static bool initialized = false;
+			if (!initialized)
+			{
+				LLVFile::initClass();
+				initialized = true;
+			}
+			std::string base = gDirUtilp->getTempFilename();
+			mIndexFile = base + ".index.db2";
+			mDataFile = base + ".data.db2";
+			for (S32 i = 0; i < VFS_TUT_FILE_COUNT; ++i)
+			{
+				mIDs.push_back(LLUUID::generateNewID());
+			}
+		}
+
+		~vfs_data()
+		{
+			LLVFS::setUseMappedReads(TRUE);
+			LLFile::remove(mIndexFile);
+			LLFile::remove(mDataFile);
+		}
+
+		LLVFS* createVFS()
+		{
+			LLVFS* vfs = new LLVFS(mIndexFile, mDataFile, FALSE, 16 * 1024 * 1024, FALSE);
+			std::vector<U8> buffer(VFS_TUT_FILE_SIZE);
+			for (S32 i = 0; i < VFS_TUT_FILE_COUNT; ++i)
+			{
+				fill_pattern(&buffer[0], VFS_TUT_FILE_SIZE, i);
+				LLVFile::writeFile(&buffer[0], VFS_TUT_FILE_SIZE, vfs, mIDs[i], LLAssetType::AT_NOTECARD);
+			}
+			return vfs;
+		}
+
+		// Returns the number of bad reads of VFS_TUT_READERS concurrent readers
+		S32 runConcurrentReads(LLVFS* vfs)
+		{
+			std::vector<VFSReader*> readers;
+			for (S32 i = 0; i < VFS_TUT_READERS; ++i)
+			{
+				readers.push_back(new VFSReader(vfs, mIDs));
+				readers.back()->start();
+			}
+			S32 errors = 0;
+			for (S32 i = 0; i < VFS_TUT_READERS; ++i)
+			{
+				while (!readers[i]->isStopped())
+				{
+					ms_sleep(1);
+				}
+				errors += readers[i]->mErrors;
+				delete readers[i];
+			}
+			return errors;
+		}
+
+		std::string mIndexFile;
+		std::string mDataFile;
+		std::vector<LLUUID> mIDs;
+	};
+	typedef test_group<vfs_data> vfs_test;
+	typedef vfs_test::object vfs_object;
+	tut::vfs_test vfs_testcase("vfs");
+
+	template<> template<>
+	void vfs_object::test<1>()
+	{
+		LLVFS::setUseMappedReads(TRUE);
+		LLVFS* vfs = createVFS();
+		ensure("vfs valid", vfs->isValid());
+		ensure("data file mapped", vfs->isDataMapped());
+
+		std::vector<U8> expected(VFS_TUT_FILE_SIZE);
+		std::vector<U8> buffer(VFS_TUT_FILE_SIZE);
+		fill_pattern(&expected[0], VFS_TUT_FILE_SIZE, 3);
+		ensure_equals("read size", vfs->getData(mIDs[3], LLAssetType::AT_NOTECARD, &buffer[0], 0, VFS_TUT_FILE_SIZE), VFS_TUT_FILE_SIZE);
+		ensure("mapped read matches", buffer == expected);
+
+		// Writes must be visible to later mapped reads
+		expected[100] = ~expected[100];
+		vfs->storeData(mIDs[3], LLAssetType::AT_NOTECARD, &expected[100], 100, 1);
+		vfs->getData(mIDs[3], LLAssetType::AT_NOTECARD, &buffer[0], 0, VFS_TUT_FILE_SIZE);
+		ensure("mapped read sees write", buffer == expected);
+		delete vfs;
+	}
+
+	template<> template<>
+	void vfs_object::test<2>()
+	{
+		LLVFS::setUseMappedReads(FALSE);
+		LLVFS* vfs = createVFS();
+		ensure("data file not mapped", !vfs->isDataMapped());
+
+		std::vector<U8> expected(VFS_TUT_FILE_SIZE);
+		std::vector<U8> buffer(VFS_TUT_FILE_SIZE);
+		fill_pattern(&expected[0], VFS_TUT_FILE_SIZE, 5);
+		ensure_equals("read size", vfs->getData(mIDs[5], LLAssetType::AT_NOTECARD, &buffer[0], 0, VFS_TUT_FILE_SIZE), VFS_TUT_FILE_SIZE);
+		ensure("buffered read matches", buffer == expected);
+		delete vfs;
+	}
+
+	template<> template<>
+	void vfs_object::test<3>()
+		// concurrent LLVFile readers share the lock, buffered and mapped
+	{
+		LLVFS::setUseMappedReads(FALSE);
+		LLVFS* vfs = createVFS();
+		ensure_equals("buffered read errors", runConcurrentReads(vfs), 0);
+		delete vfs;
+
+		LLVFS::setUseMappedReads(TRUE);
+		vfs = createVFS();
+		ensure_equals("mapped read errors", runConcurrentReads(vfs), 0);
+		delete vfs;
+	}
+
+	template<> template<>
+	void vfs_object::test<4>()
+		// a synchronous read waits for the queued appends to the same file
+	{
+		LLVFS::setUseMappedReads(TRUE);
+		LLVFS* vfs = createVFS();
+
+		std::vector<U8> expected(2 * VFS_TUT_FILE_SIZE);
+		fill_pattern(&expected[0], VFS_TUT_FILE_SIZE, 7);
+		fill_pattern(&expected[VFS_TUT_FILE_SIZE], VFS_TUT_FILE_SIZE, 8);
+		{
+			LLVFile file(vfs, mIDs[7], LLAssetType::AT_NOTECARD, LLVFile::APPEND);
+			file.setMaxSize(2 * VFS_TUT_FILE_SIZE);
+			file.write(&expected[VFS_TUT_FILE_SIZE], VFS_TUT_FILE_SIZE);
+		}
+
+		std::vector<U8> buffer(2 * VFS_TUT_FILE_SIZE);
+		LLVFile file(vfs, mIDs[7], LLAssetType::AT_NOTECARD, LLVFile::READ);
+		file.read(&buffer[0], 2 * VFS_TUT_FILE_SIZE);	/* Flawfinder: ignore */
+		ensure_equals("read after append size", file.getLastBytesRead(), 2 * VFS_TUT_FILE_SIZE);
+		ensure("read after append matches", buffer == expected);
+		delete vfs;
+	}
+}
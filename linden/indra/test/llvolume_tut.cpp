@@ -0,0 +1,303 @@
+/**
+ * @file llvolume_tut.cpp
+ * @brief LLVolume ray picking and background build tests.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include <tut/tut.hpp>
+#include "linden_common.h"
+#include "lltut.h"
+
+#include "llmath.h"
+#include "llrand.h"
+#include "lltimer.h"
+#include "llvolume.h"
+#include "llvolumemgr.h"
+#include "v2math.h"
+#include "v3math.h"
+
+namespace
+{
+	struct Segment
+	{
+		LLVector3 mStart;
+		LLVector3 mEnd;
+	};
+
+	// A lumpy sphere, like the sculpt maps people actually upload
+	void make_sculpt_map(std::vector<U8>& data, U16 width, U16 height)
+	{
+		data.resize(width * height * 3);
+		for (U16 y = 0; y < height; y++)
+		{
+			F32 v = F_PI * (F32)y / (F32)(height - 1);
+			for (U16 x = 0; x < width; x++)
+			{
+				F32 u = F_TWO_PI * (F32)x / (F32)width;
+				F32 r = 0.8f + 0.2f * sinf(5.f * u) * sinf(7.f * v);
+				LLVector3 pos(r * sinf(v) * cosf(u), r * sinf(v) * sinf(u), r * cosf(v));
+				U8* pixel = &data[(y * width + x) * 3];
+				for (U32 i = 0; i < 3; i++)
+				{
+					pixel[i] = (U8)llclamp(llround(127.5f + 127.5f * pos.mV[i]), 0, 255);
+				}
+			}
+		}
+	}
+
+	// Segments from outside the unit box through points inside it, the way
+	// hover picks cross a prim.
+	void make_segments(std::vector<Segment>& segments, S32 count)
+	{
+		segments.resize(count);
+		for (S32 i = 0; i < count; i++)
+		{
+			LLVector3 target(ll_frand() - 0.5f, ll_frand() - 0.5f, ll_frand() - 0.5f);
+			LLVector3 dir(ll_frand() - 0.5f, ll_frand() - 0.5f, ll_frand() - 0.5f);
+			dir.normVec();
+			segments[i].mStart = target - dir * 2.f;
+			segments[i].mEnd = target + dir * 2.f;
+		}
+	}
+
+	S32 count_triangles(LLVolume* volume)
+	{
+		S32 count = 0;
+		for (S32 i = 0; i < volume->getNumVolumeFaces(); i++)
+		{
+			count += volume->getVolumeFace(i).mIndices.size() / 3;
+		}
+		return count;
+	}
+
+	// Waits for the manager's background builds, as the viewer's frame loop would.
+	bool wait_for_builds(LLVolumeMgr& volume_mgr)
+	{
+		LLTimer timer;
+		while (volume_mgr.updateBuilds() > 0)
+		{
+			if (timer.getElapsedTimeF32() > 10.f)
+			{
+				return false;
+			}
+			ms_sleep(1);
+		}
+		return true;
+	}
+}
+
+namespace tut
+{
+	struct LLVolumeTestData
+	{
+		std::vector<LLPointer<LLVolume> > mVolumes;
+		std::vector<std::string> mNames;
+
+		LLVolumeTestData()
+		{
+			LLVolumeParams params;
+
+			// twisted, hollow torus
+			params.setType(LL_PCODE_PROFILE_CIRCLE, LL_PCODE_PATH_CIRCLE);
+			params.setRatio(1.f, 0.25f);
+			params.setHollow(0.5f);
+			params.setTwistEnd(0.5f);
+			addVolume(new LLVolume(params, 4.f), "torus");
+
+			// tapered box with a cut
+			LLVolumeParams box_params;
+			box_params.setType(LL_PCODE_PROFILE_SQUARE, LL_PCODE_PATH_LINE);
+			box_params.setBeginAndEndS(0.125f, 0.875f);
+			box_params.setTaper(0.3f, -0.3f);
+			addVolume(new LLVolume(box_params, 4.f), "box");
+
+			// high detail sculpty
+			LLVolumeParams sculpt_params;
+			sculpt_params.setType(LL_PCODE_PROFILE_CIRCLE, LL_PCODE_PATH_CIRCLE);
+			LLUUID sculpt_id;
+			sculpt_id.generate();
+			sculpt_params.setSculptID(sculpt_id, LL_SCULPT_TYPE_SPHERE);
+			LLVolume* sculpt = new LLVolume(sculpt_params, 4.f);
+			std::vector<U8> map;
+			make_sculpt_map(map, 64, 64);
+			sculpt->sculpt(64, 64, 3, &map[0], 0);
+			addVolume(sculpt, "sculpt");
+		}
+
+		~LLVolumeTestData()
+		{
+			LLVolumeFace::sUseBVH = TRUE;
+		}
+
+		void addVolume(LLVolume* volume, const std::string& name)
+		{
+			mVolumes.push_back(volume);
+			mNames.push_back(name);
+		}
+	};
+
+	typedef test_group<LLVolumeTestData> LLVolumeTestGroup;
+	typedef LLVolumeTestGroup::object LLVolumeTestObject;
+	LLVolumeTestGroup volumeTestGroup("LLVolume");
+
+	template<> template<>
+	void LLVolumeTestObject::test<1>()
+		// the hierarchy finds the same hits as testing every triangle
+	{
+		std::vector<Segment> segments;
+		make_segments(segments, 2000);
+
+		for (U32 v = 0; v < mVolumes.size(); v++)
+		{
+			LLVolume* volume = mVolumes[v];
+			ensure((mNames[v] + " has faces").c_str(), volume->getNumVolumeFaces() > 0);
+
+			S32 hits = 0;
+			for (U32 i = 0; i < segments.size(); i++)
+			{
+				LLVector3 brute_point, bvh_point;
+				LLVector2 brute_tc, bvh_tc;
+
+				LLVolumeFace::sUseBVH = FALSE;
+				S32 brute_face = volume->lineSegmentIntersect(segments[i].mStart, segments[i].mEnd, -1, &brute_point, &brute_tc);
+				LLVolumeFace::sUseBVH = TRUE;
+				S32 bvh_face = volume->lineSegmentIntersect(segments[i].mStart, segments[i].mEnd, -1, &bvh_point, &bvh_tc);
+
+				ensure_equals((mNames[v] + " hit face").c_str(), bvh_face, brute_face);
+				if (brute_face >= 0)
+				{
+					hits++;
+					ensure_distance((mNames[v] + " hit point x").c_str(), bvh_point.mV[VX], brute_point.mV[VX], 0.0001f);
+					ensure_distance((mNames[v] + " hit point y").c_str(), bvh_point.mV[VY], brute_point.mV[VY], 0.0001f);
+					ensure_distance((mNames[v] + " hit point z").c_str(), bvh_point.mV[VZ], brute_point.mV[VZ], 0.0001f);
+				}
+			}
+			ensure((mNames[v] + " is hit at all").c_str(), hits > 0);
+		}
+	}
+
+	template<> template<>
+	void LLVolumeTestObject::test<2>()
+		// moving a flexible path rebuilds the faces in place, which must
+		// drop the stale hierarchy
+	{
+		LLVolumeParams params;
+		params.setType(LL_PCODE_PROFILE_CIRCLE, LL_PCODE_PATH_FLEXIBLE);
+		LLPointer<LLVolume> volume = new LLVolume(params, 4.f);
+
+		const S32 SECTIONS = 8;
+		volume->resizePath(SECTIONS + 1);
+		for (S32 offset = 0; offset < 2; offset++)
+		{
+			LLPath& path = volume->getPath();
+			for (S32 i = 0; i <= SECTIONS; i++)
+			{
+				path.mPath[i].mPos.setVec(0.3f * offset, 0.f, (F32)i / SECTIONS - 0.5f);
+				path.mPath[i].mRot.setQuat(0, 0, 0);
+				path.mPath[i].mScale.setVec(1, 1);
+				path.mPath[i].mTexT = (F32)i / SECTIONS;
+			}
+			volume->regen();
+
+			// a segment along x through the middle of the tube
+			LLVector3 start(2.f, 0.1f, 0.05f);
+			LLVector3 end(-2.f, 0.1f, 0.05f);
+			LLVector3 brute_point, bvh_point;
+			LLVolumeFace::sUseBVH = FALSE;
+			S32 brute_face = volume->lineSegmentIntersect(start, end, -1, &brute_point);
+			LLVolumeFace::sUseBVH = TRUE;
+			S32 bvh_face = volume->lineSegmentIntersect(start, end, -1, &bvh_point);
+
+			ensure("tube is hit", brute_face >= 0);
+			ensure_equals("same face after regen", bvh_face, brute_face);
+			ensure_distance("same point after regen", bvh_point.mV[VX], brute_point.mV[VX], 0.0001f);
+			ensure_distance("hit follows the path", bvh_point.mV[VX], 0.3f * offset + 0.5f, 0.05f);
+		}
+	}
+
+	template<> template<>
+	void LLVolumeTestObject::test<3>()
+		// background builds match synchronous ones, identical requests
+		// share one build and newer sculpt data replaces a pending build
+	{
+		LLVolumeMgr volume_mgr;
+		volume_mgr.useBuildQueue(true);
+
+		LLVolumeParams params;
+		params.setType(LL_PCODE_PROFILE_CIRCLE, LL_PCODE_PATH_CIRCLE);
+		params.setRatio(1.f, 0.25f);
+		params.setHollow(0.5f);
+
+		// an object showing the lowest LOD keeps the group alive
+		LLPointer<LLVolume> low = volume_mgr.refVolume(params, 0);
+		ensure("high LOD not built yet", !volume_mgr.isVolumeReady(params, 3));
+		volume_mgr.requestBuild(params, 3);
+		volume_mgr.requestBuild(params, 3);
+		ensure_equals("identical requests coalesced", volume_mgr.getNumPendingBuilds(), 1);
+		ensure("build pending", volume_mgr.isBuildPending(params, 3));
+		ensure("builds finish", wait_for_builds(volume_mgr));
+		ensure("high LOD ready", volume_mgr.isVolumeReady(params, 3));
+
+		LLPointer<LLVolume> high = volume_mgr.refVolume(params, 3);
+		LLPointer<LLVolume> reference = new LLVolume(params, LLVolumeLODGroup::getVolumeScaleFromDetail(3));
+		ensure_equals("same faces", high->getNumVolumeFaces(), reference->getNumVolumeFaces());
+		ensure_equals("same triangles", count_triangles(high), count_triangles(reference));
+
+		// a sculpt is updated in place, since objects already hold its volume
+		LLVolumeParams sculpt_params;
+		sculpt_params.setType(LL_PCODE_PROFILE_CIRCLE, LL_PCODE_PATH_CIRCLE);
+		LLUUID sculpt_id;
+		sculpt_id.generate();
+		sculpt_params.setSculptID(sculpt_id, LL_SCULPT_TYPE_SPHERE);
+		std::vector<U8> map;
+		make_sculpt_map(map, 64, 64);
+
+		LLPointer<LLVolume> sculpt = volume_mgr.refVolume(sculpt_params, 3);
+		ensure("sculpt waits for its map", !volume_mgr.isVolumeReady(sculpt_params, 3));
+		// the newest sculpt data wins over a build still pending
+		volume_mgr.requestBuild(sculpt_params, 3, 64, 64, 3, &map[0], 1);
+		volume_mgr.requestBuild(sculpt_params, 3, 64, 64, 3, &map[0], 0);
+		ensure_equals("sculpt request replaced", volume_mgr.getNumPendingBuilds(), 1);
+		ensure("sculpt finishes", wait_for_builds(volume_mgr));
+		ensure_equals("sculpt level", sculpt->getSculptLevel(), 0);
+
+		LLPointer<LLVolume> sculpt_reference = new LLVolume(sculpt_params, LLVolumeLODGroup::getVolumeScaleFromDetail(3));
+		sculpt_reference->sculpt(64, 64, 3, &map[0], 0);
+		ensure_equals("same sculpt triangles", count_triangles(sculpt), count_triangles(sculpt_reference));
+
+		S32 num_builds = 0;
+		volume_mgr.getBuildTime(num_builds);
+		ensure_equals("builds counted", num_builds, 2);
+
+		volume_mgr.unrefVolume(sculpt);
+		volume_mgr.unrefVolume(high);
+		volume_mgr.unrefVolume(low);
+		ensure("no dangling references", volume_mgr.cleanup());
+	}
+}
@@ -0,0 +1,318 @@
+/**
+ * @file lscript_predecode_tut.cpp
+ * @brief Tests comparing predecoded LSL2 execution with the interpreter.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#include <tut/tut.hpp>
+#include "linden_common.h"
+#include "lltut.h"
+
+#include "lltimer.h"
+#include "lscript_execute.h"
+
+namespace
+{
+	const S32 GLOBALS_START = 128;
+	const S32 GLOBALS_SIZE = 16;
+
+	// Assembles a single LSL2 function that runs straight from GFR.
+	class Assembler
+	{
+	public:
+		S32 here() const { return (S32)mCode.size(); }
+
+		void op(LSCRIPTOpCodesEnum opcode)
+		{
+			mCode.push_back(LSCRIPTOpCodes[opcode]);
+		}
+		void op(LSCRIPTOpCodesEnum opcode, S32 arg)
+		{
+			op(opcode);
+			integer(arg);
+		}
+		void opf(LSCRIPTOpCodesEnum opcode, F32 arg)
+		{
+			op(opcode);
+			integer(*(S32 *)&arg);
+		}
+		void opb(LSCRIPTOpCodesEnum opcode, U8 arg)
+		{
+			op(opcode);
+			mCode.push_back(arg);
+		}
+		void typed(LSCRIPTOpCodesEnum opcode, LSCRIPTType left, LSCRIPTType right)
+		{
+			opb(opcode, (U8)((left << 4) | right));
+		}
+
+		// Jumps are relative to the end of the instruction.  Returns the
+		// operand's position for patch().
+		S32 jump(S32 target = 0)
+		{
+			op(LOPC_JUMP);
+			S32 at = here();
+			integer(target - (at + 4));
+			return at;
+		}
+		S32 jumpif(LSCRIPTOpCodesEnum opcode, LSCRIPTType type, S32 target = 0)
+		{
+			opb(opcode, (U8)type);
+			S32 at = here();
+			integer(target - (at + 4));
+			return at;
+		}
+		void patch(S32 at, S32 target)
+		{
+			S32 offset = at;
+			integer2bytestream(&mCode[0], offset, target - (at + 4));
+		}
+
+		// Returns a script image whose IP points at the code, with a stack
+		// frame that RETURN unwinds to IP 0.
+		std::vector<U8> image() const
+		{
+			std::vector<U8> image(TOP_OF_MEMORY, 0);
+			U8* buffer = &image[0];
+			S32 gfr = GLOBALS_START + GLOBALS_SIZE;
+			S32 hr = gfr + (S32)mCode.size();
+			memcpy(buffer + gfr, &mCode[0], mCode.size());
+
+			S32 top = TOP_OF_MEMORY - 1;
+			S32 offset = top - 4;
+			integer2bytestream(buffer, offset, 0);		// return IP
+			offset = top - 8;
+			integer2bytestream(buffer, offset, top);	// caller BP
+
+			set_register(buffer, LREG_TM, TOP_OF_MEMORY);
+			set_register(buffer, LREG_VN, LSL2_VERSION_NUMBER);
+			set_register(buffer, LREG_IP, gfr);
+			set_register(buffer, LREG_BP, top - 8);
+			set_register(buffer, LREG_SP, top - 8);
+			set_register(buffer, LREG_GVR, GLOBALS_START);
+			set_register(buffer, LREG_GFR, gfr);
+			set_register(buffer, LREG_SR, hr);
+			set_register(buffer, LREG_HR, hr);
+			set_register(buffer, LREG_HP, hr);
+			return image;
+		}
+
+	private:
+		void integer(S32 value)
+		{
+			U8 bytes[4];
+			S32 offset = 0;
+			integer2bytestream(bytes, offset, value);
+			mCode.insert(mCode.end(), bytes, bytes + 4);
+		}
+
+		std::vector<U8> mCode;
+	};
+
+	// Locals of the test loop, offsets from BP
+	const S32 LOCAL_I = 0;
+	const S32 LOCAL_SUM = 4;
+	const S32 LOCAL_F = 8;
+
+	// for (i = 0; i < count; i++) with integer, float, global and
+	// fallback instructions in the body
+	Assembler loop_script(S32 count)
+	{
+		Assembler a;
+		a.op(LOPC_PUSHE);						// i
+		a.op(LOPC_PUSHE);						// sum
+		a.opf(LOPC_PUSHARGF, 0.f);				// f
+		a.op(LOPC_PUSHARGI, 7);
+		a.op(LOPC_LOADGP, 0);
+
+		S32 loop = a.here();
+		a.op(LOPC_PUSHARGI, count);
+		a.op(LOPC_PUSH, LOCAL_I);
+		a.typed(LOPC_LESS, LST_INTEGER, LST_INTEGER);
+		S32 exit = a.jumpif(LOPC_JUMPNIF, LST_INTEGER);
+
+		// sum += i; sum % 7
+		a.op(LOPC_PUSH, LOCAL_SUM);
+		a.op(LOPC_PUSH, LOCAL_I);
+		a.typed(LOPC_ADD, LST_INTEGER, LST_INTEGER);
+		a.op(LOPC_LOADP, LOCAL_SUM);
+		a.op(LOPC_PUSHARGI, 7);
+		a.op(LOPC_PUSH, LOCAL_SUM);
+		a.typed(LOPC_MOD, LST_INTEGER, LST_INTEGER);
+		a.op(LOPC_POP);
+
+		// f += 0.5; if (f) global += 1
+		a.opf(LOPC_PUSHARGF, 0.5f);
+		a.op(LOPC_PUSH, LOCAL_F);
+		a.typed(LOPC_ADD, LST_FLOATINGPOINT, LST_FLOATINGPOINT);
+		a.op(LOPC_STORE, LOCAL_F);
+		S32 skip = a.jumpif(LOPC_JUMPNIF, LST_FLOATINGPOINT);
+		a.op(LOPC_PUSHG, 0);
+		a.op(LOPC_PUSHARGI, 1);
+		a.typed(LOPC_ADD, LST_INTEGER, LST_INTEGER);
+		a.op(LOPC_LOADGP, 0);
+		a.patch(skip, a.here());
+
+		// global ^= i; -i; i mixed with float
+		a.op(LOPC_PUSHG, 0);
+		a.op(LOPC_PUSH, LOCAL_I);
+		a.op(LOPC_BITXOR);
+		a.op(LOPC_STOREG, 0);
+		a.op(LOPC_POP);
+		a.op(LOPC_PUSH, LOCAL_I);
+		a.opb(LOPC_NEG, LST_INTEGER);
+		a.op(LOPC_POP);
+		a.op(LOPC_PUSH, LOCAL_F);
+		a.op(LOPC_PUSH, LOCAL_I);
+		a.typed(LOPC_MUL, LST_INTEGER, LST_FLOATINGPOINT);
+		a.op(LOPC_POP);
+
+		// instructions without their own handler
+		a.op(LOPC_PUSH, LOCAL_I);
+		a.op(LOPC_DUP);
+		a.op(LOPC_POPARG, 8);
+		a.opb(LOPC_PUSHARGB, 5);
+		a.op(LOPC_POPARG, 1);
+		a.op(LOPC_NOOP);
+
+		// i++
+		a.op(LOPC_PUSHARGI, 1);
+		a.op(LOPC_PUSH, LOCAL_I);
+		a.typed(LOPC_ADD, LST_INTEGER, LST_INTEGER);
+		a.op(LOPC_LOADP, LOCAL_I);
+		a.jump(loop);
+
+		a.patch(exit, a.here());
+		a.op(LOPC_RETURN);
+		return a;
+	}
+
+	// Runs the script until it returns or faults.
+	void run_script(LLScriptExecuteLSL2& script)
+	{
+		LLTimer slice;
+		const char* error = NULL;
+		U32 events = 0;
+		while (!script.isFinished() && !script.getFaults())
+		{
+			slice.reset();
+			script.runQuanta(FALSE, LLUUID::null, &error, 0.01f, events, slice);
+		}
+	}
+
+	// Runs image interpreted and predecoded and checks they end up the same.
+	void ensure_same_result(const std::string& msg, const std::vector<U8>& image, S32 fault)
+	{
+		LLScriptExecuteLSL2 interpreted(&image[0], (U32)image.size());
+		run_script(interpreted);
+
+		LLScriptExecuteLSL2 predecoded(&image[0], (U32)image.size());
+		predecoded.setPredecoded(true);
+		tut::ensure((msg + " predecoded").c_str(), predecoded.isPredecoded());
+		run_script(predecoded);
+
+		tut::ensure_equals(msg + " fault", interpreted.getFaults(), fault);
+		tut::ensure_equals(msg + " predecoded fault", predecoded.getFaults(), fault);
+		tut::ensure_equals(msg + " instruction count", predecoded.mInstructionCount, interpreted.mInstructionCount);
+		tut::ensure((msg + " memory").c_str(), !memcmp(interpreted.mBuffer, predecoded.mBuffer, TOP_OF_MEMORY));
+	}
+}
+
+namespace tut
+{
+	struct LScriptPredecodeTestData
+	{
+	};
+
+	typedef test_group<LScriptPredecodeTestData> LScriptPredecodeTestGroup;
+	typedef LScriptPredecodeTestGroup::object LScriptPredecodeTestObject;
+	LScriptPredecodeTestGroup lscriptPredecodeTestGroup("LScriptPredecode");
+
+	template<> template<>
+	void LScriptPredecodeTestObject::test<1>()
+		// a loop runs to the same state both ways
+	{
+		const S32 COUNT = 1000;
+		std::vector<U8> image = loop_script(COUNT).image();
+		ensure_same_result("loop", image, LSRF_INVALID);
+
+		LLScriptExecuteLSL2 script(&image[0], (U32)image.size());
+		script.setPredecoded(true);
+		run_script(script);
+		ensure("finished", script.isFinished());
+		S32 offset = GLOBALS_START;
+		S32 global = bytestream2integer(script.mBuffer, offset);
+		ensure("global changed", global != 7);
+		offset = TOP_OF_MEMORY - 1 - 8 - LOCAL_SUM - 4;
+		ensure_equals("sum", bytestream2integer(script.mBuffer, offset), COUNT * (COUNT - 1) / 2);
+		ensure("energy used", get_register_fp(script.mBuffer, LREG_ESR) < 0.f);
+	}
+
+	template<> template<>
+	void LScriptPredecodeTestObject::test<2>()
+		// faults stop both at the same instruction
+	{
+		// 100 / i counting down to a division by zero
+		Assembler divide;
+		divide.op(LOPC_PUSHARGI, 5);
+		S32 loop = divide.here();
+		divide.op(LOPC_PUSH, LOCAL_I);
+		divide.op(LOPC_PUSHARGI, 100);
+		divide.typed(LOPC_DIV, LST_INTEGER, LST_INTEGER);
+		divide.op(LOPC_POP);
+		divide.op(LOPC_PUSHARGI, 1);
+		divide.op(LOPC_PUSH, LOCAL_I);
+		divide.typed(LOPC_SUB, LST_INTEGER, LST_INTEGER);
+		divide.op(LOPC_LOADP, LOCAL_I);
+		divide.jump(loop);
+		ensure_same_result("divide", divide.image(), LSRF_MATH);
+
+		// a jump out of the code
+		Assembler jump;
+		jump.op(LOPC_PUSHARGI, 1);
+		jump.op(LOPC_POP);
+		jump.jump(-1000);
+		ensure_same_result("jump", jump.image(), LSRF_BOUND_CHECK_ERROR);
+
+		// pushing until the stack meets the heap
+		Assembler push;
+		S32 top = push.here();
+		push.op(LOPC_PUSHE);
+		push.jump(top);
+		ensure_same_result("push", push.image(), LSRF_STACK_HEAP_COLLISION);
+
+		// a local outside the frame
+		Assembler local;
+		local.op(LOPC_PUSHARGI, 3);
+		local.op(LOPC_LOADP, -64);
+		local.op(LOPC_RETURN);
+		ensure_same_result("local", local.image(), LSRF_BOUND_CHECK_ERROR);
+	}
+}